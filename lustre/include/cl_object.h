@@ -288,6 +288,8 @@ struct cl_layout {
 	size_t		cl_size;
 	/** Layout generation. */
 	u32		cl_layout_gen;
+	/** data is stored on the MDT, see LOV_PATTERN_MDT */
+	bool		cl_is_dom;
 };
 
 /**
@@ -1837,6 +1839,11 @@ struct cl_io {
 	 * file is released, restore has to to be triggered by vvp layer
 	 */
 			     ci_restore_needed:1,
+	/**
+	 * the IO writes to components of a composite layout which are not
+	 * instantiated yet, a write intent has to be sent by vvp layer
+	 */
+			     ci_need_write_intent:1,
 	/**
 	 * O_NOATIME
 	 */
@@ -1845,6 +1852,20 @@ struct cl_io {
 	 * Number of pages owned by this IO. For invariant checking.
 	 */
 	unsigned	     ci_owned_nr;
+	/**
+	 * Extent of the write intent, see ci_need_write_intent.
+	 */
+	struct lu_extent     ci_write_intent;
+	/**
+	 * Layout intent opcode to send, LAYOUT_INTENT_WRITE, or
+	 * LAYOUT_INTENT_TRUNC when a mirrored file is truncated.
+	 */
+	__u32		     ci_write_intent_opc;
+	/**
+	 * Mirror id the IO is restricted to, 0 to let lov pick the mirror.
+	 * Set by the tools resynchronizing the mirrors of a file.
+	 */
+	__u32		     ci_designated_mirror;
 };
 
 /** @} cl_io */
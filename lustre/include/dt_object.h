@@ -68,6 +68,7 @@ struct dt_index_features;
 struct niobuf_local;
 struct niobuf_remote;
 struct ldlm_enqueue_info;
+struct layout_intent;
 
 typedef enum {
         MNTOPT_USERXATTR        = 0x00000001,
@@ -1015,6 +1016,46 @@ struct dt_object_operations {
 				struct dt_object *dt,
 				struct ldlm_enqueue_info *einfo,
 				union ldlm_policy_data *policy);
+
+	/**
+	 * Declare intention to change the layout of an object.
+	 *
+	 * Notify the underlying filesystem that the layout of the object may
+	 * be changed to serve \a layout, e.g. the components of a composite
+	 * layout covering the extent a client is going to write to may be
+	 * instantiated. The objects needed for that are reserved here.
+	 *
+	 * \param[in] env	execution environment for this thread
+	 * \param[in] dt	object
+	 * \param[in] layout	layout intent
+	 * \param[in] th	transaction handle
+	 *
+	 * \retval 0		on success
+	 * \retval -EALREADY	the layout already serves the intent
+	 * \retval negative	negated errno on error
+	 */
+	int (*do_declare_layout_change)(const struct lu_env *env,
+					struct dt_object *dt,
+					struct layout_intent *layout,
+					struct thandle *th);
+
+	/**
+	 * Change the layout of an object.
+	 *
+	 * Apply the change declared with ->do_declare_layout_change() and
+	 * store the new layout of the object.
+	 *
+	 * \param[in] env	execution environment for this thread
+	 * \param[in] dt	object
+	 * \param[in] layout	layout intent
+	 * \param[in] th	transaction handle
+	 *
+	 * \retval 0		on success
+	 * \retval negative	negated errno on error
+	 */
+	int (*do_layout_change)(const struct lu_env *env, struct dt_object *dt,
+				struct layout_intent *layout,
+				struct thandle *th);
 };
 
 /**
@@ -1988,6 +2029,30 @@ static inline int dt_object_unlock(const struct lu_env *env,
 	return o->do_ops->do_object_unlock(env, o, einfo, policy);
 }
 
+static inline int dt_declare_layout_change(const struct lu_env *env,
+					   struct dt_object *o,
+					   struct layout_intent *layout,
+					   struct thandle *th)
+{
+	LASSERT(o != NULL);
+	LASSERT(o->do_ops != NULL);
+	if (o->do_ops->do_declare_layout_change == NULL)
+		return -EOPNOTSUPP;
+	return o->do_ops->do_declare_layout_change(env, o, layout, th);
+}
+
+static inline int dt_layout_change(const struct lu_env *env,
+				   struct dt_object *o,
+				   struct layout_intent *layout,
+				   struct thandle *th)
+{
+	LASSERT(o != NULL);
+	LASSERT(o->do_ops != NULL);
+	if (o->do_ops->do_layout_change == NULL)
+		return -EOPNOTSUPP;
+	return o->do_ops->do_layout_change(env, o, layout, th);
+}
+
 int dt_lookup_dir(const struct lu_env *env, struct dt_object *dir,
 		  const char *name, struct lu_fid *fid);
 
@@ -120,6 +120,7 @@
 #define SEQ_DATA_PORTAL                31
 #define SEQ_CONTROLLER_PORTAL          32
 #define MGS_BULK_PORTAL                33
+#define MDS_IO_PORTAL                  34
 
 /* Portal 63 is reserved for the Cray Inc DVS - nic@cray.com, roe@cray.com, n8851@cray.com */
 
@@ -228,6 +229,25 @@ struct hsm_attrs {
 };
 extern void lustre_hsm_swab(struct hsm_attrs *attrs);
 
+/**
+ * Lazy size-on-MDT attributes of a regular file, stored in XATTR_NAME_SOM.
+ * They are refreshed on close and truncate, so they may lag behind the size
+ * and blocks known by the OSTs while the file is being written.
+ */
+enum lustre_som_flags {
+	SOM_FL_UNKNOWN	= 0x0000, /* no usable attributes */
+	SOM_FL_STALE	= 0x0002, /* attributes invalidated by layout change */
+	SOM_FL_LAZY	= 0x0004, /* attributes may be out of date */
+};
+
+struct lustre_som_attrs {
+	__u16	lsa_valid;	/* see lustre_som_flags */
+	__u16	lsa_reserved[3];
+	__u64	lsa_size;
+	__u64	lsa_blocks;
+};
+extern void lustre_som_swab(struct lustre_som_attrs *attrs);
+
 /**
  * fid constants
  */
@@ -1249,6 +1269,15 @@ struct ptlrpc_body_v2 {
 #define OBD_CONNECT_BULK_MBITS	 0x2000000000000000ULL
 #define OBD_CONNECT_OBDOPACK	 0x4000000000000000ULL /* compact OUT obdo */
 #define OBD_CONNECT_FLAGS2	 0x8000000000000000ULL /* second flags word */
+/* ocd_connect_flags2 flags */
+#define OBD_CONNECT2_BATCH_GETATTR	0x1ULL /* MDS_BATCH_GETATTR RPC */
+/* 0x2ULL is reserved for cooperative caching between clients */
+#define OBD_CONNECT2_LOCK_CONVERT	0x4ULL /* drop IBITS via LDLM_CONVERT */
+#define OBD_CONNECT2_BL_BATCH		0x8ULL /* many locks per BL callback */
+#define OBD_CONNECT2_LOCK_REPLAY_BATCH	0x10ULL /* many locks per replay */
+#define OBD_CONNECT2_DOM		0x20ULL /* data on MDT, MDS_IO_PORTAL */
+#define OBD_CONNECT2_BATCH_GETATTR_LOCK	0x40ULL /* batched getattr locks */
+#define OBD_CONNECT2_BRW_COMPRESS	0x80ULL /* compressed BRW bulk */
 /* XXX README XXX:
  * Please DO NOT add flag values here before first ensuring that this same
  * flag value is not in use on some other branch.  Please clear any such
@@ -1295,7 +1324,15 @@ struct ptlrpc_body_v2 {
 				OBD_CONNECT_OPEN_BY_FID | \
 				OBD_CONNECT_DIR_STRIPE | \
 				OBD_CONNECT_BULK_MBITS | \
-				OBD_CONNECT_MULTIMODRPCS)
+				OBD_CONNECT_MULTIMODRPCS | \
+				OBD_CONNECT_FLAGS2)
+
+#define MDT_CONNECT_SUPPORTED2 (OBD_CONNECT2_BATCH_GETATTR | \
+				OBD_CONNECT2_LOCK_CONVERT | \
+				OBD_CONNECT2_BL_BATCH | \
+				OBD_CONNECT2_LOCK_REPLAY_BATCH | \
+				OBD_CONNECT2_DOM | \
+				OBD_CONNECT2_BATCH_GETATTR_LOCK)
 
 #define OST_CONNECT_SUPPORTED  (OBD_CONNECT_SRVLOCK | OBD_CONNECT_GRANT | \
                                 OBD_CONNECT_REQPORTAL | OBD_CONNECT_VERSION | \
@@ -1315,7 +1352,13 @@ struct ptlrpc_body_v2 {
 				OBD_CONNECT_LAYOUTLOCK | OBD_CONNECT_FID | \
 				OBD_CONNECT_PINGLESS | OBD_CONNECT_LFSCK | \
 				OBD_CONNECT_BULK_MBITS | \
-				OBD_CONNECT_GRANT_PARAM)
+				OBD_CONNECT_GRANT_PARAM | \
+				OBD_CONNECT_FLAGS2)
+
+#define OST_CONNECT_SUPPORTED2 (OBD_CONNECT2_BL_BATCH | \
+				OBD_CONNECT2_LOCK_REPLAY_BATCH | \
+				OBD_CONNECT2_BRW_COMPRESS)
+
 #define ECHO_CONNECT_SUPPORTED (0)
 #define MGS_CONNECT_SUPPORTED  (OBD_CONNECT_VERSION | OBD_CONNECT_AT | \
 				OBD_CONNECT_FULL20 | OBD_CONNECT_IMP_RECOV | \
@@ -1443,6 +1486,7 @@ enum obdo_flags {
         OBD_FL_NOSPC_BLK    = 0x00100000, /* no more block space on OST */
 	OBD_FL_FLUSH	    = 0x00200000, /* flush pages on the OST */
 	OBD_FL_SHORT_IO	    = 0x00400000, /* short io request */
+	OBD_FL_BRW_COMPRESS = 0x00800000, /* bulk data is compressed */
 
         /* Note that while these checksum values are currently separate bits,
          * in 2.x we can actually allow all values from 1-31 if we wanted. */
@@ -1469,6 +1513,7 @@ enum obdo_flags {
 #define LOV_MAGIC_MIGRATE	(0x0BD40000 | LOV_MAGIC_MAGIC)
 /* reserved for specifying OSTs */
 #define LOV_MAGIC_SPECIFIC	(0x0BD50000 | LOV_MAGIC_MAGIC)
+#define LOV_MAGIC_COMP_V1	(0x0BD60000 | LOV_MAGIC_MAGIC)
 #define LOV_MAGIC		LOV_MAGIC_V1
 
 /*
@@ -1485,6 +1530,7 @@ enum obdo_flags {
  */
 #define LOV_MAGIC_V1_DEF  0x0CD10BD0
 #define LOV_MAGIC_V3_DEF  0x0CD30BD0
+#define LOV_MAGIC_COMP_V1_DEF 0x0CD60BD0
 
 #define lov_pattern(pattern)		(pattern & ~LOV_PATTERN_F_MASK)
 #define lov_pattern_flags(pattern)	(pattern & LOV_PATTERN_F_MASK)
@@ -1717,6 +1763,8 @@ lov_mds_md_max_stripe_count(size_t buf_size, __u32 lmm_magic)
 							      executed */
 
 #define OBD_MD_DEFAULT_MEA   (0x0040000000000000ULL) /* default MEA */
+#define OBD_MD_FLLAZYSIZE    (0x0080000000000000ULL) /* lazy size-on-MDT */
+#define OBD_MD_FLLAZYBLOCKS  (0x0100000000000000ULL) /* lazy blocks-on-MDT */
 
 #define OBD_MD_FLGETATTR (OBD_MD_FLID    | OBD_MD_FLATIME | OBD_MD_FLMTIME | \
                           OBD_MD_FLCTIME | OBD_MD_FLSIZE  | OBD_MD_FLBLKSZ | \
@@ -1791,6 +1839,17 @@ struct niobuf_remote {
 	__u32	rnb_flags;
 };
 
+/* With OBD_FL_BRW_COMPRESS the bulk of a BRW is a stream of chunks, each of
+ * them a brw_chunk_hdr followed by bch_csize bytes of LZ4 compressed data,
+ * or by the bch_len bytes of plain data if bch_csize == bch_len. The fields
+ * are little-endian, o_compr_nob is the size of the whole stream. */
+#define BRW_CHUNK_MAX_LEN	65536
+
+struct brw_chunk_hdr {
+	__u32	bch_len;	/* data bytes in the chunk */
+	__u32	bch_csize;	/* bytes stored after the header */
+};
+
 /* lock value block communicated between the filter and llite */
 
 /* OST_LVB_ERR_INIT is needed because the return code in rc is
@@ -2025,6 +2084,7 @@ typedef enum {
 	MDS_HSM_CT_REGISTER	= 59,
 	MDS_HSM_CT_UNREGISTER	= 60,
 	MDS_SWAP_LAYOUTS	= 61,
+	MDS_BATCH_GETATTR	= 62,
 	MDS_LAST_OPC
 } mds_cmd_t;
 
@@ -2090,8 +2150,9 @@ typedef enum {
  * will grant LOOKUP_LOCK. */
 #define MDS_INODELOCK_PERM   0x000010
 #define MDS_INODELOCK_XATTR  0x000020	/* extended attributes */
+#define MDS_INODELOCK_DOM    0x000040	/* data stored on the MDT */
 
-#define MDS_INODELOCK_MAXSHIFT 5
+#define MDS_INODELOCK_MAXSHIFT 6
 /* This FULL lock is useful to take on unlink sort of operations */
 #define MDS_INODELOCK_FULL ((1<<(MDS_INODELOCK_MAXSHIFT+1))-1)
 
@@ -2113,6 +2174,7 @@ enum {
 enum {
 	/* these should be identical to their EXT4_*_FL counterparts, they are
 	 * redefined here only to avoid dragging in fs/ext4/ext4.h */
+	LUSTRE_COMPR_FL = 0x00000004, /* Compress file data */
 	LUSTRE_SYNC_FL = 0x00000008, /* Synchronous updates */
 	LUSTRE_IMMUTABLE_FL = 0x00000010, /* Immutable file */
 	LUSTRE_APPEND_FL = 0x00000020, /* writes to file may only append */
@@ -2223,6 +2285,43 @@ struct mdt_body {
 	__u64	mbo_padding_10;
 }; /* 216 */
 
+/* maximum number of names in one MDS_BATCH_GETATTR request */
+#define MDS_BATCH_GETATTR_MAX	256
+/*
+ * maximum size of the names and lock handles of one MDS_BATCH_GETATTR
+ * request, so that it fits in MDS_REG_MAXREQSIZE with the other buffers
+ */
+#define MDS_BATCH_GETATTR_BUFSIZE	(60 * 1024)
+
+/*
+ * Per-name reply of MDS_BATCH_GETATTR. The request carries the parent
+ * directory FID in mdt_body::mbo_fid1 followed by the NUL terminated names
+ * packed back to back, the reply has one entry per name in the same order.
+ * OBD_MD_FLEASIZE is set for a regular file with a layout, the layout itself
+ * is only returned with a lock, see mdt_batch_lock_rep.
+ */
+struct mdt_batch_getattr_rep {
+	__s32		mbgr_rc;	/* 0 or -errno for this name */
+	__u32		mbgr_padding;
+	struct mdt_body	mbgr_body;	/* attributes if mbgr_rc == 0 */
+};
+
+/*
+ * With OBD_CONNECT2_BATCH_GETATTR_LOCK the client may also send one lock
+ * handle per name, the MDT then tries to grant a PR inodebits lock on each
+ * child without blocking, like an IT_GETATTR intent would. The reply has one
+ * mdt_batch_lock_rep per name, mblr_handle is zero if no lock was granted.
+ * Layouts of regular files granted MDS_INODELOCK_LAYOUT are packed back to
+ * back in the layout buffer, mdt_body::mbo_eadatasize long each.
+ */
+struct mdt_batch_lock_rep {
+	struct lustre_handle	mblr_handle;	/* server lock handle */
+	__u64			mblr_bits;	/* granted inodebits */
+};
+
+/* maximum size of the layouts returned by one MDS_BATCH_GETATTR */
+#define MDS_BATCH_GETATTR_MD_MAX	(512 * 1024)
+
 struct mdt_ioepoch {
 	struct lustre_handle mio_handle;
 	__u64 mio_unused1; /* was ioepoch */
@@ -2369,6 +2468,7 @@ enum mds_op_bias {
 	MDS_HSM_RELEASE		= 1 << 12,
 	MDS_RENAME_MIGRATE	= 1 << 13,
 	MDS_CLOSE_LAYOUT_SWAP	= 1 << 14,
+	MDS_CLOSE_LSOM		= 1 << 15, /* close carries size for LSOM */
 };
 
 /* instance of mdt_reint_rec */
@@ -2897,7 +2997,8 @@ struct ldlm_lock_desc {
 	enum ldlm_mode l_req_mode;
 	enum ldlm_mode l_granted_mode;
 	union ldlm_wire_policy_data l_policy_data;
-	int l_cc; /*ziqi: collaborative cache related metadata */
+	__u32 l_padding1;
+	__u32 l_padding2;
 };
 
 #define LDLM_LOCKREQ_HANDLES 2
@@ -2930,6 +3031,25 @@ struct ldlm_reply {
         __u64  lock_policy_res2;
 };
 
+/*
+ * Lock replay batch, LDLM_ENQUEUE with LDLM_FL_REPLAY replaying
+ * ldlm_request::lock_count locks described in RMF_DLM_REPLAY_DESC, see
+ * OBD_CONNECT2_LOCK_REPLAY_BATCH. A full batch has to fit MDS_MAXREQSIZE.
+ */
+#define LDLM_REPLAY_BATCH_MAX	32
+
+struct ldlm_replay_desc {
+	struct lustre_handle	lrd_handle;	/* client lock handle */
+	struct ldlm_lock_desc	lrd_desc;
+	__u64			lrd_flags;	/* LDLM_FL_REPLAY|LDLM_FL_BLOCK_* */
+};
+
+struct ldlm_replay_rep {
+	struct lustre_handle	lrp_handle;	/* server lock handle */
+	__s32			lrp_status;
+	__u32			lrp_padding;
+};
+
 #define ldlm_flags_to_wire(flags)    ((__u32)(flags))
 #define ldlm_flags_from_wire(flags)  ((__u64)(flags))
 
@@ -3415,7 +3535,7 @@ struct obdo {
 						 * each stripe.
 						 * brw: grant space consumed on
 						 * the client for the write */
-	__u64			o_padding_4;
+	__u64			o_padding_4;	/* brw: compressed bulk size */
 	__u64			o_padding_5;
 	__u64			o_padding_6;
 };
@@ -3425,6 +3545,7 @@ struct obdo {
 #define o_dropped o_misc
 #define o_cksum   o_nlink
 #define o_grant_used o_data_version
+#define o_compr_nob  o_padding_4
 
 struct lfsck_request {
 	__u32		lr_event;
@@ -3757,13 +3878,15 @@ enum {
         LAYOUT_INTENT_GLIMPSE   = 3,
         LAYOUT_INTENT_TRUNC     = 4,
         LAYOUT_INTENT_RELEASE   = 5,
-        LAYOUT_INTENT_RESTORE   = 6
+	LAYOUT_INTENT_RESTORE   = 6,
+	LAYOUT_INTENT_RESYNC	= 7, /* start a resync of the mirrors */
+	LAYOUT_INTENT_RESYNC_DONE = 8, /* the stale mirrors are in sync */
 };
 
 /* enqueue layout lock with intent */
 struct layout_intent {
 	__u32 li_opc; /* intent operation for enqueue, read, write etc */
-	__u32 li_flags;
+	__u32 li_flags; /* layout generation for LAYOUT_INTENT_RESYNC_DONE */
 	__u64 li_start;
 	__u64 li_end;
 };
@@ -284,6 +284,9 @@ struct ll_futimes_3 {
 #define LL_IOC_HSM_ACTION		_IOR('f', 220, \
 						struct hsm_current_action)
 /*	lustre_ioctl.h			221-232 */
+#define LL_IOC_PCC_ATTACH		_IO('f', 233)
+#define LL_IOC_PCC_DETACH		_IO('f', 234)
+#define LL_IOC_PCC_STATE		_IOR('f', 235, struct lu_pcc_state)
 #define LL_IOC_LMV_SETSTRIPE		_IOWR('f', 240, struct lmv_user_md)
 #define LL_IOC_LMV_GETSTRIPE		_IOWR('f', 241, struct lmv_user_md)
 #define LL_IOC_REMOVE_ENTRY		_IOWR('f', 242, __u64)
@@ -294,6 +297,27 @@ struct ll_futimes_3 {
 #define LL_IOC_MIGRATE			_IOR('f', 247, int)
 #define LL_IOC_FID2MDTIDX		_IOWR('f', 248, struct lu_fid)
 #define LL_IOC_GETPARENT		_IOWR('f', 249, struct getparent)
+#define LL_IOC_GETATTR_BATCH		_IOWR('f', 250, struct ll_getattr_batch)
+#define LL_IOC_FLR_SET_MIRROR		_IOW('f', 251, long)
+#define LL_IOC_MIRROR_RESYNC_START	_IOR('f', 252, __u32)
+#define LL_IOC_MIRROR_RESYNC_DONE	_IOW('f', 253, __u32)
+
+/*
+ * State of a file in the persistent client cache of this client, returned by
+ * LL_IOC_PCC_STATE. An attached file is read from the copy in the local cache
+ * directory until it is opened for write or truncated by any client, or its
+ * layout changes.
+ */
+enum lu_pcc_state_flags {
+	PCC_STATE_NONE		= 0x0,
+	PCC_STATE_ATTACHED	= 0x1,
+};
+
+struct lu_pcc_state {
+	__u32	pccs_flags;	/* PCC_STATE_* */
+	__u32	pccs_padding;
+	char	pccs_path[PATH_MAX]; /* local copy, if attached */
+};
 
 /* Lease types for use as arg and return of LL_IOC_{GET,SET}_LEASE ioctl. */
 enum ll_lease_type {
@@ -311,6 +335,8 @@ enum ll_lease_type {
 #define IOC_MDC_GETFILESTRIPE   _IOWR(IOC_MDC_TYPE, 21, struct lov_user_md *)
 #define IOC_MDC_GETFILEINFO     _IOWR(IOC_MDC_TYPE, 22, struct lov_user_mds_data *)
 #define LL_IOC_MDC_GETINFO      _IOWR(IOC_MDC_TYPE, 23, struct lov_user_mds_data *)
+#define IOC_MDC_GETFILEINFO_LAZY _IOWR(IOC_MDC_TYPE, 24, \
+					struct lov_user_mds_data_lazy *)
 
 #define MAX_OBD_NAME 128 /* If this changes, a NEW ioctl must be added */
 
@@ -338,12 +364,13 @@ enum ll_lease_type {
 #define LOV_USER_MAGIC_V3	0x0BD30BD0
 /* 0x0BD40BD0 is occupied by LOV_MAGIC_MIGRATE */
 #define LOV_USER_MAGIC_SPECIFIC 0x0BD50BD0	/* for specific OSTs */
+#define LOV_USER_MAGIC_COMP_V1	0x0BD60BD0	/* composite layout */
 
 #define LMV_USER_MAGIC    0x0CD30CD0    /*default lmv magic*/
 
 #define LOV_PATTERN_RAID0	0x001
 #define LOV_PATTERN_RAID1	0x002
-#define LOV_PATTERN_FIRST	0x100
+#define LOV_PATTERN_MDT		0x100 /* data on MDT, no OST objects */
 #define LOV_PATTERN_CMOBD	0x200
 
 #define LOV_PATTERN_F_MASK	0xffff0000
@@ -420,6 +447,94 @@ static inline __u32 lov_user_md_size(__u16 stripes, __u32 lmm_magic)
 				stripes * sizeof(struct lov_user_ost_data_v1);
 }
 
+/* file extent covered by a component of a composite layout, [start, end) */
+struct lu_extent {
+	__u64	e_start;
+	__u64	e_end;
+};
+
+#define DEXT "[ %#llx , %#llx )"
+#define PEXT(ext) (unsigned long long)(ext)->e_start, \
+		  (unsigned long long)(ext)->e_end
+
+static inline bool lu_extent_is_overlapped(const struct lu_extent *e1,
+					   const struct lu_extent *e2)
+{
+	return e1->e_start < e2->e_end && e2->e_start < e1->e_end;
+}
+
+enum lov_comp_md_entry_flags {
+	LCME_FL_STALE	= 0x00000001,	/* mirror component is out of date */
+	LCME_FL_PREF_RD	= 0x00000002,	/* mirror component preferred for
+					 * reads */
+	LCME_FL_INIT	= 0x00000010,	/* component has OST objects */
+};
+
+/* the flags a user may set on a component */
+#define LCME_USER_FLAGS		LCME_FL_PREF_RD
+
+/* The maximum number of components in a composite layout */
+#define LOV_MAX_COMP_COUNT	16
+
+/*
+ * A mirrored file is a composite layout made of several mirrors, each of
+ * which is a sequence of components covering [0, LUSTRE_EOF) on its own.
+ * The mirror a component belongs to is in the high bits of its id.
+ */
+#define MIRROR_ID_SHIFT		16
+#define LOV_MAX_MIRROR_COUNT	8
+
+static inline __u16 mirror_id_of(__u32 id)
+{
+	return id >> MIRROR_ID_SHIFT;
+}
+
+/*
+ * State of a mirrored file, in lcm_flags. The mirrors are all in sync in
+ * LCM_FL_RDONLY. A write moves the file to LCM_FL_WRITE_PENDING: one mirror
+ * gets the data and the components of the other ones it overlaps are marked
+ * stale. LCM_FL_SYNC_PENDING is set while the stale components are being
+ * resynchronized, the file goes back to LCM_FL_RDONLY when it is done.
+ */
+enum lov_comp_md_flags {
+	LCM_FL_NONE		= 0,
+	LCM_FL_RDONLY		= 1,
+	LCM_FL_WRITE_PENDING	= 2,
+	LCM_FL_SYNC_PENDING	= 3,
+	LCM_FL_FLR_MASK		= 0x3,
+};
+
+/*
+ * A composite layout is a header followed by an array of component entries,
+ * each of which points (by offset from the start of the header) to a plain
+ * lov_user_md_v1/v3 (lov_mds_md_v1/v3 on disk and on the wire) describing
+ * the striping of the extent it covers.  The extents are contiguous, start
+ * at 0 and the last one ends at LUSTRE_EOF.  Until a component is
+ * instantiated (LCME_FL_INIT), its blob has no objects and the union slot
+ * lmm_stripe_offset keeps the requested starting OST index.
+ */
+struct lov_comp_md_entry_v1 {
+	__u32			lcme_id;	/* unique id of component */
+	__u32			lcme_flags;	/* LCME_FL_XXX */
+	struct lu_extent	lcme_extent;	/* file extent for component */
+	__u32			lcme_offset;	/* offset of component blob,
+						 * start from lov_comp_md_v1 */
+	__u32			lcme_size;	/* size of component blob */
+	__u64			lcme_padding[2];
+} __attribute__((packed));
+
+struct lov_comp_md_v1 {
+	__u32	lcm_magic;	/* LOV_USER_MAGIC_COMP_V1 */
+	__u32	lcm_size;	/* overall size including this struct */
+	__u32	lcm_layout_gen;
+	__u16	lcm_flags;	/* LCM_FL_XXX */
+	__u16	lcm_entry_count;
+	__u16	lcm_mirror_count; /* 0 or 1 if the file is not mirrored */
+	__u16	lcm_padding1[3];
+	__u64	lcm_padding2;
+	struct lov_comp_md_entry_v1 lcm_entries[0];
+} __attribute__((packed));
+
 /* Compile with -D_LARGEFILE64_SOURCE or -D_GNU_SOURCE (or #define) to
  * use this.  It is unsafe to #define those values in this header as it
  * is possible the application has already #included <sys/stat.h>. */
@@ -434,8 +549,54 @@ struct lov_user_mds_data_v3 {
         lstat_t lmd_st;                 /* MDS stat struct */
         struct lov_user_md_v3 lmd_lmm;  /* LOV EA V3 user data */
 } __attribute__((packed));
+
+/* Which fields of the lstat_t returned by IOC_MDC_GETFILEINFO_LAZY and
+ * LL_IOC_GETATTR_BATCH hold the lazy size-on-MDT instead of the MDT inode
+ * attributes. The lazy size is refreshed when a writer closes the file and on
+ * truncate, it may be older than the size known by the OSTs. */
+#define LL_LAZY_SIZE	0x1
+#define LL_LAZY_BLOCKS	0x2
+
+/* IOC_MDC_GETFILEINFO_LAZY: as IOC_MDC_GETFILEINFO, the name of the file is
+ * passed at the start of the buffer */
+struct lov_user_mds_data_lazy {
+	__u32	lmdl_lazy;		/* LL_LAZY_* flags */
+	__u32	lmdl_padding;
+	struct lov_user_mds_data lmdl_lmd; /* must be last, variable size */
+} __attribute__((packed));
+
+/* ll_getattr_batch_entry::lgbe_lazy flag of a regular file without a
+ * layout, hence without OST objects: its MDT size and times are
+ * authoritative */
+#define LL_BATCH_NOLAYOUT	0x100
+
+/* one entry of the LL_IOC_GETATTR_BATCH result array */
+struct ll_getattr_batch_entry {
+	__s32	lgbe_rc;	/* 0 or -errno, -EREMOTE means this name must
+				 * be stat'ed with IOC_MDC_GETFILEINFO */
+	__u32	lgbe_lazy;	/* LL_LAZY_* and LL_BATCH_* flags */
+	lstat_t	lgbe_st;	/* MDS stat struct, as IOC_MDC_GETFILEINFO */
+};
 #endif
 
+/* maximum number of names passed to one LL_IOC_GETATTR_BATCH */
+#define LL_GETATTR_BATCH_MAX	256
+/* maximum size of the names passed to one LL_IOC_GETATTR_BATCH */
+#define LL_GETATTR_BATCH_NAMELEN_MAX	(60 * 1024)
+
+/*
+ * Stat up to LL_GETATTR_BATCH_MAX entries of the directory the ioctl is
+ * issued on with a single MDS RPC. lgb_names holds lgb_count NUL terminated
+ * names back to back, lgb_entries points to lgb_count entries filled in the
+ * same order.
+ */
+struct ll_getattr_batch {
+	__u32	lgb_count;
+	__u32	lgb_namelen;	/* size of lgb_names, NULs included */
+	__u64	lgb_names;	/* user pointer to the names */
+	__u64	lgb_entries;	/* user pointer to ll_getattr_batch_entry[] */
+};
+
 struct lmv_user_mds_data {
 	struct lu_fid	lum_fid;
 	__u32		lum_padding;
@@ -1048,13 +1209,15 @@ enum hsm_states {
 	HS_NORELEASE	= 0x00000010,
 	HS_NOARCHIVE	= 0x00000020,
 	HS_LOST		= 0x00000040,
+	HS_PCCRO	= 0x00000080, /* cached in a client persistent cache */
 };
 
 /* HSM user-setable flags. */
 #define HSM_USER_MASK   (HS_NORELEASE | HS_NOARCHIVE | HS_DIRTY)
 
 /* Other HSM flags. */
-#define HSM_STATUS_MASK (HS_EXISTS | HS_LOST | HS_RELEASED | HS_ARCHIVED)
+#define HSM_STATUS_MASK (HS_EXISTS | HS_LOST | HS_RELEASED | HS_ARCHIVED | \
+			 HS_PCCRO)
 
 /*
  * All HSM-related possible flags that could be applied to a file.
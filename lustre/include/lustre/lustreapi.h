@@ -108,6 +108,14 @@ struct llapi_stripe_param {
 
 extern int llapi_file_open_param(const char *name, int flags, mode_t mode,
 				 const struct llapi_stripe_param *param);
+extern int llapi_file_open_comp(const char *name, int flags, mode_t mode,
+				struct llapi_stripe_param * const *params,
+				const __u64 *ends, int count);
+extern int llapi_file_open_mirror(const char *name, int flags, mode_t mode,
+				  struct llapi_stripe_param * const *params,
+				  const __u64 *ends, const __u32 *comp_flags,
+				  int count, int mirror_count);
+extern int llapi_mirror_resync(const char *name);
 extern int llapi_file_create(const char *name, unsigned long long stripe_size,
                              int stripe_offset, int stripe_count,
                              int stripe_pattern);
@@ -128,6 +136,9 @@ extern int llapi_get_poollist(const char *name, char **poollist, int list_size,
 extern int llapi_get_poolmembers(const char *poolname, char **members,
                                  int list_size, char *buffer, int buffer_size);
 extern int llapi_file_get_stripe(const char *path, struct lov_user_md *lum);
+extern int llapi_file_lazy_stat(const char *path, lstat_t *st, __u32 *lazy);
+extern int llapi_getattr_batch(int dirfd, char **names, int count,
+			       struct ll_getattr_batch_entry *entries);
 #define HAVE_LLAPI_FILE_LOOKUP
 extern int llapi_file_lookup(int dirfd, const char *name);
 
@@ -192,7 +203,8 @@ struct find_param {
 				 fp_check_layout:1,
 				 fp_exclude_layout:1,
 				 fp_get_default_lmv:1, /* Get default LMV */
-				 fp_migrate:1;
+				 fp_migrate:1,
+				 fp_lazy:1; /* use lazy size-on-MDT */
 
 	int			 fp_verbose;
 	int			 fp_quiet;
@@ -215,6 +227,7 @@ struct find_param {
 
 	size_t			 fp_lum_size;
 	struct  lov_user_mds_data *fp_lmd;
+	struct  lov_user_mds_data_lazy *fp_lmdl; /* holds fp_lmd */
 
 	char			 fp_poolname[LOV_MAXPOOLNAME + 1];
 
@@ -228,8 +241,11 @@ struct find_param {
 
 	/* In-process parameters. */
 	unsigned long		 fp_got_uuids:1,
-				 fp_obds_printed:1;
+				 fp_obds_printed:1,
+				 fp_batch_stat:1; /* stat entries in batches */
 	unsigned int		 fp_depth;
+	/* attributes of the current entry from llapi_getattr_batch() */
+	struct ll_getattr_batch_entry *fp_batch_ent;
 };
 
 extern int llapi_ostlist(char *path, struct find_param *param);
@@ -308,6 +324,9 @@ extern int llapi_hsm_state_set_fd(int fd, __u64 setmask, __u64 clearmask,
 				  __u32 archive_id);
 extern int llapi_hsm_state_set(const char *path, __u64 setmask, __u64 clearmask,
 			       __u32 archive_id);
+extern int llapi_pcc_attach(const char *path);
+extern int llapi_pcc_detach(const char *path);
+extern int llapi_pcc_state_get(const char *path, struct lu_pcc_state *state);
 extern int llapi_hsm_register_event_fifo(const char *path);
 extern int llapi_hsm_unregister_event_fifo(const char *path);
 extern void llapi_hsm_log_error(enum llapi_message_level level, int _rc,
@@ -271,6 +271,12 @@ typedef int (*ldlm_res_policy)(struct ldlm_namespace *, struct ldlm_lock **,
 			       __u64 flags, void *data);
 
 typedef int (*ldlm_cancel_cbt)(struct ldlm_lock *lock);
+/**
+ * Callback returning the number of cached pages a lock protects, and in
+ * \a dirty how many of them are dirty.
+ */
+typedef unsigned long (*ldlm_cost_cbt)(struct ldlm_lock *lock,
+				       unsigned long *dirty);
 
 /**
  * LVB operations.
@@ -306,6 +312,24 @@ enum ldlm_appetite {
 	LDLM_NAMESPACE_MODEST = 1 << 1
 };
 
+/**
+ * How the client LRU picks the locks to cancel.
+ */
+enum ldlm_lru_policy {
+	/** Oldest locks first. */
+	LDLM_LRU_POLICY_AGE	= 0,
+	/**
+	 * Oldest locks first, but skip the locks protecting more cached
+	 * pages than their idle time pays for, see ns_lru_cost_rate.
+	 */
+	LDLM_LRU_POLICY_COST	= 1,
+};
+
+/** Default value for the "lru_cost_rate" namespace tunable, in pages. */
+#define NS_DEFAULT_LRU_COST_RATE 256
+/** A dirty page costs that many clean ones to give up. */
+#define LDLM_LRU_COST_DIRTY	4
+
 /**
  * Default values for the "max_nolock_size", "contention_time" and
  * "contended_locks" namespace tunables.
@@ -313,6 +337,17 @@ enum ldlm_appetite {
 #define NS_DEFAULT_MAX_NOLOCK_BYTES 0
 #define NS_DEFAULT_CONTENTION_SECONDS 2
 #define NS_DEFAULT_CONTENDED_LOCKS 32
+/**
+ * Default values for the "contended_grant_bytes" and "srvlock_exports"
+ * namespace tunables, see ldlm_namespace::ns_contended_grant_size.
+ */
+#define NS_DEFAULT_CONTENDED_GRANT_BYTES (1 << 20)
+#define NS_DEFAULT_SRVLOCK_EXPORTS 16
+/**
+ * Default value for the "flock_deadlock_depth" namespace tunable, see
+ * ldlm_namespace::ns_flock_deadlock_depth.
+ */
+#define NS_DEFAULT_FLOCK_DEADLOCK_DEPTH 4096
 
 struct ldlm_ns_bucket {
 	/** back pointer to namespace */
@@ -323,10 +358,37 @@ struct ldlm_ns_bucket {
 	 * fact the network or overall system load is at fault
 	 */
 	struct adaptive_timeout     nsb_at_estimate;
-	/**
-	 * Which res in the bucket should we start with the reclaim.
-	 */
-	int			    nsb_reclaim_start;
+};
+
+/** Number of resources a server namespace keeps lock wait totals for */
+#define LDLM_WAIT_TOP_SIZE		16
+
+/**
+ * Lock wait totals of one of the resources of a server namespace its locks
+ * waited the longest on, see ldlm_lock_wait_account().
+ */
+struct ldlm_wait_top {
+	struct ldlm_res_id	lwt_name;
+	enum ldlm_type		lwt_type;
+	/** Number of locks which waited, longest wait in usec */
+	__u32			lwt_count;
+	__u32			lwt_max;
+	/** Total wait in usec */
+	__u64			lwt_time;
+};
+
+/** Number of grant epochs a server namespace keeps lock counts for */
+#define LDLM_RECLAIM_HIST_BUCKETS	16
+
+/**
+ * Reclaimable granted locks of a server namespace granted in one epoch of
+ * the lock age histogram, see ldlm_reclaim.c.
+ */
+struct ldlm_age_bucket {
+	/** Epoch the bucket counts locks of */
+	unsigned long		lab_epoch;
+	/** Number of reclaimable locks granted in that epoch */
+	__u64			lab_count;
 };
 
 enum {
@@ -422,6 +484,14 @@ struct ldlm_namespace {
 	unsigned int		ns_max_unused;
 	/** Maximum allowed age (last used time) for locks in the LRU */
 	unsigned int		ns_max_age;
+	/** How the LRU picks the locks to cancel. */
+	enum ldlm_lru_policy	ns_lru_policy;
+	/**
+	 * With LDLM_LRU_POLICY_COST, a lock is only canceled from the LRU
+	 * before ns_max_age if it protects at most that many pages (dirty
+	 * ones weighted by LDLM_LRU_COST_DIRTY) per second it was unused.
+	 */
+	unsigned int		ns_lru_cost_rate;
 	/**
 	 * Server only: number of times we evicted clients due to lack of reply
 	 * to ASTs.
@@ -488,6 +558,21 @@ struct ldlm_namespace {
 	 */
 	unsigned		ns_max_nolock_size;
 
+	/**
+	 * Extent write locks granted on a contended resource are not grown
+	 * past the \a ns_contended_grant_size aligned chunks around the
+	 * requested extent, in bytes. 0 disables this.
+	 */
+	unsigned		ns_contended_grant_size;
+
+	/**
+	 * If at least \a ns_srvlock_exports different clients recently
+	 * conflicted on a contended resource, enqueues which allow it are
+	 * denied whatever their size so the clients fall back to server
+	 * side locking. 0 disables this.
+	 */
+	unsigned		ns_srvlock_exports;
+
 	/** Limit of parallel AST RPC count. */
 	unsigned		ns_max_parallel_ast;
 
@@ -497,6 +582,9 @@ struct ldlm_namespace {
 	 */
 	ldlm_cancel_cbt		ns_cancel;
 
+	/** Callback to weigh the cached data a lock protects in the LRU. */
+	ldlm_cost_cbt		ns_lock_cost;
+
 	/** LDLM lock stats */
 	struct lprocfs_stats	*ns_stats;
 
@@ -506,10 +594,32 @@ struct ldlm_namespace {
 	 */
 	unsigned		ns_stopping:1;
 
+	/** Protects ns_reclaim_hist and ns_reclaim_older. */
+	spinlock_t		ns_reclaim_lock;
 	/**
-	 * Which bucket should we start with the lock reclaim.
+	 * Server side lock age histogram: reclaimable granted locks counted
+	 * by grant epoch, in a ring indexed by the epoch.
 	 */
-	int			ns_reclaim_start;
+	struct ldlm_age_bucket	ns_reclaim_hist[LDLM_RECLAIM_HIST_BUCKETS];
+	/** Reclaimable granted locks older than ns_reclaim_hist covers. */
+	__u64			ns_reclaim_older;
+
+	/** Protects ns_wait_top. */
+	spinlock_t		ns_wait_lock;
+	/** Resources of a server namespace locks waited the longest on. */
+	struct ldlm_wait_top	ns_wait_top[LDLM_WAIT_TOP_SIZE];
+
+	/**
+	 * Flock wait-for graph of an MDT namespace: blocked flock requests
+	 * hashed by owner, each one recording the owner it waits for.
+	 * Added with ldlm_lock::l_flock_hash, NULL in other namespaces.
+	 */
+	struct cfs_hash		*ns_flock_hash;
+	/**
+	 * Maximum number of owners followed through ns_flock_hash when a
+	 * new wait-for edge is checked for a deadlock.
+	 */
+	unsigned int		ns_flock_deadlock_depth;
 };
 
 /**
@@ -563,6 +673,13 @@ static inline void ns_register_cancel(struct ldlm_namespace *ns,
 	ns->ns_cancel = arg;
 }
 
+static inline void ns_register_lock_cost(struct ldlm_namespace *ns,
+					 ldlm_cost_cbt arg)
+{
+	LASSERT(ns != NULL);
+	ns->ns_lock_cost = arg;
+}
+
 struct ldlm_lock;
 
 /** Type for blocking callback function of a lock. */
@@ -608,6 +725,46 @@ struct ldlm_interval_tree {
 	struct interval_node	*lit_root; /* actual ldlm_interval */
 };
 
+/** Slot in liq_count[] accounting bits above MDS_INODELOCK_MAXSHIFT. */
+#define LDLM_IBITS_OTHER	(MDS_INODELOCK_MAXSHIFT + 1)
+
+/**
+ * Contention history of an extent resource on the server, protected by
+ * lr_lock. Conflicts are counted per period of ns_contention_time seconds,
+ * the previous period is kept to smooth the rate.
+ */
+struct ldlm_contention {
+	/** When the resource was last considered as contended. */
+	cfs_time_t	lc_time;
+	/** Start of the current period. */
+	cfs_time_t	lc_period_start;
+	/** Conflicting locks found in the current and previous periods. */
+	__u32		lc_conflicts;
+	__u32		lc_conflicts_prev;
+	/** Hashed set of the exports which conflicted in the current period. */
+	__u64		lc_exports;
+	/** Number of such exports in the previous period. */
+	__u32		lc_exports_prev;
+	/** Grants shrunk because of contention. */
+	__u32		lc_shrunk;
+	/** Enqueues denied so the client uses server side locking. */
+	__u32		lc_denied;
+	/** All conflicting locks ever found. */
+	__u64		lc_conflicts_total;
+};
+
+/**
+ * Summary of granted inodebits locks, kept per resource on the server.
+ * It answers "does any granted lock conflict with these bits" without
+ * walking the granted queue. See ldlm/ldlm_inodebits.c for details.
+ */
+struct ldlm_ibits_queues {
+	/** Union of bits held by granted locks of each mode. */
+	__u64			liq_bits[LCK_MODE_NUM];
+	/** Number of granted locks of each mode holding each bit. */
+	__u32			liq_count[LCK_MODE_NUM][LDLM_IBITS_OTHER + 1];
+};
+
 /** Whether to track references to exports by LDLM locks. */
 #define LUSTRE_TRACKS_LOCK_EXP_REFS (0)
 
@@ -623,9 +780,8 @@ struct ldlm_flock {
 	__u64 end;
 	__u64 owner;
 	__u64 blocking_owner;
-	struct obd_export *blocking_export;
-	/* Protected by the hash lock */
-	__u32 blocking_refs;
+	/* Client NID of blocking_owner, server only */
+	__u64 blocking_nid;
 	__u32 pid;
 };
 
@@ -713,10 +869,10 @@ struct ldlm_lock {
 	 */
 	struct hlist_node	l_exp_hash;
 	/**
-	 * Per export hash of flock locks.
-	 * Protected by per-bucket exp->exp_flock_hash locks.
+	 * Per namespace hash of blocked flock locks.
+	 * Protected by per-bucket ns->ns_flock_hash locks.
 	 */
-	struct hlist_node	l_exp_flock_hash;
+	struct hlist_node	l_flock_hash;
 	/**
 	 * Requested mode.
 	 * Protected by lr_lock.
@@ -795,6 +951,12 @@ struct ldlm_lock {
 	 * the lock, e.g. enqueue the lock or send blocking AST.
 	 */
 	cfs_time_t		l_last_activity;
+	/**
+	 * Server side, for the lock wait profiler: when the lock started to
+	 * wait to be granted, then when a blocking AST was sent for it once
+	 * granted. Zero if neither happened yet.
+	 */
+	ktime_t			l_wait_stamp;
 
 	/**
 	 * Time last used by e.g. being matched by lock match.
@@ -867,6 +1029,19 @@ struct ldlm_lock {
 	struct list_head	l_cp_ast;
 	/** For ldlm_add_ast_work_item() for "revoke" AST used in COS. */
 	struct list_head	l_rk_ast;
+	/**
+	 * Server side linkage of a reclaimable granted lock into the
+	 * exp_reclaim_list of its export, oldest first. Protected by
+	 * l_export->exp_reclaim_lock.
+	 */
+	struct list_head	l_reclaim_link;
+	/**
+	 * Server side time the lock was put on the reclaim list, in jiffies.
+	 * Keys the exp_reclaim_list order and the reclaim age histogram, so
+	 * unlike l_last_used it is never touched while the lock is granted.
+	 * Protected by l_export->exp_reclaim_lock.
+	 */
+	cfs_time_t		l_grant_time;
 
 	/**
 	 * Pointer to a conflicting lock that caused blocking AST to be sent
@@ -880,6 +1055,11 @@ struct ldlm_lock {
 	 */
 	struct list_head	l_sl_mode;
 	struct list_head	l_sl_policy;
+	/**
+	 * Protected by lr_lock, mode this IBITS lock is accounted under in
+	 * lr_ibits_queues, 0 if it is not accounted.
+	 */
+	enum ldlm_mode		l_ibits_mode;
 
 	/** Reference tracking structure to debug leaked locks. */
 	struct lu_ref		l_reference;
@@ -899,9 +1079,6 @@ struct ldlm_lock {
 	 * is: res lock -> exp_bl_list_lock -> wanting_lists_spinlock.
 	 */
 	struct list_head	l_exp_list;
-	
-	/* ziqi: collaborative cache related metadata */
-	int l_cc;
 };
 
 /** For uncommitted cross-MDT lock, store transno this lock belongs to */
@@ -958,11 +1135,17 @@ struct ldlm_resource {
 	 */
 	struct ldlm_interval_tree *lr_itree;
 
+	/**
+	 * Per-mode inodebits summary of the granted queue (only for IBITS
+	 * resources in server namespaces), protected by lr_lock.
+	 */
+	struct ldlm_ibits_queues *lr_ibits_queues;
+
 	union {
 		/**
-		 * When the resource was considered as contended,
-		 * used only on server side. */
-		cfs_time_t	lr_contention_time;
+		 * Contention history, used only on server side for extent
+		 * resources. */
+		struct ldlm_contention	lr_contention;
 		/**
 		 * Associated inode, used only on client side.
 		 */
@@ -983,6 +1166,15 @@ struct ldlm_resource {
 	/** is lvb initialized ? */
 	bool			lr_lvb_initialized;
 
+	/**
+	 * Server side lock wait profile, protected by lr_lock: usec the locks
+	 * of this resource waited to be granted, how many of them waited and
+	 * the longest wait.
+	 */
+	__u64			lr_wait_time;
+	__u32			lr_wait_count;
+	__u32			lr_wait_max;
+
 	/** List of references to this resource. For debugging. */
 	struct lu_ref		lr_reference;
 };
@@ -1245,6 +1437,13 @@ int ldlm_handle_cancel(struct ptlrpc_request *req);
 int ldlm_request_cancel(struct ptlrpc_request *req,
 			const struct ldlm_request *dlm_req,
 			int first, enum lustre_at_flags flags);
+int ldlm_grant_remote_ibits_lock(struct ldlm_namespace *ns,
+				 struct ptlrpc_request *req,
+				 const struct ldlm_res_id *res_id,
+				 enum ldlm_mode mode, __u64 bits,
+				 const struct lustre_handle *remote,
+				 const struct ldlm_callback_suite *cbs,
+				 struct lustre_handle *handle);
 /** @} ldlm_handlers */
 
 void ldlm_revoke_export_locks(struct obd_export *exp);
@@ -1484,6 +1683,14 @@ int ldlm_cli_enqueue_fini(struct obd_export *exp, struct ptlrpc_request *req,
 			  enum ldlm_mode mode, __u64 *flags, void *lvb,
 			  __u32 lvb_len,
 			  struct lustre_handle *lockh, int rc);
+int ldlm_cli_remote_lock_create(struct obd_export *exp,
+				struct ldlm_enqueue_info *einfo,
+				const struct ldlm_res_id *res_id,
+				struct lustre_handle *lockh);
+int ldlm_cli_remote_lock_fini(struct obd_export *exp,
+			      struct lustre_handle *lockh, enum ldlm_mode mode,
+			      const struct ldlm_res_id *res_id, __u64 bits,
+			      const struct lustre_handle *remote);
 int ldlm_cli_enqueue_local(struct ldlm_namespace *ns,
 			   const struct ldlm_res_id *res_id,
 			   enum ldlm_type type, union ldlm_policy_data *policy,
@@ -1497,6 +1704,7 @@ int ldlm_cli_enqueue_local(struct ldlm_namespace *ns,
 int ldlm_server_ast(struct lustre_handle *lockh, struct ldlm_lock_desc *new,
 		    void *data, __u32 data_len);
 int ldlm_cli_convert(struct lustre_handle *, int new_mode, __u32 *flags);
+int ldlm_cli_dropbits(struct ldlm_lock *lock, __u64 drop_bits);
 int ldlm_cli_update_pool(struct ptlrpc_request *req);
 int ldlm_cli_cancel(struct lustre_handle *lockh,
 		    enum ldlm_cancel_flags cancel_flags);
@@ -137,6 +137,11 @@ struct nid_stat {
 	struct proc_dir_entry   *nid_proc;
 	struct lprocfs_stats    *nid_stats;
 	struct lprocfs_stats    *nid_ldlm_stats;
+	/* lock wait profile in usec: how long the client took to cancel
+	 * locks it got a blocking AST for, and how long its locks waited
+	 * to be granted */
+	struct obd_histogram	 nid_bl_ast_hist;
+	struct obd_histogram	 nid_lock_wait_hist;
 	atomic_t		 nid_exp_ref_count; /* for obd_nid_stats_hash
 						       exp_nid_stats */
 };
@@ -219,11 +224,6 @@ struct obd_export {
 	__u32			  exp_conn_cnt;
 	/** Hash list of all ldlm locks granted on this export */
 	struct cfs_hash		 *exp_lock_hash;
-	/**
-	 * Hash list for Posix lock deadlock detection, added with
-	 * ldlm_lock::l_exp_flock_hash.
-	 */
-	struct cfs_hash	       *exp_flock_hash;
 	struct list_head	exp_outstanding_replies;
 	struct list_head	exp_uncommitted_replies;
 	spinlock_t		exp_uncommitted_replies_lock;
@@ -274,6 +274,16 @@ struct obd_export {
 	struct list_head	exp_bl_list;
 	spinlock_t		exp_bl_list_lock;
 
+	/** reclaimable granted dlm locks, oldest first, and their number,
+	 * protected by exp_reclaim_lock. See ldlm_reclaim.c */
+	struct list_head	exp_reclaim_list;
+	__u64			exp_reclaim_count;
+	spinlock_t		exp_reclaim_lock;
+
+	/** blocking ASTs gathered to be sent to the client in one RPC,
+	 * protected by ldlm_bl_batch_lock. See ldlm_server_blocking_ast() */
+	struct ldlm_bl_batch	*exp_bl_batch;
+
         /** Target specific data */
         union {
                 struct tg_export_data     eu_target_data;
@@ -306,6 +316,13 @@ static inline __u64 exp_connect_flags(struct obd_export *exp)
 	return *exp_connect_flags_ptr(exp);
 }
 
+static inline __u64 exp_connect_flags2(struct obd_export *exp)
+{
+	if (exp_connect_flags(exp) & OBD_CONNECT_FLAGS2)
+		return exp->exp_connect_data.ocd_connect_flags2;
+	return 0;
+}
+
 static inline int exp_max_brw_size(struct obd_export *exp)
 {
 	LASSERT(exp != NULL);
@@ -409,6 +426,52 @@ static inline bool imp_connect_disp_stripe(struct obd_import *imp)
 	return ocd->ocd_connect_flags & OBD_CONNECT_DISP_STRIPE;
 }
 
+static inline __u64 imp_connect_flags2(struct obd_import *imp)
+{
+	struct obd_connect_data *ocd;
+
+	LASSERT(imp != NULL);
+	ocd = &imp->imp_connect_data;
+	if (ocd->ocd_connect_flags & OBD_CONNECT_FLAGS2)
+		return ocd->ocd_connect_flags2;
+	return 0;
+}
+
+static inline bool exp_connect_batch_getattr(struct obd_export *exp)
+{
+	return !!(exp_connect_flags2(exp) & OBD_CONNECT2_BATCH_GETATTR);
+}
+
+static inline bool exp_connect_lock_convert(struct obd_export *exp)
+{
+	return !!(exp_connect_flags2(exp) & OBD_CONNECT2_LOCK_CONVERT);
+}
+
+static inline bool exp_connect_bl_batch(struct obd_export *exp)
+{
+	return !!(exp_connect_flags2(exp) & OBD_CONNECT2_BL_BATCH);
+}
+
+static inline bool exp_connect_lock_replay_batch(struct obd_export *exp)
+{
+	return !!(exp_connect_flags2(exp) & OBD_CONNECT2_LOCK_REPLAY_BATCH);
+}
+
+static inline bool exp_connect_dom(struct obd_export *exp)
+{
+	return !!(exp_connect_flags2(exp) & OBD_CONNECT2_DOM);
+}
+
+static inline bool exp_connect_batch_getattr_lock(struct obd_export *exp)
+{
+	return !!(exp_connect_flags2(exp) & OBD_CONNECT2_BATCH_GETATTR_LOCK);
+}
+
+static inline bool exp_connect_brw_compress(struct obd_export *exp)
+{
+	return !!(exp_connect_flags2(exp) & OBD_CONNECT2_BRW_COMPRESS);
+}
+
 static inline __u64 exp_connect_ibits(struct obd_export *exp)
 {
 	struct obd_connect_data *ocd;
@@ -648,6 +648,10 @@ struct ptlrpc_reply_state {
 	struct ptlrpc_cb_id	rs_cb_id;
 	/** Linkage for list of all reply states in a system */
 	struct list_head	rs_list;
+	/** Linkage for the lockless queue of a reply handling thread */
+	struct ptlrpc_reply_state *rs_hr_next;
+	/** Linkage for the committed replies of ptlrpc_commit_replies() */
+	struct ptlrpc_reply_state *rs_commit_next;
 	/** Linkage for list of all reply states on same export */
 	struct list_head	rs_exp_list;
 	/** Linkage for list of all reply states for same obd */
@@ -1779,6 +1783,18 @@ struct ptlrpc_service_part {
 	struct list_head		scp_rqbd_posted;
 	/** incoming reqs */
 	struct list_head		scp_req_incoming;
+	/** free request descriptors for reuse by request_in_callback() */
+	struct list_head		scp_req_pool;
+	/** # request descriptors in scp_req_pool */
+	int				scp_nreqs_pool;
+	/** # incoming requests which got a descriptor from scp_req_pool */
+	__u64				scp_req_pool_hits;
+	/** # incoming requests which had to allocate a descriptor */
+	__u64				scp_req_pool_misses;
+	/** # early replies sent without copying the request message */
+	__u64				scp_early_nocopy;
+	/** # early replies which had to copy the request message */
+	__u64				scp_early_copy;
 	/** timeout before re-posting reqs, in tick */
 	cfs_duration_t			scp_rqbd_timeout;
 	/**
@@ -1909,6 +1925,18 @@ struct ptlrpcd_ctl {
 	 * Record the partner index to be processed next.
 	 */
 	int				pc_cursor;
+	/**
+	 * Record the remote CPT thread to steal from next.
+	 */
+	unsigned int			pc_xcursor;
+	/**
+	 * Number of async RPCs this thread took from partners.
+	 */
+	__u64				pc_nstolen;
+	/**
+	 * Number of async RPCs this thread took from other CPTs.
+	 */
+	__u64				pc_nstolen_xcpt;
 	/**
 	 * Error code if the thread failed to fully start.
 	 */
@@ -2166,6 +2194,19 @@ static inline void ptlrpc_release_bulk_noop(struct ptlrpc_bulk_desc *desc)
 {
 }
 
+/* ptlrpc/compress.c */
+bool ptlrpc_bulk_compress_available(void);
+void ptlrpc_bulk_replace_frags(struct ptlrpc_bulk_desc *desc,
+			       lnet_kiov_t *kiov, int nob);
+int ptlrpc_bulk_compress(struct ptlrpc_bulk_desc *desc, lnet_kiov_t *stream);
+int ptlrpc_bulk_prep_stream(struct ptlrpc_bulk_desc *desc,
+			    lnet_kiov_t *stream, int nob);
+void ptlrpc_bulk_free_stream(lnet_kiov_t *stream, int count);
+int ptlrpc_bulk_decompress(lnet_kiov_t *src, int src_count, int nob,
+			   lnet_kiov_t *dst, int dst_count);
+int ptlrpc_bulk_copy(lnet_kiov_t *src, int src_count, int nob,
+		     lnet_kiov_t *dst, int dst_count);
+
 void ptlrpc_retain_replayable_request(struct ptlrpc_request *req,
                                       struct obd_import *imp);
 __u64 ptlrpc_next_xid(void);
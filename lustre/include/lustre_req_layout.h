@@ -165,6 +165,7 @@ extern struct req_format RQF_OUT_UPDATE;
  * This is format of direct (non-intent) MDS_GETATTR_NAME request.
  */
 extern struct req_format RQF_MDS_GETATTR_NAME;
+extern struct req_format RQF_MDS_BATCH_GETATTR;
 extern struct req_format RQF_MDS_CLOSE;
 extern struct req_format RQF_MDS_INTENT_CLOSE;
 extern struct req_format RQF_MDS_CONNECT;
@@ -217,6 +218,7 @@ extern struct req_format RQF_OST_GET_INFO_FIEMAP;
 /* LDLM req_format */
 extern struct req_format RQF_LDLM_ENQUEUE;
 extern struct req_format RQF_LDLM_ENQUEUE_LVB;
+extern struct req_format RQF_LDLM_ENQUEUE_REPLAY_BATCH;
 extern struct req_format RQF_LDLM_CONVERT;
 extern struct req_format RQF_LDLM_INTENT;
 extern struct req_format RQF_LDLM_INTENT_BASIC;
@@ -231,6 +233,7 @@ extern struct req_format RQF_LDLM_CANCEL;
 extern struct req_format RQF_LDLM_CALLBACK;
 extern struct req_format RQF_LDLM_CP_CALLBACK;
 extern struct req_format RQF_LDLM_BL_CALLBACK;
+extern struct req_format RQF_LDLM_BL_CALLBACK_BATCH;
 extern struct req_format RQF_LDLM_GL_CALLBACK;
 extern struct req_format RQF_LDLM_GL_DESC_CALLBACK;
 /* LOG req_format */
@@ -252,6 +255,11 @@ extern struct req_msg_field RMF_GENERIC_DATA;
 extern struct req_msg_field RMF_PTLRPC_BODY;
 extern struct req_msg_field RMF_MDT_BODY;
 extern struct req_msg_field RMF_MDT_EPOCH;
+extern struct req_msg_field RMF_BATCH_NAMES;
+extern struct req_msg_field RMF_BATCH_GETATTR_REP;
+extern struct req_msg_field RMF_BATCH_LOCK_HANDLES;
+extern struct req_msg_field RMF_BATCH_LOCK_REP;
+extern struct req_msg_field RMF_BATCH_GETATTR_MD;
 extern struct req_msg_field RMF_OBD_STATFS;
 extern struct req_msg_field RMF_NAME;
 extern struct req_msg_field RMF_SYMTGT;
@@ -273,6 +281,9 @@ extern struct req_msg_field RMF_CONNECT_DATA;
 extern struct req_msg_field RMF_DLM_REQ;
 extern struct req_msg_field RMF_DLM_REP;
 extern struct req_msg_field RMF_DLM_LVB;
+extern struct req_msg_field RMF_DLM_REPLAY_DESC;
+extern struct req_msg_field RMF_DLM_BL_DESC;
+extern struct req_msg_field RMF_DLM_REPLAY_REP;
 extern struct req_msg_field RMF_DLM_GL_DESC;
 extern struct req_msg_field RMF_LDLM_INTENT;
 extern struct req_msg_field RMF_LAYOUT_INTENT;
@@ -66,6 +66,8 @@ void lustre_swab_lquota_lvb(struct lquota_lvb *lvb);
 void lustre_swab_generic_32s(__u32 *val);
 void lustre_swab_mdt_body(struct mdt_body *b);
 void lustre_swab_mdt_ioepoch(struct mdt_ioepoch *b);
+void lustre_swab_mdt_batch_getattr_rep(struct mdt_batch_getattr_rep *r);
+void lustre_swab_mdt_batch_lock_rep(struct mdt_batch_lock_rep *r);
 void lustre_swab_mdt_remote_perm(struct mdt_remote_perm *p);
 void lustre_swab_mdt_rec_setattr(struct mdt_rec_setattr *sa);
 void lustre_swab_mdt_rec_reint(struct mdt_rec_reint *rr);
@@ -80,6 +82,8 @@ void lustre_swab_ldlm_resource_desc(struct ldlm_resource_desc *r);
 void lustre_swab_ldlm_lock_desc(struct ldlm_lock_desc *l);
 void lustre_swab_ldlm_request(struct ldlm_request *rq);
 void lustre_swab_ldlm_reply(struct ldlm_reply *r);
+void lustre_swab_ldlm_replay_desc(struct ldlm_replay_desc *d);
+void lustre_swab_ldlm_replay_rep(struct ldlm_replay_rep *r);
 void lustre_swab_mgs_target_info(struct mgs_target_info *oinfo);
 void lustre_swab_mgs_nidtbl_entry(struct mgs_nidtbl_entry *oinfo);
 void lustre_swab_mgs_config_body(struct mgs_config_body *body);
@@ -92,6 +96,7 @@ void lustre_swab_ost_last_id(__u64 *id);
 void lustre_swab_fiemap(struct fiemap *fiemap);
 void lustre_swab_lov_user_md_v1(struct lov_user_md_v1 *lum);
 void lustre_swab_lov_user_md_v3(struct lov_user_md_v3 *lum);
+void lustre_swab_lov_comp_md_v1(struct lov_comp_md_v1 *lum, size_t buflen);
 void lustre_swab_lov_user_md_objects(struct lov_user_ost_data *lod,
 				     int stripe_count);
 void lustre_swab_lov_mds_md(struct lov_mds_md *lmm);
@@ -66,6 +66,7 @@ struct md_device;
 struct md_device_operations;
 struct md_object;
 struct obd_export;
+struct layout_intent;
 
 /** metadata attributes */
 enum ma_valid {
@@ -214,6 +215,10 @@ struct md_object_operations {
 				 struct md_object *obj,
 				 struct ldlm_enqueue_info *einfo,
 				 union ldlm_policy_data *policy);
+
+	int (*moo_layout_change)(const struct lu_env *env,
+				 struct md_object *obj,
+				 struct layout_intent *layout);
 };
 
 /**
@@ -463,6 +468,14 @@ static inline int mo_object_unlock(const struct lu_env *env,
 	return m->mo_ops->moo_object_unlock(env, m, einfo, policy);
 }
 
+static inline int mo_layout_change(const struct lu_env *env,
+				   struct md_object *m,
+				   struct layout_intent *layout)
+{
+	LASSERT(m->mo_ops->moo_layout_change);
+	return m->mo_ops->moo_layout_change(env, m, layout);
+}
+
 static inline int mdo_lookup(const struct lu_env *env,
                              struct md_object *p,
                              const struct lu_name *lname,
@@ -156,6 +156,26 @@ enum {
 
 struct mdc_rpc_lock;
 struct obd_import;
+/**
+ * Part of the LRU page list of a client_obd belonging to one CPU partition.
+ * Pages are queued to the sublist of the CPT that finished their transfer,
+ * so that IO threads running on different CPTs don't contend on one lock.
+ */
+struct cl_lru_sublist {
+	/** Lock for the fields below */
+	spinlock_t		cls_lock;
+	/** List of LRU pages */
+	struct list_head	cls_list;
+	/** # of pages in cls_list */
+	long			cls_in_list;
+	/** # of LRU slots freed on this CPT but not yet returned to
+	 * client_obd::cl_lru_left, they are given back in batches */
+	long			cls_left;
+	/** # of threads shrinking this sublist. To avoid contention, only
+	 * forced shrinking may run more than one at a time. */
+	atomic_t		cls_shrinkers;
+};
+
 struct client_obd {
 	struct rw_semaphore	 cl_sem;
 	struct obd_uuid		 cl_target_uuid;
@@ -262,11 +282,9 @@ struct client_obd {
 	 * queue, or in transfer. Busy pages can't be discarded so they are not
 	 * in LRU cache. */
 	atomic_long_t            cl_lru_busy;
-	/** # of LRU pages in the cache for this client_obd */
-	atomic_long_t            cl_lru_in_list;
-	/** # of threads are shrinking LRU cache. To avoid contention, it's not
-	 * allowed to have multiple threads shrinking LRU cache. */
-	atomic_t                 cl_lru_shrinkers;
+	/** Per-CPT LRU page lists for this client_obd, see
+	 * struct cl_lru_sublist. Allocated by OSC only. */
+	struct cl_lru_sublist  **cl_lru;
 	/** The time when this LRU cache was last used. */
 	time_t                   cl_lru_last_used;
 	/** stats: how many reclaims have happened for this client_obd.
@@ -274,10 +292,6 @@ struct client_obd {
 	 * reclaim is sync, initiated by IO thread when the LRU slots are
 	 * in shortage. */
 	__u64                    cl_lru_reclaim;
-	/** List of LRU pages for this client_obd */
-	struct list_head         cl_lru_list;
-	/** Lock for LRU page list */
-	spinlock_t		 cl_lru_list_lock;
 	/** # of unstable pages in this client_obd.
 	 * An unstable page is a page state that WRITE RPC has finished but
 	 * the transaction has NOT yet committed. */
@@ -680,6 +694,11 @@ struct obd_device {
 
 	/* new recovery stuff from CMD2 */
 	int				obd_replayed_locks;
+	/* locks replayed (a batched replay RPC carries many), and the
+	 * bounds of the lock replay stage in seconds, for lprocfs_status */
+	__u64				obd_replayed_lock_count;
+	time_t				obd_lock_replay_start;
+	time_t				obd_lock_replay_end;
 	atomic_t			obd_req_replay_clients;
 	atomic_t			obd_lock_replay_clients;
 	struct target_recovery_data	obd_recovery_data;
@@ -1078,6 +1097,15 @@ struct md_ops {
 	int (*m_getattr_name)(struct obd_export *, struct md_op_data *,
 			      struct ptlrpc_request **);
 
+	int (*m_batch_getattr)(struct obd_export *, struct md_op_data *,
+			       const char *, size_t, int,
+			       struct ldlm_enqueue_info *,
+			       struct lustre_handle *,
+			       struct ptlrpc_request **);
+
+	int (*m_dom_rw)(struct obd_export *, int, struct obdo *, u64, size_t,
+			struct page **, int);
+
 	int (*m_init_ea_size)(struct obd_export *, __u32, __u32);
 
 	int (*m_get_lustre_md)(struct obd_export *, struct ptlrpc_request *,
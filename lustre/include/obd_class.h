@@ -1368,6 +1368,43 @@ static inline int md_getattr_name(struct obd_export *exp,
         RETURN(rc);
 }
 
+static inline int md_batch_getattr(struct obd_export *exp,
+				   struct md_op_data *op_data,
+				   const char *names, size_t namelen,
+				   int count, struct ldlm_enqueue_info *einfo,
+				   struct lustre_handle *lockh,
+				   struct ptlrpc_request **request)
+{
+	int rc;
+	ENTRY;
+	EXP_CHECK_MD_OP(exp, batch_getattr);
+	EXP_MD_COUNTER_INCREMENT(exp, batch_getattr);
+	rc = MDP(exp->exp_obd, batch_getattr)(exp, op_data, names, namelen,
+					      count, einfo, lockh, request);
+	RETURN(rc);
+}
+
+/**
+ * Read or write \a count bytes at \a offset of a Data-on-MDT file.
+ *
+ * \a oa holds the FID of the file and returns its attributes, \a pages
+ * hold the data starting at the in-page offset of \a offset.
+ *
+ * \retval number of bytes transferred or negative errno
+ */
+static inline int md_dom_rw(struct obd_export *exp, int cmd, struct obdo *oa,
+			    u64 offset, size_t count, struct page **pages,
+			    int npages)
+{
+	int rc;
+	ENTRY;
+	EXP_CHECK_MD_OP(exp, dom_rw);
+	EXP_MD_COUNTER_INCREMENT(exp, dom_rw);
+	rc = MDP(exp->exp_obd, dom_rw)(exp, cmd, oa, offset, count, pages,
+				       npages);
+	RETURN(rc);
+}
+
 static inline int md_intent_lock(struct obd_export *exp,
 				 struct md_op_data *op_data,
 				 struct lookup_intent *it,
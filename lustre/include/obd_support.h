@@ -249,6 +249,7 @@ extern char obd_jobid_var[];
 #define OBD_FAIL_MDS_REINT_MULTI_NET_REP 0x15a
 #define OBD_FAIL_MDS_LLOG_CREATE_FAILED2 0x15b
 #define OBD_FAIL_MDS_FLD_LOOKUP			0x15c
+#define OBD_FAIL_MDS_BATCH_GETATTR_NET		0x15d
 #define OBD_FAIL_MDS_INTENT_DELAY		0x160
 
 /* layout lock */
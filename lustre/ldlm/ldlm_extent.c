@@ -63,6 +63,144 @@
 #ifdef HAVE_SERVER_SUPPORT
 # define LDLM_MAX_GROWN_EXTENT (32 * 1024 * 1024 - 1)
 
+/**
+ * Start a new contention period of \a res if the current one is over.
+ * History older than the previous period is forgotten.
+ */
+static void ldlm_contention_rollover(struct ldlm_resource *res, cfs_time_t now)
+{
+	struct ldlm_contention *lc = &res->lr_contention;
+	cfs_duration_t period;
+
+	period = cfs_time_seconds(ldlm_res_to_ns(res)->ns_contention_time);
+	if (cfs_time_before(now, cfs_time_add(lc->lc_period_start, period)))
+		return;
+
+	if (cfs_time_before(now, cfs_time_add(lc->lc_period_start,
+					      2 * period))) {
+		lc->lc_conflicts_prev = lc->lc_conflicts;
+		lc->lc_exports_prev = hweight64(lc->lc_exports);
+	} else {
+		lc->lc_conflicts_prev = 0;
+		lc->lc_exports_prev = 0;
+	}
+	lc->lc_conflicts = 0;
+	lc->lc_exports = 0;
+	lc->lc_period_start = now;
+}
+
+/**
+ * Record that the enqueue of \a req found \a conflicts conflicting locks.
+ */
+static void ldlm_contention_note(struct ldlm_lock *req, int conflicts)
+{
+	struct ldlm_resource *res = req->l_resource;
+	struct ldlm_contention *lc = &res->lr_contention;
+
+	ldlm_contention_rollover(res, cfs_time_current());
+	if (conflicts == 0)
+		return;
+
+	lc->lc_conflicts += conflicts;
+	lc->lc_conflicts_total += conflicts;
+	if (req->l_export != NULL)
+		lc->lc_exports |= 1ULL << hash_long((unsigned long)req->l_export,
+						    6);
+}
+
+/**
+ * Get the recent conflict rate of \a res, in conflicts per period, and the
+ * approximate number of clients involved. Called with \a res locked.
+ */
+void ldlm_extent_contention_get(struct ldlm_resource *res, __u32 *rate,
+				__u32 *exports)
+{
+	struct ldlm_contention *lc = &res->lr_contention;
+
+	ldlm_contention_rollover(res, cfs_time_current());
+	*rate = lc->lc_conflicts + lc->lc_conflicts_prev;
+	*exports = max_t(__u32, hweight64(lc->lc_exports),
+			 lc->lc_exports_prev);
+}
+
+/**
+ * Is \a res contended, either because \a contended_locks conflicting locks
+ * were just found or because of its recent history.
+ */
+static int ldlm_check_contention(struct ldlm_lock *lock, int contended_locks)
+{
+	struct ldlm_resource *res = lock->l_resource;
+	struct ldlm_namespace *ns = ldlm_res_to_ns(res);
+	cfs_time_t now = cfs_time_current();
+	__u32 rate;
+	__u32 exports;
+
+	if (OBD_FAIL_CHECK(OBD_FAIL_LDLM_SET_CONTENTION))
+		return 1;
+
+	CDEBUG(D_DLMTRACE, "contended locks = %d\n", contended_locks);
+	ldlm_extent_contention_get(res, &rate, &exports);
+	if (contended_locks > ns->ns_contended_locks ||
+	    rate > ns->ns_contended_locks)
+		res->lr_contention.lc_time = now;
+	return cfs_time_before(now, cfs_time_add(res->lr_contention.lc_time,
+		cfs_time_seconds(ns->ns_contention_time)));
+}
+
+/**
+ * Should a contended enqueue of \a req be denied so its client switches to
+ * server side locking, whatever the size of the request.
+ */
+static bool ldlm_contention_wants_srvlock(struct ldlm_lock *req)
+{
+	struct ldlm_resource *res = req->l_resource;
+	unsigned int limit = ldlm_res_to_ns(res)->ns_srvlock_exports;
+	__u32 rate;
+	__u32 exports;
+
+	if (limit == 0)
+		return false;
+
+	ldlm_extent_contention_get(res, &rate, &exports);
+	return exports >= limit;
+}
+
+/**
+ * Shrink the grown extent \a new_ex of a write lock on a contended resource
+ * to the ns_contended_grant_size aligned chunks covering the request, so
+ * that clients writing to different parts of a shared file stop revoking
+ * each others locks.
+ */
+static void ldlm_extent_contention_fixup(struct ldlm_lock *req,
+					 struct ldlm_extent *new_ex)
+{
+	struct ldlm_resource *res = req->l_resource;
+	__u64 chunk = ldlm_res_to_ns(res)->ns_contended_grant_size;
+	__u64 start = req->l_req_extent.start;
+	__u64 end = req->l_req_extent.end;
+
+	if (chunk == 0 || (chunk & ~PAGE_CACHE_MASK) != 0)
+		return;
+	if (req->l_req_mode != LCK_PW && req->l_req_mode != LCK_CW)
+		return;
+	if (!ldlm_check_contention(req, 0))
+		return;
+
+	start = div64_u64(start, chunk) * chunk;
+	end = div64_u64(end, chunk) * chunk + chunk - 1;
+	if (end < req->l_req_extent.end)
+		end = OBD_OBJECT_EOF;
+
+	if (new_ex->start >= start && new_ex->end <= end)
+		return;
+
+	new_ex->start = max(new_ex->start, start);
+	new_ex->end = min(new_ex->end, end);
+	res->lr_contention.lc_shrunk++;
+	LDLM_DEBUG(req, "contended, grant shrunk to ["LPU64"->"LPU64"]",
+		   new_ex->start, new_ex->end);
+}
+
 /**
  * Fix up the ldlm_extent after expanding it.
  *
@@ -292,6 +430,7 @@ static void ldlm_extent_policy(struct ldlm_resource *res,
 
         ldlm_extent_internal_policy_granted(lock, &new_ex);
         ldlm_extent_internal_policy_waiting(lock, &new_ex);
+	ldlm_extent_contention_fixup(lock, &new_ex);
 
         if (new_ex.start != lock->l_policy_data.l_extent.start ||
             new_ex.end != lock->l_policy_data.l_extent.end) {
@@ -301,21 +440,6 @@ static void ldlm_extent_policy(struct ldlm_resource *res,
         }
 }
 
-static int ldlm_check_contention(struct ldlm_lock *lock, int contended_locks)
-{
-	struct ldlm_resource *res = lock->l_resource;
-	cfs_time_t now = cfs_time_current();
-
-	if (OBD_FAIL_CHECK(OBD_FAIL_LDLM_SET_CONTENTION))
-		return 1;
-
-	CDEBUG(D_DLMTRACE, "contended locks = %d\n", contended_locks);
-	if (contended_locks > ldlm_res_to_ns(res)->ns_contended_locks)
-		res->lr_contention_time = now;
-	return cfs_time_before(now, cfs_time_add(res->lr_contention_time,
-		cfs_time_seconds(ldlm_res_to_ns(res)->ns_contention_time)));
-}
-
 struct ldlm_extent_compat_args {
 	struct list_head *work_list;
 	struct ldlm_lock *lock;
@@ -621,13 +745,16 @@ ldlm_extent_compat_queue(struct list_head *queue, struct ldlm_lock *req,
                 }
         }
 
-        if (ldlm_check_contention(req, *contended_locks) &&
-            compat == 0 &&
-            (*flags & LDLM_FL_DENY_ON_CONTENTION) &&
-            req->l_req_mode != LCK_GROUP &&
-            req_end - req_start <=
-            ldlm_res_to_ns(req->l_resource)->ns_max_nolock_size)
-                GOTO(destroylock, compat = -EUSERS);
+	if (ldlm_check_contention(req, *contended_locks) &&
+	    compat == 0 &&
+	    (*flags & LDLM_FL_DENY_ON_CONTENTION) &&
+	    req->l_req_mode != LCK_GROUP &&
+	    (req_end - req_start <=
+	     ldlm_res_to_ns(req->l_resource)->ns_max_nolock_size ||
+	     ldlm_contention_wants_srvlock(req))) {
+		res->lr_contention.lc_denied++;
+		GOTO(destroylock, compat = -EUSERS);
+	}
 
         RETURN(compat);
 destroylock:
@@ -687,6 +814,9 @@ int ldlm_process_extent_lock(struct ldlm_lock *lock, __u64 *flags,
 	struct list_head rpc_list;
 	int rc, rc2;
 	int contended_locks = 0;
+	/* conflicts found by the first pass, restarts do not count */
+	int conflicts = 0;
+	bool restarted = false;
 	ENTRY;
 
 	LASSERT(lock->l_granted_mode != lock->l_req_mode);
@@ -697,8 +827,6 @@ int ldlm_process_extent_lock(struct ldlm_lock *lock, __u64 *flags,
 	check_res_locked(res);
 	*err = ELDLM_OK;
 
-	printk("ldlm_process_extent_lock(): lock->l_cc = %d\n", lock->l_cc);
-
         if (!first_enq) {
                 /* Careful observers will note that we don't handle -EWOULDBLOCK
                  * here, but it's ok for a non-obvious reason -- compat_queue
@@ -737,6 +865,8 @@ int ldlm_process_extent_lock(struct ldlm_lock *lock, __u64 *flags,
                                        &rpc_list, &contended_locks);
         if (rc2 < 0)
                 GOTO(out, rc = rc2); /* lock was destroyed */
+	if (!restarted)
+		conflicts = contended_locks;
 
         if (rc + rc2 == 2) {
         grant:
@@ -784,6 +914,7 @@ int ldlm_process_extent_lock(struct ldlm_lock *lock, __u64 *flags,
 				GOTO(out, rc = 0);
 			}
 
+			restarted = true;
 			GOTO(restart, rc);
 		}
 
@@ -792,8 +923,12 @@ int ldlm_process_extent_lock(struct ldlm_lock *lock, __u64 *flags,
 		*flags |= LDLM_FL_BLOCK_GRANTED | LDLM_FL_NO_TIMEOUT;
 
 	}
+	ldlm_contention_note(lock, conflicts);
 	RETURN(0);
 out:
+	/* granted while the resource was unlocked for the ASTs */
+	if (rc == 0)
+		ldlm_contention_note(lock, conflicts);
 	if (!list_empty(&rpc_list)) {
 		LASSERT(!ldlm_is_ast_discard_data(lock));
 		discard_bl_list(&rpc_list);
@@ -890,18 +1025,6 @@ struct ldlm_interval *ldlm_interval_detach(struct ldlm_lock *l)
 	return list_empty(&n->li_group) ? n : NULL;
 }
 
-static inline int ldlm_mode_to_index(enum ldlm_mode mode)
-{
-	int index;
-
-	LASSERT(mode != 0);
-	LASSERT(IS_PO2(mode));
-	for (index = -1; mode != 0; index++, mode >>= 1)
-		/* do nothing */;
-	LASSERT(index < LCK_MODE_NUM);
-	return index;
-}
-
 /** Add newly granted lock into interval tree for the resource. */
 void ldlm_extent_add_lock(struct ldlm_resource *res,
                           struct ldlm_lock *lock)
@@ -95,38 +95,73 @@ ldlm_flocks_overlap(struct ldlm_lock *lock, struct ldlm_lock *new)
                 lock->l_policy_data.l_flock.start));
 }
 
-static inline void ldlm_flock_blocking_link(struct ldlm_lock *req,
-					    struct ldlm_lock *lock)
+static inline __u64 ldlm_flock_nid(struct ldlm_lock *lock)
 {
-        /* For server only */
-        if (req->l_export == NULL)
-		return;
+	if (lock->l_export == NULL || lock->l_export->exp_connection == NULL)
+		return LNET_NID_ANY;
+
+	return lock->l_export->exp_connection->c_peer.nid;
+}
+
+/**
+ * Returns true if \a lock is what the waiting \a req is recorded to wait
+ * for in the flock wait-for graph.
+ */
+static inline bool ldlm_flock_blocked_by(struct ldlm_lock *req,
+					 struct ldlm_lock *lock)
+{
+	return req->l_policy_data.l_flock.blocking_owner ==
+	       lock->l_policy_data.l_flock.owner &&
+	       req->l_policy_data.l_flock.blocking_nid == ldlm_flock_nid(lock);
+}
+
+/**
+ * Add the wait-for edge from \a req to the owner of \a lock to the
+ * namespace flock hash, replacing the edge \a req had before.
+ *
+ * \retval true if the edge is new and has to be checked for a deadlock
+ * \retval false if \a req was already known to wait for \a lock owner
+ */
+static bool ldlm_flock_blocking_link(struct ldlm_lock *req,
+				     struct ldlm_lock *lock)
+{
+	struct cfs_hash *hs = ldlm_lock_to_ns(req)->ns_flock_hash;
+
+	/* For server only */
+	if (req->l_export == NULL || hs == NULL)
+		return false;
 
-	LASSERT(hlist_unhashed(&req->l_exp_flock_hash));
+	check_res_locked(req->l_resource);
+	if (!hlist_unhashed(&req->l_flock_hash)) {
+		if (ldlm_flock_blocked_by(req, lock))
+			return false;
+		cfs_hash_del(hs, &req->l_policy_data.l_flock.owner,
+			     &req->l_flock_hash);
+	}
 
-        req->l_policy_data.l_flock.blocking_owner =
-                lock->l_policy_data.l_flock.owner;
-        req->l_policy_data.l_flock.blocking_export =
-		lock->l_export;
-	req->l_policy_data.l_flock.blocking_refs = 0;
+	/* The edge is only read under the hash bucket lock, update it
+	 * while \a req is out of the hash. */
+	req->l_policy_data.l_flock.blocking_owner =
+		lock->l_policy_data.l_flock.owner;
+	req->l_policy_data.l_flock.blocking_nid = ldlm_flock_nid(lock);
 
-	cfs_hash_add(req->l_export->exp_flock_hash,
-		     &req->l_policy_data.l_flock.owner,
-		     &req->l_exp_flock_hash);
+	cfs_hash_add(hs, &req->l_policy_data.l_flock.owner,
+		     &req->l_flock_hash);
+	return true;
 }
 
 static inline void ldlm_flock_blocking_unlink(struct ldlm_lock *req)
 {
-        /* For server only */
-        if (req->l_export == NULL)
-                return;
+	struct cfs_hash *hs = ldlm_lock_to_ns(req)->ns_flock_hash;
+
+	/* For server only */
+	if (req->l_export == NULL || hs == NULL)
+		return;
 
 	check_res_locked(req->l_resource);
-	if (req->l_export->exp_flock_hash != NULL &&
-	    !hlist_unhashed(&req->l_exp_flock_hash))
-		cfs_hash_del(req->l_export->exp_flock_hash,
-			     &req->l_policy_data.l_flock.owner,
-			     &req->l_exp_flock_hash);
+	if (!hlist_unhashed(&req->l_flock_hash))
+		cfs_hash_del(hs, &req->l_policy_data.l_flock.owner,
+			     &req->l_flock_hash);
 }
 
 static inline void
@@ -138,7 +173,7 @@ ldlm_flock_destroy(struct ldlm_lock *lock, enum ldlm_mode mode, __u64 flags)
 		   mode, flags);
 
 	/* Safe to not lock here, since it should be empty anyway */
-	LASSERT(hlist_unhashed(&lock->l_exp_flock_hash));
+	LASSERT(hlist_unhashed(&lock->l_flock_hash));
 
 	list_del_init(&lock->l_res_link);
 	if (flags == LDLM_FL_WAIT_NOREPROC) {
@@ -157,33 +192,42 @@ ldlm_flock_destroy(struct ldlm_lock *lock, enum ldlm_mode mode, __u64 flags)
 /**
  * POSIX locks deadlock detection code.
  *
- * Given a new lock \a req and an existing lock \a bl_lock it conflicts
- * with, we need to iterate through all blocked POSIX locks for this
- * export and see if there is a deadlock condition arising. (i.e. when
- * one client holds a lock on something and want a lock on something
- * else and at the same time another client has the opposite situation).
+ * Every blocked flock request of an MDT namespace is hashed by its owner
+ * into ns_flock_hash together with the owner (and client NID) it waits
+ * for, which makes the hash a wait-for graph with one outgoing edge per
+ * waiting owner. A new edge from \a req to the owner of \a bl_lock closes
+ * a cycle (i.e. when one client holds a lock on something and want a lock
+ * on something else and at the same time another client has the opposite
+ * situation) iff following the edges from that owner leads back to the
+ * owner of \a req. As each edge is checked when it is added, an edge
+ * that did not change can't complete a cycle and needs no new check.
+ *
+ * Each step is a single hash lookup, and the walk is bounded by
+ * ns_flock_deadlock_depth, so the cost of a check does not depend on how
+ * many exports or blocked locks the namespace has.
  */
 
 struct ldlm_flock_lookup_cb_data {
-	__u64 *bl_owner;
-	struct ldlm_lock *lock;
-	struct obd_export *exp;
+	__u64 nid;
+	__u64 bl_owner;
+	__u64 bl_nid;
+	bool found;
 };
 
 static int ldlm_flock_lookup_cb(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 				struct hlist_node *hnode, void *data)
 {
 	struct ldlm_flock_lookup_cb_data *cb_data = data;
-	struct obd_export *exp = cfs_hash_object(hs, hnode);
-	struct ldlm_lock *lock;
+	struct ldlm_lock *lock = cfs_hash_object(hs, hnode);
 
-	lock = cfs_hash_lookup(exp->exp_flock_hash, cb_data->bl_owner);
-	if (lock == NULL)
+	if (ldlm_flock_nid(lock) != cb_data->nid ||
+	    lock->l_export->exp_failed)
 		return 0;
 
 	/* Stop on first found lock. Same process can't sleep twice */
-	cb_data->lock = lock;
-	cb_data->exp = class_export_get(exp);
+	cb_data->bl_owner = lock->l_policy_data.l_flock.blocking_owner;
+	cb_data->bl_nid = lock->l_policy_data.l_flock.blocking_nid;
+	cb_data->found = true;
 
 	return 1;
 }
@@ -191,60 +235,37 @@ static int ldlm_flock_lookup_cb(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 static int
 ldlm_flock_deadlock(struct ldlm_lock *req, struct ldlm_lock *bl_lock)
 {
-        struct obd_export *req_exp = req->l_export;
-        struct obd_export *bl_exp = bl_lock->l_export;
-        __u64 req_owner = req->l_policy_data.l_flock.owner;
-        __u64 bl_owner = bl_lock->l_policy_data.l_flock.owner;
-
-        /* For server only */
-        if (req_exp == NULL)
-                return 0;
+	struct ldlm_namespace *ns = ldlm_lock_to_ns(req);
+	__u64 req_owner = req->l_policy_data.l_flock.owner;
+	__u64 req_nid = ldlm_flock_nid(req);
+	__u64 bl_owner = bl_lock->l_policy_data.l_flock.owner;
+	__u64 bl_nid = ldlm_flock_nid(bl_lock);
+	unsigned int depth;
+
+	/* For server only */
+	if (req->l_export == NULL || ns->ns_flock_hash == NULL)
+		return 0;
 
-        class_export_get(bl_exp);
-	while (1) {
+	for (depth = 0; depth < ns->ns_flock_deadlock_depth; depth++) {
 		struct ldlm_flock_lookup_cb_data cb_data = {
-					.bl_owner = &bl_owner,
-					.lock = NULL,
-					.exp = NULL };
-		struct obd_export *bl_exp_new;
-		struct ldlm_lock *lock = NULL;
-		struct ldlm_flock *flock;
-
-		if (bl_exp->exp_flock_hash != NULL) {
-			cfs_hash_for_each_key(bl_exp->exp_obd->obd_nid_hash,
-				&bl_exp->exp_connection->c_peer.nid,
-				ldlm_flock_lookup_cb, &cb_data);
-			lock = cb_data.lock;
-		}
-		if (lock == NULL)
-			break;
-
-		class_export_put(bl_exp);
-		bl_exp = cb_data.exp;
-
-		LASSERT(req != lock);
-		flock = &lock->l_policy_data.l_flock;
-		LASSERT(flock->owner == bl_owner);
-                bl_owner = flock->blocking_owner;
-                bl_exp_new = class_export_get(flock->blocking_export);
-                class_export_put(bl_exp);
-
-		cfs_hash_put(bl_exp->exp_flock_hash, &lock->l_exp_flock_hash);
-                bl_exp = bl_exp_new;
-
-		if (bl_exp->exp_failed)
-			break;
-
-		if (bl_owner == req_owner &&
-		    (bl_exp->exp_connection->c_peer.nid ==
-		     req_exp->exp_connection->c_peer.nid)) {
-                        class_export_put(bl_exp);
-                        return 1;
-                }
-        }
-        class_export_put(bl_exp);
+					.nid = bl_nid,
+					.found = false };
+
+		cfs_hash_for_each_key(ns->ns_flock_hash, &bl_owner,
+				      ldlm_flock_lookup_cb, &cb_data);
+		/* the owner is not blocked, the chain ends here */
+		if (!cb_data.found)
+			return 0;
+
+		bl_owner = cb_data.bl_owner;
+		bl_nid = cb_data.bl_nid;
+		if (bl_owner == req_owner && bl_nid == req_nid)
+			return 1;
+	}
 
-        return 0;
+	LDLM_DEBUG(req, "flock wait-for chain longer than %u owners, "
+		   "deadlock check stopped", ns->ns_flock_deadlock_depth);
+	return 0;
 }
 
 static void ldlm_flock_cancel_on_deadlock(struct ldlm_lock *lock,
@@ -304,8 +325,6 @@ ldlm_process_flock_lock(struct ldlm_lock *req, __u64 *flags, int first_enq,
 	const struct ldlm_callback_suite null_cbs = { NULL };
 	ENTRY;
 
-	printk("ldlm_process_flock_lock: req->l_cc = %d\n", req->l_cc);	
-
 	CDEBUG(D_DLMTRACE, "flags "LPX64" owner "LPU64" pid %u mode %u start "
 	       LPU64" end "LPU64"\n", *flags,
 	       new->l_policy_data.l_flock.owner,
@@ -338,6 +357,8 @@ reprocess:
                 }
         } else {
 		int reprocess_failed = 0;
+		bool check;
+
                 lockmode_verify(mode);
 
                 /* This loop determines if there are existing locks
@@ -360,8 +381,18 @@ reprocess:
                                 continue;
 
 			if (!first_enq) {
+				/* The first conflict found becomes the edge of
+				 * \a req in the wait-for graph. An unchanged
+				 * edge was checked when it was added, other
+				 * conflicts are only checked. */
+				if (!reprocess_failed)
+					check = ldlm_flock_blocking_link(req,
+									 lock);
+				else
+					check = !ldlm_flock_blocked_by(req,
+								       lock);
 				reprocess_failed = 1;
-				if (ldlm_flock_deadlock(req, lock)) {
+				if (check && ldlm_flock_deadlock(req, lock)) {
 					ldlm_flock_cancel_on_deadlock(req,
 							work_list);
 					RETURN(LDLM_ITER_CONTINUE);
@@ -863,103 +894,90 @@ void ldlm_flock_policy_local_to_wire(const union ldlm_policy_data *lpolicy,
 }
 
 /*
- * Export handle<->flock hash operations.
+ * Owner<->blocked flock lock hash operations.
  */
 static unsigned
-ldlm_export_flock_hash(struct cfs_hash *hs, const void *key, unsigned mask)
+ldlm_flock_hash(struct cfs_hash *hs, const void *key, unsigned mask)
 {
 	return cfs_hash_u64_hash(*(__u64 *)key, mask);
 }
 
 static void *
-ldlm_export_flock_key(struct hlist_node *hnode)
+ldlm_flock_key(struct hlist_node *hnode)
 {
 	struct ldlm_lock *lock;
 
-	lock = hlist_entry(hnode, struct ldlm_lock, l_exp_flock_hash);
+	lock = hlist_entry(hnode, struct ldlm_lock, l_flock_hash);
 	return &lock->l_policy_data.l_flock.owner;
 }
 
 static int
-ldlm_export_flock_keycmp(const void *key, struct hlist_node *hnode)
+ldlm_flock_keycmp(const void *key, struct hlist_node *hnode)
 {
-	return !memcmp(ldlm_export_flock_key(hnode), key, sizeof(__u64));
+	return !memcmp(ldlm_flock_key(hnode), key, sizeof(__u64));
 }
 
 static void *
-ldlm_export_flock_object(struct hlist_node *hnode)
+ldlm_flock_object(struct hlist_node *hnode)
 {
-	return hlist_entry(hnode, struct ldlm_lock, l_exp_flock_hash);
+	return hlist_entry(hnode, struct ldlm_lock, l_flock_hash);
 }
 
 static void
-ldlm_export_flock_get(struct cfs_hash *hs, struct hlist_node *hnode)
+ldlm_flock_get(struct cfs_hash *hs, struct hlist_node *hnode)
 {
 	struct ldlm_lock *lock;
-	struct ldlm_flock *flock;
 
-	lock = hlist_entry(hnode, struct ldlm_lock, l_exp_flock_hash);
+	lock = hlist_entry(hnode, struct ldlm_lock, l_flock_hash);
 	LDLM_LOCK_GET(lock);
-
-	flock = &lock->l_policy_data.l_flock;
-	LASSERT(flock->blocking_export != NULL);
-	class_export_get(flock->blocking_export);
-	flock->blocking_refs++;
 }
 
 static void
-ldlm_export_flock_put(struct cfs_hash *hs, struct hlist_node *hnode)
+ldlm_flock_put(struct cfs_hash *hs, struct hlist_node *hnode)
 {
 	struct ldlm_lock *lock;
-	struct ldlm_flock *flock;
 
-	lock = hlist_entry(hnode, struct ldlm_lock, l_exp_flock_hash);
+	lock = hlist_entry(hnode, struct ldlm_lock, l_flock_hash);
 	LDLM_LOCK_RELEASE(lock);
-
-	flock = &lock->l_policy_data.l_flock;
-	LASSERT(flock->blocking_export != NULL);
-	class_export_put(flock->blocking_export);
-	if (--flock->blocking_refs == 0) {
-		flock->blocking_owner = 0;
-		flock->blocking_export = NULL;
-	}
 }
 
-static struct cfs_hash_ops ldlm_export_flock_ops = {
-	.hs_hash        = ldlm_export_flock_hash,
-	.hs_key         = ldlm_export_flock_key,
-	.hs_keycmp      = ldlm_export_flock_keycmp,
-	.hs_object      = ldlm_export_flock_object,
-	.hs_get         = ldlm_export_flock_get,
-	.hs_put         = ldlm_export_flock_put,
-	.hs_put_locked  = ldlm_export_flock_put,
+static struct cfs_hash_ops ldlm_flock_ops = {
+	.hs_hash        = ldlm_flock_hash,
+	.hs_key         = ldlm_flock_key,
+	.hs_keycmp      = ldlm_flock_keycmp,
+	.hs_object      = ldlm_flock_object,
+	.hs_get         = ldlm_flock_get,
+	.hs_put         = ldlm_flock_put,
+	.hs_put_locked  = ldlm_flock_put,
 };
 
-int ldlm_init_flock_export(struct obd_export *exp)
+/**
+ * Create the flock wait-for graph of the server namespace \a ns.
+ */
+int ldlm_flock_ns_init(struct ldlm_namespace *ns)
 {
-	if( strcmp(exp->exp_obd->obd_type->typ_name, LUSTRE_MDT_NAME) != 0)
-		RETURN(0);
+	ENTRY;
 
-	exp->exp_flock_hash =
-		cfs_hash_create(obd_uuid2str(&exp->exp_client_uuid),
+	ns->ns_flock_hash =
+		cfs_hash_create(ldlm_ns_name(ns),
 				HASH_EXP_LOCK_CUR_BITS,
 				HASH_EXP_LOCK_MAX_BITS,
 				HASH_EXP_LOCK_BKT_BITS, 0,
 				CFS_HASH_MIN_THETA, CFS_HASH_MAX_THETA,
-				&ldlm_export_flock_ops,
+				&ldlm_flock_ops,
 				CFS_HASH_DEFAULT | CFS_HASH_NBLK_CHANGE);
-	if (!exp->exp_flock_hash)
+	if (!ns->ns_flock_hash)
 		RETURN(-ENOMEM);
 
 	RETURN(0);
 }
 
-void ldlm_destroy_flock_export(struct obd_export *exp)
+void ldlm_flock_ns_fini(struct ldlm_namespace *ns)
 {
 	ENTRY;
-	if (exp->exp_flock_hash) {
-		cfs_hash_putref(exp->exp_flock_hash);
-		exp->exp_flock_hash = NULL;
+	if (ns->ns_flock_hash) {
+		cfs_hash_putref(ns->ns_flock_hash);
+		ns->ns_flock_hash = NULL;
 	}
 	EXIT;
 }
@@ -60,7 +60,123 @@
 
 #include "ldlm_internal.h"
 
+/**
+ * Granted IBITS locks of a server resource are also accounted in
+ * res->lr_ibits_queues: for every mode, how many granted locks hold each
+ * bit, and the union of those bits. ldlm_inodebits_compat_queue() uses it
+ * to tell in constant time that nothing granted can conflict with a
+ * request, which is the common case for lookup/getattr locks on a hot
+ * directory, without walking the skip lists at all.
+ */
+static inline int ldlm_ibits_slot(int bit)
+{
+	return bit > MDS_INODELOCK_MAXSHIFT ? LDLM_IBITS_OTHER : bit;
+}
+
+/** Account newly granted \a lock in the resource inodebits summary. */
+void ldlm_inodebits_add_lock(struct ldlm_resource *res, struct ldlm_lock *lock)
+{
+	struct ldlm_ibits_queues *queues = res->lr_ibits_queues;
+	__u64 bits = lock->l_policy_data.l_inodebits.bits;
+	int idx;
+	int i;
+
+	check_res_locked(res);
+	if (queues == NULL)
+		return;
+
+	LASSERT(lock->l_ibits_mode == 0);
+	lock->l_ibits_mode = lock->l_granted_mode;
+	idx = ldlm_mode_to_index(lock->l_ibits_mode);
+	for (i = 0; bits != 0; i++, bits >>= 1)
+		if (bits & 1)
+			queues->liq_count[idx][ldlm_ibits_slot(i)]++;
+	queues->liq_bits[idx] |= lock->l_policy_data.l_inodebits.bits;
+}
+
+/** Drop \a lock from the resource inodebits summary, if accounted. */
+void ldlm_inodebits_unlink_lock(struct ldlm_lock *lock)
+{
+	struct ldlm_ibits_queues *queues = lock->l_resource->lr_ibits_queues;
+	__u64 bits = lock->l_policy_data.l_inodebits.bits;
+	int idx;
+	int i;
+
+	if (queues == NULL || lock->l_ibits_mode == 0)
+		return;
+
+	idx = ldlm_mode_to_index(lock->l_ibits_mode);
+	lock->l_ibits_mode = 0;
+	for (i = 0; bits != 0; i++, bits >>= 1) {
+		int slot = ldlm_ibits_slot(i);
+
+		if (!(bits & 1))
+			continue;
+		LASSERT(queues->liq_count[idx][slot] > 0);
+		if (--queues->liq_count[idx][slot] > 0)
+			continue;
+		if (slot == LDLM_IBITS_OTHER)
+			queues->liq_bits[idx] &= MDS_INODELOCK_FULL;
+		else
+			queues->liq_bits[idx] &= ~(1ULL << slot);
+	}
+}
+
+/**
+ * Drop \a to_drop bits from granted IBITS \a lock, keeping the rest.
+ *
+ * The lock is relinked so that it lands in the skip list policy group
+ * (and granted summary slots) matching its new bits.
+ * Must be called with the resource lock held.
+ */
+void ldlm_inodebits_drop(struct ldlm_lock *lock, __u64 to_drop)
+{
+	ENTRY;
+
+	check_res_locked(lock->l_resource);
+	LASSERT(lock->l_granted_mode == lock->l_req_mode);
+
+	to_drop &= lock->l_policy_data.l_inodebits.bits;
+	if (to_drop == 0) {
+		EXIT;
+		return;
+	}
+	LASSERT(to_drop != lock->l_policy_data.l_inodebits.bits);
+
+	LDLM_DEBUG(lock, "dropping bits "LPX64, to_drop);
+	ldlm_resource_unlink_lock(lock);
+	lock->l_policy_data.l_inodebits.bits &= ~to_drop;
+	ldlm_grant_lock_with_skiplist(lock);
+	EXIT;
+}
+
 #ifdef HAVE_SERVER_SUPPORT
+/**
+ * Check the granted summary of \a req's resource.
+ *
+ * \retval true if no granted lock of a conflicting mode holds any of the
+ *	   bits of \a req, so the granted queue need not be walked
+ * \retval false if the summary is missing or a conflict is possible
+ */
+static bool ldlm_inodebits_granted_compat(struct ldlm_lock *req)
+{
+	struct ldlm_ibits_queues *queues = req->l_resource->lr_ibits_queues;
+	__u64 req_bits = req->l_policy_data.l_inodebits.bits;
+	int idx;
+
+	if (queues == NULL)
+		return false;
+
+	for (idx = 0; idx < LCK_MODE_NUM; idx++) {
+		if (!(queues->liq_bits[idx] & req_bits))
+			continue;
+		/* COS compatibility depends on the lock owner, walk. */
+		if (!lockmode_compat(1 << idx, req->l_req_mode))
+			return false;
+	}
+	return true;
+}
+
 /**
  * Determine if the lock is compatible with all locks on the queue.
  *
@@ -90,6 +206,10 @@ ldlm_inodebits_compat_queue(struct list_head *queue, struct ldlm_lock *req,
 	 * Also, such a lock would be compatible with any other bit lock */
 	LASSERT(req_bits != 0);
 
+	if (queue == &req->l_resource->lr_granted &&
+	    ldlm_inodebits_granted_compat(req))
+		RETURN(1);
+
 	list_for_each(tmp, queue) {
 		struct list_head *mode_tail;
 
@@ -201,8 +321,6 @@ int ldlm_process_inodebits_lock(struct ldlm_lock *lock, __u64 *flags,
 	INIT_LIST_HEAD(&rpc_list);
 	check_res_locked(res);
 
-	printk("ldlm_process_inodebits_lock(): lock->l_cc = %d\n", lock->l_cc);
-
 	/* (*flags & LDLM_FL_BLOCK_NOWAIT) is for layout lock right now. */
         if (!first_enq || (*flags & LDLM_FL_BLOCK_NOWAIT)) {
 		*err = ELDLM_LOCK_ABORTED;
@@ -249,6 +367,52 @@ int ldlm_process_inodebits_lock(struct ldlm_lock *lock, __u64 *flags,
         }
         RETURN(0);
 }
+
+/**
+ * Server side of an IBITS lock convert: the client gave up some bits of
+ * \a lock in reply to a blocking AST and keeps \a new_bits cached.
+ *
+ * The lock is downgraded in place and its blocking AST state is reset,
+ * so a later conflict on the remaining bits sends a new blocking AST.
+ * The caller must reprocess the resource on success.
+ *
+ * \retval 0 if the lock now holds \a new_bits
+ * \retval -EINVAL if the lock is no longer granted
+ * \retval -EPROTO if \a new_bits is not a non-empty subset of lock bits
+ * \retval -EAGAIN if the blocking AST for the lock is still being sent
+ */
+int ldlm_inodebits_convert(struct ldlm_lock *lock, __u64 new_bits)
+{
+	__u64 bits;
+	int rc = 0;
+	ENTRY;
+
+	lock_res_and_lock(lock);
+	bits = lock->l_policy_data.l_inodebits.bits;
+	if (lock->l_granted_mode != lock->l_req_mode ||
+	    ldlm_is_destroyed(lock) || ldlm_is_cancel(lock))
+		GOTO(out, rc = -EINVAL);
+
+	if (new_bits == 0 || (new_bits & ~bits) != 0)
+		GOTO(out, rc = -EPROTO);
+
+	/* ldlm_work_bl_ast_lock() still owns l_blocking_lock */
+	if (lock->l_blocking_lock != NULL || !list_empty(&lock->l_bl_ast))
+		GOTO(out, rc = -EAGAIN);
+
+	ldlm_inodebits_drop(lock, bits & ~new_bits);
+	ldlm_clear_cbpending(lock);
+	ldlm_clear_discard_data(lock);
+	ldlm_clear_ast_sent(lock);
+	lock->l_bl_ast_run = 0;
+	EXIT;
+out:
+	unlock_res_and_lock(lock);
+	if (rc != 0)
+		LDLM_DEBUG(lock, "cannot convert to bits "LPX64": rc = %d",
+			   new_bits, rc);
+	return rc;
+}
 #endif /* HAVE_SERVER_SUPPORT */
 
 void ldlm_ibits_policy_wire_to_local(const union ldlm_wire_policy_data *wpolicy,
@@ -44,6 +44,7 @@ extern struct mutex ldlm_cli_namespace_lock;
 extern struct list_head ldlm_cli_active_namespace_list;
 extern struct list_head ldlm_cli_inactive_namespace_list;
 extern unsigned int ldlm_cancel_unused_locks_before_replay;
+extern unsigned int ldlm_replay_batches_in_flight;
 
 static inline int ldlm_namespace_nr_read(enum ldlm_side client)
 {
@@ -122,6 +123,7 @@ extern unsigned int ldlm_enqueue_min;
 extern struct kmem_cache *ldlm_resource_slab;
 extern struct kmem_cache *ldlm_lock_slab;
 extern struct kmem_cache *ldlm_interval_tree_slab;
+extern struct kmem_cache *ldlm_ibits_queues_slab;
 
 int ldlm_resource_putref_locked(struct ldlm_resource *res);
 void ldlm_resource_insert_lock_after(struct ldlm_lock *original,
@@ -145,6 +147,7 @@ typedef enum {
 } ldlm_desc_ast_t;
 
 void ldlm_grant_lock(struct ldlm_lock *lock, struct list_head *work_list);
+void ldlm_grant_lock_with_skiplist(struct ldlm_lock *lock);
 int ldlm_fill_lvb(struct ldlm_lock *lock, struct req_capsule *pill,
 		  enum req_location loc, void *data, int size);
 struct ldlm_lock *
@@ -208,16 +211,38 @@ int ldlm_process_inodebits_lock(struct ldlm_lock *lock, __u64 *flags,
 int ldlm_process_extent_lock(struct ldlm_lock *lock, __u64 *flags,
 			     int first_enq, enum ldlm_error *err,
 			     struct list_head *work_list);
+void ldlm_extent_contention_get(struct ldlm_resource *res, __u32 *rate,
+				__u32 *exports);
 #endif
 void ldlm_extent_add_lock(struct ldlm_resource *res, struct ldlm_lock *lock);
 void ldlm_extent_unlink_lock(struct ldlm_lock *lock);
 
+/* ldlm_inodebits.c */
+void ldlm_inodebits_add_lock(struct ldlm_resource *res, struct ldlm_lock *lock);
+void ldlm_inodebits_unlink_lock(struct ldlm_lock *lock);
+void ldlm_inodebits_drop(struct ldlm_lock *lock, __u64 to_drop);
+#ifdef HAVE_SERVER_SUPPORT
+int ldlm_inodebits_convert(struct ldlm_lock *lock, __u64 new_bits);
+#endif
+
+static inline int ldlm_mode_to_index(enum ldlm_mode mode)
+{
+	int index;
+
+	LASSERT(mode != 0);
+	LASSERT(IS_PO2(mode));
+	for (index = -1; mode != 0; index++, mode >>= 1)
+		/* do nothing */;
+	LASSERT(index < LCK_MODE_NUM);
+	return index;
+}
+
 /* ldlm_flock.c */
 int ldlm_process_flock_lock(struct ldlm_lock *req, __u64 *flags,
 			    int first_enq, enum ldlm_error *err,
 			    struct list_head *work_list);
-int ldlm_init_flock_export(struct obd_export *exp);
-void ldlm_destroy_flock_export(struct obd_export *exp);
+int ldlm_flock_ns_init(struct ldlm_namespace *ns);
+void ldlm_flock_ns_fini(struct ldlm_namespace *ns);
 
 /* l_lock.c */
 void l_check_ns_lock(struct ldlm_namespace *ns);
@@ -356,3 +381,11 @@ void ldlm_reclaim_cleanup(void);
 void ldlm_reclaim_add(struct ldlm_lock *lock);
 void ldlm_reclaim_del(struct ldlm_lock *lock);
 bool ldlm_reclaim_full(void);
+#ifdef HAVE_SERVER_SUPPORT
+void ldlm_reclaim_hist_get(struct ldlm_namespace *ns, __u64 *hist);
+int ldlm_reclaim_hist_seq_show(struct seq_file *m, void *v);
+int ldlm_reclaim_stats_seq_show(struct seq_file *m, void *v);
+ssize_t ldlm_reclaim_stats_seq_write(struct file *file,
+				     const char __user *buffer,
+				     size_t count, loff_t *off);
+#endif
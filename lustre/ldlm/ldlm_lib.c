@@ -375,11 +375,8 @@ int client_obd_setup(struct obd_device *obddev, struct lustre_cfg *lcfg)
 
 	/* lru for osc. */
 	INIT_LIST_HEAD(&cli->cl_lru_osc);
-	atomic_set(&cli->cl_lru_shrinkers, 0);
 	atomic_long_set(&cli->cl_lru_busy, 0);
-	atomic_long_set(&cli->cl_lru_in_list, 0);
-	INIT_LIST_HEAD(&cli->cl_lru_list);
-	spin_lock_init(&cli->cl_lru_list_lock);
+	cli->cl_lru = NULL;
 	atomic_long_set(&cli->cl_unstable_count, 0);
 	INIT_LIST_HEAD(&cli->cl_shrink_list);
 
@@ -567,6 +564,7 @@ int client_connect_import(const struct lu_env *env,
 		if (is_mdc)
 			data->ocd_connect_flags |= OBD_CONNECT_MULTIMODRPCS;
                 imp->imp_connect_flags_orig = data->ocd_connect_flags;
+		imp->imp_connect_flags2_orig = data->ocd_connect_flags2;
         }
 
         rc = ptlrpc_connect_import(imp);
@@ -581,6 +579,7 @@ int client_connect_import(const struct lu_env *env,
                          ocd->ocd_connect_flags, "old "LPX64", new "LPX64"\n",
                          data->ocd_connect_flags, ocd->ocd_connect_flags);
                 data->ocd_connect_flags = ocd->ocd_connect_flags;
+		data->ocd_connect_flags2 = ocd->ocd_connect_flags2;
 		/* clear the flag as it was not set and is not known
 		 * by upper layers */
 		if (is_mdc)
@@ -2465,6 +2464,7 @@ static int target_recovery_thread(void *arg)
 	 */
 	CDEBUG(D_INFO, "2: lock replay stage - %d clients\n",
 	       atomic_read(&obd->obd_lock_replay_clients));
+	obd->obd_lock_replay_start = cfs_time_current_sec();
 	while ((req = target_next_replay_lock(lut))) {
 		LASSERT(trd->trd_processing_task == current_pid());
 		DEBUG_REQ(D_HA, req, "processing lock from %s: ",
@@ -2474,6 +2474,7 @@ static int target_recovery_thread(void *arg)
 		target_request_copy_put(req);
 		obd->obd_replayed_locks++;
 	}
+	obd->obd_lock_replay_end = cfs_time_current_sec();
 
         /**
          * The third stage: reply on final pings, at this moment all clients
@@ -2505,8 +2506,9 @@ static int target_recovery_thread(void *arg)
 	}
 
 	delta = jiffies_to_msecs(jiffies - delta) / MSEC_PER_SEC;
-	CDEBUG(D_INFO,"4: recovery completed in %lus - %d/%d reqs/locks\n",
-	      delta, obd->obd_replayed_requests, obd->obd_replayed_locks);
+	CDEBUG(D_INFO, "4: recovery completed in %lus - %d/%d/"LPU64
+	       " reqs/lock RPCs/locks\n", delta, obd->obd_replayed_requests,
+	       obd->obd_replayed_locks, obd->obd_replayed_lock_count);
 	if (delta > OBD_RECOVERY_TIME_SOFT) {
 		CWARN("too long recovery - read logs\n");
 		libcfs_debug_dumplog();
@@ -2607,6 +2609,9 @@ void target_recovery_init(struct lu_target *lut, svc_handler_t handler)
         obd->obd_next_recovery_transno = obd->obd_last_committed + 1;
         obd->obd_recovery_start = 0;
         obd->obd_recovery_end = 0;
+	obd->obd_replayed_lock_count = 0;
+	obd->obd_lock_replay_start = 0;
+	obd->obd_lock_replay_end = 0;
 
         cfs_timer_init(&obd->obd_recovery_timer, target_recovery_expired, obd);
         target_start_recovery_thread(lut, handler);
@@ -202,6 +202,7 @@ void ldlm_lock_put(struct ldlm_lock *lock)
                 res = lock->l_resource;
 		LASSERT(ldlm_is_destroyed(lock));
 		LASSERT(list_empty(&lock->l_exp_list));
+		LASSERT(list_empty(&lock->l_reclaim_link));
 		LASSERT(list_empty(&lock->l_res_link));
 		LASSERT(list_empty(&lock->l_pending_chain));
 
@@ -480,12 +481,13 @@ static struct ldlm_lock *ldlm_lock_new(struct ldlm_resource *resource)
 	INIT_LIST_HEAD(&lock->l_bl_ast);
 	INIT_LIST_HEAD(&lock->l_cp_ast);
 	INIT_LIST_HEAD(&lock->l_rk_ast);
+	INIT_LIST_HEAD(&lock->l_reclaim_link);
 	init_waitqueue_head(&lock->l_waitq);
 	lock->l_blocking_lock = NULL;
 	INIT_LIST_HEAD(&lock->l_sl_mode);
 	INIT_LIST_HEAD(&lock->l_sl_policy);
 	INIT_HLIST_NODE(&lock->l_exp_hash);
-	INIT_HLIST_NODE(&lock->l_exp_flock_hash);
+	INIT_HLIST_NODE(&lock->l_flock_hash);
 
         lprocfs_counter_incr(ldlm_res_to_ns(resource)->ns_stats,
                              LDLM_NSS_LOCKS);
@@ -651,9 +653,6 @@ void ldlm_lock2desc(struct ldlm_lock *lock, struct ldlm_lock_desc *desc)
 	ldlm_convert_policy_to_wire(lock->l_resource->lr_type,
 				    &lock->l_policy_data,
 				    &desc->l_policy_data);
-
-	/* ziqi: pass l_cc from lock to desc */
-	desc->l_cc = lock->l_cc;
 }
 
 /**
@@ -1071,6 +1070,9 @@ static void ldlm_granted_list_add_lock(struct ldlm_lock *lock,
 	if (&lock->l_sl_policy != prev->policy_link)
 		list_add(&lock->l_sl_policy, prev->policy_link);
 
+	if (res->lr_type == LDLM_IBITS)
+		ldlm_inodebits_add_lock(res, lock);
+
         EXIT;
 }
 
@@ -1078,7 +1080,7 @@ static void ldlm_granted_list_add_lock(struct ldlm_lock *lock,
  * Add a lock to granted list on a resource maintaining skiplist
  * correctness.
  */
-static void ldlm_grant_lock_with_skiplist(struct ldlm_lock *lock)
+void ldlm_grant_lock_with_skiplist(struct ldlm_lock *lock)
 {
         struct sl_insert_point prev;
         ENTRY;
@@ -1090,6 +1092,74 @@ static void ldlm_grant_lock_with_skiplist(struct ldlm_lock *lock)
         EXIT;
 }
 
+/**
+ * Lock wait profiler: remember \a res among the resources of its namespace
+ * locks waited the longest on, now that a lock of it waited \a wait usec.
+ *
+ * The table keeps the LDLM_WAIT_TOP_SIZE resources with the largest wait
+ * totals seen, a resource not in it replaces the one with the smallest
+ * total once its own total is larger.
+ */
+static void ldlm_wait_top_update(struct ldlm_resource *res, __u64 wait)
+{
+	struct ldlm_namespace *ns = ldlm_res_to_ns(res);
+	struct ldlm_wait_top *lwt;
+	struct ldlm_wait_top *min = NULL;
+	int i;
+
+	spin_lock(&ns->ns_wait_lock);
+	for (i = 0; i < LDLM_WAIT_TOP_SIZE; i++) {
+		lwt = &ns->ns_wait_top[i];
+		if (lwt->lwt_count != 0 &&
+		    ldlm_res_eq(&lwt->lwt_name, &res->lr_name)) {
+			lwt->lwt_time += wait;
+			lwt->lwt_count++;
+			lwt->lwt_max = max_t(__u32, lwt->lwt_max,
+					     res->lr_wait_max);
+			spin_unlock(&ns->ns_wait_lock);
+			return;
+		}
+		if (min == NULL || lwt->lwt_time < min->lwt_time)
+			min = lwt;
+	}
+
+	if (res->lr_wait_time > min->lwt_time) {
+		min->lwt_name = res->lr_name;
+		min->lwt_type = res->lr_type;
+		min->lwt_time = res->lr_wait_time;
+		min->lwt_count = res->lr_wait_count;
+		min->lwt_max = res->lr_wait_max;
+	}
+	spin_unlock(&ns->ns_wait_lock);
+}
+
+/**
+ * Lock wait profiler: account the wait of a server lock which is granted
+ * after waiting since ldlm_resource_add_lock() put it on lr_waiting.
+ *
+ * must be called with lr_lock held
+ */
+static void ldlm_lock_wait_account(struct ldlm_lock *lock)
+{
+	struct ldlm_resource *res = lock->l_resource;
+	struct obd_export *exp = lock->l_export;
+	__u64 wait;
+
+	wait = ktime_to_us(ktime_sub(ktime_get(), lock->l_wait_stamp));
+	lock->l_wait_stamp = ktime_set(0, 0);
+
+	res->lr_wait_time += wait;
+	res->lr_wait_count++;
+	if (wait > res->lr_wait_max)
+		res->lr_wait_max = min_t(__u64, wait, UINT_MAX);
+
+	if (exp != NULL && exp->exp_nid_stats != NULL)
+		lprocfs_oh_tally_log2(&exp->exp_nid_stats->nid_lock_wait_hist,
+				      min_t(__u64, wait, UINT_MAX));
+
+	ldlm_wait_top_update(res, wait);
+}
+
 /**
  * Perform lock granting bookkeeping.
  *
@@ -1108,6 +1178,12 @@ void ldlm_grant_lock(struct ldlm_lock *lock, struct list_head *work_list)
 
         check_res_locked(res);
 
+	/* a converted lock was granted before, its stamp is not a wait */
+	if (lock->l_granted_mode == LCK_MINMODE &&
+	    ktime_to_ns(lock->l_wait_stamp) != 0 &&
+	    ns_is_server(ldlm_res_to_ns(res)))
+		ldlm_lock_wait_account(lock);
+
         lock->l_granted_mode = lock->l_req_mode;
 
 	if (work_list && lock->l_completion_ast != NULL)
@@ -2242,6 +2318,9 @@ void ldlm_unlink_lock_skiplist(struct ldlm_lock *req)
             req->l_resource->lr_type != LDLM_IBITS)
                 return;
 
+	if (req->l_resource->lr_type == LDLM_IBITS)
+		ldlm_inodebits_unlink_lock(req);
+
 	list_del_init(&req->l_sl_policy);
 	list_del_init(&req->l_sl_mode);
 }
@@ -64,6 +64,17 @@ struct ldlm_cb_async_args {
         struct ldlm_lock       *ca_lock;
 };
 
+struct ldlm_cb_batch_args {
+	struct ldlm_bl_batch	*cba_batch;
+};
+
+/**
+ * Max number of locks revoked by one batched blocking AST RPC. The request
+ * carries a lock handle and an ldlm_lock_desc per lock and has to fit in
+ * LDLM_MAXREQSIZE, see ldlm_bl_batch_send().
+ */
+#define LDLM_BL_BATCH_MAX	40
+
 /* LDLM state */
 
 static struct ldlm_state *ldlm_state;
@@ -150,6 +161,46 @@ static struct expired_lock_thread {
 	struct list_head		elt_expired_locks;
 } expired_lock_thread;
 
+static unsigned int ldlm_bl_batch_delay = 1;
+CFS_MODULE_PARM(ldlm_bl_batch_delay, "i", uint, 0644,
+		"time in ms to gather blocking ASTs for one client");
+
+/**
+ * Blocking ASTs for locks of one client gathered during ldlm_bl_batch_delay
+ * after the first of them, sent as a single LDLM_BL_CALLBACK RPC carrying
+ * all lock handles and, for each lock, the descriptor of the lock it
+ * conflicts with.
+ */
+struct ldlm_bl_batch {
+	/** on ldlm_bl_batch_thread.lbt_batches while more locks may join */
+	struct list_head	 lbb_list;
+	struct obd_export	*lbb_exp;
+	cfs_time_t		 lbb_deadline;
+	/** LDLM_FL_AST_MASK flags, sent once for all locks */
+	__u64			 lbb_flags;
+	/** slots reserved by ldlm_bl_batch_get() and not filled yet */
+	int			 lbb_busy;
+	/** no more slots can be reserved, sent once lbb_busy is zero */
+	unsigned int		 lbb_closed:1;
+	int			 lbb_count;
+	struct ldlm_lock	*lbb_locks[LDLM_BL_BATCH_MAX];
+	struct ldlm_lock_desc	 lbb_descs[LDLM_BL_BATCH_MAX];
+};
+
+/**
+ * Protects ldlm_bl_batch_thread lists and obd_export::exp_bl_batch.
+ */
+static spinlock_t ldlm_bl_batch_lock;
+
+static struct ldlm_bl_batch_thread {
+	wait_queue_head_t	lbt_waitq;
+	int			lbt_state;
+	/** batches still open, see ldlm_bl_batch::lbb_list */
+	struct list_head	lbt_batches;
+	/** locks cancelled by a failed batched AST, linked by l_bl_ast */
+	struct list_head	lbt_reprocess;
+} ldlm_bl_batch_thread;
+
 static inline int have_expired_locks(void)
 {
 	int need_to_run;
@@ -829,12 +880,398 @@ static void ldlm_lock_reorder_req(struct ldlm_lock *lock)
 	EXIT;
 }
 
+static void ldlm_bl_batch_free(struct ldlm_bl_batch *batch)
+{
+	class_export_put(batch->lbb_exp);
+	OBD_FREE_LARGE(batch, sizeof(*batch));
+}
+
+/**
+ * Stop \a batch from taking more locks. Called with ldlm_bl_batch_lock held.
+ *
+ * \retval true if the caller has to send the batch, i.e. no slot of it is
+ *	   being filled anymore
+ */
+static bool ldlm_bl_batch_close(struct ldlm_bl_batch *batch)
+{
+	if (batch->lbb_exp->exp_bl_batch == batch)
+		batch->lbb_exp->exp_bl_batch = NULL;
+	list_del_init(&batch->lbb_list);
+	batch->lbb_closed = 1;
+
+	return batch->lbb_busy == 0;
+}
+
+/**
+ * Queue \a lock for ldlm_bl_batch_main() to reprocess its resource once a
+ * batched blocking AST failed and cancelled it. This cannot be done from
+ * the interpret callback, since granting the waiting locks may need to
+ * wait for more ASTs. The reference on \a lock is handed over.
+ */
+static void ldlm_bl_batch_reprocess(struct ldlm_lock *lock)
+{
+	struct ldlm_bl_batch_thread *lbt = &ldlm_bl_batch_thread;
+
+	lock_res_and_lock(lock);
+	if (!list_empty(&lock->l_bl_ast)) {
+		unlock_res_and_lock(lock);
+		LDLM_LOCK_RELEASE(lock);
+		return;
+	}
+	spin_lock(&ldlm_bl_batch_lock);
+	list_add_tail(&lock->l_bl_ast, &lbt->lbt_reprocess);
+	spin_unlock(&ldlm_bl_batch_lock);
+	unlock_res_and_lock(lock);
+
+	wake_up(&lbt->lbt_waitq);
+}
+
+static int ldlm_cb_batch_interpret(const struct lu_env *env,
+				   struct ptlrpc_request *req, void *data,
+				   int rc)
+{
+	struct ldlm_cb_batch_args	*ca = data;
+	struct ldlm_bl_batch		*batch = ca->cba_batch;
+	__u32				*rcs = NULL;
+	int				 i;
+	ENTRY;
+
+	if (rc == 0) {
+		rcs = req_capsule_server_sized_get(&req->rq_pill, &RMF_RCS,
+					batch->lbb_count * sizeof(*rcs));
+		if (rcs == NULL)
+			rc = -EPROTO;
+	}
+
+	for (i = 0; i < batch->lbb_count; i++) {
+		struct ldlm_lock *lock = batch->lbb_locks[i];
+		int lrc = rc;
+
+		if (lrc == 0)
+			lrc = ptlrpc_status_ntoh((int)rcs[i]);
+		if (lrc != 0)
+			lrc = ldlm_handle_ast_error(lock, req, lrc, "blocking");
+
+		/* reference taken in ldlm_bl_batch_put() */
+		if (lrc == -ERESTART)
+			ldlm_bl_batch_reprocess(lock);
+		else
+			LDLM_LOCK_RELEASE(lock);
+	}
+	ldlm_bl_batch_free(batch);
+
+	RETURN(0);
+}
+
+static void ldlm_update_batch_resend(struct ptlrpc_request *req, void *data)
+{
+	struct ldlm_cb_batch_args	*ca = data;
+	struct ldlm_bl_batch		*batch = ca->cba_batch;
+	int				 i;
+
+	for (i = 0; i < batch->lbb_count; i++)
+		ldlm_refresh_waiting_lock(batch->lbb_locks[i],
+				ldlm_bl_timeout(batch->lbb_locks[i]));
+}
+
+/**
+ * Send the blocking ASTs gathered in \a batch as one RPC through ptlrpcd.
+ * Consumes \a batch.
+ *
+ * If the request cannot be allocated the batch is put back to be retried
+ * after another ldlm_bl_batch_delay, the locks stay on the waiting list.
+ */
+static void ldlm_bl_batch_send(struct ldlm_bl_batch *batch)
+{
+	struct ldlm_bl_batch_thread	*lbt = &ldlm_bl_batch_thread;
+	struct ptlrpc_request		*req;
+	struct ldlm_cb_batch_args	*ca;
+	struct ldlm_request		*body;
+	struct ldlm_lock_desc		*descs;
+	struct ldlm_lock		*lock;
+	int				 count = batch->lbb_count;
+	int				 rc;
+	int				 i;
+	ENTRY;
+
+	/* the client accepts no more than LDLM_MAXREQSIZE, keep 512 bytes
+	 * for the lustre_msg header and the buffer alignment */
+	CLASSERT(sizeof(struct ldlm_request) +
+		 (LDLM_BL_BATCH_MAX - LDLM_LOCKREQ_HANDLES) *
+		 sizeof(struct lustre_handle) +
+		 LDLM_BL_BATCH_MAX * sizeof(struct ldlm_lock_desc) +
+		 sizeof(struct ptlrpc_body) + 512 <= LDLM_MAXREQSIZE);
+
+	if (count == 0) {
+		/* all locks went away meanwhile */
+		ldlm_bl_batch_free(batch);
+		RETURN_EXIT;
+	}
+
+	req = ptlrpc_request_alloc(batch->lbb_exp->exp_imp_reverse,
+				   &RQF_LDLM_BL_CALLBACK_BATCH);
+	if (req == NULL)
+		GOTO(out_retry, rc = -ENOMEM);
+
+	req_capsule_set_size(&req->rq_pill, &RMF_DLM_REQ, RCL_CLIENT,
+			     ldlm_request_bufsize(count, LDLM_BL_CALLBACK));
+	req_capsule_set_size(&req->rq_pill, &RMF_DLM_BL_DESC, RCL_CLIENT,
+			     count * sizeof(*descs));
+	rc = ptlrpc_request_pack(req, LUSTRE_DLM_VERSION, LDLM_BL_CALLBACK);
+	if (rc != 0) {
+		ptlrpc_request_free(req);
+		GOTO(out_retry, rc);
+	}
+
+	lock = batch->lbb_locks[0];
+	body = req_capsule_client_get(&req->rq_pill, &RMF_DLM_REQ);
+	descs = req_capsule_client_get(&req->rq_pill, &RMF_DLM_BL_DESC);
+	body->lock_desc = batch->lbb_descs[0];
+	body->lock_flags |= ldlm_flags_to_wire(batch->lbb_flags);
+	body->lock_count = count;
+	for (i = 0; i < count; i++) {
+		body->lock_handle[i] = batch->lbb_locks[i]->l_remote_handle;
+		descs[i] = batch->lbb_descs[i];
+	}
+
+	req_capsule_set_size(&req->rq_pill, &RMF_RCS, RCL_SERVER,
+			     count * sizeof(__u32));
+	ptlrpc_request_set_replen(req);
+
+	CLASSERT(sizeof(*ca) <= sizeof(req->rq_async_args));
+	ca = ptlrpc_req_async_args(req);
+	ca->cba_batch = batch;
+	req->rq_interpret_reply = ldlm_cb_batch_interpret;
+
+	/* Do not resend after lock callback timeout */
+	req->rq_delay_limit = ldlm_bl_timeout(lock);
+	req->rq_resend_cb = ldlm_update_batch_resend;
+	req->rq_send_state = LUSTRE_IMP_FULL;
+	if (AT_OFF)
+		req->rq_timeout = ldlm_get_rq_timeout();
+
+	LDLM_DEBUG(lock, "server sending blocking AST for %d locks", count);
+	ptlrpcd_add_req(req);
+	RETURN_EXIT;
+
+out_retry:
+	CDEBUG(D_DLMTRACE, "cannot send blocking AST for %d locks, retry: "
+	       "rc = %d\n", count, rc);
+	spin_lock(&ldlm_bl_batch_lock);
+	batch->lbb_deadline = cfs_time_add(cfs_time_current(),
+				msecs_to_jiffies(ldlm_bl_batch_delay));
+	list_add_tail(&batch->lbb_list, &lbt->lbt_batches);
+	spin_unlock(&ldlm_bl_batch_lock);
+	wake_up(&lbt->lbt_waitq);
+	EXIT;
+}
+
+/**
+ * Reserve a slot for the blocking AST of \a lock in the open batch of its
+ * export, starting a new batch if there is none or if the AST flags of
+ * \a lock differ from those of the open one.
+ *
+ * \retval batch to pass to ldlm_bl_batch_put()
+ * \retval NULL if no memory, the AST has to be sent on its own
+ */
+static struct ldlm_bl_batch *ldlm_bl_batch_get(struct ldlm_lock *lock)
+{
+	struct ldlm_bl_batch_thread	*lbt = &ldlm_bl_batch_thread;
+	struct obd_export		*exp = lock->l_export;
+	struct ldlm_bl_batch		*batch;
+	struct ldlm_bl_batch		*new = NULL;
+	struct ldlm_bl_batch		*ready = NULL;
+	__u64				 flags;
+	bool				 wake = false;
+	ENTRY;
+
+	flags = lock->l_flags & LDLM_FL_AST_MASK;
+again:
+	spin_lock(&ldlm_bl_batch_lock);
+	batch = exp->exp_bl_batch;
+	if (batch != NULL && batch->lbb_flags != flags) {
+		if (ldlm_bl_batch_close(batch))
+			ready = batch;
+		batch = NULL;
+	}
+	if (batch == NULL && new != NULL) {
+		batch = new;
+		new = NULL;
+		batch->lbb_flags = flags;
+		batch->lbb_deadline = cfs_time_add(cfs_time_current(),
+				msecs_to_jiffies(ldlm_bl_batch_delay));
+		list_add_tail(&batch->lbb_list, &lbt->lbt_batches);
+		exp->exp_bl_batch = batch;
+		wake = true;
+	}
+	if (batch != NULL) {
+		batch->lbb_busy++;
+		if (batch->lbb_count + batch->lbb_busy == LDLM_BL_BATCH_MAX)
+			ldlm_bl_batch_close(batch);
+	}
+	spin_unlock(&ldlm_bl_batch_lock);
+
+	if (ready != NULL) {
+		ldlm_bl_batch_send(ready);
+		ready = NULL;
+	}
+
+	if (batch == NULL) {
+		OBD_ALLOC_LARGE(new, sizeof(*new));
+		if (new == NULL)
+			RETURN(NULL);
+		INIT_LIST_HEAD(&new->lbb_list);
+		new->lbb_exp = class_export_get(exp);
+		goto again;
+	}
+
+	if (new != NULL)
+		ldlm_bl_batch_free(new);
+	if (wake)
+		wake_up(&lbt->lbt_waitq);
+
+	RETURN(batch);
+}
+
+/**
+ * Fill the slot reserved in \a batch by ldlm_bl_batch_get() with \a lock and
+ * the descriptor \a desc of the lock it conflicts with, or just release the
+ * slot if \a lock is NULL. The batch is sent here if it is full.
+ */
+static void ldlm_bl_batch_put(struct ldlm_bl_batch *batch,
+			      struct ldlm_lock *lock,
+			      struct ldlm_lock_desc *desc)
+{
+	bool send;
+
+	spin_lock(&ldlm_bl_batch_lock);
+	if (lock != NULL) {
+		LASSERT(batch->lbb_count < LDLM_BL_BATCH_MAX);
+		batch->lbb_locks[batch->lbb_count] = LDLM_LOCK_GET(lock);
+		batch->lbb_descs[batch->lbb_count] = *desc;
+		batch->lbb_count++;
+	}
+	LASSERT(batch->lbb_busy > 0);
+	batch->lbb_busy--;
+	send = batch->lbb_closed && batch->lbb_busy == 0;
+	spin_unlock(&ldlm_bl_batch_lock);
+
+	if (send)
+		ldlm_bl_batch_send(batch);
+}
+
+/**
+ * Check whether ldlm_bl_batch_main() has something to do.
+ *
+ * \param[out] timeout	time until the next batch is due, 0 if none is open
+ */
+static bool ldlm_bl_batch_due(cfs_duration_t *timeout)
+{
+	struct ldlm_bl_batch_thread	*lbt = &ldlm_bl_batch_thread;
+	struct ldlm_bl_batch		*batch;
+	cfs_time_t			 now = cfs_time_current();
+	bool				 due = false;
+
+	*timeout = 0;
+	spin_lock(&ldlm_bl_batch_lock);
+	if (!list_empty(&lbt->lbt_reprocess))
+		due = true;
+	list_for_each_entry(batch, &lbt->lbt_batches, lbb_list) {
+		if (due)
+			break;
+		if (cfs_time_aftereq(now, batch->lbb_deadline))
+			due = true;
+		else if (*timeout == 0 ||
+			 cfs_time_sub(batch->lbb_deadline, now) < *timeout)
+			*timeout = cfs_time_sub(batch->lbb_deadline, now);
+	}
+	spin_unlock(&ldlm_bl_batch_lock);
+
+	return due;
+}
+
+/**
+ * Send the batched blocking ASTs whose gathering window is over, and
+ * reprocess the resources of locks cancelled by failed batched ASTs.
+ */
+static int ldlm_bl_batch_main(void *arg)
+{
+	struct ldlm_bl_batch_thread	*lbt = &ldlm_bl_batch_thread;
+	ENTRY;
+
+	lbt->lbt_state = ELT_READY;
+	wake_up(&lbt->lbt_waitq);
+
+	while (1) {
+		struct ldlm_bl_batch	*batch;
+		struct ldlm_bl_batch	*next;
+		struct ldlm_lock	*lock;
+		struct list_head	 ready;
+		struct list_head	 reprocess;
+		cfs_duration_t		 timeout;
+		cfs_time_t		 now;
+		bool			 stop;
+
+		if (!ldlm_bl_batch_due(&timeout) &&
+		    lbt->lbt_state != ELT_TERMINATE) {
+			struct l_wait_info lwi = LWI_TIMEOUT(timeout, NULL,
+							     NULL);
+
+			l_wait_event(lbt->lbt_waitq,
+				     ldlm_bl_batch_due(&timeout) ||
+				     lbt->lbt_state == ELT_TERMINATE, &lwi);
+		}
+		stop = lbt->lbt_state == ELT_TERMINATE;
+
+		INIT_LIST_HEAD(&ready);
+		INIT_LIST_HEAD(&reprocess);
+		now = cfs_time_current();
+		spin_lock(&ldlm_bl_batch_lock);
+		list_for_each_entry_safe(batch, next, &lbt->lbt_batches,
+					 lbb_list) {
+			if (!stop && cfs_time_before(now, batch->lbb_deadline))
+				continue;
+			/* otherwise the last ldlm_bl_batch_put() sends it */
+			if (ldlm_bl_batch_close(batch))
+				list_add_tail(&batch->lbb_list, &ready);
+		}
+		list_splice_init(&lbt->lbt_reprocess, &reprocess);
+		spin_unlock(&ldlm_bl_batch_lock);
+
+		list_for_each_entry_safe(batch, next, &ready, lbb_list) {
+			list_del_init(&batch->lbb_list);
+			ldlm_bl_batch_send(batch);
+		}
+
+		while (!list_empty(&reprocess)) {
+			lock = list_entry(reprocess.next, struct ldlm_lock,
+					  l_bl_ast);
+			lock_res_and_lock(lock);
+			list_del_init(&lock->l_bl_ast);
+			unlock_res_and_lock(lock);
+
+			ldlm_reprocess_all(lock->l_resource);
+			LDLM_LOCK_RELEASE(lock);
+		}
+
+		if (stop)
+			break;
+	}
+
+	lbt->lbt_state = ELT_STOPPED;
+	wake_up(&lbt->lbt_waitq);
+	RETURN(0);
+}
+
 /**
  * ->l_blocking_ast() method for server-side locks. This is invoked when newly
  * enqueued server lock conflicts with given one.
  *
  * Sends blocking AST RPC to the client owning that lock; arms timeout timer
- * to wait for client response.
+ * to wait for client response. If the client supports OBD_CONNECT2_BL_BATCH,
+ * the AST is instead added to the batch of that client, which is sent once
+ * ldlm_bl_batch_delay has passed or once it is full, so the ASTs caused by
+ * concurrent enqueues of other clients share one RPC.
  */
 int ldlm_server_blocking_ast(struct ldlm_lock *lock,
                              struct ldlm_lock_desc *desc,
@@ -842,8 +1279,9 @@ int ldlm_server_blocking_ast(struct ldlm_lock *lock,
 {
         struct ldlm_cb_async_args *ca;
         struct ldlm_cb_set_arg *arg = data;
+	struct ldlm_bl_batch   *batch = NULL;
         struct ldlm_request    *body;
-        struct ptlrpc_request  *req;
+	struct ptlrpc_request  *req = NULL;
         int                     instant_cancel = 0;
         int                     rc = 0;
         ENTRY;
@@ -859,24 +1297,36 @@ int ldlm_server_blocking_ast(struct ldlm_lock *lock,
 
         ldlm_lock_reorder_req(lock);
 
-        req = ptlrpc_request_alloc_pack(lock->l_export->exp_imp_reverse,
-                                        &RQF_LDLM_BL_CALLBACK,
-                                        LUSTRE_DLM_VERSION, LDLM_BL_CALLBACK);
-        if (req == NULL)
-                RETURN(-ENOMEM);
+	/* CANCEL_ON_BLOCK is set at enqueue time, such locks are cancelled
+	 * right when the AST is sent and are never batched */
+	if (exp_connect_bl_batch(lock->l_export) &&
+	    !ldlm_is_cancel_on_block(lock))
+		batch = ldlm_bl_batch_get(lock);
+
+	if (batch == NULL) {
+		req = ptlrpc_request_alloc_pack(
+					lock->l_export->exp_imp_reverse,
+					&RQF_LDLM_BL_CALLBACK,
+					LUSTRE_DLM_VERSION, LDLM_BL_CALLBACK);
+		if (req == NULL)
+			RETURN(-ENOMEM);
 
-        CLASSERT(sizeof(*ca) <= sizeof(req->rq_async_args));
-        ca = ptlrpc_req_async_args(req);
-        ca->ca_set_arg = arg;
-        ca->ca_lock = lock;
+		CLASSERT(sizeof(*ca) <= sizeof(req->rq_async_args));
+		ca = ptlrpc_req_async_args(req);
+		ca->ca_set_arg = arg;
+		ca->ca_lock = lock;
 
-        req->rq_interpret_reply = ldlm_cb_interpret;
+		req->rq_interpret_reply = ldlm_cb_interpret;
+	}
 
 	lock_res_and_lock(lock);
 	if (ldlm_is_destroyed(lock)) {
 		/* What's the point? */
 		unlock_res_and_lock(lock);
-		ptlrpc_req_finished(req);
+		if (req != NULL)
+			ptlrpc_req_finished(req);
+		else
+			ldlm_bl_batch_put(batch, NULL, NULL);
 		RETURN(0);
 	}
 
@@ -887,11 +1337,24 @@ int ldlm_server_blocking_ast(struct ldlm_lock *lock,
 		ldlm_set_waited(lock);
 		unlock_res_and_lock(lock);
 
-		ptlrpc_req_finished(req);
+		if (req != NULL)
+			ptlrpc_req_finished(req);
+		else
+			ldlm_bl_batch_put(batch, NULL, NULL);
 		LDLM_DEBUG(lock, "lock not granted, not sending blocking AST");
 		RETURN(0);
 	}
 
+	if (batch != NULL) {
+		ldlm_set_cbpending(lock);
+		ldlm_add_waiting_lock(lock);
+		unlock_res_and_lock(lock);
+
+		LDLM_DEBUG(lock, "server adding blocking AST to batch");
+		ldlm_bl_batch_put(batch, lock, desc);
+		GOTO(out_stats, rc = 0);
+	}
+
 	if (ldlm_is_cancel_on_block(lock))
                 instant_cancel = 1;
 
@@ -924,16 +1387,18 @@ int ldlm_server_blocking_ast(struct ldlm_lock *lock,
         if (AT_OFF)
                 req->rq_timeout = ldlm_get_rq_timeout();
 
+	rc = ldlm_ast_fini(req, arg, lock, instant_cancel);
+	EXIT;
+out_stats:
 	lock->l_last_activity = cfs_time_current_sec();
+	lock->l_wait_stamp = ktime_get();
 
         if (lock->l_export && lock->l_export->exp_nid_stats &&
             lock->l_export->exp_nid_stats->nid_ldlm_stats)
                 lprocfs_counter_incr(lock->l_export->exp_nid_stats->nid_ldlm_stats,
                                      LDLM_BL_CALLBACK - LDLM_FIRST_OPC);
 
-	rc = ldlm_ast_fini(req, arg, lock, instant_cancel);
-
-        RETURN(rc);
+	return rc;
 }
 
 /**
@@ -1029,6 +1494,7 @@ int ldlm_server_completion_ast(struct ldlm_lock *lock, __u64 flags, void *data)
         lock_res_and_lock(lock);
 	if (ldlm_is_ast_sent(lock)) {
 		body->lock_flags |= ldlm_flags_to_wire(LDLM_FL_AST_SENT);
+		lock->l_wait_stamp = ktime_get();
 		/* Copy AST flags like LDLM_FL_DISCARD_DATA. */
 		body->lock_flags |= ldlm_flags_to_wire(lock->l_flags &
 						       LDLM_FL_AST_MASK);
@@ -1203,6 +1669,319 @@ static void ldlm_svc_get_eopc(const struct ldlm_request *dlm_req,
         return;
 }
 
+/**
+ * Sanity check the type and mode of a lock a client asks to enqueue.
+ */
+static int ldlm_enqueue_desc_check(struct ptlrpc_request *req,
+				   const struct ldlm_lock_desc *desc)
+{
+	if (unlikely(desc->l_resource.lr_type < LDLM_MIN_TYPE ||
+		     desc->l_resource.lr_type >= LDLM_MAX_TYPE)) {
+		DEBUG_REQ(D_ERROR, req, "invalid lock request type %d",
+			  desc->l_resource.lr_type);
+		return -EFAULT;
+	}
+
+	if (unlikely(desc->l_req_mode <= LCK_MINMODE ||
+		     desc->l_req_mode >= LCK_MAXMODE ||
+		     desc->l_req_mode & (desc->l_req_mode - 1))) {
+		DEBUG_REQ(D_ERROR, req, "invalid lock request mode %d",
+			  desc->l_req_mode);
+		return -EFAULT;
+	}
+
+	if (exp_connect_flags(req->rq_export) & OBD_CONNECT_IBITS) {
+		if (unlikely(desc->l_resource.lr_type == LDLM_PLAIN)) {
+			DEBUG_REQ(D_ERROR, req,
+				  "PLAIN lock request from IBITS client?");
+			return -EPROTO;
+		}
+	} else if (unlikely(desc->l_resource.lr_type == LDLM_IBITS)) {
+		DEBUG_REQ(D_ERROR, req,
+			  "IBITS lock request from unaware client?");
+		return -EPROTO;
+	}
+
+	return 0;
+}
+
+/* Count a lock replayed during recovery, for recovery_status. */
+static inline void ldlm_replayed_lock_inc(struct obd_export *exp)
+{
+	struct obd_device *obd = exp->exp_obd;
+
+	if (obd->obd_recovering)
+		obd->obd_replayed_lock_count++;
+}
+
+/**
+ * Replay one lock of a batched lock replay, see ldlm_handle_replay_batch().
+ *
+ * This is the subset of ldlm_handle_enqueue0() a replayed lock without an
+ * intent goes through: no LVB is returned since the client ignores it on
+ * replay. The server handle of the lock is returned in \a handle.
+ *
+ * \retval 0 or a positive ldlm_error if the lock was replayed
+ * \retval negative errno if it was not
+ */
+static int ldlm_replay_one_lock(struct ldlm_namespace *ns,
+				struct ptlrpc_request *req,
+				struct ldlm_replay_desc *rd,
+				const struct ldlm_callback_suite *cbs,
+				struct lustre_handle *handle)
+{
+	struct obd_export *exp = req->rq_export;
+	struct ldlm_lock_desc *desc = &rd->lrd_desc;
+	enum ldlm_error err;
+	struct ldlm_lock *lock;
+	__u64 flags;
+	int rc;
+	ENTRY;
+
+	flags = ldlm_flags_from_wire(rd->lrd_flags) &
+		(LDLM_FL_REPLAY | LDLM_FL_BLOCK_GRANTED | LDLM_FL_BLOCK_CONV |
+		 LDLM_FL_BLOCK_WAIT);
+	if (!(flags & LDLM_FL_REPLAY))
+		RETURN(-EPROTO);
+
+	rc = ldlm_enqueue_desc_check(req, desc);
+	if (rc != 0)
+		RETURN(rc);
+
+	/* the batch may be a resend, the lock is replayed already then */
+	lock = cfs_hash_lookup(exp->exp_lock_hash, (void *)&rd->lrd_handle);
+	if (lock != NULL) {
+		LDLM_DEBUG(lock, "found existing replayed lock");
+		ldlm_lock2handle(lock, handle);
+		LDLM_LOCK_RELEASE(lock);
+		RETURN(0);
+	}
+
+	lock = ldlm_lock_create(ns, &desc->l_resource.lr_name,
+				desc->l_resource.lr_type, desc->l_req_mode,
+				cbs, NULL, 0, LVB_T_NONE);
+	if (IS_ERR(lock))
+		RETURN(PTR_ERR(lock));
+
+	lock->l_remote_handle = rd->lrd_handle;
+	LDLM_DEBUG(lock, "server-side batched replay, new lock created");
+
+	if (exp->exp_disconnected) {
+		LDLM_ERROR(lock, "lock on disconnected export %p", exp);
+		lock_res_and_lock(lock);
+		ldlm_resource_unlink_lock(lock);
+		ldlm_lock_destroy_nolock(lock);
+		unlock_res_and_lock(lock);
+		LDLM_LOCK_RELEASE(lock);
+		RETURN(-ENOTCONN);
+	}
+
+	lock->l_export = class_export_lock_get(exp, lock);
+	if (exp->exp_lock_hash)
+		cfs_hash_add(exp->exp_lock_hash, &lock->l_remote_handle,
+			     &lock->l_exp_hash);
+
+	if (desc->l_resource.lr_type != LDLM_PLAIN)
+		ldlm_convert_policy_to_local(exp, desc->l_resource.lr_type,
+					     &desc->l_policy_data,
+					     &lock->l_policy_data);
+	if (desc->l_resource.lr_type == LDLM_EXTENT)
+		lock->l_req_extent = lock->l_policy_data.l_extent;
+
+	err = ldlm_lock_enqueue(ns, &lock, NULL, &flags);
+	if ((int)err < 0)
+		GOTO(out, rc = (int)err);
+
+	ldlm_lock2handle(lock, handle);
+
+	lock_res_and_lock(lock);
+	lock->l_flags |= flags & LDLM_FL_INHERIT_MASK;
+	if (unlikely(exp->exp_disconnected)) {
+		LDLM_ERROR(lock, "lock on destroyed export %p", exp);
+		rc = -ENOTCONN;
+	} else if (ldlm_is_ast_sent(lock) &&
+		   lock->l_granted_mode == lock->l_req_mode) {
+		ldlm_add_waiting_lock(lock);
+	}
+	unlock_res_and_lock(lock);
+
+	EXIT;
+out:
+	if (rc != 0)
+		ldlm_lock_cancel(lock);
+	else if (!err && desc->l_resource.lr_type != LDLM_FLOCK)
+		ldlm_reprocess_all(lock->l_resource);
+
+	if (rc == 0 && !err)
+		ldlm_replayed_lock_inc(exp);
+
+	LDLM_LOCK_RELEASE(lock);
+	return rc ?: err;
+}
+
+/**
+ * Server side handler of a batched lock replay.
+ *
+ * A client which negotiated OBD_CONNECT2_LOCK_REPLAY_BATCH replays up to
+ * LDLM_REPLAY_BATCH_MAX locks in one LDLM_ENQUEUE, the ldlm_request carries
+ * the lock count and each lock comes with its own ldlm_replay_desc. Every
+ * lock gets a ldlm_replay_rep in the reply with its server handle and
+ * status, so one bad lock does not fail the whole batch.
+ */
+static int ldlm_handle_replay_batch(struct ldlm_namespace *ns,
+				    struct ptlrpc_request *req,
+				    const struct ldlm_request *dlm_req,
+				    const struct ldlm_callback_suite *cbs)
+{
+	struct ldlm_replay_desc *descs;
+	struct ldlm_replay_rep *reps;
+	int count = dlm_req->lock_count;
+	int i;
+	int rc;
+	ENTRY;
+
+	LDLM_DEBUG_NOLOCK("server-side batched replay of %d locks", count);
+
+	if (count <= 0 || count > LDLM_REPLAY_BATCH_MAX) {
+		DEBUG_REQ(D_ERROR, req, "invalid replay batch size %d", count);
+		GOTO(out, rc = -EPROTO);
+	}
+
+	req_capsule_extend(&req->rq_pill, &RQF_LDLM_ENQUEUE_REPLAY_BATCH);
+	descs = req_capsule_client_sized_get(&req->rq_pill,
+					     &RMF_DLM_REPLAY_DESC,
+					     count * sizeof(*descs));
+	if (descs == NULL)
+		GOTO(out, rc = -EPROTO);
+
+	req_capsule_set_size(&req->rq_pill, &RMF_DLM_REPLAY_REP, RCL_SERVER,
+			     count * sizeof(*reps));
+	rc = req_capsule_server_pack(&req->rq_pill);
+	if (rc != 0)
+		GOTO(out, rc);
+
+	reps = req_capsule_server_get(&req->rq_pill, &RMF_DLM_REPLAY_REP);
+	for (i = 0; i < count; i++) {
+		rc = ldlm_replay_one_lock(ns, req, &descs[i], cbs,
+					  &reps[i].lrp_handle);
+		reps[i].lrp_status = ptlrpc_status_hton(rc);
+		if (rc < 0)
+			CDEBUG(D_DLMTRACE, "%s: replay of lock "LPX64
+			       " failed: rc = %d\n", ns->ns_name,
+			       descs[i].lrd_handle.cookie, rc);
+	}
+	rc = 0;
+	EXIT;
+out:
+	req->rq_status = rc;
+	if (!req->rq_packed_final) {
+		int err = lustre_pack_reply(req, 1, NULL, NULL);
+
+		if (rc == 0)
+			rc = err;
+	}
+	return rc;
+}
+
+/**
+ * Grant a lock on behalf of a client without a LDLM_ENQUEUE of its own.
+ *
+ * Used by requests which return locks along with their reply, such as a
+ * batched getattr: the client allocated the lock and sent \a remote, the
+ * lock is taken with LDLM_FL_BLOCK_NOWAIT so that a conflict never holds the
+ * service thread, the caller just does not return the lock then.
+ *
+ * \param[in] ns	namespace of the lock
+ * \param[in] req	request the lock comes with
+ * \param[in] res_id	resource to lock
+ * \param[in] mode	lock mode
+ * \param[in] bits	inodebits to lock
+ * \param[in] remote	client handle of the lock
+ * \param[in] cbs	server callbacks of the lock
+ * \param[out] handle	server handle of the granted lock
+ *
+ * \retval 0 if the lock was granted
+ * \retval -EWOULDBLOCK if it conflicts with another lock
+ * \retval negative errno on other errors
+ */
+int ldlm_grant_remote_ibits_lock(struct ldlm_namespace *ns,
+				 struct ptlrpc_request *req,
+				 const struct ldlm_res_id *res_id,
+				 enum ldlm_mode mode, __u64 bits,
+				 const struct lustre_handle *remote,
+				 const struct ldlm_callback_suite *cbs,
+				 struct lustre_handle *handle)
+{
+	struct obd_export *exp = req->rq_export;
+	struct ldlm_lock *lock;
+	enum ldlm_error err;
+	__u64 flags = LDLM_FL_BLOCK_NOWAIT;
+	int rc = 0;
+	ENTRY;
+
+	/* the request may be a resend, the lock is granted already then */
+	if (lustre_msg_get_flags(req->rq_reqmsg) & MSG_RESENT) {
+		lock = cfs_hash_lookup(exp->exp_lock_hash, (void *)remote);
+		if (lock != NULL) {
+			LDLM_DEBUG(lock, "found existing remote lock");
+			ldlm_lock2handle(lock, handle);
+			LDLM_LOCK_RELEASE(lock);
+			RETURN(0);
+		}
+	}
+
+	if (ldlm_reclaim_full())
+		RETURN(-EWOULDBLOCK);
+
+	lock = ldlm_lock_create(ns, res_id, LDLM_IBITS, mode, cbs, NULL, 0,
+				LVB_T_NONE);
+	if (IS_ERR(lock))
+		RETURN(PTR_ERR(lock));
+
+	lock->l_remote_handle = *remote;
+	lock->l_policy_data.l_inodebits.bits = bits;
+	LDLM_DEBUG(lock, "server-side remote lock created");
+
+	if (exp->exp_disconnected) {
+		LDLM_ERROR(lock, "lock on disconnected export %p", exp);
+		lock_res_and_lock(lock);
+		ldlm_resource_unlink_lock(lock);
+		ldlm_lock_destroy_nolock(lock);
+		unlock_res_and_lock(lock);
+		LDLM_LOCK_RELEASE(lock);
+		RETURN(-ENOTCONN);
+	}
+
+	lock->l_export = class_export_lock_get(exp, lock);
+	if (exp->exp_lock_hash)
+		cfs_hash_add(exp->exp_lock_hash, &lock->l_remote_handle,
+			     &lock->l_exp_hash);
+
+	err = ldlm_lock_enqueue(ns, &lock, NULL, &flags);
+	if ((int)err < 0)
+		GOTO(out, rc = (int)err);
+	if (err == ELDLM_LOCK_WOULDBLOCK ||
+	    lock->l_granted_mode != lock->l_req_mode)
+		GOTO(out, rc = -EWOULDBLOCK);
+
+	ldlm_lock2handle(lock, handle);
+
+	lock_res_and_lock(lock);
+	if (unlikely(exp->exp_disconnected)) {
+		LDLM_ERROR(lock, "lock on destroyed export %p", exp);
+		rc = -ENOTCONN;
+	}
+	unlock_res_and_lock(lock);
+
+	EXIT;
+out:
+	if (rc != 0)
+		ldlm_lock_cancel(lock);
+	LDLM_LOCK_RELEASE(lock);
+	return rc;
+}
+EXPORT_SYMBOL(ldlm_grant_remote_ibits_lock);
+
 /**
  * Main server-side entry point into LDLM for enqueue. This is called by ptlrpc
  * service threads to carry out client lock enqueueing requests.
@@ -1223,6 +2002,14 @@ int ldlm_handle_enqueue0(struct ldlm_namespace *ns,
 
 	LDLM_DEBUG_NOLOCK("server-side enqueue handler START");
 
+	/* A batched lock replay reuses lock_count for the number of locks it
+	 * carries, so it must not go through the early cancel below. */
+	if (unlikely(dlm_req->lock_flags & LDLM_FL_REPLAY) &&
+	    lustre_msg_bufcount(req->rq_reqmsg) > DLM_LOCKREQ_OFF + 1 &&
+	    !(dlm_req->lock_flags & LDLM_FL_HAS_INTENT) &&
+	    exp_connect_lock_replay_batch(req->rq_export))
+		RETURN(ldlm_handle_replay_batch(ns, req, dlm_req, cbs));
+
 	ldlm_request_cancel(req, dlm_req, LDLM_ENQUEUE_CANCEL_OFF, LATF_SKIP);
 	flags = ldlm_flags_from_wire(dlm_req->lock_flags);
 
@@ -1236,35 +2023,9 @@ int ldlm_handle_enqueue0(struct ldlm_namespace *ns,
                 lprocfs_counter_incr(req->rq_export->exp_nid_stats->nid_ldlm_stats,
                                      LDLM_ENQUEUE - LDLM_FIRST_OPC);
 
-        if (unlikely(dlm_req->lock_desc.l_resource.lr_type < LDLM_MIN_TYPE ||
-                     dlm_req->lock_desc.l_resource.lr_type >= LDLM_MAX_TYPE)) {
-                DEBUG_REQ(D_ERROR, req, "invalid lock request type %d",
-                          dlm_req->lock_desc.l_resource.lr_type);
-                GOTO(out, rc = -EFAULT);
-        }
-
-        if (unlikely(dlm_req->lock_desc.l_req_mode <= LCK_MINMODE ||
-                     dlm_req->lock_desc.l_req_mode >= LCK_MAXMODE ||
-                     dlm_req->lock_desc.l_req_mode &
-                     (dlm_req->lock_desc.l_req_mode-1))) {
-                DEBUG_REQ(D_ERROR, req, "invalid lock request mode %d",
-                          dlm_req->lock_desc.l_req_mode);
-                GOTO(out, rc = -EFAULT);
-        }
-
-	if (exp_connect_flags(req->rq_export) & OBD_CONNECT_IBITS) {
-                if (unlikely(dlm_req->lock_desc.l_resource.lr_type ==
-                             LDLM_PLAIN)) {
-                        DEBUG_REQ(D_ERROR, req,
-                                  "PLAIN lock request from IBITS client?");
-                        GOTO(out, rc = -EPROTO);
-                }
-        } else if (unlikely(dlm_req->lock_desc.l_resource.lr_type ==
-                            LDLM_IBITS)) {
-                DEBUG_REQ(D_ERROR, req,
-                          "IBITS lock request from unaware client?");
-                GOTO(out, rc = -EPROTO);
-        }
+	rc = ldlm_enqueue_desc_check(req, &dlm_req->lock_desc);
+	if (rc != 0)
+		GOTO(out, rc);
 
 #if 0
         /* FIXME this makes it impossible to use LDLM_PLAIN locks -- check
@@ -1320,9 +2081,6 @@ int ldlm_handle_enqueue0(struct ldlm_namespace *ns,
         lock->l_remote_handle = dlm_req->lock_handle[0];
         LDLM_DEBUG(lock, "server-side enqueue handler, new lock created");
 
-	lock->l_cc = dlm_req->lock_desc.l_cc;
-	printk("ldlm_handle_enqueue0(): lock->l_cc = %d\n", lock->l_cc);
-
 	/* Initialize resource lvb but not for a lock being replayed since
 	 * Client already got lvb sent in this case.
 	 * This must occur early since some policy methods assume resource
@@ -1412,10 +2170,6 @@ existing_lock:
 	dlm_rep->lock_flags = ldlm_flags_to_wire(flags);
 	lock->l_flags |= flags & LDLM_FL_INHERIT_MASK;
 
-	/* ziqi: set l_cc in the reply lock to client */
-	dlm_rep->lock_desc.l_cc = 233;
-	printk("ldlm_handle_enqueue0(): dlm_rep->lock_desc.l_cc = %d\n", dlm_rep->lock_desc.l_cc);
-
         /* Don't move a pending lock onto the export if it has already been
          * disconnected due to eviction (bug 5683) or server umount (bug 24324).
          * Cancel it now instead. */
@@ -1538,6 +2292,10 @@ existing_lock:
                 if (!err && dlm_req->lock_desc.l_resource.lr_type != LDLM_FLOCK)
                         ldlm_reprocess_all(lock->l_resource);
 
+		if (rc == 0 && !err && (flags & LDLM_FL_REPLAY) &&
+		    !(flags & LDLM_FL_RESENT))
+			ldlm_replayed_lock_inc(req->rq_export);
+
                 LDLM_LOCK_RELEASE(lock);
         }
 
@@ -1599,6 +2357,31 @@ int ldlm_handle_convert0(struct ptlrpc_request *req,
         lock = ldlm_handle2lock(&dlm_req->lock_handle[0]);
         if (!lock) {
 		req->rq_status = LUSTRE_EINVAL;
+	} else if (lock->l_resource->lr_type == LDLM_IBITS &&
+		   dlm_req->lock_desc.l_resource.lr_type == LDLM_IBITS &&
+		   exp_connect_lock_convert(req->rq_export)) {
+		/* Client dropped some inodebits in reply to a blocking AST
+		 * and keeps the lock for the rest. */
+		LDLM_DEBUG(lock, "server-side ibits convert handler START");
+
+		rc = ldlm_inodebits_convert(lock,
+			dlm_req->lock_desc.l_policy_data.l_inodebits.bits);
+		switch (rc) {
+		case 0:
+			if (ldlm_del_waiting_lock(lock))
+				LDLM_DEBUG(lock, "converted waiting lock");
+			req->rq_status = 0;
+			break;
+		case -EAGAIN:
+			req->rq_status = LUSTRE_EAGAIN;
+			break;
+		case -EPROTO:
+			req->rq_status = LUSTRE_EPROTO;
+			break;
+		default:
+			req->rq_status = LUSTRE_EINVAL;
+			break;
+		}
         } else {
                 void *res = NULL;
 
@@ -1645,6 +2428,23 @@ int ldlm_handle_convert(struct ptlrpc_request *req)
         return rc;
 }
 
+/**
+ * Lock wait profiler: account how long the client took to cancel \a lock
+ * after a blocking AST was sent for it.
+ */
+static void ldlm_bl_ast_account(struct ldlm_lock *lock)
+{
+	struct nid_stat *stats = lock->l_export->exp_nid_stats;
+	__u64 delay;
+
+	if (stats == NULL || ktime_to_ns(lock->l_wait_stamp) == 0)
+		return;
+
+	delay = ktime_to_us(ktime_sub(ktime_get(), lock->l_wait_stamp));
+	lprocfs_oh_tally_log2(&stats->nid_bl_ast_hist,
+			      min_t(__u64, delay, UINT_MAX));
+}
+
 /**
  * Cancel all the locks whose handles are packed into ldlm_request
  *
@@ -1710,6 +2510,7 @@ int ldlm_request_cancel(struct ptlrpc_request *req,
 			LDLM_DEBUG(lock, "server cancels blocked lock after "
 				   CFS_DURATION_T"s", delay);
 			at_measured(&lock->l_export->exp_bl_lock_at, delay);
+			ldlm_bl_ast_account(lock);
 		}
                 ldlm_lock_cancel(lock);
                 LDLM_LOCK_PUT(lock);
@@ -2156,7 +2957,142 @@ static inline void ldlm_callback_errmsg(struct ptlrpc_request *req,
                 CWARN("Send reply failed, maybe cause bug 21636.\n");
 }
 
+/**
+ * Handle a blocking callback carrying the locks of a batch gathered by
+ * a server for which OBD_CONNECT2_BL_BATCH was negotiated, with the
+ * descriptor of the conflicting lock of each of them in RMF_DLM_BL_DESC.
+ *
+ * The status of each lock is returned in RMF_RCS, -EINVAL telling the server
+ * the lock is already gone. Unused locks which have to go as a whole are
+ * then cancelled together by a blocking thread, so one LDLM_CANCEL RPC
+ * answers the batch. The others, still in use or which may only drop some
+ * inodebits, each get their own blocking callback.
+ */
+static int ldlm_handle_bl_callback_batch(struct ptlrpc_request *req,
+					 struct ldlm_namespace *ns,
+					 struct ldlm_request *dlm_req)
+{
+	struct list_head	 cancels = LIST_HEAD_INIT(cancels);
+	struct ldlm_lock_desc	*descs;
+	struct ldlm_lock	**locks;
+	__u32			*rcs;
+	int			 count = dlm_req->lock_count;
+	int			 ncancels = 0;
+	int			 i;
+	int			 rc;
+	ENTRY;
+
+	descs = req_capsule_client_get(&req->rq_pill, &RMF_DLM_BL_DESC);
+	if (count == 0 || count > LDLM_BL_BATCH_MAX || descs == NULL ||
+	    req_capsule_get_size(&req->rq_pill, &RMF_DLM_REQ, RCL_CLIENT) <
+	    ldlm_request_bufsize(count, LDLM_BL_CALLBACK) ||
+	    req_capsule_get_size(&req->rq_pill, &RMF_DLM_BL_DESC, RCL_CLIENT) <
+	    count * sizeof(*descs)) {
+		rc = ldlm_callback_reply(req, -EPROTO);
+		ldlm_callback_errmsg(req, "Operate with bad lock count", rc,
+				     &dlm_req->lock_handle[0]);
+		RETURN(0);
+	}
+
+	OBD_ALLOC(locks, count * sizeof(*locks));
+	if (locks == NULL) {
+		rc = ldlm_callback_reply(req, -ENOMEM);
+		ldlm_callback_errmsg(req, "Operate without memory", rc,
+				     &dlm_req->lock_handle[0]);
+		RETURN(0);
+	}
+
+	req_capsule_set_size(&req->rq_pill, &RMF_RCS, RCL_SERVER,
+			     count * sizeof(*rcs));
+	rc = req_capsule_server_pack(&req->rq_pill);
+	if (rc != 0) {
+		rc = ldlm_callback_reply(req, rc);
+		ldlm_callback_errmsg(req, "Cannot pack reply", rc,
+				     &dlm_req->lock_handle[0]);
+		GOTO(out, rc = 0);
+	}
+	rcs = req_capsule_server_get(&req->rq_pill, &RMF_RCS);
+
+	for (i = 0; i < count; i++) {
+		struct ldlm_lock *lock;
+		__u64 bits;
+
+		rcs[i] = 0;
+		lock = ldlm_handle2lock_long(&dlm_req->lock_handle[i], 0);
+		if (lock == NULL) {
+			CDEBUG(D_DLMTRACE, "callback on lock "LPX64" - lock "
+			       "disappeared\n", dlm_req->lock_handle[i].cookie);
+			rcs[i] = ptlrpc_status_hton(-EINVAL);
+			continue;
+		}
+
+		/* same as the single lock case in ldlm_callback_handler() */
+		lock_res_and_lock(lock);
+		lock->l_flags |= ldlm_flags_from_wire(dlm_req->lock_flags &
+						      LDLM_FL_AST_MASK);
+		if ((ldlm_is_canceling(lock) && ldlm_is_bl_done(lock)) ||
+		    ldlm_is_failed(lock)) {
+			LDLM_DEBUG(lock, "callback on lock "
+				   LPX64" - lock disappeared\n",
+				   dlm_req->lock_handle[i].cookie);
+			unlock_res_and_lock(lock);
+			LDLM_LOCK_RELEASE(lock);
+			rcs[i] = ptlrpc_status_hton(-EINVAL);
+			continue;
+		}
+		ldlm_lock_remove_from_lru(lock);
+		ldlm_set_bl_ast(lock);
+
+		/* Bits not shared with the conflicting lock may be kept by
+		 * the blocking callback, see ldlm_cli_dropbits(). */
+		bits = 0;
+		if (lock->l_resource->lr_type == LDLM_IBITS)
+			bits = lock->l_policy_data.l_inodebits.bits &
+			       ~descs[i].l_policy_data.l_inodebits.bits;
+
+		if (lock->l_readers == 0 && lock->l_writers == 0 &&
+		    bits == 0 && !ldlm_is_canceling(lock) &&
+		    !ldlm_is_cancel_on_block(lock)) {
+			/* See CBPENDING comment in ldlm_cancel_lru */
+			lock->l_flags |= LDLM_FL_CBPENDING |
+					 LDLM_FL_CANCELING;
+			LASSERT(list_empty(&lock->l_bl_ast));
+			list_add_tail(&lock->l_bl_ast, &cancels);
+			ncancels++;
+		} else {
+			locks[i] = lock;
+		}
+		unlock_res_and_lock(lock);
+	}
+
+	rc = ldlm_callback_reply(req, 0);
+	if (req->rq_no_reply || rc)
+		ldlm_callback_errmsg(req, "Normal process", rc,
+				     &dlm_req->lock_handle[0]);
+
+	CDEBUG(D_DLMTRACE, "blocking AST for %d locks, %d cancelled at once\n",
+	       count, ncancels);
+	if (ncancels > 0 &&
+	    ldlm_bl_to_thread_list(ns, NULL, &cancels, ncancels, LCF_ASYNC)) {
+		ncancels = ldlm_cli_cancel_list_local(&cancels, ncancels,
+						      LCF_BL_AST);
+		ldlm_cli_cancel_list(&cancels, ncancels, NULL, LCF_BL_AST);
+	}
+
+	for (i = 0; i < count; i++) {
+		if (locks[i] == NULL)
+			continue;
+		if (ldlm_bl_to_thread_lock(ns, &descs[i], locks[i]))
+			ldlm_handle_bl_callback(ns, &descs[i], locks[i]);
+	}
+	EXIT;
+out:
+	OBD_FREE(locks, count * sizeof(*locks));
+	return 0;
+}
+
 /* TODO: handle requests in a similar way as MDT: see mdt_handle_common() */
+
 static int ldlm_callback_handler(struct ptlrpc_request *req)
 {
         struct ldlm_namespace *ns;
@@ -2264,6 +3200,16 @@ static int ldlm_callback_handler(struct ptlrpc_request *req)
                         CERROR("ldlm_cli_cancel: %d\n", rc);
         }
 
+	if (lustre_msg_get_opc(req->rq_reqmsg) == LDLM_BL_CALLBACK) {
+		req_capsule_extend(&req->rq_pill, &RQF_LDLM_BL_CALLBACK_BATCH);
+		if (req_capsule_field_present(&req->rq_pill, &RMF_DLM_BL_DESC,
+					      RCL_CLIENT)) {
+			CDEBUG(D_INODE, "blocking ast for %u locks\n",
+			       dlm_req->lock_count);
+			RETURN(ldlm_handle_bl_callback_batch(req, ns, dlm_req));
+		}
+	}
+
         lock = ldlm_handle2lock_long(&dlm_req->lock_handle[0], 0);
         if (!lock) {
                 CDEBUG(D_DLMTRACE, "callback on lock "LPX64" - lock "
@@ -2400,6 +3346,15 @@ static int ldlm_cancel_handler(struct ptlrpc_request *req)
                 if (rc)
                         break;
                 RETURN(0);
+	/* IBITS convert is the answer to a blocking AST, so it must not
+	 * queue up behind enqueues waiting for the very same lock. */
+	case LDLM_CONVERT:
+		req_capsule_set(&req->rq_pill, &RQF_LDLM_CONVERT);
+		CDEBUG(D_INODE, "convert\n");
+		rc = ldlm_handle_convert(req);
+		if (rc)
+			break;
+		RETURN(0);
         default:
                 CERROR("invalid opcode %d\n",
                        lustre_msg_get_opc(req->rq_reqmsg));
@@ -2890,7 +3845,6 @@ static struct cfs_hash_ops ldlm_export_lock_ops = {
 
 int ldlm_init_export(struct obd_export *exp)
 {
-	int rc;
         ENTRY;
 
         exp->exp_lock_hash =
@@ -2906,14 +3860,7 @@ int ldlm_init_export(struct obd_export *exp)
         if (!exp->exp_lock_hash)
                 RETURN(-ENOMEM);
 
-	rc = ldlm_init_flock_export(exp);
-	if (rc)
-		GOTO(err, rc);
-
         RETURN(0);
-err:
-	ldlm_destroy_export(exp);
-	RETURN(rc);
 }
 EXPORT_SYMBOL(ldlm_init_export);
 
@@ -2922,8 +3869,6 @@ void ldlm_destroy_export(struct obd_export *exp)
         ENTRY;
         cfs_hash_putref(exp->exp_lock_hash);
         exp->exp_lock_hash = NULL;
-
-	ldlm_destroy_flock_export(exp);
         EXIT;
 }
 EXPORT_SYMBOL(ldlm_destroy_export);
@@ -3080,6 +4025,23 @@ static int ldlm_setup(void)
 
 	wait_event(expired_lock_thread.elt_waitq,
 		       expired_lock_thread.elt_state == ELT_READY);
+
+	INIT_LIST_HEAD(&ldlm_bl_batch_thread.lbt_batches);
+	INIT_LIST_HEAD(&ldlm_bl_batch_thread.lbt_reprocess);
+	ldlm_bl_batch_thread.lbt_state = ELT_STOPPED;
+	init_waitqueue_head(&ldlm_bl_batch_thread.lbt_waitq);
+	spin_lock_init(&ldlm_bl_batch_lock);
+
+	task = kthread_run(ldlm_bl_batch_main, NULL, "ldlm_bl_batch");
+	if (IS_ERR(task)) {
+		rc = PTR_ERR(task);
+		CERROR("Cannot start ldlm blocking AST batch thread: rc = %d\n",
+		       rc);
+		GOTO(out, rc);
+	}
+
+	wait_event(ldlm_bl_batch_thread.lbt_waitq,
+		   ldlm_bl_batch_thread.lbt_state == ELT_READY);
 #endif /* HAVE_SERVER_SUPPORT */
 
 	rc = ldlm_pools_init();
@@ -3150,6 +4112,13 @@ static int ldlm_cleanup(void)
 		wait_event(expired_lock_thread.elt_waitq,
 			       expired_lock_thread.elt_state == ELT_STOPPED);
 	}
+
+	if (ldlm_bl_batch_thread.lbt_state != ELT_STOPPED) {
+		ldlm_bl_batch_thread.lbt_state = ELT_TERMINATE;
+		wake_up(&ldlm_bl_batch_thread.lbt_waitq);
+		wait_event(ldlm_bl_batch_thread.lbt_waitq,
+			   ldlm_bl_batch_thread.lbt_state == ELT_STOPPED);
+	}
 #endif
 
         OBD_FREE(ldlm_state, sizeof(*ldlm_state));
@@ -3192,11 +4161,19 @@ int ldlm_init(void)
 	if (ldlm_interval_tree_slab == NULL)
 		goto out_interval;
 
+	ldlm_ibits_queues_slab = kmem_cache_create("ldlm_ibits_queues",
+			sizeof(struct ldlm_ibits_queues),
+			0, SLAB_HWCACHE_ALIGN, NULL);
+	if (ldlm_ibits_queues_slab == NULL)
+		goto out_interval_tree;
+
 #if LUSTRE_TRACKS_LOCK_EXP_REFS
 	class_export_dump_hook = ldlm_dump_export_locks;
 #endif
 	return 0;
 
+out_interval_tree:
+	kmem_cache_destroy(ldlm_interval_tree_slab);
 out_interval:
 	kmem_cache_destroy(ldlm_interval_slab);
 out_lock:
@@ -3219,4 +4196,5 @@ void ldlm_exit(void)
 	kmem_cache_destroy(ldlm_lock_slab);
 	kmem_cache_destroy(ldlm_interval_slab);
 	kmem_cache_destroy(ldlm_interval_tree_slab);
+	kmem_cache_destroy(ldlm_ibits_queues_slab);
 }
@@ -63,20 +63,46 @@ __u64 ldlm_lock_limit_mb;
 
 struct percpu_counter		ldlm_granted_total;
 static atomic_t			ldlm_nr_reclaimer;
-static cfs_duration_t		ldlm_last_reclaim_age;
-static cfs_time_t		ldlm_last_reclaim_time;
-
-struct ldlm_reclaim_cb_data {
-	struct list_head	 rcd_rpc_list;
-	int			 rcd_added;
-	int			 rcd_total;
-	int			 rcd_cursor;
-	int			 rcd_start;
-	bool			 rcd_skip;
-	cfs_duration_t		 rcd_age;
-	struct cfs_hash_bd	*rcd_prev_bd;
+
+/*
+ * Every reclaimable lock granted to a client is kept on the
+ * exp_reclaim_list of its export in grant order, so the oldest locks of
+ * an export are always at the list head, and is counted by grant epoch in
+ * the age histogram of its namespace. A reclaim pass uses the histogram to
+ * find the lock age it has to revoke down to, then takes the oldest locks
+ * of the heaviest exports. This costs O(victims) plus a pass over the
+ * exports of the namespace, where the former walk over all the resources
+ * of the namespace had to look at every granted lock.
+ *
+ * Lock order: res lock or obd_dev_lock -> exp_reclaim_lock ->
+ * ns_reclaim_lock.
+ */
+
+#define LDLM_RECLAIM_BATCH	512
+#define LDLM_RECLAIM_AGE_MIN	cfs_time_seconds(300)
+/* width of an epoch of the lock age histogram */
+#define LDLM_RECLAIM_EPOCH	LDLM_RECLAIM_AGE_MIN
+/* number of heaviest exports victims are taken from first */
+#define LDLM_RECLAIM_EXPORTS	8
+
+/* Serialized by ldlm_nr_reclaimer, read without locking. */
+struct ldlm_reclaim_stats {
+	__u64	rs_runs;
+	__u64	rs_victims;
+	/* exports victims were taken from, over all passes */
+	__u64	rs_exports;
+	/* reclaim pass duration in usec */
+	__u64	rs_time_last;
+	__u64	rs_time_max;
+	__u64	rs_time_total;
+	/* victims by age in epochs, the last one counts older ones */
+	__u64	rs_age[LDLM_RECLAIM_HIST_BUCKETS + 1];
 };
 
+static struct ldlm_reclaim_stats	ldlm_reclaim_stats;
+/* victims of the running pass, one pass runs at a time */
+static struct ldlm_lock		**ldlm_reclaim_victims;
+
 static inline bool ldlm_lock_reclaimable(struct ldlm_lock *lock)
 {
 	struct ldlm_namespace *ns = ldlm_lock_to_ns(lock);
@@ -92,95 +118,216 @@ static inline bool ldlm_lock_reclaimable(struct ldlm_lock *lock)
 	return false;
 }
 
+static inline unsigned long ldlm_reclaim_epoch(cfs_time_t time)
+{
+	return time / LDLM_RECLAIM_EPOCH;
+}
+
+/* Count a lock granted at \a time in the age histogram of \a ns. */
+static void ldlm_reclaim_hist_add(struct ldlm_namespace *ns, cfs_time_t time)
+{
+	unsigned long epoch = ldlm_reclaim_epoch(time);
+	struct ldlm_age_bucket *lab;
+
+	lab = &ns->ns_reclaim_hist[epoch % LDLM_RECLAIM_HIST_BUCKETS];
+	spin_lock(&ns->ns_reclaim_lock);
+	if (lab->lab_epoch != epoch) {
+		/* the ring wrapped, the locks the bucket counted are older
+		 * than it covers now */
+		ns->ns_reclaim_older += lab->lab_count;
+		lab->lab_epoch = epoch;
+		lab->lab_count = 0;
+	}
+	lab->lab_count++;
+	spin_unlock(&ns->ns_reclaim_lock);
+}
+
+static void ldlm_reclaim_hist_del(struct ldlm_namespace *ns, cfs_time_t time)
+{
+	unsigned long epoch = ldlm_reclaim_epoch(time);
+	struct ldlm_age_bucket *lab;
+
+	lab = &ns->ns_reclaim_hist[epoch % LDLM_RECLAIM_HIST_BUCKETS];
+	spin_lock(&ns->ns_reclaim_lock);
+	if (lab->lab_epoch == epoch) {
+		LASSERT(lab->lab_count > 0);
+		lab->lab_count--;
+	} else {
+		LASSERT(ns->ns_reclaim_older > 0);
+		ns->ns_reclaim_older--;
+	}
+	spin_unlock(&ns->ns_reclaim_lock);
+}
+
 /**
- * Callback function for revoking locks from certain resource.
- *
- * \param [in] hs	ns_rs_hash
- * \param [in] bd	current bucket of ns_rsh_hash
- * \param [in] hnode	hnode of the resource
- * \param [in] arg	opaque data
+ * Snapshot of the age histogram of \a ns.
  *
- * \retval 0		continue the scan
- * \retval 1		stop the iteration
+ * \param[out] hist	hist[i] is the number of reclaimable locks granted
+ *			i epochs ago, hist[LDLM_RECLAIM_HIST_BUCKETS] the
+ *			number of older ones
  */
-static int ldlm_reclaim_lock_cb(struct cfs_hash *hs, struct cfs_hash_bd *bd,
-				struct hlist_node *hnode, void *arg)
-
+void ldlm_reclaim_hist_get(struct ldlm_namespace *ns, __u64 *hist)
 {
-	struct ldlm_resource		*res;
-	struct ldlm_reclaim_cb_data	*data;
-	struct ldlm_lock		*lock;
-	struct ldlm_ns_bucket		*nsb;
-	int				 rc = 0;
-
-	data = (struct ldlm_reclaim_cb_data *)arg;
-
-	LASSERTF(data->rcd_added < data->rcd_total, "added:%d >= total:%d\n",
-		 data->rcd_added, data->rcd_total);
-
-	nsb = cfs_hash_bd_extra_get(hs, bd);
-	res = cfs_hash_object(hs, hnode);
-
-	if (data->rcd_prev_bd != bd) {
-		if (data->rcd_prev_bd != NULL)
-			ldlm_res_to_ns(res)->ns_reclaim_start++;
-		data->rcd_prev_bd = bd;
-		data->rcd_cursor = 0;
-		data->rcd_start = nsb->nsb_reclaim_start %
-				  cfs_hash_bd_count_get(bd);
+	unsigned long now = ldlm_reclaim_epoch(cfs_time_current());
+	struct ldlm_age_bucket *lab;
+	int i;
+
+	spin_lock(&ns->ns_reclaim_lock);
+	hist[LDLM_RECLAIM_HIST_BUCKETS] = ns->ns_reclaim_older;
+	for (i = 0; i < LDLM_RECLAIM_HIST_BUCKETS; i++) {
+		lab = &ns->ns_reclaim_hist[(now - i) %
+					   LDLM_RECLAIM_HIST_BUCKETS];
+		/* a bucket not reused for a whole ring holds old locks */
+		if (lab->lab_epoch == now - i) {
+			hist[i] = lab->lab_count;
+		} else {
+			hist[i] = 0;
+			hist[LDLM_RECLAIM_HIST_BUCKETS] += lab->lab_count;
+		}
 	}
+	spin_unlock(&ns->ns_reclaim_lock);
+}
 
-	if (data->rcd_skip && data->rcd_cursor < data->rcd_start) {
-		data->rcd_cursor++;
+/**
+ * Find how old the locks revoked from \a ns have to be at least, so that
+ * there are \a count of them, according to its age histogram.
+ */
+static cfs_duration_t ldlm_reclaim_age(struct ldlm_namespace *ns, int count)
+{
+	__u64 hist[LDLM_RECLAIM_HIST_BUCKETS + 1];
+	__u64 sum;
+	int i;
+
+	if (OBD_FAIL_CHECK(OBD_FAIL_LDLM_WATERMARK_LOW))
 		return 0;
+
+	ldlm_reclaim_hist_get(ns, hist);
+	sum = hist[LDLM_RECLAIM_HIST_BUCKETS];
+	for (i = LDLM_RECLAIM_HIST_BUCKETS; i > 0 && sum < count; i--)
+		sum += hist[i - 1];
+
+	/* the locks granted i epochs ago and before are enough */
+	return max_t(cfs_duration_t, i * LDLM_RECLAIM_EPOCH,
+		     LDLM_RECLAIM_AGE_MIN);
+}
+
+/**
+ * Take up to \a count locks older than \a age off the head of the reclaim
+ * list of \a exp, with a reference, into \a victims.
+ *
+ * \retval number of locks taken
+ */
+static int ldlm_reclaim_export(struct obd_export *exp, cfs_duration_t age,
+			       int count, struct ldlm_lock **victims)
+{
+	struct ldlm_reclaim_stats *rs = &ldlm_reclaim_stats;
+	cfs_time_t now = cfs_time_current();
+	struct ldlm_lock *lock;
+	unsigned long epochs;
+	int nr = 0;
+
+	spin_lock(&exp->exp_reclaim_lock);
+	while (nr < count && !list_empty(&exp->exp_reclaim_list)) {
+		lock = list_entry(exp->exp_reclaim_list.next,
+				  struct ldlm_lock, l_reclaim_link);
+		if (cfs_time_before(now,
+				    cfs_time_add(lock->l_grant_time, age)))
+			break;
+
+		/* the lock leaves the reclaim accounting now, it is going
+		 * to be revoked or is being cancelled already */
+		list_del_init(&lock->l_reclaim_link);
+		exp->exp_reclaim_count--;
+		ldlm_reclaim_hist_del(ldlm_lock_to_ns(lock),
+				      lock->l_grant_time);
+
+		epochs = cfs_time_sub(now, lock->l_grant_time) /
+			 LDLM_RECLAIM_EPOCH;
+		rs->rs_age[min_t(unsigned long, epochs,
+				 LDLM_RECLAIM_HIST_BUCKETS)]++;
+		victims[nr++] = LDLM_LOCK_GET(lock);
 	}
+	spin_unlock(&exp->exp_reclaim_lock);
 
-	nsb->nsb_reclaim_start++;
+	if (nr > 0)
+		rs->rs_exports++;
+	return nr;
+}
 
-	lock_res(res);
-	list_for_each_entry(lock, &res->lr_granted, l_res_link) {
-		if (!ldlm_lock_reclaimable(lock))
+/**
+ * Pick up to \a count victims from the exports of \a ns: the heaviest
+ * exports are served first, each in proportion to its share of their
+ * locks, then the others if that was not enough.
+ */
+static int ldlm_reclaim_pick(struct ldlm_namespace *ns, int count,
+			     cfs_duration_t age, struct ldlm_lock **victims)
+{
+	struct obd_export *heavy[LDLM_RECLAIM_EXPORTS];
+	struct obd_device *obd = ns->ns_obd;
+	struct obd_export *exp;
+	__u64 total = 0;
+	__u64 share;
+	int nr_heavy = 0;
+	int nr = 0;
+	int i;
+
+	spin_lock(&obd->obd_dev_lock);
+	list_for_each_entry(exp, &obd->obd_exports, exp_obd_chain) {
+		if (exp->exp_reclaim_count == 0)
 			continue;
 
-		if (!OBD_FAIL_CHECK(OBD_FAIL_LDLM_WATERMARK_LOW) &&
-		    cfs_time_before(cfs_time_current(),
-				    cfs_time_add(lock->l_last_used,
-						 data->rcd_age)))
-			continue;
+		/* keep heavy[] sorted, heaviest first */
+		if (nr_heavy == LDLM_RECLAIM_EXPORTS) {
+			if (exp->exp_reclaim_count <=
+			    heavy[nr_heavy - 1]->exp_reclaim_count)
+				continue;
+			nr_heavy--;
+		}
+		for (i = nr_heavy; i > 0 &&
+		     heavy[i - 1]->exp_reclaim_count < exp->exp_reclaim_count;
+		     i--)
+			heavy[i] = heavy[i - 1];
+		heavy[i] = exp;
+		nr_heavy++;
+	}
 
-		if (!ldlm_is_ast_sent(lock)) {
-			ldlm_set_ast_sent(lock);
-			LASSERT(list_empty(&lock->l_rk_ast));
-			list_add(&lock->l_rk_ast, &data->rcd_rpc_list);
-			LDLM_LOCK_GET(lock);
-			if (++data->rcd_added == data->rcd_total) {
-				rc = 1; /* stop the iteration */
+	for (i = 0; i < nr_heavy; i++)
+		total += heavy[i]->exp_reclaim_count;
+
+	for (i = 0; i < nr_heavy && nr < count; i++) {
+		share = (__u64)count * heavy[i]->exp_reclaim_count;
+		do_div(share, max_t(__u64, total, 1));
+		share = clamp_t(__u64, share, 1, count - nr);
+		nr += ldlm_reclaim_export(heavy[i], age, share, victims + nr);
+	}
+
+	/* the heaviest exports hold too few old locks, look at all */
+	if (nr < count) {
+		list_for_each_entry(exp, &obd->obd_exports, exp_obd_chain) {
+			nr += ldlm_reclaim_export(exp, age, count - nr,
+						  victims + nr);
+			if (nr == count)
 				break;
-			}
 		}
 	}
-	unlock_res(res);
+	spin_unlock(&obd->obd_dev_lock);
 
-	return rc;
+	return nr;
 }
 
 /**
- * Revoke locks from the resources of a namespace in a roundrobin
- * manner.
+ * Revoke the oldest locks of the heaviest exports of a namespace.
  *
  * \param[in] ns	namespace to do the lock revoke on
  * \param[in] count	count of lock to be revoked
- * \param[in] age	only revoke locks older than the 'age'
- * \param[in] skip	scan from the first lock on resource if the
- *			'skip' is false, otherwise, continue scan
- *			from the last scanned position
  * \param[out] count	count of lock still to be revoked
  */
-static void ldlm_reclaim_res(struct ldlm_namespace *ns, int *count,
-			     cfs_duration_t age, bool skip)
+static void ldlm_reclaim_res(struct ldlm_namespace *ns, int *count)
 {
-	struct ldlm_reclaim_cb_data	data;
-	int				idx, type, start;
+	struct list_head	 rpc_list = LIST_HEAD_INIT(rpc_list);
+	struct ldlm_lock	*lock;
+	cfs_duration_t		 age;
+	int			 idx, type, nr, i;
 	ENTRY;
 
 	LASSERT(*count != 0);
@@ -193,64 +340,54 @@ static void ldlm_reclaim_res(struct ldlm_namespace *ns, int *count,
 		}
 	}
 
-	if (atomic_read(&ns->ns_bref) == 0) {
+	if (atomic_read(&ns->ns_bref) == 0 || ns->ns_obd == NULL) {
 		EXIT;
 		return;
 	}
 
-	INIT_LIST_HEAD(&data.rcd_rpc_list);
-	data.rcd_added = 0;
-	data.rcd_total = *count;
-	data.rcd_age = age;
-	data.rcd_skip = skip;
-	data.rcd_prev_bd = NULL;
-	start = ns->ns_reclaim_start % CFS_HASH_NBKT(ns->ns_rs_hash);
-
-	cfs_hash_for_each_nolock(ns->ns_rs_hash, ldlm_reclaim_lock_cb, &data,
-				 start);
+	age = ldlm_reclaim_age(ns, *count);
+	nr = ldlm_reclaim_pick(ns, *count, age, ldlm_reclaim_victims);
 
-	CDEBUG(D_DLMTRACE, "NS(%s): %d locks to be reclaimed, found %d/%d "
-	       "locks.\n", ldlm_ns_name(ns), *count, data.rcd_added,
-	       data.rcd_total);
+	for (i = 0; i < nr; i++) {
+		lock = ldlm_reclaim_victims[i];
+		lock_res_and_lock(lock);
+		if (lock->l_granted_mode == lock->l_req_mode &&
+		    !ldlm_is_ast_sent(lock)) {
+			ldlm_set_ast_sent(lock);
+			LASSERT(list_empty(&lock->l_rk_ast));
+			/* the reference goes with the lock to the list */
+			list_add(&lock->l_rk_ast, &rpc_list);
+			unlock_res_and_lock(lock);
+			continue;
+		}
+		unlock_res_and_lock(lock);
+		LDLM_LOCK_RELEASE(lock);
+	}
 
-	LASSERTF(*count >= data.rcd_added, "count:%d, added:%d\n", *count,
-		 data.rcd_added);
+	CDEBUG(D_DLMTRACE, "NS(%s): %d locks to be reclaimed, found %d locks "
+	       "older than %lus.\n", ldlm_ns_name(ns), *count, nr,
+	       cfs_duration_sec(age));
 
-	ldlm_run_ast_work(ns, &data.rcd_rpc_list, LDLM_WORK_REVOKE_AST);
-	*count -= data.rcd_added;
+	ldlm_run_ast_work(ns, &rpc_list, LDLM_WORK_REVOKE_AST);
+	*count -= nr;
+	ldlm_reclaim_stats.rs_victims += nr;
 	EXIT;
 }
 
-#define LDLM_RECLAIM_BATCH	512
-#define LDLM_RECLAIM_AGE_MIN	cfs_time_seconds(300)
-#define LDLM_RECLAIM_AGE_MAX	(LDLM_DEFAULT_MAX_ALIVE * 3 / 4)
-
-static inline cfs_duration_t ldlm_reclaim_age(void)
-{
-	cfs_duration_t	age;
-
-	age = ldlm_last_reclaim_age +
-		cfs_time_sub(cfs_time_current(), ldlm_last_reclaim_time);
-	if (age > LDLM_RECLAIM_AGE_MAX)
-		age = LDLM_RECLAIM_AGE_MAX;
-	else if (age < (LDLM_RECLAIM_AGE_MIN * 2))
-		age = LDLM_RECLAIM_AGE_MIN;
-	return age;
-}
-
 /**
  * Revoke certain amount of locks from all the server namespaces
- * in a roundrobin manner. Lock age is used to avoid reclaim on
- * the non-aged locks.
+ * in a roundrobin manner.
  */
 static void ldlm_reclaim_ns(void)
 {
+	struct ldlm_reclaim_stats *rs = &ldlm_reclaim_stats;
 	struct ldlm_namespace	*ns;
 	int			 count = LDLM_RECLAIM_BATCH;
 	int			 ns_nr, nr_processed;
 	enum ldlm_side		 ns_cli = LDLM_NAMESPACE_SERVER;
-	cfs_duration_t		 age;
-	bool			 skip = true;
+	struct timeval		 start;
+	struct timeval		 end;
+	__u64			 usec;
 	ENTRY;
 
 	if (!atomic_add_unless(&ldlm_nr_reclaimer, 1, 1)) {
@@ -258,8 +395,7 @@ static void ldlm_reclaim_ns(void)
 		return;
 	}
 
-	age = ldlm_reclaim_age();
-again:
+	do_gettimeofday(&start);
 	nr_processed = 0;
 	ns_nr = ldlm_namespace_nr_read(ns_cli);
 	while (count > 0 && nr_processed < ns_nr) {
@@ -267,46 +403,144 @@ again:
 
 		if (list_empty(ldlm_namespace_list(ns_cli))) {
 			mutex_unlock(ldlm_namespace_lock(ns_cli));
-			goto out;
+			break;
 		}
 
 		ns = ldlm_namespace_first_locked(ns_cli);
 		ldlm_namespace_move_to_active_locked(ns, ns_cli);
 		mutex_unlock(ldlm_namespace_lock(ns_cli));
 
-		ldlm_reclaim_res(ns, &count, age, skip);
+		ldlm_reclaim_res(ns, &count);
 		ldlm_namespace_put(ns);
 		nr_processed++;
 	}
 
-	if (count > 0 && age > LDLM_RECLAIM_AGE_MIN) {
-		age >>= 1;
-		if (age < (LDLM_RECLAIM_AGE_MIN * 2))
-			age = LDLM_RECLAIM_AGE_MIN;
-		skip = false;
-		goto again;
-	}
+	do_gettimeofday(&end);
+	usec = cfs_timeval_sub(&end, &start, NULL);
+	rs->rs_runs++;
+	rs->rs_time_last = usec;
+	rs->rs_time_total += usec;
+	if (usec > rs->rs_time_max)
+		rs->rs_time_max = usec;
 
-	ldlm_last_reclaim_age = age;
-	ldlm_last_reclaim_time = cfs_time_current();
-out:
 	atomic_add_unless(&ldlm_nr_reclaimer, -1, 0);
 	EXIT;
 }
 
 void ldlm_reclaim_add(struct ldlm_lock *lock)
 {
+	struct obd_export *exp = lock->l_export;
+
 	if (!ldlm_lock_reclaimable(lock))
 		return;
 	percpu_counter_add(&ldlm_granted_total, 1);
-	lock->l_last_used = cfs_time_current();
+
+	/* only locks held by clients can be revoked */
+	if (exp == NULL) {
+		lock->l_grant_time = cfs_time_current();
+		return;
+	}
+
+	/* set the grant time under the list lock to keep the list sorted */
+	spin_lock(&exp->exp_reclaim_lock);
+	lock->l_grant_time = cfs_time_current();
+	LASSERT(list_empty(&lock->l_reclaim_link));
+	list_add_tail(&lock->l_reclaim_link, &exp->exp_reclaim_list);
+	exp->exp_reclaim_count++;
+	ldlm_reclaim_hist_add(ldlm_lock_to_ns(lock), lock->l_grant_time);
+	spin_unlock(&exp->exp_reclaim_lock);
 }
 
 void ldlm_reclaim_del(struct ldlm_lock *lock)
 {
+	struct obd_export *exp = lock->l_export;
+
 	if (!ldlm_lock_reclaimable(lock))
 		return;
 	percpu_counter_sub(&ldlm_granted_total, 1);
+
+	if (exp == NULL)
+		return;
+
+	spin_lock(&exp->exp_reclaim_lock);
+	/* not on the list if a reclaim pass took it already */
+	if (!list_empty(&lock->l_reclaim_link)) {
+		list_del_init(&lock->l_reclaim_link);
+		exp->exp_reclaim_count--;
+		ldlm_reclaim_hist_del(ldlm_lock_to_ns(lock),
+				      lock->l_grant_time);
+	}
+	spin_unlock(&exp->exp_reclaim_lock);
+}
+
+/* Statistics of the reclaim passes: duration and victims by age. */
+int ldlm_reclaim_stats_seq_show(struct seq_file *m, void *v)
+{
+	struct ldlm_reclaim_stats *rs = &ldlm_reclaim_stats;
+	__u64 avg = rs->rs_time_total;
+	int i;
+
+	if (rs->rs_runs != 0)
+		do_div(avg, rs->rs_runs);
+
+	seq_printf(m, "runs: "LPU64"\n", rs->rs_runs);
+	seq_printf(m, "victims: "LPU64"\n", rs->rs_victims);
+	seq_printf(m, "victim_exports: "LPU64"\n", rs->rs_exports);
+	seq_printf(m, "time_last_usec: "LPU64"\n", rs->rs_time_last);
+	seq_printf(m, "time_avg_usec: "LPU64"\n", avg);
+	seq_printf(m, "time_max_usec: "LPU64"\n", rs->rs_time_max);
+	seq_printf(m, "victim_age_sec:\n");
+	for (i = 0; i < LDLM_RECLAIM_HIST_BUCKETS; i++)
+		seq_printf(m, "  %6lu: "LPU64"\n",
+			   cfs_duration_sec(i * LDLM_RECLAIM_EPOCH),
+			   rs->rs_age[i]);
+	seq_printf(m, " >%6lu: "LPU64"\n",
+		   cfs_duration_sec(LDLM_RECLAIM_HIST_BUCKETS *
+				    LDLM_RECLAIM_EPOCH),
+		   rs->rs_age[LDLM_RECLAIM_HIST_BUCKETS]);
+	return 0;
+}
+
+/* Any write clears the statistics. */
+ssize_t ldlm_reclaim_stats_seq_write(struct file *file,
+				     const char __user *buffer,
+				     size_t count, loff_t *off)
+{
+	memset(&ldlm_reclaim_stats, 0, sizeof(ldlm_reclaim_stats));
+	return count;
+}
+
+/* Age histogram and heaviest exports of a server namespace. */
+int ldlm_reclaim_hist_seq_show(struct seq_file *m, void *v)
+{
+	__u64 hist[LDLM_RECLAIM_HIST_BUCKETS + 1];
+	struct ldlm_namespace *ns = m->private;
+	struct obd_export *exp;
+	int i;
+
+	ldlm_reclaim_hist_get(ns, hist);
+	seq_printf(m, "lock_age_sec:\n");
+	for (i = 0; i < LDLM_RECLAIM_HIST_BUCKETS; i++)
+		seq_printf(m, "  %6lu: "LPU64"\n",
+			   cfs_duration_sec(i * LDLM_RECLAIM_EPOCH), hist[i]);
+	seq_printf(m, " >%6lu: "LPU64"\n",
+		   cfs_duration_sec(LDLM_RECLAIM_HIST_BUCKETS *
+				    LDLM_RECLAIM_EPOCH),
+		   hist[LDLM_RECLAIM_HIST_BUCKETS]);
+
+	if (ns->ns_obd == NULL)
+		return 0;
+
+	seq_printf(m, "export_locks:\n");
+	spin_lock(&ns->ns_obd->obd_dev_lock);
+	list_for_each_entry(exp, &ns->ns_obd->obd_exports, exp_obd_chain) {
+		if (exp->exp_reclaim_count != 0)
+			seq_printf(m, "  %s: "LPU64"\n",
+				   exp->exp_client_uuid.uuid,
+				   exp->exp_reclaim_count);
+	}
+	spin_unlock(&ns->ns_obd->obd_dev_lock);
+	return 0;
 }
 
 /**
@@ -360,6 +594,8 @@ static inline __u64 ldlm_locknr2mb(__u64 locknr)
 
 int ldlm_reclaim_setup(void)
 {
+	int rc;
+
 	atomic_set(&ldlm_nr_reclaimer, 0);
 
 	ldlm_reclaim_threshold = ldlm_ratio2locknr(LDLM_WM_RATIO_LOW_DEFAULT);
@@ -367,19 +603,28 @@ int ldlm_reclaim_setup(void)
 	ldlm_lock_limit = ldlm_ratio2locknr(LDLM_WM_RATIO_HIGH_DEFAULT);
 	ldlm_lock_limit_mb = ldlm_locknr2mb(ldlm_lock_limit);
 
-	ldlm_last_reclaim_age = LDLM_RECLAIM_AGE_MAX;
-	ldlm_last_reclaim_time = cfs_time_current();
+	OBD_ALLOC_LARGE(ldlm_reclaim_victims,
+			LDLM_RECLAIM_BATCH * sizeof(*ldlm_reclaim_victims));
+	if (ldlm_reclaim_victims == NULL)
+		return -ENOMEM;
 
 #ifdef HAVE_PERCPU_COUNTER_INIT_GFP_FLAG
-	return percpu_counter_init(&ldlm_granted_total, 0, GFP_KERNEL);
+	rc = percpu_counter_init(&ldlm_granted_total, 0, GFP_KERNEL);
 #else
-	return percpu_counter_init(&ldlm_granted_total, 0);
+	rc = percpu_counter_init(&ldlm_granted_total, 0);
 #endif
+	if (rc != 0)
+		OBD_FREE_LARGE(ldlm_reclaim_victims,
+			       LDLM_RECLAIM_BATCH *
+			       sizeof(*ldlm_reclaim_victims));
+	return rc;
 }
 
 void ldlm_reclaim_cleanup(void)
 {
 	percpu_counter_destroy(&ldlm_granted_total);
+	OBD_FREE_LARGE(ldlm_reclaim_victims,
+		       LDLM_RECLAIM_BATCH * sizeof(*ldlm_reclaim_victims));
 }
 
 #else /* HAVE_SERVER_SUPPORT */
@@ -74,6 +74,10 @@ CFS_MODULE_PARM(ldlm_enqueue_min, "i", uint, 0644,
 /* in client side, whether the cached locks will be canceled before replay */
 unsigned int ldlm_cancel_unused_locks_before_replay = 1;
 
+/* in client side, how many batched lock replay RPCs an import keeps in
+ * flight when the server supports them */
+unsigned int ldlm_replay_batches_in_flight = 8;
+
 static void interrupted_completion_wait(void *data)
 {
 }
@@ -574,9 +578,6 @@ int ldlm_cli_enqueue_fini(struct obd_export *exp, struct ptlrpc_request *req,
 	if (reply == NULL)
 		GOTO(cleanup, rc = -EPROTO);
 
-	/* ziqi: get the return l_cc value from server */
-	printk("ldlm_cli_enqueue_fini(): reply->lock_desc.l_cc = %d\n", reply->lock_desc.l_cc);
-
 	if (lvb_len > 0) {
 		int size = 0;
 
@@ -717,6 +718,105 @@ cleanup:
 }
 EXPORT_SYMBOL(ldlm_cli_enqueue_fini);
 
+/**
+ * Create a lock for a request which gets its locks granted as a side effect,
+ * such as a batched getattr, rather than by a LDLM_ENQUEUE of its own.
+ *
+ * The lock is created on \a res_id and referenced in \a einfo->ei_mode, its
+ * handle is sent to the server which returns the granted resource, bits and
+ * remote handle in the reply, see ldlm_cli_remote_lock_fini().
+ */
+int ldlm_cli_remote_lock_create(struct obd_export *exp,
+				struct ldlm_enqueue_info *einfo,
+				const struct ldlm_res_id *res_id,
+				struct lustre_handle *lockh)
+{
+	const struct ldlm_callback_suite cbs = {
+		.lcs_completion	= einfo->ei_cb_cp,
+		.lcs_blocking	= einfo->ei_cb_bl,
+		.lcs_glimpse	= einfo->ei_cb_gl
+	};
+	struct ldlm_lock *lock;
+	ENTRY;
+
+	lock = ldlm_lock_create(exp->exp_obd->obd_namespace, res_id,
+				einfo->ei_type, einfo->ei_mode, &cbs,
+				einfo->ei_cbdata, 0, LVB_T_NONE);
+	if (IS_ERR(lock))
+		RETURN(PTR_ERR(lock));
+
+	ldlm_lock_addref_internal(lock, einfo->ei_mode);
+	ldlm_lock2handle(lock, lockh);
+
+	lock->l_conn_export = exp;
+	lock->l_export = NULL;
+	lock->l_blocking_ast = einfo->ei_cb_bl;
+	lock->l_last_activity = cfs_time_current_sec();
+	LDLM_DEBUG(lock, "client-side remote lock created");
+
+	/* the reference of ldlm_lock_create() is dropped in
+	 * ldlm_cli_remote_lock_fini() */
+	RETURN(0);
+}
+EXPORT_SYMBOL(ldlm_cli_remote_lock_create);
+
+/**
+ * Finish a lock created by ldlm_cli_remote_lock_create() once the reply is
+ * in. If the server granted it, \a remote is its server handle, the lock is
+ * moved to \a res_id with the inodebits \a bits and granted locally.
+ * Otherwise \a remote is zero and the lock is dropped, \a lockh must not be
+ * used anymore then.
+ *
+ * \retval 0 if the lock is granted
+ * \retval negative errno if it is not
+ */
+int ldlm_cli_remote_lock_fini(struct obd_export *exp,
+			      struct lustre_handle *lockh, enum ldlm_mode mode,
+			      const struct ldlm_res_id *res_id, __u64 bits,
+			      const struct lustre_handle *remote)
+{
+	struct ldlm_namespace *ns = exp->exp_obd->obd_namespace;
+	struct ldlm_lock *lock;
+	__u64 flags = 0;
+	int rc = 0;
+	ENTRY;
+
+	lock = ldlm_handle2lock(lockh);
+	if (lock == NULL)
+		RETURN(-ENOLCK);
+
+	if (!lustre_handle_is_used(remote))
+		GOTO(cleanup, rc = -ENOLCK);
+
+	lock_res_and_lock(lock);
+	if (exp->exp_lock_hash)
+		cfs_hash_rehash_key(exp->exp_lock_hash, &lock->l_remote_handle,
+				    (void *)remote, &lock->l_exp_hash);
+	else
+		lock->l_remote_handle = *remote;
+	unlock_res_and_lock(lock);
+
+	if (!ldlm_res_eq(res_id, &lock->l_resource->lr_name)) {
+		rc = ldlm_lock_change_resource(ns, lock, res_id);
+		if (rc || lock->l_resource == NULL)
+			GOTO(cleanup, rc = -ENOMEM);
+	}
+	lock->l_policy_data.l_inodebits.bits = bits;
+
+	rc = ldlm_lock_enqueue(ns, &lock, NULL, &flags);
+	if (rc == 0 && lock->l_completion_ast != NULL)
+		rc = lock->l_completion_ast(lock, flags, NULL);
+	LDLM_DEBUG(lock, "client-side remote lock granted: rc = %d", rc);
+	EXIT;
+cleanup:
+	if (rc != 0)
+		failed_lock_cleanup(ns, lock, mode);
+	LDLM_LOCK_PUT(lock);
+	LDLM_LOCK_RELEASE(lock);
+	return rc;
+}
+EXPORT_SYMBOL(ldlm_cli_remote_lock_fini);
+
 /**
  * Estimate number of lock handles that would fit into request of given
  * size.  PAGE_SIZE-512 is to allow TCP/IP and LNET headers to fit into
@@ -928,8 +1028,6 @@ int ldlm_cli_enqueue(struct obd_export *exp, struct ptlrpc_request **reqp,
 	lock->l_blocking_ast = einfo->ei_cb_bl;
 	lock->l_flags |= (*flags & (LDLM_FL_NO_LRU | LDLM_FL_EXCL));
         lock->l_last_activity = cfs_time_current_sec();
-	/* ziqi: test passing cc lock info from client to server */
-	lock->l_cc = 666;
 
         /* lock not sent to server yet */
 
@@ -1100,6 +1198,139 @@ int ldlm_cli_convert(struct lustre_handle *lockh, int new_mode, __u32 *flags)
         return rc;
 }
 
+/**
+ * Finish the LDLM_CONVERT RPC sent by ldlm_cli_dropbits(). On success the
+ * lock may be matched again and goes back to the LRU if unused, otherwise
+ * it is cancelled as a whole, as the server still holds the dropped bits.
+ */
+static int ldlm_cli_dropbits_interpret(const struct lu_env *env,
+				       struct ptlrpc_request *req,
+				       struct ldlm_async_args *aa, int rc)
+{
+	struct ldlm_lock *lock;
+	ENTRY;
+
+	if (rc == 0 && req->rq_status != 0)
+		rc = req->rq_status > 0 ? -req->rq_status : req->rq_status;
+
+	lock = ldlm_handle2lock(&aa->lock_handle);
+	if (lock == NULL)
+		RETURN(0);
+
+	if (rc != 0) {
+		LDLM_DEBUG(lock, "ibits convert failed: rc = %d", rc);
+		LDLM_LOCK_PUT(lock);
+		ldlm_cli_cancel(&aa->lock_handle, LCF_ASYNC);
+		RETURN(0);
+	}
+
+	/* The lock is a plain downgrade of what was granted, it may be
+	 * matched again right away. */
+	lock_res_and_lock(lock);
+	if (!ldlm_is_canceling(lock)) {
+		ldlm_clear_cbpending(lock);
+		ldlm_clear_bl_ast(lock);
+		/* taken off the LRU with the blocking AST, and kept off
+		 * by ldlm_lock_decref_internal() while BL_AST was set */
+		if (lock->l_readers == 0 && lock->l_writers == 0 &&
+		    !ldlm_is_no_lru(lock) && list_empty(&lock->l_lru))
+			ldlm_lock_add_to_lru(lock);
+	}
+	unlock_res_and_lock(lock);
+	LDLM_LOCK_PUT(lock);
+
+	RETURN(0);
+}
+
+/**
+ * Give up \a drop_bits of unused IBITS \a lock in reply to a blocking AST
+ * and keep the remaining bits cached, instead of cancelling the lock.
+ *
+ * The bits are dropped locally first, so the lock can no longer be matched
+ * for them. Then the blocking callback is called with LDLM_CB_CANCELING and
+ * a lock descriptor whose inodebits are the dropped ones, so only the
+ * state they protect is invalidated. Finally the server is told with an
+ * LDLM_CONVERT RPC, sent to the cancel portal like a cancel would be.
+ *
+ * The RPC is sent by ptlrpcd so the blocking AST thread does not wait for
+ * it, see ldlm_cli_dropbits_interpret(). The lock stays CBPENDING until
+ * then.
+ *
+ * \retval 0 if the lock stays granted with the remaining bits
+ * \retval negative if the lock has to be cancelled as a whole instead
+ */
+int ldlm_cli_dropbits(struct ldlm_lock *lock, __u64 drop_bits)
+{
+	struct obd_import	*imp;
+	struct ldlm_request	*body;
+	struct ptlrpc_request	*req;
+	struct ldlm_async_args	*aa;
+	struct ldlm_lock_desc	 ld;
+	__u64			 bits;
+	ENTRY;
+
+	if (lock->l_resource->lr_type != LDLM_IBITS ||
+	    lock->l_conn_export == NULL)
+		RETURN(-EINVAL);
+
+	imp = class_exp2cliimp(lock->l_conn_export);
+	if (imp == NULL ||
+	    !(imp_connect_flags2(imp) & OBD_CONNECT2_LOCK_CONVERT))
+		RETURN(-EOPNOTSUPP);
+
+	lock_res_and_lock(lock);
+	bits = lock->l_policy_data.l_inodebits.bits;
+	drop_bits &= bits;
+	/* Nothing in common with the conflicting lock, or nothing left to
+	 * keep: the server expects the whole lock back. */
+	if (drop_bits == 0 || drop_bits == bits ||
+	    lock->l_readers != 0 || lock->l_writers != 0 ||
+	    lock->l_granted_mode != lock->l_req_mode ||
+	    ldlm_is_canceling(lock) || ldlm_is_local_only(lock) ||
+	    ldlm_is_cancel_on_block(lock) || ldlm_is_destroyed(lock)) {
+		unlock_res_and_lock(lock);
+		RETURN(-EINVAL);
+	}
+	ldlm_inodebits_drop(lock, drop_bits);
+	ldlm_lock2desc(lock, &ld);
+	unlock_res_and_lock(lock);
+
+	LDLM_DEBUG(lock, "client-side ibits convert, dropped "LPX64,
+		   drop_bits);
+
+	if (lock->l_blocking_ast != NULL) {
+		struct ldlm_lock_desc dropped = ld;
+
+		dropped.l_policy_data.l_inodebits.bits = drop_bits;
+		lock->l_blocking_ast(lock, &dropped, lock->l_ast_data,
+				     LDLM_CB_CANCELING);
+	}
+
+	req = ptlrpc_request_alloc_pack(imp, &RQF_LDLM_CONVERT,
+					LUSTRE_DLM_VERSION, LDLM_CONVERT);
+	if (req == NULL)
+		RETURN(-ENOMEM);
+
+	body = req_capsule_client_get(&req->rq_pill, &RMF_DLM_REQ);
+	body->lock_handle[0] = lock->l_remote_handle;
+	body->lock_desc = ld;
+
+	req->rq_request_portal = LDLM_CANCEL_REQUEST_PORTAL;
+	req->rq_reply_portal = LDLM_CANCEL_REPLY_PORTAL;
+	ptlrpc_at_set_req_timeout(req);
+	ptlrpc_request_set_replen(req);
+
+	CLASSERT(sizeof(*aa) <= sizeof(req->rq_async_args));
+	aa = ptlrpc_req_async_args(req);
+	ldlm_lock2handle(lock, &aa->lock_handle);
+	req->rq_interpret_reply =
+		(ptlrpc_interpterer_t)ldlm_cli_dropbits_interpret;
+	ptlrpcd_add_req(req);
+
+	RETURN(0);
+}
+EXPORT_SYMBOL(ldlm_cli_dropbits);
+
 /**
  * Cancel locks locally.
  * Returns:
@@ -1608,6 +1839,47 @@ enum ldlm_policy_res ldlm_cancel_default_policy(struct ldlm_namespace *ns,
                 LDLM_POLICY_KEEP_LOCK : LDLM_POLICY_CANCEL_LOCK;
 }
 
+/**
+ * Filter for the locks the LRU policy chose to cancel when the namespace
+ * uses LDLM_LRU_POLICY_COST. A lock protecting many cached pages is costly
+ * to cancel, as the pages are dropped (dirty ones written first) and will
+ * likely be read again along with the lock. Such a lock is kept until it
+ * was unused long enough to pay for it, so cheaper locks are canceled
+ * first.
+ *
+ * \retval LDLM_POLICY_CANCEL_LOCK cancel lock from LRU
+ *
+ * \retval LDLM_POLICY_SKIP_LOCK keep lock in LRU, but go on scanning
+ */
+static enum ldlm_policy_res ldlm_cancel_cost_filter(struct ldlm_namespace *ns,
+						    struct ldlm_lock *lock)
+{
+	cfs_time_t cur = cfs_time_current();
+	unsigned long pages;
+	unsigned long dirty = 0;
+	__u64 cost;
+	__u64 budget;
+
+	if (ns->ns_lock_cost == NULL)
+		return LDLM_POLICY_CANCEL_LOCK;
+
+	/* No lock stays in LRU past ns_max_age, whatever its cost. */
+	if (cfs_time_after(cur, cfs_time_add(lock->l_last_used,
+					     ns->ns_max_age)))
+		return LDLM_POLICY_CANCEL_LOCK;
+
+	pages = ns->ns_lock_cost(lock, &dirty);
+	cost = (__u64)pages + (__u64)dirty * (LDLM_LRU_COST_DIRTY - 1);
+	budget = (__u64)ns->ns_lru_cost_rate *
+		 (cfs_duration_sec(cfs_time_sub(cur, lock->l_last_used)) + 1);
+	if (cost <= budget)
+		return LDLM_POLICY_CANCEL_LOCK;
+
+	LDLM_DEBUG(lock, "kept in LRU, cost "LPU64" pages, budget "LPU64,
+		   cost, budget);
+	return LDLM_POLICY_SKIP_LOCK;
+}
+
 typedef enum ldlm_policy_res
 (*ldlm_cancel_lru_policy_t)(struct ldlm_namespace *ns, struct ldlm_lock *lock,
 			    int unused, int added, int count);
@@ -1668,6 +1940,11 @@ ldlm_cancel_lru_policy(struct ldlm_namespace *ns, enum ldlm_lru_flags lru_flags)
  *				(typically before replaying locks) w/o
  *				sending any RPCs or waiting for any
  *				outstanding RPC to complete.
+ *
+ * If the namespace uses LDLM_LRU_POLICY_COST, the locks chosen by the above
+ * policies, except for LDLM_LRU_FLAG_PASSED and LDLM_LRU_FLAG_NO_WAIT, also
+ * go through ldlm_cancel_cost_filter(). The locks it keeps are set aside
+ * until the end of the scan.
  */
 static int ldlm_prepare_lru_list(struct ldlm_namespace *ns,
 				 struct list_head *cancels, int count, int max,
@@ -1675,11 +1952,17 @@ static int ldlm_prepare_lru_list(struct ldlm_namespace *ns,
 {
 	ldlm_cancel_lru_policy_t pf;
 	struct ldlm_lock *lock, *next;
+	struct list_head skipped;
 	int added = 0, unused, remained;
 	int no_wait = lru_flags & (LDLM_LRU_FLAG_NO_WAIT |
 				   LDLM_LRU_FLAG_LRUR_NO_WAIT);
+	bool cost_aware;
 	ENTRY;
 
+	INIT_LIST_HEAD(&skipped);
+	cost_aware = ns->ns_lru_policy == LDLM_LRU_POLICY_COST && !no_wait &&
+		     !(lru_flags & LDLM_LRU_FLAG_PASSED);
+
 	spin_lock(&ns->ns_lock);
 	unused = ns->ns_nr_unused;
 	remained = unused;
@@ -1757,6 +2040,18 @@ static int ldlm_prepare_lru_list(struct ldlm_namespace *ns,
 			spin_lock(&ns->ns_lock);
 			continue;
 		}
+		if (cost_aware &&
+		    ldlm_cancel_cost_filter(ns, lock) == LDLM_POLICY_SKIP_LOCK) {
+			lu_ref_del(&lock->l_reference, __func__, current);
+			spin_lock(&ns->ns_lock);
+			/* Still unused, keep it off the scanned list. */
+			if (!list_empty(&lock->l_lru))
+				list_move_tail(&lock->l_lru, &skipped);
+			spin_unlock(&ns->ns_lock);
+			LDLM_LOCK_RELEASE(lock);
+			spin_lock(&ns->ns_lock);
+			continue;
+		}
 
 		lock_res_and_lock(lock);
 		/* Check flags again under the lock. */
@@ -1805,6 +2100,8 @@ static int ldlm_prepare_lru_list(struct ldlm_namespace *ns,
 		added++;
 		unused--;
 	}
+	/* The kept locks are the oldest ones still in LRU. */
+	list_splice(&skipped, &ns->ns_unused_list);
 	spin_unlock(&ns->ns_lock);
 	RETURN(added);
 }
@@ -2175,32 +2472,25 @@ static int ldlm_chain_lock_for_replay(struct ldlm_lock *lock, void *closure)
         return LDLM_ITER_CONTINUE;
 }
 
-static int replay_lock_interpret(const struct lu_env *env,
-				 struct ptlrpc_request *req,
-				 struct ldlm_async_args *aa, int rc)
+/**
+ * Move a replayed lock under the handle the server gave it on replay.
+ */
+static int ldlm_replay_rehash(struct ptlrpc_request *req,
+			      struct lustre_handle *local,
+			      struct lustre_handle *remote)
 {
-	struct ldlm_lock     *lock;
-	struct ldlm_reply    *reply;
-	struct obd_export    *exp;
-
-	ENTRY;
-	atomic_dec(&req->rq_import->imp_replay_inflight);
-	if (rc != ELDLM_OK)
-		GOTO(out, rc);
-
-        reply = req_capsule_server_get(&req->rq_pill, &RMF_DLM_REP);
-        if (reply == NULL)
-                GOTO(out, rc = -EPROTO);
+	struct ldlm_lock  *lock;
+	struct obd_export *exp;
 
-        lock = ldlm_handle2lock(&aa->lock_handle);
-        if (!lock) {
-                CERROR("received replay ack for unknown local cookie "LPX64
-                       " remote cookie "LPX64 " from server %s id %s\n",
-                       aa->lock_handle.cookie, reply->lock_handle.cookie,
-                       req->rq_export->exp_client_uuid.uuid,
-                       libcfs_id2str(req->rq_peer));
-                GOTO(out, rc = -ESTALE);
-        }
+	lock = ldlm_handle2lock(local);
+	if (!lock) {
+		CERROR("received replay ack for unknown local cookie "LPX64
+		       " remote cookie "LPX64 " from server %s id %s\n",
+		       local->cookie, remote->cookie,
+		       req->rq_export->exp_client_uuid.uuid,
+		       libcfs_id2str(req->rq_peer));
+		return -ESTALE;
+	}
 
         /* Key change rehash lock in per-export hash with new key */
         exp = req->rq_export;
@@ -2210,15 +2500,37 @@ static int replay_lock_interpret(const struct lu_env *env,
 		/* coverity[overrun-buffer-val] */
                 cfs_hash_rehash_key(exp->exp_lock_hash,
                                     &lock->l_remote_handle,
-                                    &reply->lock_handle,
+                                    remote,
                                     &lock->l_exp_hash);
         } else {
-                lock->l_remote_handle = reply->lock_handle;
+                lock->l_remote_handle = *remote;
         }
 
         LDLM_DEBUG(lock, "replayed lock:");
-        ptlrpc_import_recovery_state_machine(req->rq_import);
         LDLM_LOCK_PUT(lock);
+	return 0;
+}
+
+static int replay_lock_interpret(const struct lu_env *env,
+				 struct ptlrpc_request *req,
+				 struct ldlm_async_args *aa, int rc)
+{
+	struct ldlm_reply    *reply;
+
+	ENTRY;
+	atomic_dec(&req->rq_import->imp_replay_inflight);
+	if (rc != ELDLM_OK)
+		GOTO(out, rc);
+
+        reply = req_capsule_server_get(&req->rq_pill, &RMF_DLM_REP);
+        if (reply == NULL)
+                GOTO(out, rc = -EPROTO);
+
+	rc = ldlm_replay_rehash(req, &aa->lock_handle, &reply->lock_handle);
+	if (rc != 0)
+		GOTO(out, rc);
+
+        ptlrpc_import_recovery_state_machine(req->rq_import);
 out:
         if (rc != ELDLM_OK)
                 ptlrpc_connect_import(req->rq_import);
@@ -2226,19 +2538,16 @@ out:
         RETURN(rc);
 }
 
-static int replay_one_lock(struct obd_import *imp, struct ldlm_lock *lock)
+/**
+ * Check whether \a lock is to be replayed at all, locks which are not are
+ * dropped or cancelled here.
+ */
+static bool ldlm_lock_want_replay(struct ldlm_lock *lock)
 {
-        struct ptlrpc_request *req;
-        struct ldlm_async_args *aa;
-        struct ldlm_request   *body;
-        int flags;
-        ENTRY;
-
-
         /* Bug 11974: Do not replay a lock which is actively being canceled */
 	if (ldlm_is_canceling(lock)) {
                 LDLM_DEBUG(lock, "Not replaying canceled lock:");
-                RETURN(0);
+		return false;
         }
 
         /* If this is reply-less callback lock, we cannot replay it, since
@@ -2247,9 +2556,17 @@ static int replay_one_lock(struct obd_import *imp, struct ldlm_lock *lock)
 	if (ldlm_is_cancel_on_block(lock)) {
                 LDLM_DEBUG(lock, "Not replaying reply-less lock:");
                 ldlm_lock_cancel(lock);
-                RETURN(0);
+		return false;
         }
 
+	return true;
+}
+
+/**
+ * Enqueue flags telling the server in which state \a lock is replayed.
+ */
+static __u64 ldlm_lock_replay_flags(struct ldlm_lock *lock)
+{
         /*
          * If granted mode matches the requested mode, this lock is granted.
          *
@@ -2265,13 +2582,27 @@ static int replay_one_lock(struct obd_import *imp, struct ldlm_lock *lock)
          * recovery.
          */
         if (lock->l_granted_mode == lock->l_req_mode)
-                flags = LDLM_FL_REPLAY | LDLM_FL_BLOCK_GRANTED;
+		return LDLM_FL_REPLAY | LDLM_FL_BLOCK_GRANTED;
         else if (lock->l_granted_mode)
-                flags = LDLM_FL_REPLAY | LDLM_FL_BLOCK_CONV;
+		return LDLM_FL_REPLAY | LDLM_FL_BLOCK_CONV;
 	else if (!list_empty(&lock->l_res_link))
-                flags = LDLM_FL_REPLAY | LDLM_FL_BLOCK_WAIT;
+		return LDLM_FL_REPLAY | LDLM_FL_BLOCK_WAIT;
         else
-                flags = LDLM_FL_REPLAY;
+		return LDLM_FL_REPLAY;
+}
+
+static int replay_one_lock(struct obd_import *imp, struct ldlm_lock *lock)
+{
+        struct ptlrpc_request *req;
+        struct ldlm_async_args *aa;
+        struct ldlm_request   *body;
+	__u64 flags;
+        ENTRY;
+
+	if (!ldlm_lock_want_replay(lock))
+		RETURN(0);
+
+	flags = ldlm_lock_replay_flags(lock);
 
         req = ptlrpc_request_alloc_pack(imp, &RQF_LDLM_ENQUEUE,
                                         LUSTRE_DLM_VERSION, LDLM_ENQUEUE);
@@ -2309,6 +2640,258 @@ static int replay_one_lock(struct obd_import *imp, struct ldlm_lock *lock)
 	RETURN(0);
 }
 
+/**
+ * Batched lock replay state of an import, shared by its batch RPCs.
+ *
+ * The locks left to replay sit on lrc_locks with a reference held, every
+ * batch RPC takes the next LDLM_REPLAY_BATCH_MAX of them once the previous
+ * one it was pipelined after is answered, so that the import never has more
+ * than ldlm_replay_batches_in_flight of them in flight.
+ */
+struct ldlm_replay_ctx {
+	spinlock_t		 lrc_lock;
+	struct list_head	 lrc_locks;
+	atomic_t		 lrc_refcount;
+	struct obd_import	*lrc_imp;
+};
+
+struct ldlm_replay_batch_args {
+	struct ldlm_replay_ctx	*lrba_ctx;
+};
+
+/* Drop the locks not replayed yet, after an error. */
+static void ldlm_replay_ctx_abort(struct ldlm_replay_ctx *ctx)
+{
+	struct list_head list = LIST_HEAD_INIT(list);
+	struct ldlm_lock *lock, *next;
+
+	spin_lock(&ctx->lrc_lock);
+	list_splice_init(&ctx->lrc_locks, &list);
+	spin_unlock(&ctx->lrc_lock);
+
+	list_for_each_entry_safe(lock, next, &list, l_pending_chain) {
+		list_del_init(&lock->l_pending_chain);
+		LDLM_LOCK_RELEASE(lock);
+	}
+}
+
+static void ldlm_replay_ctx_put(struct ldlm_replay_ctx *ctx)
+{
+	if (atomic_dec_and_test(&ctx->lrc_refcount)) {
+		ldlm_replay_ctx_abort(ctx);
+		class_import_put(ctx->lrc_imp);
+		OBD_FREE_PTR(ctx);
+	}
+}
+
+static int replay_lock_batch(struct ldlm_replay_ctx *ctx);
+
+static int replay_lock_batch_interpret(const struct lu_env *env,
+				       struct ptlrpc_request *req,
+				       struct ldlm_replay_batch_args *aa,
+				       int rc)
+{
+	struct ldlm_replay_ctx *ctx = aa->lrba_ctx;
+	struct obd_import *imp = req->rq_import;
+	struct ldlm_replay_desc *descs;
+	struct ldlm_replay_rep *reps;
+	int count;
+	int i;
+	ENTRY;
+
+	if (rc != ELDLM_OK)
+		GOTO(out, rc);
+
+	count = req_capsule_get_size(&req->rq_pill, &RMF_DLM_REPLAY_DESC,
+				     RCL_CLIENT) / sizeof(*descs);
+	descs = req_capsule_client_get(&req->rq_pill, &RMF_DLM_REPLAY_DESC);
+	reps = req_capsule_server_sized_get(&req->rq_pill, &RMF_DLM_REPLAY_REP,
+					    count * sizeof(*reps));
+	if (descs == NULL || reps == NULL)
+		GOTO(out, rc = -EPROTO);
+
+	for (i = 0; i < count; i++) {
+		rc = ptlrpc_status_ntoh(reps[i].lrp_status);
+		if (rc < 0) {
+			CERROR("%s: replay of lock "LPX64" failed: rc = %d\n",
+			       imp->imp_obd->obd_name,
+			       descs[i].lrd_handle.cookie, rc);
+			GOTO(out, rc);
+		}
+
+		rc = ldlm_replay_rehash(req, &descs[i].lrd_handle,
+					&reps[i].lrp_handle);
+		if (rc != 0)
+			GOTO(out, rc);
+	}
+
+	/* keep the pipeline full before this batch leaves it, so that
+	 * imp_replay_inflight only drops to 0 once all locks are replayed */
+	rc = replay_lock_batch(ctx);
+	if (rc > 0)
+		rc = 0;
+	EXIT;
+out:
+	if (rc != ELDLM_OK)
+		ldlm_replay_ctx_abort(ctx);
+	atomic_dec(&imp->imp_replay_inflight);
+	ldlm_replay_ctx_put(ctx);
+
+	if (rc != ELDLM_OK)
+		ptlrpc_connect_import(imp);
+	else
+		ptlrpc_import_recovery_state_machine(imp);
+
+	return rc;
+}
+
+/**
+ * Send the next batch of locks of \a ctx to replay.
+ *
+ * \retval number of locks sent
+ * \retval 0 if there is nothing left to replay
+ * \retval negative errno on failure
+ */
+static int replay_lock_batch(struct ldlm_replay_ctx *ctx)
+{
+	struct obd_import *imp = ctx->lrc_imp;
+	struct list_head batch = LIST_HEAD_INIT(batch);
+	struct ldlm_replay_batch_args *aa;
+	struct ldlm_replay_desc *descs;
+	struct ldlm_lock *lock, *next;
+	struct ptlrpc_request *req;
+	struct ldlm_request *body;
+	int count = 0;
+	int i = 0;
+	ENTRY;
+
+	/* the MDT accepts no more than MDS_MAXREQSIZE, keep 512 bytes for
+	 * the lustre_msg header and the buffer alignment */
+	CLASSERT(LDLM_REPLAY_BATCH_MAX * sizeof(struct ldlm_replay_desc) +
+		 sizeof(struct ldlm_request) + sizeof(struct ptlrpc_body) +
+		 512 <= MDS_MAXREQSIZE);
+
+restart:
+	spin_lock(&ctx->lrc_lock);
+	while (count < LDLM_REPLAY_BATCH_MAX && !list_empty(&ctx->lrc_locks)) {
+		lock = list_entry(ctx->lrc_locks.next, struct ldlm_lock,
+				  l_pending_chain);
+		list_move_tail(&lock->l_pending_chain, &batch);
+		count++;
+	}
+	spin_unlock(&ctx->lrc_lock);
+
+	/* ldlm_lock_want_replay() may cancel, so check outside the spinlock */
+	list_for_each_entry_safe(lock, next, &batch, l_pending_chain) {
+		if (!ldlm_lock_want_replay(lock)) {
+			list_del_init(&lock->l_pending_chain);
+			LDLM_LOCK_RELEASE(lock);
+			count--;
+		}
+	}
+	if (count == 0) {
+		bool empty;
+
+		/* all skipped, try the next ones if any */
+		spin_lock(&ctx->lrc_lock);
+		empty = list_empty(&ctx->lrc_locks);
+		spin_unlock(&ctx->lrc_lock);
+		if (empty)
+			RETURN(0);
+		goto restart;
+	}
+
+	req = ptlrpc_request_alloc(imp, &RQF_LDLM_ENQUEUE_REPLAY_BATCH);
+	if (req == NULL)
+		GOTO(out, count = -ENOMEM);
+
+	req_capsule_set_size(&req->rq_pill, &RMF_DLM_REPLAY_DESC, RCL_CLIENT,
+			     count * sizeof(*descs));
+	count = ptlrpc_request_pack(req, LUSTRE_DLM_VERSION, LDLM_ENQUEUE);
+	if (count != 0) {
+		ptlrpc_request_free(req);
+		GOTO(out, count);
+	}
+
+	/* We're part of recovery, so don't wait for it. */
+	req->rq_send_state = LUSTRE_IMP_REPLAY_LOCKS;
+
+	body = req_capsule_client_get(&req->rq_pill, &RMF_DLM_REQ);
+	descs = req_capsule_client_get(&req->rq_pill, &RMF_DLM_REPLAY_DESC);
+	list_for_each_entry_safe(lock, next, &batch, l_pending_chain) {
+		list_del_init(&lock->l_pending_chain);
+		ldlm_lock2handle(lock, &descs[i].lrd_handle);
+		ldlm_lock2desc(lock, &descs[i].lrd_desc);
+		descs[i].lrd_flags =
+			ldlm_flags_to_wire(ldlm_lock_replay_flags(lock));
+		/* the first lock also fills the request body, to keep the
+		 * common enqueue sanity checks of the server happy */
+		if (i == 0)
+			ldlm_lock2desc(lock, &body->lock_desc);
+		LDLM_DEBUG(lock, "replaying lock in batch:");
+		LDLM_LOCK_RELEASE(lock);
+		i++;
+	}
+	body->lock_flags = ldlm_flags_to_wire(LDLM_FL_REPLAY);
+	body->lock_count = i;
+
+	req_capsule_set_size(&req->rq_pill, &RMF_DLM_REPLAY_REP, RCL_SERVER,
+			     i * sizeof(struct ldlm_replay_rep));
+	ptlrpc_request_set_replen(req);
+	/* see replay_one_lock() */
+	lustre_msg_set_flags(req->rq_reqmsg, MSG_REQ_REPLAY_DONE);
+
+	atomic_inc(&imp->imp_replay_inflight);
+	atomic_inc(&ctx->lrc_refcount);
+	CLASSERT(sizeof(*aa) <= sizeof(req->rq_async_args));
+	aa = ptlrpc_req_async_args(req);
+	aa->lrba_ctx = ctx;
+	req->rq_interpret_reply =
+		(ptlrpc_interpterer_t)replay_lock_batch_interpret;
+	ptlrpcd_add_req(req);
+
+	RETURN(i);
+out:
+	list_for_each_entry_safe(lock, next, &batch, l_pending_chain) {
+		list_del_init(&lock->l_pending_chain);
+		LDLM_LOCK_RELEASE(lock);
+	}
+	RETURN(count);
+}
+
+/**
+ * Replay the locks on \a list in batches, see struct ldlm_replay_ctx.
+ */
+static int ldlm_replay_locks_batched(struct obd_import *imp,
+				     struct list_head *list)
+{
+	struct ldlm_replay_ctx *ctx;
+	unsigned int i;
+	int rc = 0;
+	ENTRY;
+
+	OBD_ALLOC_PTR(ctx);
+	if (ctx == NULL)
+		RETURN(-ENOMEM);
+
+	spin_lock_init(&ctx->lrc_lock);
+	INIT_LIST_HEAD(&ctx->lrc_locks);
+	list_splice_init(list, &ctx->lrc_locks);
+	atomic_set(&ctx->lrc_refcount, 1);
+	ctx->lrc_imp = class_import_get(imp);
+
+	for (i = 0; i < max(ldlm_replay_batches_in_flight, 1U); i++) {
+		rc = replay_lock_batch(ctx);
+		if (rc <= 0)
+			break;
+	}
+	if (rc < 0)
+		ldlm_replay_ctx_abort(ctx);
+	ldlm_replay_ctx_put(ctx);
+
+	RETURN(min(rc, 0));
+}
+
 /**
  * Cancel as many unused locks as possible before replay. since we are
  * in recovery, we can't wait for any outstanding RPCs to send any RPC
@@ -2361,6 +2944,14 @@ int ldlm_replay_locks(struct obd_import *imp)
 
 	ldlm_namespace_foreach(ns, ldlm_chain_lock_for_replay, &list);
 
+	if (imp_connect_flags2(imp) & OBD_CONNECT2_LOCK_REPLAY_BATCH) {
+		rc = ldlm_replay_locks_batched(imp, &list);
+		/* replay one lock per RPC if there was no memory to batch */
+		if (list_empty(&list))
+			GOTO(out, rc);
+		rc = 0;
+	}
+
 	list_for_each_entry_safe(lock, next, &list, l_pending_chain) {
 		list_del_init(&lock->l_pending_chain);
 		if (rc) {
@@ -2370,8 +2961,9 @@ int ldlm_replay_locks(struct obd_import *imp)
 		rc = replay_one_lock(imp, lock);
 		LDLM_LOCK_RELEASE(lock);
 	}
-
+	EXIT;
+out:
 	atomic_dec(&imp->imp_replay_inflight);
 
-	RETURN(rc);
+	return rc;
 }
@@ -40,6 +40,7 @@
  */
 
 #define DEBUG_SUBSYSTEM S_LDLM
+#include <linux/sort.h>
 #include <lustre_dlm.h>
 #include <lustre_fid.h>
 #include <obd_class.h>
@@ -47,6 +48,7 @@
 
 struct kmem_cache *ldlm_resource_slab, *ldlm_lock_slab;
 struct kmem_cache *ldlm_interval_tree_slab;
+struct kmem_cache *ldlm_ibits_queues_slab;
 
 int ldlm_srv_namespace_nr = 0;
 int ldlm_cli_namespace_nr = 0;
@@ -178,6 +180,9 @@ static const struct file_operations ldlm_granted_fops = {
 	.release = seq_release,
 };
 
+LPROC_SEQ_FOPS(ldlm_reclaim_stats);
+LPROC_SEQ_FOPS_RO(ldlm_reclaim_hist);
+
 #endif /* HAVE_SERVER_SUPPORT */
 
 int ldlm_proc_setup(void)
@@ -193,6 +198,9 @@ int ldlm_proc_setup(void)
 		{ .name	=	"cancel_unused_locks_before_replay",
 		  .fops	=	&ldlm_rw_uint_fops,
 		  .data	=	&ldlm_cancel_unused_locks_before_replay },
+		{ .name	=	"replay_batches_in_flight",
+		  .fops	=	&ldlm_rw_uint_fops,
+		  .data	=	&ldlm_replay_batches_in_flight },
 #ifdef HAVE_SERVER_SUPPORT
 		{ .name =	"lock_reclaim_threshold_mb",
 		  .fops =	&ldlm_watermark_fops,
@@ -203,6 +211,8 @@ int ldlm_proc_setup(void)
 		{ .name =	"lock_granted_count",
 		  .fops =	&ldlm_granted_fops,
 		  .data =	&ldlm_granted_total },
+		{ .name =	"lock_reclaim_stats",
+		  .fops =	&ldlm_reclaim_stats_fops },
 #endif
 		{ NULL }};
 	ENTRY;
@@ -418,6 +428,141 @@ static ssize_t lprocfs_elc_seq_write(struct file *file,
 }
 LPROC_SEQ_FOPS(lprocfs_elc);
 
+static const char *ldlm_lru_policy_names[] = {
+	[LDLM_LRU_POLICY_AGE]	= "age",
+	[LDLM_LRU_POLICY_COST]	= "cost",
+};
+
+static int lprocfs_lru_cancel_policy_seq_show(struct seq_file *m, void *v)
+{
+	struct ldlm_namespace *ns = m->private;
+
+	return seq_printf(m, "%s\n", ldlm_lru_policy_names[ns->ns_lru_policy]);
+}
+
+static ssize_t lprocfs_lru_cancel_policy_seq_write(struct file *file,
+						   const char __user *buffer,
+						   size_t count, loff_t *off)
+{
+	struct ldlm_namespace *ns = ((struct seq_file *)file->private_data)->private;
+	char kernbuf[16];
+	int i;
+
+	if (count >= sizeof(kernbuf))
+		return -EINVAL;
+	if (copy_from_user(kernbuf, buffer, count))
+		return -EFAULT;
+	kernbuf[count] = '\0';
+	if (count > 0 && kernbuf[count - 1] == '\n')
+		kernbuf[count - 1] = '\0';
+
+	for (i = 0; i < ARRAY_SIZE(ldlm_lru_policy_names); i++) {
+		if (strcmp(kernbuf, ldlm_lru_policy_names[i]) == 0) {
+			ns->ns_lru_policy = i;
+			return count;
+		}
+	}
+	return -EINVAL;
+}
+LPROC_SEQ_FOPS(lprocfs_lru_cancel_policy);
+
+#ifdef HAVE_SERVER_SUPPORT
+static int ldlm_res_contention_show(struct cfs_hash *hs, struct cfs_hash_bd *bd,
+				    struct hlist_node *hnode, void *arg)
+{
+	struct ldlm_resource	*res = cfs_hash_object(hs, hnode);
+	struct seq_file		*m = arg;
+	struct ldlm_contention	*lc = &res->lr_contention;
+	__u32			 rate;
+	__u32			 exports;
+
+	if (res->lr_type != LDLM_EXTENT)
+		return 0;
+
+	lock_res(res);
+	ldlm_extent_contention_get(res, &rate, &exports);
+	if (rate != 0 || exports != 0)
+		seq_printf(m, DLDLMRES": conflicts: "LPU64", rate: %u, "
+			   "exports: %u, shrunk: %u, srvlock: %u\n",
+			   PLDLMRES(res), lc->lc_conflicts_total, rate,
+			   exports, lc->lc_shrunk, lc->lc_denied);
+	unlock_res(res);
+
+	return 0;
+}
+
+/* Contention statistics of the extent resources with recent conflicts. */
+static int lprocfs_ns_contention_seq_show(struct seq_file *m, void *v)
+{
+	struct ldlm_namespace *ns = m->private;
+
+	cfs_hash_for_each_nolock(ns->ns_rs_hash, ldlm_res_contention_show,
+				 m, 0);
+	return 0;
+}
+LPROC_SEQ_FOPS_RO(lprocfs_ns_contention);
+
+static int ldlm_wait_top_cmp(const void *a, const void *b)
+{
+	const struct ldlm_wait_top *lwt_a = a;
+	const struct ldlm_wait_top *lwt_b = b;
+
+	if (lwt_a->lwt_time == lwt_b->lwt_time)
+		return 0;
+	return lwt_a->lwt_time > lwt_b->lwt_time ? -1 : 1;
+}
+
+/* The resources locks waited the longest on, longest first. */
+static int lprocfs_ns_wait_top_seq_show(struct seq_file *m, void *v)
+{
+	struct ldlm_namespace *ns = m->private;
+	struct ldlm_wait_top *top;
+	__u64 avg;
+	int i;
+
+	OBD_ALLOC(top, sizeof(ns->ns_wait_top));
+	if (top == NULL)
+		return -ENOMEM;
+
+	spin_lock(&ns->ns_wait_lock);
+	memcpy(top, ns->ns_wait_top, sizeof(ns->ns_wait_top));
+	spin_unlock(&ns->ns_wait_lock);
+
+	sort(top, LDLM_WAIT_TOP_SIZE, sizeof(*top), ldlm_wait_top_cmp, NULL);
+	for (i = 0; i < LDLM_WAIT_TOP_SIZE && top[i].lwt_count != 0; i++) {
+		avg = top[i].lwt_time;
+		do_div(avg, top[i].lwt_count);
+		seq_printf(m, DLDLMRES" %s: waits: %u, wait_usec: "LPU64
+			   ", avg_usec: "LPU64", max_usec: %u\n",
+			   (unsigned long long)top[i].lwt_name.name[0],
+			   (unsigned long long)top[i].lwt_name.name[1],
+			   (unsigned long long)top[i].lwt_name.name[2],
+			   (unsigned long long)top[i].lwt_name.name[3],
+			   ldlm_typename[top[i].lwt_type],
+			   top[i].lwt_count, top[i].lwt_time, avg,
+			   top[i].lwt_max);
+	}
+
+	OBD_FREE(top, sizeof(ns->ns_wait_top));
+	return 0;
+}
+
+/* Any write clears the table. */
+static ssize_t lprocfs_ns_wait_top_seq_write(struct file *file,
+					     const char __user *buffer,
+					     size_t count, loff_t *off)
+{
+	struct ldlm_namespace *ns = ((struct seq_file *)
+				     file->private_data)->private;
+
+	spin_lock(&ns->ns_wait_lock);
+	memset(ns->ns_wait_top, 0, sizeof(ns->ns_wait_top));
+	spin_unlock(&ns->ns_wait_lock);
+	return count;
+}
+LPROC_SEQ_FOPS(lprocfs_ns_wait_top);
+#endif /* HAVE_SERVER_SUPPORT */
+
 static void ldlm_namespace_proc_unregister(struct ldlm_namespace *ns)
 {
 	if (ns->ns_proc_dir_entry == NULL)
@@ -474,6 +619,10 @@ static int ldlm_namespace_proc_register(struct ldlm_namespace *ns)
 			     &ns->ns_max_age, &ldlm_rw_uint_fops);
 		ldlm_add_var(&lock_vars[0], ns_pde, "early_lock_cancel",
 			     ns, &lprocfs_elc_fops);
+		ldlm_add_var(&lock_vars[0], ns_pde, "lru_cancel_policy",
+			     ns, &lprocfs_lru_cancel_policy_fops);
+		ldlm_add_var(&lock_vars[0], ns_pde, "lru_cost_rate",
+			     &ns->ns_lru_cost_rate, &ldlm_rw_uint_fops);
 	} else {
 		ldlm_add_var(&lock_vars[0], ns_pde, "ctime_age_limit",
 			     &ns->ns_ctime_age_limit, &ldlm_rw_uint_fops);
@@ -485,6 +634,23 @@ static int ldlm_namespace_proc_register(struct ldlm_namespace *ns)
 			     &ns->ns_contention_time, &ldlm_rw_uint_fops);
 		ldlm_add_var(&lock_vars[0], ns_pde, "contended_locks",
 			     &ns->ns_contended_locks, &ldlm_rw_uint_fops);
+		ldlm_add_var(&lock_vars[0], ns_pde, "contended_grant_bytes",
+			     &ns->ns_contended_grant_size, &ldlm_rw_uint_fops);
+		ldlm_add_var(&lock_vars[0], ns_pde, "srvlock_exports",
+			     &ns->ns_srvlock_exports, &ldlm_rw_uint_fops);
+#ifdef HAVE_SERVER_SUPPORT
+		ldlm_add_var(&lock_vars[0], ns_pde, "contended_resources",
+			     ns, &lprocfs_ns_contention_fops);
+		ldlm_add_var(&lock_vars[0], ns_pde, "lock_age_histogram",
+			     ns, &ldlm_reclaim_hist_fops);
+		ldlm_add_var(&lock_vars[0], ns_pde, "lock_wait_top",
+			     ns, &lprocfs_ns_wait_top_fops);
+		if (ns->ns_flock_hash != NULL)
+			ldlm_add_var(&lock_vars[0], ns_pde,
+				     "flock_deadlock_depth",
+				     &ns->ns_flock_deadlock_depth,
+				     &ldlm_rw_uint_fops);
+#endif
 		ldlm_add_var(&lock_vars[0], ns_pde, "max_parallel_ast",
 			     &ns->ns_max_parallel_ast, &ldlm_rw_uint_fops);
 	}
@@ -720,7 +886,6 @@ struct ldlm_namespace *ldlm_namespace_new(struct obd_device *obd, char *name,
                 nsb = cfs_hash_bd_extra_get(ns->ns_rs_hash, &bd);
                 at_init(&nsb->nsb_at_estimate, ldlm_enqueue_min, 0);
                 nsb->nsb_namespace = ns;
-		nsb->nsb_reclaim_start = 0;
         }
 
         ns->ns_obd      = obd;
@@ -736,21 +901,36 @@ struct ldlm_namespace *ldlm_namespace_new(struct obd_device *obd, char *name,
 	ns->ns_max_nolock_size    = NS_DEFAULT_MAX_NOLOCK_BYTES;
 	ns->ns_contention_time    = NS_DEFAULT_CONTENTION_SECONDS;
 	ns->ns_contended_locks    = NS_DEFAULT_CONTENDED_LOCKS;
+	ns->ns_contended_grant_size = NS_DEFAULT_CONTENDED_GRANT_BYTES;
+	ns->ns_srvlock_exports    = NS_DEFAULT_SRVLOCK_EXPORTS;
 
         ns->ns_max_parallel_ast   = LDLM_DEFAULT_PARALLEL_AST_LIMIT;
         ns->ns_nr_unused          = 0;
         ns->ns_max_unused         = LDLM_DEFAULT_LRU_SIZE;
         ns->ns_max_age            = LDLM_DEFAULT_MAX_ALIVE;
+	ns->ns_lru_policy	  = LDLM_LRU_POLICY_AGE;
+	ns->ns_lru_cost_rate	  = NS_DEFAULT_LRU_COST_RATE;
         ns->ns_ctime_age_limit    = LDLM_CTIME_AGE_LIMIT;
         ns->ns_timeouts           = 0;
         ns->ns_orig_connect_flags = 0;
         ns->ns_connect_flags      = 0;
         ns->ns_stopping           = 0;
-	ns->ns_reclaim_start	  = 0;
+	spin_lock_init(&ns->ns_reclaim_lock);
+	spin_lock_init(&ns->ns_wait_lock);
+	ns->ns_flock_deadlock_depth = NS_DEFAULT_FLOCK_DEADLOCK_DEPTH;
+
+	if (client == LDLM_NAMESPACE_SERVER && ns_type == LDLM_NS_TYPE_MDT) {
+		rc = ldlm_flock_ns_init(ns);
+		if (rc != 0) {
+			CERROR("Can't initialize flock hash, rc %d\n", rc);
+			GOTO(out_hash, rc);
+		}
+	}
+
         rc = ldlm_namespace_proc_register(ns);
         if (rc != 0) {
                 CERROR("Can't initialize ns proc, rc %d\n", rc);
-                GOTO(out_hash, rc);
+                GOTO(out_flock, rc);
         }
 
         idx = ldlm_namespace_nr_read(client);
@@ -765,6 +945,8 @@ struct ldlm_namespace *ldlm_namespace_new(struct obd_device *obd, char *name,
 out_proc:
         ldlm_namespace_proc_unregister(ns);
         ldlm_namespace_cleanup(ns, 0);
+out_flock:
+	ldlm_flock_ns_fini(ns);
 out_hash:
         cfs_hash_putref(ns->ns_rs_hash);
 out_ns:
@@ -1029,6 +1211,7 @@ void ldlm_namespace_free_post(struct ldlm_namespace *ns)
 	ldlm_pool_fini(&ns->ns_pool);
 
 	ldlm_namespace_proc_unregister(ns);
+	ldlm_flock_ns_fini(ns);
 	cfs_hash_putref(ns->ns_rs_hash);
 	/* Namespace \a ns should be not on list at this time, otherwise
 	 * this will cause issues related to using freed \a ns in poold
@@ -1137,8 +1320,20 @@ struct ldlm_namespace *ldlm_namespace_first_locked(enum ldlm_side client)
 			    struct ldlm_namespace, ns_list_chain);
 }
 
+/** Free resource \a res and its per-type lookup structures. */
+static void ldlm_resource_free(struct ldlm_resource *res)
+{
+	if (res->lr_itree != NULL)
+		OBD_SLAB_FREE(res->lr_itree, ldlm_interval_tree_slab,
+			      sizeof(*res->lr_itree) * LCK_MODE_NUM);
+	if (res->lr_ibits_queues != NULL)
+		OBD_SLAB_FREE_PTR(res->lr_ibits_queues, ldlm_ibits_queues_slab);
+	OBD_SLAB_FREE(res, ldlm_resource_slab, sizeof *res);
+}
+
 /** Create and initialize new resource. */
-static struct ldlm_resource *ldlm_resource_new(enum ldlm_type ldlm_type)
+static struct ldlm_resource *ldlm_resource_new(struct ldlm_namespace *ns,
+					       enum ldlm_type ldlm_type)
 {
 	struct ldlm_resource *res;
 	int idx;
@@ -1162,6 +1357,16 @@ static struct ldlm_resource *ldlm_resource_new(enum ldlm_type ldlm_type)
 		}
 	}
 
+	/* Only the server checks IBITS compatibility. */
+	if (ldlm_type == LDLM_IBITS && ns_is_server(ns)) {
+		OBD_SLAB_ALLOC_PTR_GFP(res->lr_ibits_queues,
+				       ldlm_ibits_queues_slab, GFP_NOFS);
+		if (res->lr_ibits_queues == NULL) {
+			OBD_SLAB_FREE_PTR(res, ldlm_resource_slab);
+			return NULL;
+		}
+	}
+
 	INIT_LIST_HEAD(&res->lr_granted);
 	INIT_LIST_HEAD(&res->lr_converting);
 	INIT_LIST_HEAD(&res->lr_waiting);
@@ -1215,7 +1420,7 @@ ldlm_resource_get(struct ldlm_namespace *ns, struct ldlm_resource *parent,
 
 	LASSERTF(type >= LDLM_MIN_TYPE && type < LDLM_MAX_TYPE,
 		 "type: %d\n", type);
-	res = ldlm_resource_new(type);
+	res = ldlm_resource_new(ns, type);
 	if (res == NULL)
 		return ERR_PTR(-ENOMEM);
 
@@ -1232,10 +1437,7 @@ ldlm_resource_get(struct ldlm_namespace *ns, struct ldlm_resource *parent,
 		cfs_hash_bd_unlock(ns->ns_rs_hash, &bd, 1);
 		/* Clean lu_ref for failed resource. */
 		lu_ref_fini(&res->lr_reference);
-		if (res->lr_itree != NULL)
-			OBD_SLAB_FREE(res->lr_itree, ldlm_interval_tree_slab,
-				      sizeof(*res->lr_itree) * LCK_MODE_NUM);
-		OBD_SLAB_FREE(res, ldlm_resource_slab, sizeof *res);
+		ldlm_resource_free(res);
 found:
 		res = hlist_entry(hnode, struct ldlm_resource, lr_hash);
 		return res;
@@ -1316,10 +1518,7 @@ int ldlm_resource_putref(struct ldlm_resource *res)
 		cfs_hash_bd_unlock(ns->ns_rs_hash, &bd, 1);
 		if (ns->ns_lvbo && ns->ns_lvbo->lvbo_free)
 			ns->ns_lvbo->lvbo_free(res);
-		if (res->lr_itree != NULL)
-			OBD_SLAB_FREE(res->lr_itree, ldlm_interval_tree_slab,
-				      sizeof(*res->lr_itree) * LCK_MODE_NUM);
-		OBD_SLAB_FREE(res, ldlm_resource_slab, sizeof *res);
+		ldlm_resource_free(res);
 		return 1;
 	}
 	return 0;
@@ -1349,10 +1548,7 @@ int ldlm_resource_putref_locked(struct ldlm_resource *res)
 		 */
 		if (ns->ns_lvbo && ns->ns_lvbo->lvbo_free)
 			ns->ns_lvbo->lvbo_free(res);
-		if (res->lr_itree != NULL)
-			OBD_SLAB_FREE(res->lr_itree, ldlm_interval_tree_slab,
-				      sizeof(*res->lr_itree) * LCK_MODE_NUM);
-		OBD_SLAB_FREE(res, ldlm_resource_slab, sizeof *res);
+		ldlm_resource_free(res);
 
 		cfs_hash_bd_lock(ns->ns_rs_hash, &bd, 1);
 		return 1;
@@ -1377,6 +1573,12 @@ void ldlm_resource_add_lock(struct ldlm_resource *res, struct list_head *head,
 
 	LASSERT(list_empty(&lock->l_res_link));
 
+	/* start the clock of the lock wait profiler, a lock put back on the
+	 * waiting list keeps waiting since it was first queued */
+	if (head == &res->lr_waiting && ns_is_server(ldlm_res_to_ns(res)) &&
+	    ktime_to_ns(lock->l_wait_stamp) == 0)
+		lock->l_wait_stamp = ktime_get();
+
 	list_add_tail(&lock->l_res_link, head);
 }
 
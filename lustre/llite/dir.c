@@ -687,6 +687,11 @@ int ll_dir_getstripe(struct inode *inode, void **plmm, int *plmm_size,
 		if (LOV_MAGIC != cpu_to_le32(LOV_MAGIC))
 			lustre_swab_lov_user_md_v3((struct lov_user_md_v3 *)lmm);
 		break;
+	case LOV_MAGIC_COMP_V1:
+		if (LOV_MAGIC != cpu_to_le32(LOV_MAGIC))
+			lustre_swab_lov_comp_md_v1((struct lov_comp_md_v1 *)lmm,
+						   lmm_size);
+		break;
 	case LMV_MAGIC_V1:
 		if (LMV_MAGIC != cpu_to_le32(LMV_MAGIC))
 			lustre_swab_lmv_mds_md((union lmv_mds_md *)lmm);
@@ -1094,6 +1099,125 @@ static char *ll_getname(const char __user *filename)
 
 #define ll_putname(filename) OBD_FREE(filename, NAME_MAX + 1);
 
+/**
+ * Stat a batch of entries of directory \a dir with one MDS RPC, see
+ * LL_IOC_GETATTR_BATCH.
+ */
+static int ll_dir_getattr_batch(struct inode *dir,
+				struct ll_getattr_batch __user *arg)
+{
+	struct ll_sb_info		*sbi = ll_i2sbi(dir);
+	struct ll_getattr_batch		 lgb;
+	struct ll_getattr_batch_entry	*entries = NULL;
+	struct mdt_batch_getattr_rep	*rep;
+	struct ptlrpc_request		*req = NULL;
+	struct md_op_data		*op_data;
+	char				*names = NULL;
+	int				 api32 = ll_need_32bit_api(sbi);
+	int				 count = 0;
+	int				 i;
+	int				 rc;
+	ENTRY;
+
+	CLASSERT(LL_GETATTR_BATCH_MAX == MDS_BATCH_GETATTR_MAX);
+	CLASSERT(LL_GETATTR_BATCH_NAMELEN_MAX <= MDS_BATCH_GETATTR_BUFSIZE);
+
+	if (!exp_connect_batch_getattr(sbi->ll_md_exp))
+		RETURN(-EOPNOTSUPP);
+
+	if (copy_from_user(&lgb, arg, sizeof(lgb)))
+		RETURN(-EFAULT);
+
+	if (lgb.lgb_count == 0 || lgb.lgb_count > LL_GETATTR_BATCH_MAX ||
+	    lgb.lgb_namelen == 0 ||
+	    lgb.lgb_namelen > lgb.lgb_count * (NAME_MAX + 1))
+		RETURN(-EINVAL);
+
+	if (lgb.lgb_namelen > LL_GETATTR_BATCH_NAMELEN_MAX)
+		RETURN(-E2BIG);
+
+	OBD_ALLOC_LARGE(names, lgb.lgb_namelen);
+	if (names == NULL)
+		RETURN(-ENOMEM);
+
+	OBD_ALLOC_LARGE(entries, lgb.lgb_count * sizeof(*entries));
+	if (entries == NULL)
+		GOTO(out, rc = -ENOMEM);
+
+	if (copy_from_user(names, (void __user *)(unsigned long)lgb.lgb_names,
+			   lgb.lgb_namelen))
+		GOTO(out, rc = -EFAULT);
+
+	for (i = 0; i < lgb.lgb_namelen; i++)
+		if (names[i] == '\0')
+			count++;
+	if (names[lgb.lgb_namelen - 1] != '\0' || count != lgb.lgb_count)
+		GOTO(out, rc = -EINVAL);
+
+	op_data = ll_prep_md_op_data(NULL, dir, NULL, NULL, 0, 0,
+				     LUSTRE_OPC_ANY, NULL);
+	if (IS_ERR(op_data))
+		GOTO(out, rc = PTR_ERR(op_data));
+
+	rc = md_batch_getattr(sbi->ll_md_exp, op_data, names, lgb.lgb_namelen,
+			      lgb.lgb_count, NULL, NULL, &req);
+	ll_finish_md_op_data(op_data);
+	if (rc != 0)
+		GOTO(out, rc);
+
+	rep = req_capsule_server_get(&req->rq_pill, &RMF_BATCH_GETATTR_REP);
+	LASSERT(rep != NULL); /* checked by mdc_batch_getattr */
+
+	for (i = 0; i < lgb.lgb_count; i++, rep++) {
+		struct ll_getattr_batch_entry	*ent = &entries[i];
+		struct mdt_body			*body = &rep->mbgr_body;
+		lstat_t				*st = &ent->lgbe_st;
+
+		ent->lgbe_rc = rep->mbgr_rc;
+		if (ent->lgbe_rc != 0)
+			continue;
+
+		if (body->mbo_valid & OBD_MD_MDS) {
+			/* the inode is on another MDT */
+			ent->lgbe_rc = -EREMOTE;
+			continue;
+		}
+
+		st->st_dev	= dir->i_sb->s_dev;
+		st->st_mode	= body->mbo_mode;
+		st->st_nlink	= body->mbo_nlink;
+		st->st_uid	= body->mbo_uid;
+		st->st_gid	= body->mbo_gid;
+		st->st_rdev	= body->mbo_rdev;
+		st->st_size	= body->mbo_size;
+		st->st_blksize	= PAGE_CACHE_SIZE;
+		st->st_blocks	= body->mbo_blocks;
+		st->st_atime	= body->mbo_atime;
+		st->st_mtime	= body->mbo_mtime;
+		st->st_ctime	= body->mbo_ctime;
+		st->st_ino	= cl_fid_build_ino(&body->mbo_fid1, api32);
+		if (body->mbo_valid & OBD_MD_FLLAZYSIZE)
+			ent->lgbe_lazy |= LL_LAZY_SIZE;
+		if (body->mbo_valid & OBD_MD_FLLAZYBLOCKS)
+			ent->lgbe_lazy |= LL_LAZY_BLOCKS;
+		if (S_ISREG(body->mbo_mode) &&
+		    !(body->mbo_valid & OBD_MD_FLEASIZE))
+			ent->lgbe_lazy |= LL_BATCH_NOLAYOUT;
+	}
+
+	if (copy_to_user((void __user *)(unsigned long)lgb.lgb_entries,
+			 entries, lgb.lgb_count * sizeof(*entries)))
+		GOTO(out, rc = -EFAULT);
+
+	EXIT;
+out:
+	ptlrpc_req_finished(req);
+	if (entries != NULL)
+		OBD_FREE_LARGE(entries, lgb.lgb_count * sizeof(*entries));
+	OBD_FREE_LARGE(names, lgb.lgb_namelen);
+	return rc;
+}
+
 static long ll_dir_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 {
 	struct inode *inode = file->f_path.dentry->d_inode;
@@ -1381,22 +1505,36 @@ out_rmdir:
         case LL_IOC_LOV_GETSTRIPE:
         case LL_IOC_MDC_GETINFO:
         case IOC_MDC_GETFILEINFO:
+	case IOC_MDC_GETFILEINFO_LAZY:
         case IOC_MDC_GETFILESTRIPE: {
                 struct ptlrpc_request *request = NULL;
+		struct lov_user_mds_data __user *lmdp;
 		struct lov_user_md __user *lump;
                 struct lov_mds_md *lmm = NULL;
                 struct mdt_body *body;
                 char *filename = NULL;
+		bool getinfo = cmd == IOC_MDC_GETFILEINFO ||
+			       cmd == IOC_MDC_GETFILEINFO_LAZY ||
+			       cmd == LL_IOC_MDC_GETINFO;
                 int lmmsize;
 
+		lmdp = (struct lov_user_mds_data __user *)arg;
+		if (cmd == IOC_MDC_GETFILEINFO_LAZY)
+			lmdp = &((struct lov_user_mds_data_lazy __user *)
+				 arg)->lmdl_lmd;
+
                 if (cmd == IOC_MDC_GETFILEINFO ||
+		    cmd == IOC_MDC_GETFILEINFO_LAZY ||
                     cmd == IOC_MDC_GETFILESTRIPE) {
 			filename = ll_getname((const char __user *)arg);
                         if (IS_ERR(filename))
                                 RETURN(PTR_ERR(filename));
 
-                        rc = ll_lov_getstripe_ea_info(inode, filename, &lmm,
-                                                      &lmmsize, &request);
+			rc = ll_lov_getstripe_ea_info(inode, filename, &lmm,
+					&lmmsize, &request,
+					cmd == IOC_MDC_GETFILEINFO_LAZY ?
+					OBD_MD_FLLAZYSIZE |
+					OBD_MD_FLLAZYBLOCKS : 0);
 		} else {
 			rc = ll_dir_getstripe(inode, (void **)&lmm, &lmmsize,
 					      &request, 0);
@@ -1411,8 +1549,7 @@ out_rmdir:
                 }
 
                 if (rc < 0) {
-                        if (rc == -ENODATA && (cmd == IOC_MDC_GETFILEINFO ||
-                                               cmd == LL_IOC_MDC_GETINFO))
+			if (rc == -ENODATA && getinfo)
                                 GOTO(skip_lmm, rc = 0);
                         else
                                 GOTO(out_req, rc);
@@ -1422,8 +1559,6 @@ out_rmdir:
                     cmd == LL_IOC_LOV_GETSTRIPE) {
 			lump = (struct lov_user_md __user *)arg;
                 } else {
-			struct lov_user_mds_data __user *lmdp;
-			lmdp = (struct lov_user_mds_data __user *)arg;
                         lump = &lmdp->lmd_lmm;
                 }
 		if (copy_to_user(lump, lmm, lmmsize)) {
@@ -1432,8 +1567,7 @@ out_rmdir:
                         rc = -EOVERFLOW;
                 }
         skip_lmm:
-                if (cmd == IOC_MDC_GETFILEINFO || cmd == LL_IOC_MDC_GETINFO) {
-			struct lov_user_mds_data __user *lmdp;
+		if (getinfo) {
                         lstat_t st = { 0 };
 
 			st.st_dev	= inode->i_sb->s_dev;
@@ -1450,11 +1584,24 @@ out_rmdir:
 			st.st_ctime	= body->mbo_ctime;
 			st.st_ino	= inode->i_ino;
 
-			lmdp = (struct lov_user_mds_data __user *)arg;
 			if (copy_to_user(&lmdp->lmd_st, &st, sizeof(st)))
                                 GOTO(out_req, rc = -EFAULT);
                 }
 
+		if (cmd == IOC_MDC_GETFILEINFO_LAZY) {
+			struct lov_user_mds_data_lazy __user *lmdl;
+			__u32 lazy = 0;
+
+			if (body->mbo_valid & OBD_MD_FLLAZYSIZE)
+				lazy |= LL_LAZY_SIZE;
+			if (body->mbo_valid & OBD_MD_FLLAZYBLOCKS)
+				lazy |= LL_LAZY_BLOCKS;
+
+			lmdl = (struct lov_user_mds_data_lazy __user *)arg;
+			if (put_user(lazy, &lmdl->lmdl_lazy))
+				GOTO(out_req, rc = -EFAULT);
+		}
+
                 EXIT;
         out_req:
                 ptlrpc_req_finished(request);
@@ -1545,6 +1692,9 @@ out_rmdir:
 		RETURN(ll_fid2path(inode, (void __user *)arg));
 	case LL_IOC_GETPARENT:
 		RETURN(ll_getparent(file, (void __user *)arg));
+	case LL_IOC_GETATTR_BATCH:
+		RETURN(ll_dir_getattr_batch(inode,
+				(struct ll_getattr_batch __user *)arg));
 	case LL_IOC_FID2MDTIDX: {
 		struct obd_export *exp = ll_i2mdexp(inode);
 		struct lu_fid	  fid;
@@ -113,8 +113,9 @@ static void ll_prepare_close(struct inode *inode, struct md_op_data *op_data,
 	if (och->och_flags & FMODE_WRITE &&
 	    ll_file_test_and_clear_flag(ll_i2info(inode), LLIF_DATA_MODIFIED))
 		/* For HSM: if inode data has been modified, pack it so that
-		 * MDT can set data dirty flag in the archive. */
-		op_data->op_bias |= MDS_DATA_MODIFIED;
+		 * MDT can set data dirty flag in the archive. The size and
+		 * blocks known here also refresh the lazy size-on-MDT. */
+		op_data->op_bias |= MDS_DATA_MODIFIED | MDS_CLOSE_LSOM;
 
 	EXIT;
 }
@@ -643,6 +644,7 @@ restart:
                 GOTO(out_och_free, rc);
 
 	cl_lov_delay_create_clear(&file->f_flags);
+	ll_pcc_open(inode, file);
 	GOTO(out_och_free, rc);
 
 out_och_free:
@@ -1031,8 +1033,199 @@ static void ll_io_init(struct cl_io *io, const struct file *file, int write)
         }
 
 	io->ci_noatime = file_is_noatime(file);
+	io->ci_designated_mirror = LUSTRE_FPRIVATE(file)->fd_designated_mirror;
 }
 
+/**
+ * Check whether the file keeps its data on the MDT, see LOV_PATTERN_MDT.
+ *
+ * The layout of a DoM file cannot be swapped, so the flag cached when the
+ * layout was applied stays valid. Only a file without a layout yet may
+ * get one, fetch it in that case.
+ */
+bool ll_file_is_dom(struct inode *inode)
+{
+	struct ll_inode_info	*lli = ll_i2info(inode);
+	__u32			 gen;
+
+	if (!S_ISREG(inode->i_mode) || lli->lli_clob == NULL ||
+	    !exp_connect_dom(ll_i2mdexp(inode)))
+		return false;
+
+	gen = ll_layout_version_get(lli);
+	if ((gen == CL_LAYOUT_GEN_NONE || gen == CL_LAYOUT_GEN_EMPTY) &&
+	    ll_layout_refresh(inode, &gen) != 0)
+		return false;
+
+	return ll_file_test_flag(lli, LLIF_DOM);
+}
+
+#ifdef HAVE_FILE_OPERATIONS_READ_WRITE_ITER
+static int ll_inode_revalidate(struct dentry *dentry, __u64 ibits);
+
+/**
+ * Read or write a Data-on-MDT file.
+ *
+ * The data is not cached on the client, it is sent to the MDT with
+ * md_dom_rw() in chunks which fit into a single bulk. The MDT serializes
+ * the transfers with its DOM lock, which also revokes the getattr locks
+ * of other clients on write, so their cached size is refreshed.
+ */
+static ssize_t ll_dom_io(struct vvp_io_args *args, struct file *file,
+			 enum cl_io_type iot, loff_t *ppos, size_t count)
+{
+	struct inode		*inode = file->f_path.dentry->d_inode;
+	struct ll_inode_info	*lli = ll_i2info(inode);
+	struct iov_iter		*iter = args->u.normal.via_iter;
+	int			 cmd = iot == CIT_WRITE ? OBD_BRW_WRITE :
+							  OBD_BRW_READ;
+	struct range_lock	 range;
+	bool			 range_locked = false;
+	struct page		**pages = NULL;
+	struct obdo		*oa = NULL;
+	int			 npages = 0;
+	ssize_t			 result = 0;
+	int			 i, rc = 0;
+
+	ENTRY;
+
+	if (args->via_io_subtype != IO_NORMAL)
+		RETURN(-EOPNOTSUPP);
+
+	if (iot == CIT_WRITE) {
+		if (file->f_flags & O_APPEND)
+			range_lock_init(&range, 0, LUSTRE_EOF);
+		else
+			range_lock_init(&range, *ppos, *ppos + count - 1);
+		rc = range_lock(&lli->lli_write_tree, &range);
+		if (rc < 0)
+			RETURN(rc);
+		range_locked = true;
+
+		if (file->f_flags & O_APPEND) {
+			rc = ll_inode_revalidate(file->f_path.dentry,
+						 MDS_INODELOCK_UPDATE);
+			if (rc != 0)
+				GOTO(out, rc);
+			*ppos = i_size_read(inode);
+		}
+	}
+
+	/* pages cached by mmap, see ll_dom_vm_ops, must not hide the data
+	 * sent directly */
+	if (count > 0 && inode->i_mapping->nrpages != 0) {
+		loff_t end = *ppos + count - 1;
+
+		rc = filemap_write_and_wait_range(inode->i_mapping, *ppos, end);
+		if (rc == 0 && iot == CIT_WRITE)
+			rc = invalidate_inode_pages2_range(inode->i_mapping,
+							   *ppos >> PAGE_SHIFT,
+							   end >> PAGE_SHIFT);
+		if (rc != 0)
+			GOTO(out, rc);
+	}
+
+	OBD_ALLOC_PTR(oa);
+	if (oa == NULL)
+		GOTO(out, rc = -ENOMEM);
+
+	npages = min_t(size_t, LNET_MTU >> PAGE_SHIFT,
+		       ((*ppos & ~PAGE_MASK) + count + PAGE_SIZE - 1) >>
+		       PAGE_SHIFT);
+	OBD_ALLOC(pages, npages * sizeof(*pages));
+	if (pages == NULL)
+		GOTO(out, rc = -ENOMEM);
+	for (i = 0; i < npages; i++) {
+		pages[i] = alloc_page(GFP_NOFS);
+		if (pages[i] == NULL)
+			GOTO(out, rc = -ENOMEM);
+	}
+
+	while (count > 0) {
+		loff_t		pos = *ppos;
+		unsigned int	pgoff = pos & ~PAGE_MASK;
+		size_t		chunk;
+		size_t		left;
+		int		nr;
+
+		/* stay within one LNET_MTU aligned bulk */
+		chunk = min_t(size_t, count, LNET_MTU - (pos & (LNET_MTU - 1)));
+		nr = (pgoff + chunk + PAGE_SIZE - 1) >> PAGE_SHIFT;
+		LASSERT(nr <= npages);
+
+		if (cmd == OBD_BRW_WRITE) {
+			for (i = 0, left = chunk; left > 0; i++) {
+				size_t len = min_t(size_t, PAGE_SIZE - pgoff,
+						   left);
+
+				if (copy_page_from_iter(pages[i], pgoff, len,
+							iter) != len)
+					GOTO(out, rc = -EFAULT);
+				left -= len;
+				pgoff = 0;
+			}
+		}
+
+		memset(oa, 0, sizeof(*oa));
+		oa->o_oi.oi_fid = lli->lli_fid;
+		oa->o_valid = OBD_MD_FLID | OBD_MD_FLGROUP;
+		if (cmd == OBD_BRW_WRITE) {
+			oa->o_mtime = oa->o_ctime = get_seconds();
+			oa->o_valid |= OBD_MD_FLMTIME | OBD_MD_FLCTIME;
+		}
+
+		rc = md_dom_rw(ll_i2mdexp(inode), cmd, oa, pos, chunk, pages,
+			       nr);
+		if (rc < 0)
+			break;
+
+		if (cmd == OBD_BRW_READ) {
+			pgoff = pos & ~PAGE_MASK;
+			for (i = 0, left = rc; left > 0; i++) {
+				size_t len = min_t(size_t, PAGE_SIZE - pgoff,
+						   left);
+
+				if (copy_page_to_iter(pages[i], pgoff, len,
+						      iter) != len)
+					GOTO(out, rc = -EFAULT);
+				left -= len;
+				pgoff = 0;
+			}
+		}
+
+		result += rc;
+		count -= rc;
+		*ppos += rc;
+
+		if (cmd == OBD_BRW_WRITE) {
+			ll_inode_size_lock(inode);
+			if (*ppos > i_size_read(inode))
+				i_size_write(inode, *ppos);
+			ll_inode_size_unlock(inode);
+		}
+
+		/* short read at EOF */
+		if ((size_t)rc < chunk)
+			break;
+		rc = 0;
+	}
+	EXIT;
+out:
+	if (pages != NULL) {
+		for (i = 0; i < npages; i++)
+			if (pages[i] != NULL)
+				__free_page(pages[i]);
+		OBD_FREE(pages, npages * sizeof(*pages));
+	}
+	if (oa != NULL)
+		OBD_FREE_PTR(oa);
+	if (range_locked)
+		range_unlock(&lli->lli_write_tree, &range);
+
+	return result > 0 ? result : rc;
+}
+#endif /* HAVE_FILE_OPERATIONS_READ_WRITE_ITER */
+
 static ssize_t
 ll_file_io_generic(const struct lu_env *env, struct vvp_io_args *args,
 		   struct file *file, enum cl_io_type iot,
@@ -1052,6 +1245,19 @@ ll_file_io_generic(const struct lu_env *env, struct vvp_io_args *args,
 	CDEBUG(D_VFSTRACE, "file: %s, type: %d ppos: "LPU64", count: %zu\n",
 		file->f_path.dentry->d_name.name, iot, *ppos, count);
 
+#ifdef HAVE_FILE_OPERATIONS_READ_WRITE_ITER
+	if (ll_file_is_dom(inode)) {
+		result = ll_dom_io(args, file, iot, ppos, count);
+		if (result > 0)
+			ll_stats_ops_tally(ll_i2sbi(inode), iot == CIT_READ ?
+					   LPROC_LL_READ_BYTES :
+					   LPROC_LL_WRITE_BYTES, result);
+		if (iot == CIT_WRITE)
+			fd->fd_write_failed = result < 0;
+		RETURN(result);
+	}
+#endif
+
 restart:
 	io = vvp_env_thread_io(env);
 	ll_io_init(io, file, iot == CIT_WRITE);
@@ -1138,6 +1344,10 @@ out:
 		goto restart;
 	}
 
+	/* components of a composite layout could not be instantiated */
+	if (rc == -ENODATA && io->ci_result < 0)
+		rc = io->ci_result;
+
 	if (iot == CIT_READ) {
 		if (result > 0)
 			ll_stats_ops_tally(ll_i2sbi(inode),
@@ -1171,8 +1381,13 @@ static ssize_t ll_file_read_iter(struct kiocb *iocb, struct iov_iter *to)
 	struct vvp_io_args *args;
 	struct lu_env *env;
 	ssize_t result;
+	bool cached;
 	__u16 refcheck;
 
+	result = ll_pcc_read_iter(iocb, to, &cached);
+	if (cached)
+		return result;
+
 	env = cl_env_get(&refcheck);
 	if (IS_ERR(env))
 		return PTR_ERR(env);
@@ -1470,8 +1685,8 @@ out_unlock:
 }
 
 int ll_lov_getstripe_ea_info(struct inode *inode, const char *filename,
-                             struct lov_mds_md **lmmp, int *lmm_size,
-                             struct ptlrpc_request **request)
+			     struct lov_mds_md **lmmp, int *lmm_size,
+			     struct ptlrpc_request **request, u64 valid)
 {
         struct ll_sb_info *sbi = ll_i2sbi(inode);
         struct mdt_body  *body;
@@ -1490,7 +1705,7 @@ int ll_lov_getstripe_ea_info(struct inode *inode, const char *filename,
         if (IS_ERR(op_data))
                 RETURN(PTR_ERR(op_data));
 
-        op_data->op_valid = OBD_MD_FLEASIZE | OBD_MD_FLDIREA;
+	op_data->op_valid = valid | OBD_MD_FLEASIZE | OBD_MD_FLDIREA;
         rc = md_getattr_name(sbi->ll_md_exp, op_data, &req);
         ll_finish_md_op_data(op_data);
         if (rc < 0) {
@@ -1513,7 +1728,8 @@ int ll_lov_getstripe_ea_info(struct inode *inode, const char *filename,
         LASSERT(lmm != NULL);
 
         if ((lmm->lmm_magic != cpu_to_le32(LOV_MAGIC_V1)) &&
-            (lmm->lmm_magic != cpu_to_le32(LOV_MAGIC_V3))) {
+	    (lmm->lmm_magic != cpu_to_le32(LOV_MAGIC_V3)) &&
+	    (lmm->lmm_magic != cpu_to_le32(LOV_MAGIC_COMP_V1))) {
                 GOTO(out, rc = -EPROTO);
         }
 
@@ -1544,6 +1760,9 @@ int ll_lov_getstripe_ea_info(struct inode *inode, const char *filename,
                                 lustre_swab_lov_user_md_objects(
                                  ((struct lov_user_md_v3 *)lmm)->lmm_objects,
                                  stripe_count);
+		} else if (lmm->lmm_magic == cpu_to_le32(LOV_MAGIC_COMP_V1)) {
+			lustre_swab_lov_comp_md_v1(
+				(struct lov_comp_md_v1 *)lmm, lmmsize);
                 }
         }
 
@@ -1613,7 +1832,13 @@ static int ll_lov_setstripe(struct inode *inode, struct file *file,
 
 	lum_size = rc;
 	rc = ll_lov_setstripe_ea_info(inode, file, flags, klum, lum_size);
-	if (rc == 0) {
+	if (rc == 0 && klum->lmm_magic == LOV_USER_MAGIC_COMP_V1) {
+		__u32 gen;
+
+		/* the components are instantiated later, by the writes to
+		 * them, there are no objects to return yet */
+		ll_layout_refresh(inode, &gen);
+	} else if (rc == 0) {
 		__u32 gen;
 
 		put_user(0, &lum->lmm_stripe_count);
@@ -2545,6 +2770,80 @@ out:
 
 		RETURN(ll_file_futimes_3(file, &lfu));
 	}
+	case LL_IOC_FLR_SET_MIRROR: {
+		/* the page cache is shared by all the mirrors, the IO to a
+		 * designated mirror has to bypass it */
+		if (arg != 0 && !(file->f_flags & O_DIRECT))
+			RETURN(-EINVAL);
+		if (arg > LOV_MAX_MIRROR_COUNT)
+			RETURN(-EINVAL);
+		if (arg != 0 && (file->f_mode & FMODE_WRITE) &&
+		    !fd->fd_resync)
+			RETURN(-EPERM);
+
+		fd->fd_designated_mirror = arg;
+		RETURN(0);
+	}
+	case LL_IOC_MIRROR_RESYNC_START:
+	case LL_IOC_MIRROR_RESYNC_DONE: {
+		struct layout_intent intent = {
+			.li_opc = LAYOUT_INTENT_RESYNC,
+			.li_start = 0,
+			.li_end = LUSTRE_EOF,
+		};
+		__u32 gen;
+
+		if (!(file->f_mode & FMODE_WRITE))
+			RETURN(-EBADF);
+
+		/* the MDT checks the file was not written since resync
+		 * started, the layout generation changes on each write */
+		if (cmd == LL_IOC_MIRROR_RESYNC_DONE) {
+			if (get_user(gen, (__u32 __user *)arg))
+				RETURN(-EFAULT);
+			intent.li_opc = LAYOUT_INTENT_RESYNC_DONE;
+			intent.li_flags = gen;
+		}
+
+		rc = ll_layout_write_intent(inode, &intent);
+		if (cmd == LL_IOC_MIRROR_RESYNC_DONE) {
+			fd->fd_resync = false;
+			fd->fd_designated_mirror = 0;
+			RETURN(rc);
+		}
+		if (rc != 0)
+			RETURN(rc);
+		fd->fd_resync = true;
+
+		rc = ll_layout_refresh(inode, &gen);
+		if (rc != 0)
+			RETURN(rc);
+
+		RETURN(put_user(gen, (__u32 __user *)arg));
+	}
+	case LL_IOC_PCC_ATTACH:
+		RETURN(ll_pcc_attach(inode, file));
+	case LL_IOC_PCC_DETACH:
+		if (!S_ISREG(inode->i_mode))
+			RETURN(-EINVAL);
+
+		ll_pcc_detach(inode);
+		RETURN(0);
+	case LL_IOC_PCC_STATE: {
+		struct lu_pcc_state *state;
+
+		OBD_ALLOC_PTR(state);
+		if (state == NULL)
+			RETURN(-ENOMEM);
+
+		rc = ll_pcc_state(inode, state);
+		if (rc == 0 &&
+		    copy_to_user((void __user *)arg, state, sizeof(*state)))
+			rc = -EFAULT;
+
+		OBD_FREE_PTR(state);
+		RETURN(rc);
+	}
 	default: {
 		int err;
 
@@ -3791,6 +4090,7 @@ int ll_layout_conf(struct inode *inode, const struct cl_object_conf *conf)
 		       PFID(&lli->lli_fid), ll_layout_version_get(lli),
 		       cl.cl_layout_gen);
 		ll_layout_version_set(lli, cl.cl_layout_gen);
+		ll_file_update_dom(lli, &cl);
 	}
 
 out:
@@ -3951,7 +4251,11 @@ out:
 	RETURN(rc);
 }
 
-static int ll_layout_refresh_locked(struct inode *inode)
+/**
+ * Enqueue a layout lock with the intent \a intent and apply the layout
+ * returned with it.
+ */
+static int ll_layout_intent(struct inode *inode, struct layout_intent *intent)
 {
 	struct ll_inode_info  *lli = ll_i2info(inode);
 	struct ll_sb_info     *sbi = ll_i2sbi(inode);
@@ -3968,32 +4272,24 @@ static int ll_layout_refresh_locked(struct inode *inode)
 	int rc;
 	ENTRY;
 
-again:
-	/* mostly layout lock is caching on the local side, so try to match
-	 * it before grabbing layout lock mutex. */
-	mode = ll_take_md_lock(inode, MDS_INODELOCK_LAYOUT, &lockh, 0,
-			       LCK_CR | LCK_CW | LCK_PR | LCK_PW);
-	if (mode != 0) { /* hit cached lock */
-		rc = ll_layout_lock_set(&lockh, mode, inode);
-		if (rc == -EAGAIN)
-			goto again;
-
-		RETURN(rc);
-	}
-
 	op_data = ll_prep_md_op_data(NULL, inode, inode, NULL,
 				     0, 0, LUSTRE_OPC_ANY, NULL);
 	if (IS_ERR(op_data))
 		RETURN(PTR_ERR(op_data));
 
+	op_data->op_data = intent;
+	op_data->op_data_size = sizeof(*intent);
+
 	/* have to enqueue one */
 	memset(&it, 0, sizeof(it));
 	it.it_op = IT_LAYOUT;
 	lockh.cookie = 0ULL;
 
-	LDLM_DEBUG_NOLOCK("%s: requeue layout lock for file "DFID"(%p)",
+	LDLM_DEBUG_NOLOCK("%s: requeue layout lock for file "DFID"(%p) "
+			  "intent %u ["LPU64", "LPU64")",
 			  ll_get_fsname(inode->i_sb, NULL, 0),
-			  PFID(&lli->lli_fid), inode);
+			  PFID(&lli->lli_fid), inode, intent->li_opc,
+			  intent->li_start, intent->li_end);
 
 	rc = md_enqueue(sbi->ll_md_exp, &einfo, NULL, &it, op_data, &lockh, 0);
 	if (it.d.lustre.it_data != NULL)
@@ -4010,10 +4306,38 @@ again:
 		/* set lock data in case this is a new lock */
 		ll_set_lock_data(sbi->ll_md_exp, inode, &it, NULL);
 		rc = ll_layout_lock_set(&lockh, mode, inode);
+	}
+
+	RETURN(rc);
+}
+
+static int ll_layout_refresh_locked(struct inode *inode)
+{
+	struct layout_intent	intent = {
+		.li_opc = LAYOUT_INTENT_ACCESS,
+	};
+	struct lustre_handle	lockh;
+	enum ldlm_mode		mode;
+	int rc;
+	ENTRY;
+
+again:
+	/* mostly layout lock is caching on the local side, so try to match
+	 * it before grabbing layout lock mutex. */
+	mode = ll_take_md_lock(inode, MDS_INODELOCK_LAYOUT, &lockh, 0,
+			       LCK_CR | LCK_CW | LCK_PR | LCK_PW);
+	if (mode != 0) { /* hit cached lock */
+		rc = ll_layout_lock_set(&lockh, mode, inode);
 		if (rc == -EAGAIN)
 			goto again;
+
+		RETURN(rc);
 	}
 
+	rc = ll_layout_intent(inode, &intent);
+	if (rc == -EAGAIN)
+		goto again;
+
 	RETURN(rc);
 }
 
@@ -4059,6 +4383,35 @@ out:
 	RETURN(rc);
 }
 
+/**
+ * Ask the MDT to instantiate the components of a composite layout covering
+ * the extent of \a intent the client is about to write to, and fetch the
+ * new layout. For a mirrored file the MDT also marks the other mirrors
+ * stale in that extent, and the resync intents change the mirror state.
+ *
+ * \param[in] inode	file being written
+ * \param[in] intent	layout intent, LAYOUT_INTENT_WRITE, TRUNC, RESYNC
+ *			or RESYNC_DONE with the extent it applies to
+ *
+ * \retval 0		on success
+ * \retval negative	negated errno on error
+ */
+int ll_layout_write_intent(struct inode *inode, struct layout_intent *intent)
+{
+	struct ll_inode_info	*lli = ll_i2info(inode);
+	int rc;
+	ENTRY;
+
+	mutex_lock(&lli->lli_layout_mutex);
+	rc = ll_layout_intent(inode, intent);
+	/* the new layout was applied after the running IO finished */
+	if (rc == -EAGAIN)
+		rc = ll_layout_refresh_locked(inode);
+	mutex_unlock(&lli->lli_layout_mutex);
+
+	RETURN(rc);
+}
+
 /**
  *  This function send a restore request to the MDT
  */
@@ -97,6 +97,14 @@ int cl_setattr_ost(struct cl_object *obj, const struct iattr *attr,
 	io->u.ci_setattr.sa_attr_flags = attr_flags;
 	io->u.ci_setattr.sa_valid = attr->ia_valid;
 	io->u.ci_setattr.sa_parent_fid = lu_object_fid(&obj->co_lu);
+	/* resync truncates the mirror it copied the data to */
+	if (attr->ia_valid & ATTR_FILE) {
+		struct ll_file_data *fd = LUSTRE_FPRIVATE(attr->ia_file);
+
+		if (fd->fd_designated_mirror > 0 && !fd->fd_resync)
+			GOTO(out, result = -EPERM);
+		io->ci_designated_mirror = fd->fd_designated_mirror;
+	}
 
 again:
         if (cl_io_init(env, io, CIT_SETATTR, io->ci_obj) == 0) {
@@ -114,7 +122,7 @@ again:
         cl_io_fini(env, io);
 	if (unlikely(io->ci_need_restart))
 		goto again;
-
+out:
 	cl_env_put(env, &refcheck);
 	RETURN(result);
 }
@@ -178,6 +186,15 @@ int cl_file_inode_init(struct inode *inode, struct lustre_md *md)
 		result = cl_conf_set(env, lli->lli_clob, &conf);
 	}
 
+	if (result == 0) {
+		struct cl_layout cl = {
+			.cl_layout_gen = 0,
+		};
+
+		if (cl_object_layout_get(env, lli->lli_clob, &cl) == 0)
+			ll_file_update_dom(lli, &cl);
+	}
+
         cl_env_put(env, &refcheck);
 
         if (result != 0)
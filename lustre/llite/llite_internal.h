@@ -228,6 +228,13 @@ struct ll_inode_info {
 			 * accurate if the file is shared by different jobs.
 			 */
 			char                    lli_jobid[LUSTRE_JOBID_SIZE];
+
+			/* persistent cache, protected by lli_lock: the cached
+			 * copy of the file, bumped on every detach, and the
+			 * read-only opens since the last detach */
+			struct file		*lli_pcc_file;
+			__u32			lli_pcc_gen;
+			__u32			lli_pcc_opens;
 		};
 	};
 
@@ -279,6 +286,12 @@ enum ll_file_flags {
 	LLIF_FILE_RESTORING	= 1,
 	/* Xattr cache is attached to the file */
 	LLIF_XATTR_CACHE	= 2,
+	/* File is being attached to the persistent cache */
+	LLIF_PCC_ATTACHING	= 3,
+	/* File data is compressed on the wire (LUSTRE_COMPR_FL) */
+	LLIF_COMPRESS		= 4,
+	/* File data is stored on the MDT (LOV_PATTERN_MDT) */
+	LLIF_DOM		= 5,
 };
 
 static inline void ll_file_set_flag(struct ll_inode_info *lli,
@@ -299,12 +312,38 @@ static inline bool ll_file_test_flag(struct ll_inode_info *lli,
 	return test_bit(flag, &lli->lli_flags);
 }
 
+static inline bool ll_file_test_and_set_flag(struct ll_inode_info *lli,
+					     enum ll_file_flags flag)
+{
+	return test_and_set_bit(flag, &lli->lli_flags);
+}
+
 static inline bool ll_file_test_and_clear_flag(struct ll_inode_info *lli,
 					       enum ll_file_flags flag)
 {
 	return test_and_clear_bit(flag, &lli->lli_flags);
 }
 
+/* track the LUSTRE_COMPR_FL attribute flag of the file */
+static inline void ll_file_update_compress(struct ll_inode_info *lli,
+					   __u32 flags)
+{
+	if (flags & LUSTRE_COMPR_FL)
+		ll_file_set_flag(lli, LLIF_COMPRESS);
+	else
+		ll_file_clear_flag(lli, LLIF_COMPRESS);
+}
+
+/* track the layout type of the file, updated when a layout is applied */
+static inline void ll_file_update_dom(struct ll_inode_info *lli,
+				      const struct cl_layout *cl)
+{
+	if (cl->cl_is_dom)
+		ll_file_set_flag(lli, LLIF_DOM);
+	else
+		ll_file_clear_flag(lli, LLIF_DOM);
+}
+
 int ll_xattr_cache_destroy(struct inode *inode);
 
 int ll_xattr_cache_get(struct inode *inode,
@@ -508,6 +547,16 @@ struct lustre_client_ocd {
 	struct obd_export	*lco_dt_exp;
 };
 
+/* read-only persistent client cache, see llite/pcc.c */
+struct ll_pcc_info {
+	/* protects pcci_root */
+	struct mutex		pcci_lock;
+	/* directory holding the cached copies, NULL if disabled */
+	char			*pcci_root;
+	/* read-only opens attaching a file, 0 to disable */
+	unsigned int		pcci_auto_attach;
+};
+
 struct ll_sb_info {
 	/* this protects pglist and ra_info.  It isn't safe to
 	 * grab from interrupt contexts */
@@ -578,6 +627,9 @@ struct ll_sb_info {
 
 	/* root squash */
 	struct root_squash_info	  ll_squash;
+
+	/* read-only persistent client cache */
+	struct ll_pcc_info	  ll_pcc;
 };
 
 /*
@@ -679,6 +731,12 @@ struct ll_file_data {
 	bool fd_write_failed;
 	rwlock_t fd_lock; /* protect lcc list */
 	struct list_head fd_lccs; /* list of ll_cl_context */
+	/* mirror the IO through this file goes to, set by the tools
+	 * resynchronizing a mirrored file, 0 if lov picks the mirror */
+	__u32 fd_designated_mirror;
+	/* resync was started through this file, only such a file may
+	 * write to or truncate a designated mirror */
+	bool fd_resync;
 };
 
 extern spinlock_t inode_lock;
@@ -857,8 +915,8 @@ int ll_lov_setstripe_ea_info(struct inode *inode, struct file *file,
 			     __u64  flags, struct lov_user_md *lum,
 			     int lum_size);
 int ll_lov_getstripe_ea_info(struct inode *inode, const char *filename,
-                             struct lov_mds_md **lmm, int *lmm_size,
-                             struct ptlrpc_request **request);
+			     struct lov_mds_md **lmm, int *lmm_size,
+			     struct ptlrpc_request **request, u64 valid);
 int ll_dir_setstripe(struct inode *inode, struct lov_user_md *lump,
                      int set_default);
 int ll_dir_getstripe(struct inode *inode, void **lmmp,
@@ -919,6 +977,8 @@ int ll_show_options(struct seq_file *seq, struct vfsmount *vfs);
 void ll_dirty_page_discard_warn(struct page *page, int ioret);
 int ll_prep_inode(struct inode **inode, struct ptlrpc_request *req,
 		  struct super_block *, struct lookup_intent *);
+int ll_prep_inode_md(struct inode **inode, struct lustre_md *md,
+		     struct super_block *sb, struct lookup_intent *it);
 void lustre_dump_dentry(struct dentry *, int recur);
 int ll_obd_statfs(struct inode *inode, void __user *arg);
 int ll_get_max_mdsize(struct ll_sb_info *sbi, int *max_mdsize);
@@ -960,6 +1020,15 @@ static inline ssize_t ll_lov_user_md_size(const struct lov_user_md *lum)
 
 		return lov_user_md_size(lum->lmm_stripe_count,
 					LOV_USER_MAGIC_SPECIFIC);
+	case LOV_USER_MAGIC_COMP_V1: {
+		const struct lov_comp_md_v1 *lcm = (const void *)lum;
+
+		if (lcm->lcm_size < sizeof(*lcm) ||
+		    lcm->lcm_size > XATTR_SIZE_MAX)
+			return -EINVAL;
+
+		return lcm->lcm_size;
+	}
 	}
 
 	return -EINVAL;
@@ -1124,6 +1193,14 @@ ssize_t ll_getxattr(struct dentry *dentry, const char *name,
 ssize_t ll_listxattr(struct dentry *dentry, char *buffer, size_t size);
 int ll_removexattr(struct dentry *dentry, const char *name);
 
+/* llite/pcc.c */
+int ll_pcc_attach(struct inode *inode, struct file *file);
+void ll_pcc_detach(struct inode *inode);
+void ll_pcc_open(struct inode *inode, struct file *file);
+ssize_t ll_pcc_read_iter(struct kiocb *iocb, struct iov_iter *to,
+			 bool *cached);
+int ll_pcc_state(struct inode *inode, struct lu_pcc_state *state);
+
 /* llite/remote_perm.c */
 extern struct kmem_cache *ll_remote_perm_cachep;
 extern struct kmem_cache *ll_rmtperm_hash_cachep;
@@ -1474,6 +1551,8 @@ static inline void d_lustre_revalidate(struct dentry *dentry)
 int ll_layout_conf(struct inode *inode, const struct cl_object_conf *conf);
 int ll_layout_refresh(struct inode *inode, __u32 *gen);
 int ll_layout_restore(struct inode *inode, loff_t start, __u64 length);
+int ll_layout_write_intent(struct inode *inode, struct layout_intent *intent);
+bool ll_file_is_dom(struct inode *inode);
 
 int ll_xattr_init(void);
 void ll_xattr_fini(void);
@@ -1482,6 +1561,8 @@ int ll_getxattr_common(struct inode *inode, const char *name,
 		       void *buffer, size_t size, __u64 valid);
 int ll_page_sync_io(const struct lu_env *env, struct cl_io *io,
 		    struct cl_page *page, enum cl_req_type crt);
+int ll_prepare_partial_page(const struct lu_env *env, struct cl_io *io,
+			    struct cl_page *pg);
 
 int ll_getparent(struct file *file, struct getparent __user *arg);
 
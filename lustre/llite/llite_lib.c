@@ -140,6 +140,8 @@ static struct ll_sb_info *ll_init_sbi(void)
 	INIT_LIST_HEAD(&sbi->ll_squash.rsi_nosquash_nids);
 	init_rwsem(&sbi->ll_squash.rsi_sem);
 
+	mutex_init(&sbi->ll_pcc.pcci_lock);
+
 	RETURN(sbi);
 }
 
@@ -151,6 +153,9 @@ static void ll_free_sbi(struct super_block *sb)
 	if (sbi != NULL) {
 		if (!list_empty(&sbi->ll_squash.rsi_nosquash_nids))
 			cfs_free_nidlist(&sbi->ll_squash.rsi_nosquash_nids);
+		if (sbi->ll_pcc.pcci_root != NULL)
+			OBD_FREE(sbi->ll_pcc.pcci_root,
+				 strlen(sbi->ll_pcc.pcci_root) + 1);
 		if (sbi->ll_cache != NULL) {
 			cl_cache_decref(sbi->ll_cache);
 			sbi->ll_cache = NULL;
@@ -209,7 +214,18 @@ static int client_common_fill_super(struct super_block *sb, char *md, char *dt,
 				  OBD_CONNECT_DISP_STRIPE | OBD_CONNECT_LFSCK |
 				  OBD_CONNECT_OPEN_BY_FID |
 				  OBD_CONNECT_DIR_STRIPE |
-				  OBD_CONNECT_BULK_MBITS;
+				  OBD_CONNECT_BULK_MBITS |
+				  OBD_CONNECT_FLAGS2;
+
+	data->ocd_connect_flags2 = OBD_CONNECT2_BATCH_GETATTR |
+				   OBD_CONNECT2_BATCH_GETATTR_LOCK |
+				   OBD_CONNECT2_LOCK_CONVERT |
+				   OBD_CONNECT2_BL_BATCH |
+				   OBD_CONNECT2_LOCK_REPLAY_BATCH;
+#ifdef HAVE_FILE_OPERATIONS_READ_WRITE_ITER
+	/* Data-on-MDT IO copies through iov_iter helpers */
+	data->ocd_connect_flags2 |= OBD_CONNECT2_DOM;
+#endif
 
 #ifdef HAVE_LRU_RESIZE_SUPPORT
         if (sbi->ll_flags & LL_SBI_LRU_RESIZE)
@@ -389,6 +405,10 @@ static int client_common_fill_super(struct super_block *sb, char *md, char *dt,
 	 * back its backend blocksize for grant calculation purpose */
 	data->ocd_grant_blkbits = PAGE_SHIFT;
 
+	data->ocd_connect_flags2 = OBD_CONNECT2_BL_BATCH |
+				   OBD_CONNECT2_LOCK_REPLAY_BATCH;
+	if (ptlrpc_bulk_compress_available())
+		data->ocd_connect_flags2 |= OBD_CONNECT2_BRW_COMPRESS;
         data->ocd_connect_flags = OBD_CONNECT_GRANT     | OBD_CONNECT_VERSION  |
 				  OBD_CONNECT_REQPORTAL | OBD_CONNECT_BRW_SIZE |
                                   OBD_CONNECT_CANCELSET | OBD_CONNECT_FID      |
@@ -401,7 +421,7 @@ static int client_common_fill_super(struct super_block *sb, char *md, char *dt,
 				  OBD_CONNECT_JOBSTATS | OBD_CONNECT_LVB_TYPE |
 				  OBD_CONNECT_LAYOUTLOCK |
 				  OBD_CONNECT_PINGLESS | OBD_CONNECT_LFSCK |
-				  OBD_CONNECT_BULK_MBITS;
+				  OBD_CONNECT_BULK_MBITS | OBD_CONNECT_FLAGS2;
 
 	if (!OBD_FAIL_CHECK(OBD_FAIL_OSC_CONNECT_GRANT_PARAM))
 		data->ocd_connect_flags |= OBD_CONNECT_GRANT_PARAM;
@@ -968,6 +988,9 @@ void ll_lli_init(struct ll_inode_info *lli)
 		INIT_LIST_HEAD(&lli->lli_agl_list);
 		lli->lli_agl_index = 0;
 		lli->lli_async_rc = 0;
+		lli->lli_pcc_file = NULL;
+		lli->lli_pcc_gen = 0;
+		lli->lli_pcc_opens = 0;
 	}
 	mutex_init(&lli->lli_layout_mutex);
 }
@@ -1451,6 +1474,9 @@ void ll_clear_inode(struct inode *inode)
         if (lli->lli_mds_read_och)
                 ll_md_real_close(inode, FMODE_READ);
 
+	if (S_ISREG(inode->i_mode))
+		ll_pcc_detach(inode);
+
         if (S_ISLNK(inode->i_mode) && lli->lli_symlink_name) {
                 OBD_FREE(lli->lli_symlink_name,
                          strlen(lli->lli_symlink_name) + 1);
@@ -1655,6 +1681,15 @@ int ll_setattr_raw(struct dentry *dentry, struct iattr *attr, bool hsm_import)
 	if (!S_ISREG(inode->i_mode) || hsm_import)
 		GOTO(out, rc = 0);
 
+	/* the MDT has already truncated the data of a Data-on-MDT file,
+	 * update the local size and drop the pages cached by mmap */
+	if ((attr->ia_valid & ATTR_SIZE) && ll_file_is_dom(inode)) {
+		ll_inode_size_lock(inode);
+		i_size_write(inode, attr->ia_size);
+		ll_inode_size_unlock(inode);
+		ll_truncate_pagecache(inode, attr->ia_size);
+	}
+
 	if (attr->ia_valid & (ATTR_SIZE |
 			      ATTR_ATIME | ATTR_ATIME_SET |
 			      ATTR_MTIME | ATTR_MTIME_SET |
@@ -1929,8 +1964,10 @@ int ll_update_inode(struct inode *inode, struct lustre_md *md)
 		inode->i_uid = make_kuid(&init_user_ns, body->mbo_uid);
 	if (body->mbo_valid & OBD_MD_FLGID)
 		inode->i_gid = make_kgid(&init_user_ns, body->mbo_gid);
-	if (body->mbo_valid & OBD_MD_FLFLAGS)
+	if (body->mbo_valid & OBD_MD_FLFLAGS) {
 		inode->i_flags = ll_ext_to_inode_flags(body->mbo_flags);
+		ll_file_update_compress(lli, body->mbo_flags);
+	}
 	if (body->mbo_valid & OBD_MD_FLNLINK)
 		set_nlink(inode, body->mbo_nlink);
 	if (body->mbo_valid & OBD_MD_FLRDEV)
@@ -2112,6 +2149,7 @@ int ll_iocontrol(struct inode *inode, struct file *file,
 			RETURN(rc);
 
 		inode->i_flags = ll_ext_to_inode_flags(flags);
+		ll_file_update_compress(ll_i2info(inode), flags);
 
 		obj = ll_i2info(inode)->lli_clob;
 		if (obj == NULL)
@@ -2273,25 +2311,23 @@ void ll_open_cleanup(struct super_block *sb, struct ptlrpc_request *open_req)
 	EXIT;
 }
 
-int ll_prep_inode(struct inode **inode, struct ptlrpc_request *req,
-		  struct super_block *sb, struct lookup_intent *it)
+/**
+ * Get or update the inode described by \a md, see ll_prep_inode().
+ *
+ * \a md stays owned by the caller, it can come from a reply which is not a
+ * single getattr such as a batched getattr of statahead.
+ */
+int ll_prep_inode_md(struct inode **inode, struct lustre_md *md,
+		     struct super_block *sb, struct lookup_intent *it)
 {
-	struct ll_sb_info *sbi = NULL;
-	struct lustre_md md = { NULL };
+	struct ll_sb_info *sbi = sb ? ll_s2sbi(sb) : ll_i2sbi(*inode);
 	int rc;
 	ENTRY;
 
-	LASSERT(*inode || sb);
-	sbi = sb ? ll_s2sbi(sb) : ll_i2sbi(*inode);
-	rc = md_get_lustre_md(sbi->ll_md_exp, req, sbi->ll_dt_exp,
-			      sbi->ll_md_exp, &md);
-	if (rc != 0)
-		GOTO(cleanup, rc);
-
 	if (*inode) {
-		rc = ll_update_inode(*inode, &md);
+		rc = ll_update_inode(*inode, md);
 		if (rc != 0)
-			GOTO(out, rc);
+			RETURN(rc);
 	} else {
 		LASSERT(sb != NULL);
 
@@ -2299,22 +2335,22 @@ int ll_prep_inode(struct inode **inode, struct ptlrpc_request *req,
                  * At this point server returns to client's same fid as client
                  * generated for creating. So using ->fid1 is okay here.
                  */
-		LASSERT(fid_is_sane(&md.body->mbo_fid1));
+		LASSERT(fid_is_sane(&md->body->mbo_fid1));
 
-		*inode = ll_iget(sb, cl_fid_build_ino(&md.body->mbo_fid1,
+		*inode = ll_iget(sb, cl_fid_build_ino(&md->body->mbo_fid1,
 					     sbi->ll_flags & LL_SBI_32BIT_API),
-				 &md);
+				 md);
 		if (IS_ERR(*inode)) {
 #ifdef CONFIG_FS_POSIX_ACL
-                        if (md.posix_acl) {
-                                posix_acl_release(md.posix_acl);
-                                md.posix_acl = NULL;
+                        if (md->posix_acl) {
+                                posix_acl_release(md->posix_acl);
+                                md->posix_acl = NULL;
                         }
 #endif
                         rc = IS_ERR(*inode) ? PTR_ERR(*inode) : -ENOMEM;
                         *inode = NULL;
                         CERROR("new_inode -fatal: rc %d\n", rc);
-                        GOTO(out, rc);
+                        RETURN(rc);
                 }
         }
 
@@ -2340,15 +2376,32 @@ int ll_prep_inode(struct inode **inode, struct ptlrpc_request *req,
 			conf.coc_opc = OBJECT_CONF_SET;
 			conf.coc_inode = *inode;
 			conf.coc_lock = lock;
-			conf.u.coc_layout = md.layout;
+			conf.u.coc_layout = md->layout;
 			(void)ll_layout_conf(*inode, &conf);
 		}
 		LDLM_LOCK_PUT(lock);
 	}
 
-	GOTO(out, rc = 0);
+	RETURN(0);
+}
+
+int ll_prep_inode(struct inode **inode, struct ptlrpc_request *req,
+		  struct super_block *sb, struct lookup_intent *it)
+{
+	struct ll_sb_info *sbi = NULL;
+	struct lustre_md md = { NULL };
+	int rc;
+	ENTRY;
+
+	LASSERT(*inode || sb);
+	sbi = sb ? ll_s2sbi(sb) : ll_i2sbi(*inode);
+	rc = md_get_lustre_md(sbi->ll_md_exp, req, sbi->ll_dt_exp,
+			      sbi->ll_md_exp, &md);
+	if (rc != 0)
+		GOTO(cleanup, rc);
+
+	rc = ll_prep_inode_md(inode, &md, sb, it);
 
-out:
 	md_free_lustre_md(sbi->ll_md_exp, &md);
 
 cleanup:
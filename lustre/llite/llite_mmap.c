@@ -487,6 +487,35 @@ static const struct vm_operations_struct ll_file_vm_ops = {
 	.close			= ll_vm_close,
 };
 
+/**
+ * A Data-on-MDT file has no cl_page stack under its pages, they are read
+ * and written by ll_readpage() and ll_writepage() directly with the MDT.
+ */
+static int ll_dom_page_mkwrite(struct vm_area_struct *vma,
+			       struct vm_fault *vmf)
+{
+	struct inode *inode = vma->vm_file->f_path.dentry->d_inode;
+	struct page *vmpage = vmf->page;
+
+	file_update_time(vma->vm_file);
+	lock_page(vmpage);
+	if (vmpage->mapping != inode->i_mapping) {
+		/* truncated meanwhile */
+		unlock_page(vmpage);
+		return VM_FAULT_NOPAGE;
+	}
+	set_page_dirty(vmpage);
+
+	return VM_FAULT_LOCKED;
+}
+
+static const struct vm_operations_struct ll_dom_vm_ops = {
+	.fault			= filemap_fault,
+	.page_mkwrite		= ll_dom_page_mkwrite,
+	.open			= ll_vm_open,
+	.close			= ll_vm_close,
+};
+
 int ll_file_mmap(struct file *file, struct vm_area_struct * vma)
 {
 	struct inode *inode = file->f_path.dentry->d_inode;
@@ -498,7 +527,11 @@ int ll_file_mmap(struct file *file, struct vm_area_struct * vma)
 
         ll_stats_ops_tally(ll_i2sbi(inode), LPROC_LL_MAP, 1);
         rc = generic_file_mmap(file, vma);
-        if (rc == 0) {
+	if (rc == 0 && ll_file_is_dom(inode)) {
+		/* the size is returned by the MDT with the layout */
+		vma->vm_ops = &ll_dom_vm_ops;
+		vma->vm_ops->open(vma);
+	} else if (rc == 0) {
                 vma->vm_ops = &ll_file_vm_ops;
                 vma->vm_ops->open(vma);
                 /* update the inode's size and mtime */
@@ -37,6 +37,7 @@
 
 #include <linux/version.h>
 #include <linux/user_namespace.h>
+#include <linux/namei.h>
 #ifdef HAVE_UIDGID_HEADER
 # include <linux/uidgid.h>
 #endif
@@ -969,6 +970,109 @@ static ssize_t ll_nosquash_nids_seq_write(struct file *file,
 }
 LPROC_SEQ_FOPS(ll_nosquash_nids);
 
+static int ll_pcc_root_seq_show(struct seq_file *m, void *v)
+{
+	struct super_block *sb = m->private;
+	struct ll_pcc_info *pcci = &ll_s2sbi(sb)->ll_pcc;
+	int rc;
+
+	mutex_lock(&pcci->pcci_lock);
+	rc = seq_printf(m, "%s\n",
+			pcci->pcci_root != NULL ? pcci->pcci_root : "none");
+	mutex_unlock(&pcci->pcci_lock);
+
+	return rc;
+}
+
+/* directory of a local filesystem holding the cached copies, files already
+ * attached keep their copy when it is changed */
+static ssize_t ll_pcc_root_seq_write(struct file *file,
+				     const char __user *buffer,
+				     size_t count, loff_t *off)
+{
+	struct seq_file *m = file->private_data;
+	struct super_block *sb = m->private;
+	struct ll_pcc_info *pcci = &ll_s2sbi(sb)->ll_pcc;
+	struct path path;
+	char *kernbuf;
+	char *root = NULL;
+	int len;
+	int rc;
+
+	if (count >= PATH_MAX)
+		return -ENAMETOOLONG;
+
+	OBD_ALLOC(kernbuf, count + 1);
+	if (kernbuf == NULL)
+		return -ENOMEM;
+	if (copy_from_user(kernbuf, buffer, count))
+		GOTO(out, rc = -EFAULT);
+
+	len = count;
+	while (len > 0 && isspace(kernbuf[len - 1]))
+		kernbuf[--len] = '\0';
+
+	if (len != 0 && strcmp(kernbuf, "none") != 0) {
+		if (kernbuf[0] != '/')
+			GOTO(out, rc = -EINVAL);
+
+		rc = kern_path(kernbuf, LOOKUP_FOLLOW | LOOKUP_DIRECTORY,
+			       &path);
+		if (rc < 0)
+			GOTO(out, rc);
+		/* the cache has to be local to the client */
+		if (path.dentry->d_sb->s_magic == LL_SUPER_MAGIC)
+			rc = -EINVAL;
+		path_put(&path);
+		if (rc < 0)
+			GOTO(out, rc);
+
+		OBD_ALLOC(root, len + 1);
+		if (root == NULL)
+			GOTO(out, rc = -ENOMEM);
+		memcpy(root, kernbuf, len);
+	}
+
+	mutex_lock(&pcci->pcci_lock);
+	swap(pcci->pcci_root, root);
+	mutex_unlock(&pcci->pcci_lock);
+	if (root != NULL)
+		OBD_FREE(root, strlen(root) + 1);
+	rc = count;
+out:
+	OBD_FREE(kernbuf, count + 1);
+	return rc;
+}
+LPROC_SEQ_FOPS(ll_pcc_root);
+
+static int ll_pcc_auto_attach_seq_show(struct seq_file *m, void *v)
+{
+	struct super_block *sb = m->private;
+
+	return seq_printf(m, "%u\n", ll_s2sbi(sb)->ll_pcc.pcci_auto_attach);
+}
+
+static ssize_t ll_pcc_auto_attach_seq_write(struct file *file,
+					    const char __user *buffer,
+					    size_t count, loff_t *off)
+{
+	struct seq_file *m = file->private_data;
+	struct super_block *sb = m->private;
+	int val, rc;
+
+	rc = lprocfs_write_helper(buffer, count, &val);
+	if (rc)
+		return rc;
+
+	if (val < 0)
+		return -ERANGE;
+
+	ll_s2sbi(sb)->ll_pcc.pcci_auto_attach = val;
+
+	return count;
+}
+LPROC_SEQ_FOPS(ll_pcc_auto_attach);
+
 struct lprocfs_vars lprocfs_llite_obd_vars[] = {
 	{ .name	=	"uuid",
 	  .fops	=	&ll_sb_uuid_fops			},
@@ -1028,6 +1132,10 @@ struct lprocfs_vars lprocfs_llite_obd_vars[] = {
 	  .fops	=	&ll_root_squash_fops			},
 	{ .name	=	"nosquash_nids",
 	  .fops	=	&ll_nosquash_nids_fops			},
+	{ .name	=	"pcc_root",
+	  .fops	=	&ll_pcc_root_fops			},
+	{ .name	=	"pcc_auto_attach",
+	  .fops	=	&ll_pcc_auto_attach_fops		},
 	{ NULL }
 };
 
@@ -193,6 +193,15 @@ int ll_md_blocking_ast(struct ldlm_lock *lock, struct ldlm_lock_desc *desc,
 
 	switch (flag) {
 	case LDLM_CB_BLOCKING:
+		/* Only bits shared with the conflicting lock have to go, try
+		 * to keep the others cached. */
+		if (desc != NULL && desc->l_resource.lr_type == LDLM_IBITS &&
+		    ldlm_res_eq(&desc->l_resource.lr_name,
+				&lock->l_resource->lr_name) &&
+		    ldlm_cli_dropbits(lock,
+				desc->l_policy_data.l_inodebits.bits) == 0)
+			break;
+
 		ldlm_lock2handle(lock, &lockh);
 		rc = ldlm_cli_cancel(&lockh, LCF_ASYNC);
 		if (rc < 0) {
@@ -211,8 +220,12 @@ int ll_md_blocking_ast(struct ldlm_lock *lock, struct ldlm_lock_desc *desc,
 		if (inode == NULL)
 			break;
 
-		/* Invalidate all dentries associated with this inode */
-		LASSERT(ldlm_is_canceling(lock));
+		/* A descriptor is only passed by ldlm_cli_dropbits(), with
+		 * the bits dropped from a lock that stays granted. */
+		if (desc != NULL)
+			bits = desc->l_policy_data.l_inodebits.bits;
+		else
+			LASSERT(ldlm_is_canceling(lock));
 
 		if (!fid_res_name_eq(ll_inode2fid(inode),
 				     &lock->l_resource->lr_name)) {
@@ -228,6 +241,17 @@ int ll_md_blocking_ast(struct ldlm_lock *lock, struct ldlm_lock_desc *desc,
 			bits &= ~MDS_INODELOCK_XATTR;
 		}
 
+		/* another client writes the DoM file, drop the pages cached
+		 * by mmap */
+		if (bits & MDS_INODELOCK_DOM) {
+			if (S_ISREG(inode->i_mode) &&
+			    inode->i_mapping->nrpages != 0) {
+				filemap_write_and_wait(inode->i_mapping);
+				invalidate_inode_pages2(inode->i_mapping);
+			}
+			bits &= ~MDS_INODELOCK_DOM;
+		}
+
 		/* For OPEN locks we differentiate between lock modes
 		 * LCK_CR, LCK_CW, LCK_PR - bug 22891 */
 		if (bits & MDS_INODELOCK_OPEN)
@@ -271,6 +295,10 @@ int ll_md_blocking_ast(struct ldlm_lock *lock, struct ldlm_lock_desc *desc,
 				CDEBUG(D_INODE, "cannot invalidate layout of "
 				       DFID": rc = %d\n",
 				       PFID(ll_inode2fid(inode)), rc);
+
+			/* the cached copy is only valid under layout lock */
+			if (S_ISREG(inode->i_mode))
+				ll_pcc_detach(inode);
 		}
 
 		if ((bits & MDS_INODELOCK_UPDATE) && S_ISDIR(inode->i_mode)) {
@@ -0,0 +1,469 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+/*
+ * Copyright (c) 2016, Intel Corporation.
+ */
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ * Lustre is a trademark of Sun Microsystems, Inc.
+ *
+ * lustre/llite/pcc.c
+ *
+ * Read-only persistent client cache. A regular file attached to the cache
+ * has its data copied into a file named after its FID in a directory of a
+ * local filesystem, llite.*.pcc_root, and reads of the file are served from
+ * that copy instead of the OSTs or the page cache.
+ *
+ * Coherence relies on the layout lock: the copy is dropped as soon as the
+ * client holds no layout lock on the file anymore. Attaching sets HS_PCCRO
+ * in the HSM flags of the file, the MDT then revokes the layout locks before
+ * the file is opened for write or truncated by any client, and refuses the
+ * attach while the file is open for write. HSM release and restore, layout
+ * swaps and mirror resync revoke the layout locks as well.
+ *
+ * A file is attached with LL_IOC_PCC_ATTACH, or on the first read after it
+ * was opened read-only llite.*.pcc_auto_attach times on this client.
+ */
+
+#define DEBUG_SUBSYSTEM S_LLITE
+
+#include <linux/file.h>
+#include <linux/fs.h>
+#include <linux/namei.h>
+#include <linux/cred.h>
+#include <obd_support.h>
+#include <lustre_dlm.h>
+
+#include "llite_internal.h"
+
+/* size of the buffer used to copy the file data into the cache */
+#define PCC_COPY_SIZE	(1 << 20)
+
+/**
+ * Return a reference on the cached copy of \a inode, NULL if it has none.
+ */
+static struct file *ll_pcc_file_get(struct inode *inode)
+{
+	struct ll_inode_info	*lli = ll_i2info(inode);
+	struct file		*pcc_file;
+
+	spin_lock(&lli->lli_lock);
+	pcc_file = lli->lli_pcc_file;
+	if (pcc_file != NULL)
+		get_file(pcc_file);
+	spin_unlock(&lli->lli_lock);
+
+	return pcc_file;
+}
+
+/* remove \a dentry from the cache directory if it is still linked there */
+static int ll_pcc_unlink(struct dentry *dentry)
+{
+	struct dentry	*parent = dget_parent(dentry);
+	struct inode	*dir = parent->d_inode;
+	int		 rc = 0;
+
+	mutex_lock_nested(&dir->i_mutex, I_MUTEX_PARENT);
+	if (dentry->d_parent == parent && dentry->d_inode != NULL &&
+	    !d_unhashed(dentry))
+		rc = ll_vfs_unlink(dir, dentry);
+	mutex_unlock(&dir->i_mutex);
+	dput(parent);
+
+	return rc;
+}
+
+/* drop a cached copy, its data is released with the last reader */
+static void ll_pcc_file_remove(struct file *pcc_file)
+{
+	const struct cred	*old_cred;
+	struct cred		*cred;
+	int			 rc = -ENOMEM;
+
+	/* the cache directory is only writable by root */
+	cred = prepare_kernel_cred(NULL);
+	if (cred != NULL) {
+		old_cred = override_creds(cred);
+		rc = ll_pcc_unlink(pcc_file->f_path.dentry);
+		revert_creds(old_cred);
+		put_cred(cred);
+	}
+	if (rc < 0)
+		CDEBUG(D_INODE, "cannot remove cached copy %.*s: rc = %d\n",
+		       pcc_file->f_path.dentry->d_name.len,
+		       pcc_file->f_path.dentry->d_name.name, rc);
+
+	fput(pcc_file);
+}
+
+/**
+ * Drop the cached copy of \a inode. Called when the client loses its last
+ * layout lock on the file, on request, and when the inode is cleared.
+ * Attaches in progress fail.
+ */
+void ll_pcc_detach(struct inode *inode)
+{
+	struct ll_inode_info	*lli = ll_i2info(inode);
+	struct file		*pcc_file;
+
+	spin_lock(&lli->lli_lock);
+	lli->lli_pcc_gen++;
+	lli->lli_pcc_opens = 0;
+	pcc_file = lli->lli_pcc_file;
+	lli->lli_pcc_file = NULL;
+	spin_unlock(&lli->lli_lock);
+
+	if (pcc_file == NULL)
+		return;
+
+	CDEBUG(D_INODE, "%s: detach "DFID" from the persistent cache\n",
+	       ll_get_fsname(inode->i_sb, NULL, 0), PFID(ll_inode2fid(inode)));
+	ll_pcc_file_remove(pcc_file);
+}
+
+/* create the file holding the copy of \a inode in the cache directory */
+static struct file *ll_pcc_file_create(struct inode *inode)
+{
+	struct ll_sb_info	*sbi = ll_i2sbi(inode);
+	const struct cred	*old_cred;
+	struct cred		*cred;
+	struct file		*pcc_file;
+	struct path		 path;
+	char			*name = NULL;
+	int			 rc;
+	ENTRY;
+
+	mutex_lock(&sbi->ll_pcc.pcci_lock);
+	if (sbi->ll_pcc.pcci_root != NULL)
+		name = kasprintf(GFP_NOFS, "%s/"DFID_NOBRACE,
+				 sbi->ll_pcc.pcci_root,
+				 PFID(ll_inode2fid(inode)));
+	rc = sbi->ll_pcc.pcci_root == NULL ? -EOPNOTSUPP : -ENOMEM;
+	mutex_unlock(&sbi->ll_pcc.pcci_lock);
+	if (name == NULL)
+		RETURN(ERR_PTR(rc));
+
+	cred = prepare_kernel_cred(NULL);
+	if (cred == NULL)
+		GOTO(out_name, pcc_file = ERR_PTR(-ENOMEM));
+	old_cred = override_creds(cred);
+
+	pcc_file = filp_open(name, O_CREAT | O_EXCL | O_RDWR | O_LARGEFILE,
+			     S_IRUSR | S_IWUSR);
+	/* left behind by a copy which did not complete, or by a client which
+	 * was not unmounted cleanly, nobody is using it */
+	if (IS_ERR(pcc_file) && PTR_ERR(pcc_file) == -EEXIST &&
+	    kern_path(name, 0, &path) == 0) {
+		rc = ll_pcc_unlink(path.dentry);
+		path_put(&path);
+		if (rc == 0)
+			pcc_file = filp_open(name, O_CREAT | O_EXCL | O_RDWR |
+					     O_LARGEFILE, S_IRUSR | S_IWUSR);
+	}
+
+	revert_creds(old_cred);
+	put_cred(cred);
+
+	if (IS_ERR(pcc_file))
+		GOTO(out_name, pcc_file);
+
+#ifdef HAVE_FILE_OPERATIONS_READ_WRITE_ITER
+	if (pcc_file->f_op->read_iter == NULL) {
+#else
+	if (pcc_file->f_op->aio_read == NULL) {
+#endif
+		CERROR("%s: the persistent cache %s does not support AIO\n",
+		       ll_get_fsname(inode->i_sb, NULL, 0), name);
+		ll_pcc_file_remove(pcc_file);
+		GOTO(out_name, pcc_file = ERR_PTR(-EOPNOTSUPP));
+	}
+	EXIT;
+out_name:
+	kfree(name);
+	return pcc_file;
+}
+
+/* copy the data of the lustre file \a src into \a dst */
+static int ll_pcc_copy(struct file *src, struct file *dst)
+{
+	mm_segment_t	 fs;
+	loff_t		 rpos = 0;
+	loff_t		 wpos = 0;
+	ssize_t		 rc;
+	ssize_t		 wrc;
+	char		*buf;
+	ENTRY;
+
+	OBD_ALLOC_LARGE(buf, PCC_COPY_SIZE);
+	if (buf == NULL)
+		RETURN(-ENOMEM);
+
+	fs = get_fs();
+	set_fs(KERNEL_DS);
+	while (1) {
+		if (fatal_signal_pending(current))
+			GOTO(out, rc = -EINTR);
+
+		rc = vfs_read(src, (char __user *)buf, PCC_COPY_SIZE, &rpos);
+		if (rc <= 0)
+			GOTO(out, rc);
+
+		wrc = vfs_write(dst, (const char __user *)buf, rc, &wpos);
+		if (wrc != rc)
+			GOTO(out, rc = wrc < 0 ? wrc : -ENOSPC);
+	}
+	EXIT;
+out:
+	set_fs(fs);
+	OBD_FREE_LARGE(buf, PCC_COPY_SIZE);
+
+	return rc;
+}
+
+/**
+ * Copy the data of \a inode into the persistent cache and serve the reads
+ * of the file from that copy from now on.
+ *
+ * \param[in] inode	regular file to attach
+ * \param[in] file	open file of \a inode used to read its data
+ *
+ * \retval 0		on success, or if the file is already attached
+ * \retval -EOPNOTSUPP	no persistent cache is configured
+ * \retval -EBUSY	the file is open for write, being attached, or it
+ *			was modified or its layout changed while being copied
+ * \retval negative	other negated errno on error
+ */
+int ll_pcc_attach(struct inode *inode, struct file *file)
+{
+	struct ll_inode_info	*lli = ll_i2info(inode);
+	struct ll_sb_info	*sbi = ll_i2sbi(inode);
+	struct hsm_state_set	 hss = {
+		.hss_valid = HSS_SETMASK,
+		.hss_setmask = HS_PCCRO,
+	};
+	struct md_op_data	*op_data;
+	struct file		*pcc_file;
+	__u64			 dv1;
+	__u64			 dv2;
+	__u32			 gen;
+	__u32			 layout_gen;
+	int			 rc;
+	ENTRY;
+
+	if (!S_ISREG(inode->i_mode))
+		RETURN(-EINVAL);
+	if (!(file->f_mode & FMODE_READ))
+		RETURN(-EBADF);
+	/* without layout lock there is no way to tell the copy is stale */
+	if (!(sbi->ll_flags & LL_SBI_LAYOUT_LOCK))
+		RETURN(-EOPNOTSUPP);
+
+	if (ll_file_test_and_set_flag(lli, LLIF_PCC_ATTACHING))
+		RETURN(-EBUSY);
+
+	pcc_file = ll_pcc_file_get(inode);
+	if (pcc_file != NULL) {
+		fput(pcc_file);
+		GOTO(out, rc = 0);
+	}
+
+	/* any loss of the layout lock from now on fails the attach */
+	spin_lock(&lli->lli_lock);
+	gen = lli->lli_pcc_gen;
+	spin_unlock(&lli->lli_lock);
+
+	rc = ll_layout_refresh(inode, &layout_gen);
+	if (rc < 0)
+		GOTO(out, rc);
+
+	op_data = ll_prep_md_op_data(NULL, inode, NULL, NULL, 0, 0,
+				     LUSTRE_OPC_ANY, &hss);
+	if (IS_ERR(op_data))
+		GOTO(out, rc = PTR_ERR(op_data));
+	rc = obd_iocontrol(LL_IOC_HSM_STATE_SET, ll_i2mdexp(inode),
+			   sizeof(*op_data), op_data, NULL);
+	ll_finish_md_op_data(op_data);
+	if (rc < 0)
+		GOTO(out, rc);
+
+	rc = ll_data_version(inode, &dv1, LL_DV_RD_FLUSH);
+	if (rc < 0)
+		GOTO(out, rc);
+
+	pcc_file = ll_pcc_file_create(inode);
+	if (IS_ERR(pcc_file))
+		GOTO(out, rc = PTR_ERR(pcc_file));
+
+	rc = ll_pcc_copy(file, pcc_file);
+	if (rc < 0)
+		GOTO(out_remove, rc);
+
+	rc = ll_data_version(inode, &dv2, LL_DV_RD_FLUSH);
+	if (rc < 0)
+		GOTO(out_remove, rc);
+	if (dv1 != dv2)
+		GOTO(out_remove, rc = -EBUSY);
+
+	spin_lock(&lli->lli_lock);
+	if (lli->lli_pcc_gen == gen &&
+	    ll_layout_version_get(lli) == layout_gen) {
+		lli->lli_pcc_file = pcc_file;
+		pcc_file = NULL;
+	} else {
+		rc = -EBUSY;
+	}
+	spin_unlock(&lli->lli_lock);
+	if (rc < 0)
+		GOTO(out_remove, rc);
+
+	CDEBUG(D_INODE, "%s: attached "DFID" to the persistent cache\n",
+	       ll_get_fsname(inode->i_sb, NULL, 0), PFID(ll_inode2fid(inode)));
+	GOTO(out, rc = 0);
+
+out_remove:
+	ll_pcc_file_remove(pcc_file);
+out:
+	ll_file_clear_flag(lli, LLIF_PCC_ATTACHING);
+	return rc;
+}
+
+/**
+ * Count a read-only open of \a inode. Once it was opened read-only
+ * llite.*.pcc_auto_attach times on this client since it was last detached,
+ * the next read attaches it.
+ */
+void ll_pcc_open(struct inode *inode, struct file *file)
+{
+	struct ll_inode_info	*lli = ll_i2info(inode);
+
+	if (ll_i2sbi(inode)->ll_pcc.pcci_auto_attach == 0 ||
+	    !S_ISREG(inode->i_mode) || file->f_mode & FMODE_WRITE ||
+	    file->f_flags & O_DIRECT)
+		return;
+
+	spin_lock(&lli->lli_lock);
+	if (lli->lli_pcc_file == NULL)
+		lli->lli_pcc_opens++;
+	spin_unlock(&lli->lli_lock);
+}
+
+/* attach \a inode on read if ll_pcc_open() decided so */
+static void ll_pcc_auto_attach(struct inode *inode, struct file *file)
+{
+	struct ll_inode_info	*lli = ll_i2info(inode);
+	unsigned int		 auto_attach;
+	bool			 attach;
+	int			 rc;
+
+	auto_attach = ll_i2sbi(inode)->ll_pcc.pcci_auto_attach;
+	if (auto_attach == 0 || file->f_mode & FMODE_WRITE ||
+	    ll_file_test_flag(lli, LLIF_PCC_ATTACHING))
+		return;
+
+	spin_lock(&lli->lli_lock);
+	attach = lli->lli_pcc_opens >= auto_attach;
+	spin_unlock(&lli->lli_lock);
+	if (!attach)
+		return;
+
+	rc = ll_pcc_attach(inode, file);
+	if (rc < 0) {
+		CDEBUG(D_INODE, "%s: cannot attach "DFID": rc = %d\n",
+		       ll_get_fsname(inode->i_sb, NULL, 0),
+		       PFID(ll_inode2fid(inode)), rc);
+		/* try again after as many opens */
+		spin_lock(&lli->lli_lock);
+		lli->lli_pcc_opens = 0;
+		spin_unlock(&lli->lli_lock);
+	}
+}
+
+/**
+ * Read from the cached copy of the file if it has one.
+ *
+ * \param[in] iocb	kiocb of the read
+ * \param[in] to	user buffers
+ * \param[out] cached	set if the read was served from the cache
+ *
+ * \retval		bytes read, or negated errno, if \a cached is set
+ */
+ssize_t ll_pcc_read_iter(struct kiocb *iocb, struct iov_iter *to,
+			 bool *cached)
+{
+	struct file	*file = iocb->ki_filp;
+	struct inode	*inode = file->f_path.dentry->d_inode;
+	struct file	*pcc_file;
+	ssize_t		 result;
+
+	*cached = false;
+	if (file->f_flags & O_DIRECT)
+		return 0;
+
+	pcc_file = ll_pcc_file_get(inode);
+	if (pcc_file == NULL) {
+		ll_pcc_auto_attach(inode, file);
+		pcc_file = ll_pcc_file_get(inode);
+		if (pcc_file == NULL)
+			return 0;
+	}
+
+	*cached = true;
+	iocb->ki_filp = pcc_file;
+#ifdef HAVE_FILE_OPERATIONS_READ_WRITE_ITER
+	result = pcc_file->f_op->read_iter(iocb, to);
+#else
+	result = pcc_file->f_op->aio_read(iocb, to->iov, to->nr_segs,
+					  iocb->ki_pos);
+#endif
+	iocb->ki_filp = file;
+	fput(pcc_file);
+
+	return result;
+}
+
+/**
+ * Report whether \a inode is attached to the persistent cache of this
+ * client, and the path of its copy.
+ */
+int ll_pcc_state(struct inode *inode, struct lu_pcc_state *state)
+{
+	struct file	*pcc_file;
+	char		*path;
+	int		 rc = 0;
+
+	memset(state, 0, sizeof(*state));
+	pcc_file = ll_pcc_file_get(inode);
+	if (pcc_file == NULL)
+		return 0;
+
+	path = d_path(&pcc_file->f_path, state->pccs_path,
+		      sizeof(state->pccs_path));
+	if (IS_ERR(path)) {
+		rc = PTR_ERR(path);
+	} else {
+		memmove(state->pccs_path, path, strlen(path) + 1);
+		state->pccs_flags = PCC_STATE_ATTACHED;
+	}
+	fput(pcc_file);
+
+	return rc;
+}
@@ -887,6 +887,86 @@ out_unlock:
 	return;
 }
 
+/**
+ * Transfer one page cache page of a Data-on-MDT file to or from the MDT.
+ *
+ * Only mmap uses the page cache of such files, read(2) and write(2) send
+ * the data directly with ll_dom_io().
+ */
+static int ll_dom_page_rw(struct inode *inode, int cmd, struct page *vmpage,
+			  size_t len)
+{
+	struct obdo *oa;
+	int rc;
+
+	OBD_ALLOC_PTR(oa);
+	if (oa == NULL)
+		return -ENOMEM;
+
+	oa->o_oi.oi_fid = *ll_inode2fid(inode);
+	oa->o_valid = OBD_MD_FLID | OBD_MD_FLGROUP;
+	if (cmd == OBD_BRW_WRITE) {
+		oa->o_mtime = oa->o_ctime = get_seconds();
+		oa->o_valid |= OBD_MD_FLMTIME | OBD_MD_FLCTIME;
+	}
+
+	rc = md_dom_rw(ll_i2mdexp(inode), cmd, oa,
+		       (loff_t)vmpage->index << PAGE_CACHE_SHIFT, len,
+		       &vmpage, 1);
+	OBD_FREE_PTR(oa);
+
+	return rc;
+}
+
+static int ll_dom_readpage(struct inode *inode, struct page *vmpage)
+{
+	int rc;
+
+	rc = ll_dom_page_rw(inode, OBD_BRW_READ, vmpage, PAGE_CACHE_SIZE);
+	if (rc >= 0) {
+		/* short read at EOF */
+		if (rc < PAGE_CACHE_SIZE)
+			zero_user_segment(vmpage, rc, PAGE_CACHE_SIZE);
+		SetPageUptodate(vmpage);
+		rc = 0;
+	} else {
+		SetPageError(vmpage);
+	}
+	unlock_page(vmpage);
+
+	return rc;
+}
+
+static int ll_dom_writepage(struct inode *inode, struct page *vmpage)
+{
+	loff_t offset = (loff_t)vmpage->index << PAGE_CACHE_SHIFT;
+	loff_t size = i_size_read(inode);
+	int rc;
+
+	/* truncated meanwhile */
+	if (offset >= size) {
+		unlock_page(vmpage);
+		return 0;
+	}
+
+	set_page_writeback(vmpage);
+	unlock_page(vmpage);
+
+	rc = ll_dom_page_rw(inode, OBD_BRW_WRITE, vmpage,
+			    min_t(loff_t, PAGE_CACHE_SIZE, size - offset));
+	if (rc < 0) {
+		struct ll_inode_info *lli = ll_i2info(inode);
+
+		if (!lli->lli_async_rc)
+			lli->lli_async_rc = rc;
+		SetPageError(vmpage);
+		mapping_set_error(vmpage->mapping, rc);
+	}
+	end_page_writeback(vmpage);
+
+	return rc < 0 ? rc : 0;
+}
+
 int ll_writepage(struct page *vmpage, struct writeback_control *wbc)
 {
 	struct inode	       *inode = vmpage->mapping->host;
@@ -904,6 +984,10 @@ int ll_writepage(struct page *vmpage, struct writeback_control *wbc)
         LASSERT(PageLocked(vmpage));
         LASSERT(!PageWriteback(vmpage));
 
+	/* the layout is known once the page is cached, don't refresh it */
+	if (ll_file_test_flag(lli, LLIF_DOM))
+		return ll_dom_writepage(inode, vmpage);
+
 	LASSERT(ll_i2dtexp(inode) != NULL);
 
 	env = cl_env_nested_get(&nest);
@@ -1018,6 +1102,10 @@ int ll_writepages(struct address_space *mapping, struct writeback_control *wbc)
 	if (ll_i2info(inode)->lli_clob == NULL)
 		RETURN(0);
 
+	/* DoM pages are written one by one, see ll_dom_writepage() */
+	if (ll_file_test_flag(ll_i2info(inode), LLIF_DOM))
+		RETURN(generic_writepages(mapping, wbc));
+
 	result = cl_sync_file_range(inode, start, end, mode, ignore_layout);
 	if (result > 0) {
 		wbc->nr_to_write -= result;
@@ -1139,6 +1227,10 @@ int ll_readpage(struct file *file, struct page *vmpage)
 	int result;
 	ENTRY;
 
+	/* only mmap of a DoM file reads into the page cache, no cl_io */
+	if (ll_file_test_flag(ll_i2info(inode), LLIF_DOM))
+		RETURN(ll_dom_readpage(inode, vmpage));
+
 	lcc = ll_cl_find(file);
 	if (lcc == NULL) {
 		unlock_page(vmpage);
@@ -593,8 +593,8 @@ out:
 /**
  * Prepare partially written-to page for a write.
  */
-static int ll_prepare_partial_page(const struct lu_env *env, struct cl_io *io,
-				   struct cl_page *pg)
+int ll_prepare_partial_page(const struct lu_env *env, struct cl_io *io,
+			    struct cl_page *pg)
 {
 	struct cl_attr *attr   = vvp_env_thread_attr(env);
 	struct cl_object *obj  = io->ci_obj;
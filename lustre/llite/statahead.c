@@ -86,6 +86,22 @@ struct sa_entry {
 	struct lu_fid		se_fid;
 };
 
+/*
+ * Entries not in dcache the statahead thread stats with one batched getattr,
+ * which also gets their locks, instead of one async getattr intent each.
+ * Only used by the statahead thread.
+ */
+struct sa_batch {
+	/* entries queued, in index order */
+	struct sa_entry		*sab_entries[MDS_BATCH_GETATTR_MAX];
+	/* lock of each entry, returned by the MDT */
+	struct lustre_handle	 sab_lockh[MDS_BATCH_GETATTR_MAX];
+	/* number of entries queued */
+	int			 sab_count;
+	/* size of the names of the entries queued, with their NUL */
+	size_t			 sab_namelen;
+};
+
 static unsigned int sai_generation = 0;
 static DEFINE_SPINLOCK(sai_generation_lock);
 
@@ -823,9 +839,174 @@ static int sa_revalidate(struct inode *dir, struct sa_entry *entry,
 	RETURN(rc);
 }
 
-/* async stat for file with @name */
+/* whether entries can be stated in batches, see struct sa_batch */
+static inline bool sa_can_batch(struct inode *dir)
+{
+	return exp_connect_batch_getattr_lock(ll_i2mdexp(dir)) &&
+	       ll_i2info(dir)->lli_lsm_md == NULL;
+}
+
+/*
+ * whether @batch must be sent before another entry is queued: it is full,
+ * or the names and lock handles would not fit in one request with a name
+ * of NAME_MAX
+ */
+static inline bool sa_batch_full(struct sa_batch *batch)
+{
+	return batch->sab_count == MDS_BATCH_GETATTR_MAX ||
+	       batch->sab_namelen + NAME_MAX + 1 +
+	       (batch->sab_count + 1) * sizeof(struct lustre_handle) >
+	       MDS_BATCH_GETATTR_BUFSIZE;
+}
+
+/* instantiate @entry from its reply in a batched getattr */
+static void sa_batch_instantiate(struct ll_statahead_info *sai,
+				 struct sa_entry *entry, struct mdt_body *body,
+				 void *layout, struct lustre_handle *lockh)
+{
+	struct inode *dir = sai->sai_dentry->d_inode;
+	struct lookup_intent it = { .it_op = IT_GETATTR };
+	struct lustre_md md = { NULL };
+	struct inode *child = NULL;
+	int rc;
+	ENTRY;
+
+	it.d.lustre.it_lock_handle = lockh->cookie;
+	it.d.lustre.it_lock_mode = LCK_PR;
+
+	md.body = body;
+	if (layout != NULL) {
+		md.layout.lb_buf = layout;
+		md.layout.lb_len = body->mbo_eadatasize;
+	}
+
+	rc = ll_prep_inode_md(&child, &md, dir->i_sb, &it);
+	if (rc == 0) {
+		CDEBUG(D_READA, "%s: setting %.*s"DFID" l_data to inode %p\n",
+		       ll_get_fsname(child->i_sb, NULL, 0),
+		       entry->se_qstr.len, entry->se_qstr.name,
+		       PFID(ll_inode2fid(child)), child);
+		ll_set_lock_data(ll_i2sbi(dir)->ll_md_exp, child, &it, NULL);
+		entry->se_inode = child;
+		entry->se_handle = lockh->cookie;
+
+		if (agl_should_run(sai, child))
+			ll_agl_add(sai, child, entry->se_index);
+	}
+
+	/* like ll_statahead_interpret(), the lock is only kept in cache */
+	ll_intent_drop_lock(&it);
+	sa_make_ready(sai, entry, rc);
+	EXIT;
+}
+
+/*
+ * stat the entries queued in @batch with one MDS_BATCH_GETATTR RPC, entries
+ * the MDT did not return a lock for go through sa_lookup() instead.
+ */
+static void sa_batch_flush(struct ll_statahead_info *sai,
+			   struct sa_batch *batch)
+{
+	struct inode *dir = sai->sai_dentry->d_inode;
+	struct ldlm_enqueue_info einfo = {
+		.ei_type	= LDLM_IBITS,
+		.ei_mode	= LCK_PR,
+		.ei_cb_bl	= ll_md_blocking_ast,
+		.ei_cb_cp	= ldlm_completion_ast,
+	};
+	struct mdt_batch_getattr_rep *rep = NULL;
+	struct mdt_batch_lock_rep *lock_rep = NULL;
+	struct ptlrpc_request *req = NULL;
+	struct md_op_data *op_data;
+	char *names;
+	char *md = NULL;
+	char *p;
+	int count = batch->sab_count;
+	int i;
+	int rc;
+	ENTRY;
+
+	if (count == 0)
+		RETURN_EXIT;
+	batch->sab_count = 0;
+
+	OBD_ALLOC_LARGE(names, batch->sab_namelen);
+	if (names == NULL)
+		GOTO(out, rc = -ENOMEM);
+
+	for (i = 0, p = names; i < count; i++) {
+		struct qstr *qstr = &batch->sab_entries[i]->se_qstr;
+
+		memcpy(p, qstr->name, qstr->len);
+		p += qstr->len;
+		*p++ = '\0';
+	}
+
+	op_data = ll_prep_md_op_data(NULL, dir, NULL, NULL, 0, 0,
+				     LUSTRE_OPC_ANY, NULL);
+	if (IS_ERR(op_data)) {
+		OBD_FREE_LARGE(names, batch->sab_namelen);
+		GOTO(out, rc = PTR_ERR(op_data));
+	}
+
+	rc = md_batch_getattr(ll_i2mdexp(dir), op_data, names,
+			      batch->sab_namelen, count, &einfo,
+			      batch->sab_lockh, &req);
+	ll_finish_md_op_data(op_data);
+	OBD_FREE_LARGE(names, batch->sab_namelen);
+	if (rc != 0)
+		GOTO(out, rc);
+
+	rep = req_capsule_server_get(&req->rq_pill, &RMF_BATCH_GETATTR_REP);
+	if (req_capsule_get_size(&req->rq_pill, &RMF_BATCH_LOCK_REP,
+				 RCL_SERVER) == count * sizeof(*lock_rep))
+		lock_rep = req_capsule_server_get(&req->rq_pill,
+						  &RMF_BATCH_LOCK_REP);
+	if (req_capsule_get_size(&req->rq_pill, &RMF_BATCH_GETATTR_MD,
+				 RCL_SERVER) > 0)
+		md = req_capsule_server_get(&req->rq_pill,
+					    &RMF_BATCH_GETATTR_MD);
+	EXIT;
+out:
+	for (i = 0; i < count; i++) {
+		struct sa_entry *entry = batch->sab_entries[i];
+		struct lustre_handle *lockh = &batch->sab_lockh[i];
+		void *layout = NULL;
+
+		/* the layouts are back to back, checked by mdc */
+		if (rc == 0 && lock_rep != NULL && rep[i].mbgr_rc == 0 &&
+		    lustre_handle_is_used(&lock_rep[i].mblr_handle) &&
+		    rep[i].mbgr_body.mbo_valid & OBD_MD_FLEASIZE) {
+			layout = md;
+			md += rep[i].mbgr_body.mbo_eadatasize;
+		}
+
+		if (rc == 0 && lustre_handle_is_used(lockh)) {
+			sa_batch_instantiate(sai, entry, &rep[i].mbgr_body,
+					     layout, lockh);
+		} else if (rc == 0 && rep[i].mbgr_rc == -ENOENT) {
+			sa_make_ready(sai, entry, -ENOENT);
+		} else {
+			int rc2 = sa_lookup(dir, entry);
+
+			if (rc2 == 0)
+				sai->sai_sent++;
+			else
+				sa_make_ready(sai, entry, rc2);
+		}
+	}
+
+	if (req != NULL)
+		ptlrpc_req_finished(req);
+	batch->sab_namelen = 0;
+}
+
+/*
+ * async stat for file with @name, if @batch is not NULL a file not in dcache
+ * is queued there instead and stated by sa_batch_flush()
+ */
 static void sa_statahead(struct dentry *parent, const char *name, int len,
-			 const struct lu_fid *fid)
+			 const struct lu_fid *fid, struct sa_batch *batch)
 {
 	struct inode *dir = parent->d_inode;
 	struct ll_inode_info *lli = ll_i2info(dir);
@@ -840,7 +1021,14 @@ static void sa_statahead(struct dentry *parent, const char *name, int len,
 		RETURN_EXIT;
 
 	dentry = d_lookup(parent, &entry->se_qstr);
-	if (!dentry) {
+	if (!dentry && batch != NULL) {
+		batch->sab_entries[batch->sab_count++] = entry;
+		batch->sab_namelen += len + 1;
+		sai->sai_index++;
+		if (sa_batch_full(batch))
+			sa_batch_flush(sai, batch);
+		RETURN_EXIT;
+	} else if (!dentry) {
 		rc = sa_lookup(dir, entry);
 	} else {
 		rc = sa_revalidate(dir, entry, dentry);
@@ -970,6 +1158,7 @@ static int ll_statahead_thread(void *arg)
 	struct ll_statahead_info *sai;
 	struct ptlrpc_thread *sa_thread;
 	struct ptlrpc_thread *agl_thread;
+	struct sa_batch *batch = NULL;
 	int first = 0;
 	struct md_op_data *op_data;
 	struct ll_dir_chain chain;
@@ -993,6 +1182,10 @@ static int ll_statahead_thread(void *arg)
 
 	op_data->op_max_pages = ll_i2sbi(dir)->ll_md_brw_pages;
 
+	/* without a batch entries are stated one by one */
+	if (sa_can_batch(dir))
+		OBD_ALLOC_LARGE(batch, sizeof(*batch));
+
 	if (sbi->ll_flags & LL_SBI_AGL_ENABLED)
 		ll_start_agl(parent, sai);
 
@@ -1076,6 +1269,14 @@ static int ll_statahead_thread(void *arg)
 
 			fid_le_to_cpu(&fid, &ent->lde_fid);
 
+			/* the queued entries take room in the window, and
+			 * do not keep the scanner waiting for them */
+			if (batch != NULL && batch->sab_count > 0 &&
+			    (sa_sent_full(sai) ||
+			     sai->sai_index_wait >=
+			     batch->sab_entries[0]->se_index))
+				sa_batch_flush(sai, batch);
+
 			/* wait for spare statahead window */
 			do {
 				l_wait_event(sa_thread->t_ctl_waitq,
@@ -1105,9 +1306,12 @@ static int ll_statahead_thread(void *arg)
 			} while (sa_sent_full(sai) &&
 				 thread_is_running(sa_thread));
 
-			sa_statahead(parent, name, namelen, &fid);
+			sa_statahead(parent, name, namelen, &fid, batch);
 		}
 
+		if (batch != NULL)
+			sa_batch_flush(sai, batch);
+
 		pos = le64_to_cpu(dp->ldp_hash_end);
 		ll_release_page(dir, page,
 				le32_to_cpu(dp->ldp_flags) & LDF_COLLIDE);
@@ -1128,6 +1332,11 @@ static int ll_statahead_thread(void *arg)
 	ll_dir_chain_fini(&chain);
 	ll_finish_md_op_data(op_data);
 
+	if (batch != NULL) {
+		sa_batch_flush(sai, batch);
+		OBD_FREE_LARGE(batch, sizeof(*batch));
+	}
+
 	if (rc < 0) {
 		spin_lock(&lli->lli_sa_lock);
 		thread_set_flags(sa_thread, SVC_STOPPING);
@@ -338,6 +338,29 @@ static void vvp_io_fini(const struct lu_env *env, const struct cl_io_slice *ios)
 		}
 	}
 
+	if (io->ci_need_write_intent) {
+		struct layout_intent	intent = {
+			.li_opc = io->ci_write_intent_opc,
+			.li_start = io->ci_write_intent.e_start,
+			.li_end = io->ci_write_intent.e_end,
+		};
+		int			rc;
+
+		/* the IO writes to components not instantiated yet, or to a
+		 * mirrored file not open for write, ask the MDT to change the
+		 * layout and restart with the new one */
+		rc = ll_layout_write_intent(inode, &intent);
+		io->ci_need_write_intent = 0;
+		if (rc == 0) {
+			io->ci_need_restart = 1;
+		} else {
+			CDEBUG(D_VFSTRACE, DFID" write intent "DEXT": rc = %d\n",
+			       PFID(lu_object_fid(&obj->co_lu)),
+			       PEXT(&io->ci_write_intent), rc);
+			io->ci_result = rc;
+		}
+	}
+
 	if (!io->ci_ignore_layout && io->ci_verify_layout) {
 		__u32 gen = 0;
 
@@ -1045,6 +1068,264 @@ int vvp_io_write_commit(const struct lu_env *env, struct cl_io *io)
 	RETURN(rc);
 }
 
+/**
+ * Number of pages a batched buffered write locks and copies at once, see
+ * vvp_io_write_batch().
+ */
+#define VVP_WRITE_BATCH_PAGES	256
+
+/**
+ * Check if the write of \a cnt bytes at \a pos can go through
+ * vvp_io_write_batch() rather than the generic ->write_begin() and
+ * ->write_end() path.
+ */
+static bool vvp_io_write_batchable(struct vvp_io *vio, loff_t pos, size_t cnt)
+{
+	struct file *file = vio->vui_iocb->ki_filp;
+
+	if (vio->vui_io_subtype != IO_NORMAL || file->f_flags & O_DIRECT)
+		return false;
+
+	/* nothing to batch for a single page */
+	if ((pos & ~PAGE_MASK) + cnt <= PAGE_SIZE)
+		return false;
+
+	/* leave it to the generic code to send SIGXFSZ */
+	if (pos + cnt > rlimit(RLIMIT_FSIZE))
+		return false;
+
+	return true;
+}
+
+/**
+ * Lock and own the pages for \a bytes of a batched write at \a pos, adding
+ * them to \a plist. The run stops early at a page which can't be locked
+ * without blocking, or which is dirty or under writeback, as only the first
+ * page of a commit may be, see ll_write_begin().
+ *
+ * \retval	number of bytes covered by the pages in \a plist
+ * \retval	negative errno if not even the first page could be grabbed
+ */
+static ssize_t vvp_io_write_grab(const struct lu_env *env, struct cl_io *io,
+				 struct cl_page_list *plist, loff_t pos,
+				 size_t bytes)
+{
+	struct cl_object *obj = io->ci_obj;
+	struct address_space *mapping = vvp_object_inode(obj)->i_mapping;
+	ssize_t grabbed = 0;
+	int rc = 0;
+
+	while (grabbed < bytes) {
+		pgoff_t index = (pos + grabbed) >> PAGE_SHIFT;
+		unsigned int from = (pos + grabbed) & ~PAGE_MASK;
+		unsigned int to;
+		struct cl_page *page;
+		struct page *vmpage;
+
+		to = min_t(size_t, PAGE_SIZE, from + bytes - grabbed);
+
+		vmpage = grab_cache_page_nowait(mapping, index);
+		if (unlikely(vmpage == NULL ||
+			     PageDirty(vmpage) || PageWriteback(vmpage))) {
+			if (plist->pl_nr > 0) {
+				if (vmpage != NULL) {
+					unlock_page(vmpage);
+					page_cache_release(vmpage);
+				}
+				break;
+			}
+
+			/* nothing is queued, it's safe to wait for the page */
+			if (vmpage == NULL) {
+				vmpage = grab_cache_page_write_begin(mapping,
+								     index, 0);
+				if (vmpage == NULL) {
+					rc = -ENOMEM;
+					break;
+				}
+			}
+		}
+
+		page = cl_page_find(env, obj, index, vmpage, CPT_CACHEABLE);
+		if (IS_ERR(page)) {
+			unlock_page(vmpage);
+			page_cache_release(vmpage);
+			rc = PTR_ERR(page);
+			break;
+		}
+
+		lu_ref_add(&page->cp_reference, "cl_io", io);
+		cl_page_assume(env, io, page);
+		/* cl_page holds its own reference on vmpage */
+		page_cache_release(vmpage);
+
+		if (!PageUptodate(vmpage)) {
+			if (from == 0 && to == PAGE_SIZE) {
+				CL_PAGE_HEADER(D_PAGE, env, page,
+					       "full page write\n");
+				POISON_PAGE(vmpage, 0x11);
+			} else {
+				rc = ll_prepare_partial_page(env, io, page);
+				if (rc == 0)
+					SetPageUptodate(vmpage);
+			}
+		}
+		if (rc < 0) {
+			cl_page_unassume(env, io, page);
+			unlock_page(vmpage);
+			lu_ref_del(&page->cp_reference, "cl_io", io);
+			cl_page_put(env, page);
+			break;
+		}
+
+		cl_page_list_add(plist, page);
+		grabbed += to - from;
+	}
+
+	return grabbed > 0 ? grabbed : rc;
+}
+
+/**
+ * Fault in the first \a bytes of \a iter without advancing it.
+ *
+ * iov_iter_fault_in_readable() only faults in the first segment of \a iter,
+ * which for a writev() can be much shorter than a batch, so walk a copy of
+ * the iterator segment by segment.
+ */
+static int vvp_io_fault_in(const struct iov_iter *iter, size_t bytes)
+{
+	struct iov_iter i = *iter;
+
+	while (bytes > 0) {
+		size_t seg = min(bytes, iov_iter_single_seg_count(&i));
+
+		/* an empty segment, the copy skips it */
+		if (seg == 0)
+			break;
+		if (iov_iter_fault_in_readable(&i, seg))
+			return -EFAULT;
+		iov_iter_advance(&i, seg);
+		bytes -= seg;
+	}
+	return 0;
+}
+
+/**
+ * Buffered write of \a count bytes at \a pos from vvp_io::vui_iter.
+ *
+ * Instead of calling ->write_begin() and ->write_end() for every page, runs
+ * of up to VVP_WRITE_BATCH_PAGES pages are locked and owned at once, the
+ * user data is copied into them in one pass and the run is committed to the
+ * cache as a whole.
+ *
+ * \retval	number of bytes copied
+ * \retval	negative errno if nothing was copied
+ */
+static ssize_t vvp_io_write_batch(const struct lu_env *env, struct cl_io *io,
+				  loff_t pos, size_t count)
+{
+	struct vvp_io *vio = vvp_env_io(env);
+	struct file *file = vio->vui_iocb->ki_filp;
+	struct address_space *mapping = vvp_object_inode(io->ci_obj)->i_mapping;
+	struct iov_iter *iter = vio->vui_iter;
+	struct cl_page_list *queue = &vio->u.write.vui_queue;
+	struct cl_page_list plist;
+	ssize_t written = 0;
+	ssize_t rc;
+	ENTRY;
+
+	rc = file_remove_suid(file);
+	if (rc != 0)
+		RETURN(rc);
+	file_update_time(file);
+
+	cl_page_list_init(&plist);
+	while (count > 0) {
+		struct cl_page *page;
+		struct cl_page *temp;
+		bool short_copy = false;
+		size_t bytes;
+
+		bytes = min_t(size_t, count, VVP_WRITE_BATCH_PAGES * PAGE_SIZE -
+					     (pos & ~PAGE_MASK));
+
+		/* copying from a user buffer mapping one of the pages locked
+		 * below would deadlock on the page fault, so fault it in now
+		 * and copy with page faults disabled */
+		if (unlikely(vvp_io_fault_in(iter, bytes))) {
+			rc = -EFAULT;
+			break;
+		}
+
+		LASSERT(queue->pl_nr == 0);
+		rc = vvp_io_write_grab(env, io, &plist, pos, bytes);
+		if (rc <= 0)
+			break;
+		bytes = rc;
+
+		cl_page_list_for_each_safe(page, temp, &plist) {
+			struct page *vmpage = cl_page_vmpage(page);
+			unsigned int from = pos & ~PAGE_MASK;
+			size_t len = min_t(size_t, PAGE_SIZE - from, bytes);
+			size_t copied = 0;
+
+			if (!short_copy) {
+				copied = iov_iter_copy_from_user_atomic(vmpage,
+							iter, from, len);
+				flush_dcache_page(vmpage);
+				/* the rest of a page which isn't up to date
+				 * would be garbage, copy it again later */
+				if (copied < len && !PageUptodate(vmpage))
+					copied = 0;
+				if (copied < len)
+					short_copy = true;
+			}
+
+			if (copied == 0) {
+				cl_page_list_del(env, &plist, page);
+				cl_page_disown(env, io, page);
+				lu_ref_del(&page->cp_reference, "cl_io", io);
+				cl_page_put(env, page);
+				continue;
+			}
+
+			iov_iter_advance(iter, copied);
+			cl_page_list_move(queue, &plist, page);
+			if (queue->pl_nr == 1) /* first page */
+				vio->u.write.vui_from = from;
+			else
+				LASSERT(from == 0);
+			vio->u.write.vui_to = from + copied;
+
+			pos += copied;
+			count -= copied;
+			bytes -= copied;
+			written += copied;
+		}
+
+		rc = vvp_io_write_commit(env, io);
+		if (rc < 0) {
+			io->ci_result = rc;
+			break;
+		}
+
+		balance_dirty_pages_ratelimited(mapping);
+
+		if (fatal_signal_pending(current)) {
+			rc = -EINTR;
+			break;
+		}
+	}
+	cl_page_list_fini(env, &plist);
+
+	if (written > 0)
+		vio->vui_iocb->ki_pos = pos;
+
+	CDEBUG(D_VFSTRACE, "batched write: %zd bytes, rc = %zd\n",
+	       written, rc);
+	RETURN(written > 0 ? written : rc);
+}
+
 static int vvp_io_write_start(const struct lu_env *env,
                               const struct cl_io_slice *ios)
 {
@@ -1094,6 +1375,17 @@ static int vvp_io_write_start(const struct lu_env *env,
 	if (vio->vui_iter == NULL) {
 		/* from a temp io in ll_cl_init(). */
 		result = 0;
+	} else if (vvp_io_write_batchable(vio, pos, cnt)) {
+		result = vvp_io_write_batch(env, io, pos,
+				min(cnt, iov_iter_count(vio->vui_iter)));
+		if (result > 0) {
+			ssize_t err;
+
+			err = generic_write_sync(vio->vui_iocb->ki_filp,
+						 pos, result);
+			if (err < 0)
+				result = err;
+		}
 	} else {
 		/*
 		 * When using the locked AIO function (generic_file_aio_write())
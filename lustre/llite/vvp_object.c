@@ -208,6 +208,15 @@ static void vvp_req_attr_set(const struct lu_env *env, struct cl_object *obj,
 		valid_flags |= OBD_MD_FLMTIME | OBD_MD_FLCTIME |
 			       OBD_MD_FLUID | OBD_MD_FLGID;
 	obdo_from_inode(oa, inode, valid_flags & attr->cra_flags);
+	if (attr->cra_flags & OBD_MD_FLFLAGS &&
+	    ll_file_test_flag(ll_i2info(inode), LLIF_COMPRESS)) {
+		if (!(oa->o_valid & OBD_MD_FLFLAGS)) {
+			oa->o_valid |= OBD_MD_FLFLAGS;
+			oa->o_flags = 0;
+		}
+		/* only a hint, the OSC decides per RPC */
+		oa->o_flags |= OBD_FL_BRW_COMPRESS;
+	}
 	obdo_set_parent_fid(oa, &ll_i2info(inode)->lli_fid);
 	if (OBD_FAIL_CHECK(OBD_FAIL_LFSCK_INVALID_PFID))
 		oa->o_parent_oid++;
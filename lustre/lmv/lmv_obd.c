@@ -1925,6 +1925,62 @@ lmv_getattr_name(struct obd_export *exp,struct md_op_data *op_data,
 	RETURN(rc);
 }
 
+static int
+lmv_batch_getattr(struct obd_export *exp, struct md_op_data *op_data,
+		  const char *names, size_t namelen, int count,
+		  struct ldlm_enqueue_info *einfo, struct lustre_handle *lockh,
+		  struct ptlrpc_request **preq)
+{
+	struct obd_device	*obd = exp->exp_obd;
+	struct lmv_obd		*lmv = &obd->u.lmv;
+	struct lmv_tgt_desc	*tgt;
+	int			 rc;
+	ENTRY;
+
+	rc = lmv_check_connect(obd);
+	if (rc)
+		RETURN(rc);
+
+	/* names of a striped directory are spread over several MDTs by
+	 * their hash, let the caller stat them one by one */
+	if (op_data->op_mea1 != NULL)
+		RETURN(-EOPNOTSUPP);
+
+	tgt = lmv_find_target(lmv, &op_data->op_fid1);
+	if (IS_ERR(tgt))
+		RETURN(PTR_ERR(tgt));
+
+	CDEBUG(D_INODE, "BATCH_GETATTR for %d names on "DFID" -> mds #%d\n",
+	       count, PFID(&op_data->op_fid1), tgt->ltd_idx);
+
+	rc = md_batch_getattr(tgt->ltd_exp, op_data, names, namelen, count,
+			      einfo, lockh, preq);
+	RETURN(rc);
+}
+
+static int lmv_dom_rw(struct obd_export *exp, int cmd, struct obdo *oa,
+		      u64 offset, size_t count, struct page **pages,
+		      int npages)
+{
+	struct obd_device	*obd = exp->exp_obd;
+	struct lmv_obd		*lmv = &obd->u.lmv;
+	struct lmv_tgt_desc	*tgt;
+	int			 rc;
+	ENTRY;
+
+	rc = lmv_check_connect(obd);
+	if (rc)
+		RETURN(rc);
+
+	/* the data lives on the MDT holding the inode */
+	tgt = lmv_find_target(lmv, &oa->o_oi.oi_fid);
+	if (IS_ERR(tgt))
+		RETURN(PTR_ERR(tgt));
+
+	rc = md_dom_rw(tgt->ltd_exp, cmd, oa, offset, count, pages, npages);
+	RETURN(rc);
+}
+
 #define md_op_data_fid(op_data, fl)                     \
         (fl == MF_MDC_CANCEL_FID1 ? &op_data->op_fid1 : \
          fl == MF_MDC_CANCEL_FID2 ? &op_data->op_fid2 : \
@@ -3376,6 +3432,8 @@ struct md_ops lmv_md_ops = {
         .m_getattr              = lmv_getattr,
         .m_getxattr             = lmv_getxattr,
         .m_getattr_name         = lmv_getattr_name,
+	.m_batch_getattr	= lmv_batch_getattr,
+	.m_dom_rw		= lmv_dom_rw,
         .m_intent_lock          = lmv_intent_lock,
         .m_link                 = lmv_link,
         .m_rename               = lmv_rename,
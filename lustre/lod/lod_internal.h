@@ -56,6 +56,9 @@
 
 #define LOV_OFFSET_DEFAULT		((__u16)-1)
 
+/* default limit of the file size with data on MDT */
+#define LOD_DOM_MAX_STRIPESIZE_DEFAULT	(1U << 20)
+
 struct lod_qos_rr {
 	spinlock_t		 lqr_alloc;	/* protect allocation index */
 	__u32			 lqr_start_idx;	/* start index of new inode */
@@ -193,6 +196,8 @@ struct lod_device {
 
 	/* maximum EA size underlied OSD may have */
 	unsigned int	      lod_osd_max_easize;
+	/* maximum size of a file with data on MDT, 0 disables DoM */
+	unsigned int	      lod_dom_max_stripesize;
 
 	/*FIXME: When QOS and pool is implemented for MDT, probably these
 	 * structure should be moved to lod_tgt_descs as well.
@@ -238,6 +243,36 @@ struct lod_dir_stripe_info {
 		     ldsi_striped:1;
 };
 
+/*
+ * One component of a composite layout.  The stripes of instantiated
+ * components live in lod_object::ldo_stripe[], starting at llc_stripe_base.
+ */
+struct lod_layout_component {
+	struct lu_extent	  llc_extent;
+	__u32			  llc_id;
+	__u32			  llc_flags;	/* LCME_FL_XXX */
+	__u32			  llc_stripe_size;
+	__u32			  llc_pattern;
+	__u16			  llc_stripenr;
+	__u16			  llc_stripe_offset;
+	__u16			  llc_stripe_base;
+	char			 *llc_pool;
+	/* stripes allocated for the component by a declared layout change,
+	 * merged into ldo_stripe[] when the change is executed */
+	struct dt_object	**llc_new_stripe;
+	__u16			  llc_new_stripes_allocated;
+};
+
+static inline bool lod_comp_inited(const struct lod_layout_component *comp)
+{
+	return comp->llc_flags & LCME_FL_INIT;
+}
+
+static inline bool lod_comp_stale(const struct lod_layout_component *comp)
+{
+	return comp->llc_flags & LCME_FL_STALE;
+}
+
 /*
  * XXX: shrink this structure, currently it's 72bytes on 32bit arch,
  *      so, slab will be allocating 128bytes
@@ -254,6 +289,13 @@ struct lod_object {
 	__u16		   ldo_released_stripenr;
 	char		  *ldo_pool;
 	struct dt_object **ldo_stripe;
+	/* components of a composite layout, the stripes of all instantiated
+	 * components are kept in ldo_stripe[] and counted by ldo_stripenr */
+	struct lod_layout_component *ldo_comp_entries;
+	__u16		   ldo_comp_cnt;
+	/* mirrored file: number of mirrors and LCM_FL_* state */
+	__u16		   ldo_mirror_count;
+	__u16		   ldo_flr_state;
 	/* to know how much memory to free, ldo_stripenr can be less */
 	/* default striping for directory represented by this object
 	 * is cached in stripenr/stripe_size */
@@ -265,6 +307,7 @@ struct lod_object {
 	 * a striped dir */
 			   ldo_dir_slave_stripe:1;
 	__u32		   ldo_def_stripe_size;
+	__u32		   ldo_def_pattern;
 	__u16		   ldo_def_stripenr;
 	__u16		   ldo_def_stripe_offset;
 	struct lod_dir_stripe_info	*ldo_dir_stripe;
@@ -279,6 +322,22 @@ struct lod_object {
 #define ldo_dir_def_striping_cached	ldo_dir_stripe->ldsi_def_striping_cached
 #define ldo_dir_def_stripe_offset	ldo_dir_stripe->ldsi_def_stripe_offset
 
+static inline bool lod_is_composite(const struct lod_object *lo)
+{
+	return lo->ldo_comp_entries != NULL;
+}
+
+static inline bool lod_is_mirrored(const struct lod_object *lo)
+{
+	return lod_is_composite(lo) && lo->ldo_mirror_count > 1;
+}
+
+/* room for the composite header, entries and v3 component blobs on top of
+ * the stripes of a plain layout */
+#define LOD_COMP_MD_OVERHEAD						\
+	(sizeof(struct lov_comp_md_v1) + LOV_MAX_COMP_COUNT *		\
+	 (sizeof(struct lov_comp_md_entry_v1) + sizeof(struct lov_mds_md_v3)))
+
 struct lod_it {
 	struct dt_object	*lit_obj; /* object from the layer below */
 	/* stripe offset of iteration */
@@ -452,6 +511,12 @@ int lod_parse_dir_striping(const struct lu_env *env, struct lod_object *lo,
 			   const struct lu_buf *buf);
 int lod_initialize_objects(const struct lu_env *env, struct lod_object *mo,
 			   struct lov_ost_data_v1 *objs);
+int lod_alloc_comp_entries(struct lod_object *lo, __u16 comp_cnt);
+size_t lod_comp_md_size(const struct lod_object *lo);
+int lod_comp_merge_new_stripes(struct lod_object *lo);
+void lod_comp_put_new_stripes(const struct lu_env *env,
+			      struct lod_layout_component *comp);
+void lod_free_comp_entries(const struct lu_env *env, struct lod_object *lo);
 int lod_verify_striping(struct lod_device *d, const struct lu_buf *buf,
 			bool is_from_disk);
 int lod_generate_and_set_lovea(const struct lu_env *env,
@@ -476,6 +541,9 @@ int lod_pool_remove(struct obd_device *obd, char *poolname, char *ostname);
 int lod_qos_prep_create(const struct lu_env *env, struct lod_object *lo,
 			struct lu_attr *attr, const struct lu_buf *buf,
 			struct thandle *th);
+int lod_qos_prep_comp_create(const struct lu_env *env, struct lod_object *lo,
+			     struct lu_attr *attr, const struct lu_extent *ext,
+			     int mirror_id, struct thandle *th);
 int qos_add_tgt(struct lod_device*, struct lod_tgt_desc *);
 int qos_del_tgt(struct lod_device *, struct lod_tgt_desc *);
 void lod_qos_rr_init(struct lod_qos_rr *lqr);
@@ -489,6 +557,7 @@ extern struct dt_object_operations lod_obj_ops;
 extern struct lu_object_operations lod_lu_obj_ops;
 int lod_load_lmv_shards(const struct lu_env *env, struct lod_object *lo,
 			struct lu_buf *buf, bool resize);
+int lod_set_pool(char **pool, const char *new_pool);
 int lod_object_set_pool(struct lod_object *o, char *pool);
 int lod_declare_striped_object(const struct lu_env *env, struct dt_object *dt,
 			       struct lu_attr *attr,
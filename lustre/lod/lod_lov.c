@@ -598,7 +598,8 @@ int lod_ea_store_resize(struct lod_thread_info *info, size_t size)
 	__u32 round = size_roundup_power2(size);
 
 	LASSERT(round <=
-		lov_mds_md_size(LOV_MAX_STRIPE_COUNT, LOV_MAGIC_V3));
+		lov_mds_md_size(LOV_MAX_STRIPE_COUNT, LOV_MAGIC_V3) +
+		LOD_COMP_MD_OVERHEAD);
 	if (info->lti_ea_store) {
 		LASSERT(info->lti_ea_store_size);
 		LASSERT(info->lti_ea_store_size < round);
@@ -618,81 +619,95 @@ int lod_ea_store_resize(struct lod_thread_info *info, size_t size)
 }
 
 /**
- * Make LOV EA for striped object.
+ * Pack the striping of a plain layout or of a composite layout component.
  *
- * Generate striping information and store it in the LOV EA of the given
- * object. The caller must ensure nobody else is calling the function
- * against the object concurrently. The transaction must be started.
- * FLDB service must be running as well; it's used to map FID to the target,
- * which is stored in LOV EA.
+ * A component which is not instantiated yet has no objects, its requested
+ * starting OST index is kept in the lmm_layout_gen slot, the way
+ * lov_user_md does.
  *
  * \param[in] env		execution environment for this thread
  * \param[in] lo		LOD object
- * \param[in] th		transaction handle
+ * \param[in] comp		component to pack, NULL for a plain layout
+ * \param[out] lmm		buffer to pack the striping to
+ * \param[out] lmm_size		size of the packed striping
  *
- * \retval			0 if LOV EA is stored successfully
+ * \retval			0 on success
  * \retval			negative error number on failure
  */
-int lod_generate_and_set_lovea(const struct lu_env *env,
-			       struct lod_object *lo, struct thandle *th)
+static int lod_gen_component_ea(const struct lu_env *env,
+				struct lod_object *lo,
+				const struct lod_layout_component *comp,
+				struct lov_mds_md_v1 *lmm, size_t *lmm_size)
 {
 	struct lod_thread_info	*info = lod_env_info(env);
-	struct dt_object	*next = dt_object_child(&lo->ldo_obj);
 	const struct lu_fid	*fid  = lu_object_fid(&lo->ldo_obj.do_lu);
-	struct lov_mds_md_v1	*lmm;
+	struct lod_device	*lod = lu2lod_dev(lo->ldo_obj.do_lu.lo_dev);
 	struct lov_ost_data_v1	*objs;
+	struct dt_object	**stripe;
+	const char		*pool;
 	__u32			 magic;
+	__u32			 pattern;
+	__u32			 stripe_size;
+	__u16			 stripe_count;
+	__u16			 stripenr;
+	__u16			 layout_gen = 0;
 	int			 i, rc;
-	size_t			 lmm_size;
 	ENTRY;
 
-	LASSERT(lo);
-
-	magic = lo->ldo_pool != NULL ? LOV_MAGIC_V3 : LOV_MAGIC_V1;
-	lmm_size = lov_mds_md_size(lo->ldo_stripenr, magic);
-	if (info->lti_ea_store_size < lmm_size) {
-		rc = lod_ea_store_resize(info, lmm_size);
-		if (rc)
-			RETURN(rc);
+	if (comp == NULL) {
+		pattern = lo->ldo_pattern;
+		stripe_size = lo->ldo_stripe_size;
+		stripenr = lo->ldo_stripenr;
+		stripe_count = stripenr;
+		if (pattern & LOV_PATTERN_F_RELEASED)
+			stripe_count = lo->ldo_released_stripenr;
+		stripe = lo->ldo_stripe;
+		pool = lo->ldo_pool;
+	} else {
+		pattern = comp->llc_pattern;
+		stripe_size = comp->llc_stripe_size;
+		stripe_count = comp->llc_stripenr;
+		pool = comp->llc_pool;
+		if (lod_comp_inited(comp)) {
+			stripenr = comp->llc_stripenr;
+			stripe = lo->ldo_stripe + comp->llc_stripe_base;
+		} else {
+			stripenr = 0;
+			stripe = NULL;
+			layout_gen = comp->llc_stripe_offset;
+		}
 	}
 
-	if (lo->ldo_pattern == 0) /* default striping */
-		lo->ldo_pattern = LOV_PATTERN_RAID0;
-
-	lmm = info->lti_ea_store;
+	magic = pool != NULL ? LOV_MAGIC_V3 : LOV_MAGIC_V1;
 
 	lmm->lmm_magic = cpu_to_le32(magic);
-	lmm->lmm_pattern = cpu_to_le32(lo->ldo_pattern);
+	lmm->lmm_pattern = cpu_to_le32(pattern);
 	fid_to_lmm_oi(fid, &lmm->lmm_oi);
 	if (OBD_FAIL_CHECK(OBD_FAIL_LFSCK_BAD_LMMOI))
 		lmm->lmm_oi.oi.oi_id++;
 	lmm_oi_cpu_to_le(&lmm->lmm_oi, &lmm->lmm_oi);
-	lmm->lmm_stripe_size = cpu_to_le32(lo->ldo_stripe_size);
-	lmm->lmm_stripe_count = cpu_to_le16(lo->ldo_stripenr);
-	if (lo->ldo_pattern & LOV_PATTERN_F_RELEASED)
-		lmm->lmm_stripe_count = cpu_to_le16(lo->ldo_released_stripenr);
-	lmm->lmm_layout_gen = 0;
+	lmm->lmm_stripe_size = cpu_to_le32(stripe_size);
+	lmm->lmm_stripe_count = cpu_to_le16(stripe_count);
+	lmm->lmm_layout_gen = cpu_to_le16(layout_gen);
 	if (magic == LOV_MAGIC_V1) {
 		objs = &lmm->lmm_objects[0];
 	} else {
 		struct lov_mds_md_v3 *v3 = (struct lov_mds_md_v3 *) lmm;
-		size_t cplen = strlcpy(v3->lmm_pool_name, lo->ldo_pool,
+		size_t cplen = strlcpy(v3->lmm_pool_name, pool,
 				sizeof(v3->lmm_pool_name));
 		if (cplen >= sizeof(v3->lmm_pool_name))
 			RETURN(-E2BIG);
 		objs = &v3->lmm_objects[0];
 	}
 
-	for (i = 0; i < lo->ldo_stripenr; i++) {
-		struct lu_fid		*fid	= &info->lti_fid;
-		struct lod_device	*lod;
-		__u32			index;
-		int			type	= LU_SEQ_RANGE_OST;
+	for (i = 0; i < stripenr; i++) {
+		struct lu_fid	*fid	= &info->lti_fid;
+		__u32		index;
+		int		type	= LU_SEQ_RANGE_OST;
 
-		lod = lu2lod_dev(lo->ldo_obj.do_lu.lo_dev);
-		LASSERT(lo->ldo_stripe[i]);
+		LASSERT(stripe[i]);
 
-		*fid = *lu_object_fid(&lo->ldo_stripe[i]->do_lu);
+		*fid = *lu_object_fid(&stripe[i]->do_lu);
 		if (OBD_FAIL_CHECK(OBD_FAIL_LFSCK_MULTIPLE_REF)) {
 			if (cfs_fail_val == 0)
 				cfs_fail_val = fid->f_oid;
@@ -713,13 +728,130 @@ int lod_generate_and_set_lovea(const struct lu_env *env,
 		if (rc < 0) {
 			CERROR("%s: Can not locate "DFID": rc = %d\n",
 			       lod2obd(lod)->obd_name, PFID(fid), rc);
-			lod_object_free_striping(env, lo);
 			RETURN(rc);
 		}
 		objs[i].l_ost_idx = cpu_to_le32(index);
 	}
 
-	info->lti_buf.lb_buf = lmm;
+	*lmm_size = lov_mds_md_size(stripenr, magic);
+
+	RETURN(0);
+}
+
+/**
+ * Make LOV EA for a composite layout.
+ *
+ * Pack the header, the component entries and the striping of each component
+ * into \a lcm, which must be large enough (see lod_comp_md_size()).
+ *
+ * \param[in] env		execution environment for this thread
+ * \param[in] lo		LOD object with a composite layout
+ * \param[out] lcm		buffer to pack the layout to
+ *
+ * \retval			size of the packed layout on success
+ * \retval			negative error number on failure
+ */
+static int lod_gen_comp_ea(const struct lu_env *env, struct lod_object *lo,
+			   struct lov_comp_md_v1 *lcm)
+{
+	struct lod_layout_component	*comp;
+	struct lov_comp_md_entry_v1	*lcme;
+	size_t				 offset;
+	size_t				 size;
+	int				 i, rc;
+	ENTRY;
+
+	offset = offsetof(struct lov_comp_md_v1,
+			  lcm_entries[lo->ldo_comp_cnt]);
+	memset(lcm, 0, offset);
+
+	for (i = 0; i < lo->ldo_comp_cnt; i++) {
+		comp = &lo->ldo_comp_entries[i];
+		lcme = &lcm->lcm_entries[i];
+
+		rc = lod_gen_component_ea(env, lo, comp,
+					  (void *)lcm + offset, &size);
+		if (rc < 0)
+			RETURN(rc);
+
+		lcme->lcme_id = cpu_to_le32(comp->llc_id);
+		lcme->lcme_flags = cpu_to_le32(comp->llc_flags);
+		lcme->lcme_extent.e_start =
+			cpu_to_le64(comp->llc_extent.e_start);
+		lcme->lcme_extent.e_end = cpu_to_le64(comp->llc_extent.e_end);
+		lcme->lcme_offset = cpu_to_le32(offset);
+		lcme->lcme_size = cpu_to_le32(size);
+		offset += size;
+	}
+
+	lcm->lcm_magic = cpu_to_le32(LOV_MAGIC_COMP_V1);
+	lcm->lcm_size = cpu_to_le32(offset);
+	lcm->lcm_layout_gen = cpu_to_le32(lo->ldo_layout_gen);
+	lcm->lcm_flags = cpu_to_le16(lo->ldo_flr_state);
+	lcm->lcm_entry_count = cpu_to_le16(lo->ldo_comp_cnt);
+	lcm->lcm_mirror_count = cpu_to_le16(lo->ldo_mirror_count);
+
+	RETURN(offset);
+}
+
+/**
+ * Make LOV EA for striped object.
+ *
+ * Generate striping information and store it in the LOV EA of the given
+ * object. The caller must ensure nobody else is calling the function
+ * against the object concurrently. The transaction must be started.
+ * FLDB service must be running as well; it's used to map FID to the target,
+ * which is stored in LOV EA.
+ *
+ * \param[in] env		execution environment for this thread
+ * \param[in] lo		LOD object
+ * \param[in] th		transaction handle
+ *
+ * \retval			0 if LOV EA is stored successfully
+ * \retval			negative error number on failure
+ */
+int lod_generate_and_set_lovea(const struct lu_env *env,
+			       struct lod_object *lo, struct thandle *th)
+{
+	struct lod_thread_info	*info = lod_env_info(env);
+	struct dt_object	*next = dt_object_child(&lo->ldo_obj);
+	size_t			 lmm_size;
+	int			 rc;
+	ENTRY;
+
+	LASSERT(lo);
+
+	if (lod_is_composite(lo))
+		lmm_size = lod_comp_md_size(lo);
+	else
+		lmm_size = lov_mds_md_size(lo->ldo_stripenr,
+					   lo->ldo_pool != NULL ?
+					   LOV_MAGIC_V3 : LOV_MAGIC_V1);
+	if (info->lti_ea_store_size < lmm_size) {
+		rc = lod_ea_store_resize(info, lmm_size);
+		if (rc)
+			RETURN(rc);
+	}
+
+	if (lod_is_composite(lo)) {
+		rc = lod_gen_comp_ea(env, lo, info->lti_ea_store);
+		if (rc >= 0) {
+			LASSERT(rc == lmm_size);
+			rc = 0;
+		}
+	} else {
+		if (lo->ldo_pattern == 0) /* default striping */
+			lo->ldo_pattern = LOV_PATTERN_RAID0;
+
+		rc = lod_gen_component_ea(env, lo, NULL, info->lti_ea_store,
+					  &lmm_size);
+	}
+	if (rc < 0) {
+		lod_object_free_striping(env, lo);
+		RETURN(rc);
+	}
+
+	info->lti_buf.lb_buf = info->lti_ea_store;
 	info->lti_buf.lb_len = lmm_size;
 	rc = lod_sub_object_xattr_set(env, next, &info->lti_buf, XATTR_NAME_LOV,
 				      0, th);
@@ -821,46 +953,31 @@ static int validate_lod_and_idx(struct lod_device *md, __u32 idx)
 }
 
 /**
- * Instantiate objects for stripes.
- *
- * Allocate and initialize LU-objects representing the stripes. The number
- * of the stripes (ldo_stripenr) must be initialized already. The caller
- * must ensure nobody else is calling the function on the object at the same
- * time. FLDB service must be running to be able to map a FID to the targets
- * and find appropriate device representing that target.
+ * Find the LU-objects of a set of stripes.
  *
  * \param[in] env		execution environment for this thread
- * \param[in,out] lo		LOD object
- * \param[in] objs		an array of IDs to creates the objects from
+ * \param[in] md		LOD device
+ * \param[out] stripe		array to store the objects to
+ * \param[in] objs		an array of IDs to find the objects from
+ * \param[in] nr		number of the stripes
  *
  * \retval			0 if the objects are instantiated successfully
- * \retval			negative error number on failure
+ * \retval			negative error number on failure, the objects
+ *				found so far are left in \a stripe
  */
-int lod_initialize_objects(const struct lu_env *env, struct lod_object *lo,
-			   struct lov_ost_data_v1 *objs)
+static int lod_init_stripe_objects(const struct lu_env *env,
+				   struct lod_device *md,
+				   struct dt_object **stripe,
+				   struct lov_ost_data_v1 *objs, int nr)
 {
 	struct lod_thread_info	*info = lod_env_info(env);
-	struct lod_device	*md;
 	struct lu_object	*o, *n;
 	struct lu_device	*nd;
-	struct dt_object       **stripe;
-	int			 stripe_len;
-	int			 i, rc = 0;
+	int			 i, rc;
 	__u32			idx;
 	ENTRY;
 
-	LASSERT(lo != NULL);
-	md = lu2lod_dev(lo->ldo_obj.do_lu.lo_dev);
-	LASSERT(lo->ldo_stripe == NULL);
-	LASSERT(lo->ldo_stripenr > 0);
-	LASSERT(lo->ldo_stripe_size > 0);
-
-	stripe_len = lo->ldo_stripenr;
-	OBD_ALLOC(stripe, sizeof(stripe[0]) * stripe_len);
-	if (stripe == NULL)
-		RETURN(-ENOMEM);
-
-	for (i = 0; i < lo->ldo_stripenr; i++) {
+	for (i = 0; i < nr; i++) {
 		if (unlikely(lovea_slot_is_dummy(&objs[i])))
 			continue;
 
@@ -868,7 +985,7 @@ int lod_initialize_objects(const struct lu_env *env, struct lod_object *lo,
 		idx = le32_to_cpu(objs[i].l_ost_idx);
 		rc = ostid_to_fid(&info->lti_fid, &info->lti_ostid, idx);
 		if (rc != 0)
-			GOTO(out, rc);
+			RETURN(rc);
 		LASSERTF(fid_is_sane(&info->lti_fid), ""DFID" insane!\n",
 			 PFID(&info->lti_fid));
 		lod_getref(&md->lod_ost_descs);
@@ -876,7 +993,7 @@ int lod_initialize_objects(const struct lu_env *env, struct lod_object *lo,
 		rc = validate_lod_and_idx(md, idx);
 		if (unlikely(rc != 0)) {
 			lod_putref(md, &md->lod_ost_descs);
-			GOTO(out, rc);
+			RETURN(rc);
 		}
 
 		nd = &OST_TGT(md,idx)->ltd_ost->dd_lu_dev;
@@ -887,7 +1004,7 @@ int lod_initialize_objects(const struct lu_env *env, struct lod_object *lo,
 		/* coverity[overrun-buffer-val] */
 		o = lu_object_find_at(env, nd, &info->lti_fid, NULL);
 		if (IS_ERR(o))
-			GOTO(out, rc = PTR_ERR(o));
+			RETURN(PTR_ERR(o));
 
 		n = lu_object_locate(o->lo_header, nd->ld_type);
 		LASSERT(n);
@@ -895,7 +1012,46 @@ int lod_initialize_objects(const struct lu_env *env, struct lod_object *lo,
 		stripe[i] = container_of(n, struct dt_object, do_lu);
 	}
 
-out:
+	RETURN(0);
+}
+
+/**
+ * Instantiate objects for stripes.
+ *
+ * Allocate and initialize LU-objects representing the stripes. The number
+ * of the stripes (ldo_stripenr) must be initialized already. The caller
+ * must ensure nobody else is calling the function on the object at the same
+ * time. FLDB service must be running to be able to map a FID to the targets
+ * and find appropriate device representing that target.
+ *
+ * \param[in] env		execution environment for this thread
+ * \param[in,out] lo		LOD object
+ * \param[in] objs		an array of IDs to creates the objects from
+ *
+ * \retval			0 if the objects are instantiated successfully
+ * \retval			negative error number on failure
+ */
+int lod_initialize_objects(const struct lu_env *env, struct lod_object *lo,
+			   struct lov_ost_data_v1 *objs)
+{
+	struct lod_device	*md;
+	struct dt_object       **stripe;
+	int			 stripe_len;
+	int			 i, rc;
+	ENTRY;
+
+	LASSERT(lo != NULL);
+	md = lu2lod_dev(lo->ldo_obj.do_lu.lo_dev);
+	LASSERT(lo->ldo_stripe == NULL);
+	LASSERT(lo->ldo_stripenr > 0);
+	LASSERT(lo->ldo_stripe_size > 0);
+
+	stripe_len = lo->ldo_stripenr;
+	OBD_ALLOC(stripe, sizeof(stripe[0]) * stripe_len);
+	if (stripe == NULL)
+		RETURN(-ENOMEM);
+
+	rc = lod_init_stripe_objects(env, md, stripe, objs, stripe_len);
 	if (rc != 0) {
 		for (i = 0; i < stripe_len; i++)
 			if (stripe[i] != NULL)
@@ -911,6 +1067,315 @@ out:
 	RETURN(rc);
 }
 
+/**
+ * Allocate the in-core components of a composite layout.
+ *
+ * \param[in,out] lo		LOD object, must have no components yet
+ * \param[in] comp_cnt		number of the components
+ *
+ * \retval			0 on success, -ENOMEM if allocation failed
+ */
+int lod_alloc_comp_entries(struct lod_object *lo, __u16 comp_cnt)
+{
+	LASSERT(lo->ldo_comp_entries == NULL);
+	LASSERT(comp_cnt > 0 && comp_cnt <= LOV_MAX_COMP_COUNT);
+
+	OBD_ALLOC(lo->ldo_comp_entries,
+		  sizeof(lo->ldo_comp_entries[0]) * comp_cnt);
+	if (lo->ldo_comp_entries == NULL)
+		return -ENOMEM;
+	lo->ldo_comp_cnt = comp_cnt;
+
+	return 0;
+}
+
+/**
+ * Release the stripes allocated for a component but not merged yet.
+ *
+ * This happens when a layout change was declared but never executed.
+ *
+ * \param[in] env		execution environment for this thread
+ * \param[in,out] comp		layout component
+ */
+void lod_comp_put_new_stripes(const struct lu_env *env,
+			      struct lod_layout_component *comp)
+{
+	int i;
+
+	if (comp->llc_new_stripe == NULL)
+		return;
+
+	for (i = 0; i < comp->llc_new_stripes_allocated; i++)
+		if (comp->llc_new_stripe[i] != NULL)
+			lu_object_put(env, &comp->llc_new_stripe[i]->do_lu);
+	OBD_FREE(comp->llc_new_stripe,
+		 sizeof(comp->llc_new_stripe[0]) *
+		 comp->llc_new_stripes_allocated);
+	comp->llc_new_stripe = NULL;
+	comp->llc_new_stripes_allocated = 0;
+}
+
+/**
+ * Release the in-core components of a composite layout.
+ *
+ * The stripes of the instantiated components are owned by ldo_stripe[]
+ * and released with it.
+ *
+ * \param[in] env		execution environment for this thread
+ * \param[in,out] lo		LOD object
+ */
+void lod_free_comp_entries(const struct lu_env *env, struct lod_object *lo)
+{
+	struct lod_layout_component	*comp;
+	int				 i;
+
+	if (lo->ldo_comp_entries == NULL)
+		return;
+
+	for (i = 0; i < lo->ldo_comp_cnt; i++) {
+		comp = &lo->ldo_comp_entries[i];
+		lod_set_pool(&comp->llc_pool, NULL);
+		lod_comp_put_new_stripes(env, comp);
+	}
+
+	OBD_FREE(lo->ldo_comp_entries,
+		 sizeof(lo->ldo_comp_entries[0]) * lo->ldo_comp_cnt);
+	lo->ldo_comp_entries = NULL;
+	lo->ldo_comp_cnt = 0;
+	lo->ldo_mirror_count = 0;
+	lo->ldo_flr_state = LCM_FL_NONE;
+}
+
+/**
+ * Calculate the size of the LOV EA of a composite layout.
+ *
+ * Only the instantiated components and the ones a declared layout change
+ * is going to instantiate store their objects.
+ *
+ * \param[in] lo		LOD object with a composite layout
+ *
+ * \retval			size of the LOV EA in bytes
+ */
+size_t lod_comp_md_size(const struct lod_object *lo)
+{
+	const struct lod_layout_component	*comp;
+	size_t					 size;
+	__u16					 stripenr;
+	int					 i;
+
+	size = offsetof(struct lov_comp_md_v1, lcm_entries[lo->ldo_comp_cnt]);
+	for (i = 0; i < lo->ldo_comp_cnt; i++) {
+		comp = &lo->ldo_comp_entries[i];
+		stripenr = 0;
+		if (lod_comp_inited(comp) || comp->llc_new_stripe != NULL)
+			stripenr = comp->llc_stripenr;
+		size += lov_mds_md_size(stripenr, comp->llc_pool != NULL ?
+					LOV_MAGIC_V3 : LOV_MAGIC_V1);
+	}
+
+	return size;
+}
+
+/**
+ * Merge the stripes allocated for components into the object's stripes.
+ *
+ * The stripes the allocator chose for the components being instantiated
+ * are appended to ldo_stripe[] and the components are marked initialized.
+ * The caller must ensure nobody else is using the stripes of the object.
+ *
+ * \param[in,out] lo		LOD object with a composite layout
+ *
+ * \retval			0 on success, -ENOMEM if allocation failed
+ */
+int lod_comp_merge_new_stripes(struct lod_object *lo)
+{
+	struct lod_layout_component	*comp;
+	struct dt_object		**stripe;
+	int				 stripenr = lo->ldo_stripenr;
+	int				 i;
+	ENTRY;
+
+	for (i = 0; i < lo->ldo_comp_cnt; i++) {
+		comp = &lo->ldo_comp_entries[i];
+		if (comp->llc_new_stripe != NULL)
+			stripenr += comp->llc_stripenr;
+	}
+
+	if (stripenr == lo->ldo_stripenr)
+		RETURN(0);
+
+	OBD_ALLOC(stripe, sizeof(stripe[0]) * stripenr);
+	if (stripe == NULL)
+		RETURN(-ENOMEM);
+
+	if (lo->ldo_stripe != NULL) {
+		memcpy(stripe, lo->ldo_stripe,
+		       sizeof(stripe[0]) * lo->ldo_stripenr);
+		OBD_FREE(lo->ldo_stripe,
+			 sizeof(stripe[0]) * lo->ldo_stripes_allocated);
+	}
+	lo->ldo_stripe = stripe;
+	lo->ldo_stripes_allocated = stripenr;
+
+	for (i = 0; i < lo->ldo_comp_cnt; i++) {
+		comp = &lo->ldo_comp_entries[i];
+		if (comp->llc_new_stripe == NULL)
+			continue;
+
+		memcpy(stripe + lo->ldo_stripenr, comp->llc_new_stripe,
+		       sizeof(stripe[0]) * comp->llc_stripenr);
+		comp->llc_stripe_base = lo->ldo_stripenr;
+		comp->llc_flags |= LCME_FL_INIT;
+		lo->ldo_stripenr += comp->llc_stripenr;
+
+		OBD_FREE(comp->llc_new_stripe,
+			 sizeof(stripe[0]) * comp->llc_new_stripes_allocated);
+		comp->llc_new_stripe = NULL;
+		comp->llc_new_stripes_allocated = 0;
+	}
+
+	RETURN(0);
+}
+
+/**
+ * Instantiate objects for a composite layout.
+ *
+ * Parse the components of the composite LOV EA in \a buf and instantiate
+ * the objects of the initialized ones.
+ *
+ * \param[in] env		execution environment for this thread
+ * \param[in] lo		LOD object
+ * \param[in] buf		buffer storing LOV EA to parse
+ *
+ * \retval			0 if parsing and objects creation succeed
+ * \retval			negative error number on failure
+ */
+static int lod_parse_comp_striping(const struct lu_env *env,
+				   struct lod_object *lo,
+				   const struct lu_buf *buf)
+{
+	struct lod_device		*md;
+	struct lov_comp_md_v1		*lcm = buf->lb_buf;
+	struct lov_comp_md_entry_v1	*lcme;
+	struct lod_layout_component	*comp;
+	struct lov_mds_md_v1		*lmm;
+	struct lov_ost_data_v1		*objs;
+	struct dt_object		**stripe = NULL;
+	__u32				 magic;
+	__u32				 offset;
+	__u32				 size;
+	__u16				 comp_cnt;
+	int				 stripenr = 0;
+	int				 i, rc;
+	ENTRY;
+
+	md = lu2lod_dev(lo->ldo_obj.do_lu.lo_dev);
+	comp_cnt = le16_to_cpu(lcm->lcm_entry_count);
+	if (comp_cnt == 0 || comp_cnt > LOV_MAX_COMP_COUNT ||
+	    buf->lb_len < offsetof(struct lov_comp_md_v1,
+				   lcm_entries[comp_cnt]))
+		RETURN(-EINVAL);
+
+	lod_free_comp_entries(env, lo);
+	rc = lod_alloc_comp_entries(lo, comp_cnt);
+	if (rc)
+		RETURN(rc);
+
+	for (i = 0; i < comp_cnt; i++) {
+		lcme = &lcm->lcm_entries[i];
+		comp = &lo->ldo_comp_entries[i];
+
+		offset = le32_to_cpu(lcme->lcme_offset);
+		size = le32_to_cpu(lcme->lcme_size);
+		if (size < sizeof(*lmm) || offset + size > buf->lb_len)
+			GOTO(out, rc = -EINVAL);
+
+		lmm = (struct lov_mds_md_v1 *)((char *)lcm + offset);
+		magic = le32_to_cpu(lmm->lmm_magic);
+		if (magic != LOV_MAGIC_V1 && magic != LOV_MAGIC_V3)
+			GOTO(out, rc = -EINVAL);
+
+		comp->llc_id = le32_to_cpu(lcme->lcme_id);
+		comp->llc_flags = le32_to_cpu(lcme->lcme_flags);
+		comp->llc_extent.e_start =
+			le64_to_cpu(lcme->lcme_extent.e_start);
+		comp->llc_extent.e_end = le64_to_cpu(lcme->lcme_extent.e_end);
+		comp->llc_pattern = le32_to_cpu(lmm->lmm_pattern);
+		if (lov_pattern(comp->llc_pattern) != LOV_PATTERN_RAID0)
+			GOTO(out, rc = -EINVAL);
+		comp->llc_stripe_size = le32_to_cpu(lmm->lmm_stripe_size);
+		comp->llc_stripenr = le16_to_cpu(lmm->lmm_stripe_count);
+
+		if (magic == LOV_MAGIC_V3) {
+			struct lov_mds_md_v3 *v3 = (struct lov_mds_md_v3 *)lmm;
+
+			rc = lod_set_pool(&comp->llc_pool, v3->lmm_pool_name);
+			if (rc)
+				GOTO(out, rc);
+		}
+
+		if (lod_comp_inited(comp)) {
+			if (size < lov_mds_md_size(comp->llc_stripenr, magic))
+				GOTO(out, rc = -EINVAL);
+			comp->llc_stripe_base = stripenr;
+			stripenr += comp->llc_stripenr;
+		} else {
+			comp->llc_stripe_offset =
+				le16_to_cpu(lmm->lmm_layout_gen);
+		}
+	}
+
+	lo->ldo_pattern = LOV_PATTERN_RAID0;
+	lo->ldo_stripe_size = lo->ldo_comp_entries[0].llc_stripe_size;
+	lo->ldo_layout_gen = le32_to_cpu(lcm->lcm_layout_gen);
+	lo->ldo_mirror_count = le16_to_cpu(lcm->lcm_mirror_count);
+	lo->ldo_flr_state = le16_to_cpu(lcm->lcm_flags) & LCM_FL_FLR_MASK;
+	if (stripenr == 0)
+		GOTO(out, rc = 0);
+
+	OBD_ALLOC(stripe, sizeof(stripe[0]) * stripenr);
+	if (stripe == NULL)
+		GOTO(out, rc = -ENOMEM);
+
+	for (i = 0; i < comp_cnt; i++) {
+		comp = &lo->ldo_comp_entries[i];
+		if (!lod_comp_inited(comp))
+			continue;
+
+		lmm = (struct lov_mds_md_v1 *)((char *)lcm +
+			le32_to_cpu(lcm->lcm_entries[i].lcme_offset));
+		if (le32_to_cpu(lmm->lmm_magic) == LOV_MAGIC_V3)
+			objs = ((struct lov_mds_md_v3 *)lmm)->lmm_objects;
+		else
+			objs = lmm->lmm_objects;
+
+		rc = lod_init_stripe_objects(env, md,
+					     stripe + comp->llc_stripe_base,
+					     objs, comp->llc_stripenr);
+		if (rc != 0)
+			break;
+	}
+
+	if (rc != 0) {
+		for (i = 0; i < stripenr; i++)
+			if (stripe[i] != NULL)
+				lu_object_put(env, &stripe[i]->do_lu);
+
+		OBD_FREE(stripe, sizeof(stripe[0]) * stripenr);
+	} else {
+		lo->ldo_stripe = stripe;
+		lo->ldo_stripes_allocated = stripenr;
+		lo->ldo_stripenr = stripenr;
+	}
+out:
+	if (rc != 0) {
+		lod_free_comp_entries(env, lo);
+		lo->ldo_stripenr = 0;
+	}
+
+	RETURN(rc);
+}
+
 /**
  * Instantiate objects for striping.
  *
@@ -942,17 +1407,24 @@ int lod_parse_striping(const struct lu_env *env, struct lod_object *lo,
 	magic = le32_to_cpu(lmm->lmm_magic);
 	pattern = le32_to_cpu(lmm->lmm_pattern);
 
+	if (magic == LOV_MAGIC_COMP_V1) {
+		rc = lod_parse_comp_striping(env, lo, buf);
+		GOTO(out, rc);
+	}
+
 	if (magic != LOV_MAGIC_V1 && magic != LOV_MAGIC_V3)
 		GOTO(out, rc = -EINVAL);
-	if (lov_pattern(pattern) != LOV_PATTERN_RAID0)
+	if (lov_pattern(pattern) != LOV_PATTERN_RAID0 &&
+	    lov_pattern(pattern) != LOV_PATTERN_MDT)
 		GOTO(out, rc = -EINVAL);
 
 	lo->ldo_pattern = pattern;
 	lo->ldo_stripe_size = le32_to_cpu(lmm->lmm_stripe_size);
 	lo->ldo_layout_gen = le16_to_cpu(lmm->lmm_layout_gen);
 	lo->ldo_stripenr = le16_to_cpu(lmm->lmm_stripe_count);
-	/* released file stripenr fixup. */
-	if (pattern & LOV_PATTERN_F_RELEASED)
+	/* released file stripenr fixup, data on MDT has no OST objects */
+	if (pattern & LOV_PATTERN_F_RELEASED ||
+	    lov_pattern(pattern) == LOV_PATTERN_MDT)
 		lo->ldo_stripenr = 0;
 
 	LASSERT(buf->lb_len >= lov_mds_md_size(lo->ldo_stripenr, magic));
@@ -993,8 +1465,8 @@ int lod_load_striping_locked(const struct lu_env *env, struct lod_object *lo)
 	int			 rc = 0;
 	ENTRY;
 
-	/* already initialized? */
-	if (lo->ldo_stripe != NULL)
+	/* already initialized? a composite file may have no stripes yet */
+	if (lo->ldo_stripe != NULL || lo->ldo_comp_entries != NULL)
 		GOTO(out, rc = 0);
 
 	if (!dt_object_exists(next))
@@ -1131,7 +1603,8 @@ int lod_verify_striping(struct lod_device *d, const struct lu_buf *buf,
 	if (!is_from_disk && lum->lmm_pattern == 0)
 		lum->lmm_pattern = cpu_to_le32(LOV_PATTERN_RAID0);
 
-	if (le32_to_cpu(lum->lmm_pattern) != LOV_PATTERN_RAID0) {
+	if (le32_to_cpu(lum->lmm_pattern) != LOV_PATTERN_RAID0 &&
+	    le32_to_cpu(lum->lmm_pattern) != LOV_PATTERN_MDT) {
 		CDEBUG(D_IOCTL, "bad userland stripe pattern: %#x\n",
 		       le32_to_cpu(lum->lmm_pattern));
 		GOTO(out, rc = -EINVAL);
@@ -1146,6 +1619,17 @@ int lod_verify_striping(struct lod_device *d, const struct lu_buf *buf,
 		GOTO(out, rc = -EINVAL);
 	}
 
+	/* data on MDT is bounded by dom_stripesize, the whole file lives in
+	 * the single "stripe" on the MDT */
+	if (!is_from_disk &&
+	    le32_to_cpu(lum->lmm_pattern) == LOV_PATTERN_MDT &&
+	    (d->lod_dom_max_stripesize == 0 ||
+	     stripe_size > d->lod_dom_max_stripesize)) {
+		CDEBUG(D_IOCTL, "DoM stripe size %u, max %u\n",
+		       stripe_size, d->lod_dom_max_stripesize);
+		GOTO(out, rc = -EINVAL);
+	}
+
 	stripe_offset = le16_to_cpu(lum->lmm_stripe_offset);
 	if (stripe_offset != LOV_OFFSET_DEFAULT) {
 		/* if offset is not within valid range [0, osts_size) */
@@ -2116,6 +2116,7 @@ static void lod_lov_stripe_cache_clear(struct lod_object *lo)
 	lo->ldo_def_striping_cached = 0;
 	lod_object_set_pool(lo, NULL);
 	lo->ldo_def_stripe_size = 0;
+	lo->ldo_def_pattern = 0;
 	lo->ldo_def_stripenr = 0;
 	if (lo->ldo_dir_stripe != NULL)
 		lo->ldo_dir_def_striping_cached = 0;
@@ -2626,6 +2627,7 @@ static int lod_dir_striping_create_internal(const struct lu_env *env,
 
 		memset(v3, 0, sizeof(*v3));
 		v3->lmm_magic = cpu_to_le32(LOV_USER_MAGIC_V3);
+		v3->lmm_pattern = cpu_to_le32(lo->ldo_def_pattern);
 		v3->lmm_stripe_count = cpu_to_le16(lo->ldo_def_stripenr);
 		v3->lmm_stripe_offset = cpu_to_le16(lo->ldo_def_stripe_offset);
 		v3->lmm_stripe_size = cpu_to_le32(lo->ldo_def_stripe_size);
@@ -2853,6 +2855,33 @@ static int lod_xattr_list(const struct lu_env *env,
 	return dt_xattr_list(env, dt_object_child(dt), buf);
 }
 
+/**
+ * Replace a pool name kept in the object or in one of its components.
+ *
+ * \param[in,out] pool	pool name to replace, freed if \a new_pool is NULL
+ * \param[in] new_pool	new pool name or NULL
+ *
+ * \retval		0 on success, -ENOMEM if allocation failed
+ */
+int lod_set_pool(char **pool, const char *new_pool)
+{
+	int len;
+
+	if (*pool) {
+		len = strlen(*pool);
+		OBD_FREE(*pool, len + 1);
+		*pool = NULL;
+	}
+	if (new_pool) {
+		len = strlen(new_pool);
+		OBD_ALLOC(*pool, len + 1);
+		if (*pool == NULL)
+			return -ENOMEM;
+		strcpy(*pool, new_pool);
+	}
+	return 0;
+}
+
 /**
  * Initialize a pool the object belongs to.
  *
@@ -2868,21 +2897,7 @@ static int lod_xattr_list(const struct lu_env *env,
  */
 int lod_object_set_pool(struct lod_object *o, char *pool)
 {
-	int len;
-
-	if (o->ldo_pool) {
-		len = strlen(o->ldo_pool);
-		OBD_FREE(o->ldo_pool, len + 1);
-		o->ldo_pool = NULL;
-	}
-	if (pool) {
-		len = strlen(pool);
-		OBD_ALLOC(o->ldo_pool, len + 1);
-		if (o->ldo_pool == NULL)
-			return -ENOMEM;
-		strcpy(o->ldo_pool, pool);
-	}
-	return 0;
+	return lod_set_pool(&o->ldo_pool, pool);
 }
 
 static inline int lod_object_will_be_striped(int is_reg, const struct lu_fid *fid)
@@ -2924,6 +2939,7 @@ static int lod_cache_parent_lov_striping(const struct lu_env *env,
 		lp->ldo_def_striping_set = 0;
 		lp->ldo_def_striping_cached = 1;
 		lp->ldo_def_stripe_size = 0;
+		lp->ldo_def_pattern = 0;
 		lp->ldo_def_stripenr = 0;
 		lp->ldo_def_stripe_offset = (typeof(v1->lmm_stripe_offset))(-1);
 		GOTO(unlock, rc = 0);
@@ -2941,7 +2957,8 @@ static int lod_cache_parent_lov_striping(const struct lu_env *env,
 	if (v1->lmm_magic != LOV_MAGIC_V3 && v1->lmm_magic != LOV_MAGIC_V1)
 		GOTO(unlock, rc = 0);
 
-	if (v1->lmm_pattern != LOV_PATTERN_RAID0 && v1->lmm_pattern != 0)
+	if (v1->lmm_pattern != LOV_PATTERN_RAID0 &&
+	    v1->lmm_pattern != LOV_PATTERN_MDT && v1->lmm_pattern != 0)
 		GOTO(unlock, rc = 0);
 
 	CDEBUG(D_INFO, DFID" stripe_count=%d stripe_size=%d stripe_offset=%d\n",
@@ -2951,6 +2968,7 @@ static int lod_cache_parent_lov_striping(const struct lu_env *env,
 
 	lp->ldo_def_stripenr = v1->lmm_stripe_count;
 	lp->ldo_def_stripe_size = v1->lmm_stripe_size;
+	lp->ldo_def_pattern = v1->lmm_pattern;
 	lp->ldo_def_stripe_offset = v1->lmm_stripe_offset;
 	lp->ldo_def_striping_cached = 1;
 	lp->ldo_def_striping_set = 1;
@@ -3131,6 +3149,7 @@ static void lod_ah_init(const struct lu_env *env,
 				lod_object_set_pool(lc, lp->ldo_pool);
 			lc->ldo_def_stripenr = lp->ldo_def_stripenr;
 			lc->ldo_def_stripe_size = lp->ldo_def_stripe_size;
+			lc->ldo_def_pattern = lp->ldo_def_pattern;
 			lc->ldo_def_stripe_offset = lp->ldo_def_stripe_offset;
 			lc->ldo_def_striping_set = 1;
 			lc->ldo_def_striping_cached = 1;
@@ -3228,6 +3247,7 @@ static void lod_ah_init(const struct lu_env *env,
 				lod_object_set_pool(lc, lp->ldo_pool);
 			lc->ldo_stripenr = lp->ldo_def_stripenr;
 			lc->ldo_stripe_size = lp->ldo_def_stripe_size;
+			lc->ldo_pattern = lp->ldo_def_pattern;
 			lc->ldo_def_stripe_offset = lp->ldo_def_stripe_offset;
 			CDEBUG(D_OTHER, "striping from parent: #%d, sz %d %s\n",
 			       lc->ldo_stripenr, lc->ldo_stripe_size,
@@ -3280,7 +3300,9 @@ static int lod_declare_init_size(const struct lu_env *env,
 	struct lod_object  *lo = lod_dt_obj(dt);
 	struct lu_attr	   *attr = &lod_env_info(env)->lti_attr;
 	uint64_t	    size, offs;
-	int		    rc, stripe;
+	__u32		    stripe_size = lo->ldo_stripe_size;
+	__u16		    stripenr = lo->ldo_stripenr;
+	int		    rc, stripe, base = 0;
 	ENTRY;
 
 	/* XXX: we support the simplest (RAID0) striping so far */
@@ -3299,19 +3321,39 @@ static int lod_declare_init_size(const struct lu_env *env,
 	if (size == 0)
 		RETURN(0);
 
+	/* the size ends in the component holding its last byte, all the
+	 * components up to it were instantiated with the striping; like on
+	 * the client, the object offsets are computed from the file offset
+	 * with the striping of the component */
+	if (lod_is_composite(lo)) {
+		struct lod_layout_component *comp = NULL;
+		int i;
+
+		for (i = 0; i < lo->ldo_comp_cnt; i++) {
+			comp = &lo->ldo_comp_entries[i];
+			if (size <= comp->llc_extent.e_end)
+				break;
+		}
+		LASSERT(comp != NULL && lod_comp_inited(comp));
+
+		stripe_size = comp->llc_stripe_size;
+		stripenr = comp->llc_stripenr;
+		base = comp->llc_stripe_base;
+	}
+	offs = size;
+
 	/* ll_do_div64(a, b) returns a % b, and a = a / b */
-	ll_do_div64(size, (__u64) lo->ldo_stripe_size);
-	stripe = ll_do_div64(size, (__u64) lo->ldo_stripenr);
+	ll_do_div64(size, (__u64) stripe_size);
+	stripe = ll_do_div64(size, (__u64) stripenr);
 
-	size = size * lo->ldo_stripe_size;
-	offs = attr->la_size;
-	size += ll_do_div64(offs, lo->ldo_stripe_size);
+	size = size * stripe_size;
+	size += ll_do_div64(offs, stripe_size);
 
 	attr->la_valid = LA_SIZE;
 	attr->la_size = size;
 
-	rc = lod_sub_object_declare_attr_set(env, lo->ldo_stripe[stripe], attr,
-					     th);
+	rc = lod_sub_object_declare_attr_set(env, lo->ldo_stripe[base + stripe],
+					     attr, th);
 
 	RETURN(rc);
 }
@@ -3365,7 +3407,10 @@ int lod_declare_striped_object(const struct lu_env *env, struct dt_object *dt,
 		/*
 		 * declare storage for striping data
 		 */
-		info->lti_buf.lb_len = lov_mds_md_size(lo->ldo_stripenr,
+		if (lod_is_composite(lo))
+			info->lti_buf.lb_len = lod_comp_md_size(lo);
+		else
+			info->lti_buf.lb_len = lov_mds_md_size(lo->ldo_stripenr,
 				lo->ldo_pool ?  LOV_MAGIC_V3 : LOV_MAGIC_V1);
 	} else {
 		/* LOD can not choose OST objects for remote objects, i.e.
@@ -3580,8 +3625,11 @@ static int lod_object_create(const struct lu_env *env, struct dt_object *dt,
 	if (rc != 0)
 		RETURN(rc);
 
+	/* data on MDT has a layout but no stripe objects */
 	if (S_ISREG(dt->do_lu.lo_header->loh_attr) &&
-	    lo->ldo_stripe && dof->u.dof_reg.striped != 0)
+	    (lo->ldo_stripe != NULL ||
+	     lov_pattern(lo->ldo_pattern) == LOV_PATTERN_MDT) &&
+	    dof->u.dof_reg.striped != 0)
 		rc = lod_striping_create(env, dt, attr, dof, th);
 
 	RETURN(rc);
@@ -3980,6 +4028,380 @@ out:
 	RETURN(rc);
 }
 
+/**
+ * Find the primary mirror of a mirrored file.
+ *
+ * Writes go to the mirror which has no stale components; when all the
+ * mirrors are in sync the first one is used.
+ *
+ * \param[in] lo	LOD object with a mirrored layout
+ *
+ * \retval		mirror id of the primary mirror
+ * \retval -EIO		if all the mirrors have stale components
+ */
+static int lod_primary_mirror(const struct lod_object *lo)
+{
+	struct lod_layout_component	*comp;
+	__u32				 stale = 0;
+	int				 i;
+
+	for (i = 0; i < lo->ldo_comp_cnt; i++) {
+		comp = &lo->ldo_comp_entries[i];
+		if (lod_comp_stale(comp))
+			stale |= 1 << mirror_id_of(comp->llc_id);
+	}
+
+	for (i = 1; i <= lo->ldo_mirror_count; i++)
+		if (!(stale & (1 << i)))
+			return i;
+
+	CERROR(DFID": no mirror is in sync\n",
+	       PFID(lu_object_fid(&lo->ldo_obj.do_lu)));
+	return -EIO;
+}
+
+/**
+ * Get the extents a write or truncate intent on a mirrored file covers.
+ *
+ * \param[in] layout	layout intent
+ * \param[out] write	extent of the primary mirror to instantiate
+ * \param[out] stale	extent the other mirrors become stale in
+ */
+static void lod_mirror_intent_ext(const struct layout_intent *layout,
+				  struct lu_extent *write,
+				  struct lu_extent *stale)
+{
+	stale->e_start = layout->li_start;
+	stale->e_end = layout->li_end;
+	*write = *stale;
+
+	/* only the component the new EOF is in needs objects to hold the
+	 * size; nothing is written when the file is truncated to 0 */
+	if (layout->li_opc == LAYOUT_INTENT_TRUNC) {
+		write->e_end = write->e_start;
+		if (write->e_start > 0)
+			write->e_start--;
+	}
+}
+
+/**
+ * Check whether a primary mirror component overlapping \a ext has objects.
+ */
+static bool lod_mirror_has_data(const struct lod_object *lo, int primary,
+				const struct lu_extent *ext)
+{
+	struct lod_layout_component	*comp;
+	int				 i;
+
+	for (i = 0; i < lo->ldo_comp_cnt; i++) {
+		comp = &lo->ldo_comp_entries[i];
+		if (mirror_id_of(comp->llc_id) == primary &&
+		    lod_comp_inited(comp) &&
+		    lu_extent_is_overlapped(&comp->llc_extent, ext))
+			return true;
+	}
+
+	return false;
+}
+
+/**
+ * Update the flags and the state of a mirrored file for a layout intent.
+ *
+ * A write or truncate makes the components of the other mirrors it covers
+ * stale, the file stays LCM_FL_WRITE_PENDING until it is resynchronized.
+ * Resync moves the file to LCM_FL_SYNC_PENDING, and once the data is copied
+ * LAYOUT_INTENT_RESYNC_DONE clears the stale flags.
+ *
+ * \param[in] lo	LOD object with a mirrored layout
+ * \param[in] layout	layout intent
+ * \param[in] primary	primary mirror id
+ * \param[in] update	false to only check whether anything changes
+ *
+ * \retval		true if the layout changes
+ */
+static bool lod_mirror_update(struct lod_object *lo,
+			      const struct layout_intent *layout,
+			      int primary, bool update)
+{
+	struct lod_layout_component	*comp;
+	struct lu_extent		 write, stale;
+	__u16				 state;
+	bool				 changed = false;
+	int				 i;
+
+	switch (layout->li_opc) {
+	case LAYOUT_INTENT_WRITE:
+	case LAYOUT_INTENT_TRUNC:
+		state = LCM_FL_WRITE_PENDING;
+		lod_mirror_intent_ext(layout, &write, &stale);
+		for (i = 0; i < lo->ldo_comp_cnt; i++) {
+			comp = &lo->ldo_comp_entries[i];
+			if (mirror_id_of(comp->llc_id) == primary ||
+			    lod_comp_stale(comp) ||
+			    !lu_extent_is_overlapped(&comp->llc_extent, &stale))
+				continue;
+			changed = true;
+			if (update)
+				comp->llc_flags |= LCME_FL_STALE;
+		}
+		break;
+	case LAYOUT_INTENT_RESYNC:
+		state = LCM_FL_SYNC_PENDING;
+		break;
+	case LAYOUT_INTENT_RESYNC_DONE:
+		state = LCM_FL_RDONLY;
+		for (i = 0; i < lo->ldo_comp_cnt; i++) {
+			comp = &lo->ldo_comp_entries[i];
+			if (!lod_comp_stale(comp))
+				continue;
+			changed = true;
+			if (update)
+				comp->llc_flags &= ~LCME_FL_STALE;
+		}
+		break;
+	default:
+		LBUG();
+	}
+
+	if (lo->ldo_flr_state != state) {
+		changed = true;
+		if (update)
+			lo->ldo_flr_state = state;
+	}
+
+	return changed;
+}
+
+/**
+ * Declare a layout change of a mirrored file.
+ *
+ * Check the intent against the state of the file and allocate the stripes
+ * the change needs: the primary mirror components a write lands in, or
+ * the stale components resync is going to copy the data to.
+ *
+ * \param[in] env	execution environment for this thread
+ * \param[in] lo	LOD object with a mirrored layout
+ * \param[in] layout	layout intent
+ * \param[in] attr	attributes OST objects will be declared with
+ * \param[in] th	transaction handle
+ *
+ * \retval 0		on success
+ * \retval -EALREADY	if the layout does not change
+ * \retval -EBUSY	if the file was modified while it was resynchronized
+ * \retval negative	negated errno on other errors
+ */
+static int lod_declare_mirror_change(const struct lu_env *env,
+				     struct lod_object *lo,
+				     struct layout_intent *layout,
+				     struct lu_attr *attr,
+				     struct thandle *th)
+{
+	struct lod_layout_component	*comp;
+	struct lu_extent		 write, stale;
+	bool				 changed;
+	int				 primary, i, rc;
+	ENTRY;
+
+	primary = lod_primary_mirror(lo);
+	if (primary < 0)
+		RETURN(primary);
+
+	switch (layout->li_opc) {
+	case LAYOUT_INTENT_WRITE:
+	case LAYOUT_INTENT_TRUNC:
+		lod_mirror_intent_ext(layout, &write, &stale);
+		changed = lod_mirror_update(lo, layout, primary, false);
+		for (i = 0; i < lo->ldo_comp_cnt && !changed; i++) {
+			comp = &lo->ldo_comp_entries[i];
+			if (mirror_id_of(comp->llc_id) == primary &&
+			    !lod_comp_inited(comp) &&
+			    lu_extent_is_overlapped(&comp->llc_extent, &write))
+				changed = true;
+		}
+		if (!changed)
+			RETURN(-EALREADY);
+
+		rc = lod_qos_prep_comp_create(env, lo, attr, &write, primary,
+					      th);
+		break;
+	case LAYOUT_INTENT_RESYNC:
+		if (lo->ldo_flr_state == LCM_FL_RDONLY)
+			RETURN(-EALREADY);
+
+		rc = 0;
+		for (i = 0; i < lo->ldo_comp_cnt && rc == 0; i++) {
+			comp = &lo->ldo_comp_entries[i];
+			if (!lod_comp_stale(comp) || lod_comp_inited(comp) ||
+			    !lod_mirror_has_data(lo, primary, &comp->llc_extent))
+				continue;
+
+			rc = lod_qos_prep_comp_create(env, lo, attr,
+						      &comp->llc_extent,
+						      mirror_id_of(comp->llc_id),
+						      th);
+		}
+		break;
+	case LAYOUT_INTENT_RESYNC_DONE:
+		/* the layout generation tells whether the file was written
+		 * while the data was copied */
+		if (lo->ldo_flr_state != LCM_FL_SYNC_PENDING ||
+		    layout->li_flags != lo->ldo_layout_gen)
+			RETURN(-EBUSY);
+		rc = 0;
+		break;
+	default:
+		rc = -EOPNOTSUPP;
+		break;
+	}
+
+	RETURN(rc);
+}
+
+/**
+ * Implementation of dt_object_operations::do_declare_layout_change.
+ *
+ * Allocate the stripes of the components of a composite layout which
+ * overlap the extent of a write intent and are not instantiated yet.
+ * Mirrored files also handle truncate and resync intents, see
+ * lod_declare_mirror_change().
+ *
+ * \see dt_object_operations::do_declare_layout_change() in the API
+ * description for details.
+ */
+static int lod_declare_layout_change(const struct lu_env *env,
+				     struct dt_object *dt,
+				     struct layout_intent *layout,
+				     struct thandle *th)
+{
+	struct lod_thread_info		*info = lod_env_info(env);
+	struct lod_object		*lo = lod_dt_obj(dt);
+	struct dt_object		*next = dt_object_child(dt);
+	struct lod_layout_component	*comp;
+	struct lu_attr			*attr = &info->lti_attr;
+	struct lu_extent		 ext;
+	bool				 changed = false;
+	int				 i, rc;
+	ENTRY;
+
+	if (!S_ISREG(dt->do_lu.lo_header->loh_attr) || !dt_object_exists(dt) ||
+	    dt_object_remote(next))
+		RETURN(-EINVAL);
+
+	if (layout->li_opc != LAYOUT_INTENT_WRITE &&
+	    layout->li_opc != LAYOUT_INTENT_TRUNC &&
+	    layout->li_opc != LAYOUT_INTENT_RESYNC &&
+	    layout->li_opc != LAYOUT_INTENT_RESYNC_DONE)
+		RETURN(-EOPNOTSUPP);
+
+	if (layout->li_start >= layout->li_end)
+		RETURN(-EINVAL);
+
+	rc = lod_load_striping(env, lo);
+	if (rc)
+		RETURN(rc);
+
+	if (!lod_is_composite(lo))
+		RETURN(-EINVAL);
+
+	/* only mirrored files have a state to truncate or resync */
+	if (!lod_is_mirrored(lo) && layout->li_opc != LAYOUT_INTENT_WRITE)
+		RETURN(-EOPNOTSUPP);
+
+	ext.e_start = layout->li_start;
+	ext.e_end = layout->li_end;
+
+	for (i = 0; i < lo->ldo_comp_cnt; i++) {
+		comp = &lo->ldo_comp_entries[i];
+		/* leftover of a layout change which was not executed */
+		lod_comp_put_new_stripes(env, comp);
+		if (!lod_comp_inited(comp) &&
+		    lu_extent_is_overlapped(&comp->llc_extent, &ext))
+			changed = true;
+	}
+
+	if (!changed && !lod_is_mirrored(lo))
+		RETURN(-EALREADY);
+
+	rc = dt_attr_get(env, next, attr);
+	if (rc)
+		GOTO(out, rc);
+
+	if (lod_is_mirrored(lo))
+		rc = lod_declare_mirror_change(env, lo, layout, attr, th);
+	else
+		rc = lod_qos_prep_comp_create(env, lo, attr, &ext, -1, th);
+	if (rc == -EALREADY)
+		RETURN(rc);
+	if (rc)
+		GOTO(out, rc);
+
+	info->lti_buf.lb_buf = NULL;
+	info->lti_buf.lb_len = lod_comp_md_size(lo);
+	rc = lod_sub_object_declare_xattr_set(env, next, &info->lti_buf,
+					      XATTR_NAME_LOV, 0, th);
+	EXIT;
+out:
+	if (rc)
+		lod_object_free_striping(env, lo);
+	return rc;
+}
+
+/**
+ * Implementation of dt_object_operations::do_layout_change.
+ *
+ * Create the stripes allocated by lod_declare_layout_change(), add them to
+ * the layout, update the mirror state and store the new LOV EA.
+ *
+ * \see dt_object_operations::do_layout_change() in the API description
+ * for details.
+ */
+static int lod_layout_change(const struct lu_env *env, struct dt_object *dt,
+			     struct layout_intent *layout, struct thandle *th)
+{
+	struct lod_object		*lo = lod_dt_obj(dt);
+	struct lod_layout_component	*comp;
+	int				 i, j, rc = 0;
+	ENTRY;
+
+	LASSERT(lod_is_composite(lo));
+
+	for (i = 0; i < lo->ldo_comp_cnt; i++) {
+		comp = &lo->ldo_comp_entries[i];
+		if (comp->llc_new_stripe == NULL)
+			continue;
+
+		for (j = 0; j < comp->llc_stripenr; j++) {
+			rc = lod_sub_object_create(env,
+						   comp->llc_new_stripe[j],
+						   NULL, NULL, NULL, th);
+			if (rc)
+				GOTO(out, rc);
+		}
+	}
+
+	rc = lod_comp_merge_new_stripes(lo);
+	if (rc)
+		GOTO(out, rc);
+
+	/* the primary mirror is picked the same way as at declare time, the
+	 * stripes just merged do not change it */
+	if (lod_is_mirrored(lo)) {
+		rc = lod_primary_mirror(lo);
+		if (rc < 0)
+			GOTO(out, rc);
+		lod_mirror_update(lo, layout, rc, true);
+		rc = 0;
+	}
+
+	lo->ldo_layout_gen++;
+	rc = lod_generate_and_set_lovea(env, lo, th);
+	EXIT;
+out:
+	if (rc)
+		lod_object_free_striping(env, lo);
+	return rc;
+}
+
 struct dt_object_operations lod_obj_ops = {
 	.do_read_lock		= lod_object_read_lock,
 	.do_write_lock		= lod_object_write_lock,
@@ -4008,6 +4430,8 @@ struct dt_object_operations lod_obj_ops = {
 	.do_object_sync		= lod_object_sync,
 	.do_object_lock		= lod_object_lock,
 	.do_object_unlock	= lod_object_unlock,
+	.do_declare_layout_change = lod_declare_layout_change,
+	.do_layout_change	= lod_layout_change,
 };
 
 /**
@@ -4188,6 +4612,7 @@ void lod_object_free_striping(const struct lu_env *env, struct lod_object *lo)
 		lo->ldo_stripe = NULL;
 		lo->ldo_stripes_allocated = 0;
 	}
+	lod_free_comp_entries(env, lo);
 	lo->ldo_striping_cached = 0;
 	lo->ldo_stripenr = 0;
 	lo->ldo_pattern = 0;
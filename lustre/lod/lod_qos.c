@@ -1652,6 +1652,11 @@ static int lod_use_defined_striping(const struct lu_env *env,
 		magic = LOV_MAGIC_V3;
 		objs = &v3->lmm_objects[0];
 		lod_object_set_pool(mo, v3->lmm_pool_name);
+	} else if (magic == LOV_MAGIC_COMP_V1_DEF) {
+		/* a composite layout is stored as is */
+		v1->lmm_magic = cpu_to_le32(LOV_MAGIC_COMP_V1);
+		rc = lod_parse_striping(env, mo, buf);
+		GOTO(out, rc);
 	} else {
 		GOTO(out, rc = -EINVAL);
 	}
@@ -1676,6 +1681,207 @@ out:
 	RETURN(rc);
 }
 
+/**
+ * Parse a suggested composite layout.
+ *
+ * Verify the components of the composite layout \a buf describes and store
+ * them in the object; the stripes are allocated later, when the components
+ * are instantiated. Each component is a plain v1/v3 hint for the extent it
+ * covers, the extents must follow each other from 0 to EOF. A mirrored
+ * layout is several such sequences in a row, a new mirror starts with a
+ * component at offset 0 after the previous mirror reached EOF.
+ *
+ * \param[in] env	execution environment for this thread
+ * \param[in] lo	LOD object
+ * \param[in] buf	buffer containing the composite layout (host endian)
+ *
+ * \retval 0		on success
+ * \retval negative	negated errno on error
+ */
+static int lod_qos_parse_comp_config(const struct lu_env *env,
+				     struct lod_object *lo,
+				     const struct lu_buf *buf)
+{
+	struct lod_device		*d = lu2lod_dev(lod2lu_obj(lo)->lo_dev);
+	struct lov_comp_md_v1		*lcm = buf->lb_buf;
+	struct lov_comp_md_entry_v1	*lcme;
+	struct lod_layout_component	*comp;
+	struct lov_user_md_v1		*v1;
+	struct lov_user_md_v3		*v3;
+	struct pool_desc		*pool;
+	char				*pool_name;
+	__u64				 prev_end = LUSTRE_EOF;
+	__u32				 stripe_size;
+	__u16				 comp_cnt;
+	__u16				 mirror_cnt = 0;
+	int				 i, rc;
+	ENTRY;
+
+	/* lustre_swab_lov_comp_md_v1() leaves a layout that does not fit
+	 * in the buffer in the wrong byte order */
+	if (buf->lb_len < sizeof(*lcm) ||
+	    lcm->lcm_magic != LOV_USER_MAGIC_COMP_V1 ||
+	    buf->lb_len < lcm->lcm_size) {
+		CERROR("%s: wrong composite layout size: %zd\n",
+		       lod2obd(d)->obd_name, buf->lb_len);
+		RETURN(-EINVAL);
+	}
+
+	comp_cnt = lcm->lcm_entry_count;
+	if (comp_cnt == 0 || comp_cnt > LOV_MAX_COMP_COUNT ||
+	    lcm->lcm_size < offsetof(struct lov_comp_md_v1,
+				     lcm_entries[comp_cnt])) {
+		CERROR("%s: invalid component count: %u\n",
+		       lod2obd(d)->obd_name, comp_cnt);
+		RETURN(-EINVAL);
+	}
+
+	lod_free_comp_entries(env, lo);
+	rc = lod_alloc_comp_entries(lo, comp_cnt);
+	if (rc)
+		RETURN(rc);
+
+	for (i = 0; i < comp_cnt; i++) {
+		lcme = &lcm->lcm_entries[i];
+		comp = &lo->ldo_comp_entries[i];
+
+		if (prev_end == LUSTRE_EOF && lcme->lcme_extent.e_start == 0) {
+			if (++mirror_cnt > LOV_MAX_MIRROR_COUNT) {
+				CERROR("%s: too many mirrors\n",
+				       lod2obd(d)->obd_name);
+				GOTO(out, rc = -EINVAL);
+			}
+			prev_end = 0;
+		}
+
+		if (lcme->lcme_extent.e_start != prev_end ||
+		    lcme->lcme_extent.e_end <= lcme->lcme_extent.e_start ||
+		    (lcme->lcme_extent.e_end != LUSTRE_EOF &&
+		     lcme->lcme_extent.e_end & (LOV_MIN_STRIPE_SIZE - 1))) {
+			CERROR("%s: invalid extent of component %d: "DEXT"\n",
+			       lod2obd(d)->obd_name, i,
+			       PEXT(&lcme->lcme_extent));
+			GOTO(out, rc = -EINVAL);
+		}
+		prev_end = lcme->lcme_extent.e_end;
+
+		if (lcme->lcme_offset < offsetof(struct lov_comp_md_v1,
+						 lcm_entries[comp_cnt]) ||
+		    lcme->lcme_size < sizeof(*v1) ||
+		    lcme->lcme_offset > lcm->lcm_size ||
+		    lcme->lcme_size > lcm->lcm_size - lcme->lcme_offset)
+			GOTO(out, rc = -EINVAL);
+
+		v1 = (struct lov_user_md_v1 *)((char *)lcm +
+					       lcme->lcme_offset);
+		pool_name = NULL;
+		if (v1->lmm_magic == LOV_USER_MAGIC_V3) {
+			if (lcme->lcme_size < sizeof(*v3))
+				GOTO(out, rc = -EINVAL);
+			v3 = (struct lov_user_md_v3 *)v1;
+			if (v3->lmm_pool_name[0] != '\0')
+				pool_name = v3->lmm_pool_name;
+		} else if (v1->lmm_magic != LOV_USER_MAGIC_V1) {
+			CERROR("%s: unrecognized magic %X of component %d\n",
+			       lod2obd(d)->obd_name, v1->lmm_magic, i);
+			GOTO(out, rc = -EINVAL);
+		}
+
+		if (v1->lmm_pattern == 0)
+			v1->lmm_pattern = LOV_PATTERN_RAID0;
+		if (lov_pattern(v1->lmm_pattern) != LOV_PATTERN_RAID0) {
+			CERROR("%s: invalid pattern of component %d: %x\n",
+			       lod2obd(d)->obd_name, i, v1->lmm_pattern);
+			GOTO(out, rc = -EINVAL);
+		}
+
+		stripe_size = v1->lmm_stripe_size;
+		if (stripe_size == 0)
+			stripe_size = lo->ldo_stripe_size ?:
+				      d->lod_desc.ld_default_stripe_size;
+		if (stripe_size & (LOV_MIN_STRIPE_SIZE - 1))
+			stripe_size = LOV_MIN_STRIPE_SIZE;
+		/* a stripe never spans two components */
+		if (lcme->lcme_extent.e_end != LUSTRE_EOF &&
+		    lcme->lcme_extent.e_end % stripe_size != 0) {
+			CERROR("%s: component %d end "LPU64" is not a multiple "
+			       "of stripe size %u\n", lod2obd(d)->obd_name, i,
+			       (__u64)lcme->lcme_extent.e_end, stripe_size);
+			GOTO(out, rc = -EINVAL);
+		}
+
+		comp->llc_id = i + 1;
+		if (lcm->lcm_mirror_count > 1) {
+			comp->llc_id |= mirror_cnt << MIRROR_ID_SHIFT;
+			comp->llc_flags = lcme->lcme_flags & LCME_USER_FLAGS;
+		}
+		comp->llc_extent = lcme->lcme_extent;
+		comp->llc_pattern = v1->lmm_pattern;
+		comp->llc_stripe_size = stripe_size;
+		comp->llc_stripenr = v1->lmm_stripe_count;
+		comp->llc_stripe_offset = v1->lmm_stripe_offset;
+
+		if (pool_name == NULL)
+			continue;
+
+		/* In the function below, .hs_keycmp resolves to
+		 * pool_hashkey_keycmp() */
+		/* coverity[overrun-buffer-val] */
+		pool = lod_find_pool(d, pool_name);
+		if (pool != NULL) {
+			if (comp->llc_stripe_offset != LOV_OFFSET_DEFAULT) {
+				rc = lod_check_index_in_pool(
+					       comp->llc_stripe_offset, pool);
+				if (rc < 0) {
+					lod_pool_putref(pool);
+					CERROR("%s: invalid offset, %u\n",
+					       lod2obd(d)->obd_name,
+					       comp->llc_stripe_offset);
+					GOTO(out, rc = -EINVAL);
+				}
+			}
+
+			if (comp->llc_stripenr > pool_tgt_count(pool))
+				comp->llc_stripenr = pool_tgt_count(pool);
+
+			lod_pool_putref(pool);
+		}
+
+		rc = lod_set_pool(&comp->llc_pool, pool_name);
+		if (rc)
+			GOTO(out, rc);
+	}
+
+	if (prev_end != LUSTRE_EOF) {
+		CERROR("%s: composite layout does not reach EOF\n",
+		       lod2obd(d)->obd_name);
+		GOTO(out, rc = -EINVAL);
+	}
+
+	/* the mirror count is given explicitly so that a layout that is
+	 * cut short by mistake is not taken for a mirrored one */
+	if ((lcm->lcm_mirror_count > 1 || mirror_cnt > 1) &&
+	    lcm->lcm_mirror_count != mirror_cnt) {
+		CERROR("%s: mirror count %u does not match layout (%u)\n",
+		       lod2obd(d)->obd_name, lcm->lcm_mirror_count, mirror_cnt);
+		GOTO(out, rc = -EINVAL);
+	}
+	if (mirror_cnt > 1) {
+		lo->ldo_mirror_count = mirror_cnt;
+		lo->ldo_flr_state = LCM_FL_RDONLY;
+	}
+
+	lo->ldo_pattern = LOV_PATTERN_RAID0;
+	lo->ldo_stripe_size = lo->ldo_comp_entries[0].llc_stripe_size;
+	lo->ldo_layout_gen = 0;
+	lod_object_set_pool(lo, NULL);
+	rc = 0;
+out:
+	if (rc)
+		lod_free_comp_entries(env, lo);
+	RETURN(rc);
+}
+
 /**
  * Parse suggested striping configuration.
  *
@@ -1713,7 +1919,8 @@ static int lod_qos_parse_config(const struct lu_env *env,
 	v1 = buf->lb_buf;
 	magic = v1->lmm_magic;
 
-	if (unlikely(magic == LOV_MAGIC_V1_DEF || magic == LOV_MAGIC_V3_DEF)) {
+	if (unlikely(magic == LOV_MAGIC_V1_DEF || magic == LOV_MAGIC_V3_DEF ||
+		     magic == LOV_MAGIC_COMP_V1_DEF)) {
 		/* try to use as fully defined striping */
 		rc = lod_use_defined_striping(env, lo, buf);
 		RETURN(rc);
@@ -1752,6 +1959,13 @@ static int lod_qos_parse_config(const struct lu_env *env,
 					LOV_USER_MAGIC_SPECIFIC);
 		break;
 
+	case __swab32(LOV_USER_MAGIC_COMP_V1):
+		lustre_swab_lov_comp_md_v1(buf->lb_buf, buf->lb_len);
+		/* fall through */
+	case LOV_USER_MAGIC_COMP_V1:
+		rc = lod_qos_parse_comp_config(env, lo, buf);
+		RETURN(rc);
+
 	default:
 		CERROR("%s: unrecognized magic %X\n",
 		       lod2obd(d)->obd_name, magic);
@@ -1769,7 +1983,8 @@ static int lod_qos_parse_config(const struct lu_env *env,
 	v1->lmm_magic = magic;
 	if (v1->lmm_pattern == 0)
 		v1->lmm_pattern = LOV_PATTERN_RAID0;
-	if (lov_pattern(v1->lmm_pattern) != LOV_PATTERN_RAID0) {
+	if (lov_pattern(v1->lmm_pattern) != LOV_PATTERN_RAID0 &&
+	    lov_pattern(v1->lmm_pattern) != LOV_PATTERN_MDT) {
 		CERROR("%s: invalid pattern: %x\n",
 		       lod2obd(d)->obd_name, v1->lmm_pattern);
 		RETURN(-EINVAL);
@@ -1858,12 +2073,6 @@ int lod_qos_prep_create(const struct lu_env *env, struct lod_object *lo,
 
 	LASSERT(lo);
 
-	/* no OST available */
-	/* XXX: should we be waiting a bit to prevent failures during
-	 * cluster initialization? */
-	if (d->lod_ostnr == 0)
-		GOTO(out, rc = -EIO);
-
 	/*
 	 * by this time, the object's ldo_stripenr and ldo_stripe_size
 	 * contain default value for striping: taken from the parent
@@ -1876,6 +2085,44 @@ int lod_qos_prep_create(const struct lu_env *env, struct lod_object *lo,
 	if (rc)
 		GOTO(out, rc);
 
+	/* the data is kept on the MDT, no OST objects are needed; if DoM
+	 * was disabled after the default was set, use the regular striping */
+	if (lov_pattern(lo->ldo_pattern) == LOV_PATTERN_MDT) {
+		if (d->lod_dom_max_stripesize != 0) {
+			if (lo->ldo_stripe_size == 0 ||
+			    lo->ldo_stripe_size > d->lod_dom_max_stripesize)
+				lo->ldo_stripe_size = d->lod_dom_max_stripesize;
+			lo->ldo_stripenr = 0;
+			GOTO(out, rc = 0);
+		}
+		lo->ldo_pattern = LOV_PATTERN_RAID0;
+		if (lo->ldo_stripenr == 0)
+			lo->ldo_stripenr = d->lod_desc.ld_default_stripe_count;
+	}
+
+	/* no OST available */
+	/* XXX: should we be waiting a bit to prevent failures during
+	 * cluster initialization? */
+	if (d->lod_ostnr == 0)
+		GOTO(out, rc = -EIO);
+
+	/* only the components the existing data lives in, and at least the
+	 * first one, are instantiated at create time; the others are left
+	 * for the clients to request when they write to them. Of a mirrored
+	 * file only the first mirror is, the others are filled by resync */
+	if (lod_is_composite(lo) && lo->ldo_stripe == NULL) {
+		struct lu_extent ext = { .e_start = 0, .e_end = 1 };
+
+		if (attr->la_valid & LA_SIZE && attr->la_size > 0)
+			ext.e_end = attr->la_size;
+
+		rc = lod_qos_prep_comp_create(env, lo, attr, &ext,
+					      lod_is_mirrored(lo) ? 1 : -1, th);
+		if (rc == 0)
+			rc = lod_comp_merge_new_stripes(lo);
+		GOTO(out, rc);
+	}
+
 	/* A released file is being created */
 	if (lo->ldo_stripenr == 0)
 		GOTO(out, rc = 0);
@@ -1955,3 +2202,143 @@ out:
 	RETURN(rc);
 }
 
+/**
+ * Allocate the stripes of a component of a composite layout.
+ *
+ * The allocators work on the striping parameters of the object itself, so
+ * those are pointed to the component's for the time of the allocation. The
+ * stripes are kept in the component until lod_comp_merge_new_stripes() adds
+ * them to the object's stripes.
+ *
+ * \param[in] env	execution environment for this thread
+ * \param[in] lo	LOD object
+ * \param[in] comp	component to allocate the stripes for
+ * \param[in] th	transaction handle
+ *
+ * \retval 0		on success
+ * \retval negative	negated errno on error
+ */
+static int lod_qos_alloc_comp(const struct lu_env *env, struct lod_object *lo,
+			      struct lod_layout_component *comp,
+			      struct thandle *th)
+{
+	struct lod_device	*d = lu2lod_dev(lod2lu_obj(lo)->lo_dev);
+	struct dt_object      **stripe;
+	char		       *saved_pool = lo->ldo_pool;
+	__u16			saved_stripenr = lo->ldo_stripenr;
+	__u16			saved_offset = lo->ldo_def_stripe_offset;
+	size_t			ea_size;
+	int			stripe_len;
+	int			flag = LOV_USES_ASSIGNED_STRIPE;
+	int			i, rc;
+	ENTRY;
+
+	stripe_len = lod_get_stripecnt(d, comp->llc_pool != NULL ?
+				       LOV_MAGIC_V3 : LOV_MAGIC_V1,
+				       comp->llc_stripenr);
+
+	/* the stripes of all the components share one LOV EA */
+	if (d->lod_osd_max_easize > 0) {
+		ea_size = lod_comp_md_size(lo);
+		if (ea_size >= d->lod_osd_max_easize)
+			RETURN(-E2BIG);
+		stripe_len = min_t(int, stripe_len,
+				   (d->lod_osd_max_easize - ea_size) /
+				   sizeof(struct lov_ost_data_v1));
+		if (stripe_len == 0)
+			RETURN(-E2BIG);
+	}
+
+	OBD_ALLOC(stripe, sizeof(stripe[0]) * stripe_len);
+	if (stripe == NULL)
+		RETURN(-ENOMEM);
+
+	lo->ldo_stripenr = stripe_len;
+	lo->ldo_def_stripe_offset = comp->llc_stripe_offset;
+	lo->ldo_pool = comp->llc_pool;
+
+	lod_getref(&d->lod_ost_descs);
+	if (lo->ldo_def_stripe_offset == LOV_OFFSET_DEFAULT) {
+		rc = lod_alloc_qos(env, lo, stripe, flag, th);
+		if (rc == -EAGAIN)
+			rc = lod_alloc_rr(env, lo, stripe, flag, th);
+	} else {
+		rc = lod_alloc_specific(env, lo, stripe, flag, th);
+	}
+	lod_putref(d, &d->lod_ost_descs);
+
+	if (rc == 0)
+		comp->llc_stripenr = lo->ldo_stripenr;
+
+	lo->ldo_stripenr = saved_stripenr;
+	lo->ldo_def_stripe_offset = saved_offset;
+	lo->ldo_pool = saved_pool;
+
+	if (rc < 0) {
+		for (i = 0; i < stripe_len; i++)
+			if (stripe[i] != NULL)
+				lu_object_put(env, &stripe[i]->do_lu);
+
+		OBD_FREE(stripe, sizeof(stripe[0]) * stripe_len);
+		RETURN(rc);
+	}
+
+	comp->llc_new_stripe = stripe;
+	comp->llc_new_stripes_allocated = stripe_len;
+
+	CDEBUG(D_OTHER, "component %u "DEXT": %u stripes allocated\n",
+	       comp->llc_id, PEXT(&comp->llc_extent), comp->llc_stripenr);
+
+	RETURN(0);
+}
+
+/**
+ * Allocate the stripes of the components covering a file extent.
+ *
+ * Declare the creation of the stripes of all the components of a composite
+ * layout which intersect \a ext and are not instantiated yet. The caller
+ * must ensure no concurrent calls to the function are made against the same
+ * object.
+ *
+ * \param[in] env	execution environment for this thread
+ * \param[in] lo	LOD object with a composite layout
+ * \param[in] attr	attributes OST objects will be declared with
+ * \param[in] ext	file extent to instantiate the components for
+ * \param[in] mirror_id	only instantiate the components of this mirror,
+ *			-1 for the components of all mirrors
+ * \param[in] th	transaction handle
+ *
+ * \retval 0		on success
+ * \retval negative	negated errno on error
+ */
+int lod_qos_prep_comp_create(const struct lu_env *env, struct lod_object *lo,
+			     struct lu_attr *attr, const struct lu_extent *ext,
+			     int mirror_id, struct thandle *th)
+{
+	struct lod_device		*d = lu2lod_dev(lod2lu_obj(lo)->lo_dev);
+	struct lod_layout_component	*comp;
+	int				 i, rc = 0;
+	ENTRY;
+
+	LASSERT(lod_is_composite(lo));
+
+	if (d->lod_ostnr == 0)
+		RETURN(-EIO);
+
+	lod_qos_statfs_update(env, d);
+
+	for (i = 0; i < lo->ldo_comp_cnt; i++) {
+		comp = &lo->ldo_comp_entries[i];
+		if (lod_comp_inited(comp) || comp->llc_new_stripe != NULL ||
+		    !lu_extent_is_overlapped(&comp->llc_extent, ext))
+			continue;
+		if (mirror_id >= 0 && mirror_id_of(comp->llc_id) != mirror_id)
+			continue;
+
+		rc = lod_qos_alloc_comp(env, lo, comp, th);
+		if (rc < 0)
+			break;
+	}
+
+	RETURN(rc);
+}
@@ -708,6 +708,65 @@ lod_lmv_failout_seq_write(struct file *file, const char __user *buffer,
 }
 LPROC_SEQ_FOPS(lod_lmv_failout);
 
+/**
+ * Show the maximum size of a file with data on MDT.
+ *
+ * \param[in] m		seq file
+ * \param[in] v		unused for single entry
+ *
+ * \retval 0		on success
+ * \retval negative	error code if failed
+ */
+static int lod_dom_stripesize_seq_show(struct seq_file *m, void *v)
+{
+	struct obd_device *dev = m->private;
+	struct lod_device *lod;
+
+	LASSERT(dev != NULL);
+	lod = lu2lod_dev(dev->obd_lu_dev);
+	return seq_printf(m, "%u\n", lod->lod_dom_max_stripesize);
+}
+
+/**
+ * Set the maximum size of a file with data on MDT.
+ *
+ * Files with LOV_PATTERN_MDT layout cannot be created with a larger stripe
+ * size, 0 disables creation of such files. Existing files are not affected.
+ *
+ * \param[in] file	proc file
+ * \param[in] buffer	string containing the size in bytes, a multiple of
+ *			LOV_MIN_STRIPE_SIZE
+ * \param[in] count	@buffer length
+ * \param[in] off	unused for single entry
+ *
+ * \retval @count	on success
+ * \retval negative	error code if failed
+ */
+static ssize_t
+lod_dom_stripesize_seq_write(struct file *file, const char __user *buffer,
+			     size_t count, loff_t *off)
+{
+	struct seq_file   *m = file->private_data;
+	struct obd_device *dev = m->private;
+	struct lod_device *lod;
+	__u64 val;
+	int rc;
+
+	LASSERT(dev != NULL);
+	lod = lu2lod_dev(dev->obd_lu_dev);
+
+	rc = lprocfs_write_u64_helper(buffer, count, &val);
+	if (rc)
+		return rc;
+
+	if (val & (LOV_MIN_STRIPE_SIZE - 1) || val > ~0U)
+		return -EINVAL;
+
+	lod->lod_dom_max_stripesize = val;
+	return count;
+}
+LPROC_SEQ_FOPS(lod_dom_stripesize);
+
 static struct lprocfs_vars lprocfs_lod_obd_vars[] = {
 	{ .name	=	"uuid",
 	  .fops	=	&lod_uuid_fops		},
@@ -733,6 +792,8 @@ static struct lprocfs_vars lprocfs_lod_obd_vars[] = {
 	  .fops	=	&lod_qos_maxage_fops	},
 	{ .name	=	"lmv_failout",
 	  .fops	=	&lod_lmv_failout_fops	},
+	{ .name	=	"dom_stripesize",
+	  .fops	=	&lod_dom_stripesize_fops },
 	{ NULL }
 };
 
@@ -150,7 +150,7 @@ struct lov_device {
 enum lov_layout_type {
 	LLT_EMPTY,	/** empty file without body (mknod + truncate) */
 	LLT_RAID0,	/** striped file */
-	LLT_RELEASED,	/** file with no objects (data in HSM) */
+	LLT_RELEASED,	/** file with no objects (data in HSM or on MDT) */
 	LLT_NR
 };
 
@@ -213,6 +213,11 @@ struct lov_object {
 	 * Waitq - wait for no one else is using lo_lsm
 	 */
 	wait_queue_head_t	lo_waitq;
+	/**
+	 * Spreads the reads of a mirrored file over its equally loaded
+	 * mirrors, see lov_io_read_mirror().
+	 */
+	atomic_t		lo_mirror_rr;
 	/**
 	 * Layout metadata. NULL if empty layout.
 	 */
@@ -297,6 +302,10 @@ struct lov_page {
 	unsigned int		lps_stripe; /* stripe index */
 };
 
+/* lps_stripe of a page in a component of a composite layout which is not
+ * instantiated yet */
+#define LOV_PAGE_HOLE	(~0U)
+
 /*
  * Bottom half.
  */
@@ -452,6 +461,11 @@ struct lov_io {
 
 	int			lis_mem_frozen;
 	int			lis_stripe_count;
+	/**
+	 * index of the mirror of a mirrored file the IO goes to, -1 if it
+	 * goes to all of them
+	 */
+	int			lis_mirror;
 	int			lis_active_subios;
 
 	/**
@@ -63,7 +63,8 @@ static int lsm_lmm_verify_common(struct lov_mds_md *lmm, int lmm_bytes,
 		return -EINVAL;
 	}
 
-	if (lov_pattern(le32_to_cpu(lmm->lmm_pattern)) != LOV_PATTERN_RAID0) {
+	if (lov_pattern(le32_to_cpu(lmm->lmm_pattern)) != LOV_PATTERN_RAID0 &&
+	    lov_pattern(le32_to_cpu(lmm->lmm_pattern)) != LOV_PATTERN_MDT) {
 		CERROR("bad striping pattern\n");
 		lov_dump_lmm_common(D_WARNING, lmm);
 		return -EINVAL;
@@ -151,30 +152,18 @@ static loff_t lov_tgt_maxbytes(struct lov_tgt_desc *tgt)
 	return maxbytes;
 }
 
-static int lsm_unpackmd_common(struct lov_obd *lov,
-			       struct lov_stripe_md *lsm,
-			       struct lov_mds_md *lmm,
-			       struct lov_ost_data_v1 *objects)
+static int lsm_unpackmd_objects(struct lov_obd *lov,
+				struct lov_stripe_md *lsm,
+				struct lov_mds_md *lmm,
+				struct lov_ost_data_v1 *objects,
+				unsigned int base, unsigned int stripe_count,
+				loff_t *stripe_maxbytes)
 {
 	struct lov_oinfo *loi;
-	loff_t stripe_maxbytes = LLONG_MAX;
-	unsigned int stripe_count;
 	unsigned int i;
 
-	/*
-	 * This supposes lov_mds_md_v1/v3 first fields are
-	 * are the same
-	 */
-	lmm_oi_le_to_cpu(&lsm->lsm_oi, &lmm->lmm_oi);
-	lsm->lsm_stripe_size = le32_to_cpu(lmm->lmm_stripe_size);
-	lsm->lsm_pattern = le32_to_cpu(lmm->lmm_pattern);
-	lsm->lsm_layout_gen = le16_to_cpu(lmm->lmm_layout_gen);
-	lsm->lsm_pool_name[0] = '\0';
-
-	stripe_count = lsm_is_released(lsm) ? 0 : lsm->lsm_stripe_count;
-
 	for (i = 0; i < stripe_count; i++) {
-		loi = lsm->lsm_oinfo[i];
+		loi = lsm->lsm_oinfo[base + i];
 		ostid_le_to_cpu(&objects[i].l_ost_oi, &loi->loi_oi);
 		loi->loi_ost_idx = le32_to_cpu(objects[i].l_ost_idx);
 		loi->loi_ost_gen = le32_to_cpu(objects[i].l_ost_gen);
@@ -197,15 +186,46 @@ static int lsm_unpackmd_common(struct lov_obd *lov,
 			continue;
 		}
 
-		stripe_maxbytes = min_t(loff_t, stripe_maxbytes,
-					lov_tgt_maxbytes(
-					lov->lov_tgts[loi->loi_ost_idx]));
+		*stripe_maxbytes = min_t(loff_t, *stripe_maxbytes,
+					 lov_tgt_maxbytes(
+					 lov->lov_tgts[loi->loi_ost_idx]));
 	}
 
+	return 0;
+}
+
+static int lsm_unpackmd_common(struct lov_obd *lov,
+			       struct lov_stripe_md *lsm,
+			       struct lov_mds_md *lmm,
+			       struct lov_ost_data_v1 *objects)
+{
+	loff_t stripe_maxbytes = LLONG_MAX;
+	unsigned int stripe_count;
+	int rc;
+
+	/*
+	 * This supposes lov_mds_md_v1/v3 first fields are
+	 * are the same
+	 */
+	lmm_oi_le_to_cpu(&lsm->lsm_oi, &lmm->lmm_oi);
+	lsm->lsm_stripe_size = le32_to_cpu(lmm->lmm_stripe_size);
+	lsm->lsm_pattern = le32_to_cpu(lmm->lmm_pattern);
+	lsm->lsm_layout_gen = le16_to_cpu(lmm->lmm_layout_gen);
+	lsm->lsm_pool_name[0] = '\0';
+
+	stripe_count = lsm_is_released(lsm) ? 0 : lsm->lsm_stripe_count;
+
+	rc = lsm_unpackmd_objects(lov, lsm, lmm, objects, 0, stripe_count,
+				  &stripe_maxbytes);
+	if (rc != 0)
+		return rc;
+
 	if (stripe_maxbytes == LLONG_MAX)
 		stripe_maxbytes = LUSTRE_EXT3_STRIPE_MAXBYTES;
 
-	if (lsm->lsm_stripe_count == 0)
+	if (lsm_is_dom(lsm))
+		lsm->lsm_maxbytes = lsm->lsm_stripe_size;
+	else if (lsm->lsm_stripe_count == 0)
 		lsm->lsm_maxbytes = stripe_maxbytes * lov->desc.ld_tgt_count;
 	else
 		lsm->lsm_maxbytes = stripe_maxbytes * lsm->lsm_stripe_count;
@@ -321,6 +341,228 @@ const struct lsm_operations lsm_v3_ops = {
         .lsm_unpackmd           = lsm_unpackmd_v3,
 };
 
+static void lsm_free_comp(struct lov_stripe_md *lsm)
+{
+	if (lsm->lsm_entries != NULL)
+		OBD_FREE(lsm->lsm_entries,
+			 sizeof(lsm->lsm_entries[0]) * lsm->lsm_entry_count);
+	if (lsm->lsm_comp_md != NULL)
+		OBD_FREE_LARGE(lsm->lsm_comp_md, lsm->lsm_comp_md_size);
+	lsm_free_plain(lsm);
+}
+
+static void
+lsm_stripe_by_index_comp(struct lov_stripe_md *lsm, int *stripeno,
+			 loff_t *lov_off, loff_t *swidth)
+{
+	struct lsm_entry *lsme = lov_stripe_entry(lsm, *stripeno);
+
+	*stripeno -= lsme->lsme_stripe_base;
+	if (swidth != NULL)
+		*swidth = (loff_t)lsme->lsme_stripe_size *
+			  lsme->lsme_stripe_count;
+}
+
+static void
+lsm_stripe_by_offset_comp(struct lov_stripe_md *lsm, int *stripeno,
+			  loff_t *lov_off, loff_t *swidth)
+{
+	struct lsm_entry *lsme = lov_offset_entry(lsm, -1, *lov_off);
+
+	if (swidth != NULL)
+		*swidth = (loff_t)lsme->lsme_stripe_size *
+			  lsme->lsme_stripe_count;
+}
+
+/**
+ * Verify a composite layout and return the number of the stripes of its
+ * instantiated components in \a stripe_count. The components of a mirror
+ * cover the file from 0 to EOF, the next mirror starts over from 0.
+ */
+static int lsm_lmm_verify_comp_v1(struct lov_mds_md *lmmv1, int lmm_bytes,
+				  __u16 *stripe_count)
+{
+	struct lov_comp_md_v1		*lcm = (struct lov_comp_md_v1 *)lmmv1;
+	struct lov_comp_md_entry_v1	*lcme;
+	struct lov_mds_md		*lmm;
+	__u64				 prev_end = LUSTRE_EOF;
+	__u32				 size, offset, blob_size;
+	__u16				 entry_count, count;
+	__u16				 mirror_count = 0;
+	unsigned int			 total = 0;
+	int				 i, rc;
+
+	if (lmm_bytes < sizeof(*lcm)) {
+		CERROR("lov_comp_md_v1 too small: %d, need at least %d\n",
+		       lmm_bytes, (int)sizeof(*lcm));
+		return -EINVAL;
+	}
+
+	size = le32_to_cpu(lcm->lcm_size);
+	entry_count = le16_to_cpu(lcm->lcm_entry_count);
+	if (size > lmm_bytes || entry_count == 0 ||
+	    entry_count > LOV_MAX_COMP_COUNT ||
+	    size < sizeof(*lcm) + entry_count * sizeof(*lcme)) {
+		CERROR("bad composite layout: size %u/%d, %u components\n",
+		       size, lmm_bytes, entry_count);
+		return -EINVAL;
+	}
+
+	for (i = 0; i < entry_count; i++) {
+		lcme = &lcm->lcm_entries[i];
+		offset = le32_to_cpu(lcme->lcme_offset);
+		blob_size = le32_to_cpu(lcme->lcme_size);
+
+		if (prev_end == LUSTRE_EOF &&
+		    le64_to_cpu(lcme->lcme_extent.e_start) == 0) {
+			mirror_count++;
+			prev_end = 0;
+		}
+
+		if (le64_to_cpu(lcme->lcme_extent.e_start) != prev_end ||
+		    le64_to_cpu(lcme->lcme_extent.e_end) <= prev_end ||
+		    offset > size || blob_size > size - offset ||
+		    blob_size < sizeof(struct lov_mds_md_v1)) {
+			CERROR("bad component %d: extent ["LPX64", "LPX64"), "
+			       "offset %u, size %u\n", i,
+			       le64_to_cpu(lcme->lcme_extent.e_start),
+			       le64_to_cpu(lcme->lcme_extent.e_end),
+			       offset, blob_size);
+			return -EINVAL;
+		}
+		prev_end = le64_to_cpu(lcme->lcme_extent.e_end);
+
+		lmm = (struct lov_mds_md *)((char *)lcm + offset);
+		if (le32_to_cpu(lmm->lmm_magic) != LOV_MAGIC_V1 &&
+		    le32_to_cpu(lmm->lmm_magic) != LOV_MAGIC_V3) {
+			CERROR("bad magic %#x of component %d\n",
+			       le32_to_cpu(lmm->lmm_magic), i);
+			return -EINVAL;
+		}
+
+		/* a component which is not instantiated has no objects */
+		if (!(le32_to_cpu(lcme->lcme_flags) & LCME_FL_INIT))
+			continue;
+
+		if (le32_to_cpu(lmm->lmm_magic) == LOV_MAGIC_V1)
+			rc = lsm_lmm_verify_v1(lmm, blob_size, &count);
+		else
+			rc = lsm_lmm_verify_v3(lmm, blob_size, &count);
+		if (rc != 0)
+			return rc;
+
+		if (lov_pattern(le32_to_cpu(lmm->lmm_pattern)) !=
+		    LOV_PATTERN_RAID0) {
+			CERROR("bad pattern %#x of component %d\n",
+			       le32_to_cpu(lmm->lmm_pattern), i);
+			return -EINVAL;
+		}
+		total += count;
+	}
+
+	if (prev_end != LUSTRE_EOF || total > LOV_MAX_STRIPE_COUNT ||
+	    (mirror_count > 1 &&
+	     mirror_count != le16_to_cpu(lcm->lcm_mirror_count))) {
+		CERROR("bad composite layout: end "LPX64", %u stripes, "
+		       "%u mirrors\n", prev_end, total, mirror_count);
+		return -EINVAL;
+	}
+
+	*stripe_count = total;
+	return 0;
+}
+
+static int lsm_unpackmd_comp_v1(struct lov_obd *lov, struct lov_stripe_md *lsm,
+				struct lov_mds_md *lmmv1)
+{
+	struct lov_comp_md_v1		*lcm = (struct lov_comp_md_v1 *)lmmv1;
+	struct lov_comp_md_entry_v1	*lcme;
+	struct lov_mds_md		*lmm;
+	struct lov_ost_data_v1		*objects;
+	struct lsm_entry		*lsme;
+	loff_t				 stripe_maxbytes = LLONG_MAX;
+	unsigned int			 base = 0;
+	unsigned int			 last_count = 0;
+	int				 mirror = 0;
+	int				 i, rc;
+
+	lsm->lsm_entry_count = le16_to_cpu(lcm->lcm_entry_count);
+	OBD_ALLOC(lsm->lsm_entries,
+		  sizeof(lsm->lsm_entries[0]) * lsm->lsm_entry_count);
+	if (lsm->lsm_entries == NULL)
+		return -ENOMEM;
+
+	lsm->lsm_comp_md_size = le32_to_cpu(lcm->lcm_size);
+	OBD_ALLOC_LARGE(lsm->lsm_comp_md, lsm->lsm_comp_md_size);
+	if (lsm->lsm_comp_md == NULL)
+		return -ENOMEM;
+	memcpy(lsm->lsm_comp_md, lcm, lsm->lsm_comp_md_size);
+
+	lsm->lsm_pattern = LOV_PATTERN_RAID0;
+	lsm->lsm_layout_gen = le32_to_cpu(lcm->lcm_layout_gen);
+	lsm->lsm_pool_name[0] = '\0';
+	lsm->lsm_mirror_count = le16_to_cpu(lcm->lcm_mirror_count);
+	lsm->lsm_flr_state = le16_to_cpu(lcm->lcm_flags) & LCM_FL_FLR_MASK;
+
+	for (i = 0; i < lsm->lsm_entry_count; i++) {
+		lcme = &lcm->lcm_entries[i];
+		lsme = &lsm->lsm_entries[i];
+		lmm = (struct lov_mds_md *)((char *)lcm +
+					    le32_to_cpu(lcme->lcme_offset));
+
+		lsme->lsme_extent.e_start =
+			le64_to_cpu(lcme->lcme_extent.e_start);
+		lsme->lsme_extent.e_end = le64_to_cpu(lcme->lcme_extent.e_end);
+		lsme->lsme_id = le32_to_cpu(lcme->lcme_id);
+		lsme->lsme_flags = le32_to_cpu(lcme->lcme_flags);
+		lsme->lsme_stripe_size = le32_to_cpu(lmm->lmm_stripe_size);
+		lsme->lsme_stripe_base = base;
+		if (i > 0 && lsme->lsme_extent.e_start == 0)
+			mirror++;
+		lsme->lsme_mirror = mirror;
+		if (i == 0) {
+			lmm_oi_le_to_cpu(&lsm->lsm_oi, &lmm->lmm_oi);
+			lsm->lsm_stripe_size = lsme->lsme_stripe_size;
+		}
+
+		last_count = le16_to_cpu(lmm->lmm_stripe_count);
+		if (!(lsme->lsme_flags & LCME_FL_INIT))
+			continue;
+
+		lsme->lsme_stripe_count = last_count;
+		if (le32_to_cpu(lmm->lmm_magic) == LOV_MAGIC_V3)
+			objects = ((struct lov_mds_md_v3 *)lmm)->lmm_objects;
+		else
+			objects = ((struct lov_mds_md_v1 *)lmm)->lmm_objects;
+
+		rc = lsm_unpackmd_objects(lov, lsm, lmm, objects, base,
+					  lsme->lsme_stripe_count,
+					  &stripe_maxbytes);
+		if (rc != 0)
+			return rc;
+		base += lsme->lsme_stripe_count;
+	}
+	LASSERT(base == lsm->lsm_stripe_count);
+
+	if (stripe_maxbytes == LLONG_MAX)
+		stripe_maxbytes = LUSTRE_EXT3_STRIPE_MAXBYTES;
+
+	/* the last component extends to EOF and sets the limit */
+	if (last_count == 0 || last_count > lov->desc.ld_tgt_count)
+		last_count = lov->desc.ld_tgt_count;
+	lsm->lsm_maxbytes = stripe_maxbytes * last_count;
+
+	return 0;
+}
+
+const struct lsm_operations lsm_comp_v1_ops = {
+	.lsm_free		= lsm_free_comp,
+	.lsm_stripe_by_index	= lsm_stripe_by_index_comp,
+	.lsm_stripe_by_offset	= lsm_stripe_by_offset_comp,
+	.lsm_lmm_verify		= lsm_lmm_verify_comp_v1,
+	.lsm_unpackmd		= lsm_unpackmd_comp_v1,
+};
+
 void dump_lsm(unsigned int level, const struct lov_stripe_md *lsm)
 {
 	CDEBUG(level, "lsm %p, objid "DOSTID", maxbytes "LPX64", magic 0x%08X,"
@@ -45,6 +45,20 @@
  * the old maximum object size from ext3. */
 #define LUSTRE_EXT3_STRIPE_MAXBYTES 0x1fffffff000ULL
 
+/* one component of a composite layout */
+struct lsm_entry {
+	struct lu_extent	lsme_extent;
+	u32			lsme_id;
+	u32			lsme_flags;
+	u32			lsme_stripe_size;
+	/* number of stripes, 0 until the component is instantiated */
+	u16			lsme_stripe_count;
+	/* index of the first stripe of the component in lsm_oinfo[] */
+	u16			lsme_stripe_base;
+	/* index of the mirror the component belongs to, from 0 */
+	u16			lsme_mirror;
+};
+
 struct lov_stripe_md {
 	atomic_t	lsm_refc;
 	spinlock_t	lsm_lock;
@@ -60,20 +74,45 @@ struct lov_stripe_md {
 	u16		lsm_stripe_count;
 	u16		lsm_layout_gen;
 	char		lsm_pool_name[LOV_MAXPOOLNAME + 1];
+	/* composite layout: the stripes of all the instantiated components
+	 * are in lsm_oinfo[], the layout as fetched is kept for packing */
+	u16		lsm_entry_count;
+	/* mirrored file: number of mirrors and LCM_FL_* state */
+	u16		lsm_mirror_count;
+	u16		lsm_flr_state;
+	struct lsm_entry	*lsm_entries;
+	void		*lsm_comp_md;
+	size_t		lsm_comp_md_size;
 	struct lov_oinfo	*lsm_oinfo[0];
 };
 
+static inline bool lsm_is_composite(const struct lov_stripe_md *lsm)
+{
+	return lsm->lsm_magic == LOV_MAGIC_COMP_V1;
+}
+
+static inline bool lsm_is_mirrored(const struct lov_stripe_md *lsm)
+{
+	return lsm_is_composite(lsm) && lsm->lsm_mirror_count > 1;
+}
+
 static inline bool lsm_is_released(struct lov_stripe_md *lsm)
 {
 	return !!(lsm->lsm_pattern & LOV_PATTERN_F_RELEASED);
 }
 
+/* data on MDT, the file has a layout but no OST objects */
+static inline bool lsm_is_dom(struct lov_stripe_md *lsm)
+{
+	return lov_pattern(lsm->lsm_pattern) == LOV_PATTERN_MDT;
+}
+
 static inline bool lsm_has_objects(struct lov_stripe_md *lsm)
 {
 	if (lsm == NULL)
 		return false;
 
-	if (lsm_is_released(lsm))
+	if (lsm_is_released(lsm) || lsm_is_dom(lsm))
 		return false;
 
 	return true;
@@ -93,6 +132,7 @@ struct lsm_operations {
 
 extern const struct lsm_operations lsm_v1_ops;
 extern const struct lsm_operations lsm_v3_ops;
+extern const struct lsm_operations lsm_comp_v1_ops;
 static inline const struct lsm_operations *lsm_op_find(int magic)
 {
 	switch (magic) {
@@ -100,6 +140,8 @@ static inline const struct lsm_operations *lsm_op_find(int magic)
 		return &lsm_v1_ops;
 	case LOV_MAGIC_V3:
 		return &lsm_v3_ops;
+	case LOV_MAGIC_COMP_V1:
+		return &lsm_comp_v1_ops;
 	default:
 		CERROR("unrecognized lsm_magic %08x\n", magic);
 		return NULL;
@@ -205,7 +247,10 @@ loff_t lov_size_to_stripe(struct lov_stripe_md *lsm, u64 file_size,
 int lov_stripe_intersects(struct lov_stripe_md *lsm, int stripeno,
 			  loff_t start, loff_t end,
 			  loff_t *obd_start, loff_t *obd_end);
-int lov_stripe_number(struct lov_stripe_md *lsm, loff_t lov_off);
+int lov_stripe_number(struct lov_stripe_md *lsm, int mirror, loff_t lov_off);
+struct lsm_entry *lov_stripe_entry(struct lov_stripe_md *lsm, int stripeno);
+struct lsm_entry *lov_offset_entry(struct lov_stripe_md *lsm, int mirror,
+				   loff_t lov_off);
 pgoff_t lov_stripe_pgoff(struct lov_stripe_md *lsm, pgoff_t stripe_index,
 			 int stripe);
 
@@ -315,13 +315,322 @@ static int lov_io_subio_init(const struct lu_env *env, struct lov_io *lio,
 	RETURN(result);
 }
 
+/**
+ * Check that the components of a composite layout covering [start, end) are
+ * instantiated. If they are not, the IO is stopped and vvp layer asks the
+ * MDT to instantiate them before restarting it.
+ */
+static int lov_io_comp_check(struct lov_object *obj, struct cl_io *io,
+			     loff_t start, loff_t end)
+{
+	struct lov_stripe_md	*lsm = obj->lo_lsm;
+	struct lsm_entry	*lsme;
+	struct lu_extent	 ext = {
+		.e_start = start,
+		.e_end = end,
+	};
+	int i;
+
+	if (!lsm_is_composite(lsm))
+		return 0;
+
+	for (i = 0; i < lsm->lsm_entry_count; i++) {
+		lsme = &lsm->lsm_entries[i];
+		if (lsme->lsme_stripe_count > 0 ||
+		    !lu_extent_is_overlapped(&lsme->lsme_extent, &ext))
+			continue;
+
+		CDEBUG(D_VFSTRACE, DFID" component %u "DEXT" is not "
+		       "instantiated for "DEXT"\n",
+		       PFID(lu_object_fid(lov2lu(obj))), lsme->lsme_id,
+		       PEXT(&lsme->lsme_extent), PEXT(&ext));
+		io->ci_need_write_intent = 1;
+		io->ci_write_intent_opc = LAYOUT_INTENT_WRITE;
+		io->ci_write_intent = ext;
+		return -ENODATA;
+	}
+
+	return 0;
+}
+
+/**
+ * Find the mirror of a mirrored file the writes go to, the one which has
+ * no stale component. The MDT picks it the same way.
+ */
+static int lov_io_primary_mirror(const struct lov_stripe_md *lsm)
+{
+	__u32	stale = 0;
+	int	i;
+
+	for (i = 0; i < lsm->lsm_entry_count; i++)
+		if (lsm->lsm_entries[i].lsme_flags & LCME_FL_STALE)
+			stale |= 1 << lsm->lsm_entries[i].lsme_mirror;
+
+	for (i = 0; i < lsm->lsm_mirror_count; i++)
+		if (!(stale & (1 << i)))
+			return i;
+
+	/* the MDT never leaves a file without a mirror in sync */
+	return 0;
+}
+
+/**
+ * Pick the mirror of a mirrored file in sync to read [start, end) from.
+ *
+ * The mirrors with a component preferred for reading come first, mirrors
+ * with a stripe on an inactive OST are skipped. Among the rest the one with
+ * the fewest reads in flight to its OSTs is used, equally loaded mirrors
+ * are used in turn.
+ */
+static int lov_io_read_mirror(struct lov_object *obj, loff_t start,
+			      loff_t end)
+{
+	struct lov_obd		*lov = lu2lov_dev(obj->lo_cl.co_lu.lo_dev)->ld_lov;
+	struct lov_stripe_md	*lsm = obj->lo_lsm;
+	struct lov_tgt_desc	*tgt;
+	struct lsm_entry	*lsme;
+	struct lu_extent	 ext = {
+		.e_start = start,
+		.e_end = end,
+	};
+	unsigned int		 load[LOV_MAX_MIRROR_COUNT] = { 0 };
+	bool			 pref[LOV_MAX_MIRROR_COUNT] = { false };
+	bool			 skip[LOV_MAX_MIRROR_COUNT] = { false };
+	unsigned int		 best_load = UINT_MAX;
+	bool			 best_pref = false;
+	int			 nr = 0;
+	int			 i, j, m;
+
+	for (i = 0; i < lsm->lsm_entry_count; i++) {
+		lsme = &lsm->lsm_entries[i];
+		if (!lu_extent_is_overlapped(&lsme->lsme_extent, &ext))
+			continue;
+
+		m = lsme->lsme_mirror;
+		if (lsme->lsme_flags & LCME_FL_PREF_RD)
+			pref[m] = true;
+
+		for (j = lsme->lsme_stripe_base;
+		     j < lsme->lsme_stripe_base + lsme->lsme_stripe_count;
+		     j++) {
+			tgt = lov->lov_tgts[lsm->lsm_oinfo[j]->loi_ost_idx];
+			if (tgt == NULL || !tgt->ltd_active ||
+			    tgt->ltd_exp == NULL) {
+				skip[m] = true;
+				break;
+			}
+			load[m] += tgt->ltd_exp->exp_obd->u.cli.cl_r_in_flight;
+		}
+	}
+
+	for (m = 0; m < lsm->lsm_mirror_count; m++) {
+		if (skip[m])
+			continue;
+		if (pref[m] > best_pref ||
+		    (pref[m] == best_pref && load[m] < best_load)) {
+			best_pref = pref[m];
+			best_load = load[m];
+			nr = 0;
+		}
+		if (pref[m] == best_pref && load[m] == best_load)
+			nr++;
+	}
+
+	/* all mirrors have an OST down, let the read fail over there */
+	if (nr == 0)
+		return lov_io_primary_mirror(lsm);
+
+	nr = atomic_inc_return(&obj->lo_mirror_rr) % nr;
+	for (m = 0; m < lsm->lsm_mirror_count; m++) {
+		if (skip[m] || pref[m] != best_pref || load[m] != best_load)
+			continue;
+		if (nr-- == 0)
+			break;
+	}
+
+	CDEBUG(D_VFSTRACE, DFID" read "DEXT" from mirror %d, load %u\n",
+	       PFID(lu_object_fid(lov2lu(obj))), PEXT(&ext), m, best_load);
+	return m;
+}
+
+/**
+ * Check that a mirrored file is ready to be written: it is open for write
+ * on the MDT, the components of the primary mirror covering \a write are
+ * instantiated and the other mirrors are marked stale in \a stale. If not,
+ * vvp layer sends a layout intent \a opc to the MDT before restarting the
+ * IO.
+ */
+static int lov_io_mirror_write_check(struct lov_object *obj, struct cl_io *io,
+				     int primary, const struct lu_extent *write,
+				     const struct lu_extent *stale, __u32 opc)
+{
+	struct lov_stripe_md	*lsm = obj->lo_lsm;
+	struct lsm_entry	*lsme;
+	int			 i;
+
+	if (lsm->lsm_flr_state != LCM_FL_WRITE_PENDING)
+		goto intent;
+
+	for (i = 0; i < lsm->lsm_entry_count; i++) {
+		lsme = &lsm->lsm_entries[i];
+		if (lsme->lsme_mirror == primary) {
+			if (lsme->lsme_stripe_count == 0 &&
+			    lu_extent_is_overlapped(&lsme->lsme_extent, write))
+				goto intent;
+		} else if (!(lsme->lsme_flags & LCME_FL_STALE) &&
+			   lu_extent_is_overlapped(&lsme->lsme_extent, stale)) {
+			goto intent;
+		}
+	}
+
+	return 0;
+
+intent:
+	CDEBUG(D_VFSTRACE, DFID" state %u, mirror %d is not ready for "
+	       "layout intent %u "DEXT"\n", PFID(lu_object_fid(lov2lu(obj))),
+	       lsm->lsm_flr_state, primary, opc, PEXT(stale));
+	io->ci_need_write_intent = 1;
+	io->ci_write_intent_opc = opc;
+	io->ci_write_intent = *stale;
+	return -ENODATA;
+}
+
+/**
+ * Check that an IO with a designated mirror may change \a ext of the mirror.
+ *
+ * Only the resync tool writes to or truncates a designated mirror, to copy
+ * the data to the stale components while the file is LCM_FL_SYNC_PENDING.
+ * Any other change would make the mirror differ from the others while it
+ * is considered in sync.
+ */
+static int lov_io_designated_check(struct lov_object *obj, int mirror,
+				   const struct lu_extent *ext)
+{
+	struct lov_stripe_md	*lsm = obj->lo_lsm;
+	struct lsm_entry	*lsme;
+	int			 i;
+
+	if (lsm->lsm_flr_state != LCM_FL_SYNC_PENDING) {
+		CDEBUG(D_VFSTRACE, DFID" state %u, mirror %d is not being "
+		       "resynced\n", PFID(lu_object_fid(lov2lu(obj))),
+		       lsm->lsm_flr_state, mirror);
+		return -EBUSY;
+	}
+
+	for (i = 0; i < lsm->lsm_entry_count; i++) {
+		lsme = &lsm->lsm_entries[i];
+		if (lsme->lsme_mirror != mirror ||
+		    !lu_extent_is_overlapped(&lsme->lsme_extent, ext))
+			continue;
+
+		if (!(lsme->lsme_flags & LCME_FL_STALE)) {
+			CDEBUG(D_VFSTRACE, DFID" component %d of mirror %d "
+			       "is not stale\n",
+			       PFID(lu_object_fid(lov2lu(obj))), i, mirror);
+			return -EPERM;
+		}
+		if (lsme->lsme_stripe_count == 0)
+			return -ENODATA;
+	}
+
+	return 0;
+}
+
+/**
+ * Choose the mirror of a mirrored file the IO goes to.
+ *
+ * Reads of a file in sync are spread over the mirrors, otherwise the IO
+ * goes to the primary mirror, the only one up to date. Truncate applies to
+ * all the mirrors so that none of them keeps data beyond EOF. An IO with a
+ * designated mirror, issued by the resync tool, only goes to that mirror
+ * and never changes the layout.
+ */
+static int lov_io_mirror_init(struct lov_io *lio, struct lov_object *obj,
+			      struct cl_io *io)
+{
+	struct lov_stripe_md	*lsm = obj->lo_lsm;
+	struct lu_extent	 write, stale;
+
+	if (io->ci_designated_mirror > 0) {
+		if (io->ci_designated_mirror > lsm->lsm_mirror_count)
+			return -EINVAL;
+
+		lio->lis_mirror = io->ci_designated_mirror - 1;
+		switch (io->ci_type) {
+		case CIT_FAULT:
+			if (!io->u.ci_fault.ft_writable &&
+			    !io->u.ci_fault.ft_mkwrite)
+				return 0;
+			/* mmap bypasses O_DIRECT, see LL_IOC_FLR_SET_MIRROR */
+			return -EPERM;
+		case CIT_WRITE:
+			write.e_start = lio->lis_pos;
+			write.e_end = lio->lis_endpos;
+			return lov_io_designated_check(obj, lio->lis_mirror,
+						       &write);
+		case CIT_SETATTR:
+			if (!cl_io_is_trunc(io))
+				return 0;
+			/* resync only drops what it copied beyond EOF, from
+			 * the stale component the new EOF is in */
+			stale.e_start = io->u.ci_setattr.sa_attr.lvb_size;
+			stale.e_end = stale.e_start + 1;
+			return lov_io_designated_check(obj, lio->lis_mirror,
+						       &stale);
+		default:
+			return 0;
+		}
+	}
+
+	switch (io->ci_type) {
+	case CIT_FAULT:
+		if (io->u.ci_fault.ft_writable || io->u.ci_fault.ft_mkwrite)
+			goto write;
+		/* fall through */
+	case CIT_READ:
+		if (lsm->lsm_flr_state == LCM_FL_RDONLY)
+			lio->lis_mirror = lov_io_read_mirror(obj, lio->lis_pos,
+							     lio->lis_endpos);
+		else
+			lio->lis_mirror = lov_io_primary_mirror(lsm);
+		return 0;
+	case CIT_WRITE:
+write:
+		lio->lis_mirror = lov_io_primary_mirror(lsm);
+		write.e_start = lio->lis_pos;
+		write.e_end = lio->lis_endpos;
+		return lov_io_mirror_write_check(obj, io, lio->lis_mirror,
+						 &write, &write,
+						 LAYOUT_INTENT_WRITE);
+	case CIT_SETATTR:
+		if (!cl_io_is_trunc(io))
+			return 0;
+		/* the component of the new last byte keeps the size */
+		stale.e_start = io->u.ci_setattr.sa_attr.lvb_size;
+		stale.e_end = LUSTRE_EOF;
+		write.e_start = stale.e_start > 0 ? stale.e_start - 1 : 0;
+		write.e_end = stale.e_start;
+		return lov_io_mirror_write_check(obj, io,
+						 lov_io_primary_mirror(lsm),
+						 &write, &stale,
+						 LAYOUT_INTENT_TRUNC);
+	case CIT_MISC:
+		lio->lis_mirror = lov_io_primary_mirror(lsm);
+		return 0;
+	default:
+		return 0;
+	}
+}
+
 static int lov_io_slice_init(struct lov_io *lio,
 			     struct lov_object *obj, struct cl_io *io)
 {
+	bool	check = false;
 	ENTRY;
 
 	io->ci_result = 0;
 	lio->lis_object = obj;
+	lio->lis_mirror = -1;
 
 	LASSERT(obj->lo_lsm != NULL);
 	lio->lis_stripe_count = obj->lo_lsm->lsm_stripe_count;
@@ -344,6 +653,7 @@ static int lov_io_slice_init(struct lov_io *lio,
                         lio->lis_pos = 0;
                         lio->lis_endpos = OBD_OBJECT_EOF;
                 }
+		check = io->ci_type == CIT_WRITE;
                 break;
 
         case CIT_SETATTR:
@@ -352,6 +662,12 @@ static int lov_io_slice_init(struct lov_io *lio,
                 else
                         lio->lis_pos = 0;
                 lio->lis_endpos = OBD_OBJECT_EOF;
+		/* the objects of the component holding the last byte keep
+		 * the size, even if it ends at the new size */
+		if (lsm_is_composite(obj->lo_lsm) && lio->lis_pos > 0) {
+			lio->lis_pos--;
+			check = true;
+		}
                 break;
 
 	case CIT_DATA_VERSION:
@@ -363,6 +679,9 @@ static int lov_io_slice_init(struct lov_io *lio,
                 pgoff_t index = io->u.ci_fault.ft_index;
                 lio->lis_pos = cl_offset(io->ci_obj, index);
                 lio->lis_endpos = cl_offset(io->ci_obj, index + 1);
+		/* whether the page is going to be written is not known yet,
+		 * mapping a page instantiates its component */
+		check = true;
                 break;
         }
 
@@ -381,6 +700,16 @@ static int lov_io_slice_init(struct lov_io *lio,
                 LBUG();
         }
 
+	if (lsm_is_mirrored(obj->lo_lsm))
+		RETURN(lov_io_mirror_init(lio, obj, io));
+
+	if (check && io->ci_type == CIT_SETATTR)
+		RETURN(lov_io_comp_check(obj, io, lio->lis_pos,
+					 lio->lis_pos + 1));
+	if (check)
+		RETURN(lov_io_comp_check(obj, io, lio->lis_pos,
+					 lio->lis_endpos));
+
 	RETURN(0);
 }
 
@@ -427,6 +756,11 @@ static int lov_io_iter_init(const struct lu_env *env,
         ENTRY;
         endpos = lov_offset_mod(lio->lis_endpos, -1);
         for (stripe = 0; stripe < lio->lis_stripe_count; stripe++) {
+		if (lio->lis_mirror >= 0 &&
+		    lov_stripe_entry(lsm, stripe)->lsme_mirror !=
+		    lio->lis_mirror)
+			continue;
+
                 if (!lov_stripe_intersects(lsm, stripe, lio->lis_pos,
                                            endpos, &start, &end))
                         continue;
@@ -476,6 +810,12 @@ static int lov_io_rw_iter_init(const struct lu_env *env,
         LASSERT(io->ci_type == CIT_READ || io->ci_type == CIT_WRITE);
         ENTRY;
 
+	/* the chunks of a composite file follow the striping of the
+	 * component they are in, the components end on stripe boundaries */
+	if (lsm_is_composite(lsm))
+		ssize = lov_offset_entry(lsm, lio->lis_mirror,
+					 start)->lsme_stripe_size;
+
         /* fast path for common case. */
         if (lio->lis_nr_subios != 1 && !cl_io_is_append(io)) {
 
@@ -630,7 +970,12 @@ static int lov_io_read_ahead(const struct lu_env *env,
 	int			 rc;
 	ENTRY;
 
-	stripe = lov_stripe_number(loo->lo_lsm, cl_offset(obj, start));
+	stripe = lov_stripe_number(loo->lo_lsm, lio->lis_mirror,
+				   cl_offset(obj, start));
+	/* no data in a component not instantiated yet */
+	if (stripe < 0)
+		RETURN(-ENODATA);
+
 	if (unlikely(r0->lo_sub[stripe] == NULL))
 		RETURN(-EIO);
 
@@ -661,12 +1006,16 @@ static int lov_io_read_ahead(const struct lu_env *env,
 	if (ra_end != CL_PAGE_EOF)
 		ra_end = lov_stripe_pgoff(loo->lo_lsm, ra_end, stripe);
 
-	pps = loo->lo_lsm->lsm_stripe_size >> PAGE_CACHE_SHIFT;
+	if (lsm_is_composite(loo->lo_lsm))
+		pps = lov_stripe_entry(loo->lo_lsm, stripe)->lsme_stripe_size >>
+		      PAGE_CACHE_SHIFT;
+	else
+		pps = loo->lo_lsm->lsm_stripe_size >> PAGE_CACHE_SHIFT;
 
 	CDEBUG(D_READA, DFID " max_index = %lu, pps = %u, "
 	       "stripe_size = %u, stripe no = %u, start index = %lu\n",
 	       PFID(lu_object_fid(lov2lu(loo))), ra_end, pps,
-	       loo->lo_lsm->lsm_stripe_size, stripe, start);
+	       pps << PAGE_CACHE_SHIFT, stripe, start);
 
 	/* never exceed the end of the stripe */
 	ra->cra_end = min_t(pgoff_t, ra_end, start + pps - start % pps - 1);
@@ -701,7 +1050,10 @@ static int lov_io_submit(const struct lu_env *env,
 	int rc = 0;
 	ENTRY;
 
-        if (lio->lis_active_subios == 1) {
+	/* the pages of the components of a composite layout not
+	 * instantiated yet are to be sorted out below */
+	if (lio->lis_active_subios == 1 &&
+	    !lsm_is_composite(lio->lis_object->lo_lsm)) {
                 int idx = lio->lis_single_subio_index;
 
                 LASSERT(idx < lio->lis_nr_subios);
@@ -723,9 +1075,16 @@ static int lov_io_submit(const struct lu_env *env,
 		cl_2queue_init(cl2q);
 
 		page = cl_page_list_first(qin);
+		stripe = lov_page_stripe(page);
+		/* a hole of a composite layout, the page is zeroed and up to
+		 * date already, it is left unsent */
+		if (stripe == LOV_PAGE_HOLE) {
+			cl_page_list_move(plist, qin, page);
+			cl_2queue_fini(env, cl2q);
+			continue;
+		}
 		cl_page_list_move(&cl2q->c2_qin, qin, page);
 
-		stripe = lov_page_stripe(page);
 		while (qin->pl_nr > 0) {
 			page = cl_page_list_first(qin);
 			if (stripe != lov_page_stripe(page))
@@ -1094,6 +1453,11 @@ int lov_io_init_released(const struct lu_env *env, struct cl_object *obj,
 		result = 1;
 		break;
 	case CIT_SETATTR:
+		/* data on MDT is truncated by the MDT in setattr */
+		if (lsm_is_dom(lov->lo_lsm)) {
+			result = 1;
+			break;
+		}
 		/* the truncate to 0 is managed by MDT:
 		 * - in open, for open O_TRUNC
 		 * - in setattr, for truncate
@@ -1108,6 +1472,11 @@ int lov_io_init_released(const struct lu_env *env, struct cl_object *obj,
 	case CIT_READ:
 	case CIT_WRITE:
 	case CIT_FAULT:
+		/* llite does data on MDT I/O without the page cache */
+		if (lsm_is_dom(lov->lo_lsm)) {
+			result = -EOPNOTSUPP;
+			break;
+		}
 		io->ci_restore_needed = 1;
 		result = -ENODATA;
 		break;
@@ -115,6 +115,13 @@ static int lov_sublock_init(const struct lu_env *env,
 	RETURN(result);
 }
 
+static inline bool lov_lock_mirror_match(struct lov_stripe_md *lsm,
+					 int stripe, int mirror)
+{
+	return mirror < 0 ||
+	       lov_stripe_entry(lsm, stripe)->lsme_mirror == mirror;
+}
+
 /**
  * Creates sub-locks for a given lov_lock for the first time.
  *
@@ -122,6 +129,8 @@ static int lov_sublock_init(const struct lu_env *env,
  * sub-object intersecting with top-lock extent. This is complicated by the
  * fact that top-lock (that is being created) can be accessed concurrently
  * through already created sub-locks (possibly shared with other top-locks).
+ * Only the stripes of the mirror the IO goes to are locked for a mirrored
+ * file.
  */
 static struct lov_lock *lov_lock_sub_init(const struct lu_env *env,
 					  const struct cl_object *obj,
@@ -130,6 +139,7 @@ static struct lov_lock *lov_lock_sub_init(const struct lu_env *env,
 	int result = 0;
 	int i;
 	int nr;
+	int mirror = -1;
 	loff_t start;
 	loff_t end;
 	loff_t file_start;
@@ -137,6 +147,7 @@ static struct lov_lock *lov_lock_sub_init(const struct lu_env *env,
 
 	struct lov_object	*loo    = cl2lov(obj);
 	struct lov_layout_raid0	*r0     = lov_r0(loo);
+	struct lov_io		*lio    = lov_env_io(env);
 	struct lov_lock		*lovlck;
 
 	ENTRY;
@@ -144,17 +155,22 @@ static struct lov_lock *lov_lock_sub_init(const struct lu_env *env,
 	file_start = cl_offset(lov2cl(loo), lock->cll_descr.cld_start);
 	file_end   = cl_offset(lov2cl(loo), lock->cll_descr.cld_end + 1) - 1;
 
+	if (lsm_is_mirrored(loo->lo_lsm) && lio->lis_object == loo)
+		mirror = lio->lis_mirror;
+
         for (i = 0, nr = 0; i < r0->lo_nr; i++) {
                 /*
                  * XXX for wide striping smarter algorithm is desirable,
                  * breaking out of the loop, early.
                  */
 		if (likely(r0->lo_sub[i] != NULL) && /* spare layout */
+		    lov_lock_mirror_match(loo->lo_lsm, i, mirror) &&
 		    lov_stripe_intersects(loo->lo_lsm, i,
 					  file_start, file_end, &start, &end))
 			nr++;
 	}
-	LASSERT(nr > 0);
+	/* a lock on a hole of a composite layout has no sub-locks */
+	LASSERT(nr > 0 || lsm_is_composite(loo->lo_lsm));
 
 	OBD_ALLOC_LARGE(lovlck, offsetof(struct lov_lock, lls_sub[nr]));
 	if (lovlck == NULL)
@@ -163,6 +179,7 @@ static struct lov_lock *lov_lock_sub_init(const struct lu_env *env,
 	lovlck->lls_nr = nr;
 	for (i = 0, nr = 0; i < r0->lo_nr; ++i) {
 		if (likely(r0->lo_sub[i] != NULL) &&
+		    lov_lock_mirror_match(loo->lo_lsm, i, mirror) &&
 		    lov_stripe_intersects(loo->lo_lsm, i,
 					  file_start, file_end, &start, &end)) {
 			struct lov_lock_sub *lls = &lovlck->lls_sub[nr];
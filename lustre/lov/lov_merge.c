@@ -70,6 +70,11 @@ int lov_merge_lvb_kms(struct lov_stripe_md *lsm,
 		u64 lov_size;
 		u64 tmpsize;
 
+		/* a stale mirror may still have data beyond EOF */
+		if (lsm_is_mirrored(lsm) &&
+		    lov_stripe_entry(lsm, i)->lsme_flags & LCME_FL_STALE)
+			continue;
+
                 if (OST_LVB_IS_ERR(loi->loi_lvb.lvb_blocks)) {
                         rc = OST_LVB_GET_ERR(loi->loi_lvb.lvb_blocks);
                         continue;
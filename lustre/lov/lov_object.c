@@ -237,10 +237,12 @@ static int lov_init_raid0(const struct lu_env *env, struct lov_device *dev,
 
         ENTRY;
 
-	if (lsm->lsm_magic != LOV_MAGIC_V1 && lsm->lsm_magic != LOV_MAGIC_V3) {
+	if (lsm->lsm_magic != LOV_MAGIC_V1 && lsm->lsm_magic != LOV_MAGIC_V3 &&
+	    lsm->lsm_magic != LOV_MAGIC_COMP_V1) {
 		dump_lsm(D_ERROR, lsm);
-		LASSERTF(0, "magic mismatch, expected %d/%d, actual %d.\n",
-			 LOV_MAGIC_V1, LOV_MAGIC_V3, lsm->lsm_magic);
+		LASSERTF(0, "magic mismatch, expected %d/%d/%d, actual %d.\n",
+			 LOV_MAGIC_V1, LOV_MAGIC_V3, LOV_MAGIC_COMP_V1,
+			 lsm->lsm_magic);
 	}
 
 	LASSERT(lov->lo_lsm == NULL);
@@ -312,7 +314,7 @@ static int lov_init_released(const struct lu_env *env,
 			     union lov_layout_state *state)
 {
 	LASSERT(lsm != NULL);
-	LASSERT(lsm_is_released(lsm));
+	LASSERT(lsm_is_released(lsm) || lsm_is_dom(lsm));
 	LASSERT(lov->lo_lsm == NULL);
 
 	lov->lo_lsm = lsm_addref(lsm);
@@ -683,7 +685,8 @@ static enum lov_layout_type lov_type(struct lov_stripe_md *lsm)
 {
 	if (lsm == NULL)
 		return LLT_EMPTY;
-	if (lsm_is_released(lsm))
+	/* data on MDT has no objects either, the I/O goes to the MDT */
+	if (lsm_is_released(lsm) || lsm_is_dom(lsm))
 		return LLT_RELEASED;
 	return LLT_RAID0;
 }
@@ -850,6 +853,7 @@ int lov_object_init(const struct lu_env *env, struct lu_object *obj,
 	init_rwsem(&lov->lo_type_guard);
 	atomic_set(&lov->lo_active_ios, 0);
 	init_waitqueue_head(&lov->lo_waitq);
+	atomic_set(&lov->lo_mirror_rr, 0);
 	cl_object_page_init(lu2cl(obj), sizeof(struct lov_page));
 
 	lov->lo_type = LLT_EMPTY;
@@ -1202,6 +1206,10 @@ static int lov_object_fiemap(const struct lu_env *env, struct cl_object *obj,
 	if (lsm == NULL)
 		RETURN(-ENODATA);
 
+	/* the stripes of a composite layout are not mapped per component */
+	if (lsm_is_composite(lsm))
+		GOTO(out_lsm, rc = -EOPNOTSUPP);
+
 	/**
 	 * If the stripe_count > 1 and the application does not understand
 	 * DEVICE_ORDER flag, it cannot interpret the extents correctly.
@@ -1244,7 +1252,7 @@ static int lov_object_fiemap(const struct lu_env *env, struct cl_object *obj,
 	fm_start = fiemap->fm_start;
 	fm_length = fiemap->fm_length;
 	/* Calculate start stripe, last stripe and length of mapping */
-	start_stripe = lov_stripe_number(lsm, fm_start);
+	start_stripe = lov_stripe_number(lsm, -1, fm_start);
 	fm_end = (fm_length == ~0ULL) ? fmkey->lfik_oa.o_size :
 					fm_start + fm_length - 1;
 	/* If fm_length != ~0ULL but fm_start_fm_length-1 exceeds file size */
@@ -1487,12 +1495,14 @@ static int lov_object_layout_get(const struct lu_env *env,
 	if (lsm == NULL) {
 		cl->cl_size = 0;
 		cl->cl_layout_gen = CL_LAYOUT_GEN_EMPTY;
+		cl->cl_is_dom = false;
 
 		RETURN(0);
 	}
 
-	cl->cl_size = lov_mds_md_size(lsm->lsm_stripe_count, lsm->lsm_magic);
+	cl->cl_size = lov_lsm_pack(lsm, NULL, 0);
 	cl->cl_layout_gen = lsm->lsm_layout_gen;
+	cl->cl_is_dom = lsm_is_dom(lsm);
 
 	rc = lov_lsm_pack(lsm, buf->lb_buf, buf->lb_len);
 	lov_lsm_put(lsm);
@@ -42,6 +42,79 @@
 
 #include "lov_internal.h"
 
+/**
+ * Find the component of a composite layout stripe \a stripeno belongs to.
+ *
+ * The stripes of the instantiated components follow each other in
+ * lsm_oinfo[]; the objects of a component are striped like a plain RAID0
+ * file, with the object offsets computed from the file offsets.
+ */
+struct lsm_entry *lov_stripe_entry(struct lov_stripe_md *lsm, int stripeno)
+{
+	struct lsm_entry *lsme;
+	int i;
+
+	LASSERT(lsm_is_composite(lsm));
+
+	for (i = 0; i < lsm->lsm_entry_count; i++) {
+		lsme = &lsm->lsm_entries[i];
+		if (lsme->lsme_stripe_count > 0 &&
+		    stripeno >= lsme->lsme_stripe_base &&
+		    stripeno < lsme->lsme_stripe_base +
+			       lsme->lsme_stripe_count)
+			return lsme;
+	}
+
+	LASSERTF(0, "stripe %d out of %u\n", stripeno, lsm->lsm_stripe_count);
+	return NULL;
+}
+
+/**
+ * Find the component of mirror \a mirror of a composite layout covering
+ * \a lov_off, the component of the first mirror if \a mirror is negative.
+ *
+ * The component may not be instantiated yet, i.e. have no stripes.
+ */
+struct lsm_entry *lov_offset_entry(struct lov_stripe_md *lsm, int mirror,
+				   loff_t lov_off)
+{
+	struct lsm_entry *lsme;
+	int i;
+
+	LASSERT(lsm_is_composite(lsm));
+
+	for (i = 0; i < lsm->lsm_entry_count; i++) {
+		lsme = &lsm->lsm_entries[i];
+		if (mirror >= 0 && lsme->lsme_mirror != mirror)
+			continue;
+		if ((__u64)lov_off < lsme->lsme_extent.e_end)
+			return lsme;
+	}
+
+	/* the last component ends at LUSTRE_EOF */
+	return &lsm->lsm_entries[lsm->lsm_entry_count - 1];
+}
+
+/* clamp "lov_off" to the extent of the component stripe "stripeno" belongs
+ * to, return < 0 if it was moved forward, > 0 if it was moved back */
+static int lov_entry_clamp(struct lov_stripe_md *lsm, int stripeno,
+			   loff_t *lov_off, unsigned long *ssize)
+{
+	struct lsm_entry *lsme = lov_stripe_entry(lsm, stripeno);
+
+	*ssize = lsme->lsme_stripe_size;
+	if ((__u64)*lov_off < lsme->lsme_extent.e_start) {
+		*lov_off = lsme->lsme_extent.e_start;
+		return -1;
+	}
+	if (lsme->lsme_extent.e_end != LUSTRE_EOF &&
+	    (__u64)*lov_off >= lsme->lsme_extent.e_end) {
+		*lov_off = lsme->lsme_extent.e_end;
+		return 1;
+	}
+	return 0;
+}
+
 /* compute object size given "stripeno" and the ost size */
 u64 lov_stripe_size(struct lov_stripe_md *lsm, u64 ost_size, int stripeno)
 {
@@ -55,6 +128,9 @@ u64 lov_stripe_size(struct lov_stripe_md *lsm, u64 ost_size, int stripeno)
         if (ost_size == 0)
                 RETURN(0);
 
+	if (lsm_is_composite(lsm))
+		ssize = lov_stripe_entry(lsm, stripeno)->lsme_stripe_size;
+
         LASSERT(lsm_op_find(magic) != NULL);
         lsm_op_find(magic)->lsm_stripe_by_index(lsm, &stripeno, NULL, &swidth);
 
@@ -128,7 +204,10 @@ pgoff_t lov_stripe_pgoff(struct lov_stripe_md *lsm, pgoff_t stripe_index,
  * this function returns < 0 when the offset was "before" the stripe and
  * was moved forward to the start of the stripe in question;  0 when it
  * falls in the stripe and no shifting was done; > 0 when the offset
- * was outside the stripe and was pulled back to its final byte. */
+ * was outside the stripe and was pulled back to its final byte.
+ *
+ * for a composite layout the offset is first clamped to the extent of the
+ * component the stripe belongs to, the same way. */
 int lov_stripe_offset(struct lov_stripe_md *lsm, loff_t lov_off, int stripeno,
 		      loff_t *obdoff)
 {
@@ -138,12 +217,16 @@ int lov_stripe_offset(struct lov_stripe_md *lsm, loff_t lov_off, int stripeno,
 	loff_t swidth;
 	u32 magic = lsm->lsm_magic;
         int ret = 0;
+	int clamp = 0;
 
         if (lov_off == OBD_OBJECT_EOF) {
                 *obdoff = OBD_OBJECT_EOF;
                 return 0;
         }
 
+	if (lsm_is_composite(lsm))
+		clamp = lov_entry_clamp(lsm, stripeno, &lov_off, &ssize);
+
         LASSERT(lsm_op_find(magic) != NULL);
         lsm_op_find(magic)->lsm_stripe_by_index(lsm, &stripeno, &lov_off,
                                                 &swidth);
@@ -165,7 +248,7 @@ int lov_stripe_offset(struct lov_stripe_md *lsm, loff_t lov_off, int stripeno,
         }
 
         *obdoff = lov_off * ssize + stripe_off;
-        return ret;
+	return clamp != 0 ? clamp : ret;
 }
 
 /* Given a whole-file size and a stripe number, give the file size which
@@ -199,6 +282,13 @@ loff_t lov_size_to_stripe(struct lov_stripe_md *lsm, u64 file_size,
         if (file_size == OBD_OBJECT_EOF)
                 return OBD_OBJECT_EOF;
 
+	if (lsm_is_composite(lsm)) {
+		loff_t size = file_size;
+
+		lov_entry_clamp(lsm, stripeno, &size, &ssize);
+		file_size = size;
+	}
+
         LASSERT(lsm_op_find(magic) != NULL);
         lsm_op_find(magic)->lsm_stripe_by_index(lsm, &stripeno, &file_size,
                                                 &swidth);
@@ -262,21 +352,35 @@ int lov_stripe_intersects(struct lov_stripe_md *lsm, int stripeno,
         return 1;
 }
 
-/* compute which stripe number "lov_off" will be written into */
-int lov_stripe_number(struct lov_stripe_md *lsm, loff_t lov_off)
+/* compute which stripe number "lov_off" will be written into, -1 if it
+ * falls into a component of a composite layout not instantiated yet. For a
+ * mirrored file the stripe is looked up in mirror "mirror" */
+int lov_stripe_number(struct lov_stripe_md *lsm, int mirror, loff_t lov_off)
 {
 	unsigned long ssize  = lsm->lsm_stripe_size;
 	loff_t stripe_off;
 	loff_t swidth;
 	u32 magic = lsm->lsm_magic;
-
-	LASSERT(lsm_op_find(magic) != NULL);
-	lsm_op_find(magic)->lsm_stripe_by_offset(lsm, NULL, &lov_off, &swidth);
+	int base = 0;
+
+	if (lsm_is_composite(lsm)) {
+		struct lsm_entry *lsme = lov_offset_entry(lsm, mirror, lov_off);
+
+		if (lsme->lsme_stripe_count == 0)
+			return -1;
+		ssize = lsme->lsme_stripe_size;
+		base = lsme->lsme_stripe_base;
+		swidth = (loff_t)ssize * lsme->lsme_stripe_count;
+	} else {
+		LASSERT(lsm_op_find(magic) != NULL);
+		lsm_op_find(magic)->lsm_stripe_by_offset(lsm, NULL, &lov_off,
+							 &swidth);
+	}
 
 	stripe_off = lov_do_div64(lov_off, swidth);
 
 	/* Puts stripe_off/ssize result into stripe_off */
 	lov_do_div64(stripe_off, ssize);
 
-	return stripe_off;
+	return base + stripe_off;
 }
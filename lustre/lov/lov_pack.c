@@ -142,6 +142,18 @@ ssize_t lov_lsm_pack(const struct lov_stripe_md *lsm, void *buf,
 	unsigned int i;
 	ENTRY;
 
+	/* the composite layout is kept as fetched from the MDT */
+	if (lsm_is_composite(lsm)) {
+		if (buf_size == 0)
+			RETURN(lsm->lsm_comp_md_size);
+
+		if (buf_size < lsm->lsm_comp_md_size)
+			RETURN(-ERANGE);
+
+		memcpy(buf, lsm->lsm_comp_md, lsm->lsm_comp_md_size);
+		RETURN(lsm->lsm_comp_md_size);
+	}
+
 	lmm_size = lov_mds_md_size(lsm->lsm_stripe_count, lsm->lsm_magic);
 	if (buf_size == 0)
 		RETURN(lmm_size);
@@ -334,6 +346,30 @@ int lov_getstripe(struct lov_object *obj, struct lov_stripe_md *lsm,
 	int			rc;
 	ENTRY;
 
+	/* the user passes the size of its buffer in lcm_size, the layout is
+	 * returned in the disk format like the lustre.lov xattr */
+	if (lsm_is_composite(lsm)) {
+		struct lov_comp_md_v1 lcm;
+
+		if (copy_from_user(&lcm, lump, sizeof(lcm)))
+			GOTO(out, rc = -EFAULT);
+
+		if (lcm.lcm_magic != LOV_USER_MAGIC_COMP_V1)
+			GOTO(out, rc = -EINVAL);
+
+		if (lcm.lcm_size < lsm->lsm_comp_md_size) {
+			lcm.lcm_size = lsm->lsm_comp_md_size;
+			rc = copy_to_user(lump, &lcm, sizeof(lcm));
+			GOTO(out, rc = -EOVERFLOW);
+		}
+
+		if (copy_to_user(lump, lsm->lsm_comp_md,
+				 lsm->lsm_comp_md_size))
+			GOTO(out, rc = -EFAULT);
+
+		GOTO(out, rc = 0);
+	}
+
 	if (lsm->lsm_magic != LOV_MAGIC_V1 && lsm->lsm_magic != LOV_MAGIC_V3) {
 		CERROR("bad LSM MAGIC: 0x%08X != 0x%08X nor 0x%08X\n",
 		       lsm->lsm_magic, LOV_MAGIC_V1, LOV_MAGIC_V3);
@@ -83,7 +83,14 @@ int lov_page_init_raid0(const struct lu_env *env, struct cl_object *obj,
 	ENTRY;
 
 	offset = cl_offset(obj, index);
-	stripe = lov_stripe_number(loo->lo_lsm, offset);
+	stripe = lov_stripe_number(loo->lo_lsm, lio->lis_object == loo ?
+				   lio->lis_mirror : -1, offset);
+	/* a component of a composite layout not instantiated yet reads as
+	 * zeroes, writing to it instantiates it first */
+	if (stripe < 0) {
+		lpg->lps_stripe = LOV_PAGE_HOLE;
+		RETURN(lov_page_init_empty(env, obj, page, index));
+	}
 	LASSERT(stripe < r0->lo_nr);
 	rc = lov_stripe_offset(loo->lo_lsm, offset, stripe,
 			       &suboff);
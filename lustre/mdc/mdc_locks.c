@@ -482,7 +482,7 @@ static struct ptlrpc_request *mdc_intent_getattr_pack(struct obd_export *exp,
 
 static struct ptlrpc_request *mdc_intent_layout_pack(struct obd_export *exp,
 						     struct lookup_intent *it,
-						     struct md_op_data *unused)
+						     struct md_op_data *op_data)
 {
 	struct obd_device     *obd = class_exp2obd(exp);
 	struct ptlrpc_request *req;
@@ -509,9 +509,13 @@ static struct ptlrpc_request *mdc_intent_layout_pack(struct obd_export *exp,
 
 	/* pack the layout intent request */
 	layout = req_capsule_client_get(&req->rq_pill, &RMF_LAYOUT_INTENT);
-	/* LAYOUT_INTENT_ACCESS is generic, specific operation will be
-	 * set for replication */
-	layout->li_opc = LAYOUT_INTENT_ACCESS;
+	/* LAYOUT_INTENT_ACCESS is generic, a specific operation such as
+	 * LAYOUT_INTENT_WRITE is passed by the caller in op_data */
+	if (op_data->op_data != NULL &&
+	    op_data->op_data_size == sizeof(*layout))
+		memcpy(layout, op_data->op_data, sizeof(*layout));
+	else
+		layout->li_opc = LAYOUT_INTENT_ACCESS;
 
 	req_capsule_set_size(&req->rq_pill, &RMF_DLM_LVB, RCL_SERVER,
 			     obd->u.cli.cl_default_mds_easize);
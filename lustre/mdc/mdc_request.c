@@ -260,6 +260,258 @@ static int mdc_getattr_name(struct obd_export *exp, struct md_op_data *op_data,
         RETURN(rc);
 }
 
+static inline bool
+mdc_batch_lock_has_md(const struct mdt_batch_getattr_rep *rep,
+		      const struct mdt_batch_lock_rep *lock_rep)
+{
+	return rep->mbgr_rc == 0 &&
+	       lustre_handle_is_used(&lock_rep->mblr_handle) &&
+	       rep->mbgr_body.mbo_valid & OBD_MD_FLEASIZE;
+}
+
+/**
+ * Finish the lock of one entry of a batched getattr, see mdc_batch_getattr().
+ * The layout of the entry, if any, is at \a md and is stored in the lock
+ * like mdc_finish_enqueue() does for a getattr intent.
+ */
+static int mdc_batch_lock_fini(struct obd_export *exp,
+			       struct lustre_handle *lockh, enum ldlm_mode mode,
+			       const struct mdt_batch_getattr_rep *rep,
+			       const struct mdt_batch_lock_rep *lock_rep,
+			       const void *md)
+{
+	const struct mdt_body	*body = &rep->mbgr_body;
+	struct lustre_handle	 remote = { 0 };
+	struct ldlm_res_id	 res_id;
+	struct ldlm_lock	*lock;
+	void			*lmm;
+	int			 rc;
+
+	if (rep->mbgr_rc == 0)
+		remote = lock_rep->mblr_handle;
+
+	fid_build_reg_res_name(&body->mbo_fid1, &res_id);
+	rc = ldlm_cli_remote_lock_fini(exp, lockh, mode, &res_id,
+				       lock_rep->mblr_bits, &remote);
+	if (rc != 0) {
+		lockh->cookie = 0;
+		return rc;
+	}
+
+	if (md == NULL)
+		return 0;
+
+	lock = ldlm_handle2lock(lockh);
+	LASSERT(lock != NULL);
+	if (!ldlm_has_layout(lock)) {
+		LDLM_LOCK_PUT(lock);
+		return 0;
+	}
+
+	/* without a layout in the lock it is fetched when the file is used */
+	OBD_ALLOC_LARGE(lmm, body->mbo_eadatasize);
+	if (lmm != NULL) {
+		memcpy(lmm, md, body->mbo_eadatasize);
+		lock_res_and_lock(lock);
+		if (lock->l_lvb_data == NULL) {
+			lock->l_lvb_type = LVB_T_LAYOUT;
+			lock->l_lvb_data = lmm;
+			lock->l_lvb_len = body->mbo_eadatasize;
+			lmm = NULL;
+		}
+		unlock_res_and_lock(lock);
+		if (lmm != NULL)
+			OBD_FREE_LARGE(lmm, body->mbo_eadatasize);
+	}
+	LDLM_LOCK_PUT(lock);
+	return 0;
+}
+
+/**
+ * Stat \a count names of directory op_data::op_fid1 with one
+ * MDS_BATCH_GETATTR RPC.
+ *
+ * \a names holds the NUL terminated names back to back, \a namelen is its
+ * total size. On success the reply holds one mdt_batch_getattr_rep per
+ * name, in the same order, in RMF_BATCH_GETATTR_REP.
+ *
+ * If \a einfo is not NULL and the MDT supports it, a \a einfo->ei_mode lock
+ * is asked for each name too. \a lockh then returns the handle of the lock
+ * of each name, referenced in \a einfo->ei_mode, or zero if the MDT did not
+ * grant one. The layouts granted with the locks are in RMF_BATCH_GETATTR_MD,
+ * mdt_body::mbo_eadatasize long each.
+ *
+ * \retval -EOPNOTSUPP	the MDT does not support batched getattr
+ * \retval -E2BIG	the names and lock handles are larger than
+ *			MDS_BATCH_GETATTR_BUFSIZE
+ */
+static int mdc_batch_getattr(struct obd_export *exp, struct md_op_data *op_data,
+			     const char *names, size_t namelen, int count,
+			     struct ldlm_enqueue_info *einfo,
+			     struct lustre_handle *lockh,
+			     struct ptlrpc_request **request)
+{
+	struct obd_import		*imp = class_exp2cliimp(exp);
+	struct ptlrpc_request		*req;
+	struct mdt_batch_getattr_rep	*rep;
+	struct mdt_batch_lock_rep	*lock_rep = NULL;
+	struct lustre_handle		*handles;
+	struct ldlm_res_id		 res_id;
+	char				*buf;
+	char				*md = NULL;
+	int				 mdlen = 0;
+	int				 repsize;
+	int				 size;
+	int				 locks = 0;
+	int				 i;
+	int				 rc;
+	ENTRY;
+
+	/* lustre_msg_v2 with its 4 buffer lengths, each buffer 8 aligned */
+	CLASSERT(sizeof(struct lustre_msg_v2) + 4 * sizeof(__u32) +
+		 sizeof(struct ptlrpc_body) + sizeof(struct mdt_body) +
+		 MDS_BATCH_GETATTR_BUFSIZE + 4 * 8 <= MDS_REG_MAXREQSIZE);
+
+	*request = NULL;
+	if (!(imp_connect_flags2(imp) & OBD_CONNECT2_BATCH_GETATTR))
+		RETURN(-EOPNOTSUPP);
+
+	if (count <= 0 || count > MDS_BATCH_GETATTR_MAX || namelen == 0)
+		RETURN(-EINVAL);
+
+	LASSERT(einfo == NULL || lockh != NULL);
+	if (lockh != NULL)
+		memset(lockh, 0, count * sizeof(*lockh));
+	if (einfo != NULL &&
+	    imp_connect_flags2(imp) & OBD_CONNECT2_BATCH_GETATTR_LOCK)
+		locks = count;
+	if (namelen + locks * sizeof(*handles) > MDS_BATCH_GETATTR_BUFSIZE)
+		RETURN(-E2BIG);
+
+	req = ptlrpc_request_alloc(imp, &RQF_MDS_BATCH_GETATTR);
+	if (req == NULL)
+		RETURN(-ENOMEM);
+
+	req_capsule_set_size(&req->rq_pill, &RMF_BATCH_NAMES, RCL_CLIENT,
+			     namelen);
+	req_capsule_set_size(&req->rq_pill, &RMF_BATCH_LOCK_HANDLES,
+			     RCL_CLIENT, locks * sizeof(*handles));
+
+	rc = ptlrpc_request_pack(req, LUSTRE_MDS_VERSION, MDS_BATCH_GETATTR);
+	if (rc) {
+		ptlrpc_request_free(req);
+		RETURN(rc);
+	}
+
+	mdc_pack_body(req, &op_data->op_fid1, op_data->op_valid, 0,
+		      op_data->op_suppgids[0], 0);
+
+	buf = req_capsule_client_get(&req->rq_pill, &RMF_BATCH_NAMES);
+	memcpy(buf, names, namelen);
+
+	/* the locks are created on the parent, the MDT tells which child
+	 * each of them covers */
+	if (locks > 0) {
+		handles = req_capsule_client_get(&req->rq_pill,
+						 &RMF_BATCH_LOCK_HANDLES);
+		fid_build_reg_res_name(&op_data->op_fid1, &res_id);
+		for (i = 0; i < locks; i++) {
+			rc = ldlm_cli_remote_lock_create(exp, einfo, &res_id,
+							 &lockh[i]);
+			if (rc != 0)
+				GOTO(out, rc);
+			handles[i] = lockh[i];
+		}
+		mdlen = min_t(int, MDS_BATCH_GETATTR_MD_MAX,
+			      count * exp->exp_obd->u.cli.cl_max_mds_easize);
+	}
+
+	repsize = count * sizeof(*rep);
+	req_capsule_set_size(&req->rq_pill, &RMF_BATCH_GETATTR_REP, RCL_SERVER,
+			     repsize);
+	req_capsule_set_size(&req->rq_pill, &RMF_BATCH_LOCK_REP, RCL_SERVER,
+			     locks * sizeof(*lock_rep));
+	req_capsule_set_size(&req->rq_pill, &RMF_BATCH_GETATTR_MD, RCL_SERVER,
+			     mdlen);
+	ptlrpc_request_set_replen(req);
+
+	rc = ptlrpc_queue_wait(req);
+	if (rc != 0)
+		GOTO(out, rc);
+
+	rep = req_capsule_server_sized_get(&req->rq_pill,
+					   &RMF_BATCH_GETATTR_REP, repsize);
+	if (rep == NULL)
+		GOTO(out, rc = -EPROTO);
+
+	if (locks > 0) {
+		size = req_capsule_get_size(&req->rq_pill, &RMF_BATCH_LOCK_REP,
+					    RCL_SERVER);
+		if (size != locks * sizeof(*lock_rep))
+			GOTO(out, rc = -EPROTO);
+		lock_rep = req_capsule_server_get(&req->rq_pill,
+						  &RMF_BATCH_LOCK_REP);
+		if (lock_rep == NULL)
+			GOTO(out, rc = -EPROTO);
+
+		mdlen = req_capsule_get_size(&req->rq_pill,
+					     &RMF_BATCH_GETATTR_MD, RCL_SERVER);
+		if (mdlen > 0)
+			md = req_capsule_server_get(&req->rq_pill,
+						    &RMF_BATCH_GETATTR_MD);
+		if (md == NULL)
+			mdlen = 0;
+	}
+
+	/* check all the layouts first, a lock once finished is the caller's */
+	for (i = 0, size = 0; i < locks; i++) {
+		const struct mdt_body *body = &rep[i].mbgr_body;
+
+		if (!mdc_batch_lock_has_md(&rep[i], &lock_rep[i]))
+			continue;
+
+		if (!S_ISREG(body->mbo_mode) || body->mbo_eadatasize == 0 ||
+		    body->mbo_eadatasize > mdlen - size) {
+			CDEBUG(D_INFO, "%s: bad layout size %u, %d left\n",
+			       exp->exp_obd->obd_name, body->mbo_eadatasize,
+			       mdlen - size);
+			GOTO(out, rc = -EPROTO);
+		}
+		size += body->mbo_eadatasize;
+	}
+
+	for (i = 0; i < locks; i++) {
+		const char *lmm = NULL;
+
+		if (mdc_batch_lock_has_md(&rep[i], &lock_rep[i])) {
+			lmm = md;
+			md += rep[i].mbgr_body.mbo_eadatasize;
+		}
+		mdc_batch_lock_fini(exp, &lockh[i], einfo->ei_mode, &rep[i],
+				    &lock_rep[i], lmm);
+	}
+	EXIT;
+out:
+	if (rc != 0) {
+		struct lustre_handle none = { 0 };
+
+		/* drop the locks, the MDT cancels the ones it granted when
+		 * their blocking AST fails */
+		for (i = 0; i < locks; i++) {
+			if (!lustre_handle_is_used(&lockh[i]))
+				continue;
+			ldlm_cli_remote_lock_fini(exp, &lockh[i],
+						  einfo->ei_mode, &res_id, 0,
+						  &none);
+			lockh[i].cookie = 0;
+		}
+		ptlrpc_req_finished(req);
+	} else {
+		*request = req;
+	}
+	return rc;
+}
+
 static int mdc_xattr_common(struct obd_export *exp,const struct req_format *fmt,
 			    const struct lu_fid *fid, int opcode, u64 valid,
 			    const char *xattr_name, const char *input,
@@ -925,6 +1177,136 @@ restart_bulk:
 	RETURN(0);
 }
 
+/**
+ * Bulk IO to the data of a Data-on-MDT file.
+ *
+ * The request is an OST_READ/OST_WRITE with a single niobuf sent to the
+ * MDS_IO_PORTAL, the range must fit into one bulk MD (LNET_MTU). The data
+ * is not cached, the server takes the DOM lock for the transfer.
+ *
+ * \param[in] exp	MDC export
+ * \param[in] cmd	OBD_BRW_READ or OBD_BRW_WRITE
+ * \param[in,out] oa	FID of the file, attributes from the reply
+ * \param[in] offset	file offset
+ * \param[in] count	number of bytes
+ * \param[in] pages	data, starting at the in-page offset of \a offset
+ * \param[in] npages	number of pages
+ *
+ * \retval		number of bytes transferred
+ * \retval		negative errno on error
+ */
+static int mdc_dom_rw(struct obd_export *exp, int cmd, struct obdo *oa,
+		      u64 offset, size_t count, struct page **pages,
+		      int npages)
+{
+	struct obd_import	*imp = class_exp2cliimp(exp);
+	struct ptlrpc_request	*req;
+	struct ptlrpc_bulk_desc	*desc;
+	struct req_capsule	*pill;
+	struct ost_body		*body;
+	struct obd_ioobj	*ioobj;
+	struct niobuf_remote	*niobuf;
+	int			 opc = cmd == OBD_BRW_WRITE ? OST_WRITE : OST_READ;
+	unsigned int		 pgoff = offset & ~PAGE_MASK;
+	size_t			 left = count;
+	int			 i, rc;
+	ENTRY;
+
+	if (!exp_connect_dom(exp))
+		RETURN(-EOPNOTSUPP);
+
+	LASSERT(count > 0 && count <= LNET_MTU);
+	LASSERT(npages > 0 && npages <= LNET_MAX_IOV);
+
+	req = ptlrpc_request_alloc(imp, opc == OST_WRITE ? &RQF_OST_BRW_WRITE :
+							   &RQF_OST_BRW_READ);
+	if (req == NULL)
+		RETURN(-ENOMEM);
+
+	pill = &req->rq_pill;
+	req_capsule_set_size(pill, &RMF_OBD_IOOBJ, RCL_CLIENT, sizeof(*ioobj));
+	req_capsule_set_size(pill, &RMF_NIOBUF_REMOTE, RCL_CLIENT,
+			     sizeof(*niobuf));
+	rc = ptlrpc_request_pack(req, LUSTRE_OST_VERSION, opc);
+	if (rc) {
+		ptlrpc_request_free(req);
+		RETURN(rc);
+	}
+
+	req->rq_request_portal = MDS_IO_PORTAL;
+	ptlrpc_at_set_req_timeout(req);
+
+	desc = ptlrpc_prep_bulk_imp(req, npages, 1,
+				    (opc == OST_WRITE ? PTLRPC_BULK_GET_SOURCE :
+							PTLRPC_BULK_PUT_SINK) |
+				    PTLRPC_BULK_BUF_KIOV, OST_BULK_PORTAL,
+				    &ptlrpc_bulk_kiov_pin_ops);
+	if (desc == NULL)
+		GOTO(out, rc = -ENOMEM);
+
+	/* NB req now owns desc and will free it when it gets freed */
+	for (i = 0; i < npages && left > 0; i++) {
+		unsigned int len = min_t(size_t, PAGE_SIZE - pgoff, left);
+
+		desc->bd_frag_ops->add_kiov_frag(desc, pages[i], pgoff, len);
+		left -= len;
+		pgoff = 0;
+	}
+	LASSERT(left == 0);
+
+	body = req_capsule_client_get(pill, &RMF_OST_BODY);
+	ioobj = req_capsule_client_get(pill, &RMF_OBD_IOOBJ);
+	niobuf = req_capsule_client_get(pill, &RMF_NIOBUF_REMOTE);
+	LASSERT(body != NULL && ioobj != NULL && niobuf != NULL);
+
+	lustre_set_wire_obdo(&imp->imp_connect_data, &body->oa, oa);
+	obdo_to_ioobj(oa, ioobj);
+	ioobj->ioo_bufcnt = 1;
+	ioobj_max_brw_set(ioobj, desc->bd_md_max_brw);
+
+	niobuf->rnb_offset = offset;
+	niobuf->rnb_len = count;
+	niobuf->rnb_flags = 0;
+
+	if (opc == OST_WRITE)
+		req_capsule_set_size(pill, &RMF_RCS, RCL_SERVER,
+				     sizeof(__u32));
+	ptlrpc_request_set_replen(req);
+
+	/* a read returns the number of bytes sent in the bulk */
+	rc = ptlrpc_queue_wait(req);
+	if (rc < 0)
+		GOTO(out, rc);
+
+	body = req_capsule_server_get(pill, &RMF_OST_BODY);
+	if (body == NULL)
+		GOTO(out, rc = -EPROTO);
+	lustre_get_wire_obdo(&imp->imp_connect_data, oa, &body->oa);
+
+	if (opc == OST_WRITE) {
+		__u32 *rcs;
+
+		if (sptlrpc_cli_unwrap_bulk_write(req, req->rq_bulk))
+			GOTO(out, rc = -EAGAIN);
+
+		rcs = req_capsule_server_get(pill, &RMF_RCS);
+		if (rcs == NULL)
+			GOTO(out, rc = -EPROTO);
+		if ((int)rcs[0] < 0)
+			GOTO(out, rc = rcs[0]);
+		if (req->rq_bulk->bd_nob_transferred != count)
+			GOTO(out, rc = -EPROTO);
+		rc = count;
+	} else {
+		rc = sptlrpc_cli_unwrap_bulk_read(req, req->rq_bulk,
+					req->rq_bulk->bd_nob_transferred);
+	}
+	EXIT;
+out:
+	ptlrpc_req_finished(req);
+	return rc;
+}
+
 static void mdc_release_page(struct page *page, int remove)
 {
 	if (remove) {
@@ -2561,6 +2943,31 @@ static int mdc_cancel_weight(struct ldlm_lock *lock)
 	RETURN(1);
 }
 
+/**
+ * Get the number of pages cached under the lock for the cost aware LRU: the
+ * pages of a directory are dropped along with its UPDATE lock. Data of
+ * regular files are protected by OSC locks.
+ */
+static unsigned long mdc_lock_cost(struct ldlm_lock *lock,
+				   unsigned long *dirty)
+{
+	struct inode	*inode;
+	unsigned long	 pages = 0;
+
+	*dirty = 0;
+	if (lock->l_resource->lr_type != LDLM_IBITS ||
+	    !(lock->l_policy_data.l_inodebits.bits & MDS_INODELOCK_UPDATE))
+		return 0;
+
+	lock_res_and_lock(lock);
+	inode = lock->l_resource->lr_lvb_inode;
+	if (inode != NULL && S_ISDIR(inode->i_mode))
+		pages = inode->i_mapping->nrpages;
+	unlock_res_and_lock(lock);
+
+	return pages;
+}
+
 static int mdc_resource_inode_free(struct ldlm_resource *res)
 {
 	if (res->lr_lvb_inode)
@@ -2627,6 +3034,7 @@ static int mdc_setup(struct obd_device *obd, struct lustre_cfg *cfg)
 	ptlrpc_lprocfs_register_obd(obd);
 
 	ns_register_cancel(obd->obd_namespace, mdc_cancel_weight);
+	ns_register_lock_cost(obd->obd_namespace, mdc_lock_cost);
 
 	obd->obd_namespace->ns_lvbo = &inode_lvbo;
 
@@ -2766,6 +3174,8 @@ static struct md_ops mdc_md_ops = {
         .m_enqueue          = mdc_enqueue,
         .m_getattr          = mdc_getattr,
         .m_getattr_name     = mdc_getattr_name,
+	.m_batch_getattr    = mdc_batch_getattr,
+	.m_dom_rw           = mdc_dom_rw,
         .m_intent_lock      = mdc_intent_lock,
         .m_link             = mdc_link,
         .m_rename           = mdc_rename,
@@ -3511,6 +3511,12 @@ static int mdd_migrate_create(const struct lu_env *env,
 		rc = mdd_get_lov_ea(env, mdd_sobj, &lmm_buf);
 		if (rc != 0 && rc != -ENODATA)
 			RETURN(rc);
+		/* the data of a DoM file would stay on this MDT */
+		if (lmm_buf.lb_buf != NULL &&
+		    mdd_lov_ea_is_dom(lmm_buf.lb_buf)) {
+			OBD_FREE(lmm_buf.lb_buf, lmm_buf.lb_len);
+			RETURN(-EOPNOTSUPP);
+		}
 		if (lmm_buf.lb_buf != NULL && lmm_buf.lb_len != 0) {
 			spec->u.sp_ea.eadata = lmm_buf.lb_buf;
 			spec->u.sp_ea.eadatalen = lmm_buf.lb_len;
@@ -312,6 +312,15 @@ int mdd_declare_object_create_internal(const struct lu_env *env,
 int mdd_get_lov_ea(const struct lu_env *env, struct mdd_object *obj,
 		   struct lu_buf *lmm_buf);
 
+/* file data is stored in the MDT inode, see LOV_PATTERN_MDT */
+static inline bool mdd_lov_ea_is_dom(const struct lov_mds_md *lmm)
+{
+	__u32 magic = le32_to_cpu(lmm->lmm_magic);
+
+	return (magic == LOV_MAGIC_V1 || magic == LOV_MAGIC_V3) &&
+	       lov_pattern(le32_to_cpu(lmm->lmm_pattern)) == LOV_PATTERN_MDT;
+}
+
 /* mdd_trans.c */
 void mdd_object_make_hint(const struct lu_env *env, struct mdd_object *parent,
 			  struct mdd_object *child, const struct lu_attr *attr,
@@ -539,6 +548,32 @@ static inline int mdo_xattr_set(const struct lu_env *env,struct mdd_object *obj,
 	return dt_xattr_set(env, next, buf, name, fl, handle);
 }
 
+static inline int mdo_declare_layout_change(const struct lu_env *env,
+					    struct mdd_object *obj,
+					    struct layout_intent *layout,
+					    struct thandle *handle)
+{
+	struct dt_object *next = mdd_object_child(obj);
+
+	if (!mdd_object_exists(obj))
+		return -ENOENT;
+
+	return dt_declare_layout_change(env, next, layout, handle);
+}
+
+static inline int mdo_layout_change(const struct lu_env *env,
+				    struct mdd_object *obj,
+				    struct layout_intent *layout,
+				    struct thandle *handle)
+{
+	struct dt_object *next = mdd_object_child(obj);
+
+	if (!mdd_object_exists(obj))
+		return -ENOENT;
+
+	return dt_layout_change(env, next, layout, handle);
+}
+
 static inline int mdo_declare_xattr_del(const struct lu_env *env,
                                         struct mdd_object *obj,
                                         const char *name,
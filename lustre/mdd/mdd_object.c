@@ -1269,6 +1269,11 @@ static int mdd_xattr_hsm_replace(const struct lu_env *env,
 	RETURN(rc);
 }
 
+static inline bool mdd_lov_ea_is_comp(const struct lov_mds_md *lmm)
+{
+	return le32_to_cpu(lmm->lmm_magic) == LOV_MAGIC_COMP_V1;
+}
+
 /*
  *  check if layout swapping between 2 objects is allowed
  *  the rules are:
@@ -1388,6 +1393,19 @@ static int mdd_swap_layouts(const struct lu_env *env, struct md_object *obj1,
 		swap(fst_buf, snd_buf);
 	}
 
+	/* composite layouts keep the generation in their own header, swapping
+	 * them is not supported yet */
+	if ((fst_buf->lb_buf != NULL &&
+	     mdd_lov_ea_is_comp(fst_buf->lb_buf)) ||
+	    mdd_lov_ea_is_comp(snd_buf->lb_buf))
+		GOTO(stop, rc = -EOPNOTSUPP);
+
+	/* the data of a DoM file is in the MDT inode and cannot follow its
+	 * layout, this covers HSM release and lfs migrate too */
+	if ((fst_buf->lb_buf != NULL && mdd_lov_ea_is_dom(fst_buf->lb_buf)) ||
+	    mdd_lov_ea_is_dom(snd_buf->lb_buf))
+		GOTO(stop, rc = -EOPNOTSUPP);
+
 	/* lmm and generation layout initialization */
 	if (fst_buf->lb_buf != NULL) {
 		fst_lmm = fst_buf->lb_buf;
@@ -1569,6 +1587,62 @@ stop:
 	return rc;
 }
 
+/**
+ * Change the layout of a file to serve a layout intent.
+ *
+ * Used to instantiate the components of a composite layout covering the
+ * extent a client is about to write to.
+ *
+ * \param[in] env	execution environment
+ * \param[in] obj	file
+ * \param[in] layout	layout intent sent by the client
+ *
+ * \retval 0		on success, or if the layout already serves the intent
+ * \retval negative	negated errno on error
+ */
+static int mdd_layout_change(const struct lu_env *env, struct md_object *obj,
+			     struct layout_intent *layout)
+{
+	struct mdd_object	*mdd_obj = md2mdd_obj(obj);
+	struct mdd_device	*mdd = mdo2mdd(obj);
+	struct thandle		*handle;
+	int			 rc;
+	ENTRY;
+
+	if (!S_ISREG(mdd_object_type(mdd_obj)))
+		RETURN(-EINVAL);
+
+	handle = mdd_trans_create(env, mdd);
+	if (IS_ERR(handle))
+		RETURN(PTR_ERR(handle));
+
+	rc = mdo_declare_layout_change(env, mdd_obj, layout, handle);
+	if (rc)
+		GOTO(stop, rc);
+
+	rc = mdd_declare_changelog_store(env, mdd, NULL, NULL, handle);
+	if (rc)
+		GOTO(stop, rc);
+
+	rc = mdd_trans_start(env, mdd, handle);
+	if (rc)
+		GOTO(stop, rc);
+
+	mdd_write_lock(env, mdd_obj, MOR_TGT_CHILD);
+	rc = mdo_layout_change(env, mdd_obj, layout, handle);
+	mdd_write_unlock(env, mdd_obj);
+	if (rc)
+		GOTO(stop, rc);
+
+	rc = mdd_changelog_data_store(env, mdd, CL_LAYOUT, 0, mdd_obj, handle);
+	EXIT;
+
+stop:
+	mdd_trans_stop(env, mdd, rc, handle);
+	/* nothing to instantiate, somebody else did it already */
+	return rc == -EALREADY ? 0 : rc;
+}
+
 void mdd_object_make_hint(const struct lu_env *env, struct mdd_object *parent,
 			  struct mdd_object *child, const struct lu_attr *attr,
 			  const struct md_op_spec *spec,
@@ -2069,6 +2143,7 @@ const struct md_object_operations mdd_obj_ops = {
 	.moo_xattr_list		= mdd_xattr_list,
 	.moo_xattr_del		= mdd_xattr_del,
 	.moo_swap_layouts	= mdd_swap_layouts,
+	.moo_layout_change	= mdd_layout_change,
 	.moo_open		= mdd_open,
 	.moo_close		= mdd_close,
 	.moo_readpage		= mdd_readpage,
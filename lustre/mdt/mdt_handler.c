@@ -487,6 +487,12 @@ void mdt_pack_attr2body(struct mdt_thread_info *info, struct mdt_body *b,
 		else
 			b->mbo_blocks = 1;
 		b->mbo_valid |= OBD_MD_FLSIZE | OBD_MD_FLBLOCKS;
+	} else if ((ma->ma_valid & MA_LOV) && ma->ma_lmm != NULL &&
+		   le32_to_cpu(ma->ma_lmm->lmm_magic) != LOV_MAGIC_COMP_V1 &&
+		   lov_pattern(le32_to_cpu(ma->ma_lmm->lmm_pattern)) ==
+		   LOV_PATTERN_MDT) {
+		/* Data-on-MDT file, the MDT inode holds data and size */
+		b->mbo_valid |= OBD_MD_FLSIZE | OBD_MD_FLBLOCKS;
 	}
 
 	if (fid != NULL && (b->mbo_valid & OBD_MD_FLSIZE))
@@ -933,6 +939,12 @@ static int mdt_getattr_internal(struct mdt_thread_info *info,
         else
                 RETURN(-EFAULT);
 
+	/* the size of a striped file is only known by the OSTs, return the
+	 * lazy size-on-MDT if the client can live with it */
+	if ((reqbody->mbo_valid & OBD_MD_FLLAZYSIZE) && S_ISREG(la->la_mode) &&
+	    !(repbody->mbo_valid & OBD_MD_FLSIZE))
+		mdt_lsom_pack(info, o, repbody);
+
         if (mdt_body_has_lov(la, reqbody)) {
                 if (ma->ma_valid & MA_LOV) {
                         LASSERT(ma->ma_lmm_size);
@@ -1220,6 +1232,8 @@ static int mdt_swap_layouts(struct tgt_session_info *tsi)
 		GOTO(unlock2, rc);
 
 	mdt_swap_lov_flag(o1, o2);
+	mdt_lsom_invalidate(info, o1);
+	mdt_lsom_invalidate(info, o2);
 
 unlock2:
 	mdt_object_unlock(info, o2, lh2, rc);
@@ -1482,6 +1496,13 @@ static int mdt_getattr_name_lock(struct mdt_thread_info *info,
 			try_layout = true;
 		}
 
+		/* the size of a DoM file is cached under this lock too, so
+		 * it has to conflict with the DOM lock of writes */
+		if (child_bits & MDS_INODELOCK_UPDATE &&
+		    exp_connect_dom(info->mti_exp) &&
+		    mdt_dom_object(info->mti_env, child, NULL))
+			child_bits |= MDS_INODELOCK_DOM;
+
 		rc = 0;
 		if (try_layout) {
 			child_bits |= MDS_INODELOCK_LAYOUT;
@@ -1573,6 +1594,295 @@ out_shrink:
 	return rc;
 }
 
+static int mdt_batch_getattr_one(struct mdt_thread_info *info,
+				 struct mdt_object *o, struct mdt_body *body)
+{
+	struct md_attr	*ma = &info->mti_attr;
+	int		 rc;
+
+	if (mdt_object_remote(o)) {
+		/* let the client stat it on the MDT holding the inode */
+		body->mbo_fid1 = *mdt_object_fid(o);
+		body->mbo_valid = OBD_MD_FLID | OBD_MD_MDS;
+		return 0;
+	}
+
+	ma->ma_need = MA_INODE;
+	ma->ma_valid = 0;
+	rc = mdt_attr_get_complex(info, o, ma);
+	if (rc != 0)
+		return rc;
+
+	mdt_pack_attr2body(info, body, &ma->ma_attr, mdt_object_fid(o));
+	if (!S_ISREG(ma->ma_attr.la_mode))
+		return 0;
+
+	mdt_lsom_pack(info, o, body);
+	/* only the layout size, so the client knows whether the MDT size
+	 * and times are authoritative */
+	rc = mdt_attr_get_eabuf_size(info, o);
+	if (rc < 0)
+		return rc;
+	if (rc > 0) {
+		body->mbo_eadatasize = rc;
+		body->mbo_valid |= OBD_MD_FLEASIZE;
+	}
+	return 0;
+}
+
+static const struct ldlm_callback_suite mdt_batch_lock_cbs = {
+	.lcs_completion	= ldlm_server_completion_ast,
+	.lcs_blocking	= ldlm_server_blocking_ast,
+	.lcs_glimpse	= ldlm_server_glimpse_ast
+};
+
+/**
+ * Grant the client lock \a remote on the child \a o of a batched getattr.
+ *
+ * Like an IT_GETATTR intent the lock covers LOOKUP, UPDATE and PERM, plus
+ * the layout of regular files, which is then returned at \a *md. Nothing is
+ * granted for remote objects and directories, nor if the lock would block or
+ * the layout does not fit in the \a *mdlen bytes left, the client stats those
+ * entries one by one.
+ *
+ * \retval 0 if the lock was granted, \a rep, \a body, \a md and \a mdlen
+ *	   are updated
+ * \retval negative errno if it was not
+ */
+static int mdt_batch_getattr_lock(struct mdt_thread_info *info,
+				  struct mdt_object *o,
+				  const struct lustre_handle *remote,
+				  struct mdt_batch_lock_rep *rep,
+				  struct mdt_body *body, char **md, int *mdlen)
+{
+	struct ldlm_res_id	*res_id = &info->mti_res_id;
+	struct md_attr		*ma = &info->mti_attr;
+	struct lustre_handle	 lockh;
+	__u64			 bits;
+	__u32			 mode = lu_object_attr(&o->mot_obj);
+	int			 rc;
+	ENTRY;
+
+	if (mdt_object_remote(o) || S_ISDIR(mode))
+		RETURN(-EOPNOTSUPP);
+
+	bits = MDS_INODELOCK_LOOKUP | MDS_INODELOCK_UPDATE |
+	       MDS_INODELOCK_PERM;
+	if (S_ISREG(mode)) {
+		if (*mdlen < sizeof(struct lov_mds_md_v1))
+			RETURN(-EOVERFLOW);
+		bits |= MDS_INODELOCK_LAYOUT;
+	}
+
+	fid_build_reg_res_name(mdt_object_fid(o), res_id);
+	rc = ldlm_grant_remote_ibits_lock(info->mti_mdt->mdt_namespace,
+					  mdt_info_req(info), res_id, LCK_PR,
+					  bits, remote, &mdt_batch_lock_cbs,
+					  &lockh);
+	if (rc != 0)
+		RETURN(rc);
+
+	/* read the attributes again under the lock, they are cached from
+	 * here on */
+	ma->ma_need = MA_INODE;
+	ma->ma_valid = 0;
+	if (S_ISREG(mode)) {
+		ma->ma_need |= MA_LOV;
+		ma->ma_lmm = (struct lov_mds_md *)*md;
+		ma->ma_lmm_size = *mdlen;
+	}
+	info->mti_big_lmm_used = 0;
+	rc = mdt_attr_get_complex(info, o, ma);
+	if (rc == 0 && info->mti_big_lmm_used)
+		rc = -EOVERFLOW;
+	info->mti_big_lmm_used = 0;
+	if (rc != 0) {
+		struct ldlm_lock *lock = ldlm_handle2lock(&lockh);
+
+		if (lock != NULL) {
+			ldlm_lock_cancel(lock);
+			LDLM_LOCK_PUT(lock);
+		}
+		RETURN(rc);
+	}
+
+	mdt_pack_attr2body(info, body, &ma->ma_attr, mdt_object_fid(o));
+	if (S_ISREG(mode))
+		mdt_lsom_pack(info, o, body);
+	if (ma->ma_valid & MA_LOV) {
+		body->mbo_eadatasize = ma->ma_lmm_size;
+		body->mbo_valid |= OBD_MD_FLEASIZE;
+		*md += ma->ma_lmm_size;
+		*mdlen -= ma->ma_lmm_size;
+	}
+
+	rep->mblr_handle = lockh;
+	rep->mblr_bits = bits;
+	RETURN(0);
+}
+
+/**
+ * Look up a batch of names in one directory and return their attributes.
+ *
+ * This replaces one MDS_GETATTR_NAME RPC per entry by one RPC per batch for
+ * clients scanning large directories. Like MDS_GETATTR_NAME no lock is
+ * granted unless the client sent lock handles, the attributes are only a
+ * snapshot then. Errors are reported per name in
+ * mdt_batch_getattr_rep::mbgr_rc, the RPC itself only fails if the request
+ * is malformed or the parent cannot be used.
+ *
+ * With lock handles the client can instantiate the entries right away, see
+ * mdt_batch_getattr_lock(). The parent is locked for the whole batch so that
+ * no name moves between its lookup and the lock of its child.
+ */
+static int mdt_batch_getattr(struct tgt_session_info *tsi)
+{
+	struct mdt_thread_info		*info = tsi2mdt_info(tsi);
+	struct req_capsule		*pill = info->mti_pill;
+	struct mdt_object		*parent = info->mti_object;
+	struct lu_fid			*child_fid = &info->mti_tmp_fid1;
+	struct lu_name			*lname = &info->mti_name;
+	struct mdt_batch_getattr_rep	*rep;
+	struct mdt_batch_lock_rep	*lock_rep = NULL;
+	struct lustre_handle		*handles = NULL;
+	struct mdt_lock_handle		*lhp;
+	struct mdt_body			*reqbody;
+	char				*names;
+	char				*md = NULL;
+	char				*mdbuf = NULL;
+	int				 mdlen = 0;
+	int				 size;
+	int				 count = 0;
+	int				 i;
+	int				 rc;
+	ENTRY;
+
+	reqbody = req_capsule_client_get(pill, &RMF_MDT_BODY);
+	names = req_capsule_client_get(pill, &RMF_BATCH_NAMES);
+	size = req_capsule_get_size(pill, &RMF_BATCH_NAMES, RCL_CLIENT);
+	if (reqbody == NULL || names == NULL || size <= 0 ||
+	    names[size - 1] != '\0')
+		GOTO(out, rc = err_serious(-EPROTO));
+
+	for (i = 0; i < size; i++)
+		if (names[i] == '\0')
+			count++;
+	if (count > MDS_BATCH_GETATTR_MAX)
+		GOTO(out, rc = err_serious(-EPROTO));
+
+	if (exp_connect_batch_getattr_lock(info->mti_exp) &&
+	    req_capsule_get_size(pill, &RMF_BATCH_LOCK_HANDLES,
+				 RCL_CLIENT) > 0) {
+		handles = req_capsule_client_get(pill, &RMF_BATCH_LOCK_HANDLES);
+		if (handles == NULL ||
+		    req_capsule_get_size(pill, &RMF_BATCH_LOCK_HANDLES,
+					 RCL_CLIENT) !=
+		    count * sizeof(*handles))
+			GOTO(out, rc = err_serious(-EPROTO));
+
+		mdlen = min(count * info->mti_mdt->mdt_max_mdsize,
+			    MDS_BATCH_GETATTR_MD_MAX);
+	}
+
+	req_capsule_set_size(pill, &RMF_BATCH_GETATTR_REP, RCL_SERVER,
+			     count * sizeof(*rep));
+	req_capsule_set_size(pill, &RMF_BATCH_LOCK_REP, RCL_SERVER,
+			     handles != NULL ? count * sizeof(*lock_rep) : 0);
+	req_capsule_set_size(pill, &RMF_BATCH_GETATTR_MD, RCL_SERVER, mdlen);
+	rc = req_capsule_server_pack(pill);
+	if (unlikely(rc != 0))
+		GOTO(out, rc = err_serious(rc));
+
+	rep = req_capsule_server_get(pill, &RMF_BATCH_GETATTR_REP);
+	memset(rep, 0, count * sizeof(*rep));
+	if (handles != NULL) {
+		lock_rep = req_capsule_server_get(pill, &RMF_BATCH_LOCK_REP);
+		memset(lock_rep, 0, count * sizeof(*lock_rep));
+		if (mdlen > 0)
+			mdbuf = req_capsule_server_get(pill,
+						       &RMF_BATCH_GETATTR_MD);
+		md = mdbuf;
+		if (md == NULL)
+			mdlen = 0;
+	}
+
+	rc = mdt_init_ucred(info, reqbody);
+	if (unlikely(rc != 0))
+		GOTO(out, rc);
+
+	if (!mdt_object_exists(parent))
+		GOTO(out_ucred, rc = -ESTALE);
+
+	if (mdt_object_remote(parent))
+		GOTO(out_ucred, rc = -EREMOTE);
+
+	if (!S_ISDIR(lu_object_attr(&parent->mot_obj)))
+		GOTO(out_ucred, rc = -ENOTDIR);
+
+	lhp = &info->mti_lh[MDT_LH_PARENT];
+	if (handles != NULL) {
+		mdt_lock_reg_init(lhp, LCK_PR);
+		rc = mdt_object_lock(info, parent, lhp, MDS_INODELOCK_UPDATE);
+		if (rc != 0)
+			GOTO(out_ucred, rc);
+	}
+
+	for (i = 0; i < count; i++, rep++) {
+		struct mdt_object *child;
+
+		lname->ln_name = names;
+		lname->ln_namelen = strlen(names);
+		names += lname->ln_namelen + 1;
+
+		if (!lu_name_is_valid(lname)) {
+			rep->mbgr_rc = -EINVAL;
+			continue;
+		}
+
+		fid_zero(child_fid);
+		rc = mdo_lookup(info->mti_env, mdt_object_child(parent), lname,
+				child_fid, &info->mti_spec);
+		if (rc != 0) {
+			rep->mbgr_rc = rc;
+			continue;
+		}
+
+		child = mdt_object_find(info->mti_env, info->mti_mdt,
+					child_fid);
+		if (IS_ERR(child)) {
+			rep->mbgr_rc = PTR_ERR(child);
+			continue;
+		}
+
+		if (!mdt_object_exists(child))
+			rep->mbgr_rc = -ENOENT;
+		else if (handles == NULL ||
+			 mdt_batch_getattr_lock(info, child, &handles[i],
+						&lock_rep[i], &rep->mbgr_body,
+						&md, &mdlen) != 0)
+			rep->mbgr_rc = mdt_batch_getattr_one(info, child,
+							     &rep->mbgr_body);
+		mdt_object_put(info->mti_env, child);
+
+		if (rep->mbgr_rc == 0)
+			mdt_counter_incr(mdt_info_req(info), LPROC_MDT_GETATTR);
+	}
+
+	if (handles != NULL) {
+		mdt_object_unlock(info, parent, lhp, 1);
+		if (mdbuf != NULL)
+			req_capsule_shrink(pill, &RMF_BATCH_GETATTR_MD,
+					   md - mdbuf, RCL_SERVER);
+	}
+	rc = 0;
+	EXIT;
+out_ucred:
+	mdt_exit_ucred(info);
+out:
+	mdt_thread_info_fini(info);
+	return rc;
+}
+
 static int mdt_iocontrol(unsigned int cmd, struct obd_export *exp, int len,
 			 void *karg, void __user *uarg);
 
@@ -3255,6 +3565,54 @@ out_shrink:
         return rc;
 }
 
+/**
+ * Change the layout of \a obj to serve a write intent.
+ *
+ * The components of a composite layout the client is about to write to are
+ * instantiated under an EX layout lock, so the clients caching the old
+ * layout have to fetch the new one.
+ *
+ * \param[in] info	thread info
+ * \param[in] obj	file the client is writing to
+ * \param[in] layout	layout intent sent by the client
+ *
+ * \retval 0		on success
+ * \retval negative	negated errno on error
+ */
+static int mdt_layout_change(struct mdt_thread_info *info,
+			     struct mdt_object *obj,
+			     struct layout_intent *layout)
+{
+	struct mdt_lock_handle	*lh = &info->mti_lh[MDT_LH_LOCAL];
+	int			 rc;
+	ENTRY;
+
+	if (!mdt_object_exists(obj) || mdt_object_remote(obj))
+		RETURN(-ENOENT);
+
+	if (!S_ISREG(lu_object_attr(&obj->mot_obj)))
+		RETURN(-EINVAL);
+
+	if (exp_connect_flags(mdt_info_req(info)->rq_export) &
+	    OBD_CONNECT_RDONLY)
+		RETURN(-EROFS);
+
+	CDEBUG(D_INODE, "%s: layout intent %u "DFID" ["LPU64", "LPU64")\n",
+	       mdt_obd_name(info->mti_mdt), layout->li_opc,
+	       PFID(mdt_object_fid(obj)), layout->li_start, layout->li_end);
+
+	mdt_lock_reg_init(lh, LCK_EX);
+	rc = mdt_object_lock(info, obj, lh, MDS_INODELOCK_LAYOUT);
+	if (rc)
+		RETURN(rc);
+
+	rc = mo_layout_change(info->mti_env, mdt_object_child(obj), layout);
+
+	mdt_object_unlock(info, obj, lh, 1);
+
+	RETURN(rc);
+}
+
 static int mdt_intent_layout(enum mdt_it_code opcode,
 			     struct mdt_thread_info *info,
 			     struct ldlm_lock **lockp,
@@ -3278,7 +3636,14 @@ static int mdt_intent_layout(enum mdt_it_code opcode,
 	if (layout == NULL)
 		RETURN(-EPROTO);
 
-	if (layout->li_opc != LAYOUT_INTENT_ACCESS) {
+	switch (layout->li_opc) {
+	case LAYOUT_INTENT_ACCESS:
+	case LAYOUT_INTENT_WRITE:
+	case LAYOUT_INTENT_TRUNC:
+	case LAYOUT_INTENT_RESYNC:
+	case LAYOUT_INTENT_RESYNC_DONE:
+		break;
+	default:
 		CERROR("%s: Unsupported layout intent opc %d\n",
 		       mdt_obd_name(info->mti_mdt), layout->li_opc);
 		RETURN(-EINVAL);
@@ -3294,6 +3659,12 @@ static int mdt_intent_layout(enum mdt_it_code opcode,
 	if (IS_ERR(obj))
 		GOTO(out, rc = PTR_ERR(obj));
 
+	if (layout->li_opc != LAYOUT_INTENT_ACCESS) {
+		rc = mdt_layout_change(info, obj, layout);
+		if (rc)
+			GOTO(out_obj, rc);
+	}
+
 	if (mdt_object_exists(obj) && !mdt_object_remote(obj)) {
 		layout_size = mdt_attr_get_eabuf_size(info, obj);
 		if (layout_size < 0)
@@ -4246,6 +4617,8 @@ TGT_MDT_HDL(HABEO_CORPUS,		MDS_GETATTR,	mdt_getattr),
 TGT_MDT_HDL(HABEO_CORPUS| HABEO_REFERO,	MDS_GETATTR_NAME,
 							mdt_getattr_name),
 TGT_MDT_HDL(HABEO_CORPUS,		MDS_GETXATTR,	mdt_tgt_getxattr),
+TGT_MDT_HDL(HABEO_CORPUS,		MDS_BATCH_GETATTR,
+							mdt_batch_getattr),
 TGT_MDT_HDL(0		| HABEO_REFERO,	MDS_STATFS,	mdt_statfs),
 TGT_MDT_HDL(0		| MUTABOR,	MDS_REINT,	mdt_reint),
 TGT_MDT_HDL(HABEO_CORPUS,		MDS_CLOSE,	mdt_close),
@@ -4280,6 +4653,17 @@ static struct tgt_handler mdt_quota_ops[] = {
 TGT_QUOTA_HDL(HABEO_REFERO,		QUOTA_DQACQ,	  mdt_quota_dqacq),
 };
 
+#define OBD_FAIL_OST_READ_NET	OBD_FAIL_OST_BRW_NET
+#define OBD_FAIL_OST_WRITE_NET	OBD_FAIL_OST_BRW_NET
+#define OST_BRW_READ	OST_READ
+#define OST_BRW_WRITE	OST_WRITE
+
+/* bulk IO to Data-on-MDT files, accepted on MDS_IO_PORTAL only */
+static struct tgt_handler mdt_io_ops[] = {
+TGT_OST_HDL(HABEO_CORPUS | HABEO_REFERO, OST_BRW_READ,	tgt_brw_read),
+TGT_OST_HDL(HABEO_CORPUS | MUTABOR,	 OST_BRW_WRITE,	tgt_brw_write),
+};
+
 static struct tgt_opc_slice mdt_common_slice[] = {
 	{
 		.tos_opc_start	= MDS_FIRST_OPC,
@@ -4331,6 +4715,11 @@ static struct tgt_opc_slice mdt_common_slice[] = {
 		.tos_opc_end	= LFSCK_LAST_OPC,
 		.tos_hs		= tgt_lfsck_handlers
 	},
+	{
+		.tos_opc_start	= OST_FIRST_OPC,
+		.tos_opc_end	= OST_WRITE + 1,
+		.tos_hs		= mdt_io_ops
+	},
 
 	{
 		.tos_hs		= NULL
@@ -4914,6 +5303,10 @@ static int mdt_connect_internal(struct obd_export *exp,
 	LASSERT(data != NULL);
 
 	data->ocd_connect_flags &= MDT_CONNECT_SUPPORTED;
+	if (data->ocd_connect_flags & OBD_CONNECT_FLAGS2)
+		data->ocd_connect_flags2 &= MDT_CONNECT_SUPPORTED2;
+	else
+		data->ocd_connect_flags2 = 0;
 	data->ocd_ibits_known &= MDS_INODELOCK_FULL;
 
 	if (!(data->ocd_connect_flags & OBD_CONNECT_MDS_MDS) &&
@@ -5849,6 +6242,8 @@ static struct obd_ops mdt_obd_device_ops = {
         .o_destroy_export = mdt_destroy_export,
         .o_iocontrol      = mdt_iocontrol,
         .o_postrecov      = mdt_obd_postrecov,
+	.o_preprw	  = mdt_obd_preprw,
+	.o_commitrw	  = mdt_obd_commitrw,
 };
 
 static struct lu_device* mdt_device_fini(const struct lu_env *env,
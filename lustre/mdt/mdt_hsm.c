@@ -242,6 +242,34 @@ out:
 	return rc;
 }
 
+/**
+ * Check whether the caller may attach \a obj to a persistent cache with
+ * HS_PCCRO: it must be allowed to read the file and its client must have
+ * the file open for read.
+ */
+static bool mdt_hsm_pccro_allowed(struct mdt_thread_info *info,
+				  struct mdt_object *obj)
+{
+	struct mdt_export_data	*med = &info->mti_exp->exp_mdt_data;
+	struct mdt_file_data	*mfd;
+	bool			 opened = false;
+
+	if (mo_permission(info->mti_env, NULL, mdt_object_child(obj), NULL,
+			  MAY_READ) != 0)
+		return false;
+
+	spin_lock(&med->med_open_lock);
+	list_for_each_entry(mfd, &med->med_open_head, mfd_list) {
+		if (mfd->mfd_object == obj && mfd->mfd_mode & FMODE_READ) {
+			opened = true;
+			break;
+		}
+	}
+	spin_unlock(&med->med_open_lock);
+
+	return opened;
+}
+
 /**
  * Change HSM state and archive number of a file.
  *
@@ -258,6 +286,7 @@ int mdt_hsm_state_set(struct tgt_session_info *tsi)
 	struct md_attr          *ma = &info->mti_attr;
 	struct hsm_state_set	*hss;
 	struct mdt_lock_handle	*lh;
+	bool			 pccro = false;
 	int			 rc;
 	__u64			 flags;
 	ENTRY;
@@ -272,6 +301,15 @@ int mdt_hsm_state_set(struct tgt_session_info *tsi)
 	if (rc < 0)
 		GOTO(out, rc = err_serious(rc));
 
+	/* A client attaching the file to its persistent cache sets HS_PCCRO,
+	 * the next open for write or truncate clears it and revokes the
+	 * cached copies, see mdt_pccro_revoke(). Opens take the open sem
+	 * before the DLM locks. */
+	if (hss->hss_valid & HSS_SETMASK && hss->hss_setmask & HS_PCCRO) {
+		pccro = true;
+		down_write(&obj->mot_open_sem);
+	}
+
 	lh = &info->mti_lh[MDT_LH_CHILD];
 	mdt_lock_reg_init(lh, LCK_PW);
 	rc = mdt_object_lock(info, obj, lh, MDS_INODELOCK_LOOKUP |
@@ -288,15 +326,29 @@ int mdt_hsm_state_set(struct tgt_session_info *tsi)
 	}
 
 	/* Non-root users are forbidden to set or clear flags which are
-	 * NOT defined in HSM_USER_MASK. */
-	if (((hss->hss_setmask | hss->hss_clearmask) & ~HSM_USER_MASK) &&
-	    !md_capable(mdt_ucred(info), CFS_CAP_SYS_ADMIN)) {
-		CDEBUG(D_HSM, "Incompatible masks provided (set "LPX64
-		       ", clear "LPX64") vs unprivileged set (%#x).\n",
-		       hss->hss_setmask, hss->hss_clearmask, HSM_USER_MASK);
-		GOTO(out_unlock, rc = -EPERM);
+	 * NOT defined in HSM_USER_MASK, except HS_PCCRO on a file they have
+	 * open for read. */
+	if (!md_capable(mdt_ucred(info), CFS_CAP_SYS_ADMIN)) {
+		if (((hss->hss_setmask & ~HS_PCCRO) | hss->hss_clearmask) &
+		    ~HSM_USER_MASK) {
+			CDEBUG(D_HSM, "Incompatible masks provided (set "LPX64
+			       ", clear "LPX64") vs unprivileged set (%#x).\n",
+			       hss->hss_setmask, hss->hss_clearmask,
+			       HSM_USER_MASK);
+			GOTO(out_unlock, rc = -EPERM);
+		}
+
+		if (pccro && !mdt_hsm_pccro_allowed(info, obj)) {
+			CDEBUG(D_HSM, DFID" is not open for read, cannot set "
+			       "HS_PCCRO\n", PFID(mdt_object_fid(obj)));
+			GOTO(out_unlock, rc = -EPERM);
+		}
 	}
 
+	/* a copy would be stale as soon as the writers modify the file */
+	if (pccro && mdt_write_read(obj) > 0)
+		GOTO(out_unlock, rc = -EBUSY);
+
 	/* Read current HSM info */
 	ma->ma_valid = 0;
 	ma->ma_need = MA_HSM;
@@ -356,6 +408,8 @@ int mdt_hsm_state_set(struct tgt_session_info *tsi)
 out_unlock:
 	mdt_object_unlock(info, obj, lh, 1);
 out_ucred:
+	if (pccro)
+		up_write(&obj->mot_open_sem);
 	mdt_exit_ucred(info);
 out:
 	mdt_thread_info_fini(info);
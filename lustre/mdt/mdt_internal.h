@@ -698,6 +698,8 @@ void mdt_mfd_free(struct mdt_file_data *mfd);
 int mdt_close(struct tgt_session_info *tsi);
 int mdt_add_dirty_flag(struct mdt_thread_info *info, struct mdt_object *mo,
 			struct md_attr *ma);
+int mdt_pccro_revoke(struct mdt_thread_info *info, struct mdt_object *mo,
+		     struct md_attr *ma);
 int mdt_fix_reply(struct mdt_thread_info *info);
 int mdt_handle_last_unlink(struct mdt_thread_info *, struct mdt_object *,
                            const struct md_attr *);
@@ -1039,6 +1041,29 @@ void mdt_rename_counter_tally(struct mdt_thread_info *info,
 			      struct ptlrpc_request *req,
 			      struct mdt_object *src, struct mdt_object *tgt);
 
+/* mdt/mdt_io.c */
+bool mdt_dom_object(const struct lu_env *env, struct mdt_object *mo,
+		    __u32 *size);
+int mdt_dom_punch(struct mdt_thread_info *info, struct mdt_object *mo,
+		  __u64 size);
+int mdt_obd_preprw(const struct lu_env *env, int cmd, struct obd_export *exp,
+		   struct obdo *oa, int objcount, struct obd_ioobj *obj,
+		   struct niobuf_remote *rnb, int *nr_local,
+		   struct niobuf_local *lnb);
+int mdt_obd_commitrw(const struct lu_env *env, int cmd, struct obd_export *exp,
+		     struct obdo *oa, int objcount, struct obd_ioobj *obj,
+		     struct niobuf_remote *rnb, int npages,
+		     struct niobuf_local *lnb, int old_rc);
+
+/* mdt/mdt_som.c */
+int mdt_lsom_get(struct mdt_thread_info *info, struct mdt_object *obj,
+		 struct lustre_som_attrs *lsa);
+int mdt_lsom_update(struct mdt_thread_info *info, struct mdt_object *obj,
+		    __u64 size, __u64 blocks, bool truncate);
+int mdt_lsom_invalidate(struct mdt_thread_info *info, struct mdt_object *obj);
+void mdt_lsom_pack(struct mdt_thread_info *info, struct mdt_object *obj,
+		   struct mdt_body *body);
+
 static inline struct obd_device *mdt2obd_dev(const struct mdt_device *mdt)
 {
 	return mdt->mdt_lu_dev.ld_obd;
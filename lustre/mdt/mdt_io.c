@@ -0,0 +1,393 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+/*
+ * Copyright (c) 2016, Intel Corporation.
+ */
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ * Lustre is a trademark of Sun Microsystems, Inc.
+ *
+ * lustre/mdt/mdt_io.c
+ *
+ * Bulk IO to the data of files stored on the MDT (Data-on-MDT). Such files
+ * have a LOV_PATTERN_MDT layout and no OST objects, their data lives in the
+ * MDT inode itself. The OST_READ/OST_WRITE requests are received on the
+ * MDS_IO_PORTAL and handled by the common tgt_brw_read()/tgt_brw_write(),
+ * which call back into the preprw/commitrw methods below.
+ */
+
+#define DEBUG_SUBSYSTEM S_MDS
+
+#include "mdt_internal.h"
+
+/**
+ * Check whether the object keeps its data on the MDT.
+ *
+ * A DoM layout has no stripes, so it always fits into mti_xattr_buf;
+ * a layout which does not is striped over OSTs and is not DoM.
+ *
+ * \param[in] env	execution environment
+ * \param[in] mo	MDT object
+ * \param[out] size	maximum size of the DoM data, may be NULL
+ *
+ * \retval		true if \a mo is a DoM file
+ * \retval		false otherwise
+ */
+bool mdt_dom_object(const struct lu_env *env, struct mdt_object *mo,
+		    __u32 *size)
+{
+	struct mdt_thread_info	*info = mdt_th_info(env);
+	struct lu_buf		*buf = &info->mti_buf;
+	struct lov_mds_md	*lmm;
+	int			 rc;
+
+	if (!mdt_object_exists(mo) || mdt_object_remote(mo) ||
+	    !S_ISREG(lu_object_attr(&mo->mot_obj)))
+		return false;
+
+	buf->lb_buf = info->mti_xattr_buf;
+	buf->lb_len = sizeof(info->mti_xattr_buf);
+	rc = mo_xattr_get(env, mdt_object_child(mo), buf, XATTR_NAME_LOV);
+	if (rc < (int)sizeof(struct lov_mds_md_v1))
+		return false;
+
+	lmm = buf->lb_buf;
+	if (le32_to_cpu(lmm->lmm_magic) == LOV_MAGIC_COMP_V1 ||
+	    lov_pattern(le32_to_cpu(lmm->lmm_pattern)) != LOV_PATTERN_MDT)
+		return false;
+
+	if (size != NULL)
+		*size = le32_to_cpu(lmm->lmm_stripe_size);
+	return true;
+}
+
+/**
+ * Truncate the data of a DoM file.
+ *
+ * Called from setattr after the new size was stored, so the blocks beyond
+ * the new EOF are released and don't reappear if the file grows again.
+ * The caller holds the DOM ibits lock.
+ *
+ * \param[in] info	thread info
+ * \param[in] mo	MDT object
+ * \param[in] size	new file size
+ *
+ * \retval		0 on success
+ * \retval		negative value on error
+ */
+int mdt_dom_punch(struct mdt_thread_info *info, struct mdt_object *mo,
+		  __u64 size)
+{
+	struct mdt_device	*mdt = info->mti_mdt;
+	struct dt_object	*dob = mdt_obj2dt(mo);
+	struct thandle		*th;
+	int			 rc;
+
+	ENTRY;
+
+	th = dt_trans_create(info->mti_env, mdt->mdt_bottom);
+	if (IS_ERR(th))
+		RETURN(PTR_ERR(th));
+
+	rc = dt_declare_punch(info->mti_env, dob, size, OBD_OBJECT_EOF, th);
+	if (rc)
+		GOTO(stop, rc);
+
+	rc = dt_trans_start_local(info->mti_env, mdt->mdt_bottom, th);
+	if (rc)
+		GOTO(stop, rc);
+
+	dt_write_lock(info->mti_env, dob, 0);
+	rc = dt_punch(info->mti_env, dob, size, OBD_OBJECT_EOF, th);
+	dt_write_unlock(info->mti_env, dob);
+	GOTO(stop, rc);
+stop:
+	th->th_result = rc;
+	dt_trans_stop(info->mti_env, mdt->mdt_bottom, th);
+	return rc;
+}
+
+/**
+ * Find the DoM object for bulk IO and take a reference on it.
+ *
+ * The reference is dropped in mdt_obd_commitrw().
+ */
+static struct mdt_object *mdt_io_object_find(const struct lu_env *env,
+					     struct obd_export *exp,
+					     const struct lu_fid *fid,
+					     __u32 *size)
+{
+	struct mdt_device	*mdt = mdt_exp2dev(exp);
+	struct mdt_object	*mo;
+
+	mo = mdt_object_find(env, mdt, fid);
+	if (IS_ERR(mo))
+		return mo;
+
+	if (!mdt_object_exists(mo)) {
+		mdt_object_put(env, mo);
+		return ERR_PTR(-ENOENT);
+	}
+
+	if (!mdt_dom_object(env, mo, size)) {
+		CDEBUG(D_INODE, "%s: "DFID" has no data on MDT\n",
+		       mdt_obd_name(mdt), PFID(fid));
+		mdt_object_put(env, mo);
+		return ERR_PTR(-EPROTO);
+	}
+
+	return mo;
+}
+
+static int mdt_preprw_read(const struct lu_env *env, struct obd_export *exp,
+			   struct mdt_object *mo, struct lu_attr *la,
+			   int niocount, struct niobuf_remote *rnb,
+			   int *nr_local, struct niobuf_local *lnb)
+{
+	struct dt_object	*dob = mdt_obj2dt(mo);
+	int			 i, j, rc;
+
+	ENTRY;
+
+	dt_read_lock(env, dob, 0);
+	*nr_local = 0;
+	for (i = 0, j = 0; i < niocount; i++) {
+		rc = dt_bufs_get(env, dob, rnb + i, lnb + j, 0);
+		if (unlikely(rc < 0))
+			GOTO(buf_put, rc);
+		LASSERT(rc <= PTLRPC_MAX_BRW_PAGES);
+		j += rc;
+		*nr_local += rc;
+		LASSERT(j <= PTLRPC_MAX_BRW_PAGES);
+	}
+
+	LASSERT(*nr_local > 0 && *nr_local <= PTLRPC_MAX_BRW_PAGES);
+	rc = dt_attr_get(env, dob, la);
+	if (unlikely(rc))
+		GOTO(buf_put, rc);
+
+	rc = dt_read_prep(env, dob, lnb, *nr_local);
+	if (unlikely(rc))
+		GOTO(buf_put, rc);
+
+	RETURN(0);
+
+buf_put:
+	dt_bufs_put(env, dob, lnb, *nr_local);
+	dt_read_unlock(env, dob);
+	return rc;
+}
+
+static int mdt_preprw_write(const struct lu_env *env, struct obd_export *exp,
+			    struct mdt_object *mo, __u32 dom_size,
+			    int niocount, struct niobuf_remote *rnb,
+			    int *nr_local, struct niobuf_local *lnb)
+{
+	struct dt_object	*dob = mdt_obj2dt(mo);
+	int			 i, j, k, rc;
+
+	ENTRY;
+
+	/* the layout has no other component to spill the data over to */
+	for (i = 0; i < niocount; i++) {
+		if (rnb[i].rnb_offset + rnb[i].rnb_len > dom_size)
+			RETURN(-EFBIG);
+	}
+
+	dt_read_lock(env, dob, 0);
+	*nr_local = 0;
+	for (i = 0, j = 0; i < niocount; i++) {
+		rc = dt_bufs_get(env, dob, rnb + i, lnb + j, 1);
+		if (unlikely(rc < 0))
+			GOTO(err, rc);
+		LASSERT(rc <= PTLRPC_MAX_BRW_PAGES);
+		for (k = 0; k < rc; k++)
+			lnb[j + k].lnb_flags = rnb[i].rnb_flags;
+		j += rc;
+		*nr_local += rc;
+		LASSERT(j <= PTLRPC_MAX_BRW_PAGES);
+	}
+	LASSERT(*nr_local > 0 && *nr_local <= PTLRPC_MAX_BRW_PAGES);
+
+	rc = dt_write_prep(env, dob, lnb, *nr_local);
+	if (unlikely(rc != 0))
+		GOTO(err, rc);
+
+	RETURN(0);
+err:
+	dt_bufs_put(env, dob, lnb, *nr_local);
+	dt_read_unlock(env, dob);
+	return rc;
+}
+
+/**
+ * Prepare bulk IO to the data of a DoM file.
+ *
+ * This is the obd_preprw() method of the MDT, see ofd_preprw() for the
+ * description of the parameters. On success the object stays referenced
+ * and read-locked until mdt_obd_commitrw().
+ */
+int mdt_obd_preprw(const struct lu_env *env, int cmd, struct obd_export *exp,
+		   struct obdo *oa, int objcount, struct obd_ioobj *obj,
+		   struct niobuf_remote *rnb, int *nr_local,
+		   struct niobuf_local *lnb)
+{
+	struct mdt_thread_info	*info = mdt_th_info(env);
+	struct lu_attr		*la = &info->mti_attr.ma_attr;
+	const struct lu_fid	*fid = &oa->o_oi.oi_fid;
+	struct mdt_object	*mo;
+	__u32			 dom_size;
+	int			 rc;
+
+	ENTRY;
+
+	if (!exp_connect_dom(exp))
+		RETURN(-EOPNOTSUPP);
+
+	LASSERT(objcount == 1);
+	LASSERT(obj->ioo_bufcnt > 0);
+
+	mo = mdt_io_object_find(env, exp, fid, &dom_size);
+	if (IS_ERR(mo))
+		RETURN(PTR_ERR(mo));
+
+	if (cmd == OBD_BRW_WRITE) {
+		rc = mdt_preprw_write(env, exp, mo, dom_size, obj->ioo_bufcnt,
+				      rnb, nr_local, lnb);
+	} else if (cmd == OBD_BRW_READ) {
+		rc = mdt_preprw_read(env, exp, mo, la, obj->ioo_bufcnt, rnb,
+				     nr_local, lnb);
+		if (rc == 0)
+			obdo_from_la(oa, la, LA_ATIME | LA_MTIME | LA_CTIME |
+					     LA_SIZE | LA_BLOCKS);
+	} else {
+		CERROR("%s: wrong cmd %d received!\n",
+		       exp->exp_obd->obd_name, cmd);
+		rc = -EPROTO;
+	}
+
+	if (rc != 0)
+		mdt_object_put(env, mo);
+	RETURN(rc);
+}
+
+static int mdt_commitrw_write(const struct lu_env *env, struct obd_export *exp,
+			      struct mdt_object *mo, struct lu_attr *la,
+			      int niocount, struct niobuf_local *lnb)
+{
+	struct mdt_device	*mdt = mdt_exp2dev(exp);
+	struct dt_object	*dob = mdt_obj2dt(mo);
+	struct thandle		*th;
+	int			 rc;
+
+	ENTRY;
+
+	th = dt_trans_create(env, mdt->mdt_bottom);
+	if (IS_ERR(th))
+		RETURN(PTR_ERR(th));
+
+	rc = dt_declare_write_commit(env, dob, lnb, niocount, th);
+	if (rc)
+		GOTO(out_stop, rc);
+
+	if (la->la_valid) {
+		rc = dt_declare_attr_set(env, dob, la, th);
+		if (rc)
+			GOTO(out_stop, rc);
+	}
+
+	tgt_vbr_obj_set(env, dob);
+	rc = dt_trans_start(env, mdt->mdt_bottom, th);
+	if (rc)
+		GOTO(out_stop, rc);
+
+	rc = dt_write_commit(env, dob, lnb, niocount, th);
+	if (rc)
+		GOTO(out_stop, rc);
+
+	if (la->la_valid) {
+		rc = dt_attr_set(env, dob, la, th);
+		if (rc)
+			GOTO(out_stop, rc);
+	}
+
+	/* get attr to return */
+	rc = dt_attr_get(env, dob, la);
+	GOTO(out_stop, rc);
+
+out_stop:
+	th->th_result = rc;
+	dt_trans_stop(env, mdt->mdt_bottom, th);
+	return rc;
+}
+
+/**
+ * Commit bulk IO to the data of a DoM file.
+ *
+ * This is the obd_commitrw() method of the MDT, companion of
+ * mdt_obd_preprw(). It writes the buffers to the MDT inode (WRITE),
+ * releases them and drops the references taken in preprw.
+ */
+int mdt_obd_commitrw(const struct lu_env *env, int cmd, struct obd_export *exp,
+		     struct obdo *oa, int objcount, struct obd_ioobj *obj,
+		     struct niobuf_remote *rnb, int npages,
+		     struct niobuf_local *lnb, int old_rc)
+{
+	struct mdt_thread_info	*info = mdt_th_info(env);
+	struct lu_attr		*la = &info->mti_attr.ma_attr;
+	struct mdt_device	*mdt = mdt_exp2dev(exp);
+	struct mdt_object	*mo;
+	struct dt_object	*dob;
+	int			 rc = old_rc;
+
+	ENTRY;
+
+	LASSERT(npages > 0);
+
+	mo = mdt_object_find(env, mdt, &oa->o_oi.oi_fid);
+	LASSERT(!IS_ERR(mo));
+	LASSERT(mdt_object_exists(mo));
+	dob = mdt_obj2dt(mo);
+
+	if (cmd == OBD_BRW_WRITE) {
+		if (rc == 0) {
+			la_from_obdo(la, oa, OBD_MD_FLATIME | OBD_MD_FLMTIME |
+					     OBD_MD_FLCTIME);
+			rc = mdt_commitrw_write(env, exp, mo, la, npages, lnb);
+			if (rc == 0)
+				obdo_from_la(oa, la, LA_ATIME | LA_MTIME |
+						     LA_CTIME | LA_SIZE |
+						     LA_BLOCKS);
+		}
+	} else if (cmd == OBD_BRW_READ) {
+		/* nothing to commit */
+	} else {
+		LBUG();
+	}
+
+	dt_bufs_put(env, dob, lnb, npages);
+	dt_read_unlock(env, dob);
+	mdt_object_put(env, mo);
+	/* second put is pair to the find in mdt_obd_preprw() */
+	mdt_object_put(env, mo);
+	RETURN(rc);
+}
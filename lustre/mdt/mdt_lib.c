@@ -636,6 +636,12 @@ void mdt_dump_lmm(int level, const struct lov_mds_md *lmm, __u64 valid)
 	if (likely(!cfs_cdebug_show(level, DEBUG_SUBSYSTEM)))
 		return;
 
+	if (le32_to_cpu(lmm->lmm_magic) == LOV_MAGIC_COMP_V1) {
+		CDEBUG(level, "composite layout, magic 0x%08X\n",
+		       le32_to_cpu(lmm->lmm_magic));
+		return;
+	}
+
 	count = le16_to_cpu(((struct lov_user_md *)lmm)->lmm_stripe_count);
 
 	CDEBUG(level, "objid "DOSTID", magic 0x%08X, pattern %#X\n",
@@ -960,6 +966,11 @@ static int mdt_setattr_unpack_rec(struct mdt_thread_info *info)
 	else
 		ma->ma_attr_flags &= ~MDS_CLOSE_LAYOUT_SWAP;
 
+	if (rec->sa_bias & MDS_CLOSE_LSOM)
+		ma->ma_attr_flags |= MDS_CLOSE_LSOM;
+	else
+		ma->ma_attr_flags &= ~MDS_CLOSE_LSOM;
+
 	RETURN(0);
 }
 
@@ -1313,6 +1324,10 @@ static void mdt_fix_lov_magic(struct mdt_thread_info *info)
 			v1->lmm_magic = LOV_MAGIC_V3_DEF;
 		} else if (v1->lmm_magic == __swab32(LOV_USER_MAGIC_V3)) {
 			v1->lmm_magic = __swab32(LOV_MAGIC_V3_DEF);
+		} else if (v1->lmm_magic == LOV_USER_MAGIC_COMP_V1) {
+			v1->lmm_magic = LOV_MAGIC_COMP_V1_DEF;
+		} else if (v1->lmm_magic == __swab32(LOV_USER_MAGIC_COMP_V1)) {
+			v1->lmm_magic = __swab32(LOV_MAGIC_COMP_V1_DEF);
 		}
 	}
 }
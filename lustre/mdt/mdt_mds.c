@@ -59,6 +59,7 @@ struct mds_device {
 	struct md_device	 mds_md_dev;
 	struct ptlrpc_service	*mds_regular_service;
 	struct ptlrpc_service	*mds_readpage_service;
+	struct ptlrpc_service	*mds_io_service;
 	struct ptlrpc_service	*mds_out_service;
 	struct ptlrpc_service	*mds_setattr_service;
 	struct ptlrpc_service	*mds_mdsc_service;
@@ -91,6 +92,14 @@ static char *mds_rdpg_num_cpts;
 CFS_MODULE_PARM(mds_rdpg_num_cpts, "c", charp, 0444,
 		"CPU partitions MDS readpage threads should run on");
 
+static unsigned long mds_io_num_threads;
+CFS_MODULE_PARM(mds_io_num_threads, "ul", ulong, 0444,
+		"number of MDS data I/O service threads to start");
+
+static char *mds_io_num_cpts;
+CFS_MODULE_PARM(mds_io_num_cpts, "c", charp, 0444,
+		"CPU partitions MDS data I/O threads should run on");
+
 /* NB: these two should be removed along with setattr service in the future */
 static unsigned long mds_attr_num_threads;
 CFS_MODULE_PARM(mds_attr_num_threads, "ul", ulong, 0444,
@@ -114,6 +123,10 @@ static void mds_stop_ptlrpc_service(struct mds_device *m)
 		ptlrpc_unregister_service(m->mds_readpage_service);
 		m->mds_readpage_service = NULL;
 	}
+	if (m->mds_io_service != NULL) {
+		ptlrpc_unregister_service(m->mds_io_service);
+		m->mds_io_service = NULL;
+	}
 	if (m->mds_out_service != NULL) {
 		ptlrpc_unregister_service(m->mds_out_service);
 		m->mds_out_service = NULL;
@@ -236,6 +249,52 @@ static int mds_start_ptlrpc_service(struct mds_device *m)
 		GOTO(err_mds_svc, rc);
 	}
 
+	/*
+	 * bulk I/O service for the files with data on MDT, see
+	 * LOV_PATTERN_MDT. Requests are OST_READ/OST_WRITE handled by the
+	 * common target BRW code.
+	 */
+	memset(&conf, 0, sizeof(conf));
+	conf = (typeof(conf)) {
+		.psc_name		= LUSTRE_MDT_NAME "_io",
+		.psc_watchdog_factor	= MDT_SERVICE_WATCHDOG_FACTOR,
+		.psc_buf		= {
+			.bc_nbufs		= OST_NBUFS,
+			.bc_buf_size		= OST_IO_BUFSIZE,
+			.bc_req_max_size	= OST_IO_MAXREQSIZE,
+			.bc_rep_max_size	= OST_IO_MAXREPSIZE,
+			.bc_req_portal		= MDS_IO_PORTAL,
+			.bc_rep_portal		= MDC_REPLY_PORTAL,
+		},
+		.psc_thr		= {
+			.tc_thr_name		= LUSTRE_MDT_NAME "_io",
+			.tc_thr_factor		= MDS_RDPG_THR_FACTOR,
+			.tc_nthrs_init		= MDS_RDPG_NTHRS_INIT,
+			.tc_nthrs_base		= MDS_RDPG_NTHRS_BASE,
+			.tc_nthrs_max		= MDS_RDPG_NTHRS_MAX,
+			.tc_nthrs_user		= mds_io_num_threads,
+			.tc_cpu_affinity	= 1,
+			.tc_ctx_tags		= LCT_MD_THREAD | LCT_DT_THREAD,
+		},
+		.psc_cpt		= {
+			.cc_pattern		= mds_io_num_cpts,
+		},
+		.psc_ops		= {
+			.so_thr_init		= tgt_io_thread_init,
+			.so_thr_done		= tgt_io_thread_done,
+			.so_req_handler		= tgt_request_handle,
+			.so_req_printer		= target_print_req,
+		},
+	};
+	m->mds_io_service = ptlrpc_register_service(&conf, procfs_entry);
+	if (IS_ERR(m->mds_io_service)) {
+		rc = PTR_ERR(m->mds_io_service);
+		CERROR("failed to start data I/O service: %d\n", rc);
+		m->mds_io_service = NULL;
+
+		GOTO(err_mds_svc, rc);
+	}
+
 	/*
 	 * setattr service configuration.
 	 *
@@ -550,6 +609,7 @@ static int mds_health_check(const struct lu_env *env, struct obd_device *obd)
 	mutex_lock(&mds->mds_health_mutex);
 	rc |= ptlrpc_service_health_check(mds->mds_regular_service);
 	rc |= ptlrpc_service_health_check(mds->mds_readpage_service);
+	rc |= ptlrpc_service_health_check(mds->mds_io_service);
 	rc |= ptlrpc_service_health_check(mds->mds_out_service);
 	rc |= ptlrpc_service_health_check(mds->mds_setattr_service);
 	rc |= ptlrpc_service_health_check(mds->mds_mdsc_service);
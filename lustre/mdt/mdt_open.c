@@ -858,6 +858,15 @@ static int mdt_object_open_lock(struct mdt_thread_info *info,
 			atomic_read(&obj->mot_open_count), lm);
 	}
 
+	/* clients caching the file read-only lose their copy before it is
+	 * opened for write, the open sem keeps them from attaching it again
+	 * until this open is counted in mot_write_count */
+	if (open_flags & FMODE_WRITE) {
+		rc = mdt_pccro_revoke(info, obj, ma);
+		if (rc != 0)
+			GOTO(out, rc);
+	}
+
 	mdt_lock_reg_init(lhc, lm);
 
 	/* one problem to return layout lock on open is that it may result
@@ -1066,7 +1075,7 @@ static int mdt_open_by_fid_lock(struct mdt_thread_info *info,
 	mdt_set_disposition(info, rep, (DISP_IT_EXECD | DISP_LOOKUP_EXECD));
 
 	mdt_prep_ma_buf_from_rep(info, o, ma);
-	if (flags & MDS_OPEN_RELEASE)
+	if (flags & (MDS_OPEN_RELEASE | FMODE_WRITE))
 		ma->ma_need |= MA_HSM;
 	rc = mdt_attr_get_complex(info, o, ma);
 	if (rc)
@@ -1889,6 +1898,9 @@ int mdt_close_swap_layouts(struct mdt_thread_info *info,
 	if (rc < 0)
 		GOTO(out_unlock2, rc);
 
+	mdt_lsom_invalidate(info, o1);
+	mdt_lsom_invalidate(info, o2);
+
 	EXIT;
 
 out_unlock2:
@@ -1943,6 +1955,18 @@ int mdt_mfd_close(struct mdt_thread_info *info, struct mdt_file_data *mfd)
 
         mode = mfd->mfd_mode;
 
+	/* the client wrote the file, refresh the lazy size-on-MDT with the
+	 * size it knows, before a layout swap invalidates it */
+	if ((ma->ma_attr_flags & MDS_CLOSE_LSOM) && (mode & FMODE_WRITE)) {
+		rc = mdt_lsom_update(info, o, ma->ma_attr.la_size,
+				     ma->ma_attr.la_blocks, false);
+		if (rc < 0)
+			CDEBUG(D_INODE, "%s: cannot update lazy size of "DFID
+			       ": rc = %d\n", mdt_obd_name(info->mti_mdt),
+			       PFID(mdt_object_fid(o)), rc);
+		rc = 0;
+	}
+
 	if (ma->ma_attr_flags & MDS_HSM_RELEASE) {
 		rc = mdt_hsm_release(info, o, ma);
 		if (rc < 0) {
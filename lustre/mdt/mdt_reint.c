@@ -604,6 +604,8 @@ static int mdt_attr_set(struct mdt_thread_info *info, struct mdt_object *mo,
 	struct mdt_lock_handle *s0_lh = NULL;
 	struct mdt_object *s0_obj = NULL;
 	bool cos_incompat = false;
+	bool dom = false;
+	__u32 dom_size;
 	int rc;
 	ENTRY;
 
@@ -611,6 +613,16 @@ static int mdt_attr_set(struct mdt_thread_info *info, struct mdt_object *mo,
 	if (rc > 0)
 		cos_incompat = true;
 
+	/* truncate of a Data-on-MDT file also releases the data blocks, the
+	 * DOM bit keeps it from racing with bulk IO on MDS_IO_PORTAL */
+	if ((ma->ma_attr.la_valid & LA_SIZE) &&
+	    mdt_dom_object(info->mti_env, mo, &dom_size)) {
+		if (ma->ma_attr.la_size > dom_size)
+			RETURN(-EFBIG);
+		dom = true;
+		lockpart |= MDS_INODELOCK_DOM;
+	}
+
         lh = &info->mti_lh[MDT_LH_PARENT];
         mdt_lock_reg_init(lh, LCK_PW);
 
@@ -662,6 +674,12 @@ static int mdt_attr_set(struct mdt_thread_info *info, struct mdt_object *mo,
         if (rc != 0)
                 GOTO(out_unlock, rc);
 
+	if (dom) {
+		rc = mdt_dom_punch(info, mo, ma->ma_attr.la_size);
+		if (rc != 0)
+			GOTO(out_unlock, rc);
+	}
+
         EXIT;
 out_unlock:
 	mdt_unlock_slaves(info, mo, lockpart, s0_lh, s0_obj, einfo, rc);
@@ -712,6 +730,55 @@ int mdt_add_dirty_flag(struct mdt_thread_info *info, struct mdt_object *mo,
 	RETURN(rc);
 }
 
+/**
+ * Revoke the layout locks of \a mo if a client keeps a read-only copy of it
+ * in its persistent cache (HS_PCCRO), before its data can be modified. The
+ * clients drop their copy along with the layout lock.
+ *
+ * The caller holds mot_open_sem so that no client attaches the file again
+ * meanwhile, see mdt_hsm_state_set().
+ *
+ * \param[in] info	thread info
+ * \param[in] mo	file about to be written or truncated
+ * \param[in] ma	HSM attributes of \a mo if already read, or NULL
+ *
+ * \retval		0 on success
+ * \retval		negative errno on failure
+ */
+int mdt_pccro_revoke(struct mdt_thread_info *info, struct mdt_object *mo,
+		     struct md_attr *ma)
+{
+	struct mdt_lock_handle	*lh = &info->mti_lh[MDT_LH_LAYOUT];
+	int			 rc;
+	ENTRY;
+
+	if (ma == NULL) {
+		ma = &info->mti_u.hsm.attr;
+		ma->ma_need = MA_HSM;
+		rc = mdt_attr_get_complex(info, mo, ma);
+		if (rc != 0)
+			RETURN(rc);
+	}
+
+	if (!(ma->ma_valid & MA_HSM) || !(ma->ma_hsm.mh_flags & HS_PCCRO))
+		RETURN(0);
+
+	mdt_lock_handle_init(lh);
+	mdt_lock_reg_init(lh, LCK_EX);
+	rc = mdt_object_lock(info, mo, lh, MDS_INODELOCK_LAYOUT |
+			     MDS_INODELOCK_XATTR);
+	if (rc != 0)
+		RETURN(rc);
+
+	ma->ma_hsm.mh_flags &= ~HS_PCCRO;
+	rc = mdt_hsm_attr_set(info, mo, &ma->ma_hsm);
+	CDEBUG(D_HSM, "%s: revoked persistent client cache of "DFID": rc = %d\n",
+	       mdt_obd_name(info->mti_mdt), PFID(mdt_object_fid(mo)), rc);
+	mdt_object_unlock(info, mo, lh, rc);
+
+	RETURN(rc);
+}
+
 static int mdt_reint_setattr(struct mdt_thread_info *info,
                              struct mdt_lock_handle *lhc)
 {
@@ -720,6 +787,7 @@ static int mdt_reint_setattr(struct mdt_thread_info *info,
         struct ptlrpc_request   *req = mdt_info_req(info);
         struct mdt_object       *mo;
         struct mdt_body         *repbody;
+	bool			 open_sem = false;
 	int			 rc, rc2;
         ENTRY;
 
@@ -747,13 +815,36 @@ static int mdt_reint_setattr(struct mdt_thread_info *info,
 			GOTO(out_put, rc = -ETXTBSY);
 	}
 
+	/* a truncate modifies the data without opening the file, the cached
+	 * copies have to go first */
+	if (ma->ma_attr.la_valid & LA_SIZE) {
+		down_read(&mo->mot_open_sem);
+		open_sem = true;
+		rc = mdt_pccro_revoke(info, mo, NULL);
+		if (rc != 0)
+			GOTO(out_put, rc);
+	}
+
 	if ((ma->ma_valid & MA_INODE) && ma->ma_attr.la_valid) {
+		bool	truncate = ma->ma_attr.la_valid & LA_SIZE;
+		__u64	size = ma->ma_attr.la_size;
+
 		if (ma->ma_valid & MA_LOV)
 			GOTO(out_put, rc = -EPROTO);
 
 		rc = mdt_attr_set(info, mo, ma);
                 if (rc)
                         GOTO(out_put, rc);
+
+		if (truncate) {
+			rc = mdt_lsom_update(info, mo, size, 0, true);
+			if (rc < 0)
+				CDEBUG(D_INODE, "%s: cannot update lazy size of "
+				       DFID": rc = %d\n",
+				       mdt_obd_name(info->mti_mdt),
+				       PFID(rr->rr_fid1), rc);
+			rc = 0;
+		}
 	} else if ((ma->ma_valid & MA_LOV) && (ma->ma_valid & MA_INODE)) {
 		struct lu_buf *buf  = &info->mti_buf;
 
@@ -811,6 +902,8 @@ static int mdt_reint_setattr(struct mdt_thread_info *info,
 
         EXIT;
 out_put:
+	if (open_sem)
+		up_read(&mo->mot_open_sem);
         mdt_object_put(info->mti_env, mo);
 out:
         if (rc == 0)
@@ -0,0 +1,205 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+/*
+ * Copyright (c) 2016, Intel Corporation.
+ */
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ * Lustre is a trademark of Sun Microsystems, Inc.
+ *
+ * lustre/mdt/mdt_som.c
+ *
+ * Lazy Size-on-MDT. The size and blocks of a regular file striped over OSTs
+ * are only known by the OSTs, getting them means a glimpse to every object.
+ * The MDT keeps a hint of both in the XATTR_NAME_SOM xattr, refreshed when a
+ * client which wrote the file closes it and when the file is truncated, so
+ * that tools scanning many files can use it instead of glimpsing the OSTs.
+ * It is not authoritative: it lags behind the OSTs while the file is open
+ * for write, and concurrent updates are not serialized.
+ */
+
+#define DEBUG_SUBSYSTEM S_MDS
+
+#include "mdt_internal.h"
+
+/**
+ * Read the lazy size-on-MDT attributes of \a obj.
+ *
+ * \param[in] info	thread info
+ * \param[in] obj	object to read the attributes of
+ * \param[out] lsa	attributes, in host byte order
+ *
+ * \retval		0 on success
+ * \retval		-ENODATA if the object has no attributes
+ * \retval		negative errno on other errors
+ */
+int mdt_lsom_get(struct mdt_thread_info *info, struct mdt_object *obj,
+		 struct lustre_som_attrs *lsa)
+{
+	struct lu_buf	buf = {
+		.lb_buf = lsa,
+		.lb_len = sizeof(*lsa),
+	};
+	int		rc;
+
+	rc = mo_xattr_get(info->mti_env, mdt_object_child(obj), &buf,
+			  XATTR_NAME_SOM);
+	if (rc < 0)
+		return rc;
+	if (rc < sizeof(*lsa))
+		return -ENODATA;
+
+	lustre_som_swab(lsa);
+	return 0;
+}
+
+static int mdt_lsom_set(struct mdt_thread_info *info, struct mdt_object *obj,
+			__u16 valid, __u64 size, __u64 blocks)
+{
+	struct lustre_som_attrs	*lsa;
+	struct lu_buf		*buf = &info->mti_buf;
+	struct lu_ucred		*uc = mdt_ucred(info);
+	cfs_cap_t		 cap;
+	int			 rc;
+	ENTRY;
+
+	CLASSERT(sizeof(info->mti_xattr_buf) >= sizeof(*lsa));
+	lsa = (struct lustre_som_attrs *)info->mti_xattr_buf;
+	memset(lsa, 0, sizeof(*lsa));
+	lsa->lsa_valid = valid;
+	lsa->lsa_size = size;
+	lsa->lsa_blocks = blocks;
+	lustre_som_swab(lsa);
+
+	buf->lb_buf = lsa;
+	buf->lb_len = sizeof(*lsa);
+
+	/* the hint is kept on behalf of the filesystem, any writer of the
+	 * file may update it, not only its owner */
+	cap = uc->uc_cap;
+	uc->uc_cap |= 1 << CFS_CAP_FOWNER;
+	rc = mo_xattr_set(info->mti_env, mdt_object_child(obj), buf,
+			  XATTR_NAME_SOM, 0);
+	uc->uc_cap = cap;
+
+	CDEBUG(D_INODE, "%s: set lazy SOM of "DFID" valid %#x size "LPU64
+	       " blocks "LPU64": rc = %d\n", mdt_obd_name(info->mti_mdt),
+	       PFID(mdt_object_fid(obj)), valid, size, blocks, rc);
+	RETURN(rc);
+}
+
+/**
+ * Refresh the lazy size-on-MDT of \a obj.
+ *
+ * On close the client reports the size and blocks it knows, which may be
+ * older than what another client wrote meanwhile, so the hint only grows.
+ * A truncate sets the size exactly, blocks are then an upper bound.
+ *
+ * \param[in] info	thread info
+ * \param[in] obj	regular file
+ * \param[in] size	file size
+ * \param[in] blocks	allocated blocks
+ * \param[in] truncate	\a size comes from a truncate
+ *
+ * \retval		0 on success or if no update is needed
+ * \retval		negative errno on failure
+ */
+int mdt_lsom_update(struct mdt_thread_info *info, struct mdt_object *obj,
+		    __u64 size, __u64 blocks, bool truncate)
+{
+	struct lustre_som_attrs	lsa;
+	bool			valid;
+	__u32			dom_size;
+	int			rc;
+	ENTRY;
+
+	if (!mdt_object_exists(obj) || mdt_object_remote(obj) ||
+	    !S_ISREG(lu_object_attr(&obj->mot_obj)))
+		RETURN(0);
+
+	/* the MDT inode already holds the exact size of DoM files */
+	if (mdt_dom_object(info->mti_env, obj, &dom_size))
+		RETURN(0);
+
+	rc = mdt_lsom_get(info, obj, &lsa);
+	if (rc < 0 && rc != -ENODATA)
+		RETURN(rc);
+	valid = rc == 0 && (lsa.lsa_valid & SOM_FL_LAZY);
+
+	if (truncate) {
+		if (valid && lsa.lsa_size == size)
+			RETURN(0);
+		blocks = (size + 511) >> 9;
+		if (valid && lsa.lsa_blocks < blocks)
+			blocks = lsa.lsa_blocks;
+	} else if (valid) {
+		if (lsa.lsa_size >= size && lsa.lsa_blocks >= blocks)
+			RETURN(0);
+		if (lsa.lsa_size > size)
+			size = lsa.lsa_size;
+		if (lsa.lsa_blocks > blocks)
+			blocks = lsa.lsa_blocks;
+	}
+
+	rc = mdt_lsom_set(info, obj, SOM_FL_LAZY, size, blocks);
+	RETURN(rc);
+}
+
+/**
+ * Mark the lazy size-on-MDT of \a obj stale, after its layout and hence its
+ * data were replaced. The next close after a write validates it again.
+ */
+int mdt_lsom_invalidate(struct mdt_thread_info *info, struct mdt_object *obj)
+{
+	struct lustre_som_attrs	lsa;
+	int			rc;
+	ENTRY;
+
+	rc = mdt_lsom_get(info, obj, &lsa);
+	if (rc == -ENODATA)
+		RETURN(0);
+	if (rc < 0)
+		RETURN(rc);
+	if (!(lsa.lsa_valid & SOM_FL_LAZY))
+		RETURN(0);
+
+	rc = mdt_lsom_set(info, obj, SOM_FL_STALE, 0, 0);
+	RETURN(rc);
+}
+
+/**
+ * Return the lazy size-on-MDT of \a obj in \a body if it has a valid one,
+ * flagged with OBD_MD_FLLAZYSIZE and OBD_MD_FLLAZYBLOCKS.
+ */
+void mdt_lsom_pack(struct mdt_thread_info *info, struct mdt_object *obj,
+		   struct mdt_body *body)
+{
+	struct lustre_som_attrs	lsa;
+
+	if (mdt_lsom_get(info, obj, &lsa) != 0 ||
+	    !(lsa.lsa_valid & SOM_FL_LAZY))
+		return;
+
+	body->mbo_size = lsa.lsa_size;
+	body->mbo_blocks = lsa.lsa_blocks;
+	body->mbo_valid |= OBD_MD_FLLAZYSIZE | OBD_MD_FLLAZYBLOCKS;
+}
@@ -847,7 +847,6 @@ struct obd_export *class_new_export(struct obd_device *obd,
 
         export->exp_conn_cnt = 0;
         export->exp_lock_hash = NULL;
-	export->exp_flock_hash = NULL;
 	atomic_set(&export->exp_refcount, 2);
 	atomic_set(&export->exp_rpc_count, 0);
 	atomic_set(&export->exp_cb_count, 0);
@@ -874,6 +873,8 @@ struct obd_export *class_new_export(struct obd_device *obd,
 	INIT_HLIST_NODE(&export->exp_gen_hash);
 	spin_lock_init(&export->exp_bl_list_lock);
 	INIT_LIST_HEAD(&export->exp_bl_list);
+	spin_lock_init(&export->exp_reclaim_lock);
+	INIT_LIST_HEAD(&export->exp_reclaim_list);
 	INIT_LIST_HEAD(&export->exp_stale_list);
 
 	export->exp_sp_peer = LUSTRE_SP_ANY;
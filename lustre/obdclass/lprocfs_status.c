@@ -660,7 +660,20 @@ static const char *obd_connect_names[] = {
 	NULL
 };
 
-static void obd_connect_seq_flags2str(struct seq_file *m, __u64 flags, char *sep)
+static const char *obd_connect_names2[] = {
+	"batch_getattr",
+	"unknown",
+	"lock_convert",
+	"bl_batch",
+	"lock_replay_batch",
+	"dom",
+	"batch_getattr_lock",
+	"brw_compress",
+	NULL
+};
+
+static void obd_connect_seq_flags2str(struct seq_file *m, __u64 flags,
+				      __u64 flags2, char *sep)
 {
 	bool first = true;
 	__u64 mask = 1;
@@ -673,9 +686,25 @@ static void obd_connect_seq_flags2str(struct seq_file *m, __u64 flags, char *sep
 			first = false;
 		}
 	}
-	if (flags & ~(mask - 1))
+	if (flags & ~(mask - 1)) {
 		seq_printf(m, "%sunknown_"LPX64,
 			   first ? "" : sep, flags & ~(mask - 1));
+		first = false;
+	}
+
+	if (!(flags & OBD_CONNECT_FLAGS2) || flags2 == 0)
+		return;
+
+	for (i = 0, mask = 1; obd_connect_names2[i] != NULL; i++, mask <<= 1) {
+		if (flags2 & mask) {
+			seq_printf(m, "%s%s",
+				   first ? "" : sep, obd_connect_names2[i]);
+			first = false;
+		}
+	}
+	if (flags2 & ~(mask - 1))
+		seq_printf(m, "%sunknown2_"LPX64,
+			   first ? "" : sep, flags2 & ~(mask - 1));
 }
 
 int obd_connect_flags2str(char *page, int count, __u64 flags, char *sep)
@@ -709,6 +738,9 @@ static void obd_connect_data_seqprint(struct seq_file *m,
 		      "       instance: %u\n",
 		      ocd->ocd_connect_flags,
 		      ocd->ocd_instance);
+	if (flags & OBD_CONNECT_FLAGS2)
+		seq_printf(m, "       flags2: "LPX64"\n",
+			      ocd->ocd_connect_flags2);
 	if (flags & OBD_CONNECT_VERSION)
 		seq_printf(m, "       target_version: %u.%u.%u.%u\n",
 			      OBD_OCD_VERSION_MAJOR(ocd->ocd_version),
@@ -778,7 +810,8 @@ int lprocfs_import_seq_show(struct seq_file *m, void *data)
 		      obd2cli_tgt(obd),
 		      ptlrpc_import_state_name(imp->imp_state));
 	obd_connect_seq_flags2str(m, imp->imp_connect_data.ocd_connect_flags,
-					", ");
+				  imp->imp_connect_data.ocd_connect_flags2,
+				  ", ");
 	seq_printf(m, " ]\n");
 	obd_connect_data_seqprint(m, ocd);
 	seq_printf(m, "    import_flags: [ ");
@@ -983,11 +1016,15 @@ int lprocfs_connect_flags_seq_show(struct seq_file *m, void *data)
 {
 	struct obd_device *obd = data;
 	__u64 flags;
+	__u64 flags2;
 
 	LPROCFS_CLIMP_CHECK(obd);
 	flags = obd->u.cli.cl_import->imp_connect_data.ocd_connect_flags;
+	flags2 = obd->u.cli.cl_import->imp_connect_data.ocd_connect_flags2;
 	seq_printf(m, "flags="LPX64"\n", flags);
-	obd_connect_seq_flags2str(m, flags, "\n");
+	if (flags & OBD_CONNECT_FLAGS2)
+		seq_printf(m, "flags2="LPX64"\n", flags2);
+	obd_connect_seq_flags2str(m, flags, flags2, "\n");
 	seq_printf(m, "\n");
 	LPROCFS_CLIMP_EXIT(obd);
 	return 0;
@@ -258,6 +258,49 @@ int lprocfs_exp_replydata_seq_show(struct seq_file *m, void *data)
 }
 LPROC_SEQ_FOPS_RO(lprocfs_exp_replydata);
 
+static void lprocfs_exp_hist_show(struct seq_file *m, const char *name,
+				  struct obd_histogram *oh)
+{
+	unsigned long sum = lprocfs_oh_sum(oh);
+	unsigned long cum = 0;
+	unsigned long n;
+	int i;
+
+	seq_printf(m, "%-16s %10s %4s %6s\n", name, "locks", "%", "cum %");
+	for (i = 0; i < OBD_HIST_MAX && cum < sum; i++) {
+		n = oh->oh_buckets[i];
+		cum += n;
+		seq_printf(m, "<= %-13lu %10lu %4lu %6lu\n", 1UL << i, n,
+			   n * 100 / sum, cum * 100 / sum);
+	}
+}
+
+/* Lock wait profile of the client, in usec. */
+static int lprocfs_exp_lock_wait_seq_show(struct seq_file *m, void *data)
+{
+	struct nid_stat *stats = m->private;
+
+	lprocfs_exp_hist_show(m, "bl_ast_usec", &stats->nid_bl_ast_hist);
+	seq_printf(m, "\n");
+	lprocfs_exp_hist_show(m, "lock_wait_usec",
+			      &stats->nid_lock_wait_hist);
+	return 0;
+}
+
+/* Any write clears the histograms. */
+static ssize_t
+lprocfs_exp_lock_wait_seq_write(struct file *file, const char __user *buffer,
+				size_t count, loff_t *off)
+{
+	struct nid_stat *stats = ((struct seq_file *)
+				  file->private_data)->private;
+
+	lprocfs_oh_clear(&stats->nid_bl_ast_hist);
+	lprocfs_oh_clear(&stats->nid_lock_wait_hist);
+	return count;
+}
+LPROC_SEQ_FOPS(lprocfs_exp_lock_wait);
+
 int lprocfs_nid_stats_clear_seq_show(struct seq_file *m, void *data)
 {
 	return seq_printf(m, "%s\n", "Write into this file to clear all nid "
@@ -281,6 +324,8 @@ static int lprocfs_nid_stats_clear_write_cb(void *obj, void *data)
 	/* we has reference to object - only clear data*/
 	if (stat->nid_stats)
 		lprocfs_clear_stats(stat->nid_stats);
+	lprocfs_oh_clear(&stat->nid_bl_ast_hist);
+	lprocfs_oh_clear(&stat->nid_lock_wait_hist);
 
 	RETURN(0);
 }
@@ -346,6 +391,8 @@ int lprocfs_exp_setup(struct obd_export *exp, lnet_nid_t *nid)
 
 	new_stat->nid     = *nid;
 	new_stat->nid_obd = exp->exp_obd;
+	spin_lock_init(&new_stat->nid_bl_ast_hist.oh_lock);
+	spin_lock_init(&new_stat->nid_lock_wait_hist.oh_lock);
 	/* we need set default refcount to 1 to balance obd_disconnect */
 	atomic_set(&new_stat->nid_exp_ref_count, 1);
 
@@ -412,6 +459,15 @@ int lprocfs_exp_setup(struct obd_export *exp, lnet_nid_t *nid)
 		GOTO(destroy_new_ns, rc);
 	}
 
+	entry = lprocfs_add_simple(new_stat->nid_proc, "lock_wait_stats",
+				   new_stat, &lprocfs_exp_lock_wait_fops);
+	if (IS_ERR(entry)) {
+		rc = PTR_ERR(entry);
+		CWARN("%s: Error adding the lock_wait_stats file: rc = %d\n",
+		      obd->obd_name, rc);
+		GOTO(destroy_new_ns, rc);
+	}
+
 	spin_lock(&exp->exp_lock);
 	exp->exp_nid_stats = new_stat;
 	spin_unlock(&exp->exp_lock);
@@ -561,6 +617,25 @@ int lprocfs_hash_seq_show(struct seq_file *m, void *data)
 }
 EXPORT_SYMBOL(lprocfs_hash_seq_show);
 
+/* Locks replayed so far and the lock replay rate in locks per second, the
+ * stage is still running if it has not recorded its end time yet. */
+static void lprocfs_lock_replay_show(struct seq_file *m, struct obd_device *obd)
+{
+	time_t end = obd->obd_lock_replay_end;
+	__u64 rate;
+
+	seq_printf(m, "replayed_locks: "LPU64"\n",
+		   obd->obd_replayed_lock_count);
+	if (obd->obd_lock_replay_start == 0)
+		return;
+
+	if (end < obd->obd_lock_replay_start)
+		end = cfs_time_current_sec();
+	rate = div64_u64(obd->obd_replayed_lock_count,
+			 max_t(__u64, end - obd->obd_lock_replay_start, 1));
+	seq_printf(m, "lock_replay_rate: "LPU64"\n", rate);
+}
+
 int lprocfs_recovery_status_seq_show(struct seq_file *m, void *data)
 {
 	struct obd_device *obd = m->private;
@@ -586,6 +661,7 @@ int lprocfs_recovery_status_seq_show(struct seq_file *m, void *data)
 			   obd->obd_max_recoverable_clients);
 		seq_printf(m, "replayed_requests: %d\n",
 			   obd->obd_replayed_requests);
+		lprocfs_lock_replay_show(m, obd);
 		seq_printf(m, "last_transno: "LPD64"\n",
 			   obd->obd_next_recovery_transno - 1);
 		seq_printf(m, "VBR: %s\n", obd->obd_version_recov ?
@@ -617,6 +693,7 @@ int lprocfs_recovery_status_seq_show(struct seq_file *m, void *data)
 		   atomic_read(&obd->obd_lock_replay_clients));
 	seq_printf(m, "evicted_clients: %d\n", obd->obd_stale_clients);
 	seq_printf(m, "replayed_requests: %d\n", obd->obd_replayed_requests);
+	lprocfs_lock_replay_show(m, obd);
 	seq_printf(m, "queued_requests: %d\n",
 		   obd->obd_requests_queued_for_recovery);
 	seq_printf(m, "next_transno: "LPD64"\n",
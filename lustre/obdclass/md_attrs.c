@@ -89,6 +89,23 @@ void lustre_hsm_swab(struct hsm_attrs *attrs)
 	}
 };
 
+/**
+ * Swab, if needed, lazy size-on-MDT structure which is stored on-disk in
+ * little-endian order.
+ *
+ * \param attrs - is a pointer to the SOM structure to be swabbed.
+ */
+void lustre_som_swab(struct lustre_som_attrs *attrs)
+{
+	/* Use LUSTRE_MSG_MAGIC to detect local endianess. */
+	if (LUSTRE_MSG_MAGIC != cpu_to_le32(LUSTRE_MSG_MAGIC)) {
+		__swab16s(&attrs->lsa_valid);
+		__swab64s(&attrs->lsa_size);
+		__swab64s(&attrs->lsa_blocks);
+	}
+}
+EXPORT_SYMBOL(lustre_som_swab);
+
 /*
  * Swab and extract HSM attributes from on-disk xattr.
  *
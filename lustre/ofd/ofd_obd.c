@@ -164,6 +164,12 @@ static int ofd_parse_connect_data(const struct lu_env *env,
 	fed->fed_group = data->ocd_group;
 
 	data->ocd_connect_flags &= OST_CONNECT_SUPPORTED;
+	if (data->ocd_connect_flags & OBD_CONNECT_FLAGS2)
+		data->ocd_connect_flags2 &= OST_CONNECT_SUPPORTED2;
+	else
+		data->ocd_connect_flags2 = 0;
+	if (!ptlrpc_bulk_compress_available())
+		data->ocd_connect_flags2 &= ~OBD_CONNECT2_BRW_COMPRESS;
 	data->ocd_version = LUSTRE_VERSION_CODE;
 
 	/* Kindly make sure the SKIP_ORPHAN flag is from MDS. */
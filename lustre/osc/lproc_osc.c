@@ -185,7 +185,7 @@ static int osc_cached_mb_seq_show(struct seq_file *m, void *v)
 		      "used_mb: %ld\n"
 		      "busy_cnt: %ld\n"
 		      "reclaim: "LPU64"\n",
-		      (atomic_long_read(&cli->cl_lru_in_list) +
+		      (osc_lru_in_list(cli) +
 		       atomic_long_read(&cli->cl_lru_busy)) >> shift,
 		      atomic_long_read(&cli->cl_lru_busy),
 		      cli->cl_lru_reclaim);
@@ -228,7 +228,7 @@ osc_cached_mb_seq_write(struct file *file, const char __user *buffer,
 	if (pages_number < 0)
 		return -ERANGE;
 
-	rc = atomic_long_read(&cli->cl_lru_in_list) - pages_number;
+	rc = osc_lru_in_list(cli) - pages_number;
 	if (rc > 0) {
 		struct lu_env *env;
 		__u16 refcheck;
@@ -787,6 +787,26 @@ static ssize_t osc_rpc_stats_seq_write(struct file *file,
 }
 LPROC_SEQ_FOPS(osc_rpc_stats);
 
+/* data bytes per 100 bytes sent of the compressed bulks */
+static unsigned int osc_compress_ratio(struct osc_stats *stats)
+{
+	__u64 bytes = stats->os_compr_write_bytes + stats->os_compr_read_bytes;
+	__u64 cbytes = stats->os_compr_write_cbytes +
+		       stats->os_compr_read_cbytes;
+
+	/* ratios are reported in percent, scale the divisor to fit 32 bits */
+	if (cbytes == 0)
+		return 0;
+	while (cbytes >> 32) {
+		cbytes >>= 1;
+		bytes >>= 1;
+	}
+	bytes *= 100;
+	do_div(bytes, (__u32)cbytes);
+
+	return bytes;
+}
+
 static int osc_stats_seq_show(struct seq_file *seq, void *v)
 {
 	struct timeval now;
@@ -803,6 +823,12 @@ static int osc_stats_seq_show(struct seq_file *seq, void *v)
 		   stats->os_lockless_reads);
 	seq_printf(seq, "lockless_truncate\t\t"LPU64"\n",
 		   stats->os_lockless_truncates);
+	seq_printf(seq, "compressed_write_bytes\t\t"LPU64" "LPU64"\n",
+		   stats->os_compr_write_bytes, stats->os_compr_write_cbytes);
+	seq_printf(seq, "compressed_read_bytes\t\t"LPU64" "LPU64"\n",
+		   stats->os_compr_read_bytes, stats->os_compr_read_cbytes);
+	seq_printf(seq, "compression_ratio\t\t%u%%\n",
+		   osc_compress_ratio(stats));
 	return 0;
 }
 
@@ -1360,16 +1360,15 @@ static int osc_completion(const struct lu_env *env, struct osc_async_page *oap,
 	CDEBUG(lvl, "%s: grant { dirty: %ld/%ld dirty_pages: %ld/%lu "	\
 	       "dropped: %ld avail: %ld, dirty_grant: %ld, "		\
 	       "reserved: %ld, flight: %d } lru {in list: %ld, "	\
-	       "left: %ld, waiters: %d }" fmt "\n",			\
+	       "busy: %ld }" fmt "\n",					\
 	       cli_name(__tmp),						\
 	       __tmp->cl_dirty_pages, __tmp->cl_dirty_max_pages,	\
 	       atomic_long_read(&obd_dirty_pages), obd_max_dirty_pages,	\
 	       __tmp->cl_lost_grant, __tmp->cl_avail_grant,		\
 	       __tmp->cl_dirty_grant,					\
 	       __tmp->cl_reserved_grant, __tmp->cl_w_in_flight,		\
-	       atomic_long_read(&__tmp->cl_lru_in_list),		\
-	       atomic_long_read(&__tmp->cl_lru_busy),			\
-	       atomic_read(&__tmp->cl_lru_shrinkers), ##args);		\
+	       osc_lru_in_list(__tmp),					\
+	       atomic_long_read(&__tmp->cl_lru_busy), ##args);		\
 } while (0)
 
 /* caller must hold loi_list_lock */
@@ -365,6 +365,11 @@ struct osc_page {
 	 * lru page list. See osc_lru_{del|use}() in osc_page.c for usage.
 	 */
 	struct list_head	ops_lru;
+	/**
+	 * CPT of the LRU sublist the page is accounted to, see
+	 * struct cl_lru_sublist.
+	 */
+	int			ops_lru_cpt;
 	/**
 	 * Submit time - the time when the page is starting RPC. For debugging.
 	 */
@@ -133,6 +133,9 @@ int osc_sync_base(struct osc_object *obj, struct obdo *oa,
 int osc_process_config_base(struct obd_device *obd, struct lustre_cfg *cfg);
 int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 		  struct list_head *ext_list, int cmd);
+int osc_lru_setup(struct client_obd *cli);
+void osc_lru_cleanup(struct client_obd *cli);
+long osc_lru_in_list(struct client_obd *cli);
 long osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
 		   long target, bool force);
 unsigned long osc_lru_reserve(struct client_obd *cli, unsigned long npages);
@@ -141,6 +144,7 @@ void osc_lru_unreserve(struct client_obd *cli, unsigned long npages);
 extern struct lu_kmem_descr osc_caches[];
 
 unsigned long osc_ldlm_weigh_ast(struct ldlm_lock *dlmlock);
+unsigned long osc_ldlm_cost(struct ldlm_lock *dlmlock, unsigned long *dirty);
 
 int osc_cleanup(struct obd_device *obd);
 int osc_setup(struct obd_device *obd, struct lustre_cfg *lcfg);
@@ -184,6 +188,10 @@ struct osc_device {
                 uint64_t     os_lockless_writes;          /* by bytes */
                 uint64_t     os_lockless_reads;           /* by bytes */
                 uint64_t     os_lockless_truncates;       /* by times */
+                uint64_t     os_compr_write_bytes;        /* data bytes */
+                uint64_t     os_compr_write_cbytes;       /* wire bytes */
+                uint64_t     os_compr_read_bytes;         /* data bytes */
+                uint64_t     os_compr_read_cbytes;        /* wire bytes */
         } od_stats;
 
         /* configuration item(s) */
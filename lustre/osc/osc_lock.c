@@ -740,6 +740,40 @@ out:
 	return weight;
 }
 
+/**
+ * Get the number of cached and dirty pages a dlm lock protects, for the cost
+ * aware LRU. This is an estimate from the counters of the object, pages are
+ * not looked up.
+ */
+unsigned long osc_ldlm_cost(struct ldlm_lock *dlmlock, unsigned long *dirty)
+{
+	struct ldlm_extent	*extent = &dlmlock->l_policy_data.l_extent;
+	struct osc_object	*obj;
+	unsigned long		 pages = 0;
+	__u64			 span;
+
+	*dirty = 0;
+	if (dlmlock->l_resource->lr_type != LDLM_EXTENT)
+		return 0;
+
+	lock_res_and_lock(dlmlock);
+	obj = dlmlock->l_ast_data;
+	if (obj != NULL) {
+		pages = obj->oo_npages;
+		*dirty = atomic_read(&obj->oo_nr_writes);
+	}
+	unlock_res_and_lock(dlmlock);
+
+	/* the lock cannot protect more pages than it covers */
+	span = ((extent->end - extent->start) >> PAGE_CACHE_SHIFT) + 1;
+	if (span < pages)
+		pages = span;
+	if (*dirty > pages)
+		*dirty = pages;
+
+	return pages;
+}
+
 static void osc_lock_build_einfo(const struct lu_env *env,
 				 const struct cl_lock *lock,
 				 struct osc_object *osc,
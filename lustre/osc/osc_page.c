@@ -467,6 +467,120 @@ void osc_page_submit(const struct lu_env *env, struct osc_page *opg,
 
 static DECLARE_WAIT_QUEUE_HEAD(osc_lru_waitq);
 
+/**
+ * LRU slots freed by osc_lru_del() are kept in the sublist of the page and
+ * returned to client_obd::cl_lru_left once this many have been accumulated,
+ * so that freeing pages doesn't hit the shared counter for each page.
+ */
+#define OSC_LRU_LEFT_BATCH	32
+
+/**
+ * Allocate the per-CPT LRU sublists of \a cli.
+ */
+int osc_lru_setup(struct client_obd *cli)
+{
+	struct cl_lru_sublist *cls;
+	int i;
+
+	cli->cl_lru = cfs_percpt_alloc(cfs_cpt_table, sizeof(*cls));
+	if (cli->cl_lru == NULL)
+		return -ENOMEM;
+
+	cfs_percpt_for_each(cls, i, cli->cl_lru) {
+		spin_lock_init(&cls->cls_lock);
+		INIT_LIST_HEAD(&cls->cls_list);
+		cls->cls_in_list = 0;
+		cls->cls_left = 0;
+		atomic_set(&cls->cls_shrinkers, 0);
+	}
+	return 0;
+}
+
+/**
+ * Return the number of pages in the LRU of \a cli. The sublists are read
+ * without their locks so the result is approximate.
+ */
+long osc_lru_in_list(struct client_obd *cli)
+{
+	struct cl_lru_sublist *cls;
+	long count = 0;
+	int i;
+
+	if (cli->cl_lru == NULL)
+		return 0;
+
+	cfs_percpt_for_each(cls, i, cli->cl_lru)
+		count += cls->cls_in_list;
+	return count;
+}
+
+/**
+ * Return the LRU slots kept in the sublists of \a cli to cl_lru_left.
+ */
+static long osc_lru_flush_left(struct client_obd *cli)
+{
+	struct cl_lru_sublist *cls;
+	long left = 0;
+	int i;
+
+	if (cli->cl_lru == NULL || cli->cl_lru_left == NULL)
+		return 0;
+
+	cfs_percpt_for_each(cls, i, cli->cl_lru) {
+		if (cls->cls_left == 0)
+			continue;
+
+		spin_lock(&cls->cls_lock);
+		left += cls->cls_left;
+		cls->cls_left = 0;
+		spin_unlock(&cls->cls_lock);
+	}
+
+	if (left > 0)
+		atomic_long_add(left, cli->cl_lru_left);
+	return left;
+}
+
+/**
+ * Free the LRU sublists of \a cli, returning their cached slots.
+ */
+void osc_lru_cleanup(struct client_obd *cli)
+{
+	struct cl_lru_sublist *cls;
+	int i;
+
+	if (cli->cl_lru == NULL)
+		return;
+
+	osc_lru_flush_left(cli);
+	cfs_percpt_for_each(cls, i, cli->cl_lru)
+		LASSERT(list_empty(&cls->cls_list));
+
+	cfs_percpt_free(cli->cl_lru);
+	cli->cl_lru = NULL;
+}
+
+/**
+ * Check if any thread waits for LRU slots. The barrier pairs with the one
+ * l_wait_event() implies between queueing the waiter and checking for free
+ * slots, so that either the waiter sees the freed slot or we see the waiter.
+ */
+static inline bool osc_lru_waiters(void)
+{
+	smp_mb();
+	return waitqueue_active(&osc_lru_waitq);
+}
+
+/**
+ * Check if there are LRU slots left for \a cli, returning the slots cached
+ * in its sublists first.
+ */
+static inline bool osc_lru_has_left(struct client_obd *cli)
+{
+	osc_lru_flush_left(cli);
+	return atomic_long_read(cli->cl_lru_left) > 0;
+}
+
 /**
  * LRU pages are freed in batch mode. OSC should at least free this
  * number of pages to avoid running out of LRU slots.
@@ -494,7 +608,7 @@ static inline int lru_shrink_max(struct client_obd *cli)
 static int osc_cache_too_much(struct client_obd *cli)
 {
 	struct cl_client_cache *cache = cli->cl_cache;
-	long pages = atomic_long_read(&cli->cl_lru_in_list);
+	long pages = osc_lru_in_list(cli);
 	unsigned long budget;
 
 	LASSERT(cache != NULL);
@@ -539,12 +653,19 @@ int lru_queue_work(const struct lu_env *env, void *data)
 	RETURN(0);
 }
 
+/**
+ * Add the pages of \a plist which finished their transfer to the LRU. They
+ * go to the sublist of the current CPT.
+ */
 void osc_lru_add_batch(struct client_obd *cli, struct list_head *plist)
 {
 	struct list_head lru = LIST_HEAD_INIT(lru);
+	struct cl_lru_sublist *cls;
 	struct osc_async_page *oap;
 	long npages = 0;
+	int cpt;
 
+	cpt = cfs_cpt_current(cfs_cpt_table, 1);
 	list_for_each_entry(oap, plist, oap_pending_item) {
 		struct osc_page *opg = oap2osc_page(oap);
 
@@ -553,27 +674,30 @@ void osc_lru_add_batch(struct client_obd *cli, struct list_head *plist)
 
 		++npages;
 		LASSERT(list_empty(&opg->ops_lru));
+		opg->ops_lru_cpt = cpt;
 		list_add(&opg->ops_lru, &lru);
 	}
 
 	if (npages > 0) {
-		spin_lock(&cli->cl_lru_list_lock);
-		list_splice_tail(&lru, &cli->cl_lru_list);
+		cls = cli->cl_lru[cpt];
+		spin_lock(&cls->cls_lock);
+		list_splice_tail(&lru, &cls->cls_list);
+		cls->cls_in_list += npages;
+		spin_unlock(&cls->cls_lock);
+
 		atomic_long_sub(npages, &cli->cl_lru_busy);
-		atomic_long_add(npages, &cli->cl_lru_in_list);
 		cli->cl_lru_last_used = cfs_time_current_sec();
-		spin_unlock(&cli->cl_lru_list_lock);
 
 		if (waitqueue_active(&osc_lru_waitq))
 			(void)ptlrpcd_queue_work(cli->cl_lru_work);
 	}
 }
 
-static void __osc_lru_del(struct client_obd *cli, struct osc_page *opg)
+static void __osc_lru_del(struct cl_lru_sublist *cls, struct osc_page *opg)
 {
-	LASSERT(atomic_long_read(&cli->cl_lru_in_list) > 0);
+	LASSERT(cls->cls_in_list > 0);
 	list_del_init(&opg->ops_lru);
-	atomic_long_dec(&cli->cl_lru_in_list);
+	cls->cls_in_list--;
 }
 
 /**
@@ -583,16 +707,29 @@ static void __osc_lru_del(struct client_obd *cli, struct osc_page *opg)
 static void osc_lru_del(struct client_obd *cli, struct osc_page *opg)
 {
 	if (opg->ops_in_lru) {
-		spin_lock(&cli->cl_lru_list_lock);
+		struct cl_lru_sublist *cls = cli->cl_lru[opg->ops_lru_cpt];
+		long left = 0;
+
+		spin_lock(&cls->cls_lock);
 		if (!list_empty(&opg->ops_lru)) {
-			__osc_lru_del(cli, opg);
+			__osc_lru_del(cls, opg);
 		} else {
 			LASSERT(atomic_long_read(&cli->cl_lru_busy) > 0);
 			atomic_long_dec(&cli->cl_lru_busy);
 		}
-		spin_unlock(&cli->cl_lru_list_lock);
+		/* return the freed slots in batches, unless someone is
+		 * waiting for them */
+		if (++cls->cls_left >= OSC_LRU_LEFT_BATCH ||
+		    osc_lru_waiters()) {
+			left = cls->cls_left;
+			cls->cls_left = 0;
+		}
+		spin_unlock(&cls->cls_lock);
 
-		atomic_long_inc(cli->cl_lru_left);
+		if (left == 0)
+			return;
+
+		atomic_long_add(left, cli->cl_lru_left);
 		/* this is a great place to release more LRU pages if
 		 * this osc occupies too many LRU pages and kernel is
 		 * stealing one of them. */
@@ -614,9 +751,11 @@ static void osc_lru_use(struct client_obd *cli, struct osc_page *opg)
 	/* If page is being transferred for the first time,
 	 * ops_lru should be empty */
 	if (opg->ops_in_lru && !list_empty(&opg->ops_lru)) {
-		spin_lock(&cli->cl_lru_list_lock);
-		__osc_lru_del(cli, opg);
-		spin_unlock(&cli->cl_lru_list_lock);
+		struct cl_lru_sublist *cls = cli->cl_lru[opg->ops_lru_cpt];
+
+		spin_lock(&cls->cls_lock);
+		__osc_lru_del(cls, opg);
+		spin_unlock(&cls->cls_lock);
 		atomic_long_inc(&cli->cl_lru_busy);
 	}
 }
@@ -662,10 +801,12 @@ static inline bool lru_page_busy(struct client_obd *cli, struct cl_page *page)
 }
 
 /**
- * Drop @target of pages from LRU at most.
+ * Drop @target of pages from the LRU sublist \a cls at most.
  */
-long osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
-		   long target, bool force)
+static long osc_lru_shrink_one(const struct lu_env *env,
+			       struct client_obd *cli,
+			       struct cl_lru_sublist *cls,
+			       long target, bool force)
 {
 	struct cl_io *io;
 	struct cl_object *clobj = NULL;
@@ -677,46 +818,37 @@ long osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
 	int rc = 0;
 	ENTRY;
 
-	LASSERT(atomic_long_read(&cli->cl_lru_in_list) >= 0);
-	if (atomic_long_read(&cli->cl_lru_in_list) == 0 || target <= 0)
-		RETURN(0);
-
-	CDEBUG(D_CACHE, "%s: shrinkers: %d, force: %d\n",
-	       cli_name(cli), atomic_read(&cli->cl_lru_shrinkers), force);
 	if (!force) {
-		if (atomic_read(&cli->cl_lru_shrinkers) > 0)
+		if (atomic_read(&cls->cls_shrinkers) > 0)
 			RETURN(-EBUSY);
 
-		if (atomic_inc_return(&cli->cl_lru_shrinkers) > 1) {
-			atomic_dec(&cli->cl_lru_shrinkers);
+		if (atomic_inc_return(&cls->cls_shrinkers) > 1) {
+			atomic_dec(&cls->cls_shrinkers);
 			RETURN(-EBUSY);
 		}
 	} else {
-		atomic_inc(&cli->cl_lru_shrinkers);
+		atomic_inc(&cls->cls_shrinkers);
 	}
 
 	pvec = (struct cl_page **)osc_env_info(env)->oti_pvec;
 	io = &osc_env_info(env)->oti_io;
 
-	spin_lock(&cli->cl_lru_list_lock);
-	if (force)
-		cli->cl_lru_reclaim++;
-	maxscan = min(target << 1, atomic_long_read(&cli->cl_lru_in_list));
-	while (!list_empty(&cli->cl_lru_list)) {
+	spin_lock(&cls->cls_lock);
+	maxscan = min(target << 1, cls->cls_in_list);
+	while (!list_empty(&cls->cls_list)) {
 		struct cl_page *page;
 		bool will_free = false;
 
-		if (!force && atomic_read(&cli->cl_lru_shrinkers) > 1)
+		if (!force && atomic_read(&cls->cls_shrinkers) > 1)
 			break;
 
 		if (--maxscan < 0)
 			break;
 
-		opg = list_entry(cli->cl_lru_list.next, struct osc_page,
-				 ops_lru);
+		opg = list_entry(cls->cls_list.next, struct osc_page, ops_lru);
 		page = opg->ops_cl.cpl_page;
 		if (lru_page_busy(cli, page)) {
-			list_move_tail(&opg->ops_lru, &cli->cl_lru_list);
+			list_move_tail(&opg->ops_lru, &cls->cls_list);
 			continue;
 		}
 
@@ -725,7 +857,7 @@ long osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
 			struct cl_object *tmp = page->cp_obj;
 
 			cl_object_get(tmp);
-			spin_unlock(&cli->cl_lru_list_lock);
+			spin_unlock(&cls->cls_lock);
 
 			if (clobj != NULL) {
 				discard_pagevec(env, io, pvec, index);
@@ -741,7 +873,7 @@ long osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
 			io->ci_ignore_layout = 1;
 			rc = cl_io_init(env, io, CIT_MISC, clobj);
 
-			spin_lock(&cli->cl_lru_list_lock);
+			spin_lock(&cls->cls_lock);
 
 			if (rc != 0)
 				break;
@@ -754,7 +886,7 @@ long osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
 			if (!lru_page_busy(cli, page)) {
 				/* remove it from lru list earlier to avoid
 				 * lock contention */
-				__osc_lru_del(cli, opg);
+				__osc_lru_del(cls, opg);
 				opg->ops_in_lru = 0; /* will be discarded */
 
 				cl_page_get(page);
@@ -765,24 +897,24 @@ long osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
 		}
 
 		if (!will_free) {
-			list_move_tail(&opg->ops_lru, &cli->cl_lru_list);
+			list_move_tail(&opg->ops_lru, &cls->cls_list);
 			continue;
 		}
 
-		/* Don't discard and free the page with cl_lru_list held */
+		/* Don't discard and free the page with cls_lock held */
 		pvec[index++] = page;
 		if (unlikely(index == OTI_PVEC_SIZE)) {
-			spin_unlock(&cli->cl_lru_list_lock);
+			spin_unlock(&cls->cls_lock);
 			discard_pagevec(env, io, pvec, index);
 			index = 0;
 
-			spin_lock(&cli->cl_lru_list_lock);
+			spin_lock(&cls->cls_lock);
 		}
 
 		if (++count >= target)
 			break;
 	}
-	spin_unlock(&cli->cl_lru_list_lock);
+	spin_unlock(&cls->cls_lock);
 
 	if (clobj != NULL) {
 		discard_pagevec(env, io, pvec, index);
@@ -791,7 +923,50 @@ long osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
 		cl_object_put(env, clobj);
 	}
 
-	atomic_dec(&cli->cl_lru_shrinkers);
+	atomic_dec(&cls->cls_shrinkers);
+	RETURN(count > 0 ? count : rc);
+}
+
+/**
+ * Drop @target of pages from LRU at most.
+ *
+ * The sublists are scanned starting from the one of the current CPT. Unless
+ * \a force is set, a sublist being shrunk by another thread is skipped, so
+ * that threads running on different CPTs shrink the LRU in parallel.
+ */
+long osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
+		   long target, bool force)
+{
+	struct cl_lru_sublist *cls;
+	long count = 0;
+	long rc = 0;
+	int ncpt;
+	int cpt;
+	int i;
+	ENTRY;
+
+	if (target <= 0 || osc_lru_in_list(cli) == 0)
+		RETURN(0);
+
+	CDEBUG(D_CACHE, "%s: shrink %ld pages, force: %d\n",
+	       cli_name(cli), target, force);
+	if (force)
+		cli->cl_lru_reclaim++;
+
+	ncpt = cfs_percpt_number(cli->cl_lru);
+	cpt = cfs_cpt_current(cfs_cpt_table, 1);
+	for (i = 0; i < ncpt && count < target; i++) {
+		cls = cli->cl_lru[(cpt + i) % ncpt];
+		if (cls->cls_in_list == 0)
+			continue;
+
+		rc = osc_lru_shrink_one(env, cli, cls, target - count, force);
+		if (rc > 0)
+			count += rc;
+		else if (rc < 0 && rc != -EBUSY)
+			break;
+	}
+
 	if (count > 0) {
 		atomic_long_add(count, cli->cl_lru_left);
 		wake_up_all(&osc_lru_waitq);
@@ -811,14 +986,21 @@ static long osc_lru_reclaim(struct client_obd *cli, unsigned long npages)
 	struct lu_env *env;
 	struct cl_client_cache *cache = cli->cl_cache;
 	int max_scans;
+	long left;
 	long rc = 0;
 	ENTRY;
 
 	LASSERT(cache != NULL);
 
+	/* slots freed by this OSC may not have been given back yet */
+	left = osc_lru_flush_left(cli);
+	if (left >= npages)
+		RETURN(left);
+	npages -= left;
+
 	env = cl_env_nested_get(&nest);
 	if (IS_ERR(env))
-		RETURN(rc);
+		RETURN(left);
 
 	npages = max_t(int, npages, cli->cl_max_pages_per_rpc);
 	CDEBUG(D_CACHE, "%s: start to reclaim %ld pages from LRU\n",
@@ -835,7 +1017,7 @@ static long osc_lru_reclaim(struct client_obd *cli, unsigned long npages)
 	}
 
 	CDEBUG(D_CACHE, "%s: cli %p no free slots, pages: %ld/%ld, want: %ld\n",
-		cli_name(cli), cli, atomic_long_read(&cli->cl_lru_in_list),
+		cli_name(cli), cli, osc_lru_in_list(cli),
 		atomic_long_read(&cli->cl_lru_busy), npages);
 
 	/* Reclaim LRU slots from other client_obd as it can't free enough
@@ -853,10 +1035,11 @@ static long osc_lru_reclaim(struct client_obd *cli, unsigned long npages)
 
 		CDEBUG(D_CACHE, "%s: cli %p LRU pages: %ld, busy: %ld.\n",
 			cli_name(cli), cli,
-			atomic_long_read(&cli->cl_lru_in_list),
+			osc_lru_in_list(cli),
 			atomic_long_read(&cli->cl_lru_busy));
 
 		list_move_tail(&cli->cl_lru_osc, &cache->ccc_lru);
+		left += osc_lru_flush_left(cli);
 		if (osc_cache_too_much(cli) > 0) {
 			spin_unlock(&cache->ccc_lru_lock);
 
@@ -872,6 +1055,8 @@ static long osc_lru_reclaim(struct client_obd *cli, unsigned long npages)
 
 out:
 	cl_env_nested_put(&nest, env);
+	if (left > 0)
+		rc = max_t(long, rc, 0) + left;
 	CDEBUG(D_CACHE, "%s: cli %p freed %ld pages.\n",
 		cli_name(cli), cli, rc);
 	return rc;
@@ -910,9 +1095,7 @@ static int osc_lru_alloc(const struct lu_env *env, struct client_obd *cli,
 			continue;
 
 		cond_resched();
-		rc = l_wait_event(osc_lru_waitq,
-				atomic_long_read(cli->cl_lru_left) > 0,
-				&lwi);
+		rc = l_wait_event(osc_lru_waitq, osc_lru_has_left(cli), &lwi);
 		if (rc < 0)
 			break;
 	}
@@ -920,6 +1103,7 @@ static int osc_lru_alloc(const struct lu_env *env, struct client_obd *cli,
 out:
 	if (rc >= 0) {
 		atomic_long_inc(&cli->cl_lru_busy);
+		opg->ops_lru_cpt = cfs_cpt_current(cfs_cpt_table, 1);
 		opg->ops_in_lru = 1;
 		rc = 0;
 	}
@@ -1139,7 +1323,7 @@ unsigned long osc_cache_shrink_count(struct shrinker *sk,
 
 	spin_lock(&osc_shrink_lock);
 	list_for_each_entry(cli, &osc_shrink_list, cl_shrink_list)
-		cached += atomic_long_read(&cli->cl_lru_in_list);
+		cached += osc_lru_in_list(cli);
 	spin_unlock(&osc_shrink_lock);
 
 	return (cached  * sysctl_vfs_cache_pressure) / 100;
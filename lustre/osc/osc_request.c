@@ -72,6 +72,8 @@ struct osc_brw_async_args {
 	struct client_obd	 *aa_cli;
 	struct list_head	  aa_oaps;
 	struct list_head	  aa_exts;
+	/* the bulk carries a compressed stream, see OBD_FL_BRW_COMPRESS */
+	bool			  aa_compress;
 };
 
 #define osc_grant_args osc_brw_async_args
@@ -1020,6 +1022,133 @@ static u32 osc_checksum_bulk(int nob, size_t pg_count,
 	return cksum;
 }
 
+/**
+ * Whether the bulk of BRW request \a req is to be compressed: the file asked
+ * for it, the OST supports it, the bulk is not already transformed by the
+ * sptlrpc flavor, and the RPC is not sent to free memory.
+ */
+static bool osc_brw_compress_ok(struct client_obd *cli,
+				struct ptlrpc_request *req, struct obdo *oa,
+				struct brw_page *pg)
+{
+	return oa->o_valid & OBD_MD_FLFLAGS &&
+	       oa->o_flags & OBD_FL_BRW_COMPRESS &&
+	       imp_connect_flags2(cli->cl_import) & OBD_CONNECT2_BRW_COMPRESS &&
+	       !sptlrpc_flavor_has_bulk(&req->rq_flvr) &&
+	       !(pg->flag & OBD_BRW_MEMALLOC);
+}
+
+/**
+ * Replace the pages of write bulk \a desc by their compressed stream, if
+ * that saves at least one page.
+ *
+ * \retval	size of the stream
+ * \retval	0 if the data is to be sent as is
+ */
+static int osc_brw_compress_write(struct ptlrpc_bulk_desc *desc)
+{
+	lnet_kiov_t	*stream;
+	int		 count = desc->bd_iov_count;
+	int		 rc;
+
+	OBD_ALLOC_LARGE(stream, count * sizeof(*stream));
+	if (stream == NULL)
+		return 0;
+
+	rc = ptlrpc_bulk_compress(desc, stream);
+	/* the descriptor holds its own references on the stream pages */
+	ptlrpc_bulk_free_stream(stream, count);
+	OBD_FREE_LARGE(stream, count * sizeof(*stream));
+
+	return rc;
+}
+
+/**
+ * Post a sink of the size of read bulk \a desc for the compressed stream,
+ * the pages of the read are filled by osc_brw_expand_read() on reply.
+ */
+static int osc_brw_compress_read(struct ptlrpc_bulk_desc *desc)
+{
+	lnet_kiov_t	*stream;
+	int		 count = desc->bd_iov_count;
+	int		 rc;
+
+	OBD_ALLOC_LARGE(stream, count * sizeof(*stream));
+	if (stream == NULL)
+		return -ENOMEM;
+
+	rc = ptlrpc_bulk_prep_stream(desc, stream, desc->bd_nob);
+	ptlrpc_bulk_free_stream(stream, count);
+	OBD_FREE_LARGE(stream, count * sizeof(*stream));
+
+	return rc;
+}
+
+/**
+ * Move the data of a read received in the compressed stream sink into the
+ * pages of the read. The OST may have sent the data as is if it did not
+ * compress well.
+ *
+ * \param[in] nob	data bytes read by the OST
+ *
+ * \retval		0 on success
+ * \retval		negative errno on failure
+ */
+static int osc_brw_expand_read(struct ptlrpc_request *req,
+			       struct osc_brw_async_args *aa,
+			       struct ost_body *body, int nob)
+{
+	struct ptlrpc_bulk_desc	*desc = req->rq_bulk;
+	struct osc_stats	*stats;
+	lnet_kiov_t		*kiov;
+	int			 transferred = desc->bd_nob_transferred;
+	bool			 compressed;
+	int			 i;
+	int			 rc;
+
+	compressed = body->oa.o_valid & OBD_MD_FLFLAGS &&
+		     body->oa.o_flags & OBD_FL_BRW_COMPRESS;
+	if (transferred != (compressed ? body->oa.o_compr_nob : nob)) {
+		CERROR("Unexpected rc %d (%d transferred%s)\n", nob,
+		       transferred, compressed ? ", compressed" : "");
+		return -EPROTO;
+	}
+
+	OBD_ALLOC_LARGE(kiov, aa->aa_page_count * sizeof(*kiov));
+	if (kiov == NULL)
+		return -ENOMEM;
+
+	for (i = 0; i < aa->aa_page_count; i++) {
+		struct brw_page *pg = aa->aa_ppga[i];
+
+		kiov[i].kiov_page = pg->pg;
+		kiov[i].kiov_offset = pg->off & ~PAGE_MASK;
+		kiov[i].kiov_len = pg->count;
+	}
+
+	if (compressed) {
+		rc = ptlrpc_bulk_decompress(GET_KIOV(desc), desc->bd_iov_count,
+					    transferred, kiov,
+					    aa->aa_page_count);
+		if (rc >= 0 && rc != nob)
+			rc = -EPROTO;
+		if (rc >= 0) {
+			stats = &obd2osc_dev(req->rq_import->imp_obd)->od_stats;
+			stats->os_compr_read_bytes += nob;
+			stats->os_compr_read_cbytes += transferred;
+		}
+	} else {
+		rc = ptlrpc_bulk_copy(GET_KIOV(desc), desc->bd_iov_count,
+				      transferred, kiov, aa->aa_page_count);
+	}
+	OBD_FREE_LARGE(kiov, aa->aa_page_count * sizeof(*kiov));
+	if (rc < 0)
+		CERROR("%s: cannot expand read of %d bytes: rc = %d\n",
+		       req->rq_import->imp_obd->obd_name, nob, rc);
+
+	return rc < 0 ? rc : 0;
+}
+
 static int
 osc_brw_prep_request(int cmd, struct client_obd *cli, struct obdo *oa,
 		     u32 page_count, struct brw_page **pga,
@@ -1034,6 +1163,7 @@ osc_brw_prep_request(int cmd, struct client_obd *cli, struct obdo *oa,
         struct osc_brw_async_args *aa;
         struct req_capsule      *pill;
         struct brw_page *pg_prev;
+	bool compress;
 
         ENTRY;
         if (OBD_FAIL_CHECK(OBD_FAIL_OSC_BRW_PREP_REQ))
@@ -1199,6 +1329,24 @@ osc_brw_prep_request(int cmd, struct client_obd *cli, struct obdo *oa,
                         body->oa.o_valid |= OBD_MD_FLCKSUM | OBD_MD_FLFLAGS;
                 }
         }
+
+	compress = osc_brw_compress_ok(cli, req, &body->oa, pga[0]);
+	if (compress && opc == OST_WRITE) {
+		body->oa.o_compr_nob = osc_brw_compress_write(desc);
+		if (body->oa.o_compr_nob != 0) {
+			struct osc_stats *stats;
+
+			stats = &obd2osc_dev(cli->cl_import->imp_obd)->od_stats;
+			stats->os_compr_write_bytes += requested_nob;
+			stats->os_compr_write_cbytes += body->oa.o_compr_nob;
+		} else {
+			compress = false;
+		}
+	} else if (compress) {
+		compress = osc_brw_compress_read(desc) == 0;
+	}
+	if (!compress && body->oa.o_valid & OBD_MD_FLFLAGS)
+		body->oa.o_flags &= ~OBD_FL_BRW_COMPRESS;
         ptlrpc_request_set_replen(req);
 
         CLASSERT(sizeof(*aa) <= sizeof(req->rq_async_args));
@@ -1210,6 +1358,7 @@ osc_brw_prep_request(int cmd, struct client_obd *cli, struct obdo *oa,
         aa->aa_resends = 0;
         aa->aa_ppga = pga;
         aa->aa_cli = cli;
+	aa->aa_compress = compress;
 	INIT_LIST_HEAD(&aa->aa_oaps);
 
 	*reqp = req;
@@ -1316,7 +1465,8 @@ static int osc_brw_fini_request(struct ptlrpc_request *req, int rc)
                         CERROR("Unexpected +ve rc %d\n", rc);
                         RETURN(-EPROTO);
                 }
-                LASSERT(req->rq_bulk->bd_nob == aa->aa_requested_nob);
+		LASSERT(aa->aa_compress ||
+			req->rq_bulk->bd_nob == aa->aa_requested_nob);
 
                 if (sptlrpc_cli_unwrap_bulk_write(req, req->rq_bulk))
                         RETURN(-EAGAIN);
@@ -1335,10 +1485,14 @@ static int osc_brw_fini_request(struct ptlrpc_request *req, int rc)
 
         /* The rest of this function executes only for OST_READs */
 
-        /* if unwrap_bulk failed, return -EAGAIN to retry */
-        rc = sptlrpc_cli_unwrap_bulk_read(req, req->rq_bulk, rc);
-        if (rc < 0)
-                GOTO(out, rc = -EAGAIN);
+	/* with compression the bulk flavor is null, rc is then the size of
+	 * the data read and not that of the stream which was transferred */
+	if (!aa->aa_compress) {
+		/* if unwrap_bulk failed, return -EAGAIN to retry */
+		rc = sptlrpc_cli_unwrap_bulk_read(req, req->rq_bulk, rc);
+		if (rc < 0)
+			GOTO(out, rc = -EAGAIN);
+	}
 
         if (rc > aa->aa_requested_nob) {
                 CERROR("Unexpected rc %d (%d requested)\n", rc,
@@ -1346,7 +1500,12 @@ static int osc_brw_fini_request(struct ptlrpc_request *req, int rc)
                 RETURN(-EPROTO);
         }
 
-        if (rc != req->rq_bulk->bd_nob_transferred) {
+	if (aa->aa_compress) {
+		int rc2 = osc_brw_expand_read(req, aa, body, rc);
+
+		if (rc2 < 0)
+			RETURN(rc2);
+	} else if (rc != req->rq_bulk->bd_nob_transferred) {
                 CERROR ("Unexpected rc %d (%d transferred)\n",
                         rc, req->rq_bulk->bd_nob_transferred);
                 return (-EPROTO);
@@ -2391,7 +2550,7 @@ static int osc_set_info_async(const struct lu_env *env, struct obd_export *exp,
 
 	if (KEY_IS(KEY_CACHE_LRU_SHRINK)) {
 		struct client_obd *cli = &obd->u.cli;
-		long nr = atomic_long_read(&cli->cl_lru_in_list) >> 1;
+		long nr = osc_lru_in_list(cli) >> 1;
 		long target = *(long *)val;
 
 		nr = osc_lru_shrink(env, cli, min(nr, target), true);
@@ -2676,9 +2835,13 @@ int osc_setup(struct obd_device *obd, struct lustre_cfg *lcfg)
 	if (rc)
 		GOTO(out_ptlrpcd, rc);
 
+	rc = osc_lru_setup(cli);
+	if (rc)
+		GOTO(out_client_setup, rc);
+
 	handler = ptlrpcd_alloc_work(cli->cl_import, brw_queue_work, cli);
 	if (IS_ERR(handler))
-		GOTO(out_client_setup, rc = PTR_ERR(handler));
+		GOTO(out_lru, rc = PTR_ERR(handler));
 	cli->cl_writeback_work = handler;
 
 	handler = ptlrpcd_alloc_work(cli->cl_import, lru_queue_work, cli);
@@ -2739,6 +2902,7 @@ int osc_setup(struct obd_device *obd, struct lustre_cfg *lcfg)
 
 	INIT_LIST_HEAD(&cli->cl_grant_shrink_list);
 	ns_register_cancel(obd->obd_namespace, osc_cancel_weight);
+	ns_register_lock_cost(obd->obd_namespace, osc_ldlm_cost);
 
 	spin_lock(&osc_shrink_lock);
 	list_add_tail(&cli->cl_shrink_list, &osc_shrink_list);
@@ -2755,6 +2919,8 @@ out_ptlrpcd_work:
 		ptlrpcd_destroy_work(cli->cl_lru_work);
 		cli->cl_lru_work = NULL;
 	}
+out_lru:
+	osc_lru_cleanup(cli);
 out_client_setup:
 	client_obd_cleanup(obd);
 out_ptlrpcd:
@@ -2805,6 +2971,7 @@ int osc_cleanup(struct obd_device *obd)
 	spin_unlock(&osc_shrink_lock);
 
 	/* lru cleanup */
+	osc_lru_cleanup(cli);
 	if (cli->cl_cache != NULL) {
 		LASSERT(atomic_read(&cli->cl_cache->ccc_users) > 0);
 		spin_lock(&cli->cl_cache->ccc_lru_lock);
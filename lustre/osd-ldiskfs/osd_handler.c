@@ -1947,6 +1947,9 @@ static void osd_inode_getattr(const struct lu_env *env,
 	attr->la_uid	 = i_uid_read(inode);
 	attr->la_gid	 = i_gid_read(inode);
 	attr->la_flags	 = ll_inode_to_ext_flags(inode->i_flags);
+	/* not a VFS flag, it is kept in the ldiskfs inode only */
+	if (LDISKFS_I(inode)->i_flags & LDISKFS_COMPR_FL)
+		attr->la_flags |= LUSTRE_COMPR_FL;
 	attr->la_nlink	 = inode->i_nlink;
 	attr->la_rdev	 = inode->i_rdev;
 	attr->la_blksize = 1 << inode->i_blkbits;
@@ -2168,6 +2171,10 @@ static int osd_inode_setattr(const struct lu_env *env,
                 /* always keep S_NOCMTIME */
                 inode->i_flags = ll_ext_to_inode_flags(attr->la_flags) |
                                  S_NOCMTIME;
+		if (attr->la_flags & LUSTRE_COMPR_FL)
+			LDISKFS_I(inode)->i_flags |= LDISKFS_COMPR_FL;
+		else
+			LDISKFS_I(inode)->i_flags &= ~LDISKFS_COMPR_FL;
         }
         return 0;
 }
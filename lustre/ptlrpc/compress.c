@@ -0,0 +1,579 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+/*
+ * Copyright (c) 2016, Intel Corporation.
+ */
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ * Lustre is a trademark of Sun Microsystems, Inc.
+ *
+ * lustre/ptlrpc/compress.c
+ *
+ * Compression of BRW bulk data on the wire. The sender of a bulk turns the
+ * data of its fragments into a stream of chunks of up to BRW_CHUNK_MAX_LEN
+ * bytes, see struct brw_chunk_hdr, and the receiver expands the stream back
+ * into its own fragments. The data is stored uncompressed by the OSD, only
+ * the network transfer is reduced.
+ *
+ * LZ4 is used through the kernel crypto API. The transforms and the chunk
+ * buffers come from a pool per CPT, which grows up to one context per CPU
+ * of the CPT. If the kernel has no LZ4 the feature is not offered.
+ */
+
+#define DEBUG_SUBSYSTEM S_RPC
+
+#include <linux/crypto.h>
+#include <linux/highmem.h>
+#include <libcfs/libcfs.h>
+
+#include <obd_support.h>
+#include <lustre_net.h>
+
+#include "ptlrpc_internal.h"
+
+/* worst case LZ4 output for a chunk of BRW_CHUNK_MAX_LEN bytes */
+#define BRW_CHUNK_CBUF_LEN	(BRW_CHUNK_MAX_LEN + \
+				 BRW_CHUNK_MAX_LEN / 255 + 16)
+
+struct ptlrpc_compress_pool;
+
+struct ptlrpc_compress_ctx {
+	/* on pcp_free, or on pcp_busy while in use */
+	struct list_head		 pcc_list;
+	struct ptlrpc_compress_pool	*pcc_pool;
+	struct crypto_comp		*pcc_tfm;
+	/* compressed chunk */
+	char				*pcc_cbuf;
+	/* plain chunk */
+	char				*pcc_dbuf;
+};
+
+struct ptlrpc_compress_pool {
+	spinlock_t		 pcp_lock;
+	struct list_head	 pcp_free;
+	struct list_head	 pcp_busy;
+	/* contexts allocated, and the limit */
+	int			 pcp_nr;
+	int			 pcp_max;
+	wait_queue_head_t	 pcp_waitq;
+};
+
+static struct ptlrpc_compress_pool **ptlrpc_compress_pools;
+
+/* position in an array of fragments */
+struct brw_kiov_cursor {
+	lnet_kiov_t	*bkc_kiov;
+	int		 bkc_count;
+	int		 bkc_idx;
+	int		 bkc_off;
+	/* allocate the pages of the fragments as they are written */
+	bool		 bkc_alloc;
+};
+
+/**
+ * Whether BRW bulk compression can be used on this node.
+ */
+bool ptlrpc_bulk_compress_available(void)
+{
+	return ptlrpc_compress_pools != NULL;
+}
+EXPORT_SYMBOL(ptlrpc_bulk_compress_available);
+
+static int brw_kiov_copy(struct brw_kiov_cursor *bkc, char *buf, int len,
+			 bool to_kiov)
+{
+	while (len > 0) {
+		lnet_kiov_t	*kiov;
+		char		*addr;
+		int		 count;
+
+		if (bkc->bkc_idx >= bkc->bkc_count)
+			return -EOVERFLOW;
+
+		kiov = &bkc->bkc_kiov[bkc->bkc_idx];
+		if (kiov->kiov_page == NULL) {
+			LASSERT(bkc->bkc_alloc);
+			kiov->kiov_page = alloc_page(GFP_NOFS);
+			if (kiov->kiov_page == NULL)
+				return -ENOMEM;
+		}
+		count = min_t(int, len, kiov->kiov_len - bkc->bkc_off);
+
+		addr = kmap(kiov->kiov_page) + kiov->kiov_offset +
+		       bkc->bkc_off;
+		if (to_kiov)
+			memcpy(addr, buf, count);
+		else
+			memcpy(buf, addr, count);
+		kunmap(kiov->kiov_page);
+
+		bkc->bkc_off += count;
+		if (bkc->bkc_off == kiov->kiov_len) {
+			bkc->bkc_idx++;
+			bkc->bkc_off = 0;
+		}
+		buf += count;
+		len -= count;
+	}
+
+	return 0;
+}
+
+static void ptlrpc_compress_ctx_free(struct ptlrpc_compress_ctx *pcc)
+{
+	if (pcc->pcc_dbuf != NULL)
+		OBD_FREE_LARGE(pcc->pcc_dbuf, BRW_CHUNK_MAX_LEN);
+	if (pcc->pcc_cbuf != NULL)
+		OBD_FREE_LARGE(pcc->pcc_cbuf, BRW_CHUNK_CBUF_LEN);
+	if (pcc->pcc_tfm != NULL && !IS_ERR(pcc->pcc_tfm))
+		crypto_free_comp(pcc->pcc_tfm);
+	OBD_FREE_PTR(pcc);
+}
+
+static struct ptlrpc_compress_ctx *
+ptlrpc_compress_ctx_alloc(struct ptlrpc_compress_pool *pcp)
+{
+	struct ptlrpc_compress_ctx *pcc;
+
+	OBD_ALLOC_PTR(pcc);
+	if (pcc == NULL)
+		return ERR_PTR(-ENOMEM);
+
+	INIT_LIST_HEAD(&pcc->pcc_list);
+	pcc->pcc_pool = pcp;
+	pcc->pcc_tfm = crypto_alloc_comp("lz4", 0, 0);
+	if (IS_ERR(pcc->pcc_tfm)) {
+		int rc = PTR_ERR(pcc->pcc_tfm);
+
+		ptlrpc_compress_ctx_free(pcc);
+		return ERR_PTR(rc);
+	}
+
+	OBD_ALLOC_LARGE(pcc->pcc_cbuf, BRW_CHUNK_CBUF_LEN);
+	OBD_ALLOC_LARGE(pcc->pcc_dbuf, BRW_CHUNK_MAX_LEN);
+	if (pcc->pcc_cbuf == NULL || pcc->pcc_dbuf == NULL) {
+		ptlrpc_compress_ctx_free(pcc);
+		return ERR_PTR(-ENOMEM);
+	}
+
+	return pcc;
+}
+
+/**
+ * Take a compression context from the pool of the current CPT, adding one
+ * to the pool if all are in use and it is below its limit, or waiting for
+ * one to be released otherwise.
+ */
+static struct ptlrpc_compress_ctx *ptlrpc_compress_ctx_get(void)
+{
+	struct ptlrpc_compress_pool	*pcp;
+	struct ptlrpc_compress_ctx	*pcc;
+
+	pcp = ptlrpc_compress_pools[cfs_cpt_current(cfs_cpt_table, 1)];
+	spin_lock(&pcp->pcp_lock);
+	while (list_empty(&pcp->pcp_free)) {
+		if (pcp->pcp_nr < pcp->pcp_max) {
+			pcp->pcp_nr++;
+			spin_unlock(&pcp->pcp_lock);
+
+			pcc = ptlrpc_compress_ctx_alloc(pcp);
+
+			spin_lock(&pcp->pcp_lock);
+			if (!IS_ERR(pcc)) {
+				list_add(&pcc->pcc_list, &pcp->pcp_busy);
+				spin_unlock(&pcp->pcp_lock);
+				return pcc;
+			}
+			/* make do with the contexts there are */
+			pcp->pcp_nr--;
+			pcp->pcp_max = pcp->pcp_nr;
+			continue;
+		}
+
+		spin_unlock(&pcp->pcp_lock);
+		wait_event(pcp->pcp_waitq, !list_empty(&pcp->pcp_free));
+		spin_lock(&pcp->pcp_lock);
+	}
+	pcc = list_entry(pcp->pcp_free.next, struct ptlrpc_compress_ctx,
+			 pcc_list);
+	list_move(&pcc->pcc_list, &pcp->pcp_busy);
+	spin_unlock(&pcp->pcp_lock);
+
+	return pcc;
+}
+
+static void ptlrpc_compress_ctx_put(struct ptlrpc_compress_ctx *pcc)
+{
+	struct ptlrpc_compress_pool *pcp = pcc->pcc_pool;
+
+	spin_lock(&pcp->pcp_lock);
+	list_move(&pcc->pcc_list, &pcp->pcp_free);
+	spin_unlock(&pcp->pcp_lock);
+	wake_up(&pcp->pcp_waitq);
+}
+
+/* give \a stream the layout of the fragments of \a desc, without pages */
+static void ptlrpc_bulk_stream_layout(struct ptlrpc_bulk_desc *desc,
+				      lnet_kiov_t *stream)
+{
+	int i;
+
+	for (i = 0; i < desc->bd_iov_count; i++) {
+		stream[i].kiov_page = NULL;
+		stream[i].kiov_offset = BD_GET_KIOV(desc, i).kiov_offset;
+		stream[i].kiov_len = BD_GET_KIOV(desc, i).kiov_len;
+	}
+}
+
+/**
+ * Replace the fragments of \a desc by the first \a nob bytes of \a kiov,
+ * the last fragment used is cut to what is left of \a nob.
+ *
+ * With ptlrpc_bulk_kiov_pin_ops the descriptor takes its own reference on
+ * the pages.
+ */
+void ptlrpc_bulk_replace_frags(struct ptlrpc_bulk_desc *desc,
+			       lnet_kiov_t *kiov, int nob)
+{
+	int i;
+
+	LASSERT(ptlrpc_is_bulk_desc_kiov(desc->bd_type));
+	LASSERT(desc->bd_md_count == 0);
+
+	if (desc->bd_frag_ops->release_frags != NULL)
+		desc->bd_frag_ops->release_frags(desc);
+	desc->bd_iov_count = 0;
+	desc->bd_nob = 0;
+
+	for (i = 0; nob > 0; i++) {
+		int len = min_t(int, nob, kiov[i].kiov_len);
+
+		desc->bd_frag_ops->add_kiov_frag(desc, kiov[i].kiov_page,
+						 kiov[i].kiov_offset, len);
+		nob -= len;
+	}
+}
+EXPORT_SYMBOL(ptlrpc_bulk_replace_frags);
+
+/**
+ * Compress the data of \a desc, and make the stream its fragments if that
+ * saves at least one fragment.
+ *
+ * The data of consecutive fragments is gathered into chunks of up to
+ * BRW_CHUNK_MAX_LEN bytes, LZ4 does much better on those than on single
+ * pages. The stream is laid out in new pages with the offsets and lengths
+ * of the data fragments, so that both peers split the bulk into the same
+ * LNet MDs as for plain data.
+ *
+ * \param[in] desc	bulk holding the data
+ * \param[out] stream	array of desc->bd_iov_count fragments receiving the
+ *			stream, its pages are to be released by
+ *			ptlrpc_bulk_free_stream() in all cases
+ *
+ * \retval		size of the stream in bytes
+ * \retval		0 if \a desc is left as is
+ */
+int ptlrpc_bulk_compress(struct ptlrpc_bulk_desc *desc, lnet_kiov_t *stream)
+{
+	struct ptlrpc_compress_ctx	*pcc;
+	struct brw_kiov_cursor		 in = {
+		.bkc_kiov	= &BD_GET_KIOV(desc, 0),
+		.bkc_count	= desc->bd_iov_count,
+	};
+	struct brw_kiov_cursor		 out = {
+		.bkc_kiov	= stream,
+		.bkc_count	= desc->bd_iov_count - 1,
+		.bkc_alloc	= true,
+	};
+	int				 left = desc->bd_nob;
+	int				 nob = 0;
+	int				 rc = 0;
+	ENTRY;
+
+	LASSERT(ptlrpc_bulk_compress_available());
+
+	ptlrpc_bulk_stream_layout(desc, stream);
+	if (desc->bd_iov_count < 2)
+		RETURN(0);
+
+	pcc = ptlrpc_compress_ctx_get();
+	while (left > 0 && rc == 0) {
+		struct brw_chunk_hdr	 bch;
+		unsigned int		 clen = BRW_CHUNK_CBUF_LEN;
+		int			 len = min(left, BRW_CHUNK_MAX_LEN);
+
+		rc = brw_kiov_copy(&in, pcc->pcc_dbuf, len, false);
+		if (rc < 0)
+			break;
+
+		if (crypto_comp_compress(pcc->pcc_tfm, pcc->pcc_dbuf, len,
+					 pcc->pcc_cbuf, &clen) != 0 ||
+		    clen >= len)
+			clen = len;
+
+		bch.bch_len = cpu_to_le32(len);
+		bch.bch_csize = cpu_to_le32(clen);
+		rc = brw_kiov_copy(&out, (char *)&bch, sizeof(bch), true);
+		if (rc == 0)
+			rc = brw_kiov_copy(&out, clen < len ? pcc->pcc_cbuf :
+						 pcc->pcc_dbuf, clen, true);
+		nob += sizeof(bch) + clen;
+		left -= len;
+	}
+	ptlrpc_compress_ctx_put(pcc);
+
+	if (rc < 0) {
+		if (rc != -EOVERFLOW)
+			CDEBUG(D_NET, "cannot compress bulk: rc = %d\n", rc);
+		RETURN(0);
+	}
+
+	ptlrpc_bulk_replace_frags(desc, stream, nob);
+	RETURN(nob);
+}
+EXPORT_SYMBOL(ptlrpc_bulk_compress);
+
+/**
+ * Make the fragments of \a desc a sink for a stream of at most \a nob
+ * bytes, laid out like the current fragments in new pages.
+ *
+ * \param[in] desc	bulk whose fragments describe the plain data
+ * \param[out] stream	array of desc->bd_iov_count fragments receiving the
+ *			sink, its pages are to be released by
+ *			ptlrpc_bulk_free_stream() in all cases
+ * \param[in] nob	size of the sink
+ */
+int ptlrpc_bulk_prep_stream(struct ptlrpc_bulk_desc *desc,
+			    lnet_kiov_t *stream, int nob)
+{
+	int left = nob;
+	int i;
+
+	ptlrpc_bulk_stream_layout(desc, stream);
+	for (i = 0; i < desc->bd_iov_count && left > 0; i++) {
+		stream[i].kiov_page = alloc_page(GFP_NOFS);
+		if (stream[i].kiov_page == NULL)
+			return -ENOMEM;
+		left -= stream[i].kiov_len;
+	}
+	if (left > 0)
+		return -EOVERFLOW;
+
+	ptlrpc_bulk_replace_frags(desc, stream, nob);
+	return 0;
+}
+EXPORT_SYMBOL(ptlrpc_bulk_prep_stream);
+
+/**
+ * Release the pages of a stream set up by ptlrpc_bulk_compress() or
+ * ptlrpc_bulk_prep_stream().
+ */
+void ptlrpc_bulk_free_stream(lnet_kiov_t *stream, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		if (stream[i].kiov_page != NULL) {
+			__free_page(stream[i].kiov_page);
+			stream[i].kiov_page = NULL;
+		}
+	}
+}
+EXPORT_SYMBOL(ptlrpc_bulk_free_stream);
+
+/**
+ * Expand a stream made by ptlrpc_bulk_compress() into \a dst.
+ *
+ * The stream comes from the network, it is checked not to overflow \a dst
+ * nor the chunk buffers.
+ *
+ * \param[in] src	fragments holding the stream
+ * \param[in] src_count	number of fragments of the stream
+ * \param[in] nob	size of the stream in bytes
+ * \param[in] dst	fragments receiving the data
+ * \param[in] dst_count	number of fragments in \a dst
+ *
+ * \retval		number of data bytes written to \a dst
+ * \retval		-EPROTO if the stream is malformed
+ */
+int ptlrpc_bulk_decompress(lnet_kiov_t *src, int src_count, int nob,
+			   lnet_kiov_t *dst, int dst_count)
+{
+	struct ptlrpc_compress_ctx	*pcc;
+	struct brw_kiov_cursor		 in = {
+		.bkc_kiov	= src,
+		.bkc_count	= src_count,
+	};
+	struct brw_kiov_cursor		 out = {
+		.bkc_kiov	= dst,
+		.bkc_count	= dst_count,
+	};
+	int				 total = 0;
+	int				 rc = 0;
+	ENTRY;
+
+	LASSERT(ptlrpc_bulk_compress_available());
+
+	pcc = ptlrpc_compress_ctx_get();
+	while (nob > 0) {
+		struct brw_chunk_hdr	bch;
+		unsigned int		dlen = BRW_CHUNK_MAX_LEN;
+		int			len;
+		int			clen;
+
+		if (nob < sizeof(bch))
+			GOTO(out, rc = -EPROTO);
+
+		rc = brw_kiov_copy(&in, (char *)&bch, sizeof(bch), false);
+		if (rc < 0)
+			GOTO(out, rc = -EPROTO);
+
+		len = le32_to_cpu(bch.bch_len);
+		clen = le32_to_cpu(bch.bch_csize);
+		if (len <= 0 || len > BRW_CHUNK_MAX_LEN || clen <= 0 ||
+		    clen > len || clen > nob - sizeof(bch))
+			GOTO(out, rc = -EPROTO);
+
+		if (clen == len) {
+			rc = brw_kiov_copy(&in, pcc->pcc_dbuf, len, false);
+		} else {
+			rc = brw_kiov_copy(&in, pcc->pcc_cbuf, clen, false);
+			if (rc == 0 &&
+			    (crypto_comp_decompress(pcc->pcc_tfm, pcc->pcc_cbuf,
+						    clen, pcc->pcc_dbuf,
+						    &dlen) != 0 || dlen != len))
+				rc = -EPROTO;
+		}
+		if (rc == 0)
+			rc = brw_kiov_copy(&out, pcc->pcc_dbuf, len, true);
+		if (rc < 0)
+			GOTO(out, rc = -EPROTO);
+
+		nob -= sizeof(bch) + clen;
+		total += len;
+	}
+out:
+	ptlrpc_compress_ctx_put(pcc);
+	if (rc < 0)
+		CDEBUG(D_NET, "malformed compressed bulk at %d: rc = %d\n",
+		       total, rc);
+
+	RETURN(rc < 0 ? rc : total);
+}
+EXPORT_SYMBOL(ptlrpc_bulk_decompress);
+
+/**
+ * Copy \a nob bytes of plain data from \a src to \a dst, for a bulk which
+ * was sent as is into a sink set up for a compressed stream.
+ */
+int ptlrpc_bulk_copy(lnet_kiov_t *src, int src_count, int nob,
+		     lnet_kiov_t *dst, int dst_count)
+{
+	struct brw_kiov_cursor	out = {
+		.bkc_kiov	= dst,
+		.bkc_count	= dst_count,
+	};
+	int			i;
+	int			rc = 0;
+
+	for (i = 0; i < src_count && nob > 0 && rc == 0; i++) {
+		int	 len = min_t(int, nob, src[i].kiov_len);
+		char	*addr;
+
+		addr = kmap(src[i].kiov_page) + src[i].kiov_offset;
+		rc = brw_kiov_copy(&out, addr, len, true);
+		kunmap(src[i].kiov_page);
+		nob -= len;
+	}
+	if (rc == 0 && nob > 0)
+		rc = -EPROTO;
+
+	return rc < 0 ? -EPROTO : 0;
+}
+EXPORT_SYMBOL(ptlrpc_bulk_copy);
+
+void ptlrpc_compress_fini(void)
+{
+	struct ptlrpc_compress_pool	*pcp;
+	struct ptlrpc_compress_ctx	*pcc;
+	int				 i;
+
+	if (ptlrpc_compress_pools == NULL)
+		return;
+
+	cfs_percpt_for_each(pcp, i, ptlrpc_compress_pools) {
+		LASSERT(list_empty(&pcp->pcp_busy));
+		while (!list_empty(&pcp->pcp_free)) {
+			pcc = list_entry(pcp->pcp_free.next,
+					 struct ptlrpc_compress_ctx, pcc_list);
+			list_del(&pcc->pcc_list);
+			ptlrpc_compress_ctx_free(pcc);
+		}
+	}
+	cfs_percpt_free(ptlrpc_compress_pools);
+	ptlrpc_compress_pools = NULL;
+}
+
+/**
+ * Set up the per-CPT pools of compression contexts, with one context each
+ * to start with.
+ *
+ * A kernel without LZ4 is not an error, BRW compression is then simply not
+ * negotiated with the peers.
+ */
+int ptlrpc_compress_init(void)
+{
+	struct ptlrpc_compress_pool	*pcp;
+	struct ptlrpc_compress_ctx	*pcc;
+	int				 i;
+
+	ptlrpc_compress_pools = cfs_percpt_alloc(cfs_cpt_table, sizeof(*pcp));
+	if (ptlrpc_compress_pools == NULL)
+		return -ENOMEM;
+
+	cfs_percpt_for_each(pcp, i, ptlrpc_compress_pools) {
+		spin_lock_init(&pcp->pcp_lock);
+		INIT_LIST_HEAD(&pcp->pcp_free);
+		INIT_LIST_HEAD(&pcp->pcp_busy);
+		init_waitqueue_head(&pcp->pcp_waitq);
+		pcp->pcp_max = max(cfs_cpt_weight(cfs_cpt_table, i), 1);
+	}
+
+	cfs_percpt_for_each(pcp, i, ptlrpc_compress_pools) {
+		pcc = ptlrpc_compress_ctx_alloc(pcp);
+		if (IS_ERR(pcc)) {
+			int rc = PTR_ERR(pcc);
+
+			ptlrpc_compress_fini();
+			if (rc == -ENOMEM)
+				return rc;
+
+			CDEBUG(D_INFO, "no lz4, BRW compression disabled: "
+			       "rc = %d\n", rc);
+			return 0;
+		}
+		list_add(&pcc->pcc_list, &pcp->pcp_free);
+		pcp->pcp_nr = 1;
+	}
+
+	return 0;
+}
@@ -701,6 +701,8 @@ int ptlrpc_connect_import(struct obd_import *imp)
         /* Reset connect flags to the originally requested flags, in case
          * the server is updated on-the-fly we will get the new features. */
         imp->imp_connect_data.ocd_connect_flags = imp->imp_connect_flags_orig;
+	imp->imp_connect_data.ocd_connect_flags2 =
+		imp->imp_connect_flags2_orig;
 	/* Reset ocd_version each time so the server knows the exact versions */
 	imp->imp_connect_data.ocd_version = LUSTRE_VERSION_CODE;
         imp->imp_msghdr_flags &= ~MSGHDR_AT_SUPPORT;
@@ -1053,6 +1055,16 @@ static int ptlrpc_connect_interpret(const struct lu_env *env,
 		GOTO(out, rc = -EPROTO);
 	}
 
+	if ((ocd->ocd_connect_flags & OBD_CONNECT_FLAGS2) &&
+	    (ocd->ocd_connect_flags2 & imp->imp_connect_flags2_orig) !=
+	    ocd->ocd_connect_flags2) {
+		CERROR("%s: Server didn't grant requested subset of flags2: "
+		       "asked="LPX64" granted="LPX64"\n",
+		       imp->imp_obd->obd_name, imp->imp_connect_flags2_orig,
+		       ocd->ocd_connect_flags2);
+		GOTO(out, rc = -EPROTO);
+	}
+
 	if (!(imp->imp_connect_flags_orig & OBD_CONNECT_LIGHTWEIGHT) &&
 	    (imp->imp_connect_flags_orig & OBD_CONNECT_MDS_MDS) &&
 	    (imp->imp_connect_flags_orig & OBD_CONNECT_FID) &&
@@ -194,6 +194,20 @@ static const struct req_msg_field *mds_getattr_name_client[] = {
         &RMF_NAME
 };
 
+static const struct req_msg_field *mds_batch_getattr_client[] = {
+	&RMF_PTLRPC_BODY,
+	&RMF_MDT_BODY,
+	&RMF_BATCH_NAMES,
+	&RMF_BATCH_LOCK_HANDLES
+};
+
+static const struct req_msg_field *mds_batch_getattr_server[] = {
+	&RMF_PTLRPC_BODY,
+	&RMF_BATCH_GETATTR_REP,
+	&RMF_BATCH_LOCK_REP,
+	&RMF_BATCH_GETATTR_MD
+};
+
 static const struct req_msg_field *mds_reint_client[] = {
         &RMF_PTLRPC_BODY,
         &RMF_REC_REINT
@@ -379,6 +393,29 @@ static const struct req_msg_field *ldlm_enqueue_lvb_server[] = {
         &RMF_DLM_LVB
 };
 
+static const struct req_msg_field *ldlm_enqueue_replay_batch_client[] = {
+	&RMF_PTLRPC_BODY,
+	&RMF_DLM_REQ,
+	&RMF_DLM_REPLAY_DESC
+};
+
+static const struct req_msg_field *ldlm_enqueue_replay_batch_server[] = {
+	&RMF_PTLRPC_BODY,
+	&RMF_DLM_REP,
+	&RMF_DLM_REPLAY_REP
+};
+
+static const struct req_msg_field *ldlm_bl_callback_batch_client[] = {
+	&RMF_PTLRPC_BODY,
+	&RMF_DLM_REQ,
+	&RMF_DLM_BL_DESC
+};
+
+static const struct req_msg_field *ldlm_bl_callback_batch_server[] = {
+	&RMF_PTLRPC_BODY,
+	&RMF_RCS
+};
+
 static const struct req_msg_field *ldlm_cp_callback_client[] = {
         &RMF_PTLRPC_BODY,
         &RMF_DLM_REQ,
@@ -728,6 +765,7 @@ static struct req_format *req_formats[] = {
         &RQF_MDS_STATFS,
         &RQF_MDS_GETATTR,
         &RQF_MDS_GETATTR_NAME,
+	&RQF_MDS_BATCH_GETATTR,
         &RQF_MDS_GETXATTR,
         &RQF_MDS_SYNC,
         &RQF_MDS_CLOSE,
@@ -775,11 +813,13 @@ static struct req_format *req_formats[] = {
         &RQF_OST_GET_INFO_FIEMAP,
         &RQF_LDLM_ENQUEUE,
         &RQF_LDLM_ENQUEUE_LVB,
+	&RQF_LDLM_ENQUEUE_REPLAY_BATCH,
         &RQF_LDLM_CONVERT,
         &RQF_LDLM_CANCEL,
         &RQF_LDLM_CALLBACK,
         &RQF_LDLM_CP_CALLBACK,
         &RQF_LDLM_BL_CALLBACK,
+	&RQF_LDLM_BL_CALLBACK_BATCH,
         &RQF_LDLM_GL_CALLBACK,
 	&RQF_LDLM_GL_DESC_CALLBACK,
         &RQF_LDLM_INTENT,
@@ -926,6 +966,31 @@ struct req_msg_field RMF_MDT_BODY =
                     sizeof(struct mdt_body), lustre_swab_mdt_body, NULL);
 EXPORT_SYMBOL(RMF_MDT_BODY);
 
+struct req_msg_field RMF_BATCH_NAMES =
+	DEFINE_MSGF("batch_names", 0, -1, NULL, NULL);
+EXPORT_SYMBOL(RMF_BATCH_NAMES);
+
+struct req_msg_field RMF_BATCH_GETATTR_REP =
+	DEFINE_MSGF("batch_getattr_rep", RMF_F_STRUCT_ARRAY,
+		    sizeof(struct mdt_batch_getattr_rep),
+		    lustre_swab_mdt_batch_getattr_rep, NULL);
+EXPORT_SYMBOL(RMF_BATCH_GETATTR_REP);
+
+struct req_msg_field RMF_BATCH_LOCK_HANDLES =
+	DEFINE_MSGF("batch_lock_handles", RMF_F_STRUCT_ARRAY,
+		    sizeof(struct lustre_handle), NULL, NULL);
+EXPORT_SYMBOL(RMF_BATCH_LOCK_HANDLES);
+
+struct req_msg_field RMF_BATCH_LOCK_REP =
+	DEFINE_MSGF("batch_lock_rep", RMF_F_STRUCT_ARRAY,
+		    sizeof(struct mdt_batch_lock_rep),
+		    lustre_swab_mdt_batch_lock_rep, NULL);
+EXPORT_SYMBOL(RMF_BATCH_LOCK_REP);
+
+struct req_msg_field RMF_BATCH_GETATTR_MD =
+	DEFINE_MSGF("batch_getattr_md", 0, -1, NULL, NULL);
+EXPORT_SYMBOL(RMF_BATCH_GETATTR_MD);
+
 struct req_msg_field RMF_OBD_QUOTACTL =
         DEFINE_MSGF("obd_quotactl", 0,
                     sizeof(struct obd_quotactl),
@@ -1032,6 +1097,24 @@ struct req_msg_field RMF_LDLM_INTENT =
                     sizeof(struct ldlm_intent), lustre_swab_ldlm_intent, NULL);
 EXPORT_SYMBOL(RMF_LDLM_INTENT);
 
+struct req_msg_field RMF_DLM_REPLAY_DESC =
+	DEFINE_MSGF("dlm_replay_desc", RMF_F_STRUCT_ARRAY,
+		    sizeof(struct ldlm_replay_desc),
+		    lustre_swab_ldlm_replay_desc, NULL);
+EXPORT_SYMBOL(RMF_DLM_REPLAY_DESC);
+
+struct req_msg_field RMF_DLM_BL_DESC =
+	DEFINE_MSGF("dlm_bl_desc", RMF_F_STRUCT_ARRAY,
+		    sizeof(struct ldlm_lock_desc),
+		    lustre_swab_ldlm_lock_desc, NULL);
+EXPORT_SYMBOL(RMF_DLM_BL_DESC);
+
+struct req_msg_field RMF_DLM_REPLAY_REP =
+	DEFINE_MSGF("dlm_replay_rep", RMF_F_STRUCT_ARRAY,
+		    sizeof(struct ldlm_replay_rep),
+		    lustre_swab_ldlm_replay_rep, NULL);
+EXPORT_SYMBOL(RMF_DLM_REPLAY_REP);
+
 struct req_msg_field RMF_DLM_LVB =
 	DEFINE_MSGF("dlm_lvb", 0, -1, NULL, NULL);
 EXPORT_SYMBOL(RMF_DLM_LVB);
@@ -1334,6 +1417,11 @@ struct req_format RQF_MDS_GETATTR_NAME =
                         mds_getattr_name_client, mds_getattr_server);
 EXPORT_SYMBOL(RQF_MDS_GETATTR_NAME);
 
+struct req_format RQF_MDS_BATCH_GETATTR =
+	DEFINE_REQ_FMT0("MDS_BATCH_GETATTR",
+			mds_batch_getattr_client, mds_batch_getattr_server);
+EXPORT_SYMBOL(RQF_MDS_BATCH_GETATTR);
+
 struct req_format RQF_MDS_REINT =
         DEFINE_REQ_FMT0("MDS_REINT", mds_reint_client, mdt_body_only);
 EXPORT_SYMBOL(RQF_MDS_REINT);
@@ -1422,6 +1510,12 @@ struct req_format RQF_LDLM_ENQUEUE_LVB =
                         ldlm_enqueue_client, ldlm_enqueue_lvb_server);
 EXPORT_SYMBOL(RQF_LDLM_ENQUEUE_LVB);
 
+struct req_format RQF_LDLM_ENQUEUE_REPLAY_BATCH =
+	DEFINE_REQ_FMT0("LDLM_ENQUEUE_REPLAY_BATCH",
+			ldlm_enqueue_replay_batch_client,
+			ldlm_enqueue_replay_batch_server);
+EXPORT_SYMBOL(RQF_LDLM_ENQUEUE_REPLAY_BATCH);
+
 struct req_format RQF_LDLM_CONVERT =
         DEFINE_REQ_FMT0("LDLM_CONVERT",
                         ldlm_enqueue_client, ldlm_enqueue_server);
@@ -1443,6 +1537,12 @@ struct req_format RQF_LDLM_BL_CALLBACK =
         DEFINE_REQ_FMT0("LDLM_BL_CALLBACK", ldlm_enqueue_client, empty);
 EXPORT_SYMBOL(RQF_LDLM_BL_CALLBACK);
 
+struct req_format RQF_LDLM_BL_CALLBACK_BATCH =
+	DEFINE_REQ_FMT0("LDLM_BL_CALLBACK_BATCH",
+			ldlm_bl_callback_batch_client,
+			ldlm_bl_callback_batch_server);
+EXPORT_SYMBOL(RQF_LDLM_BL_CALLBACK_BATCH);
+
 struct req_format RQF_LDLM_GL_CALLBACK =
         DEFINE_REQ_FMT0("LDLM_GL_CALLBACK", ldlm_enqueue_client,
                         ldlm_gl_callback_server);
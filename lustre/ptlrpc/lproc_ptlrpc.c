@@ -99,6 +99,7 @@ static struct ll_rpc_opcode {
 	{ MDS_HSM_CT_REGISTER, "mds_hsm_ct_register" },
 	{ MDS_HSM_CT_UNREGISTER, "mds_hsm_ct_unregister" },
 	{ MDS_SWAP_LAYOUTS,	"mds_swap_layouts" },
+	{ MDS_BATCH_GETATTR,	"mds_batch_getattr" },
         { LDLM_ENQUEUE,     "ldlm_enqueue" },
         { LDLM_CONVERT,     "ldlm_convert" },
         { LDLM_CANCEL,      "ldlm_cancel" },
@@ -272,6 +273,39 @@ ptlrpc_lprocfs_req_history_len_seq_show(struct seq_file *m, void *v)
 }
 LPROC_SEQ_FOPS_RO(ptlrpc_lprocfs_req_history_len);
 
+static int
+ptlrpc_lprocfs_req_buffer_pool_seq_show(struct seq_file *m, void *v)
+{
+	struct ptlrpc_service *svc = m->private;
+	struct ptlrpc_service_part *svcpt;
+	__u64	hits = 0;
+	__u64	misses = 0;
+	__u64	nocopy = 0;
+	__u64	copy = 0;
+	int	cached = 0;
+	int	bufs = 0;
+	int	i;
+
+	ptlrpc_service_for_each_part(svcpt, i, svc) {
+		spin_lock(&svcpt->scp_lock);
+		bufs += svcpt->scp_nrqbds_total;
+		cached += svcpt->scp_nreqs_pool;
+		hits += svcpt->scp_req_pool_hits;
+		misses += svcpt->scp_req_pool_misses;
+		nocopy += svcpt->scp_early_nocopy;
+		copy += svcpt->scp_early_copy;
+		spin_unlock(&svcpt->scp_lock);
+	}
+
+	seq_printf(m, "req_buffers: %d\n", bufs);
+	seq_printf(m, "req_descs_cached: %d\n", cached);
+	seq_printf(m, "req_pool_hits: "LPU64"\n", hits);
+	seq_printf(m, "req_pool_misses: "LPU64"\n", misses);
+	seq_printf(m, "early_reply_nocopy: "LPU64"\n", nocopy);
+	return seq_printf(m, "early_reply_copy: "LPU64"\n", copy);
+}
+LPROC_SEQ_FOPS_RO(ptlrpc_lprocfs_req_buffer_pool);
+
 static int
 ptlrpc_lprocfs_req_history_max_seq_show(struct seq_file *m, void *n)
 {
@@ -1087,6 +1121,9 @@ void ptlrpc_lprocfs_register_service(struct proc_dir_entry *entry,
 		{ .name = "req_buffer_history_max",
 		  .fops	= &ptlrpc_lprocfs_req_history_max_fops,
 		  .data	= svc },
+		{ .name = "req_buffer_pool",
+		  .fops	= &ptlrpc_lprocfs_req_buffer_pool_fops,
+		  .data	= svc },
 		{ .name = "threads_min",
 		  .fops = &ptlrpc_lprocfs_threads_min_fops,
 		  .data = svc },
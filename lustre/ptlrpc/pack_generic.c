@@ -354,6 +354,8 @@ int lustre_pack_reply_v2(struct ptlrpc_request *req, int count,
 	INIT_LIST_HEAD(&rs->rs_exp_list);
 	INIT_LIST_HEAD(&rs->rs_obd_list);
 	INIT_LIST_HEAD(&rs->rs_list);
+	rs->rs_hr_next = NULL;
+	rs->rs_commit_next = NULL;
 	spin_lock_init(&rs->rs_lock);
 
         req->rq_replen = msg_len;
@@ -1863,6 +1865,19 @@ void lustre_swab_mdt_body (struct mdt_body *b)
 	CLASSERT(offsetof(typeof(*b), mbo_padding_5) != 0);
 }
 
+void lustre_swab_mdt_batch_getattr_rep(struct mdt_batch_getattr_rep *r)
+{
+	__swab32s(&r->mbgr_rc);
+	CLASSERT(offsetof(typeof(*r), mbgr_padding) != 0);
+	lustre_swab_mdt_body(&r->mbgr_body);
+}
+
+void lustre_swab_mdt_batch_lock_rep(struct mdt_batch_lock_rep *r)
+{
+	/* lustre_handle is opaque */
+	__swab64s(&r->mblr_bits);
+}
+
 void lustre_swab_mdt_ioepoch(struct mdt_ioepoch *b)
 {
 	/* mio_handle is opaque */
@@ -2181,6 +2196,142 @@ void lustre_swab_lov_user_md_v3(struct lov_user_md_v3 *lum)
 }
 EXPORT_SYMBOL(lustre_swab_lov_user_md_v3);
 
+/**
+ * Check that the entry table of composite layout \a lum and every v1/v3
+ * blob it points to, including the stripe objects, lie within \a buflen
+ * bytes.  \a cpu_endian tells whether \a lum is in host byte order.
+ */
+static bool lov_comp_md_fits(struct lov_comp_md_v1 *lum, size_t buflen,
+			     bool cpu_endian)
+{
+	struct lov_comp_md_entry_v1	*ent;
+	struct lov_user_md_v1		*v1;
+	__u32				 magic, off, size, hdr;
+	__u16				 ent_count, stripe_count;
+	int				 i;
+
+	if (buflen < sizeof(*lum))
+		return false;
+
+	ent_count = lum->lcm_entry_count;
+	if (!cpu_endian)
+		__swab16s(&ent_count);
+	if (buflen < offsetof(struct lov_comp_md_v1, lcm_entries[ent_count]))
+		return false;
+
+	for (i = 0; i < ent_count; i++) {
+		ent = &lum->lcm_entries[i];
+		off = ent->lcme_offset;
+		size = ent->lcme_size;
+		if (!cpu_endian) {
+			__swab32s(&off);
+			__swab32s(&size);
+		}
+		if (off > buflen || size > buflen - off || size < sizeof(*v1))
+			return false;
+
+		v1 = (struct lov_user_md_v1 *)((char *)lum + off);
+		magic = v1->lmm_magic;
+		stripe_count = v1->lmm_stripe_count;
+		if (!cpu_endian) {
+			__swab32s(&magic);
+			__swab16s(&stripe_count);
+		}
+		if (magic == LOV_USER_MAGIC_V3)
+			hdr = sizeof(struct lov_user_md_v3);
+		else
+			hdr = sizeof(*v1);
+		if (size < hdr)
+			return false;
+		if (size > hdr && (size - hdr) / sizeof(v1->lmm_objects[0]) <
+				  stripe_count)
+			return false;
+	}
+
+	return true;
+}
+
+/**
+ * Swab a composite layout, including the component entries and the plain
+ * v1/v3 blobs they point to.  Works in both directions: the entry count and
+ * offsets are read in host order either before or after swabbing the header.
+ * A layout that does not fit in \a buflen bytes is left untouched.
+ */
+void lustre_swab_lov_comp_md_v1(struct lov_comp_md_v1 *lum, size_t buflen)
+{
+	struct lov_comp_md_entry_v1	*ent;
+	struct lov_user_md_v1		*v1;
+	struct lov_user_md_v3		*v3;
+	bool				 cpu_endian;
+	__u32				 off, size;
+	__u16				 ent_count, stripe_count;
+	int				 i;
+	ENTRY;
+
+	cpu_endian = buflen >= sizeof(*lum) &&
+		     lum->lcm_magic == LOV_USER_MAGIC_COMP_V1;
+	if (!lov_comp_md_fits(lum, buflen, cpu_endian)) {
+		CERROR("composite layout does not fit in %zu bytes\n", buflen);
+		RETURN_EXIT;
+	}
+
+	ent_count = lum->lcm_entry_count;
+	if (!cpu_endian)
+		__swab16s(&ent_count);
+
+	CDEBUG(D_IOCTL, "swabbing lov_user_comp_md v1\n");
+	__swab32s(&lum->lcm_magic);
+	__swab32s(&lum->lcm_size);
+	__swab32s(&lum->lcm_layout_gen);
+	__swab16s(&lum->lcm_flags);
+	__swab16s(&lum->lcm_entry_count);
+	__swab16s(&lum->lcm_mirror_count);
+	CLASSERT(offsetof(typeof(*lum), lcm_padding1) != 0);
+	CLASSERT(offsetof(typeof(*lum), lcm_padding2) != 0);
+
+	for (i = 0; i < ent_count; i++) {
+		ent = &lum->lcm_entries[i];
+		off = ent->lcme_offset;
+		size = ent->lcme_size;
+
+		if (!cpu_endian) {
+			__swab32s(&off);
+			__swab32s(&size);
+		}
+		__swab32s(&ent->lcme_id);
+		__swab32s(&ent->lcme_flags);
+		__swab64s(&ent->lcme_extent.e_start);
+		__swab64s(&ent->lcme_extent.e_end);
+		__swab32s(&ent->lcme_offset);
+		__swab32s(&ent->lcme_size);
+		CLASSERT(offsetof(typeof(*ent), lcme_padding) != 0);
+
+		v1 = (struct lov_user_md_v1 *)((char *)lum + off);
+		stripe_count = v1->lmm_stripe_count;
+		if (!cpu_endian)
+			__swab16s(&stripe_count);
+
+		if (v1->lmm_magic == __swab32(LOV_USER_MAGIC_V1) ||
+		    v1->lmm_magic == LOV_USER_MAGIC_V1) {
+			lustre_swab_lov_user_md_v1(v1);
+			if (size > sizeof(*v1))
+				lustre_swab_lov_user_md_objects(v1->lmm_objects,
+								stripe_count);
+		} else if (v1->lmm_magic == __swab32(LOV_USER_MAGIC_V3) ||
+			   v1->lmm_magic == LOV_USER_MAGIC_V3) {
+			v3 = (struct lov_user_md_v3 *)v1;
+			lustre_swab_lov_user_md_v3(v3);
+			if (size > sizeof(*v3))
+				lustre_swab_lov_user_md_objects(v3->lmm_objects,
+								stripe_count);
+		} else {
+			CERROR("Invalid magic %#x\n", v1->lmm_magic);
+		}
+	}
+	EXIT;
+}
+EXPORT_SYMBOL(lustre_swab_lov_comp_md_v1);
+
 void lustre_swab_lov_mds_md(struct lov_mds_md *lmm)
 {
 	ENTRY;
@@ -2247,6 +2398,8 @@ void lustre_swab_ldlm_lock_desc (struct ldlm_lock_desc *l)
         __swab32s (&l->l_req_mode);
         __swab32s (&l->l_granted_mode);
         lustre_swab_ldlm_policy_data (&l->l_policy_data);
+	CLASSERT(offsetof(typeof(*l), l_padding1) != 0);
+	CLASSERT(offsetof(typeof(*l), l_padding2) != 0);
 }
 
 void lustre_swab_ldlm_request (struct ldlm_request *rq)
@@ -2267,6 +2420,20 @@ void lustre_swab_ldlm_reply (struct ldlm_reply *r)
         __swab64s (&r->lock_policy_res2);
 }
 
+void lustre_swab_ldlm_replay_desc(struct ldlm_replay_desc *d)
+{
+	/* lrd_handle opaque */
+	lustre_swab_ldlm_lock_desc(&d->lrd_desc);
+	__swab64s(&d->lrd_flags);
+}
+
+void lustre_swab_ldlm_replay_rep(struct ldlm_replay_rep *r)
+{
+	/* lrp_handle opaque */
+	__swab32s(&r->lrp_status);
+	CLASSERT(offsetof(typeof(*r), lrp_padding) != 0);
+}
+
 void lustre_swab_quota_body(struct quota_body *b)
 {
 	lustre_swab_lu_fid(&b->qb_fid);
@@ -57,6 +57,7 @@
 
 #include <linux/kthread.h>
 #include <libcfs/libcfs.h>
+#include <libcfs/libcfs_hash.h> /* hash_long() */
 #include <lustre_net.h>
 #include <lustre_lib.h>
 #include <lustre_ha.h>
@@ -136,12 +137,34 @@ static char *ptlrpcd_cpts;
 CFS_MODULE_PARM(ptlrpcd_cpts, "s", charp, 0644,
 		"CPU partitions ptlrpcd threads should run in");
 
+/*
+ * ptlrpcd_steal_xcpt: The minimum number of queued async RPCs a ptlrpcd
+ * thread in another CPT must have before an idle thread, which found no
+ * work on its partners, takes some of them. 0 disables stealing across
+ * CPTs.
+ */
+static int ptlrpcd_steal_xcpt = 4;
+CFS_MODULE_PARM(ptlrpcd_steal_xcpt, "i", int, 0644,
+		"Min queued RPCs before stealing from another CPT (0 = never)");
+
+/*
+ * ptlrpcd_import_affinity: If set, async RPCs of an import are queued on
+ * the same ptlrpcd thread of the submitting CPT instead of being spread
+ * round-robin, so the import's state stays in that thread's cache.
+ * Partners still take work from a busy thread when they are idle.
+ */
+static int ptlrpcd_import_affinity;
+CFS_MODULE_PARM(ptlrpcd_import_affinity, "i", int, 0644,
+		"Queue async RPCs of one import on the same ptlrpcd thread");
+
 /* ptlrpcds_cpt_idx maps cpt numbers to an index in the ptlrpcds array. */
 static int		*ptlrpcds_cpt_idx;
 
 /* ptlrpcds_num is the number of entries in the ptlrpcds array. */
 static int		ptlrpcds_num;
 static struct ptlrpcd	**ptlrpcds;
+/* Set once all ptlrpcds are started, cross-CPT stealing is allowed. */
+static int		ptlrpcds_started;
 
 /*
  * In addition to the regular thread pool above, there is a single
@@ -181,6 +204,12 @@ ptlrpcd_select_pc(struct ptlrpc_request *req)
 		idx = ptlrpcds_cpt_idx[cpt];
 	pd = ptlrpcds[idx];
 
+	if (ptlrpcd_import_affinity && req != NULL && req->rq_import != NULL) {
+		idx = hash_long((unsigned long)req->rq_import, BITS_PER_LONG) %
+		      pd->pd_nthreads;
+		return &pd->pd_threads[idx];
+	}
+
 	/* We do not care whether it is strict load balance. */
 	idx = pd->pd_cursor;
 	if (++idx == pd->pd_nthreads)
@@ -231,33 +260,105 @@ void ptlrpcd_add_rqset(struct ptlrpc_request_set *set)
 	}
 }
 
+static inline void ptlrpc_reqset_get(struct ptlrpc_request_set *set)
+{
+	atomic_inc(&set->set_refcount);
+}
+
 /**
+ * Move the older half of the new requests queued on \a src to \a des,
+ * the owner of \a src keeps the rest so that both threads have work.
+ * Nothing is moved if fewer than \a min requests are queued.
+ *
  * Return transferred RPCs count.
  */
 static int ptlrpcd_steal_rqset(struct ptlrpc_request_set *des,
-                               struct ptlrpc_request_set *src)
+			       struct ptlrpc_request_set *src, int min)
 {
 	struct list_head *tmp, *pos;
 	struct ptlrpc_request *req;
+	int count;
 	int rc = 0;
 
 	spin_lock(&src->set_new_req_lock);
-	if (likely(!list_empty(&src->set_new_requests))) {
+	count = atomic_read(&src->set_new_count);
+	if (likely(!list_empty(&src->set_new_requests)) && count >= min) {
+		count = (count + 1) / 2;
 		list_for_each_safe(pos, tmp, &src->set_new_requests) {
+			if (rc == count)
+				break;
 			req = list_entry(pos, struct ptlrpc_request,
 					 rq_set_chain);
 			req->rq_set = des;
+			list_move_tail(&req->rq_set_chain, &des->set_requests);
+			rc++;
 		}
-		list_splice_init(&src->set_new_requests,
-				 &des->set_requests);
-		rc = atomic_read(&src->set_new_count);
 		atomic_add(rc, &des->set_remaining);
-		atomic_set(&src->set_new_count, 0);
+		if (list_empty(&src->set_new_requests))
+			atomic_set(&src->set_new_count, 0);
+		else
+			atomic_sub(rc, &src->set_new_count);
 	}
 	spin_unlock(&src->set_new_req_lock);
 	return rc;
 }
 
+/**
+ * Take some new requests of \a victim onto the set of \a pc.
+ *
+ * Return transferred RPCs count.
+ */
+static int ptlrpcd_steal(struct ptlrpcd_ctl *pc, struct ptlrpcd_ctl *victim,
+			 int min)
+{
+	struct ptlrpc_request_set *ps;
+	int rc = 0;
+
+	spin_lock(&victim->pc_lock);
+	ps = victim->pc_set;
+	if (ps == NULL) {
+		spin_unlock(&victim->pc_lock);
+		return 0;
+	}
+
+	ptlrpc_reqset_get(ps);
+	spin_unlock(&victim->pc_lock);
+
+	if (atomic_read(&ps->set_new_count) >= min) {
+		rc = ptlrpcd_steal_rqset(pc->pc_set, ps, min);
+		if (rc > 0)
+			CDEBUG(D_RPCTRACE, "transfer %d async RPCs [%s->%s]\n",
+			       rc, victim->pc_name, pc->pc_name);
+	}
+	ptlrpc_reqset_put(ps);
+
+	return rc;
+}
+
+/**
+ * Look at one ptlrpcd thread of another CPT per call, and take some of
+ * its new requests if it has a backlog of at least ptlrpcd_steal_xcpt.
+ *
+ * Return transferred RPCs count.
+ */
+static int ptlrpcd_steal_xcpt_one(struct ptlrpcd_ctl *pc)
+{
+	struct ptlrpcd	*pd;
+	int		min = ptlrpcd_steal_xcpt;
+	unsigned int	idx;
+
+	if (min <= 0 || ptlrpcds_num < 2 || !ptlrpcds_started)
+		return 0;
+
+	idx = pc->pc_xcursor++;
+	pd = ptlrpcds[idx % ptlrpcds_num];
+	if (pd->pd_cpt == pc->pc_cpt)
+		return 0;
+
+	idx = (idx / ptlrpcds_num) % pd->pd_nthreads;
+	return ptlrpcd_steal(pc, &pd->pd_threads[idx], min);
+}
+
 /**
  * Requests that are added to the ptlrpcd queue are sent via
  * ptlrpcd_check->ptlrpc_check_set().
@@ -301,11 +402,6 @@ void ptlrpcd_add_req(struct ptlrpc_request *req)
 }
 EXPORT_SYMBOL(ptlrpcd_add_req);
 
-static inline void ptlrpc_reqset_get(struct ptlrpc_request_set *set)
-{
-	atomic_inc(&set->set_refcount);
-}
-
 /**
  * Check if there is more work to do on ptlrpcd set.
  * Returns 1 if yes.
@@ -379,7 +475,6 @@ static int ptlrpcd_check(struct lu_env *env, struct ptlrpcd_ctl *pc)
                  * work from our partner threads. */
                 if (rc == 0 && pc->pc_npartners > 0) {
                         struct ptlrpcd_ctl *partner;
-                        struct ptlrpc_request_set *ps;
                         int first = pc->pc_cursor;
 
                         do {
@@ -389,26 +484,16 @@ static int ptlrpcd_check(struct lu_env *env, struct ptlrpcd_ctl *pc)
                                 if (partner == NULL)
                                         continue;
 
-				spin_lock(&partner->pc_lock);
-				ps = partner->pc_set;
-				if (ps == NULL) {
-					spin_unlock(&partner->pc_lock);
-					continue;
-				}
-
-				ptlrpc_reqset_get(ps);
-				spin_unlock(&partner->pc_lock);
-
-				if (atomic_read(&ps->set_new_count)) {
-					rc = ptlrpcd_steal_rqset(set, ps);
-					if (rc > 0)
-						CDEBUG(D_RPCTRACE, "transfer %d"
-						       " async RPCs [%d->%d]\n",
-						       rc, partner->pc_index,
-						       pc->pc_index);
-				}
-				ptlrpc_reqset_put(ps);
+				rc = ptlrpcd_steal(pc, partner, 1);
 			} while (rc == 0 && pc->pc_cursor != first);
+			pc->pc_nstolen += rc;
+		}
+
+		/* Partners are idle too, help a busy thread elsewhere. The
+		 * recovery thread keeps to its own work. */
+		if (rc == 0 && pc->pc_index >= 0) {
+			rc = ptlrpcd_steal_xcpt_one(pc);
+			pc->pc_nstolen_xcpt += rc;
 		}
 	}
 
@@ -526,6 +611,8 @@ static void ptlrpcd_ctl_init(struct ptlrpcd_ctl *pc, int index, int cpt)
 
 	pc->pc_index = index;
 	pc->pc_cpt = cpt;
+	pc->pc_nstolen = 0;
+	pc->pc_nstolen_xcpt = 0;
 	init_completion(&pc->pc_starting);
 	init_completion(&pc->pc_finishing);
 	spin_lock_init(&pc->pc_lock);
@@ -695,6 +782,47 @@ out:
         EXIT;
 }
 
+static void ptlrpcd_stats_show_one(struct seq_file *m, struct ptlrpcd_ctl *pc)
+{
+	int queued = 0;
+	int active = 0;
+
+	spin_lock(&pc->pc_lock);
+	if (pc->pc_set != NULL) {
+		queued = atomic_read(&pc->pc_set->set_new_count);
+		active = atomic_read(&pc->pc_set->set_remaining);
+	}
+	spin_unlock(&pc->pc_lock);
+
+	seq_printf(m, "%-16s %4d %8d %8d %12llu %12llu\n", pc->pc_name,
+		   pc->pc_cpt, queued, active, pc->pc_nstolen,
+		   pc->pc_nstolen_xcpt);
+}
+
+/*
+ * Per-thread queue depths, to see how evenly async RPCs are spread:
+ * "queued" RPCs are not yet picked up by the thread, "active" RPCs
+ * are in its set being sent or interpreted.
+ */
+static int ptlrpcd_stats_seq_show(struct seq_file *m, void *v)
+{
+	int i;
+	int j;
+
+	seq_printf(m, "%-16s %4s %8s %8s %12s %12s\n", "thread", "cpt",
+		   "queued", "active", "stolen", "stolen_xcpt");
+
+	/* The proc entry only exists while all ptlrpcds are started, and
+	 * ptlrpcd_fini() removes it before freeing anything. */
+	for (i = 0; i < ptlrpcds_num; i++)
+		for (j = 0; j < ptlrpcds[i]->pd_nthreads; j++)
+			ptlrpcd_stats_show_one(m, &ptlrpcds[i]->pd_threads[j]);
+	ptlrpcd_stats_show_one(m, &ptlrpcd_rcv);
+
+	return 0;
+}
+LPROC_SEQ_FOPS_RO(ptlrpcd_stats);
+
 static void ptlrpcd_fini(void)
 {
 	int	i;
@@ -702,14 +830,29 @@ static void ptlrpcd_fini(void)
 	int	ncpts;
 	ENTRY;
 
+	if (ptlrpcds_started) {
+		lprocfs_remove_proc_entry("ptlrpcd_stats", proc_lustre_root);
+		ptlrpcds_started = 0;
+	}
+
 	if (ptlrpcds != NULL) {
+		/* Threads may steal from other CPTs until they are stopped,
+		 * so stop all of them before freeing any ptlrpcd. */
 		for (i = 0; i < ptlrpcds_num; i++) {
 			if (ptlrpcds[i] == NULL)
 				break;
 			for (j = 0; j < ptlrpcds[i]->pd_nthreads; j++)
 				ptlrpcd_stop(&ptlrpcds[i]->pd_threads[j], 0);
+		}
+		for (i = 0; i < ptlrpcds_num; i++) {
+			if (ptlrpcds[i] == NULL)
+				break;
 			for (j = 0; j < ptlrpcds[i]->pd_nthreads; j++)
 				ptlrpcd_free(&ptlrpcds[i]->pd_threads[j]);
+		}
+		for (i = 0; i < ptlrpcds_num; i++) {
+			if (ptlrpcds[i] == NULL)
+				break;
 			OBD_FREE(ptlrpcds[i], ptlrpcds[i]->pd_size);
 			ptlrpcds[i] = NULL;
 		}
@@ -942,6 +1085,14 @@ static int ptlrpcd_init(void)
 				GOTO(out, rc);
 		}
 	}
+
+	ptlrpcds_started = 1;
+	rc = lprocfs_seq_create(proc_lustre_root, "ptlrpcd_stats", 0444,
+				&ptlrpcd_stats_fops, NULL);
+	if (rc != 0) {
+		CWARN("Failed to create ptlrpcd_stats: rc = %d\n", rc);
+		rc = 0;
+	}
 out:
 	if (rc != 0)
 		ptlrpcd_fini();
@@ -65,6 +65,12 @@ static int ptlrpc_server_post_idle_rqbds(struct ptlrpc_service_part *svcpt);
 static void ptlrpc_server_hpreq_fini(struct ptlrpc_request *req);
 static void ptlrpc_at_remove_timed(struct ptlrpc_request *req);
 
+/**
+ * Max # of free request descriptors each service partition keeps around for
+ * incoming requests, instead of returning them to the slab.
+ */
+#define PTLRPC_SVC_REQ_POOL_MAX		512
+
 /** Holds a list of all PTLRPC services */
 struct list_head ptlrpc_all_services;
 /** Used to protect the \e ptlrpc_all_services list */
@@ -117,6 +123,52 @@ ptlrpc_free_rqbd(struct ptlrpc_request_buffer_desc *rqbd)
 	OBD_FREE_PTR(rqbd);
 }
 
+/**
+ * Get a zeroed request descriptor for an incoming request on \a svcpt.
+ *
+ * Descriptors of finished requests are cached per service partition, so
+ * at high request rates this avoids a GFP_ATOMIC slab allocation from the
+ * LNet callback and keeps the descriptors local to the partition's CPUs.
+ */
+struct ptlrpc_request *
+ptlrpc_server_request_alloc(struct ptlrpc_service_part *svcpt)
+{
+	struct ptlrpc_request *req = NULL;
+
+	spin_lock(&svcpt->scp_lock);
+	if (!list_empty(&svcpt->scp_req_pool)) {
+		req = list_entry(svcpt->scp_req_pool.next,
+				 struct ptlrpc_request, rq_list);
+		list_del(&req->rq_list);
+		svcpt->scp_nreqs_pool--;
+		svcpt->scp_req_pool_hits++;
+	} else {
+		svcpt->scp_req_pool_misses++;
+	}
+	spin_unlock(&svcpt->scp_lock);
+
+	if (req == NULL)
+		return ptlrpc_request_cache_alloc(GFP_ATOMIC);
+
+	memset(req, 0, sizeof(*req));
+	return req;
+}
+
+static void ptlrpc_server_request_release(struct ptlrpc_service_part *svcpt,
+					  struct ptlrpc_request *req)
+{
+	spin_lock(&svcpt->scp_lock);
+	if (svcpt->scp_nreqs_pool < PTLRPC_SVC_REQ_POOL_MAX) {
+		list_add(&req->rq_list, &svcpt->scp_req_pool);
+		svcpt->scp_nreqs_pool++;
+		req = NULL;
+	}
+	spin_unlock(&svcpt->scp_lock);
+
+	if (req != NULL)
+		ptlrpc_request_cache_free(req);
+}
+
 static int
 ptlrpc_grow_req_bufs(struct ptlrpc_service_part *svcpt, int post)
 {
@@ -207,9 +259,10 @@ struct ptlrpc_hr_partition;
 
 struct ptlrpc_hr_thread {
 	int				hrt_id;		/* thread ID */
-	spinlock_t			hrt_lock;
 	wait_queue_head_t		hrt_waitq;
-	struct list_head			hrt_queue;	/* RS queue */
+	/* lockless RS queue, pushed by many producers, drained by this
+	 * thread only, linked through rs_hr_next (LIFO) */
+	struct ptlrpc_reply_state	*hrt_head;
 	struct ptlrpc_hr_partition	*hrt_partition;
 };
 
@@ -244,7 +297,9 @@ struct ptlrpc_hr_service {
 };
 
 struct rs_batch {
-	struct list_head			rsb_replies;
+	/* chain of batched replies linked through rs_hr_next */
+	struct ptlrpc_reply_state	*rsb_head;
+	struct ptlrpc_reply_state	*rsb_tail;
 	unsigned int			rsb_n_replies;
 	struct ptlrpc_service_part	*rsb_svcpt;
 };
@@ -265,7 +320,6 @@ static struct ptlrpc_hr_service		ptlrpc_hr;
 static void rs_batch_init(struct rs_batch *b)
 {
 	memset(b, 0, sizeof *b);
-	INIT_LIST_HEAD(&b->rsb_replies);
 }
 
 /**
@@ -293,6 +347,29 @@ ptlrpc_hr_select(struct ptlrpc_service_part *svcpt)
 	return &hrp->hrp_thrs[rotor % hrp->hrp_nthrs];
 }
 
+/**
+ * Push a chain of replies \a head ... \a tail (linked through rs_hr_next)
+ * onto the queue of reply handling thread \a hrt without taking any lock.
+ *
+ * The thread is only woken up when the queue goes from empty to non-empty,
+ * if the queue was not empty the thread has not drained it yet and will
+ * find the new replies on its next pass.
+ */
+static void ptlrpc_hr_push(struct ptlrpc_hr_thread *hrt,
+			   struct ptlrpc_reply_state *head,
+			   struct ptlrpc_reply_state *tail)
+{
+	struct ptlrpc_reply_state *first;
+
+	do {
+		first = ACCESS_ONCE(hrt->hrt_head);
+		tail->rs_hr_next = first;
+	} while (cmpxchg(&hrt->hrt_head, first, head) != first);
+
+	if (first == NULL)
+		wake_up(&hrt->hrt_waitq);
+}
+
 /**
  * Dispatch all replies accumulated in the batch to one from
  * dedicated reply handling threads.
@@ -305,12 +382,10 @@ static void rs_batch_dispatch(struct rs_batch *b)
 		struct ptlrpc_hr_thread	*hrt;
 
 		hrt = ptlrpc_hr_select(b->rsb_svcpt);
+		ptlrpc_hr_push(hrt, b->rsb_head, b->rsb_tail);
 
-		spin_lock(&hrt->hrt_lock);
-		list_splice_init(&b->rsb_replies, &hrt->hrt_queue);
-		spin_unlock(&hrt->hrt_lock);
-
-		wake_up(&hrt->hrt_waitq);
+		b->rsb_head = NULL;
+		b->rsb_tail = NULL;
 		b->rsb_n_replies = 0;
 	}
 }
@@ -336,12 +411,17 @@ static void rs_batch_add(struct rs_batch *b, struct ptlrpc_reply_state *rs)
 	}
 	spin_lock(&rs->rs_lock);
 	rs->rs_scheduled_ever = 1;
-	if (rs->rs_scheduled == 0) {
-		list_move(&rs->rs_list, &b->rsb_replies);
+	/* a reply handled since ptlrpc_commit_replies() found it is done
+	 * with, or will be scheduled again when it is off the net */
+	if (rs->rs_scheduled == 0 && !rs->rs_handled) {
+		list_del_init(&rs->rs_list);
+		rs->rs_hr_next = b->rsb_head;
+		b->rsb_head = rs;
+		if (b->rsb_tail == NULL)
+			b->rsb_tail = rs;
 		rs->rs_scheduled = 1;
 		b->rsb_n_replies++;
 	}
-	rs->rs_committed = 1;
 	spin_unlock(&rs->rs_lock);
 }
 
@@ -375,12 +455,7 @@ void ptlrpc_dispatch_difficult_reply(struct ptlrpc_reply_state *rs)
 	LASSERT(list_empty(&rs->rs_list));
 
 	hrt = ptlrpc_hr_select(rs->rs_svcpt);
-
-	spin_lock(&hrt->hrt_lock);
-	list_add_tail(&rs->rs_list, &hrt->hrt_queue);
-	spin_unlock(&hrt->hrt_lock);
-
-	wake_up(&hrt->hrt_waitq);
+	ptlrpc_hr_push(hrt, rs, rs);
 	EXIT;
 }
 
@@ -408,28 +483,48 @@ EXPORT_SYMBOL(ptlrpc_schedule_difficult_reply);
 
 void ptlrpc_commit_replies(struct obd_export *exp)
 {
-        struct ptlrpc_reply_state *rs, *nxt;
-        DECLARE_RS_BATCH(batch);
-        ENTRY;
-
-        rs_batch_init(&batch);
-        /* Find any replies that have been committed and get their service
-         * to attend to complete them. */
+	struct ptlrpc_reply_state *rs, *nxt;
+	struct ptlrpc_reply_state *head = NULL;
+	struct ptlrpc_reply_state **tail = &head;
+	DECLARE_RS_BATCH(batch);
+	ENTRY;
 
-        /* CAVEAT EMPTOR: spinlock ordering!!! */
+	rs_batch_init(&batch);
+	/* Find any replies that have been committed and get their service
+	 * to attend to complete them.
+	 *
+	 * They are only collected under exp_uncommitted_replies_lock, with a
+	 * reference, and batched under scp_rep_lock once it is dropped.
+	 * rs_committed is set here so that ptlrpc_handle_rs() does not look
+	 * for them on the export list, see there. */
 	spin_lock(&exp->exp_uncommitted_replies_lock);
 	list_for_each_entry_safe(rs, nxt, &exp->exp_uncommitted_replies,
-                                     rs_obd_list) {
-                LASSERT (rs->rs_difficult);
-                /* VBR: per-export last_committed */
-                LASSERT(rs->rs_export);
-                if (rs->rs_transno <= exp->exp_last_committed) {
-			list_del_init(&rs->rs_obd_list);
-                        rs_batch_add(&batch, rs);
-                }
-        }
+				 rs_obd_list) {
+		LASSERT(rs->rs_difficult);
+		/* VBR: per-export last_committed */
+		LASSERT(rs->rs_export);
+		if (rs->rs_transno > exp->exp_last_committed)
+			continue;
+
+		list_del_init(&rs->rs_obd_list);
+		spin_lock(&rs->rs_lock);
+		rs->rs_committed = 1;
+		spin_unlock(&rs->rs_lock);
+		ptlrpc_rs_addref(rs);
+		*tail = rs;
+		tail = &rs->rs_commit_next;
+	}
+	*tail = NULL;
 	spin_unlock(&exp->exp_uncommitted_replies_lock);
+
+	for (rs = head; rs != NULL; rs = rs->rs_commit_next)
+		rs_batch_add(&batch, rs);
 	rs_batch_fini(&batch);
+
+	for (rs = head; rs != NULL; rs = nxt) {
+		nxt = rs->rs_commit_next;
+		ptlrpc_rs_decref(rs);
+	}
 	EXIT;
 }
 
@@ -612,6 +707,7 @@ ptlrpc_service_part_init(struct ptlrpc_service *svc,
 	spin_lock_init(&svcpt->scp_lock);
 	INIT_LIST_HEAD(&svcpt->scp_rqbd_idle);
 	INIT_LIST_HEAD(&svcpt->scp_rqbd_posted);
+	INIT_LIST_HEAD(&svcpt->scp_req_pool);
 	INIT_LIST_HEAD(&svcpt->scp_req_incoming);
 	init_waitqueue_head(&svcpt->scp_waitq);
 	/* history request & rqbd list */
@@ -849,7 +945,7 @@ static void ptlrpc_server_free_request(struct ptlrpc_request *req)
 		/* NB request buffers use an embedded
 		 * req if the incoming req unlinked the
 		 * MD; this isn't one of them! */
-		ptlrpc_request_cache_free(req);
+		ptlrpc_server_request_release(req->rq_rqbd->rqbd_svcpt, req);
 	}
 }
 
@@ -1261,7 +1357,7 @@ static int ptlrpc_at_send_early_reply(struct ptlrpc_request *req)
 {
 	struct ptlrpc_service_part *svcpt = req->rq_rqbd->rqbd_svcpt;
 	struct ptlrpc_request *reqcopy;
-	struct lustre_msg *reqmsg;
+	struct lustre_msg *reqmsg = NULL;
 	cfs_duration_t olddl = req->rq_deadline - cfs_time_current_sec();
 	time_t	newdl;
 	int rc;
@@ -1340,9 +1436,24 @@ static int ptlrpc_at_send_early_reply(struct ptlrpc_request *req)
 	reqcopy = ptlrpc_request_cache_alloc(GFP_NOFS);
 	if (reqcopy == NULL)
 		RETURN(-ENOMEM);
-	OBD_ALLOC_LARGE(reqmsg, req->rq_reqlen);
-	if (!reqmsg)
-		GOTO(out_free, rc = -ENOMEM);
+
+	/* The request message is only read while sending the early reply,
+	 * and the caller holds a reference on \a req which pins its request
+	 * buffer.  It may only be modified under us if the handler swabs it
+	 * in place, so only copy it for requests which need swabbing. */
+	if (ptlrpc_req_need_swab(req)) {
+		OBD_ALLOC_LARGE(reqmsg, req->rq_reqlen);
+		if (!reqmsg)
+			GOTO(out_free, rc = -ENOMEM);
+		memcpy(reqmsg, req->rq_reqmsg, req->rq_reqlen);
+	}
+
+	spin_lock(&svcpt->scp_lock);
+	if (reqmsg != NULL)
+		svcpt->scp_early_copy++;
+	else
+		svcpt->scp_early_nocopy++;
+	spin_unlock(&svcpt->scp_lock);
 
         *reqcopy = *req;
         reqcopy->rq_reply_state = NULL;
@@ -1351,9 +1462,9 @@ static int ptlrpc_at_send_early_reply(struct ptlrpc_request *req)
         reqcopy->rq_pack_udesc = 0;
         reqcopy->rq_packed_final = 0;
         sptlrpc_svc_ctx_addref(reqcopy);
-        /* We only need the reqmsg for the magic */
-        reqcopy->rq_reqmsg = reqmsg;
-        memcpy(reqmsg, req->rq_reqmsg, req->rq_reqlen);
+	/* We only need the reqmsg for the magic */
+	if (reqmsg != NULL)
+		reqcopy->rq_reqmsg = reqmsg;
 
 	/*
 	 * tgt_brw_read() and tgt_brw_write() may have decided not to reply.
@@ -1406,7 +1517,8 @@ out_put:
 	class_export_put(reqcopy->rq_export);
 out:
 	sptlrpc_svc_ctx_decref(reqcopy);
-	OBD_FREE_LARGE(reqmsg, req->rq_reqlen);
+	if (reqmsg != NULL)
+		OBD_FREE_LARGE(reqmsg, req->rq_reqlen);
 out_free:
 	ptlrpc_request_cache_free(reqcopy);
 	RETURN(rc);
@@ -2183,11 +2295,10 @@ ptlrpc_handle_rs(struct ptlrpc_reply_state *rs)
          * exp_uncommitted_replies.  Note that if we lose the race and the
          * reply has already been removed, list_del_init() is a noop.
          *
-         * If we see rs_committed set, we know the commit callback is handling,
-         * or has handled this reply since store reordering might allow us to
-         * see rs_committed set out of sequence.  But since this is done
-         * holding rs_lock, we can be sure it has all completed once we hold
-         * rs_lock, which we do right next.
+         * If we see rs_committed set, we know the commit callback has taken
+         * this reply off exp_uncommitted_replies.  It may still try to
+         * schedule it later, but rs_batch_add() leaves a reply alone once
+         * rs_handled is set, which we do right next under rs_lock.
          */
 	if (!rs->rs_committed) {
 		spin_lock(&exp->exp_uncommitted_replies_lock);
@@ -2561,15 +2672,22 @@ out:
 static int hrt_dont_sleep(struct ptlrpc_hr_thread *hrt,
 			  struct list_head *replies)
 {
-	int result;
-
-	spin_lock(&hrt->hrt_lock);
+	struct ptlrpc_reply_state *rs;
+	struct ptlrpc_reply_state *next;
 
-	list_splice_init(&hrt->hrt_queue, replies);
-	result = ptlrpc_hr.hr_stopping || !list_empty(replies);
+	/* detach the whole queue at once, producers keep pushing onto the
+	 * empty head and will wake us up again */
+	rs = xchg(&hrt->hrt_head, NULL);
+	while (rs != NULL) {
+		next = rs->rs_hr_next;
+		rs->rs_hr_next = NULL;
+		/* queue is newest first, so the oldest reply ends up at
+		 * replies.prev which is handled first */
+		list_add_tail(&rs->rs_list, replies);
+		rs = next;
+	}
 
-	spin_unlock(&hrt->hrt_lock);
-	return result;
+	return ptlrpc_hr.hr_stopping || !list_empty(replies);
 }
 
 /**
@@ -2929,8 +3047,7 @@ int ptlrpc_hr_init(void)
 			hrt->hrt_id = j;
 			hrt->hrt_partition = hrp;
 			init_waitqueue_head(&hrt->hrt_waitq);
-			spin_lock_init(&hrt->hrt_lock);
-			INIT_LIST_HEAD(&hrt->hrt_queue);
+			hrt->hrt_head = NULL;
 		}
 	}
 
@@ -3108,6 +3225,15 @@ ptlrpc_service_purge_all(struct ptlrpc_service *svc)
 					      rqbd_list);
 			ptlrpc_free_rqbd(rqbd);
 		}
+
+		while (!list_empty(&svcpt->scp_req_pool)) {
+			req = list_entry(svcpt->scp_req_pool.next,
+					 struct ptlrpc_request, rq_list);
+			list_del(&req->rq_list);
+			svcpt->scp_nreqs_pool--;
+			ptlrpc_request_cache_free(req);
+		}
+		LASSERT(svcpt->scp_nreqs_pool == 0);
 		ptlrpc_wait_replies(svcpt);
 
 		while (!list_empty(&svcpt->scp_rep_idle)) {
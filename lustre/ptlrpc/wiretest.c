@@ -176,7 +176,9 @@ void lustre_assert_wire_constants(void)
 		 (long long)MDS_HSM_CT_UNREGISTER);
 	LASSERTF(MDS_SWAP_LAYOUTS == 61, "found %lld\n",
 		 (long long)MDS_SWAP_LAYOUTS);
-	LASSERTF(MDS_LAST_OPC == 62, "found %lld\n",
+	LASSERTF(MDS_BATCH_GETATTR == 62, "found %lld\n",
+		 (long long)MDS_BATCH_GETATTR);
+	LASSERTF(MDS_LAST_OPC == 63, "found %lld\n",
 		 (long long)MDS_LAST_OPC);
 	LASSERTF(REINT_SETATTR == 1, "found %lld\n",
 		 (long long)REINT_SETATTR);
@@ -488,6 +490,26 @@ void lustre_assert_wire_constants(void)
 	LASSERTF((int)sizeof(((struct hsm_attrs *)0)->hsm_arch_ver) == 8, "found %lld\n",
 		 (long long)(int)sizeof(((struct hsm_attrs *)0)->hsm_arch_ver));
 
+	/* Checks for struct lustre_som_attrs */
+	LASSERTF((int)sizeof(struct lustre_som_attrs) == 24, "found %lld\n",
+		 (long long)(int)sizeof(struct lustre_som_attrs));
+	LASSERTF((int)offsetof(struct lustre_som_attrs, lsa_valid) == 0, "found %lld\n",
+		 (long long)(int)offsetof(struct lustre_som_attrs, lsa_valid));
+	LASSERTF((int)sizeof(((struct lustre_som_attrs *)0)->lsa_valid) == 2, "found %lld\n",
+		 (long long)(int)sizeof(((struct lustre_som_attrs *)0)->lsa_valid));
+	LASSERTF((int)offsetof(struct lustre_som_attrs, lsa_reserved) == 2, "found %lld\n",
+		 (long long)(int)offsetof(struct lustre_som_attrs, lsa_reserved));
+	LASSERTF((int)sizeof(((struct lustre_som_attrs *)0)->lsa_reserved) == 6, "found %lld\n",
+		 (long long)(int)sizeof(((struct lustre_som_attrs *)0)->lsa_reserved));
+	LASSERTF((int)offsetof(struct lustre_som_attrs, lsa_size) == 8, "found %lld\n",
+		 (long long)(int)offsetof(struct lustre_som_attrs, lsa_size));
+	LASSERTF((int)sizeof(((struct lustre_som_attrs *)0)->lsa_size) == 8, "found %lld\n",
+		 (long long)(int)sizeof(((struct lustre_som_attrs *)0)->lsa_size));
+	LASSERTF((int)offsetof(struct lustre_som_attrs, lsa_blocks) == 16, "found %lld\n",
+		 (long long)(int)offsetof(struct lustre_som_attrs, lsa_blocks));
+	LASSERTF((int)sizeof(((struct lustre_som_attrs *)0)->lsa_blocks) == 8, "found %lld\n",
+		 (long long)(int)sizeof(((struct lustre_som_attrs *)0)->lsa_blocks));
+
 	/* Checks for struct ost_id */
 	LASSERTF((int)sizeof(struct ost_id) == 16, "found %lld\n",
 		 (long long)(int)sizeof(struct ost_id));
@@ -1204,6 +1226,20 @@ void lustre_assert_wire_constants(void)
 		 OBD_CONNECT_OBDOPACK);
 	LASSERTF(OBD_CONNECT_FLAGS2 == 0x8000000000000000ULL, "found 0x%.16llxULL\n",
 		 OBD_CONNECT_FLAGS2);
+	LASSERTF(OBD_CONNECT2_BATCH_GETATTR == 0x1ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_BATCH_GETATTR);
+	LASSERTF(OBD_CONNECT2_LOCK_CONVERT == 0x4ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_LOCK_CONVERT);
+	LASSERTF(OBD_CONNECT2_BL_BATCH == 0x8ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_BL_BATCH);
+	LASSERTF(OBD_CONNECT2_LOCK_REPLAY_BATCH == 0x10ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_LOCK_REPLAY_BATCH);
+	LASSERTF(OBD_CONNECT2_DOM == 0x20ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_DOM);
+	LASSERTF(OBD_CONNECT2_BATCH_GETATTR_LOCK == 0x40ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_BATCH_GETATTR_LOCK);
+	LASSERTF(OBD_CONNECT2_BRW_COMPRESS == 0x80ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_BRW_COMPRESS);
 	LASSERTF(OBD_CKSUM_CRC32 == 0x00000001UL, "found 0x%.8xUL\n",
 		(unsigned)OBD_CKSUM_CRC32);
 	LASSERTF(OBD_CKSUM_ADLER == 0x00000002UL, "found 0x%.8xUL\n",
@@ -1420,6 +1456,10 @@ void lustre_assert_wire_constants(void)
 		 OBD_MD_FLRMTRGETFACL);
 	LASSERTF(OBD_MD_FLDATAVERSION == (0x0010000000000000ULL), "found 0x%.16llxULL\n",
 		 OBD_MD_FLDATAVERSION);
+	LASSERTF(OBD_MD_FLLAZYSIZE == (0x0080000000000000ULL), "found 0x%.16llxULL\n",
+		 OBD_MD_FLLAZYSIZE);
+	LASSERTF(OBD_MD_FLLAZYBLOCKS == (0x0100000000000000ULL), "found 0x%.16llxULL\n",
+		 OBD_MD_FLLAZYBLOCKS);
 	CLASSERT(OBD_FL_INLINEDATA == 0x00000001);
 	CLASSERT(OBD_FL_OBDMDEXISTS == 0x00000002);
 	CLASSERT(OBD_FL_DELORPHAN == 0x00000004);
@@ -1442,6 +1482,7 @@ void lustre_assert_wire_constants(void)
 	CLASSERT(OBD_FL_NOSPC_BLK == 0x00100000);
 	CLASSERT(OBD_FL_FLUSH == 0x00200000);
 	CLASSERT(OBD_FL_SHORT_IO == 0x00400000);
+	CLASSERT(OBD_FL_BRW_COMPRESS == 0x00800000);
 	CLASSERT(OBD_FL_LOCAL_MASK == 0xf0000000);
 
 	/* Checks for struct lov_ost_data_v1 */
@@ -1534,11 +1575,86 @@ void lustre_assert_wire_constants(void)
 		(unsigned)LOV_PATTERN_RAID0);
 	LASSERTF(LOV_PATTERN_RAID1 == 0x00000002UL, "found 0x%.8xUL\n",
 		(unsigned)LOV_PATTERN_RAID1);
-	LASSERTF(LOV_PATTERN_FIRST == 0x00000100UL, "found 0x%.8xUL\n",
-		(unsigned)LOV_PATTERN_FIRST);
+	LASSERTF(LOV_PATTERN_MDT == 0x00000100UL, "found 0x%.8xUL\n",
+		(unsigned)LOV_PATTERN_MDT);
 	LASSERTF(LOV_PATTERN_CMOBD == 0x00000200UL, "found 0x%.8xUL\n",
 		(unsigned)LOV_PATTERN_CMOBD);
 
+	/* Checks for struct lov_comp_md_entry_v1 */
+	LASSERTF((int)sizeof(struct lov_comp_md_entry_v1) == 48, "found %lld\n",
+		 (long long)(int)sizeof(struct lov_comp_md_entry_v1));
+	LASSERTF((int)offsetof(struct lov_comp_md_entry_v1, lcme_id) == 0, "found %lld\n",
+		 (long long)(int)offsetof(struct lov_comp_md_entry_v1, lcme_id));
+	LASSERTF((int)sizeof(((struct lov_comp_md_entry_v1 *)0)->lcme_id) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct lov_comp_md_entry_v1 *)0)->lcme_id));
+	LASSERTF((int)offsetof(struct lov_comp_md_entry_v1, lcme_flags) == 4, "found %lld\n",
+		 (long long)(int)offsetof(struct lov_comp_md_entry_v1, lcme_flags));
+	LASSERTF((int)sizeof(((struct lov_comp_md_entry_v1 *)0)->lcme_flags) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct lov_comp_md_entry_v1 *)0)->lcme_flags));
+	LASSERTF((int)offsetof(struct lov_comp_md_entry_v1, lcme_extent.e_start) == 8, "found %lld\n",
+		 (long long)(int)offsetof(struct lov_comp_md_entry_v1, lcme_extent.e_start));
+	LASSERTF((int)sizeof(((struct lov_comp_md_entry_v1 *)0)->lcme_extent.e_start) == 8, "found %lld\n",
+		 (long long)(int)sizeof(((struct lov_comp_md_entry_v1 *)0)->lcme_extent.e_start));
+	LASSERTF((int)offsetof(struct lov_comp_md_entry_v1, lcme_extent.e_end) == 16, "found %lld\n",
+		 (long long)(int)offsetof(struct lov_comp_md_entry_v1, lcme_extent.e_end));
+	LASSERTF((int)sizeof(((struct lov_comp_md_entry_v1 *)0)->lcme_extent.e_end) == 8, "found %lld\n",
+		 (long long)(int)sizeof(((struct lov_comp_md_entry_v1 *)0)->lcme_extent.e_end));
+	LASSERTF((int)offsetof(struct lov_comp_md_entry_v1, lcme_offset) == 24, "found %lld\n",
+		 (long long)(int)offsetof(struct lov_comp_md_entry_v1, lcme_offset));
+	LASSERTF((int)sizeof(((struct lov_comp_md_entry_v1 *)0)->lcme_offset) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct lov_comp_md_entry_v1 *)0)->lcme_offset));
+	LASSERTF((int)offsetof(struct lov_comp_md_entry_v1, lcme_size) == 28, "found %lld\n",
+		 (long long)(int)offsetof(struct lov_comp_md_entry_v1, lcme_size));
+	LASSERTF((int)sizeof(((struct lov_comp_md_entry_v1 *)0)->lcme_size) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct lov_comp_md_entry_v1 *)0)->lcme_size));
+	LASSERTF((int)offsetof(struct lov_comp_md_entry_v1, lcme_padding) == 32, "found %lld\n",
+		 (long long)(int)offsetof(struct lov_comp_md_entry_v1, lcme_padding));
+	LASSERTF((int)sizeof(((struct lov_comp_md_entry_v1 *)0)->lcme_padding) == 16, "found %lld\n",
+		 (long long)(int)sizeof(((struct lov_comp_md_entry_v1 *)0)->lcme_padding));
+	LASSERTF(LCME_FL_INIT == 0x00000010UL, "found 0x%.8xUL\n",
+		(unsigned)LCME_FL_INIT);
+
+	/* Checks for struct lov_comp_md_v1 */
+	LASSERTF((int)sizeof(struct lov_comp_md_v1) == 32, "found %lld\n",
+		 (long long)(int)sizeof(struct lov_comp_md_v1));
+	LASSERTF((int)offsetof(struct lov_comp_md_v1, lcm_magic) == 0, "found %lld\n",
+		 (long long)(int)offsetof(struct lov_comp_md_v1, lcm_magic));
+	LASSERTF((int)sizeof(((struct lov_comp_md_v1 *)0)->lcm_magic) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct lov_comp_md_v1 *)0)->lcm_magic));
+	LASSERTF((int)offsetof(struct lov_comp_md_v1, lcm_size) == 4, "found %lld\n",
+		 (long long)(int)offsetof(struct lov_comp_md_v1, lcm_size));
+	LASSERTF((int)sizeof(((struct lov_comp_md_v1 *)0)->lcm_size) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct lov_comp_md_v1 *)0)->lcm_size));
+	LASSERTF((int)offsetof(struct lov_comp_md_v1, lcm_layout_gen) == 8, "found %lld\n",
+		 (long long)(int)offsetof(struct lov_comp_md_v1, lcm_layout_gen));
+	LASSERTF((int)sizeof(((struct lov_comp_md_v1 *)0)->lcm_layout_gen) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct lov_comp_md_v1 *)0)->lcm_layout_gen));
+	LASSERTF((int)offsetof(struct lov_comp_md_v1, lcm_flags) == 12, "found %lld\n",
+		 (long long)(int)offsetof(struct lov_comp_md_v1, lcm_flags));
+	LASSERTF((int)sizeof(((struct lov_comp_md_v1 *)0)->lcm_flags) == 2, "found %lld\n",
+		 (long long)(int)sizeof(((struct lov_comp_md_v1 *)0)->lcm_flags));
+	LASSERTF((int)offsetof(struct lov_comp_md_v1, lcm_entry_count) == 14, "found %lld\n",
+		 (long long)(int)offsetof(struct lov_comp_md_v1, lcm_entry_count));
+	LASSERTF((int)sizeof(((struct lov_comp_md_v1 *)0)->lcm_entry_count) == 2, "found %lld\n",
+		 (long long)(int)sizeof(((struct lov_comp_md_v1 *)0)->lcm_entry_count));
+	LASSERTF((int)offsetof(struct lov_comp_md_v1, lcm_mirror_count) == 16, "found %lld\n",
+		 (long long)(int)offsetof(struct lov_comp_md_v1, lcm_mirror_count));
+	LASSERTF((int)sizeof(((struct lov_comp_md_v1 *)0)->lcm_mirror_count) == 2, "found %lld\n",
+		 (long long)(int)sizeof(((struct lov_comp_md_v1 *)0)->lcm_mirror_count));
+	LASSERTF((int)offsetof(struct lov_comp_md_v1, lcm_padding1) == 18, "found %lld\n",
+		 (long long)(int)offsetof(struct lov_comp_md_v1, lcm_padding1));
+	LASSERTF((int)sizeof(((struct lov_comp_md_v1 *)0)->lcm_padding1) == 6, "found %lld\n",
+		 (long long)(int)sizeof(((struct lov_comp_md_v1 *)0)->lcm_padding1));
+	LASSERTF((int)offsetof(struct lov_comp_md_v1, lcm_padding2) == 24, "found %lld\n",
+		 (long long)(int)offsetof(struct lov_comp_md_v1, lcm_padding2));
+	LASSERTF((int)sizeof(((struct lov_comp_md_v1 *)0)->lcm_padding2) == 8, "found %lld\n",
+		 (long long)(int)sizeof(((struct lov_comp_md_v1 *)0)->lcm_padding2));
+	LASSERTF((int)offsetof(struct lov_comp_md_v1, lcm_entries[0]) == 32, "found %lld\n",
+		 (long long)(int)offsetof(struct lov_comp_md_v1, lcm_entries[0]));
+	LASSERTF((int)sizeof(((struct lov_comp_md_v1 *)0)->lcm_entries[0]) == 48, "found %lld\n",
+		 (long long)(int)sizeof(((struct lov_comp_md_v1 *)0)->lcm_entries[0]));
+	CLASSERT(LOV_MAGIC_COMP_V1 == (0x0BD60000 | 0x0BD0));
+
 	/* Checks for struct lmv_mds_md_v1 */
 	LASSERTF((int)sizeof(struct lmv_mds_md_v1) == 56, "found %lld\n",
 		 (long long)(int)sizeof(struct lmv_mds_md_v1));
@@ -1969,6 +2085,20 @@ void lustre_assert_wire_constants(void)
 	LASSERTF(OBD_BRW_SOFT_SYNC == 0x4000, "found 0x%.8x\n",
 		OBD_BRW_SOFT_SYNC);
 
+	/* Checks for struct brw_chunk_hdr */
+	LASSERTF((int)sizeof(struct brw_chunk_hdr) == 8, "found %lld\n",
+		 (long long)(int)sizeof(struct brw_chunk_hdr));
+	LASSERTF((int)offsetof(struct brw_chunk_hdr, bch_len) == 0, "found %lld\n",
+		 (long long)(int)offsetof(struct brw_chunk_hdr, bch_len));
+	LASSERTF((int)sizeof(((struct brw_chunk_hdr *)0)->bch_len) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct brw_chunk_hdr *)0)->bch_len));
+	LASSERTF((int)offsetof(struct brw_chunk_hdr, bch_csize) == 4, "found %lld\n",
+		 (long long)(int)offsetof(struct brw_chunk_hdr, bch_csize));
+	LASSERTF((int)sizeof(((struct brw_chunk_hdr *)0)->bch_csize) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct brw_chunk_hdr *)0)->bch_csize));
+	LASSERTF(BRW_CHUNK_MAX_LEN == 65536, "found %lld\n",
+		 (long long)BRW_CHUNK_MAX_LEN);
+
 	/* Checks for struct ost_body */
 	LASSERTF((int)sizeof(struct ost_body) == 208, "found %lld\n",
 		 (long long)(int)sizeof(struct ost_body));
@@ -2198,6 +2328,8 @@ void lustre_assert_wire_constants(void)
 		MDS_INODELOCK_OPEN);
 	LASSERTF(MDS_INODELOCK_LAYOUT == 0x000008, "found 0x%.8x\n",
 		MDS_INODELOCK_LAYOUT);
+	LASSERTF(MDS_INODELOCK_DOM == 0x000040, "found 0x%.8x\n",
+		MDS_INODELOCK_DOM);
 
 	/* Checks for struct mdt_ioepoch */
 	LASSERTF((int)sizeof(struct mdt_ioepoch) == 24, "found %lld\n",
@@ -2219,6 +2351,34 @@ void lustre_assert_wire_constants(void)
 	LASSERTF((int)sizeof(((struct mdt_ioepoch *)0)->mio_padding) == 4, "found %lld\n",
 		 (long long)(int)sizeof(((struct mdt_ioepoch *)0)->mio_padding));
 
+	/* Checks for struct mdt_batch_getattr_rep */
+	LASSERTF((int)sizeof(struct mdt_batch_getattr_rep) == 224, "found %lld\n",
+		 (long long)(int)sizeof(struct mdt_batch_getattr_rep));
+	LASSERTF((int)offsetof(struct mdt_batch_getattr_rep, mbgr_rc) == 0, "found %lld\n",
+		 (long long)(int)offsetof(struct mdt_batch_getattr_rep, mbgr_rc));
+	LASSERTF((int)sizeof(((struct mdt_batch_getattr_rep *)0)->mbgr_rc) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct mdt_batch_getattr_rep *)0)->mbgr_rc));
+	LASSERTF((int)offsetof(struct mdt_batch_getattr_rep, mbgr_padding) == 4, "found %lld\n",
+		 (long long)(int)offsetof(struct mdt_batch_getattr_rep, mbgr_padding));
+	LASSERTF((int)sizeof(((struct mdt_batch_getattr_rep *)0)->mbgr_padding) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct mdt_batch_getattr_rep *)0)->mbgr_padding));
+	LASSERTF((int)offsetof(struct mdt_batch_getattr_rep, mbgr_body) == 8, "found %lld\n",
+		 (long long)(int)offsetof(struct mdt_batch_getattr_rep, mbgr_body));
+	LASSERTF((int)sizeof(((struct mdt_batch_getattr_rep *)0)->mbgr_body) == 216, "found %lld\n",
+		 (long long)(int)sizeof(((struct mdt_batch_getattr_rep *)0)->mbgr_body));
+
+	/* Checks for struct mdt_batch_lock_rep */
+	LASSERTF((int)sizeof(struct mdt_batch_lock_rep) == 16, "found %lld\n",
+		 (long long)(int)sizeof(struct mdt_batch_lock_rep));
+	LASSERTF((int)offsetof(struct mdt_batch_lock_rep, mblr_handle) == 0, "found %lld\n",
+		 (long long)(int)offsetof(struct mdt_batch_lock_rep, mblr_handle));
+	LASSERTF((int)sizeof(((struct mdt_batch_lock_rep *)0)->mblr_handle) == 8, "found %lld\n",
+		 (long long)(int)sizeof(((struct mdt_batch_lock_rep *)0)->mblr_handle));
+	LASSERTF((int)offsetof(struct mdt_batch_lock_rep, mblr_bits) == 8, "found %lld\n",
+		 (long long)(int)offsetof(struct mdt_batch_lock_rep, mblr_bits));
+	LASSERTF((int)sizeof(((struct mdt_batch_lock_rep *)0)->mblr_bits) == 8, "found %lld\n",
+		 (long long)(int)sizeof(((struct mdt_batch_lock_rep *)0)->mblr_bits));
+
 	/* Checks for struct mdt_remote_perm */
 	LASSERTF((int)sizeof(struct mdt_remote_perm) == 32, "found %lld\n",
 		 (long long)(int)sizeof(struct mdt_remote_perm));
@@ -3170,6 +3330,14 @@ void lustre_assert_wire_constants(void)
 		 (long long)(int)offsetof(struct ldlm_lock_desc, l_policy_data));
 	LASSERTF((int)sizeof(((struct ldlm_lock_desc *)0)->l_policy_data) == 32, "found %lld\n",
 		 (long long)(int)sizeof(((struct ldlm_lock_desc *)0)->l_policy_data));
+	LASSERTF((int)offsetof(struct ldlm_lock_desc, l_padding1) == 80, "found %lld\n",
+		 (long long)(int)offsetof(struct ldlm_lock_desc, l_padding1));
+	LASSERTF((int)sizeof(((struct ldlm_lock_desc *)0)->l_padding1) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct ldlm_lock_desc *)0)->l_padding1));
+	LASSERTF((int)offsetof(struct ldlm_lock_desc, l_padding2) == 84, "found %lld\n",
+		 (long long)(int)offsetof(struct ldlm_lock_desc, l_padding2));
+	LASSERTF((int)sizeof(((struct ldlm_lock_desc *)0)->l_padding2) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct ldlm_lock_desc *)0)->l_padding2));
 
 	/* Checks for struct ldlm_request */
 	LASSERTF((int)sizeof(struct ldlm_request) == 112, "found %lld\n",
@@ -3219,6 +3387,38 @@ void lustre_assert_wire_constants(void)
 	LASSERTF((int)sizeof(((struct ldlm_reply *)0)->lock_policy_res2) == 8, "found %lld\n",
 		 (long long)(int)sizeof(((struct ldlm_reply *)0)->lock_policy_res2));
 
+	/* Checks for struct ldlm_replay_desc */
+	LASSERTF((int)sizeof(struct ldlm_replay_desc) == 104, "found %lld\n",
+		 (long long)(int)sizeof(struct ldlm_replay_desc));
+	LASSERTF((int)offsetof(struct ldlm_replay_desc, lrd_handle) == 0, "found %lld\n",
+		 (long long)(int)offsetof(struct ldlm_replay_desc, lrd_handle));
+	LASSERTF((int)sizeof(((struct ldlm_replay_desc *)0)->lrd_handle) == 8, "found %lld\n",
+		 (long long)(int)sizeof(((struct ldlm_replay_desc *)0)->lrd_handle));
+	LASSERTF((int)offsetof(struct ldlm_replay_desc, lrd_desc) == 8, "found %lld\n",
+		 (long long)(int)offsetof(struct ldlm_replay_desc, lrd_desc));
+	LASSERTF((int)sizeof(((struct ldlm_replay_desc *)0)->lrd_desc) == 88, "found %lld\n",
+		 (long long)(int)sizeof(((struct ldlm_replay_desc *)0)->lrd_desc));
+	LASSERTF((int)offsetof(struct ldlm_replay_desc, lrd_flags) == 96, "found %lld\n",
+		 (long long)(int)offsetof(struct ldlm_replay_desc, lrd_flags));
+	LASSERTF((int)sizeof(((struct ldlm_replay_desc *)0)->lrd_flags) == 8, "found %lld\n",
+		 (long long)(int)sizeof(((struct ldlm_replay_desc *)0)->lrd_flags));
+
+	/* Checks for struct ldlm_replay_rep */
+	LASSERTF((int)sizeof(struct ldlm_replay_rep) == 16, "found %lld\n",
+		 (long long)(int)sizeof(struct ldlm_replay_rep));
+	LASSERTF((int)offsetof(struct ldlm_replay_rep, lrp_handle) == 0, "found %lld\n",
+		 (long long)(int)offsetof(struct ldlm_replay_rep, lrp_handle));
+	LASSERTF((int)sizeof(((struct ldlm_replay_rep *)0)->lrp_handle) == 8, "found %lld\n",
+		 (long long)(int)sizeof(((struct ldlm_replay_rep *)0)->lrp_handle));
+	LASSERTF((int)offsetof(struct ldlm_replay_rep, lrp_status) == 8, "found %lld\n",
+		 (long long)(int)offsetof(struct ldlm_replay_rep, lrp_status));
+	LASSERTF((int)sizeof(((struct ldlm_replay_rep *)0)->lrp_status) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct ldlm_replay_rep *)0)->lrp_status));
+	LASSERTF((int)offsetof(struct ldlm_replay_rep, lrp_padding) == 12, "found %lld\n",
+		 (long long)(int)offsetof(struct ldlm_replay_rep, lrp_padding));
+	LASSERTF((int)sizeof(((struct ldlm_replay_rep *)0)->lrp_padding) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct ldlm_replay_rep *)0)->lrp_padding));
+
 	/* Checks for struct ost_lvb_v1 */
 	LASSERTF((int)sizeof(struct ost_lvb_v1) == 40, "found %lld\n",
 		 (long long)(int)sizeof(struct ost_lvb_v1));
@@ -4248,6 +4448,10 @@ void lustre_assert_wire_constants(void)
 		 (long long)LAYOUT_INTENT_RELEASE);
 	LASSERTF(LAYOUT_INTENT_RESTORE == 6, "found %lld\n",
 		 (long long)LAYOUT_INTENT_RESTORE);
+	LASSERTF(LAYOUT_INTENT_RESYNC == 7, "found %lld\n",
+		 (long long)LAYOUT_INTENT_RESYNC);
+	LASSERTF(LAYOUT_INTENT_RESYNC_DONE == 8, "found %lld\n",
+		 (long long)LAYOUT_INTENT_RESYNC_DONE);
 
 	/* Checks for struct hsm_action_item */
 	LASSERTF((int)sizeof(struct hsm_action_item) == 72, "found %lld\n",
@@ -1063,6 +1063,8 @@ int tgt_connect(struct tgt_session_info *tsi)
 	reply = req_capsule_server_get(tsi->tsi_pill, &RMF_CONNECT_DATA);
 	spin_lock(&tsi->tsi_exp->exp_lock);
 	*exp_connect_flags_ptr(tsi->tsi_exp) = reply->ocd_connect_flags;
+	tsi->tsi_exp->exp_connect_data.ocd_connect_flags2 =
+		reply->ocd_connect_flags2;
 	tsi->tsi_exp->exp_connect_data.ocd_brw_size = reply->ocd_brw_size;
 	spin_unlock(&tsi->tsi_exp->exp_lock);
 
@@ -1750,6 +1752,50 @@ void tgt_brw_unlock(struct obd_ioobj *obj, struct niobuf_remote *niob,
 	EXIT;
 }
 
+/**
+ * Take a server side IBITS lock protecting the data of a file stored on
+ * the MDT, see LOV_PATTERN_MDT. Clients doing I/O to such files do not
+ * cache data, so the lock is always taken by the server for the duration
+ * of the bulk transfer. Clients caching the size of a DoM file hold the
+ * DOM bit with their getattr lock, so a write revokes it.
+ */
+static int tgt_mdt_data_lock(struct ldlm_namespace *ns,
+			     struct ldlm_res_id *res_id,
+			     struct lustre_handle *lh, enum ldlm_mode mode)
+{
+	union ldlm_policy_data policy;
+	__u64 flags = 0;
+	int rc;
+
+	ENTRY;
+
+	LASSERT(mode == LCK_PR || mode == LCK_PW);
+	LASSERT(!lustre_handle_is_used(lh));
+
+	policy.l_inodebits.bits = MDS_INODELOCK_DOM;
+
+	rc = ldlm_cli_enqueue_local(ns, res_id, LDLM_IBITS, &policy, mode,
+				    &flags, ldlm_blocking_ast,
+				    ldlm_completion_ast, NULL, NULL, 0,
+				    LVB_T_NONE, NULL, lh);
+	RETURN(rc == ELDLM_OK ? 0 : -EIO);
+}
+
+static void tgt_mdt_data_unlock(struct lustre_handle *lh, enum ldlm_mode mode)
+{
+	LASSERT(mode == LCK_PR || mode == LCK_PW);
+
+	if (lustre_handle_is_used(lh))
+		ldlm_lock_decref(lh, mode);
+}
+
+static inline bool tgt_brw_portal_ok(struct ptlrpc_request *req)
+{
+	__u32 portal = ptlrpc_req2svc(req)->srv_req_portal;
+
+	return portal == OST_IO_PORTAL || portal == MDS_IO_PORTAL;
+}
+
 static __u32 tgt_checksum_bulk(struct lu_target *tgt,
 			       struct ptlrpc_bulk_desc *desc, int opc,
 			       cksum_type_t cksum_type)
@@ -1830,6 +1876,70 @@ static __u32 tgt_checksum_bulk(struct lu_target *tgt,
 	return cksum;
 }
 
+/**
+ * Whether the client asked for the bulk of a BRW to be compressed.
+ */
+static bool tgt_brw_compress(struct obd_export *exp, struct obdo *oa)
+{
+	return exp_connect_brw_compress(exp) &&
+	       oa->o_valid & OBD_MD_FLFLAGS &&
+	       oa->o_flags & OBD_FL_BRW_COMPRESS;
+}
+
+/**
+ * Make write bulk \a desc a sink for the compressed stream of its data,
+ * o_compr_nob bytes as announced by the client.
+ */
+static int tgt_brw_write_stream(struct ptlrpc_bulk_desc *desc,
+				struct obdo *oa, lnet_kiov_t **stream)
+{
+	if (oa->o_compr_nob == 0 || oa->o_compr_nob >= desc->bd_nob)
+		return -EPROTO;
+
+	OBD_ALLOC_LARGE(*stream, desc->bd_iov_count * sizeof(**stream));
+	if (*stream == NULL)
+		return -ENOMEM;
+
+	return ptlrpc_bulk_prep_stream(desc, *stream, oa->o_compr_nob);
+}
+
+/**
+ * Expand the compressed stream received in \a desc into the pages of
+ * \a lnb, which become the fragments of \a desc again.
+ */
+static int tgt_brw_write_expand(struct ptlrpc_bulk_desc *desc,
+				lnet_kiov_t *stream, struct niobuf_local *lnb,
+				int npages)
+{
+	lnet_kiov_t	*kiov;
+	int		 nob = 0;
+	int		 i;
+	int		 rc;
+
+	OBD_ALLOC_LARGE(kiov, npages * sizeof(*kiov));
+	if (kiov == NULL)
+		return -ENOMEM;
+
+	for (i = 0; i < npages; i++) {
+		kiov[i].kiov_page = lnb[i].lnb_page;
+		kiov[i].kiov_offset = lnb[i].lnb_page_offset;
+		kiov[i].kiov_len = lnb[i].lnb_len;
+		nob += lnb[i].lnb_len;
+	}
+
+	rc = ptlrpc_bulk_decompress(stream, npages, desc->bd_nob_transferred,
+				    kiov, npages);
+	if (rc >= 0 && rc != nob)
+		rc = -EPROTO;
+	if (rc >= 0) {
+		ptlrpc_bulk_replace_frags(desc, kiov, nob);
+		rc = 0;
+	}
+	OBD_FREE_LARGE(kiov, npages * sizeof(*kiov));
+
+	return rc;
+}
+
 int tgt_brw_read(struct tgt_session_info *tsi)
 {
 	struct ptlrpc_request	*req = tgt_ses_req(tsi);
@@ -1841,12 +1951,15 @@ int tgt_brw_read(struct tgt_session_info *tsi)
 	struct ost_body		*body, *repbody;
 	struct l_wait_info	 lwi;
 	struct lustre_handle	 lockh = { 0 };
+	lnet_kiov_t		*stream = NULL;
 	int			 npages, nob = 0, rc, i, no_reply = 0;
+	int			 cnob = 0, nstream = 0;
+	bool			 dom;
 	struct tgt_thread_big_cache *tbc = req->rq_svc_thread->t_data;
 
 	ENTRY;
 
-	if (ptlrpc_req2svc(req)->srv_req_portal != OST_IO_PORTAL) {
+	if (!tgt_brw_portal_ok(req)) {
 		CERROR("%s: deny read request from %s to portal %u\n",
 		       tgt_name(tsi->tsi_tgt),
 		       obd_export_nid2str(req->rq_export),
@@ -1889,8 +2002,14 @@ int tgt_brw_read(struct tgt_session_info *tsi)
 
 	local_nb = tbc->local;
 
-	rc = tgt_brw_lock(exp->exp_obd->obd_namespace, &tsi->tsi_resid, ioo,
-			  remote_nb, &lockh, LCK_PR);
+	dom = ptlrpc_req2svc(req)->srv_req_portal == MDS_IO_PORTAL;
+	if (dom)
+		rc = tgt_mdt_data_lock(exp->exp_obd->obd_namespace,
+				       &tsi->tsi_resid, &lockh, LCK_PR);
+	else
+		rc = tgt_brw_lock(exp->exp_obd->obd_namespace,
+				  &tsi->tsi_resid, ioo, remote_nb, &lockh,
+				  LCK_PR);
 	if (rc != 0)
 		RETURN(rc);
 
@@ -1968,6 +2087,22 @@ int tgt_brw_read(struct tgt_session_info *tsi)
 	} else {
 		repbody->oa.o_valid = 0;
 	}
+
+	/* the checksum is that of the plain data, compress it afterwards */
+	if (rc == 0 && tgt_brw_compress(exp, &body->oa)) {
+		nstream = desc->bd_iov_count;
+		OBD_ALLOC_LARGE(stream, nstream * sizeof(*stream));
+		if (stream != NULL)
+			cnob = ptlrpc_bulk_compress(desc, stream);
+		if (cnob > 0) {
+			if (!(repbody->oa.o_valid & OBD_MD_FLFLAGS)) {
+				repbody->oa.o_valid |= OBD_MD_FLFLAGS;
+				repbody->oa.o_flags = 0;
+			}
+			repbody->oa.o_flags |= OBD_FL_BRW_COMPRESS;
+			repbody->oa.o_compr_nob = cnob;
+		}
+	}
 	/* We're finishing using body->oa as an input variable */
 
 	/* Check if client was evicted while we were doing i/o before touching
@@ -1985,7 +2120,10 @@ out_commitrw:
 	if (rc == 0)
 		tgt_drop_id(exp, &repbody->oa);
 out_lock:
-	tgt_brw_unlock(ioo, remote_nb, &lockh, LCK_PR);
+	if (dom)
+		tgt_mdt_data_unlock(&lockh, LCK_PR);
+	else
+		tgt_brw_unlock(ioo, remote_nb, &lockh, LCK_PR);
 
 	if (desc && !CFS_FAIL_PRECHECK(OBD_FAIL_PTLRPC_CLIENT_BULK_CB2))
 		ptlrpc_free_bulk(desc);
@@ -2019,6 +2157,11 @@ out_lock:
 		ptlrpc_free_bulk(desc);
 	}
 
+	if (stream != NULL) {
+		ptlrpc_bulk_free_stream(stream, nstream);
+		OBD_FREE_LARGE(stream, nstream * sizeof(*stream));
+	}
+
 	RETURN(rc);
 }
 EXPORT_SYMBOL(tgt_brw_read);
@@ -2078,15 +2221,16 @@ int tgt_brw_write(struct tgt_session_info *tsi)
 	struct l_wait_info	 lwi;
 	struct lustre_handle	 lockh = {0};
 	__u32			*rcs;
+	lnet_kiov_t		*stream = NULL;
 	int			 objcount, niocount, npages;
 	int			 rc, i, j;
 	cksum_type_t		 cksum_type = OBD_CKSUM_CRC32;
-	bool			 no_reply = false, mmap;
+	bool			 no_reply = false, mmap, dom, compress;
 	struct tgt_thread_big_cache *tbc = req->rq_svc_thread->t_data;
 
 	ENTRY;
 
-	if (ptlrpc_req2svc(req)->srv_req_portal != OST_IO_PORTAL) {
+	if (!tgt_brw_portal_ok(req)) {
 		CERROR("%s: deny write request from %s to portal %u\n",
 		       tgt_name(tsi->tsi_tgt),
 		       obd_export_nid2str(req->rq_export),
@@ -2150,8 +2294,14 @@ int tgt_brw_write(struct tgt_session_info *tsi)
 
 	local_nb = tbc->local;
 
-	rc = tgt_brw_lock(exp->exp_obd->obd_namespace, &tsi->tsi_resid, ioo,
-			  remote_nb, &lockh, LCK_PW);
+	dom = ptlrpc_req2svc(req)->srv_req_portal == MDS_IO_PORTAL;
+	if (dom)
+		rc = tgt_mdt_data_lock(exp->exp_obd->obd_namespace,
+				       &tsi->tsi_resid, &lockh, LCK_PW);
+	else
+		rc = tgt_brw_lock(exp->exp_obd->obd_namespace,
+				  &tsi->tsi_resid, ioo, remote_nb, &lockh,
+				  LCK_PW);
 	if (rc != 0)
 		GOTO(out, rc);
 
@@ -2204,12 +2354,21 @@ int tgt_brw_write(struct tgt_session_info *tsi)
 						 local_nb[i].lnb_page_offset,
 						 local_nb[i].lnb_len);
 
+	compress = tgt_brw_compress(exp, &body->oa);
+	if (compress) {
+		rc = tgt_brw_write_stream(desc, &body->oa, &stream);
+		if (rc != 0)
+			GOTO(skip_transfer, rc);
+	}
+
 	rc = sptlrpc_svc_prep_bulk(req, desc);
 	if (rc != 0)
 		GOTO(skip_transfer, rc);
 
 	rc = target_bulk_io(exp, desc, &lwi);
 	no_reply = rc != 0;
+	if (rc == 0 && compress)
+		rc = tgt_brw_write_expand(desc, stream, local_nb, npages);
 
 skip_transfer:
 	if (body->oa.o_valid & OBD_MD_FLCKSUM && rc == 0) {
@@ -2281,9 +2440,16 @@ skip_transfer:
 		tgt_drop_id(exp, &repbody->oa);
 	}
 out_lock:
-	tgt_brw_unlock(ioo, remote_nb, &lockh, LCK_PW);
+	if (dom)
+		tgt_mdt_data_unlock(&lockh, LCK_PW);
+	else
+		tgt_brw_unlock(ioo, remote_nb, &lockh, LCK_PW);
 	if (desc)
 		ptlrpc_free_bulk(desc);
+	if (stream != NULL) {
+		ptlrpc_bulk_free_stream(stream, npages);
+		OBD_FREE_LARGE(stream, npages * sizeof(*stream));
+	}
 out:
 	if (no_reply) {
 		req->rq_no_reply = 1;
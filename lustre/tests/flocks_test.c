@@ -42,6 +42,7 @@
 #include <unistd.h>
 #include <pthread.h>
 #include <sys/file.h>
+#include <sys/time.h>
 #include <sys/wait.h>
 #include <stdarg.h>
 
@@ -565,6 +566,169 @@ int t5(int argc, char *argv[])
 
 }
 
+#define T6_USAGE							      \
+	"Usage: ./flocks_test 6 nprocs iterations file1\n"		      \
+"       nprocs: number of processes locking file1\n"			      \
+"       iterations: uncontended lock/unlock pairs per process\n"	      \
+"       file1: fcntl is called for this file\n"
+
+static double t6_now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static int t6_lock(int fd, int cmd, short type, off_t start)
+{
+	struct flock lock = {
+		.l_type = type,
+		.l_whence = SEEK_SET,
+		.l_start = start,
+		.l_len = 1,
+	};
+
+	return t_fcntl(fd, cmd, &lock);
+}
+
+/**
+ * Child \a idx of the t6 stress: time \a iters lock/unlock pairs on its own
+ * byte, then take it, wait for \a go and ask for the byte of the next child.
+ * The requests form a chain through all the children which the last one
+ * closes into a cycle, so it must be the only one to get EDEADLK.
+ */
+static int t6_child(const char *path, int idx, int nprocs, int iters,
+		    int ready, int go)
+{
+	double start;
+	char c;
+	int last = idx == nprocs - 1;
+	int fd;
+	int rc;
+	int i;
+
+	fd = open(path, O_RDWR);
+	if (fd < 0) {
+		fprintf(stderr, "%d: couldn't open file: %s\n", idx, path);
+		return EXIT_FAILURE;
+	}
+
+	start = t6_now();
+	for (i = 0; i < iters; i++) {
+		if (t6_lock(fd, F_SETLKW, F_WRLCK, idx) < 0 ||
+		    t6_lock(fd, F_SETLKW, F_UNLCK, idx) < 0)
+			return EXIT_FAILURE;
+	}
+	if (iters > 0)
+		printf("%d: %d uncontended lock/unlock: %.1f usec/pair\n",
+		       idx, iters, (t6_now() - start) * 1000000 / iters);
+
+	if (t6_lock(fd, F_SETLKW, F_WRLCK, idx) < 0)
+		return EXIT_FAILURE;
+
+	if (write(ready, "r", 1) != 1 || read(go, &c, 1) != 1) {
+		perror("pipe");
+		return EXIT_FAILURE;
+	}
+
+	if (last) {
+		/* let the rest of the chain block first */
+		sleep(2 + nprocs / 256);
+		start = t6_now();
+	}
+
+	rc = t6_lock(fd, F_SETLKW, F_WRLCK, last ? 0 : idx + 1);
+	if (last) {
+		if (rc != -EDEADLK) {
+			fprintf(stderr, "%d: cycle of %d owners not detected: "
+				"rc = %d\n", idx, nprocs, rc);
+			return EXIT_FAILURE;
+		}
+		printf("%d: deadlock of %d owners detected in %.1f usec\n",
+		       idx, nprocs, (t6_now() - start) * 1000000);
+	} else if (rc < 0) {
+		return EXIT_FAILURE;
+	}
+
+	close(fd);
+	return EXIT_SUCCESS;
+}
+
+int t6(int argc, char *argv[])
+{
+	int ready[2];
+	int go[2];
+	int nprocs;
+	int iters;
+	int status;
+	int rc = EXIT_SUCCESS;
+	char c;
+	int i;
+
+	if (argc != 5) {
+		fprintf(stderr, T6_USAGE);
+		return EXIT_FAILURE;
+	}
+
+	nprocs = atoi(argv[2]);
+	iters = atoi(argv[3]);
+	if (nprocs < 2 || iters < 0) {
+		fprintf(stderr, T6_USAGE);
+		return EXIT_FAILURE;
+	}
+
+	if (pipe(ready) < 0 || pipe(go) < 0) {
+		perror("pipe");
+		return EXIT_FAILURE;
+	}
+
+	for (i = 0; i < nprocs; i++) {
+		pid_t pid = fork();
+
+		if (pid < 0) {
+			perror("fork");
+			nprocs = i;
+			rc = EXIT_FAILURE;
+			break;
+		}
+		if (pid == 0) {
+			close(ready[0]);
+			close(go[1]);
+			exit(t6_child(argv[4], i, nprocs, iters, ready[1],
+				      go[0]));
+		}
+	}
+	close(ready[1]);
+	close(go[0]);
+
+	/* all the children hold their bytes, start the chain */
+	for (i = 0; i < nprocs && rc == EXIT_SUCCESS; i++) {
+		if (read(ready[0], &c, 1) != 1) {
+			fprintf(stderr, "child exited before locking\n");
+			rc = EXIT_FAILURE;
+		}
+	}
+	for (i = 0; i < nprocs; i++)
+		if (write(go[1], "g", 1) != 1)
+			break;
+	close(go[1]);
+
+	for (i = 0; i < nprocs; i++) {
+		if (wait(&status) < 0) {
+			perror("wait");
+			rc = EXIT_FAILURE;
+			break;
+		}
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+			rc = EXIT_FAILURE;
+	}
+
+	close(ready[0]);
+	printf("%d: exit rc=%d\n", getpid(), rc);
+	return rc;
+}
+
 /** ==============================================================
  * program entry
  */
@@ -600,6 +764,9 @@ int main(int argc, char* argv[])
 	case 5:
 		rc = t5(argc, argv);
 		break;
+	case 6:
+		rc = t6(argc, argv);
+		break;
 	default:
                 fprintf(stderr, "unknow test number %s\n", argv[1]);
                 break;
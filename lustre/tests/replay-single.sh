@@ -4445,6 +4445,43 @@ test_120() {
 }
 run_test 120 "DNE fail abort should stop both normal and DNE replay"
 
+test_121() {
+	$LCTL get_param -n mdc.$FSNAME-MDT0000-mdc-*.connect_flags |
+		grep -q lock_replay_batch ||
+		{ skip "no lock replay batch support" && return 0; }
+
+	# more locks than one replay batch (LDLM_REPLAY_BATCH_MAX) carries
+	local nr=100
+	local ns="ldlm.namespaces.$FSNAME-MDT0000-mdc-*"
+	local before
+	local after
+	local replayed
+
+	mkdir -p $DIR/$tdir || error "mkdir $DIR/$tdir failed"
+	createmany -o $DIR/$tdir/f- $nr || error "createmany failed"
+	cancel_lru_locks mdc
+	ls -l $DIR/$tdir > /dev/null || error "ls $DIR/$tdir failed"
+
+	before=$($LCTL get_param -n $ns.lock_count)
+	[ $before -gt $nr ] || error "only $before locks cached"
+
+	replay_barrier $SINGLEMDS
+	fail $SINGLEMDS
+
+	after=$($LCTL get_param -n $ns.lock_count)
+	replayed=$(do_facet $SINGLEMDS "$LCTL get_param -n \
+		mdt.$FSNAME-MDT0000.recovery_status" |
+		awk '/replayed_locks:/ { print $2 }')
+	echo "locks before $before, after $after, replayed $replayed"
+	[ $after -eq $before ] ||
+		error "$after of $before locks kept over recovery"
+	[ $replayed -ge $before ] ||
+		error "$replayed of $before locks replayed"
+
+	unlinkmany $DIR/$tdir/f- $nr || error "unlinkmany failed"
+}
+run_test 121 "replay more locks than one replay batch"
+
 complete $SECONDS
 check_and_cleanup_lustre
 exit_status
@@ -7297,6 +7297,23 @@ test_105e() { # bug 22660 && 22040
 }
 run_test 105e "Two conflicting flocks from same process ======="
 
+test_105f() {
+	flock_is_enabled || { skip "mount w/o flock enabled" && return; }
+	local nprocs=${FLOCK_NPROCS:-256}
+
+	touch $DIR/$tfile
+	timeout 300 flocks_test 6 $nprocs 100 $DIR/$tfile
+	case $? in
+		0) ;;
+		124) error "deadlock of $nprocs flock owners not resolved" ;;
+		*) error "flocks_test 6 $nprocs 100 $DIR/$tfile failed" ;;
+	esac
+	do_facet $SINGLEMDS $LCTL get_param -n \
+		ldlm.namespaces.mdt-*.flock_deadlock_depth
+	rm -f $DIR/$tfile
+}
+run_test 105f "flock deadlock detection across many owners ====="
+
 test_106() { #bug 10921
 	test_mkdir -p $DIR/$tdir
 	$DIR/$tdir && error "exec $DIR/$tdir succeeded"
@@ -8573,6 +8590,63 @@ test_124c() {
 }
 run_test 124c "LRUR cancel very aged locks"
 
+test_124d() {
+	local nsdir="ldlm.namespaces.*-OST0000-osc-[^M]*"
+	local policy=$($LCTL get_param -n $nsdir.lru_cancel_policy)
+
+	[ -z "$policy" ] && skip "no lru_cancel_policy" && return 0
+	[ "$policy" == "age" ] || error "default policy is $policy"
+
+	$LCTL set_param $nsdir.lru_cancel_policy=cost ||
+		error "cannot set cost policy"
+	[ "$($LCTL get_param -n $nsdir.lru_cancel_policy)" == "cost" ] ||
+		error "cost policy not set"
+	$LCTL set_param $nsdir.lru_cancel_policy=bogus 2>/dev/null &&
+		error "bogus policy accepted"
+
+	# locks over cached pages are still canceled on request
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=4 ||
+		error "dd to $DIR/$tfile failed"
+	cancel_lru_locks osc
+	local unused=$($LCTL get_param -n $nsdir.lock_unused_count)
+
+	[ $unused -eq 0 ] || error "$unused locks are not canceled"
+
+	# With a fixed LRU size, each enqueue cancels the oldest unused
+	# locks. The lock over 16MB of cached pages is the oldest one, but
+	# it is costly, so the cheap locks taken after it go first.
+	local lru_size=$($LCTL get_param -n $nsdir.lru_size | head -1)
+	$LCTL get_param -n osc.*OST0000-osc-[^M]*.connect_flags |
+		grep -q lru_resize && lru_size=0
+	local nr=4
+	local enqueues
+	local i
+
+	test_mkdir $DIR/$tdir
+	$LFS setstripe -c 1 -i 0 $DIR/$tdir
+	$LCTL set_param -n $nsdir.lru_size=2
+	dd if=/dev/zero of=$DIR/$tdir/big bs=1M count=16 ||
+		error "dd to $DIR/$tdir/big failed"
+	for i in $(seq $nr); do
+		dd if=/dev/zero of=$DIR/$tdir/f$i bs=4k count=1 2>/dev/null ||
+			error "dd to $DIR/$tdir/f$i failed"
+	done
+	unused=$($LCTL get_param -n $nsdir.lock_unused_count)
+
+	$LCTL set_param -n osc.*OST0000-osc-[^M]*.stats=clear
+	cat $DIR/$tdir/big > /dev/null || error "read $DIR/$tdir/big failed"
+	enqueues=$($LCTL get_param -n osc.*OST0000-osc-[^M]*.stats |
+		awk '/ldlm_enqueue/ { n += $2 } END { print n + 0 }')
+
+	$LCTL set_param -n $nsdir.lru_size=$lru_size
+	$LCTL set_param -n $nsdir.lru_cancel_policy=$policy
+	echo "$unused unused locks, $enqueues enqueues to read the big file"
+	[ $unused -le $nr ] || error "no cheap lock was canceled: $unused"
+	[ $enqueues -eq 0 ] || error "costly lock was canceled"
+	rm -rf $DIR/$tdir $DIR/$tfile
+}
+run_test 124d "cost aware LRU cancel policy"
+
 test_125() { # 13358
 	[ -z "$(lctl get_param -n llite.*.client_type | grep local)" ] && skip "must run as local client" && return
 	[ -z "$(lctl get_param -n mdc.*-mdc-*.connect_flags | grep acl)" ] && skip "must have acl enabled" && return
@@ -9566,6 +9640,41 @@ test_134b() {
 }
 run_test 134b "Server rejects lock request when reaching lock_limit_mb"
 
+test_134c() {
+	[[ $(lustre_version_code $SINGLEMDS) -lt $(version_code 2.8.50) ]] &&
+		skip "Need MDS version at least 2.8.50" && return
+
+	mkdir -p $DIR/$tdir || error "failed to create $DIR/$tdir"
+	cancel_lru_locks mdc
+
+	local nr=1000
+	createmany -o $DIR/$tdir/f $nr ||
+		error "failed to create $nr files in $DIR/$tdir"
+
+	local nsdir="ldlm.namespaces.mdt-*-MDT0000*"
+	local uuid=$($LCTL get_param -n mdc.*-MDT0000-mdc-*.uuid | head -n1)
+	do_facet mds1 $LCTL get_param -n $nsdir.lock_age_histogram |
+		grep -q "$uuid" ||
+		error "client $uuid not in the lock age histogram"
+
+	do_facet mds1 $LCTL set_param ldlm.lock_reclaim_stats=clear
+	#define OBD_FAIL_LDLM_WATERMARK_LOW     0x327
+	do_facet mds1 $LCTL set_param fail_loc=0x327
+	do_facet mds1 $LCTL set_param fail_val=500
+	touch $DIR/$tdir/m
+
+	local victims=$(do_facet mds1 $LCTL get_param -n \
+			ldlm.lock_reclaim_stats | awk '/^victims:/ { print $2 }')
+	do_facet mds1 $LCTL set_param fail_loc=0
+	do_facet mds1 $LCTL set_param fail_val=0
+	do_facet mds1 $LCTL get_param ldlm.lock_reclaim_stats
+	[ ${victims:-0} -gt 0 ] || error "no reclaim victims accounted"
+
+	rm $DIR/$tdir/m
+	unlinkmany $DIR/$tdir/f $nr
+}
+run_test 134c "Server reclaim picks victims from the heaviest exports"
+
 test_140() { #bug-17379
 	[ $PARALLEL == "yes" ] && skip "skip parallel run" && return
         test_mkdir -p $DIR/$tdir || error "Creating dir $DIR/$tdir"
@@ -14436,6 +14545,309 @@ test_402() {
 }
 run_test 402 "Return ENOENT to lod_generate_and_set_lovea"
 
+test_403() {
+	[ -z "$(lctl get_param -n mdc.*-mdc-*.connect_flags | grep dom)" ] &&
+		skip "MDS does not support Data-on-MDT" && return
+	local dom=$DIR/$tfile
+	local tmp=$TMP/$tfile.tmp
+
+	$LFS setstripe -L mdt -S 1M $dom || error "setstripe -L mdt failed"
+	[ $($LFS getstripe -c $dom) -eq 0 ] ||
+		error "$dom should have no OST objects"
+
+	dd if=/dev/urandom of=$tmp bs=4k count=100
+	dd if=$tmp of=$dom bs=64k conv=notrunc || error "write $dom failed"
+	cancel_lru_locks mdc
+	cmp $tmp $dom || error "$dom data mismatch"
+	[ $(stat -c %s $dom) -eq $(stat -c %s $tmp) ] ||
+		error "$dom size mismatch"
+
+	$MULTIOP $dom OSMRUc || error "mmap read $dom failed"
+	$MULTIOP $dom OSMWUc || error "mmap write $dom failed"
+	cancel_lru_locks mdc
+	cmp -s $tmp $dom && error "mmap write to $dom was lost"
+	cp $dom $tmp || error "cp $dom failed"
+
+	touch $DIR/$tfile.2
+	$LFS swap_layouts $dom $DIR/$tfile.2 &&
+		error "swap of a DoM layout succeeded"
+	rm -f $DIR/$tfile.2
+
+	$TRUNCATE $dom 1000 || error "truncate $dom failed"
+	cancel_lru_locks mdc
+	[ $(stat -c %s $dom) -eq 1000 ] || error "$dom size after truncate"
+	cmp -n 1000 $tmp $dom || error "$dom data mismatch after truncate"
+
+	dd if=/dev/zero of=$dom bs=1M seek=1 count=1 conv=notrunc &&
+		error "write beyond the DoM size limit succeeded"
+	rm -f $dom $tmp
+}
+run_test 403 "Data-on-MDT stores small file data on the MDT"
+
+test_404() {
+	[ $OSTCOUNT -lt 2 ] && skip "needs >= 2 OSTs" && return
+	local comp=$DIR/$tfile
+	local tmp=$TMP/$tfile.tmp
+
+	$LFS setstripe -E 1M -c 1 -E -1 -c 2 $comp ||
+		error "setstripe of a composite layout failed"
+	[ $($LFS getstripe $comp | grep -c "lcme_flags: *init") -eq 0 ] ||
+		error "$comp should have no instantiated component"
+
+	dd if=/dev/urandom of=$tmp bs=64k count=8
+	dd if=$tmp of=$comp bs=64k conv=notrunc || error "write $comp failed"
+	[ $($LFS getstripe $comp | grep -c "lcme_flags: *init") -eq 1 ] ||
+		error "only the first component should be instantiated"
+
+	dd if=$tmp of=$comp bs=64k seek=32 conv=notrunc ||
+		error "write past the first component failed"
+	[ $($LFS getstripe $comp | grep -c "lcme_flags: *init") -eq 2 ] ||
+		error "both components should be instantiated"
+
+	cancel_lru_locks osc
+	cmp -n 524288 $tmp $comp || error "$comp data mismatch"
+	cmp -n 524288 $tmp $comp 0 2097152 ||
+		error "$comp data mismatch in second component"
+	[ $(stat -c %s $comp) -eq 2621440 ] || error "$comp size mismatch"
+	rm -f $comp $tmp
+}
+run_test 404 "composite layout components are instantiated on write"
+
+test_405() {
+	[ $OSTCOUNT -lt 2 ] && skip "needs >= 2 OSTs" && return
+	local mirr=$DIR/$tfile
+	local tmp=$TMP/$tfile.tmp
+
+	$LFS mirror_create -N -c 1 -i 0 -N -c 1 -i 1 $mirr ||
+		error "create of a mirrored file failed"
+	$LFS getstripe $mirr | grep -q "lcm_mirror_count: *2" ||
+		error "$mirr should have 2 mirrors"
+
+	dd if=/dev/urandom of=$tmp bs=64k count=16
+	dd if=$tmp of=$mirr bs=64k || error "write $mirr failed"
+	$LFS getstripe $mirr | grep -q "lcm_flags: *wp" ||
+		error "$mirr should be write pending after a write"
+	[ $($LFS getstripe $mirr | grep -c "lcme_flags:.*stale") -eq 1 ] ||
+		error "the second mirror should be stale after a write"
+
+	$LFS mirror_resync $mirr || error "resync of $mirr failed"
+	$LFS getstripe $mirr | grep -q "lcm_flags: *ro" ||
+		error "$mirr should be read-only after the resync"
+	[ $($LFS getstripe $mirr | grep -c "lcme_flags:.*stale") -eq 0 ] ||
+		error "no mirror should be stale after the resync"
+
+	cancel_lru_locks osc
+	cmp $tmp $mirr || error "$mirr data mismatch"
+	rm -f $mirr $tmp
+}
+run_test 405 "mirrored file is resynced after a write"
+
+test_406() {
+	local dir=$DIR/$tdir
+	local file=$dir/$tfile
+
+	test_mkdir -p $dir
+	$LFS setstripe -c -1 $file || error "setstripe $file failed"
+	dd if=/dev/zero of=$file bs=1M count=4 || error "write $file failed"
+
+	[ "$($LFS find $dir --lazy --size 4M --type f)" == "$file" ] ||
+		error "lazy size of $file should be 4M after close"
+
+	$TRUNCATE $file 1048576 || error "truncate $file failed"
+	[ "$($LFS find $dir --lazy --size 1M --type f)" == "$file" ] ||
+		error "lazy size of $file should be 1M after truncate"
+
+	rm -rf $dir
+}
+run_test 406 "lazy size on MDT is updated on close and truncate"
+
+test_407() {
+	local file=$DIR/$tfile
+	local tmp=$TMP/$tfile.tmp
+	local cache=$TMP/$tdir.pcc
+	local old_root=$($LCTL get_param -n llite.*.pcc_root | head -n1)
+
+	mkdir -p $cache || error "mkdir $cache failed"
+	$LCTL set_param llite.*.pcc_root=$cache || error "set pcc_root failed"
+
+	dd if=/dev/urandom of=$tmp bs=64k count=16
+	cp $tmp $file || error "write $file failed"
+	$LFS pcc_attach $file || error "attach $file failed"
+	$LFS pcc_state $file | grep -q "attached, cache: $cache/" ||
+		error "$file should be attached"
+	$LFS hsm_state $file | grep -q pcc_cached ||
+		error "$file should be flagged cached on the MDT"
+	cmp $tmp $file || error "$file data mismatch in the cache"
+
+	# a writer revokes the cached copies
+	echo foo >> $tmp
+	echo foo >> $file || error "append to $file failed"
+	$LFS pcc_state $file | grep -q "none" ||
+		error "$file should be detached after a write"
+	cmp $tmp $file || error "$file data mismatch after the write"
+
+	# only a reader of the file may attach it
+	chmod 0600 $file
+	$RUNAS $LFS pcc_attach $file &&
+		error "attach of an unreadable $file succeeded"
+	$LFS hsm_state $file | grep -q pcc_cached &&
+		error "$file flagged cached by a non-reader"
+
+	$LCTL set_param llite.*.pcc_root=$old_root
+	rm -rf $file $tmp $cache
+}
+run_test 407 "read-only persistent client cache is revoked on write"
+
+test_409() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run" && return
+	$LCTL get_param -n mdc.*.connect_flags | grep -q batch_getattr_lock ||
+		{ skip "MDS does not support batch_getattr_lock" && return; }
+
+	local nr=2000
+	local batch
+	local enqueue
+
+	test_mkdir -p $DIR/$tdir
+	createmany -m $DIR/$tdir/$tfile $nr || error "createmany failed"
+
+	cancel_lru_locks mdc
+	$LCTL set_param mdc.*.stats=clear
+	ls -l $DIR/$tdir > /dev/null || error "ls -l $DIR/$tdir failed"
+
+	batch=$($LCTL get_param -n mdc.*MDT0000*.stats |
+		awk '/^mds_batch_getattr/ { print $2 }')
+	enqueue=$($LCTL get_param -n mdc.*MDT0000*.stats |
+		awk '/^ldlm_ibits_enqueue/ { print $2 }')
+	echo "$nr entries: ${batch:-0} batched getattr, ${enqueue:-0} enqueue"
+	[ ${batch:-0} -gt 0 ] || error "no batched getattr sent"
+	[ ${enqueue:-0} -lt $((nr / 2)) ] ||
+		error "$enqueue lock enqueues for $nr entries"
+
+	unlinkmany $DIR/$tdir/$tfile $nr || error "unlinkmany failed"
+}
+run_test 409 "ls -l gets attributes and locks in batches"
+
+test_410() {
+	local src=$TMP/$tfile.src
+	local ref=$TMP/$tfile.ref
+
+	dd if=/dev/urandom of=$src bs=1M count=5 || error "dd $src failed"
+	dd if=/dev/urandom of=$ref bs=1M count=5 || error "dd $ref failed"
+	cp $ref $DIR/$tfile || error "cp $ref failed"
+
+	# multi-page writes at unaligned offsets over partial and full pages
+	# take the batched write path, a single page write the generic one
+	for off in 1000 70000 1048575 3000000; do
+		dd if=$src of=$DIR/$tfile bs=$((1048576 + 3333)) count=1 \
+			seek=$off oflag=seek_bytes conv=notrunc ||
+			error "write at $off failed"
+		dd if=$src of=$ref bs=$((1048576 + 3333)) count=1 \
+			seek=$off oflag=seek_bytes conv=notrunc ||
+			error "write $ref at $off failed"
+	done
+	dd if=$src of=$DIR/$tfile bs=100 count=1 seek=5000 \
+		oflag=seek_bytes conv=notrunc || error "small write failed"
+	dd if=$src of=$ref bs=100 count=1 seek=5000 \
+		oflag=seek_bytes conv=notrunc || error "small write failed"
+
+	cmp $ref $DIR/$tfile || error "data mismatch in cache"
+	cancel_lru_locks osc
+	cmp $ref $DIR/$tfile || error "data mismatch after cache flush"
+
+	rm -f $src $ref $DIR/$tfile
+}
+run_test 410 "batched buffered writes keep file data intact"
+
+test_411() {
+	local dir=$DIR/$tdir
+	local ref=$TMP/$tfile.ref
+
+	test_mkdir $dir
+	chattr +c $dir || { skip "chattr +c not supported"; return; }
+
+	# compressible data, with a partial page at the end
+	for i in $(seq 20000); do
+		echo "line $i of compressible test data for $tfile"
+	done > $ref
+	dd if=/dev/urandom bs=1M count=1 >> $ref || error "dd $ref failed"
+
+	$LCTL set_param -n osc.*.osc_stats=0
+	cp $ref $dir/$tfile || error "cp $ref failed"
+	lsattr $dir/$tfile | grep -q -- "-c" ||
+		error "$dir/$tfile did not inherit the compress flag"
+	cancel_lru_locks osc
+	cmp $ref $dir/$tfile || error "data mismatch after cache flush"
+
+	if $LCTL get_param -n osc.*.connect_flags | grep -q brw_compress; then
+		local stats=$($LCTL get_param -n osc.*.osc_stats)
+		local wr=$(awk '/compressed_write_bytes/ { n += $2 }
+				END { print n + 0 }' <<< "$stats")
+		local rd=$(awk '/compressed_read_bytes/ { n += $2 }
+				END { print n + 0 }' <<< "$stats")
+
+		[ $wr -gt 0 ] || error "no compressed writes"
+		[ $rd -gt 0 ] || error "no compressed reads"
+	fi
+
+	rm -rf $ref $dir
+}
+run_test 411 "compressed BRW transfers keep file data intact"
+
+test_412() {
+	local dir=$DIR/$tdir
+	local lfind
+	local gfind
+	local rpcs
+
+	$LCTL get_param -n mdc.*.connect_flags | grep -q batch_getattr ||
+		{ skip "MDS does not support batched getattr"; return; }
+
+	test_mkdir $dir
+	for i in $(seq 100); do
+		dd if=/dev/zero of=$dir/f$i bs=1k count=$i 2>/dev/null ||
+			error "dd $dir/f$i failed"
+	done
+	chown $RUNAS_ID $dir/f1[0-9] || error "chown failed"
+	touch -m -d "3 days ago" $dir/f2[0-9] || error "touch failed"
+	cancel_lru_locks mdc
+	cancel_lru_locks osc
+
+	# the attributes of the batch must select the same files as find
+	$LCTL set_param -n mdc.*.stats=clear
+	lfind=$($LFS find $dir -uid $RUNAS_ID | sort)
+	gfind=$(find $dir -uid $RUNAS_ID | sort)
+	[ "$lfind" == "$gfind" ] || error "-uid: '$lfind' != '$gfind'"
+	rpcs=$($LCTL get_param -n mdc.*.stats |
+		awk '/mds_batch_getattr/ { n += $2 } END { print n + 0 }')
+	[ $rpcs -gt 0 ] || error "lfs find did not batch getattr"
+	[ $rpcs -lt 10 ] || error "$rpcs batched getattr RPCs for 100 files"
+
+	lfind=$($LFS find $dir -type f -mtime +2 | sort)
+	gfind=$(find $dir -type f -mtime +2 | sort)
+	[ "$lfind" == "$gfind" ] || error "-mtime: '$lfind' != '$gfind'"
+
+	lfind=$($LFS find $dir -type f -size +50k | sort)
+	gfind=$(find $dir -type f -size +50k | sort)
+	[ "$lfind" == "$gfind" ] || error "-size: '$lfind' != '$gfind'"
+
+	# files without a layout need no stat after the batch
+	rm -f $dir/*
+	for i in $(seq 100); do
+		$MCREATE $dir/m$i || error "mcreate $dir/m$i failed"
+	done
+	cancel_lru_locks mdc
+	$LCTL set_param -n mdc.*.stats=clear
+	lfind=$($LFS find $dir -type f -size -1k -mtime -1 | sort)
+	rpcs=$($LCTL get_param -n mdc.*.stats |
+		awk '/ldlm_enqueue/ { n += $2 } END { print n + 0 }')
+	[ $rpcs -lt 10 ] || error "lfs find stat'ed files: $rpcs enqueue RPCs"
+	gfind=$(find $dir -type f -size -1k -mtime -1 | sort)
+	[ "$lfind" == "$gfind" ] || error "no layout: '$lfind' != '$gfind'"
+
+	rm -rf $dir
+}
+run_test 412 "lfs find stats directory entries in batches"
+
 #
 # tests that do cleanup/setup should be run at the end
 #
@@ -828,6 +828,81 @@ test_32b() { # bug 11270
 }
 run_test 32b "lockless i/o"
 
+test_32c() {
+	remote_ost_nodsh && skip "remote OST with nodsh" && return
+
+	local node
+	local facets=$(get_facets OST)
+	local p="$TMP/$TESTSUITE-$TESTNAME.parameters"
+
+	save_lustre_params client "osc.*.contention_seconds" > $p
+	save_lustre_params $facets \
+		"ldlm.namespaces.filter-*.max_nolock_bytes" >> $p
+	save_lustre_params $facets \
+		"ldlm.namespaces.filter-*.contended_locks" >> $p
+	save_lustre_params $facets \
+		"ldlm.namespaces.filter-*.contention_seconds" >> $p
+	save_lustre_params $facets \
+		"ldlm.namespaces.filter-*.srvlock_exports" >> $p
+	clear_osc_stats
+
+	# lockless i/o only because of the number of contending exports,
+	# max_nolock_bytes stays 0
+	for node in $(osts_nodes); do
+		do_node $node "lctl set_param -n \
+			ldlm.namespaces.filter-*.max_nolock_bytes=0 \
+			ldlm.namespaces.filter-*.contended_locks=0 \
+			ldlm.namespaces.filter-*.contention_seconds=60 \
+			ldlm.namespaces.filter-*.srvlock_exports=1"
+	done
+	lctl set_param -n osc.*.contention_seconds 60
+	for i in $(seq 5); do
+		dd if=/dev/zero of=$DIR1/$tfile bs=4k count=1 conv=notrunc \
+			> /dev/null 2>&1
+		dd if=/dev/zero of=$DIR2/$tfile bs=4k count=1 conv=notrunc \
+			> /dev/null 2>&1
+	done
+	[ $(calc_osc_stats lockless_write_bytes) -ne 0 ] ||
+		error "lockless i/o was not triggered"
+	do_nodes $(comma_list $(osts_nodes)) \
+		"lctl get_param -n ldlm.namespaces.filter-*.contended_resources" |
+		grep -q "srvlock: [1-9]" ||
+		error "contended resource not reported"
+
+	lctl set_param -n osc.*.contention_seconds 0
+	rm -f $DIR1/$tfile
+	restore_lustre_params <$p
+	rm -f $p
+}
+run_test 32c "lockless i/o on resources contended by many clients"
+
+test_32d() {
+	remote_ost_nodsh && skip "remote OST with nodsh" && return
+	[[ $(lustre_version_code ost1) -lt $(version_code 2.8.50) ]] &&
+		skip "Need OST version at least 2.8.50" && return
+
+	local nodes=$(comma_list $(osts_nodes))
+
+	do_nodes $nodes "lctl set_param -n \
+		ldlm.namespaces.filter-*.lock_wait_top=clear"
+	$LFS setstripe -c 1 -i 0 $DIR1/$tfile || error "setstripe failed"
+	# ping-pong the lock of the object between both mounts
+	for i in $(seq 10); do
+		dd if=/dev/zero of=$DIR1/$tfile bs=4k count=1 conv=notrunc \
+			> /dev/null 2>&1
+		dd if=/dev/zero of=$DIR2/$tfile bs=4k count=1 conv=notrunc \
+			> /dev/null 2>&1
+	done
+
+	do_facet ost1 "lctl get_param -n \
+		ldlm.namespaces.filter-*.lock_wait_top" | grep "waits:" ||
+		error "no lock waits reported"
+	do_facet ost1 "lctl get_param obdfilter.*.exports.*.lock_wait_stats" |
+		grep -q "bl_ast_usec" || error "no blocking AST latency reported"
+	rm -f $DIR1/$tfile
+}
+run_test 32d "lock wait profile of a resource clients ping-pong"
+
 print_jbd_stat () {
     local dev
     local mdts=$(get_facets MDS)
@@ -3567,6 +3642,134 @@ test_92() {
 }
 run_test 92 "create remote directory under orphan directory"
 
+test_93() {
+	local old_debug=$($LCTL get_param -n debug)
+	local line
+	local kept
+	local dropped
+	local converts
+
+	$LCTL get_param -n mdc.*.connect_flags | grep -q lock_convert ||
+		{ skip "MDS does not support lock convert"; return; }
+
+	touch $DIR1/$tfile || error "touch $DIR1/$tfile failed"
+	cancel_lru_locks mdc
+	stat $DIR1/$tfile > /dev/null || error "stat $DIR1/$tfile failed"
+
+	$LCTL set_param -n mdc.*.stats=clear
+	$LCTL set_param debug=+dlmtrace
+	$LCTL clear
+	# conflicts with the UPDATE bit of the lock cached by the first mount
+	chmod 0600 $DIR2/$tfile || error "chmod $DIR2/$tfile failed"
+	line=$($LCTL dk | grep "client-side ibits convert, dropped" | tail -1)
+	$LCTL set_param debug="$old_debug"
+	[ -n "$line" ] || error "conflicting bits were not dropped"
+
+	kept=$(sed -e 's/.* bits \([0-9a-fx]*\) .*/\1/' <<< "$line")
+	dropped=$(sed -e 's/.*dropped \([0-9a-fx]*\) .*/\1/' <<< "$line")
+	echo "kept bits $kept, dropped $dropped"
+	(( (kept & 0x1) != 0 )) || error "LOOKUP bit not kept: $kept"
+	(( (kept & 0x2) == 0 )) || error "UPDATE bit not dropped: $kept"
+	(( (kept & dropped) == 0 )) || error "dropped bits kept: $kept"
+
+	converts=$($LCTL get_param -n mdc.*.stats |
+		awk '/ldlm_convert/ { n += $2 } END { print n + 0 }')
+	[ $converts -gt 0 ] || error "no LDLM_CONVERT sent"
+
+	# the dropped UPDATE bit must not leave stale attributes behind
+	[ $(stat -c %a $DIR1/$tfile) == 600 ] ||
+		error "mode of $DIR1/$tfile not refreshed"
+	rm -f $DIR1/$tfile
+}
+run_test 93 "conflicting inodebits are dropped from a cached lock"
+
+test_94() {
+	local param=/sys/module/ptlrpc/parameters/ldlm_bl_batch_delay
+	local old_debug=$($LCTL get_param -n debug)
+	local old_delay
+	local count=32
+	local batched
+	local i
+
+	$LCTL get_param -n osc.*.connect_flags | grep -q bl_batch ||
+		{ skip "OST does not batch blocking ASTs"; return; }
+	old_delay=$(do_facet ost1 cat $param)
+
+	test_mkdir $DIR1/$tdir
+	$LFS setstripe -c 1 -i 0 $DIR1/$tdir
+	for i in $(seq $count); do
+		dd if=/dev/zero of=$DIR1/$tdir/f$i bs=4k count=1 2>/dev/null ||
+			error "write $DIR1/$tdir/f$i failed"
+	done
+
+	# give the conflicting reads time to gather on the OST
+	do_facet ost1 "echo 100 > $param"
+	$LCTL set_param debug=+dlmtrace
+	$LCTL clear
+	for i in $(seq $count); do
+		cat $DIR2/$tdir/f$i > /dev/null &
+	done
+	wait
+	batched=$($LCTL dk | awk '/blocking AST for [0-9]+ locks/ {
+		for (i = 1; i < NF; i++)
+			if ($i == "for" && $(i + 1) > n)
+				n = $(i + 1)
+		} END { print n + 0 }')
+	$LCTL set_param debug="$old_debug"
+	do_facet ost1 "echo $old_delay > $param"
+
+	echo "at most $batched locks per blocking AST"
+	[ $batched -gt 1 ] || error "no blocking AST carried more than one lock"
+	rm -rf $DIR1/$tdir
+}
+run_test 94 "blocking ASTs for one client share an RPC"
+
+test_95() {
+	local end=$((SECONDS + 30))
+	local pids=""
+	local mode
+	local i
+
+	test_mkdir $DIR1/$tdir
+	createmany -o $DIR1/$tdir/f 200 || error "createmany failed"
+
+	# lookup, readdir, getattr, create and setattr of both mounts stack
+	# up locks of all modes and bits on the directory
+	(while [ $SECONDS -lt $end ]; do
+		ls -l $DIR1/$tdir > /dev/null
+	done) &
+	pids="$pids $!"
+	(while [ $SECONDS -lt $end ]; do
+		ls -l $DIR2/$tdir > /dev/null
+	done) &
+	pids="$pids $!"
+	(while [ $SECONDS -lt $end ]; do
+		stat $DIR2/$tdir $DIR2/$tdir/f$((RANDOM % 200)) > /dev/null
+	done) &
+	pids="$pids $!"
+	(i=0; while [ $SECONDS -lt $end ]; do
+		touch $DIR2/$tdir/n$i && rm -f $DIR1/$tdir/n$i
+		i=$((i + 1))
+	done) &
+	pids="$pids $!"
+	(while [ $SECONDS -lt $end ]; do
+		chmod 0700 $DIR1/$tdir && chmod 0755 $DIR2/$tdir
+	done) &
+	pids="$pids $!"
+	wait $pids
+
+	# a conflict missed by the granted lock summary leaves stale state
+	chmod 0711 $DIR1/$tdir || error "chmod $DIR1/$tdir failed"
+	for i in $DIR1 $DIR2; do
+		mode=$(stat -c %a $i/$tdir)
+		[ $mode == 711 ] || error "$i/$tdir mode $mode, not 711"
+		[ $(ls $i/$tdir | wc -l) -eq 200 ] ||
+			error "$i/$tdir: $(ls $i/$tdir | wc -l) entries, not 200"
+	done
+	rm -rf $DIR1/$tdir
+}
+run_test 95 "many inodebits locks of all modes on one directory"
+
 log "cleanup: ======================================================"
 
 # kill and wait in each test only guarentee script finish, but command in script
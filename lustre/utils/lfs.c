@@ -115,6 +115,11 @@ static int lfs_hsm_release(int argc, char **argv);
 static int lfs_hsm_remove(int argc, char **argv);
 static int lfs_hsm_cancel(int argc, char **argv);
 static int lfs_swap_layouts(int argc, char **argv);
+static int lfs_pcc_attach(int argc, char **argv);
+static int lfs_pcc_detach(int argc, char **argv);
+static int lfs_pcc_state(int argc, char **argv);
+static int lfs_mirror_create(int argc, char **argv);
+static int lfs_mirror_resync(int argc, char **argv);
 static int lfs_mv(int argc, char **argv);
 
 /* Setstripe and migrate share mostly the same parameters */
@@ -142,8 +147,26 @@ static int lfs_mv(int argc, char **argv);
 
 #define SETSTRIPE_USAGE						\
 	SSM_CMD_COMMON("setstripe")				\
+	"                 [--layout|-L <raid0|mdt>]\n"		\
 	"                 <directory|filename>\n"		\
-	SSM_HELP_COMMON
+	" or\n"							\
+	"usage: setstripe --component-end|-E <comp_end>\n"	\
+	"                 [--stripe-count|-c <stripe_count>]\n"	\
+	"                 [--stripe-index|-i <start_ost_idx>]\n"	\
+	"                 [--stripe-size|-S <stripe_size>]\n"	\
+	"                 [--pool|-p <pool_name>]\n"		\
+	"                 [--component-end|-E <comp_end> ...]\n"	\
+	"                 <filename>\n"				\
+	SSM_HELP_COMMON						\
+	"\n"							\
+	"\tlayout:       raid0 (default) or mdt to keep the data of\n" \
+	"\t              a small file on the MDT, stripe_size is the\n" \
+	"\t              maximum file size then\n"			\
+	"\tcomp_end:     Extent end of the component, the options\n" \
+	"\t              following it up to the next -E describe it.\n" \
+	"\t              The last component must end at -1 (EOF). The\n" \
+	"\t              OST objects of a component are created when\n" \
+	"\t              it is first written to\n"
 
 #define MIGRATE_USAGE							\
 	SSM_CMD_COMMON("migrate  ")					\
@@ -158,6 +181,8 @@ static int lfs_mv(int argc, char **argv);
 static const char	*progname;
 static bool		 file_lease_supported = true;
 
+static int name2layout(__u32 *layout, char *name);
+
 /* all available commands */
 command_t cmdlist[] = {
 	{"setstripe", lfs_setstripe, 0,
@@ -230,7 +255,7 @@ command_t cmdlist[] = {
          "     [[!] --stripe-size|-S [+-]N[kMGT]] [[!] --type|-t <filetype>]\n"
          "     [[!] --gid|-g|--group|-G <gid>|<gname>]\n"
          "     [[!] --uid|-u|--user|-U <uid>|<uname>] [[!] --pool <pool>]\n"
-	 "     [[!] --layout|-L released,raid0]\n"
+	 "     [[!] --layout|-L released,raid0,mdt] [--lazy]\n"
          "\t !: used before an option indicates 'NOT' requested attribute\n"
          "\t -: used before a value indicates 'AT MOST' requested value\n"
          "\t +: used before a value indicates 'AT LEAST' requested value\n"},
@@ -355,6 +380,31 @@ command_t cmdlist[] = {
 	 "usage: hsm_cancel [--filelist FILELIST] [--data DATA] <file> ..."},
 	{"swap_layouts", lfs_swap_layouts, 0, "Swap layouts between 2 files.\n"
 	 "usage: swap_layouts <path1> <path2>"},
+	{"pcc_attach", lfs_pcc_attach, 0,
+	 "Copy files into the persistent cache of this client.\n"
+	 "usage: pcc_attach <file> ..."},
+	{"pcc_detach", lfs_pcc_detach, 0,
+	 "Drop files from the persistent cache of this client.\n"
+	 "usage: pcc_detach <file> ..."},
+	{"pcc_state", lfs_pcc_state, 0,
+	 "Display the persistent cache state of files on this client.\n"
+	 "usage: pcc_state <file> ..."},
+	{"mirror_create", lfs_mirror_create, 0,
+	 "Create a file with several mirrors (replicas) of its data.\n"
+	 "usage: mirror_create --mirror-count|-N[<count>] [--prefer]\n"
+	 "                     [--component-end|-E <comp_end>]\n"
+	 "                     [--stripe-count|-c <stripe_count>]\n"
+	 "                     [--stripe-index|-i <start_ost_idx>]\n"
+	 "                     [--stripe-size|-S <stripe_size>]\n"
+	 "                     [--pool|-p <pool_name>] ...\n"
+	 "                     <-N ...> <filename>\n"
+	 "\tcount:   number of copies of the mirror that follows (1 default)\n"
+	 "\tprefer:  read from this mirror in preference to the others\n"
+	 "\tcomp_end: end of a component of the mirror, the last one must\n"
+	 "\t          be -1 or eof (a mirror without -E has one component)"},
+	{"mirror_resync", lfs_mirror_resync, 0,
+	 "Copy the data of the primary mirror over the stale mirrors.\n"
+	 "usage: mirror_resync <filename> ..."},
 	{"migrate", lfs_setstripe, 0,
 	 "migrate a directory between MDTs.\n"
 	 "usage: migrate --mdt-index <mdt_idx> [--verbose|-v] "
@@ -895,6 +945,126 @@ static int parse_targets(__u32 *osts, int size, int offset, char *arg)
 	return rc < 0 ? rc : nr;
 }
 
+/* Options of a component of a composite layout, as given to setstripe */
+struct lfs_setstripe_comp {
+	char	*lsc_end_arg;
+	char	*lsc_size_arg;
+	char	*lsc_offset_arg;
+	char	*lsc_count_arg;
+	char	*lsc_pool_arg;
+	__u32	 lsc_flags;
+};
+
+/**
+ * Create files with a composite layout.
+ *
+ * \param cmd		name of the command for the error messages
+ * \param fnames	NULL terminated list of files to create
+ * \param comps		options of the components
+ * \param comp_count	number of components
+ * \param mirror_count	number of mirrors the components describe
+ *
+ * \retval		0 on success, first error encountered otherwise
+ */
+static int lfs_setstripe_comp(const char *cmd, char **fnames,
+			      struct lfs_setstripe_comp *comps, int comp_count,
+			      int mirror_count)
+{
+	struct llapi_stripe_param	*params[LOV_MAX_COMP_COUNT] = { NULL };
+	__u64				 ends[LOV_MAX_COMP_COUNT];
+	__u32				 flags[LOV_MAX_COMP_COUNT];
+	unsigned long long		 size_units;
+	unsigned long long		 val;
+	char				*end;
+	int				 result = 0;
+	int				 rc;
+	int				 i;
+
+	for (i = 0; i < comp_count; i++) {
+		struct lfs_setstripe_comp *comp = &comps[i];
+
+		params[i] = calloc(1, sizeof(*params[i]));
+		if (params[i] == NULL) {
+			fprintf(stderr, "error: %s: run out of memory\n", cmd);
+			result = -ENOMEM;
+			goto out;
+		}
+		params[i]->lsp_stripe_offset = -1;
+		params[i]->lsp_pool = comp->lsc_pool_arg;
+		flags[i] = comp->lsc_flags;
+
+		if (strcmp(comp->lsc_end_arg, "-1") == 0 ||
+		    strcasecmp(comp->lsc_end_arg, "eof") == 0) {
+			ends[i] = LUSTRE_EOF;
+		} else {
+			size_units = 1;
+			if (llapi_parse_size(comp->lsc_end_arg, &val,
+					     &size_units, 0) != 0) {
+				fprintf(stderr, "error: %s: bad component end "
+					"'%s'\n", cmd, comp->lsc_end_arg);
+				result = CMD_HELP;
+				goto out;
+			}
+			ends[i] = val;
+		}
+
+		if (comp->lsc_size_arg != NULL) {
+			size_units = 1;
+			if (llapi_parse_size(comp->lsc_size_arg, &val,
+					     &size_units, 0) != 0) {
+				fprintf(stderr, "error: %s: bad stripe size "
+					"'%s'\n", cmd, comp->lsc_size_arg);
+				result = CMD_HELP;
+				goto out;
+			}
+			params[i]->lsp_stripe_size = val;
+		}
+
+		if (comp->lsc_offset_arg != NULL) {
+			params[i]->lsp_stripe_offset =
+				strtol(comp->lsc_offset_arg, &end, 0);
+			if (*end != '\0') {
+				fprintf(stderr, "error: %s: bad stripe offset "
+					"'%s'\n", cmd, comp->lsc_offset_arg);
+				result = CMD_HELP;
+				goto out;
+			}
+		}
+
+		if (comp->lsc_count_arg != NULL) {
+			params[i]->lsp_stripe_count =
+				strtoul(comp->lsc_count_arg, &end, 0);
+			if (*end != '\0') {
+				fprintf(stderr, "error: %s: bad stripe count "
+					"'%s'\n", cmd, comp->lsc_count_arg);
+				result = CMD_HELP;
+				goto out;
+			}
+		}
+	}
+
+	for (; *fnames != NULL; fnames++) {
+		rc = llapi_file_open_mirror(*fnames, O_CREAT | O_WRONLY, 0644,
+					    params, ends, flags, comp_count,
+					    mirror_count);
+		if (rc >= 0) {
+			close(rc);
+			continue;
+		}
+
+		/* Save the first error encountered. */
+		if (result == 0)
+			result = rc;
+		fprintf(stderr, "error: %s: create file '%s' failed\n",
+			cmd, *fnames);
+	}
+out:
+	for (i = 0; i < comp_count; i++)
+		free(params[i]);
+
+	return result;
+}
+
 /* functions */
 static int lfs_setstripe(int argc, char **argv)
 {
@@ -916,16 +1086,21 @@ static int lfs_setstripe(int argc, char **argv)
 	char				*stripe_count_arg = NULL;
 	char				*pool_name_arg = NULL;
 	char				*mdt_idx_arg = NULL;
+	__u32				 st_pattern = 0;
 	unsigned long long		 size_units = 1;
 	bool				 migrate_mode = false;
 	bool				 migration_block = false;
 	__u64				 migration_flags = 0;
 	__u32				 osts[LOV_MAX_STRIPE_COUNT] = { 0 };
 	int				 nr_osts = 0;
+	struct lfs_setstripe_comp	 comps[LOV_MAX_COMP_COUNT] = { { 0 } };
+	int				 comp_count = 0;
 
 	struct option		 long_opts[] = {
 		/* --block is only valid in migrate mode */
 		{"block",	 no_argument,	    0, 'b'},
+		{"component-end", required_argument, 0, 'E'},
+		{"component_end", required_argument, 0, 'E'},
 #if LUSTRE_VERSION_CODE < OBD_OCD_VERSION(2, 9, 53, 0)
 		/* This formerly implied "stripe-count", but was explicitly
 		 * made "stripe-count" for consistency with other options,
@@ -943,6 +1118,7 @@ static int lfs_setstripe(int argc, char **argv)
 #endif
 		{"stripe-index", required_argument, 0, 'i'},
 		{"stripe_index", required_argument, 0, 'i'},
+		{"layout",	 required_argument, 0, 'L'},
 		{"mdt-index",	 required_argument, 0, 'm'},
 		{"mdt_index",	 required_argument, 0, 'm'},
 		/* --non-block is only valid in migrate mode */
@@ -970,12 +1146,53 @@ static int lfs_setstripe(int argc, char **argv)
 	if (strcmp(argv[0], "migrate") == 0)
 		migrate_mode = true;
 
-	while ((c = getopt_long(argc, argv, "bc:di:m:no:p:s:S:v",
+	while ((c = getopt_long(argc, argv, "bc:dE:i:L:m:no:p:s:S:v",
 				long_opts, NULL)) >= 0) {
 		switch (c) {
 		case 0:
 			/* Long options. */
 			break;
+		case 'E':
+			if (migrate_mode) {
+				fprintf(stderr, "--component-end is not valid "
+						"for migrate mode\n");
+				return CMD_HELP;
+			}
+			if (comp_count == LOV_MAX_COMP_COUNT) {
+				fprintf(stderr, "error: %s: too many "
+					"components, max is %d\n",
+					argv[0], LOV_MAX_COMP_COUNT);
+				return CMD_HELP;
+			}
+			if (comp_count == 0 &&
+			    (stripe_size_arg != NULL ||
+			     stripe_off_arg != NULL ||
+			     stripe_count_arg != NULL ||
+			     pool_name_arg != NULL)) {
+				fprintf(stderr, "error: %s: -E must come "
+					"before the options of the first "
+					"component\n", argv[0]);
+				return CMD_HELP;
+			}
+			/* the options given so far describe the previous
+			 * component */
+			if (comp_count > 0) {
+				comps[comp_count - 1].lsc_size_arg =
+							stripe_size_arg;
+				comps[comp_count - 1].lsc_offset_arg =
+							stripe_off_arg;
+				comps[comp_count - 1].lsc_count_arg =
+							stripe_count_arg;
+				comps[comp_count - 1].lsc_pool_arg =
+							pool_name_arg;
+				stripe_size_arg = NULL;
+				stripe_off_arg = NULL;
+				stripe_count_arg = NULL;
+				pool_name_arg = NULL;
+			}
+			memset(&comps[comp_count], 0, sizeof(comps[0]));
+			comps[comp_count++].lsc_end_arg = optarg;
+			break;
 		case 'b':
 			if (!migrate_mode) {
 				fprintf(stderr, "--block is valid only for"
@@ -1018,6 +1235,20 @@ static int lfs_setstripe(int argc, char **argv)
 #endif
 			stripe_off_arg = optarg;
 			break;
+		case 'L':
+			if (migrate_mode) {
+				fprintf(stderr, "--layout is not valid for"
+						" migrate mode\n");
+				return CMD_HELP;
+			}
+			if (name2layout(&st_pattern, optarg) != 0 ||
+			    (st_pattern != LOV_PATTERN_RAID0 &&
+			     st_pattern != LOV_PATTERN_MDT)) {
+				fprintf(stderr, "error: %s: bad layout '%s'\n",
+					argv[0], optarg);
+				return CMD_HELP;
+			}
+			break;
 		case 'm':
 			if (!migrate_mode) {
 				fprintf(stderr, "--mdt-index is valid only for"
@@ -1077,6 +1308,22 @@ static int lfs_setstripe(int argc, char **argv)
 		return CMD_HELP;
 	}
 
+	if (comp_count > 0) {
+		if (delete || nr_osts > 0 || st_pattern != 0) {
+			fprintf(stderr, "error: %s: cannot specify -d, -o or "
+				"-L with -E\n", argv[0]);
+			return CMD_HELP;
+		}
+
+		comps[comp_count - 1].lsc_size_arg = stripe_size_arg;
+		comps[comp_count - 1].lsc_offset_arg = stripe_off_arg;
+		comps[comp_count - 1].lsc_count_arg = stripe_count_arg;
+		comps[comp_count - 1].lsc_pool_arg = pool_name_arg;
+
+		return lfs_setstripe_comp(argv[0], &argv[optind], comps,
+					  comp_count, 1);
+	}
+
 	if (mdt_idx_arg != NULL && optind > 3) {
 		fprintf(stderr, "error: %s: cannot specify -m with other "
 			"options\n", argv[0]);
@@ -1156,6 +1403,14 @@ static int lfs_setstripe(int argc, char **argv)
                 }
         }
 
+	/* the data on MDT has no OST objects */
+	if (st_pattern == LOV_PATTERN_MDT &&
+	    (st_count != 0 || stripe_off_arg != NULL || nr_osts > 0)) {
+		fprintf(stderr, "error: %s: cannot specify -c, -i or -o with "
+			"the mdt layout\n", argv[0]);
+		return CMD_HELP;
+	}
+
 	if (mdt_idx_arg != NULL) {
 		/* initialize migrate mdt parameters */
 		migrate_mdt_param.fp_mdt_index = strtoul(mdt_idx_arg, &end, 0);
@@ -1177,7 +1432,7 @@ static int lfs_setstripe(int argc, char **argv)
 		param->lsp_stripe_size = st_size;
 		param->lsp_stripe_offset = st_offset;
 		param->lsp_stripe_count = st_count;
-		param->lsp_stripe_pattern = 0;
+		param->lsp_stripe_pattern = st_pattern;
 		param->lsp_pool = pool_name_arg;
 		param->lsp_is_specific = false;
 		if (nr_osts > 0) {
@@ -1328,6 +1583,8 @@ static int name2layout(__u32 *layout, char *name)
 			*layout |= LOV_PATTERN_F_RELEASED;
 		else if (strcmp(lyt, "raid0") == 0)
 			*layout |= LOV_PATTERN_RAID0;
+		else if (strcmp(lyt, "mdt") == 0)
+			*layout |= LOV_PATTERN_MDT;
 		else
 			return -1;
 	}
@@ -1335,6 +1592,7 @@ static int name2layout(__u32 *layout, char *name)
 }
 
 #define FIND_POOL_OPT 3
+#define FIND_LAZY_OPT 4
 static int lfs_find(int argc, char **argv)
 {
 	int c, rc;
@@ -1355,6 +1613,8 @@ static int lfs_find(int argc, char **argv)
                 {"stripe-index", required_argument, 0, 'i'},
                 {"stripe_index", required_argument, 0, 'i'},
 		{"layout",	 required_argument, 0, 'L'},
+		/* --size from the MDT size hint, no glimpse to the OSTs */
+		{"lazy",	 no_argument,	    0, FIND_LAZY_OPT},
                 {"mdt",          required_argument, 0, 'm'},
                 {"mtime",        required_argument, 0, 'M'},
                 {"name",         required_argument, 0, 'n'},
@@ -1522,6 +1782,9 @@ static int lfs_find(int argc, char **argv)
 			param.fp_exclude_pool = !!neg_opt;
 			param.fp_check_pool = 1;
                         break;
+		case FIND_LAZY_OPT:
+			param.fp_lazy = 1;
+			break;
                 case 'n':
 			param.fp_pattern = (char *)optarg;
 			param.fp_exclude_pattern = !!neg_opt;
@@ -3750,6 +4013,8 @@ static int lfs_hsm_state(int argc, char **argv)
 			printf(" never_archive");
 		if (hus.hus_states & HS_LOST)
 			printf(" lost_from_hsm");
+		if (hus.hus_states & HS_PCCRO)
+			printf(" pcc_cached");
 
 		if (hus.hus_archive_id != 0)
 			printf(", archive_id:%d", hus.hus_archive_id);
@@ -4219,6 +4484,265 @@ static int lfs_swap_layouts(int argc, char **argv)
 				  SWAP_LAYOUTS_KEEP_ATIME);
 }
 
+static int lfs_pcc_attach_detach(int argc, char **argv, bool attach)
+{
+	int rc = 0;
+	int rc2;
+	int i;
+
+	if (argc < 2)
+		return CMD_HELP;
+
+	for (i = 1; i < argc; i++) {
+		rc2 = attach ? llapi_pcc_attach(argv[i]) :
+			       llapi_pcc_detach(argv[i]);
+		if (rc2 < 0) {
+			fprintf(stderr, "%s: cannot %s '%s': %s\n", argv[0],
+				attach ? "attach" : "detach", argv[i],
+				strerror(-rc2));
+			if (rc == 0)
+				rc = rc2;
+		}
+	}
+
+	return rc;
+}
+
+static int lfs_pcc_attach(int argc, char **argv)
+{
+	return lfs_pcc_attach_detach(argc, argv, true);
+}
+
+static int lfs_pcc_detach(int argc, char **argv)
+{
+	return lfs_pcc_attach_detach(argc, argv, false);
+}
+
+static int lfs_pcc_state(int argc, char **argv)
+{
+	struct lu_pcc_state	state;
+	int			rc = 0;
+	int			rc2;
+	int			i;
+
+	if (argc < 2)
+		return CMD_HELP;
+
+	for (i = 1; i < argc; i++) {
+		rc2 = llapi_pcc_state_get(argv[i], &state);
+		if (rc2 < 0) {
+			fprintf(stderr, "%s: cannot get state of '%s': %s\n",
+				argv[0], argv[i], strerror(-rc2));
+			if (rc == 0)
+				rc = rc2;
+			continue;
+		}
+
+		if (state.pccs_flags & PCC_STATE_ATTACHED)
+			printf("%s: attached, cache: %s\n", argv[i],
+			       state.pccs_path);
+		else
+			printf("%s: none\n", argv[i]);
+	}
+
+	return rc;
+}
+
+/**
+ * Close the mirror started at \a first: give the pending stripe options to
+ * its last component (or to an implicit component covering the whole file
+ * when no -E was given), apply the mirror flags and replicate it \a copies
+ * times.
+ *
+ * \retval	number of mirrors added on success, negative errno otherwise
+ */
+static int lfs_mirror_close(const char *cmd, struct lfs_setstripe_comp *comps,
+			    int *comp_count, int first, int copies,
+			    struct lfs_setstripe_comp *pending, __u32 flags)
+{
+	int count;
+	int i;
+
+	if (*comp_count == first) {
+		if (*comp_count == LOV_MAX_COMP_COUNT)
+			goto too_many;
+		comps[*comp_count].lsc_end_arg = "eof";
+		(*comp_count)++;
+	}
+
+	comps[*comp_count - 1].lsc_size_arg = pending->lsc_size_arg;
+	comps[*comp_count - 1].lsc_offset_arg = pending->lsc_offset_arg;
+	comps[*comp_count - 1].lsc_count_arg = pending->lsc_count_arg;
+	comps[*comp_count - 1].lsc_pool_arg = pending->lsc_pool_arg;
+	memset(pending, 0, sizeof(*pending));
+
+	count = *comp_count - first;
+	for (i = first; i < *comp_count; i++)
+		comps[i].lsc_flags = flags;
+
+	for (i = 1; i < copies; i++) {
+		if (*comp_count + count > LOV_MAX_COMP_COUNT)
+			goto too_many;
+		memcpy(&comps[*comp_count], &comps[first],
+		       count * sizeof(*comps));
+		*comp_count += count;
+	}
+
+	return copies;
+
+too_many:
+	fprintf(stderr, "error: %s: too many components, max is %d\n",
+		cmd, LOV_MAX_COMP_COUNT);
+	return -E2BIG;
+}
+
+static int lfs_mirror_create(int argc, char **argv)
+{
+	struct lfs_setstripe_comp	 comps[LOV_MAX_COMP_COUNT] = { { 0 } };
+	struct lfs_setstripe_comp	 pending = { 0 };
+	int				 comp_count = 0;
+	int				 mirror_count = 0;
+	int				 first = -1;
+	int				 copies = 0;
+	__u32				 flags = 0;
+	char				*end;
+	int				 rc;
+	int				 c;
+
+	struct option		 long_opts[] = {
+		{"stripe-count",  required_argument, 0, 'c'},
+		{"component-end", required_argument, 0, 'E'},
+		{"stripe-index",  required_argument, 0, 'i'},
+		{"mirror-count",  optional_argument, 0, 'N'},
+		{"pool",	  required_argument, 0, 'p'},
+		{"prefer",	  no_argument,	     0, 'P'},
+		{"stripe-size",   required_argument, 0, 'S'},
+		{0, 0, 0, 0}
+	};
+
+	while ((c = getopt_long(argc, argv, "c:E:i:N::p:S:",
+				long_opts, NULL)) >= 0) {
+		if (c != 'N' && first < 0) {
+			fprintf(stderr, "error: %s: -N must come before the "
+				"options of the first mirror\n", argv[0]);
+			return CMD_HELP;
+		}
+
+		switch (c) {
+		case 'N':
+			if (first >= 0) {
+				rc = lfs_mirror_close(argv[0], comps,
+						      &comp_count, first,
+						      copies, &pending, flags);
+				if (rc < 0)
+					return CMD_HELP;
+				mirror_count += rc;
+			}
+			first = comp_count;
+			flags = 0;
+			copies = 1;
+			if (optarg != NULL) {
+				copies = strtoul(optarg, &end, 0);
+				if (*end != '\0' || copies < 1 ||
+				    copies > LOV_MAX_MIRROR_COUNT) {
+					fprintf(stderr, "error: %s: bad mirror "
+						"count '%s'\n", argv[0],
+						optarg);
+					return CMD_HELP;
+				}
+			}
+			break;
+		case 'E':
+			if (comp_count == LOV_MAX_COMP_COUNT) {
+				fprintf(stderr, "error: %s: too many "
+					"components, max is %d\n",
+					argv[0], LOV_MAX_COMP_COUNT);
+				return CMD_HELP;
+			}
+			/* the options given so far describe the previous
+			 * component of this mirror */
+			if (comp_count > first) {
+				comps[comp_count - 1].lsc_size_arg =
+						pending.lsc_size_arg;
+				comps[comp_count - 1].lsc_offset_arg =
+						pending.lsc_offset_arg;
+				comps[comp_count - 1].lsc_count_arg =
+						pending.lsc_count_arg;
+				comps[comp_count - 1].lsc_pool_arg =
+						pending.lsc_pool_arg;
+				memset(&pending, 0, sizeof(pending));
+			}
+			comps[comp_count++].lsc_end_arg = optarg;
+			break;
+		case 'c':
+			pending.lsc_count_arg = optarg;
+			break;
+		case 'i':
+			pending.lsc_offset_arg = optarg;
+			break;
+		case 'p':
+			pending.lsc_pool_arg = optarg;
+			break;
+		case 'P':
+			flags |= LCME_FL_PREF_RD;
+			break;
+		case 'S':
+			pending.lsc_size_arg = optarg;
+			break;
+		default:
+			return CMD_HELP;
+		}
+	}
+
+	if (first < 0) {
+		fprintf(stderr, "error: %s: no mirror given\n", argv[0]);
+		return CMD_HELP;
+	}
+
+	if (optind == argc) {
+		fprintf(stderr, "error: %s: missing filename\n", argv[0]);
+		return CMD_HELP;
+	}
+
+	rc = lfs_mirror_close(argv[0], comps, &comp_count, first, copies,
+			      &pending, flags);
+	if (rc < 0)
+		return CMD_HELP;
+	mirror_count += rc;
+
+	if (mirror_count < 2 || mirror_count > LOV_MAX_MIRROR_COUNT) {
+		fprintf(stderr, "error: %s: a mirrored file needs 2 to %d "
+			"mirrors, %d given\n", argv[0], LOV_MAX_MIRROR_COUNT,
+			mirror_count);
+		return CMD_HELP;
+	}
+
+	return lfs_setstripe_comp(argv[0], &argv[optind], comps, comp_count,
+				  mirror_count);
+}
+
+static int lfs_mirror_resync(int argc, char **argv)
+{
+	int result = 0;
+	int rc;
+	int i;
+
+	if (argc < 2)
+		return CMD_HELP;
+
+	for (i = 1; i < argc; i++) {
+		rc = llapi_mirror_resync(argv[i]);
+		if (rc < 0) {
+			fprintf(stderr, "error: %s: cannot resync '%s': %s\n",
+				argv[0], argv[i], strerror(-rc));
+			if (result == 0)
+				result = rc;
+		}
+	}
+
+	return result;
+}
+
 int main(int argc, char **argv)
 {
         int rc;
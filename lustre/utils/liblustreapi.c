@@ -54,6 +54,7 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <limits.h>
 #include <dirent.h>
 #include <stdarg.h>
 #include <sys/stat.h>
@@ -452,6 +453,49 @@ int llapi_search_ost(char *fsname, char *poolname, char *ostname)
         return 0;
 }
 
+/**
+ * Check that the pool a file is to be striped over exists and has OSTs.
+ *
+ * \param fsname     the name of the filesystem the file is in
+ * \param pool_name  the name of the pool, stripped of the filesystem name
+ *                   on return if it was given as <fsname>.<poolname>
+ *
+ * \retval           0 on success
+ * \retval           negative errno on failure
+ */
+static int llapi_stripe_pool_check(char *fsname, char **pool_name)
+{
+	char *ptr;
+	int rc;
+
+	/* in case user gives the full pool name <fsname>.<poolname>,
+	 * strip the fsname */
+	ptr = strchr(*pool_name, '.');
+	if (ptr != NULL) {
+		*ptr = '\0';
+		if (strcmp(*pool_name, fsname) != 0) {
+			*ptr = '.';
+			llapi_err_noerrno(LLAPI_MSG_ERROR,
+				"Pool '%s' is not on filesystem '%s'",
+				*pool_name, fsname);
+			return -EINVAL;
+		}
+		*pool_name = ptr + 1;
+	}
+
+	/* Make sure the pool exists and is non-empty */
+	rc = llapi_search_ost(fsname, *pool_name, NULL);
+	if (rc < 1) {
+		char *err = rc == 0 ? "has no OSTs" : "does not exist";
+
+		llapi_err_noerrno(LLAPI_MSG_ERROR, "pool '%s.%s' %s",
+				  fsname, *pool_name, err);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
 /**
  * Open a Lustre file.
  *
@@ -491,30 +535,9 @@ int llapi_file_open_param(const char *name, int flags, mode_t mode,
 
 	/* Make sure we have a good pool */
 	if (pool_name != NULL) {
-		/* in case user gives the full pool name <fsname>.<poolname>,
-		 * strip the fsname */
-		char *ptr = strchr(pool_name, '.');
-		if (ptr != NULL) {
-			*ptr = '\0';
-			if (strcmp(pool_name, fsname) != 0) {
-				*ptr = '.';
-				llapi_err_noerrno(LLAPI_MSG_ERROR,
-					"Pool '%s' is not on filesystem '%s'",
-					pool_name, fsname);
-				return -EINVAL;
-			}
-			pool_name = ptr + 1;
-		}
-
-		/* Make sure the pool exists and is non-empty */
-		rc = llapi_search_ost(fsname, pool_name, NULL);
-		if (rc < 1) {
-			char *err = rc == 0 ? "has no OSTs" : "does not exist";
-
-			llapi_err_noerrno(LLAPI_MSG_ERROR, "pool '%s.%s' %s",
-					  fsname, pool_name, err);
-			return -EINVAL;
-		}
+		rc = llapi_stripe_pool_check(fsname, &pool_name);
+		if (rc != 0)
+			return rc;
 
 		lum_size = sizeof(struct lov_user_md_v3);
 	}
@@ -626,6 +649,433 @@ retry_open:
 	return fd;
 }
 
+/**
+ * Open a Lustre file with a mirrored composite layout.
+ *
+ * The components of a mirror follow each other from 0 to LUSTRE_EOF, the
+ * component after one ending at LUSTRE_EOF starts the next mirror. Writes
+ * go to one mirror and make the others stale until they are resynchronized,
+ * see llapi_mirror_resync(); reads are spread over the mirrors in sync.
+ *
+ * \param name		the name of the file to be opened
+ * \param flags		access mode, see flags in open(2)
+ * \param mode		permission of the file if it is created, see mode
+ *			in open(2)
+ * \param params	stripe patterns of the components
+ * \param ends		ends of the component extents
+ * \param comp_flags	LCME_USER_FLAGS of the components, or NULL
+ * \param count		number of components
+ * \param mirror_count	number of mirrors the components describe
+ *
+ * \retval		file descriptor of opened file
+ * \retval		negative errno on failure
+ */
+int llapi_file_open_mirror(const char *name, int flags, mode_t mode,
+			   struct llapi_stripe_param * const *params,
+			   const __u64 *ends, const __u32 *comp_flags,
+			   int count, int mirror_count)
+{
+	char fsname[MAX_OBD_NAME + 1] = { 0 };
+	char *pool_names[LOV_MAX_COMP_COUNT] = { NULL };
+	struct lov_comp_md_v1 *lcm;
+	struct lov_comp_md_entry_v1 *lcme;
+	struct lov_user_md *lum;
+	size_t lcm_size;
+	__u64 start = 0;
+	int mirrors = 1;
+	int fd, rc, i;
+
+	if (count < 1 || count > LOV_MAX_COMP_COUNT) {
+		llapi_err_noerrno(LLAPI_MSG_ERROR,
+				  "invalid component count %d (max %d)",
+				  count, LOV_MAX_COMP_COUNT);
+		return -EINVAL;
+	}
+
+	if (mirror_count < 1 || mirror_count > LOV_MAX_MIRROR_COUNT) {
+		llapi_err_noerrno(LLAPI_MSG_ERROR,
+				  "invalid mirror count %d (max %d)",
+				  mirror_count, LOV_MAX_MIRROR_COUNT);
+		return -EINVAL;
+	}
+
+	/* Make sure we are on a Lustre file system */
+	rc = llapi_search_fsname(name, fsname);
+	if (rc) {
+		llapi_error(LLAPI_MSG_ERROR, rc,
+			    "'%s' is not on a Lustre filesystem",
+			    name);
+		return rc;
+	}
+
+	lcm_size = offsetof(struct lov_comp_md_v1, lcm_entries[count]);
+	for (i = 0; i < count; i++) {
+		const struct llapi_stripe_param *param = params[i];
+
+		if (i > 0 && ends[i - 1] == LUSTRE_EOF) {
+			start = 0;
+			mirrors++;
+		}
+		if (ends[i] <= start ||
+		    (i == count - 1 && ends[i] != LUSTRE_EOF)) {
+			llapi_err_noerrno(LLAPI_MSG_ERROR,
+					  "invalid end "LPU64" of component %d",
+					  ends[i], i);
+			return -EINVAL;
+		}
+		start = ends[i];
+
+		if (comp_flags != NULL && comp_flags[i] & ~LCME_USER_FLAGS) {
+			llapi_err_noerrno(LLAPI_MSG_ERROR,
+					  "invalid flags %#x of component %d",
+					  comp_flags[i], i);
+			return -EINVAL;
+		}
+
+		if (param->lsp_is_specific) {
+			llapi_err_noerrno(LLAPI_MSG_ERROR,
+					  "OST list is not supported by "
+					  "composite layouts");
+			return -EINVAL;
+		}
+
+		rc = llapi_stripe_limit_check(param->lsp_stripe_size,
+					      param->lsp_stripe_offset,
+					      param->lsp_stripe_count,
+					      param->lsp_stripe_pattern);
+		if (rc != 0)
+			return rc;
+
+		pool_names[i] = param->lsp_pool;
+		if (pool_names[i] != NULL) {
+			rc = llapi_stripe_pool_check(fsname, &pool_names[i]);
+			if (rc != 0)
+				return rc;
+
+			lcm_size += sizeof(struct lov_user_md_v3);
+		} else {
+			lcm_size += sizeof(struct lov_user_md_v1);
+		}
+	}
+
+	if (mirrors != mirror_count) {
+		llapi_err_noerrno(LLAPI_MSG_ERROR,
+				  "components describe %d mirrors, not %d",
+				  mirrors, mirror_count);
+		return -EINVAL;
+	}
+
+	lcm = calloc(1, lcm_size);
+	if (lcm == NULL)
+		return -ENOMEM;
+
+	/*  Initialize IOCTL composite layout structure */
+	lcm->lcm_magic = LOV_USER_MAGIC_COMP_V1;
+	lcm->lcm_size = lcm_size;
+	lcm->lcm_entry_count = count;
+	if (mirror_count > 1)
+		lcm->lcm_mirror_count = mirror_count;
+
+	start = 0;
+	lcm_size = offsetof(struct lov_comp_md_v1, lcm_entries[count]);
+	for (i = 0; i < count; i++) {
+		lcme = &lcm->lcm_entries[i];
+		if (i > 0 && ends[i - 1] == LUSTRE_EOF)
+			start = 0;
+		if (comp_flags != NULL)
+			lcme->lcme_flags = comp_flags[i];
+		lcme->lcme_extent.e_start = start;
+		lcme->lcme_extent.e_end = ends[i];
+		lcme->lcme_offset = lcm_size;
+		start = ends[i];
+
+		lum = (struct lov_user_md *)((char *)lcm + lcm_size);
+		lum->lmm_magic = LOV_USER_MAGIC_V1;
+		lum->lmm_pattern = params[i]->lsp_stripe_pattern;
+		lum->lmm_stripe_size = params[i]->lsp_stripe_size;
+		lum->lmm_stripe_count = params[i]->lsp_stripe_count;
+		lum->lmm_stripe_offset = params[i]->lsp_stripe_offset;
+		if (pool_names[i] != NULL) {
+			struct lov_user_md_v3 *lumv3 = (void *)lum;
+
+			lumv3->lmm_magic = LOV_USER_MAGIC_V3;
+			strncpy(lumv3->lmm_pool_name, pool_names[i],
+				LOV_MAXPOOLNAME);
+			lcme->lcme_size = sizeof(*lumv3);
+		} else {
+			lcme->lcme_size = sizeof(struct lov_user_md_v1);
+		}
+		lcm_size += lcme->lcme_size;
+	}
+
+	fd = open(name, flags | O_LOV_DELAY_CREATE, mode);
+	if (fd < 0) {
+		rc = -errno;
+		llapi_error(LLAPI_MSG_ERROR, rc, "unable to open '%s'", name);
+		free(lcm);
+		return rc;
+	}
+
+	if (ioctl(fd, LL_IOC_LOV_SETSTRIPE, lcm) != 0) {
+		char *errmsg = "stripe already set";
+
+		rc = -errno;
+		if (errno != EEXIST && errno != EALREADY)
+			errmsg = strerror(errno);
+
+		llapi_err_noerrno(LLAPI_MSG_ERROR,
+				  "error on ioctl "LPX64" for '%s' (%d): %s",
+				  (__u64)LL_IOC_LOV_SETSTRIPE, name, fd,
+				  errmsg);
+
+		close(fd);
+		fd = rc;
+	}
+
+	free(lcm);
+
+	return fd;
+}
+
+/**
+ * Open a Lustre file with a composite layout.
+ *
+ * The component \a i covers the file extent [ends[i - 1], ends[i]) and is
+ * striped following \a params[i], the first component starts at 0 and the
+ * last one must end at LUSTRE_EOF. The OST objects of a component are only
+ * created when the component is written to for the first time.
+ *
+ * \param name     the name of the file to be opened
+ * \param flags    access mode, see flags in open(2)
+ * \param mode     permission of the file if it is created, see mode in open(2)
+ * \param params   stripe patterns of the components
+ * \param ends     ends of the component extents
+ * \param count    number of components
+ *
+ * \retval         file descriptor of opened file
+ * \retval         negative errno on failure
+ */
+int llapi_file_open_comp(const char *name, int flags, mode_t mode,
+			 struct llapi_stripe_param * const *params,
+			 const __u64 *ends, int count)
+{
+	return llapi_file_open_mirror(name, flags, mode, params, ends, NULL,
+				      count, 1);
+}
+
+/* O_DIRECT IO size used to copy the data between mirrors */
+#define MIRROR_RESYNC_IO_SIZE	(4 << 20)
+
+/**
+ * Copy [start, end) of a file from mirror \a src to mirror \a dst.
+ *
+ * The data is copied with O_DIRECT as the page cache is shared by the
+ * mirrors. The last block is written whole, the mirror is truncated to the
+ * file size afterwards.
+ */
+static int llapi_mirror_copy(int rfd, int wfd, __u16 src, __u16 dst,
+			     __u64 start, __u64 end, void *buf)
+{
+	ssize_t page_size = sysconf(_SC_PAGESIZE);
+	ssize_t count, rd, wr;
+
+	if (ioctl(rfd, LL_IOC_FLR_SET_MIRROR, src) < 0 ||
+	    ioctl(wfd, LL_IOC_FLR_SET_MIRROR, dst) < 0)
+		return -errno;
+
+	while (start < end) {
+		count = end - start;
+		if (count > MIRROR_RESYNC_IO_SIZE)
+			count = MIRROR_RESYNC_IO_SIZE;
+		count = (count + page_size - 1) & ~(page_size - 1);
+
+		rd = pread(rfd, buf, count, start);
+		if (rd < 0)
+			return -errno;
+		if (rd == 0)
+			break;
+
+		wr = (rd + page_size - 1) & ~(page_size - 1);
+		memset((char *)buf + rd, 0, wr - rd);
+		if (pwrite(wfd, buf, wr, start) != wr)
+			return errno != 0 ? -errno : -EIO;
+
+		start += rd;
+		if (rd < count)
+			break;
+	}
+
+	return 0;
+}
+
+/**
+ * Resynchronize the stale mirrors of a mirrored file.
+ *
+ * The MDT is told the resync starts, it instantiates the stale components
+ * the data is copied to. The data of the mirror in sync is then copied to
+ * the stale components and the MDT clears the stale flags, unless the file
+ * was written to in the meantime.
+ *
+ * \param name		name of the mirrored file
+ *
+ * \retval 0		on success, or if the file is in sync already
+ * \retval -EBUSY	if the file was modified during the resync
+ * \retval		negative errno on other failures
+ */
+int llapi_mirror_resync(const char *name)
+{
+	struct lov_comp_md_v1 *lcm = NULL;
+	struct lov_comp_md_entry_v1 *src, *dst;
+	__u64 start, end;
+	__u32 stale = 0;
+	__u32 gen;
+	struct stat st;
+	void *buf = NULL;
+	int rfd = -1, wfd = -1;
+	int primary, rc, i, j;
+
+	rfd = open(name, O_RDONLY | O_DIRECT);
+	wfd = open(name, O_WRONLY | O_DIRECT);
+	if (rfd < 0 || wfd < 0) {
+		rc = -errno;
+		llapi_error(LLAPI_MSG_ERROR, rc, "cannot open '%s'", name);
+		goto out;
+	}
+
+	if (ioctl(wfd, LL_IOC_MIRROR_RESYNC_START, &gen) < 0) {
+		rc = -errno;
+		llapi_error(LLAPI_MSG_ERROR, rc, "cannot start resync of '%s'",
+			    name);
+		goto out;
+	}
+
+	lcm = calloc(1, XATTR_SIZE_MAX);
+	if (lcm == NULL) {
+		rc = -ENOMEM;
+		goto out;
+	}
+	lcm->lcm_magic = LOV_USER_MAGIC_COMP_V1;
+	lcm->lcm_size = XATTR_SIZE_MAX;
+	if (ioctl(rfd, LL_IOC_LOV_GETSTRIPE, lcm) < 0) {
+		rc = -errno;
+		llapi_error(LLAPI_MSG_ERROR, rc, "cannot get layout of '%s'",
+			    name);
+		goto out;
+	}
+
+	if (lcm->lcm_magic != LOV_USER_MAGIC_COMP_V1 ||
+	    lcm->lcm_mirror_count < 2) {
+		rc = -EINVAL;
+		llapi_err_noerrno(LLAPI_MSG_ERROR, "'%s' is not mirrored",
+				  name);
+		goto out;
+	}
+
+	/* nothing was written since the last resync */
+	if ((lcm->lcm_flags & LCM_FL_FLR_MASK) == LCM_FL_RDONLY) {
+		rc = 0;
+		goto out;
+	}
+
+	for (i = 0; i < lcm->lcm_entry_count; i++)
+		if (lcm->lcm_entries[i].lcme_flags & LCME_FL_STALE)
+			stale |= 1 << mirror_id_of(lcm->lcm_entries[i].lcme_id);
+
+	for (primary = 1; primary <= lcm->lcm_mirror_count; primary++)
+		if (!(stale & (1 << primary)))
+			break;
+	if (primary > lcm->lcm_mirror_count) {
+		rc = -EIO;
+		llapi_err_noerrno(LLAPI_MSG_ERROR, "no mirror of '%s' is in "
+				  "sync", name);
+		goto out;
+	}
+
+	if (fstat(rfd, &st) < 0) {
+		rc = -errno;
+		goto out;
+	}
+
+	rc = posix_memalign(&buf, sysconf(_SC_PAGESIZE),
+			    MIRROR_RESYNC_IO_SIZE);
+	if (rc != 0) {
+		rc = -rc;
+		goto out;
+	}
+
+	/* stale components without objects have no data to copy to them */
+	for (i = 0; i < lcm->lcm_entry_count; i++) {
+		dst = &lcm->lcm_entries[i];
+		if (!(dst->lcme_flags & LCME_FL_STALE) ||
+		    !(dst->lcme_flags & LCME_FL_INIT))
+			continue;
+
+		for (j = 0; j < lcm->lcm_entry_count; j++) {
+			src = &lcm->lcm_entries[j];
+			if (mirror_id_of(src->lcme_id) != primary ||
+			    !(src->lcme_flags & LCME_FL_INIT))
+				continue;
+
+			start = src->lcme_extent.e_start;
+			if (start < dst->lcme_extent.e_start)
+				start = dst->lcme_extent.e_start;
+			end = src->lcme_extent.e_end;
+			if (end > dst->lcme_extent.e_end)
+				end = dst->lcme_extent.e_end;
+			if (end > st.st_size)
+				end = st.st_size;
+			if (start >= end)
+				continue;
+
+			rc = llapi_mirror_copy(rfd, wfd, primary,
+					       mirror_id_of(dst->lcme_id),
+					       start, end, buf);
+			if (rc < 0) {
+				llapi_error(LLAPI_MSG_ERROR, rc,
+					    "cannot copy ["LPU64", "LPU64") "
+					    "of '%s' to mirror %u", start, end,
+					    name, mirror_id_of(dst->lcme_id));
+				goto out;
+			}
+		}
+	}
+
+	/* drop the data the stale mirrors have beyond EOF */
+	for (i = 1; i <= lcm->lcm_mirror_count; i++) {
+		if (!(stale & (1 << i)))
+			continue;
+		if (ioctl(wfd, LL_IOC_FLR_SET_MIRROR, i) < 0 ||
+		    ftruncate(wfd, st.st_size) < 0) {
+			rc = -errno;
+			llapi_error(LLAPI_MSG_ERROR, rc, "cannot truncate "
+				    "mirror %d of '%s'", i, name);
+			goto out;
+		}
+	}
+
+	if (ioctl(wfd, LL_IOC_FLR_SET_MIRROR, 0) < 0 ||
+	    ioctl(wfd, LL_IOC_MIRROR_RESYNC_DONE, &gen) < 0) {
+		rc = -errno;
+		if (rc == -EBUSY)
+			llapi_err_noerrno(LLAPI_MSG_ERROR, "'%s' was modified "
+					  "during resync", name);
+		else
+			llapi_error(LLAPI_MSG_ERROR, rc, "cannot complete "
+				    "resync of '%s'", name);
+		goto out;
+	}
+	rc = 0;
+out:
+	free(buf);
+	free(lcm);
+	if (wfd >= 0)
+		close(wfd);
+	if (rfd >= 0)
+		close(rfd);
+
+	return rc;
+}
+
 int llapi_file_open_pool(const char *name, int flags, int mode,
 			 unsigned long long stripe_size, int stripe_offset,
 			 int stripe_count, int stripe_pattern, char *pool_name)
@@ -1309,13 +1759,17 @@ static int common_param_init(struct find_param *param, char *path)
 		lum_size = PATH_MAX + 1;
 
 	param->fp_lum_size = lum_size;
-	param->fp_lmd = calloc(1, sizeof(lstat_t) + param->fp_lum_size);
-	if (param->fp_lmd == NULL) {
+	/* room for the lazy flags in front of the stat and layout, see
+	 * get_lmd_info() */
+	param->fp_lmdl = calloc(1, sizeof(*param->fp_lmdl) +
+				param->fp_lum_size);
+	if (param->fp_lmdl == NULL) {
 		llapi_error(LLAPI_MSG_ERROR, -ENOMEM,
 			    "error: allocation of %zu bytes for ioctl",
-			    sizeof(lstat_t) + param->fp_lum_size);
+			    sizeof(*param->fp_lmdl) + param->fp_lum_size);
 		return -ENOMEM;
 	}
+	param->fp_lmd = &param->fp_lmdl->lmdl_lmd;
 
 	param->fp_lmv_stripe_count = 256;
 	param->fp_lmv_md = calloc(1,
@@ -1342,8 +1796,8 @@ static void find_param_fini(struct find_param *param)
 	if (param->fp_obd_indexes)
 		free(param->fp_obd_indexes);
 
-	if (param->fp_lmd)
-		free(param->fp_lmd);
+	if (param->fp_lmdl)
+		free(param->fp_lmdl);
 
 	if (param->fp_lmv_md)
 		free(param->fp_lmv_md);
@@ -1412,8 +1866,13 @@ again:
 	return ret;
 }
 
+/*
+ * If \a lazy is not NULL, \a lmd must be the lmdl_lmd of a
+ * struct lov_user_mds_data_lazy and the size of a regular file is taken from
+ * the lazy size-on-MDT if there is one, as told by the flags set in \a lazy.
+ */
 static int get_lmd_info(char *path, DIR *parent, DIR *dir,
-                 struct lov_user_mds_data *lmd, int lumlen)
+			struct lov_user_mds_data *lmd, int lumlen, __u32 *lazy)
 {
         lstat_t *st = &lmd->lmd_st;
         int ret = 0;
@@ -1421,6 +1880,9 @@ static int get_lmd_info(char *path, DIR *parent, DIR *dir,
         if (parent == NULL && dir == NULL)
                 return -EINVAL;
 
+	if (lazy != NULL)
+		*lazy = 0;
+
         if (dir) {
                 ret = ioctl(dirfd(dir), LL_IOC_MDC_GETINFO, (void *)lmd);
         } else if (parent) {
@@ -1433,9 +1895,23 @@ static int get_lmd_info(char *path, DIR *parent, DIR *dir,
 		 * client dcache with millions of dentries when traversing
 		 * a large filesystem.  */
 		fname = (fname == NULL ? path : fname + 1);
-		/* retrieve needed file info */
-		strlcpy((char *)lmd, fname, lumlen);
-		ret = ioctl(dirfd(parent), IOC_MDC_GETFILEINFO, (void *)lmd);
+		if (lazy != NULL) {
+			struct lov_user_mds_data_lazy *lmdl;
+
+			lmdl = (void *)((char *)lmd -
+				offsetof(struct lov_user_mds_data_lazy,
+					 lmdl_lmd));
+			strlcpy((char *)lmdl, fname, lumlen);
+			ret = ioctl(dirfd(parent), IOC_MDC_GETFILEINFO_LAZY,
+				    (void *)lmdl);
+			if (ret == 0)
+				*lazy = lmdl->lmdl_lazy;
+		} else {
+			/* retrieve needed file info */
+			strlcpy((char *)lmd, fname, lumlen);
+			ret = ioctl(dirfd(parent), IOC_MDC_GETFILEINFO,
+				    (void *)lmd);
+		}
         }
 
         if (ret) {
@@ -1470,12 +1946,155 @@ static int get_lmd_info(char *path, DIR *parent, DIR *dir,
 	return ret;
 }
 
+/* directory entries stat'ed together with llapi_getattr_batch() */
+struct find_batch {
+	int				 fb_count;
+	struct dirent64			 fb_dents[LL_GETATTR_BATCH_MAX];
+	char				*fb_names[LL_GETATTR_BATCH_MAX];
+	/* index in fb_ents of each entry of fb_dents, -1 if not stat'ed */
+	int				 fb_slot[LL_GETATTR_BATCH_MAX];
+	struct ll_getattr_batch_entry	 fb_ents[LL_GETATTR_BATCH_MAX];
+};
+
+static int llapi_semantic_traverse(char *path, int size, DIR *parent,
+				   semantic_func_t sem_init,
+				   semantic_func_t sem_fini, void *data,
+				   struct dirent64 *de);
+
+/*
+ * Handle the entry \a dent of directory \a d, \a ent holds its attributes if
+ * they were fetched with llapi_getattr_batch().
+ *
+ * \retval 1 if the traversal of \a d must stop, 0 or negative errno otherwise
+ */
+static int llapi_semantic_traverse_entry(char *path, int len, int size,
+					 DIR *d, struct dirent64 *dent,
+					 struct ll_getattr_batch_entry *ent,
+					 semantic_func_t sem_init,
+					 semantic_func_t sem_fini, void *data)
+{
+	struct find_param *param = (struct find_param *)data;
+	int ret = 0;
+	int rc;
+
+	path[len] = 0;
+	if ((len + dent->d_reclen + 2) > size) {
+		llapi_err_noerrno(LLAPI_MSG_ERROR,
+				  "error: %s: string buffer is too small",
+				  __func__);
+		return 1;
+	}
+	strcat(path, "/");
+	strcat(path, dent->d_name);
+
+	if (dent->d_type == DT_UNKNOWN && ent != NULL) {
+		dent->d_type = IFTODT(ent->lgbe_st.st_mode);
+	} else if (dent->d_type == DT_UNKNOWN) {
+		lstat_t *st = &param->fp_lmd->lmd_st;
+
+		rc = get_lmd_info(path, d, NULL, param->fp_lmd,
+				  param->fp_lum_size, NULL);
+		if (rc == 0)
+			dent->d_type = IFTODT(st->st_mode);
+		else
+			ret = rc;
+
+		if (rc == -ENOENT)
+			return ret;
+	}
+	switch (dent->d_type) {
+	case DT_UNKNOWN:
+		llapi_err_noerrno(LLAPI_MSG_ERROR,
+				  "error: %s: '%s' is UNKNOWN type %d",
+				  __func__, dent->d_name, dent->d_type);
+		break;
+	case DT_DIR:
+		rc = llapi_semantic_traverse(path, size, d, sem_init,
+					     sem_fini, data, dent);
+		if (rc != 0 && ret == 0)
+			ret = rc;
+		break;
+	default:
+		rc = 0;
+		param->fp_batch_ent = ent;
+		if (sem_init) {
+			rc = sem_init(path, d, NULL, data, dent);
+			if (rc < 0 && ret == 0)
+				ret = rc;
+		}
+		if (sem_fini && rc == 0)
+			sem_fini(path, d, NULL, data, dent);
+		param->fp_batch_ent = NULL;
+	}
+
+	return ret;
+}
+
+/*
+ * Stat the entries gathered in \a fb other than directories with a single
+ * RPC, then handle all of them in readdir order. Entries the batch could not
+ * stat are handled as if there was no batch.
+ */
+static int llapi_semantic_traverse_batch(char *path, int len, int size,
+					 DIR *d, struct find_batch *fb,
+					 semantic_func_t sem_init,
+					 semantic_func_t sem_fini, void *data)
+{
+	struct find_param *param = (struct find_param *)data;
+	int count = 0;
+	int ret = 0;
+	int rc;
+	int i;
+
+	for (i = 0; i < fb->fb_count; i++) {
+		fb->fb_slot[i] = -1;
+		if (fb->fb_dents[i].d_type == DT_DIR)
+			continue;
+		fb->fb_slot[i] = count;
+		fb->fb_names[count++] = fb->fb_dents[i].d_name;
+	}
+
+	if (count > 1) {
+		rc = llapi_getattr_batch(dirfd(d), fb->fb_names, count,
+					 fb->fb_ents);
+		/* not a Lustre client, do not try again. -EOPNOTSUPP is
+		 * returned without an RPC for striped directories and MDTs
+		 * not supporting batches */
+		if (rc == -ENOTTY)
+			param->fp_batch_stat = 0;
+		if (rc != 0)
+			count = 0;
+	} else {
+		count = 0;
+	}
+
+	for (i = 0; i < fb->fb_count; i++) {
+		struct ll_getattr_batch_entry *ent = NULL;
+
+		if (count > 0 && fb->fb_slot[i] >= 0 &&
+		    fb->fb_ents[fb->fb_slot[i]].lgbe_rc == 0)
+			ent = &fb->fb_ents[fb->fb_slot[i]];
+
+		rc = llapi_semantic_traverse_entry(path, len, size, d,
+						   &fb->fb_dents[i], ent,
+						   sem_init, sem_fini, data);
+		if (rc > 0)
+			return rc;
+		if (rc < 0 && ret == 0)
+			ret = rc;
+	}
+	fb->fb_count = 0;
+
+	return ret;
+}
+
 static int llapi_semantic_traverse(char *path, int size, DIR *parent,
 				   semantic_func_t sem_init,
 				   semantic_func_t sem_fini, void *data,
 				   struct dirent64 *de)
 {
 	struct find_param *param = (struct find_param *)data;
+	struct find_batch *fb = NULL;
 	struct dirent64 *dent;
 	int len, ret;
 	DIR *d, *p = NULL;
@@ -1504,7 +2123,13 @@ static int llapi_semantic_traverse(char *path, int size, DIR *parent,
 	if (d == NULL)
 		goto out;
 
+	if (param->fp_batch_stat)
+		fb = malloc(sizeof(*fb));
+	if (fb != NULL)
+		fb->fb_count = 0;
+
 	while ((dent = readdir64(d)) != NULL) {
+		struct dirent64 *bdent;
 		int rc;
 
                 if (!strcmp(dent->d_name, ".") || !strcmp(dent->d_name, ".."))
@@ -1514,52 +2139,40 @@ static int llapi_semantic_traverse(char *path, int size, DIR *parent,
                 if (!(strcmp(dent->d_name, dot_lustre_name)))
                         continue;
 
-                path[len] = 0;
-                if ((len + dent->d_reclen + 2) > size) {
-                        llapi_err_noerrno(LLAPI_MSG_ERROR,
-                                          "error: %s: string buffer is too small",
-                                          __func__);
-                        break;
-                }
-                strcat(path, "/");
-                strcat(path, dent->d_name);
-
-                if (dent->d_type == DT_UNKNOWN) {
-			lstat_t *st = &param->fp_lmd->lmd_st;
-
-			rc = get_lmd_info(path, d, NULL, param->fp_lmd,
-					   param->fp_lum_size);
-			if (rc == 0)
-				dent->d_type = IFTODT(st->st_mode);
-			else if (ret == 0)
-				ret = rc;
-
-			if (rc == -ENOENT)
+		if (fb == NULL || !param->fp_batch_stat) {
+			rc = llapi_semantic_traverse_entry(path, len, size, d,
+							   dent, NULL,
+							   sem_init, sem_fini,
+							   data);
+		} else {
+			/* readdir64() may reuse its buffer, keep a copy */
+			bdent = &fb->fb_dents[fb->fb_count++];
+			bdent->d_ino = dent->d_ino;
+			bdent->d_reclen = dent->d_reclen;
+			bdent->d_type = dent->d_type;
+			strlcpy(bdent->d_name, dent->d_name,
+				sizeof(bdent->d_name));
+			if (fb->fb_count < LL_GETATTR_BATCH_MAX)
 				continue;
+
+			rc = llapi_semantic_traverse_batch(path, len, size, d,
+							   fb, sem_init,
+							   sem_fini, data);
 		}
-                switch (dent->d_type) {
-                case DT_UNKNOWN:
-                        llapi_err_noerrno(LLAPI_MSG_ERROR,
-                                          "error: %s: '%s' is UNKNOWN type %d",
-                                          __func__, dent->d_name, dent->d_type);
-                        break;
-		case DT_DIR:
-			rc = llapi_semantic_traverse(path, size, d, sem_init,
-						      sem_fini, data, dent);
-			if (rc != 0 && ret == 0)
-				ret = rc;
+		if (rc > 0)
 			break;
-		default:
-			rc = 0;
-			if (sem_init) {
-				rc = sem_init(path, d, NULL, data, dent);
-				if (rc < 0 && ret == 0)
-					ret = rc;
-			}
-			if (sem_fini && rc == 0)
-				sem_fini(path, d, NULL, data, dent);
-                }
-        }
+		if (rc < 0 && ret == 0)
+			ret = rc;
+	}
+
+	if (fb != NULL && fb->fb_count > 0 && dent == NULL) {
+		int rc;
+
+		rc = llapi_semantic_traverse_batch(path, len, size, d, fb,
+						   sem_init, sem_fini, data);
+		if (rc < 0 && ret == 0)
+			ret = rc;
+	}
 
 out:
         path[len] = 0;
@@ -1567,6 +2180,8 @@ out:
 	if (sem_fini)
 		sem_fini(path, parent, &d, data, de);
 err:
+	if (fb)
+		free(fb);
         if (d)
                 closedir(d);
         if (p)
@@ -2356,6 +2971,96 @@ void lmv_dump_user_lmm(struct lmv_user_md *lum, char *pool_name,
 		llapi_printf(LLAPI_MSG_NORMAL, "\n");
 }
 
+static void lov_dump_comp_v1(struct find_param *param, char *path)
+{
+	struct lov_comp_md_v1 *lcm = (void *)&param->fp_lmd->lmd_lmm;
+	struct lov_comp_md_entry_v1 *lcme;
+	struct lov_user_md *lum;
+	struct lov_user_ost_data_v1 *objects;
+	char pool_name[LOV_MAXPOOLNAME + 1];
+	int i;
+
+	if (param->fp_max_depth && path != NULL)
+		llapi_printf(LLAPI_MSG_NORMAL, "%s\n", path);
+
+	if (param->fp_verbose & VERBOSE_DETAIL) {
+		llapi_printf(LLAPI_MSG_NORMAL, "lcm_magic:          0x%08X\n",
+			     lcm->lcm_magic);
+		llapi_printf(LLAPI_MSG_NORMAL, "lcm_layout_gen:     %u\n",
+			     lcm->lcm_layout_gen);
+	}
+	if (lcm->lcm_mirror_count > 1) {
+		static const char *const states[] = {
+			[LCM_FL_NONE]		= "0",
+			[LCM_FL_RDONLY]		= "ro",
+			[LCM_FL_WRITE_PENDING]	= "wp",
+			[LCM_FL_SYNC_PENDING]	= "sp",
+		};
+
+		llapi_printf(LLAPI_MSG_NORMAL, "lcm_mirror_count:   %u\n",
+			     lcm->lcm_mirror_count);
+		llapi_printf(LLAPI_MSG_NORMAL, "lcm_flags:          %s\n",
+			     states[lcm->lcm_flags & LCM_FL_FLR_MASK]);
+	}
+	llapi_printf(LLAPI_MSG_NORMAL, "lcm_entry_count:    %u\n",
+		     lcm->lcm_entry_count);
+
+	for (i = 0; i < lcm->lcm_entry_count; i++) {
+		lcme = &lcm->lcm_entries[i];
+		lum = (struct lov_user_md *)((char *)lcm + lcme->lcme_offset);
+
+		llapi_printf(LLAPI_MSG_NORMAL, "  lcme_id:          %u\n",
+			     lcme->lcme_id);
+		if (lcm->lcm_mirror_count > 1)
+			llapi_printf(LLAPI_MSG_NORMAL,
+				     "  lcme_mirror_id:   %u\n",
+				     mirror_id_of(lcme->lcme_id));
+		llapi_printf(LLAPI_MSG_NORMAL, "  lcme_flags:       %s%s%s\n",
+			     lcme->lcme_flags & LCME_FL_INIT ? "init" : "0",
+			     lcme->lcme_flags & LCME_FL_STALE ? ",stale" : "",
+			     lcme->lcme_flags & LCME_FL_PREF_RD ? ",prefer" : "");
+		llapi_printf(LLAPI_MSG_NORMAL, "  lcme_extent:      ["LPU64", ",
+			     lcme->lcme_extent.e_start);
+		if (lcme->lcme_extent.e_end == LUSTRE_EOF)
+			llapi_printf(LLAPI_MSG_NORMAL, "EOF)\n");
+		else
+			llapi_printf(LLAPI_MSG_NORMAL, LPU64")\n",
+				     lcme->lcme_extent.e_end);
+
+		pool_name[0] = '\0';
+		objects = lum->lmm_objects;
+		if (lum->lmm_magic == LOV_USER_MAGIC_V3) {
+			struct lov_user_md_v3 *lumv3 = (void *)lum;
+
+			strlcpy(pool_name, lumv3->lmm_pool_name,
+				sizeof(pool_name));
+			objects = lumv3->lmm_objects;
+		}
+
+		if (lcme->lcme_flags & LCME_FL_INIT) {
+			lov_dump_user_lmm_v1v3(lum, pool_name[0] == '\0' ?
+					       NULL : pool_name,
+					       objects, NULL, 0,
+					       param->fp_obd_index, 0,
+					       param->fp_verbose,
+					       param->fp_raw);
+			continue;
+		}
+
+		/* no objects yet, the requested striping is shown as for
+		 * a directory default */
+		llapi_printf(LLAPI_MSG_NORMAL, "    stripe_count:   %d\n"
+			     "    stripe_size:    %u\n"
+			     "    stripe_offset:  %d\n",
+			     (__s16)lum->lmm_stripe_count,
+			     lum->lmm_stripe_size,
+			     (__s16)lum->lmm_stripe_offset);
+		if (pool_name[0] != '\0')
+			llapi_printf(LLAPI_MSG_NORMAL,
+				     "    pool:           %s\n", pool_name);
+	}
+}
+
 void llapi_lov_dump_user_lmm(struct find_param *param, char *path, int is_dir)
 {
 	__u32 magic;
@@ -2400,11 +3105,15 @@ void llapi_lov_dump_user_lmm(struct find_param *param, char *path, int is_dir)
 				  param->fp_max_depth, param->fp_verbose);
 		break;
 	}
+	case LOV_USER_MAGIC_COMP_V1:
+		lov_dump_comp_v1(param, path);
+		break;
 	default:
 		llapi_printf(LLAPI_MSG_NORMAL, "unknown lmm_magic:  %#x "
-			     "(expecting one of %#x %#x %#x %#x)\n",
+			     "(expecting one of %#x %#x %#x %#x %#x)\n",
 			     *(__u32 *)&param->fp_lmd->lmd_lmm,
 			     LOV_USER_MAGIC_V1, LOV_USER_MAGIC_V3,
+			     LOV_USER_MAGIC_COMP_V1,
 			     LMV_USER_MAGIC, LMV_MAGIC_V1);
 		return;
 	}
@@ -2452,6 +3161,135 @@ int llapi_file_get_stripe(const char *path, struct lov_user_md *lum)
         return rc;
 }
 
+/**
+ * Get the attributes of a file as known by its MDT, without glimpsing the
+ * OSTs. For a regular file with OST objects the size and blocks are only
+ * meaningful if they come from the lazy size-on-MDT, as told by the
+ * LL_LAZY_SIZE and LL_LAZY_BLOCKS flags returned in \a lazy. The lazy size
+ * may be older than the size known by the OSTs if the file is being written.
+ *
+ * \param[in] path	file to stat
+ * \param[out] st	attributes of the file
+ * \param[out] lazy	LL_LAZY_* flags
+ *
+ * \retval		0 on success, negative errno on failure
+ */
+int llapi_file_lazy_stat(const char *path, lstat_t *st, __u32 *lazy)
+{
+	struct lov_user_mds_data_lazy *lmdl;
+	const char *fname;
+	char *dname;
+	int lum_size;
+	int fd;
+	int rc = 0;
+
+	fname = strrchr(path, '/');
+	if (fname == NULL) {
+		dname = strdup(".");
+		fname = path;
+	} else {
+		dname = strndup(path, fname - path + 1);
+		fname++;
+	}
+	if (dname == NULL)
+		return -ENOMEM;
+
+	lum_size = get_mds_md_size(path);
+	if (lum_size < PATH_MAX + 1)
+		lum_size = PATH_MAX + 1;
+
+	lmdl = calloc(1, sizeof(*lmdl) + lum_size);
+	if (lmdl == NULL) {
+		rc = -ENOMEM;
+		goto out_free;
+	}
+
+	fd = open(dname, O_RDONLY | O_DIRECTORY);
+	if (fd < 0) {
+		rc = -errno;
+		goto out_free;
+	}
+
+	strlcpy((char *)lmdl, fname, lum_size);
+	if (ioctl(fd, IOC_MDC_GETFILEINFO_LAZY, lmdl) < 0 &&
+	    errno != EOVERFLOW) {
+		rc = -errno;
+		llapi_error(LLAPI_MSG_ERROR, rc,
+			    "cannot get MDT attributes of '%s'", path);
+	} else {
+		*st = lmdl->lmdl_lmd.lmd_st;
+		*lazy = lmdl->lmdl_lazy;
+	}
+	close(fd);
+out_free:
+	free(lmdl);
+	free(dname);
+	return rc;
+}
+
+/**
+ * Get the attributes of \a count entries of the directory open as \a dirfd
+ * with as few MDS RPCs as possible, see LL_IOC_GETATTR_BATCH. The attributes
+ * are those known by the MDT, as returned by llapi_file_lazy_stat().
+ *
+ * \param[in] dirfd	directory holding the entries
+ * \param[in] names	names of the entries
+ * \param[in] count	number of names
+ * \param[out] entries	\a count entries filled in the order of \a names,
+ *			each with its own status in lgbe_rc
+ *
+ * \retval		0 on success, negative errno on failure, -ENOTTY or
+ *			-EOPNOTSUPP if the batch is not supported
+ */
+int llapi_getattr_batch(int dirfd, char **names, int count,
+			struct ll_getattr_batch_entry *entries)
+{
+	struct ll_getattr_batch lgb;
+	char *buf;
+	int buflen = 0;
+	int done;
+	int i;
+	int rc = 0;
+
+	for (i = 0; i < count; i++)
+		buflen += strlen(names[i]) + 1;
+
+	buf = malloc(buflen);
+	if (buf == NULL)
+		return -ENOMEM;
+
+	for (done = 0; done < count; done += lgb.lgb_count) {
+		char *p = buf;
+
+		memset(&lgb, 0, sizeof(lgb));
+
+		/* as many names as fit in one ioctl */
+		for (i = done; i < count &&
+		     lgb.lgb_count < LL_GETATTR_BATCH_MAX; i++) {
+			int len = strlen(names[i]) + 1;
+
+			if (p - buf + len > LL_GETATTR_BATCH_NAMELEN_MAX &&
+			    lgb.lgb_count > 0)
+				break;
+			memcpy(p, names[i], len);
+			p += len;
+			lgb.lgb_count++;
+		}
+		lgb.lgb_namelen = p - buf;
+		lgb.lgb_names = (uintptr_t)buf;
+		lgb.lgb_entries = (uintptr_t)&entries[done];
+		memset(&entries[done], 0, lgb.lgb_count * sizeof(*entries));
+
+		if (ioctl(dirfd, LL_IOC_GETATTR_BATCH, &lgb) < 0) {
+			rc = -errno;
+			break;
+		}
+	}
+
+	free(buf);
+	return rc;
+}
+
 int llapi_file_lookup(int dirfd, const char *name)
 {
         struct obd_ioctl_data data = { 0 };
@@ -2684,6 +3522,7 @@ static int cb_find_init(char *path, DIR *parent, DIR **dirp,
 	lstat_t *st = &param->fp_lmd->lmd_st;
         int lustre_fs = 1;
         int checked_type = 0;
+	__u32 lazy = 0;
         int ret = 0;
 
         LASSERT(parent != NULL || dir != NULL);
@@ -2728,9 +3567,23 @@ static int cb_find_init(char *path, DIR *parent, DIR **dirp,
 	if (param->fp_type != 0 && checked_type == 0)
                 decision = 0;
 
-	if (decision == 0) {
+	if (decision == 0 && param->fp_batch_ent != NULL) {
+		struct ll_getattr_batch_entry *ent = param->fp_batch_ent;
+
+		/* the batch returns no layout, only whether there is one.
+		 * The attributes of a file without OST objects are final,
+		 * those of a striped file are checked on the OSTs like
+		 * after get_lmd_info(), unless its lazy size is enough */
+		*st = ent->lgbe_st;
+		if (param->fp_lazy)
+			lazy = ent->lgbe_lazy & (LL_LAZY_SIZE | LL_LAZY_BLOCKS);
+		param->fp_lmd->lmd_lmm.lmm_stripe_count =
+			S_ISREG(st->st_mode) &&
+			!(ent->lgbe_lazy & LL_BATCH_NOLAYOUT);
+	} else if (decision == 0) {
 		ret = get_lmd_info(path, parent, dir, param->fp_lmd,
-				   param->fp_lum_size);
+				   param->fp_lum_size,
+				   param->fp_lazy ? &lazy : NULL);
 		if (ret == 0 && param->fp_lmd->lmd_lmm.lmm_magic == 0 &&
 		    (param->fp_check_pool || param->fp_check_stripe_count ||
 		     param->fp_check_stripe_size || param->fp_check_layout)) {
@@ -2940,7 +3793,8 @@ obd_matches:
            'glimpse-size-ioctl'. */
 
 	if (param->fp_check_size && S_ISREG(st->st_mode) &&
-	    param->fp_lmd->lmd_lmm.lmm_stripe_count)
+	    param->fp_lmd->lmd_lmm.lmm_stripe_count &&
+	    !(lazy & LL_LAZY_SIZE))
                 decision = 0;
 
 	if (param->fp_check_size && S_ISDIR(st->st_mode))
@@ -3118,6 +3972,17 @@ int llapi_mv(char *path, struct find_param *param)
 
 int llapi_find(char *path, struct find_param *param)
 {
+	/* the MDT attributes are enough to check these, stat the entries of
+	 * each directory in batches rather than one RPC per entry */
+	param->fp_batch_stat = (param->fp_check_uid || param->fp_check_gid ||
+				param->fp_atime || param->fp_mtime ||
+				param->fp_ctime || param->fp_check_size) &&
+			       !(param->fp_obd_uuid || param->fp_mdt_uuid ||
+				 param->fp_check_pool ||
+				 param->fp_check_stripe_count ||
+				 param->fp_check_stripe_size ||
+				 param->fp_check_layout);
+
         return param_callback(path, cb_find_init, cb_common_fini, param);
 }
 
@@ -1496,6 +1496,64 @@ int llapi_hsm_current_action(const char *path, struct hsm_current_action *hca)
 	return rc;
 }
 
+/* issue a persistent client cache \a cmd on the file pointed by \a path */
+static int llapi_pcc_ioctl(const char *path, unsigned int cmd, void *arg)
+{
+	int fd;
+	int rc;
+
+	fd = open(path, O_RDONLY | O_NONBLOCK);
+	if (fd < 0)
+		return -errno;
+
+	rc = ioctl(fd, cmd, arg);
+	/* If error, save errno value */
+	rc = rc ? -errno : 0;
+
+	close(fd);
+	return rc;
+}
+
+/**
+ * Copy the file pointed by \a path into the persistent cache of this client,
+ * its reads are served from the local copy until the file is modified.
+ *
+ * \retval 0 on success, or if the file was already attached.
+ * \retval -EOPNOTSUPP if the client has no persistent cache.
+ * \retval -EBUSY if the file is open for write or was modified meanwhile.
+ * \retval -errno on other errors.
+ */
+int llapi_pcc_attach(const char *path)
+{
+	return llapi_pcc_ioctl(path, LL_IOC_PCC_ATTACH, NULL);
+}
+
+/**
+ * Drop the copy of the file pointed by \a path from the persistent cache of
+ * this client.
+ *
+ * \retval 0 on success.
+ * \retval -errno on error.
+ */
+int llapi_pcc_detach(const char *path)
+{
+	return llapi_pcc_ioctl(path, LL_IOC_PCC_DETACH, NULL);
+}
+
+/**
+ * Return whether the file pointed by \a path is in the persistent cache of
+ * this client, and the path of its copy.
+ *
+ * \param state  Should be allocated by caller.
+ *
+ * \retval 0 on success.
+ * \retval -errno on error.
+ */
+int llapi_pcc_state_get(const char *path, struct lu_pcc_state *state)
+{
+	return llapi_pcc_ioctl(path, LL_IOC_PCC_STATE, state);
+}
+
 /**
  * Allocate a hsm_user_request with the specified carateristics.
  * This structure should be freed with free().
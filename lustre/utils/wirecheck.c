@@ -228,6 +228,17 @@ check_hsm_attrs(void)
 	CHECK_MEMBER(hsm_attrs, hsm_arch_ver);
 }
 
+static void
+check_lustre_som_attrs(void)
+{
+	BLANK_LINE();
+	CHECK_STRUCT(lustre_som_attrs);
+	CHECK_MEMBER(lustre_som_attrs, lsa_valid);
+	CHECK_MEMBER(lustre_som_attrs, lsa_reserved);
+	CHECK_MEMBER(lustre_som_attrs, lsa_size);
+	CHECK_MEMBER(lustre_som_attrs, lsa_blocks);
+}
+
 static void
 check_ost_id(void)
 {
@@ -536,6 +547,13 @@ check_obd_connect_data(void)
 	CHECK_DEFINE_64X(OBD_CONNECT_BULK_MBITS);
 	CHECK_DEFINE_64X(OBD_CONNECT_OBDOPACK);
 	CHECK_DEFINE_64X(OBD_CONNECT_FLAGS2);
+	CHECK_DEFINE_64X(OBD_CONNECT2_BATCH_GETATTR);
+	CHECK_DEFINE_64X(OBD_CONNECT2_LOCK_CONVERT);
+	CHECK_DEFINE_64X(OBD_CONNECT2_BL_BATCH);
+	CHECK_DEFINE_64X(OBD_CONNECT2_LOCK_REPLAY_BATCH);
+	CHECK_DEFINE_64X(OBD_CONNECT2_DOM);
+	CHECK_DEFINE_64X(OBD_CONNECT2_BATCH_GETATTR_LOCK);
+	CHECK_DEFINE_64X(OBD_CONNECT2_BRW_COMPRESS);
 
 	CHECK_VALUE_X(OBD_CKSUM_CRC32);
 	CHECK_VALUE_X(OBD_CKSUM_ADLER);
@@ -623,6 +641,8 @@ check_obdo(void)
 	CHECK_DEFINE_64X(OBD_MD_FLRMTRSETFACL);
 	CHECK_DEFINE_64X(OBD_MD_FLRMTRGETFACL);
 	CHECK_DEFINE_64X(OBD_MD_FLDATAVERSION);
+	CHECK_DEFINE_64X(OBD_MD_FLLAZYSIZE);
+	CHECK_DEFINE_64X(OBD_MD_FLLAZYBLOCKS);
 
 	CHECK_CVALUE_X(OBD_FL_INLINEDATA);
 	CHECK_CVALUE_X(OBD_FL_OBDMDEXISTS);
@@ -646,6 +666,7 @@ check_obdo(void)
 	CHECK_CVALUE_X(OBD_FL_NOSPC_BLK);
 	CHECK_CVALUE_X(OBD_FL_FLUSH);
 	CHECK_CVALUE_X(OBD_FL_SHORT_IO);
+	CHECK_CVALUE_X(OBD_FL_BRW_COMPRESS);
 	CHECK_CVALUE_X(OBD_FL_LOCAL_MASK);
 }
 
@@ -694,10 +715,44 @@ check_lov_mds_md_v3(void)
 
 	CHECK_VALUE_X(LOV_PATTERN_RAID0);
 	CHECK_VALUE_X(LOV_PATTERN_RAID1);
-	CHECK_VALUE_X(LOV_PATTERN_FIRST);
+	CHECK_VALUE_X(LOV_PATTERN_MDT);
 	CHECK_VALUE_X(LOV_PATTERN_CMOBD);
 }
 
+static void
+check_lov_comp_md_entry_v1(void)
+{
+	BLANK_LINE();
+	CHECK_STRUCT(lov_comp_md_entry_v1);
+	CHECK_MEMBER(lov_comp_md_entry_v1, lcme_id);
+	CHECK_MEMBER(lov_comp_md_entry_v1, lcme_flags);
+	CHECK_MEMBER(lov_comp_md_entry_v1, lcme_extent.e_start);
+	CHECK_MEMBER(lov_comp_md_entry_v1, lcme_extent.e_end);
+	CHECK_MEMBER(lov_comp_md_entry_v1, lcme_offset);
+	CHECK_MEMBER(lov_comp_md_entry_v1, lcme_size);
+	CHECK_MEMBER(lov_comp_md_entry_v1, lcme_padding);
+
+	CHECK_VALUE_X(LCME_FL_INIT);
+}
+
+static void
+check_lov_comp_md_v1(void)
+{
+	BLANK_LINE();
+	CHECK_STRUCT(lov_comp_md_v1);
+	CHECK_MEMBER(lov_comp_md_v1, lcm_magic);
+	CHECK_MEMBER(lov_comp_md_v1, lcm_size);
+	CHECK_MEMBER(lov_comp_md_v1, lcm_layout_gen);
+	CHECK_MEMBER(lov_comp_md_v1, lcm_flags);
+	CHECK_MEMBER(lov_comp_md_v1, lcm_entry_count);
+	CHECK_MEMBER(lov_comp_md_v1, lcm_mirror_count);
+	CHECK_MEMBER(lov_comp_md_v1, lcm_padding1);
+	CHECK_MEMBER(lov_comp_md_v1, lcm_padding2);
+	CHECK_MEMBER(lov_comp_md_v1, lcm_entries[0]);
+
+	CHECK_CDEFINE(LOV_MAGIC_COMP_V1);
+}
+
 static void
 check_lmv_mds_md_v1(void)
 {
@@ -884,6 +939,16 @@ check_niobuf_remote(void)
 	CHECK_DEFINE_X(OBD_BRW_SOFT_SYNC);
 }
 
+static void
+check_brw_chunk_hdr(void)
+{
+	BLANK_LINE();
+	CHECK_STRUCT(brw_chunk_hdr);
+	CHECK_MEMBER(brw_chunk_hdr, bch_len);
+	CHECK_MEMBER(brw_chunk_hdr, bch_csize);
+	CHECK_VALUE(BRW_CHUNK_MAX_LEN);
+}
+
 static void
 check_ost_body(void)
 {
@@ -981,6 +1046,7 @@ check_mdt_body(void)
 	CHECK_DEFINE_X(MDS_INODELOCK_UPDATE);
 	CHECK_DEFINE_X(MDS_INODELOCK_OPEN);
 	CHECK_DEFINE_X(MDS_INODELOCK_LAYOUT);
+	CHECK_DEFINE_X(MDS_INODELOCK_DOM);
 }
 
 static void
@@ -994,6 +1060,25 @@ check_mdt_ioepoch(void)
 	CHECK_MEMBER(mdt_ioepoch, mio_padding);
 }
 
+static void
+check_mdt_batch_getattr_rep(void)
+{
+	BLANK_LINE();
+	CHECK_STRUCT(mdt_batch_getattr_rep);
+	CHECK_MEMBER(mdt_batch_getattr_rep, mbgr_rc);
+	CHECK_MEMBER(mdt_batch_getattr_rep, mbgr_padding);
+	CHECK_MEMBER(mdt_batch_getattr_rep, mbgr_body);
+}
+
+static void
+check_mdt_batch_lock_rep(void)
+{
+	BLANK_LINE();
+	CHECK_STRUCT(mdt_batch_lock_rep);
+	CHECK_MEMBER(mdt_batch_lock_rep, mblr_handle);
+	CHECK_MEMBER(mdt_batch_lock_rep, mblr_bits);
+}
+
 static void
 check_mdt_remote_perm(void)
 {
@@ -1345,6 +1430,8 @@ check_ldlm_lock_desc(void)
 	CHECK_MEMBER(ldlm_lock_desc, l_req_mode);
 	CHECK_MEMBER(ldlm_lock_desc, l_granted_mode);
 	CHECK_MEMBER(ldlm_lock_desc, l_policy_data);
+	CHECK_MEMBER(ldlm_lock_desc, l_padding1);
+	CHECK_MEMBER(ldlm_lock_desc, l_padding2);
 }
 
 static void
@@ -1371,6 +1458,26 @@ check_ldlm_reply(void)
 	CHECK_MEMBER(ldlm_reply, lock_policy_res2);
 }
 
+static void
+check_ldlm_replay_desc(void)
+{
+	BLANK_LINE();
+	CHECK_STRUCT(ldlm_replay_desc);
+	CHECK_MEMBER(ldlm_replay_desc, lrd_handle);
+	CHECK_MEMBER(ldlm_replay_desc, lrd_desc);
+	CHECK_MEMBER(ldlm_replay_desc, lrd_flags);
+}
+
+static void
+check_ldlm_replay_rep(void)
+{
+	BLANK_LINE();
+	CHECK_STRUCT(ldlm_replay_rep);
+	CHECK_MEMBER(ldlm_replay_rep, lrp_handle);
+	CHECK_MEMBER(ldlm_replay_rep, lrp_status);
+	CHECK_MEMBER(ldlm_replay_rep, lrp_padding);
+}
+
 static void
 check_ldlm_ost_lvb_v1(void)
 {
@@ -2028,6 +2135,8 @@ static void check_layout_intent(void)
 	CHECK_VALUE(LAYOUT_INTENT_TRUNC);
 	CHECK_VALUE(LAYOUT_INTENT_RELEASE);
 	CHECK_VALUE(LAYOUT_INTENT_RESTORE);
+	CHECK_VALUE(LAYOUT_INTENT_RESYNC);
+	CHECK_VALUE(LAYOUT_INTENT_RESYNC_DONE);
 }
 
 static void check_hsm_state_set(void)
@@ -2451,6 +2560,7 @@ main(int argc, char **argv)
 	CHECK_VALUE(MDS_HSM_CT_REGISTER);
 	CHECK_VALUE(MDS_HSM_CT_UNREGISTER);
 	CHECK_VALUE(MDS_SWAP_LAYOUTS);
+	CHECK_VALUE(MDS_BATCH_GETATTR);
 	CHECK_VALUE(MDS_LAST_OPC);
 
 	CHECK_VALUE(REINT_SETATTR);
@@ -2602,6 +2712,7 @@ main(int argc, char **argv)
 	CHECK_VALUE(OUT_READ);
 
 	check_hsm_attrs();
+	check_lustre_som_attrs();
 	check_ost_id();
 	check_lu_dirent();
 	check_luda_type();
@@ -2614,16 +2725,21 @@ main(int argc, char **argv)
 	check_lov_ost_data_v1();
 	check_lov_mds_md_v1();
 	check_lov_mds_md_v3();
+	check_lov_comp_md_entry_v1();
+	check_lov_comp_md_v1();
 	check_lmv_mds_md_v1();
 	check_obd_statfs();
 	check_obd_ioobj();
 	check_obd_quotactl();
 	check_obd_idx_read();
 	check_niobuf_remote();
+	check_brw_chunk_hdr();
 	check_ost_body();
 	check_ll_fid();
 	check_mdt_body();
 	check_mdt_ioepoch();
+	check_mdt_batch_getattr_rep();
+	check_mdt_batch_lock_rep();
 	check_mdt_remote_perm();
 	check_mdt_rec_setattr();
 	check_mdt_rec_create();
@@ -2643,6 +2759,8 @@ main(int argc, char **argv)
 	check_ldlm_lock_desc();
 	check_ldlm_request();
 	check_ldlm_reply();
+	check_ldlm_replay_desc();
+	check_ldlm_replay_rep();
 	check_ldlm_ost_lvb_v1();
 	check_ldlm_ost_lvb();
 	check_ldlm_lquota_lvb();